@@ -34,7 +34,7 @@ ifeq ($(OS),Windows_NT)
 	REMOVE_FILE=@if exist "$(1)" del /Q "$(1)"
 	MAKE_DIR=@if not exist "$(1)" mkdir "$(1)"
 	TARGET_EXTENSION=.exe
-	LIBS=
+	LIBS=-lpsapi
 	ifeq ($(PROCESSOR_ARCHITEW6432),AMD64)
 		ARCH=-m64
 	else ifeq ($(PROCESSOR_ARCHITECTURE),AMD64)
@@ -56,7 +56,8 @@ else ifeq ($(shell uname -s),Linux)
 		MAKE_DIR=mkdir -p "$(1)"
 		TARGET_EXTENSION=
 		MACHINE_ARCH=$(shell uname -m)
-		LIBS=-lrt
+		LIBS=-lrt -lm -rdynamic
+		#(-rdynamic exports symbols so crash backtraces show function names)
 		ifeq ($(MACHINE_ARCH),x86_64)
 			ARCH=-m64
 		else ifeq ($(MACHINE_ARCH),i386)
@@ -147,7 +148,7 @@ all:$(TARGET)
 
 $(TARGET):create_dirs $(OFILES)
 	@echo "linking..."
-	@$(CC) $(LFLAGS) $(LIBS) $(OFILES) -o $(TARGET)
+	@$(CC) $(LFLAGS) $(OFILES) $(LIBS) -o $(TARGET)
 
 $(BIN_INT)/%.o:%.c
 	@$(call MAKE_DIR,$(dir $@))
@@ -0,0 +1,44 @@
+#ifndef BENCH__H
+#define BENCH__H
+
+#include "defines.h"
+#include "logger.h"
+
+// benchmarks run in release where LOGx compiles out, results always go to stdout
+#define BENCH_PRINT(msg_fmt, ...) log_stdout(msg_fmt "\n", ##__VA_ARGS__)
+
+typedef struct bench_config {
+    // highest thread count, thread counts double from 1 up to it
+    u32 max_threads;
+    // operations each thread performs per workload
+    u64 ops_per_thread;
+    // workloads whose name does not contain this substring are skipped (0 runs all)
+    const char* filter;
+    // optional csv file receiving one row per workload and thread count
+    const char* csv_path;
+} bench_config;
+
+typedef struct bench_result {
+    const char* workload;
+    u32 threads;
+    u64 ops;
+    f64 seconds;
+    f64 ops_per_sec;
+    // latency percentiles of sampled operations in nanoseconds
+    f64 p50;
+    f64 p90;
+    f64 p99;
+    f64 p999;
+    f64 max;
+    // resident memory right after the workload and process peak
+    u64 rss;
+    u64 peak_rss;
+} bench_result;
+
+void bench_report_header();
+
+void bench_report(bench_result* result);
+
+void run_memory_benchmarks(bench_config* config);
+
+#endif
@@ -0,0 +1,393 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "memory.h"
+#include "zthread.h"
+#include "zmutex.h"
+#include "zsemaphore.h"
+#include "zatomic.h"
+#include "platform.h"
+
+//    ███    ███ ███████ ███    ███  ██████  ██████  ██    ██
+//    ████  ████ ██      ████  ████ ██    ██ ██   ██  ██  ██
+//    ██ ████ ██ █████   ██ ████ ██ ██    ██ ██████    ████
+//    ██  ██  ██ ██      ██  ██  ██ ██    ██ ██   ██    ██
+//    ██      ██ ███████ ██      ██  ██████  ██   ██    ██
+//
+//
+
+/**
+ * allocator workloads run against the memory.h api at increasing thread counts.
+ * every LATENCY_SAMPLE_RATE-th operation is timed individually for the percentiles
+ */
+
+#define LATENCY_SAMPLE_RATE 16
+#define WINDOW_SLOTS 64
+#define LARSON_SLOTS 256
+#define LARSON_ROUNDS 4
+#define CROSS_BATCH 256
+#define QUEUE_CAPACITY 1024
+
+typedef struct bench_shared {
+    u32 thread_count;
+    u64 ops_per_thread;
+    volatile u32 barrier_count;
+    volatile u32 barrier_sense;
+    // size distribution of the current workload
+    u32 min_size;
+    u32 max_size;
+    // producer/consumer queue
+    void** queue;
+    u64 head;
+    u64 tail;
+    zmutex queue_mutex;
+    zsemaphore queue_items;
+    zsemaphore queue_slots;
+    // per thread block arrays handed between threads by larson and cross thread free
+    void*** slots;
+} bench_shared;
+
+typedef struct bench_thread {
+    bench_shared* shared;
+    u32 index;
+    u32 barrier_sense;
+    u64 rng;
+    u64 ops;
+    f64 start;
+    f64 end;
+    f64* latencies;
+    u64 latency_count;
+    u64 latency_capacity;
+} bench_thread;
+
+typedef void (*bench_workload)(bench_thread* thread);
+
+static u64 bench_random(bench_thread* thread) {
+    // xorshift64*
+    thread->rng ^= thread->rng >> 12;
+    thread->rng ^= thread->rng << 25;
+    thread->rng ^= thread->rng >> 27;
+    return thread->rng * 2685821657736338717ULL;
+}
+
+static u32 bench_size(bench_thread* thread) {
+    bench_shared* shared = thread->shared;
+    if (shared->min_size == shared->max_size) {
+        return shared->min_size;
+    }
+    if (shared->max_size > 16 * shared->min_size) {
+        // log uniform, small blocks dominate as in real programs
+        u32 min_bits = 31 - __builtin_clz(shared->min_size);
+        u32 max_bits = 31 - __builtin_clz(shared->max_size);
+        u32 bits = min_bits + (u32)(bench_random(thread) % (max_bits - min_bits + 1));
+        u32 size = (1u << bits) + (u32)(bench_random(thread) % (1u << bits));
+        // the top and bottom octaves reach past the bounds unless they are powers of two
+        size = size > shared->max_size ? shared->max_size : size;
+        return size < shared->min_size ? shared->min_size : size;
+    }
+    return shared->min_size + (u32)(bench_random(thread) % (shared->max_size - shared->min_size + 1));
+}
+
+static void bench_barrier(bench_thread* thread) {
+    bench_shared* shared = thread->shared;
+    thread->barrier_sense = !thread->barrier_sense;
+    if (zatomic_add_u32(&shared->barrier_count, 1) == shared->thread_count - 1) {
+        zatomic_store_u32(&shared->barrier_count, 0);
+        zatomic_store_u32(&shared->barrier_sense, thread->barrier_sense);
+    } else {
+        while (zatomic_load_u32(&shared->barrier_sense) != thread->barrier_sense) {
+            zthread_yield();
+        }
+    }
+}
+
+static void record_latency(bench_thread* thread, f64 seconds) {
+    if (thread->latency_count < thread->latency_capacity) {
+        thread->latencies[thread->latency_count++] = seconds;
+    }
+}
+
+static void* timed_allocate(bench_thread* thread, u32 size) {
+    void* ptr;
+    if (thread->ops++ % LATENCY_SAMPLE_RATE == 0) {
+        f64 start = platform_time();
+        ptr = memory_allocate(size);
+        record_latency(thread, platform_time() - start);
+    } else {
+        ptr = memory_allocate(size);
+    }
+    // touch the block so the pages are really committed
+    *(u8*)ptr = (u8)size;
+    return ptr;
+}
+
+static void timed_free(bench_thread* thread, void* ptr) {
+    if (thread->ops++ % LATENCY_SAMPLE_RATE == 0) {
+        f64 start = platform_time();
+        memory_free(ptr);
+        record_latency(thread, platform_time() - start);
+    } else {
+        memory_free(ptr);
+    }
+}
+
+//    ██     ██  ██████  ██████  ██   ██ ██       ██████   █████  ██████  ███████
+//    ██     ██ ██    ██ ██   ██ ██  ██  ██      ██    ██ ██   ██ ██   ██ ██
+//    ██  █  ██ ██    ██ ██████  █████   ██      ██    ██ ███████ ██   ██ ███████
+//    ██ ███ ██ ██    ██ ██   ██ ██  ██  ██      ██    ██ ██   ██ ██   ██      ██
+//     ███ ███   ██████  ██   ██ ██   ██ ███████  ██████  ██   ██ ██████  ███████
+//
+//
+
+// each thread keeps a small window of live blocks and keeps replacing them
+static void workload_size_distribution(bench_thread* thread) {
+    void* window[WINDOW_SLOTS] = {0};
+    u64 ops = thread->shared->ops_per_thread;
+    for (u64 i = 0; thread->ops < ops; ++i) {
+        u32 slot = (u32)(i % WINDOW_SLOTS);
+        if (window[slot]) {
+            timed_free(thread, window[slot]);
+        }
+        window[slot] = timed_allocate(thread, bench_size(thread));
+    }
+    for (u32 slot = 0; slot < WINDOW_SLOTS; ++slot) {
+        if (window[slot]) {
+            memory_free(window[slot]);
+        }
+    }
+}
+
+// larson server simulation: random slots are replaced, and between rounds every
+// thread inherits the blocks of its neighbour so most frees hit foreign blocks
+static void workload_larson(bench_thread* thread) {
+    bench_shared* shared = thread->shared;
+    void** slots = shared->slots[thread->index];
+    for (u32 i = 0; i < LARSON_SLOTS; ++i) {
+        slots[i] = memory_allocate(bench_size(thread));
+    }
+    u64 ops_per_round = shared->ops_per_thread / LARSON_ROUNDS;
+    for (u32 round = 0; round < LARSON_ROUNDS; ++round) {
+        for (u64 end = thread->ops + ops_per_round; thread->ops < end;) {
+            u32 slot = (u32)(bench_random(thread) % LARSON_SLOTS);
+            timed_free(thread, slots[slot]);
+            slots[slot] = timed_allocate(thread, bench_size(thread));
+        }
+        bench_barrier(thread);
+        slots = shared->slots[(thread->index + round + 1) % shared->thread_count];
+        bench_barrier(thread);
+    }
+    for (u32 i = 0; i < LARSON_SLOTS; ++i) {
+        memory_free(slots[i]);
+    }
+}
+
+// every block is freed by a different thread than the one that allocated it
+static void workload_cross_thread_free(bench_thread* thread) {
+    bench_shared* shared = thread->shared;
+    void** outbox = shared->slots[thread->index];
+    void** inbox = shared->slots[(thread->index + 1) % shared->thread_count];
+    u64 rounds = shared->ops_per_thread / (2 * CROSS_BATCH);
+    rounds = rounds ? rounds : 1;
+    for (u64 round = 0; round < rounds; ++round) {
+        for (u32 i = 0; i < CROSS_BATCH; ++i) {
+            outbox[i] = timed_allocate(thread, bench_size(thread));
+        }
+        bench_barrier(thread);
+        for (u32 i = 0; i < CROSS_BATCH; ++i) {
+            timed_free(thread, inbox[i]);
+        }
+        bench_barrier(thread);
+    }
+}
+
+// half the threads allocate and push blocks through a bounded queue, the other half pop and free
+static void workload_producer_consumer(bench_thread* thread) {
+    bench_shared* shared = thread->shared;
+    if (shared->thread_count == 1) {
+        // nobody to hand blocks to, alternate roles on the one thread
+        void* blocks[QUEUE_CAPACITY];
+        while (thread->ops < shared->ops_per_thread) {
+            for (u32 i = 0; i < QUEUE_CAPACITY; ++i) {
+                blocks[i] = timed_allocate(thread, bench_size(thread));
+            }
+            for (u32 i = 0; i < QUEUE_CAPACITY; ++i) {
+                timed_free(thread, blocks[i]);
+            }
+        }
+        return;
+    }
+    u32 producers = shared->thread_count / 2;
+    u32 consumers = shared->thread_count - producers;
+    u64 items = shared->ops_per_thread * producers;
+    bool producer = thread->index < producers;
+    u32 role_index = producer ? thread->index : thread->index - producers;
+    u32 role_count = producer ? producers : consumers;
+    // split the items evenly so every pushed block is popped exactly once
+    u64 count = items / role_count + (role_index < items % role_count ? 1 : 0);
+    for (u64 i = 0; i < count; ++i) {
+        if (producer) {
+            void* block = timed_allocate(thread, bench_size(thread));
+            zsemaphore_wait(&shared->queue_slots);
+            zmutex_lock(&shared->queue_mutex);
+            shared->queue[shared->tail++ % QUEUE_CAPACITY] = block;
+            zmutex_unlock(&shared->queue_mutex);
+            zsemaphore_signal(&shared->queue_items);
+        } else {
+            zsemaphore_wait(&shared->queue_items);
+            zmutex_lock(&shared->queue_mutex);
+            void* block = shared->queue[shared->head++ % QUEUE_CAPACITY];
+            zmutex_unlock(&shared->queue_mutex);
+            zsemaphore_signal(&shared->queue_slots);
+            timed_free(thread, block);
+        }
+    }
+}
+
+//    ██████  ██    ██ ███    ██ ███    ██ ███████ ██████
+//    ██   ██ ██    ██ ████   ██ ████   ██ ██      ██   ██
+//    ██████  ██    ██ ██ ██  ██ ██ ██  ██ █████   ██████
+//    ██   ██ ██    ██ ██  ██ ██ ██  ██ ██ ██      ██   ██
+//    ██   ██  ██████  ██   ████ ██   ████ ███████ ██   ██
+//
+//
+
+typedef struct bench_thread_params {
+    bench_thread* thread;
+    bench_workload workload;
+} bench_thread_params;
+
+static zthread_func_return_type bench_thread_main(void* params) {
+    bench_thread_params* p = (bench_thread_params*)params;
+    bench_barrier(p->thread);
+    p->thread->start = platform_time();
+    p->workload(p->thread);
+    p->thread->end = platform_time();
+    return 0;
+}
+
+static i32 compare_f64(const void* a, const void* b) {
+    f64 x = *(const f64*)a;
+    f64 y = *(const f64*)b;
+    return (x > y) - (x < y);
+}
+
+static f64 percentile(f64* sorted, u64 count, f64 fraction) {
+    if (count == 0) {
+        return 0;
+    }
+    u64 index = (u64)(fraction * (count - 1) + 0.5);
+    return sorted[index] * 1e9;
+}
+
+static void run_workload(const char* name, bench_workload workload, u32 min_size, u32 max_size, u32 thread_count, bench_config* config) {
+    bench_shared shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.thread_count = thread_count;
+    shared.ops_per_thread = config->ops_per_thread;
+    shared.min_size = min_size;
+    shared.max_size = max_size;
+    shared.queue = (void**)memory_allocate(sizeof(void*) * QUEUE_CAPACITY);
+    zmutex_create(&shared.queue_mutex);
+    zsemaphore_create(&shared.queue_items, 0);
+    zsemaphore_create(&shared.queue_slots, QUEUE_CAPACITY);
+    shared.slots = (void***)memory_allocate(sizeof(void**) * thread_count);
+
+    zthread* threads = (zthread*)memory_allocate(sizeof(zthread) * thread_count);
+    bench_thread* data = (bench_thread*)memory_allocate(sizeof(bench_thread) * thread_count);
+    bench_thread_params* params = (bench_thread_params*)memory_allocate(sizeof(bench_thread_params) * thread_count);
+    // producer/consumer threads can do up to ops_per_thread * 2 operations
+    u64 latency_capacity = config->ops_per_thread * 2 / LATENCY_SAMPLE_RATE + 16;
+    for (u32 i = 0; i < thread_count; ++i) {
+        shared.slots[i] = (void**)memory_allocate(sizeof(void*) * (LARSON_SLOTS > CROSS_BATCH ? LARSON_SLOTS : CROSS_BATCH));
+        memset(&data[i], 0, sizeof(bench_thread));
+        data[i].shared = &shared;
+        data[i].index = i;
+        data[i].rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+        data[i].latency_capacity = latency_capacity;
+        data[i].latencies = (f64*)memory_allocate(sizeof(f64) * latency_capacity);
+        params[i].thread = &data[i];
+        params[i].workload = workload;
+    }
+
+    for (u32 i = 0; i < thread_count; ++i) {
+        zthread_create(bench_thread_main, &params[i], &threads[i]);
+    }
+    for (u32 i = 0; i < thread_count; ++i) {
+        zthread_wait(&threads[i]);
+        zthread_destroy(&threads[i]);
+    }
+
+    bench_result result;
+    result.workload = name;
+    result.threads = thread_count;
+    result.ops = 0;
+    f64 start = data[0].start;
+    f64 end = data[0].end;
+    u64 latency_count = 0;
+    for (u32 i = 0; i < thread_count; ++i) {
+        result.ops += data[i].ops;
+        start = data[i].start < start ? data[i].start : start;
+        end = data[i].end > end ? data[i].end : end;
+        latency_count += data[i].latency_count;
+    }
+    f64* latencies = (f64*)memory_allocate(sizeof(f64) * (latency_count + 1));
+    latency_count = 0;
+    for (u32 i = 0; i < thread_count; ++i) {
+        memcpy(latencies + latency_count, data[i].latencies, sizeof(f64) * data[i].latency_count);
+        latency_count += data[i].latency_count;
+    }
+    qsort(latencies, latency_count, sizeof(f64), compare_f64);
+
+    result.seconds = end - start;
+    result.ops_per_sec = result.seconds > 0 ? result.ops / result.seconds : 0;
+    result.p50 = percentile(latencies, latency_count, 0.50);
+    result.p90 = percentile(latencies, latency_count, 0.90);
+    result.p99 = percentile(latencies, latency_count, 0.99);
+    result.p999 = percentile(latencies, latency_count, 0.999);
+    result.max = percentile(latencies, latency_count, 1.0);
+    result.rss = platform_memory_usage();
+    result.peak_rss = platform_peak_memory_usage();
+    bench_report(&result);
+
+    memory_free(latencies);
+    for (u32 i = 0; i < thread_count; ++i) {
+        memory_free(shared.slots[i]);
+        memory_free(data[i].latencies);
+    }
+    memory_free(params);
+    memory_free(data);
+    memory_free(threads);
+    memory_free(shared.slots);
+    memory_free(shared.queue);
+    zmutex_destroy(&shared.queue_mutex);
+    zsemaphore_destroy(&shared.queue_items);
+    zsemaphore_destroy(&shared.queue_slots);
+}
+
+typedef struct workload_entry {
+    const char* name;
+    bench_workload workload;
+    u32 min_size;
+    u32 max_size;
+} workload_entry;
+
+void run_memory_benchmarks(bench_config* config) {
+    workload_entry workloads[] = {
+        {"size_small", workload_size_distribution, 8, 64},
+        {"size_medium", workload_size_distribution, 64, 4096},
+        {"size_large", workload_size_distribution, 4096, 256 * 1024},
+        {"size_mixed", workload_size_distribution, 8, 256 * 1024},
+        {"larson", workload_larson, 8, 1024},
+        {"cross_thread_free", workload_cross_thread_free, 16, 512},
+        {"producer_consumer", workload_producer_consumer, 16, 512},
+    };
+    bench_report_header();
+    for (u32 w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        if (config->filter && strstr(workloads[w].name, config->filter) == 0) {
+            continue;
+        }
+        for (u32 threads = 1; threads <= config->max_threads; threads *= 2) {
+            run_workload(workloads[w].name, workloads[w].workload, workloads[w].min_size, workloads[w].max_size, threads, config);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+// ============================================================================
+// BENCHMARK RUNNER
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "memory.h"
+#include "platform.h"
+
+static FILE* csv_file;
+
+void bench_report_header() {
+    BENCH_PRINT("%-20s %7s %12s %14s %10s %10s %10s %10s %12s %10s %10s", "workload", "threads", "ops", "ops/sec",
+                "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns", "rss MB", "peak MB");
+}
+
+void bench_report(bench_result* r) {
+    BENCH_PRINT("%-20s %7u %12llu %14.0f %10.0f %10.0f %10.0f %10.0f %12.0f %10.1f %10.1f", r->workload, r->threads, r->ops,
+                r->ops_per_sec, r->p50, r->p90, r->p99, r->p999, r->max, r->rss / (1024.0 * 1024.0), r->peak_rss / (1024.0 * 1024.0));
+    if (csv_file) {
+        fprintf(csv_file, "%s,%u,%llu,%.9f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%llu,%llu\n", r->workload, r->threads, r->ops, r->seconds,
+                r->ops_per_sec, r->p50, r->p90, r->p99, r->p999, r->max, r->rss, r->peak_rss);
+        fflush(csv_file);
+    }
+}
+
+static bool match_option(const char* arg, const char* option, const char** value) {
+    u64 length = strlen(option);
+    if (strncmp(arg, option, length) != 0 || arg[length] != '=') {
+        return FALSE;
+    }
+    *value = arg + length + 1;
+    return TRUE;
+}
+
+// --threads=N     highest thread count (default: processor count)
+// --ops=N         operations per thread per workload (default 200000)
+// --filter=name   only run workloads whose name contains name
+// --csv=path      also write the results as csv
+int main(int argc, char** argv) {
+    bench_config config;
+    config.max_threads = 0;
+    config.ops_per_thread = 200000;
+    config.filter = 0;
+    config.csv_path = 0;
+    for (i32 i = 1; i < argc; ++i) {
+        const char* value;
+        if (match_option(argv[i], "--threads", &value)) {
+            config.max_threads = (u32)strtoul(value, 0, 10);
+        } else if (match_option(argv[i], "--ops", &value)) {
+            config.ops_per_thread = strtoull(value, 0, 10);
+        } else if (match_option(argv[i], "--filter", &value)) {
+            config.filter = value;
+        } else if (match_option(argv[i], "--csv", &value)) {
+            config.csv_path = value;
+        } else {
+            BENCH_PRINT("unknown argument %s", argv[i]);
+            return 1;
+        }
+    }
+    if (config.max_threads == 0) {
+        config.max_threads = platform_processor_count();
+    }
+
+    if (config.csv_path) {
+        csv_file = fopen(config.csv_path, "w");
+        if (!csv_file) {
+            BENCH_PRINT("unable to open %s", config.csv_path);
+            return 1;
+        }
+        fprintf(csv_file, "workload,threads,ops,seconds,ops_per_sec,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,rss,peak_rss\n");
+    }
+
+    memory_init(TRUE);
+    run_memory_benchmarks(&config);
+    memory_shutdown();
+
+    if (csv_file) {
+        fclose(csv_file);
+    }
+    return 0;
+}
@@ -0,0 +1,851 @@
+#include "bvh.h"
+#include <stdlib.h>
+#include "ray_packet.h"
+#include "arena.h"
+#include "clock.h"
+#include "logger.h"
+#include "zatomic.h"
+#include "memory.h"
+
+// ranges at least this large are binned with zpool_parallel_for, in chunks of BVH_BIN_CHUNK
+#define BVH_PARALLEL_THRESHOLD (64 * 1024)
+#define BVH_BIN_CHUNK (16 * 1024)
+// subtrees handed to the pool are never smaller than this
+#define BVH_MIN_SUBTREE 1024
+// past this depth ranges are split in half by index, which bounds the depth of degenerate
+// inputs (where every sah split peels off a single primitive) to BVH_SAH_DEPTH + 32
+#define BVH_SAH_DEPTH 32
+
+// ============================================================================
+// BUILD STATE
+// ============================================================================
+
+// primitive bounds with the primitive index in the padding, the build partitions these
+// directly so binning and partitioning stream through memory instead of chasing indices
+typedef struct build_ref {
+    f32 min[3];
+    u32 prim;
+    f32 max[3];
+    u32 pad;
+} build_ref;
+
+typedef struct build_bin {
+    bounds3 bounds;
+    bounds3 centroid_bounds;
+    u32 count;
+} build_bin;
+
+// a node still to be built over refs[begin, end)
+typedef struct build_task {
+    bounds3 bounds;
+    bounds3 centroid_bounds;
+    u32 node;
+    u32 begin;
+    u32 end;
+    u32 depth;
+} build_task;
+
+typedef struct build_split {
+    bool leaf;
+    // split by index in the middle of the range instead of by bin
+    bool by_index;
+    u32 axis;
+    // small ranges use fewer bins, sweeping 16 bins to place 5 primitives dominates the build
+    u32 bin_count;
+    // primitives whose centroid falls in bins [0, bin] go to the left child
+    u32 bin;
+    f32 centroid_min;
+    f32 bin_scale;
+    bounds3 left_bounds;
+    bounds3 left_centroid_bounds;
+    bounds3 right_bounds;
+    bounds3 right_centroid_bounds;
+} build_split;
+
+typedef struct build_context {
+    build_ref* refs;
+    // receives the primitive order of refs once the build is done
+    u32* prim_indices;
+    bvh_node* nodes;
+    volatile u32 node_count;
+    bvh_build_options options;
+    zpool* pool;
+    // per chunk bins for parallel binning, only used by the top phase on the calling thread
+    build_bin* chunk_bins;
+    // ranges at or below this size are deferred and built concurrently
+    u32 subtree_threshold;
+    // grows as ranges are deferred, skewed inputs can defer one small range per split
+    build_task* subtrees;
+    u32 subtree_count;
+    u32 subtree_capacity;
+} build_context;
+
+FORCE_INLINE bounds3 ref_bounds(const build_ref* ref) {
+    bounds3 b;
+    b.min = vec3_make(ref->min[0], ref->min[1], ref->min[2]);
+    b.max = vec3_make(ref->max[0], ref->max[1], ref->max[2]);
+    return b;
+}
+
+FORCE_INLINE point3 ref_centroid(const build_ref* ref) {
+    return vec3_make((ref->min[0] + ref->max[0]) * 0.5f,
+                     (ref->min[1] + ref->max[1]) * 0.5f,
+                     (ref->min[2] + ref->max[2]) * 0.5f);
+}
+
+static void bin_clear(build_bin* bins, u32 count) {
+    for (u32 i = 0; i < count; ++i) {
+        bins[i].bounds = bounds3_empty();
+        bins[i].centroid_bounds = bounds3_empty();
+        bins[i].count = 0;
+    }
+}
+
+FORCE_INLINE u32 bin_index(f32 centroid, f32 centroid_min, f32 bin_scale, u32 bin_count) {
+    u32 bin = (u32)((centroid - centroid_min) * bin_scale);
+    return bin < bin_count ? bin : bin_count - 1;
+}
+
+static void bin_range(const build_context* ctx, u32 begin, u32 end, const build_split* split, build_bin* bins) {
+    u32 bin_count = split->bin_count;
+    for (u32 i = begin; i < end; ++i) {
+        const build_ref* ref = &ctx->refs[i];
+        point3 c = ref_centroid(ref);
+        build_bin* bin = &bins[bin_index(c.e[split->axis], split->centroid_min, split->bin_scale, bin_count)];
+        bin->bounds = bounds3_union(bin->bounds, ref_bounds(ref));
+        bin->centroid_bounds = bounds3_union_point(bin->centroid_bounds, c);
+        bin->count += 1;
+    }
+}
+
+typedef struct bin_job {
+    const build_context* ctx;
+    const build_split* split;
+    u32 begin;
+    u32 end;
+} bin_job;
+
+static void bin_chunk_task(void* params, u64 index, u32 thread_index) {
+    bin_job* job = (bin_job*)params;
+    u32 begin = job->begin + (u32)index * BVH_BIN_CHUNK;
+    u32 end = begin + BVH_BIN_CHUNK < job->end ? begin + BVH_BIN_CHUNK : job->end;
+    build_bin* bins = job->ctx->chunk_bins + index * job->split->bin_count;
+    bin_clear(bins, job->split->bin_count);
+    bin_range(job->ctx, begin, end, job->split, bins);
+}
+
+static void bin_range_parallel(const build_context* ctx, u32 begin, u32 end, const build_split* split, build_bin* bins) {
+    u32 bin_count = split->bin_count;
+    bin_clear(bins, bin_count);
+    if (!ctx->pool || end - begin < BVH_PARALLEL_THRESHOLD) {
+        bin_range(ctx, begin, end, split, bins);
+        return;
+    }
+    u32 chunks = (end - begin + BVH_BIN_CHUNK - 1) / BVH_BIN_CHUNK;
+    bin_job job = {ctx, split, begin, end};
+    zpool_parallel_for(ctx->pool, chunks, 1, bin_chunk_task, &job);
+    for (u32 c = 0; c < chunks; ++c) {
+        const build_bin* chunk = ctx->chunk_bins + c * bin_count;
+        for (u32 i = 0; i < bin_count; ++i) {
+            bins[i].bounds = bounds3_union(bins[i].bounds, chunk[i].bounds);
+            bins[i].centroid_bounds = bounds3_union(bins[i].centroid_bounds, chunk[i].centroid_bounds);
+            bins[i].count += chunk[i].count;
+        }
+    }
+}
+
+// ============================================================================
+// SPLITTING
+// ============================================================================
+
+static void bounds_of_range(const build_context* ctx, u32 begin, u32 end, bounds3* bounds, bounds3* centroid_bounds) {
+    *bounds = bounds3_empty();
+    *centroid_bounds = bounds3_empty();
+    for (u32 i = begin; i < end; ++i) {
+        *bounds = bounds3_union(*bounds, ref_bounds(&ctx->refs[i]));
+        *centroid_bounds = bounds3_union_point(*centroid_bounds, ref_centroid(&ctx->refs[i]));
+    }
+}
+
+static void find_split(const build_context* ctx, const build_task* task, bool parallel, build_split* split) {
+    u32 count = task->end - task->begin;
+    const bvh_build_options* options = &ctx->options;
+    split->leaf = FALSE;
+    split->by_index = FALSE;
+    if (count == 1) {
+        split->leaf = TRUE;
+        return;
+    }
+
+    split->axis = bounds3_maximum_extent(&task->centroid_bounds);
+    f32 centroid_min = task->centroid_bounds.min.e[split->axis];
+    f32 extent = task->centroid_bounds.max.e[split->axis] - centroid_min;
+    if (extent <= 0 || task->depth >= BVH_SAH_DEPTH) {
+        // every centroid coincides (or the tree is too deep), bins cannot separate anything
+        if (count <= options->max_leaf_size) {
+            split->leaf = TRUE;
+            return;
+        }
+        u32 mid = task->begin + count / 2;
+        split->by_index = TRUE;
+        bounds_of_range(ctx, task->begin, mid, &split->left_bounds, &split->left_centroid_bounds);
+        bounds_of_range(ctx, mid, task->end, &split->right_bounds, &split->right_centroid_bounds);
+        return;
+    }
+
+    u32 bin_count = count < 4 ? 4 : count;
+    bin_count = bin_count < options->bin_count ? bin_count : options->bin_count;
+    split->bin_count = bin_count;
+    split->centroid_min = centroid_min;
+    // slightly under bin_count / extent so the largest centroid lands in the last bin
+    split->bin_scale = (f32)bin_count * (1 - 1e-5f) / extent;
+    build_bin bins[BVH_MAX_BINS];
+    if (parallel) {
+        bin_range_parallel(ctx, task->begin, task->end, split, bins);
+    } else {
+        bin_clear(bins, bin_count);
+        bin_range(ctx, task->begin, task->end, split, bins);
+    }
+
+    // sweep from the right collecting the area and count above every split plane
+    f32 right_area[BVH_MAX_BINS];
+    u32 right_count[BVH_MAX_BINS];
+    bounds3 accumulated = bounds3_empty();
+    u32 accumulated_count = 0;
+    for (u32 i = bin_count - 1; i > 0; --i) {
+        accumulated = bounds3_union(accumulated, bins[i].bounds);
+        accumulated_count += bins[i].count;
+        right_area[i - 1] = accumulated_count ? bounds3_surface_area(&accumulated) : 0;
+        right_count[i - 1] = accumulated_count;
+    }
+
+    // costs are kept multiplied by the node area, so flat nodes with zero area still compare
+    f32 node_area = bounds3_surface_area(&task->bounds);
+    f32 best_cost = MAX_F32;
+    u32 best_bin = 0;
+    accumulated = bounds3_empty();
+    accumulated_count = 0;
+    for (u32 i = 0; i + 1 < bin_count; ++i) {
+        accumulated = bounds3_union(accumulated, bins[i].bounds);
+        accumulated_count += bins[i].count;
+        if (accumulated_count == 0 || right_count[i] == 0) {
+            continue;
+        }
+        f32 cost = options->traversal_cost * node_area +
+                   options->intersect_cost *
+                       ((f32)accumulated_count * bounds3_surface_area(&accumulated) + (f32)right_count[i] * right_area[i]);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_bin = i;
+        }
+    }
+
+    f32 leaf_cost = options->intersect_cost * (f32)count * node_area;
+    if (count <= options->max_leaf_size && leaf_cost <= best_cost) {
+        split->leaf = TRUE;
+        return;
+    }
+
+    // extent > 0 puts the smallest and largest centroid in different bins, so a split exists
+    split->bin = best_bin;
+    split->left_bounds = bounds3_empty();
+    split->left_centroid_bounds = bounds3_empty();
+    split->right_bounds = bounds3_empty();
+    split->right_centroid_bounds = bounds3_empty();
+    for (u32 i = 0; i < bin_count; ++i) {
+        if (bins[i].count == 0) {
+            continue;
+        }
+        if (i <= best_bin) {
+            split->left_bounds = bounds3_union(split->left_bounds, bins[i].bounds);
+            split->left_centroid_bounds = bounds3_union(split->left_centroid_bounds, bins[i].centroid_bounds);
+        } else {
+            split->right_bounds = bounds3_union(split->right_bounds, bins[i].bounds);
+            split->right_centroid_bounds = bounds3_union(split->right_centroid_bounds, bins[i].centroid_bounds);
+        }
+    }
+}
+
+// returns the first index of the right child
+static u32 partition(const build_context* ctx, const build_task* task, const build_split* split) {
+    if (split->by_index) {
+        return task->begin + (task->end - task->begin) / 2;
+    }
+    build_ref* refs = ctx->refs;
+    u32 left = task->begin;
+    u32 right = task->end;
+    while (left < right) {
+        point3 c = ref_centroid(&refs[left]);
+        if (bin_index(c.e[split->axis], split->centroid_min, split->bin_scale, split->bin_count) <= split->bin) {
+            ++left;
+        } else {
+            --right;
+            build_ref temp = refs[left];
+            refs[left] = refs[right];
+            refs[right] = temp;
+        }
+    }
+    return left;
+}
+
+static void set_node_bounds(bvh_node* node, const bounds3* b) {
+    for (u32 i = 0; i < 3; ++i) {
+        node->min[i] = b->min.e[i];
+        node->max[i] = b->max.e[i];
+    }
+}
+
+static void emit_leaf(build_context* ctx, const build_task* task) {
+    bvh_node* node = &ctx->nodes[task->node];
+    set_node_bounds(node, &task->bounds);
+    node->offset = task->begin;
+    node->prim_count = (u16)(task->end - task->begin);
+    node->axis = 0;
+}
+
+// reserves the child pair and fills the two child tasks
+static void emit_interior(build_context* ctx, const build_task* task, const build_split* split, build_task* left, build_task* right) {
+    u32 mid = partition(ctx, task, split);
+    u32 first_child = zatomic_add_u32(&ctx->node_count, 2);
+    bvh_node* node = &ctx->nodes[task->node];
+    set_node_bounds(node, &task->bounds);
+    node->offset = first_child;
+    node->prim_count = 0;
+    node->axis = (u16)split->axis;
+
+    left->bounds = split->left_bounds;
+    left->centroid_bounds = split->left_centroid_bounds;
+    left->node = first_child;
+    left->begin = task->begin;
+    left->end = mid;
+    left->depth = task->depth + 1;
+
+    right->bounds = split->right_bounds;
+    right->centroid_bounds = split->right_centroid_bounds;
+    right->node = first_child + 1;
+    right->begin = mid;
+    right->end = task->end;
+    right->depth = task->depth + 1;
+}
+
+// ============================================================================
+// BUILD PHASES
+// ============================================================================
+
+static void build_subtree(build_context* ctx, const build_task* task) {
+    build_split split;
+    find_split(ctx, task, FALSE, &split);
+    if (split.leaf) {
+        emit_leaf(ctx, task);
+        return;
+    }
+    build_task left, right;
+    emit_interior(ctx, task, &split, &left, &right);
+    build_subtree(ctx, &left);
+    build_subtree(ctx, &right);
+}
+
+// splits the large ranges near the root on the calling thread with parallel binning,
+// deferring every range of at most subtree_threshold primitives
+static void build_top(build_context* ctx, const build_task* task) {
+    if (task->end - task->begin <= ctx->subtree_threshold) {
+        if (ctx->subtree_count == ctx->subtree_capacity) {
+            ctx->subtree_capacity *= 2;
+            ctx->subtrees = (build_task*)memory_reallocate(ctx->subtrees, sizeof(build_task) * (u64)ctx->subtree_capacity);
+        }
+        ctx->subtrees[ctx->subtree_count++] = *task;
+        return;
+    }
+    build_split split;
+    find_split(ctx, task, TRUE, &split);
+    if (split.leaf) {
+        emit_leaf(ctx, task);
+        return;
+    }
+    build_task left, right;
+    emit_interior(ctx, task, &split, &left, &right);
+    build_top(ctx, &left);
+    build_top(ctx, &right);
+}
+
+static void subtree_task(void* params, u64 index, u32 thread_index) {
+    build_context* ctx = (build_context*)params;
+    build_subtree(ctx, &ctx->subtrees[index]);
+}
+
+// largest first so the long subtrees start early
+static int compare_task_size(const void* a, const void* b) {
+    u32 size_a = ((const build_task*)a)->end - ((const build_task*)a)->begin;
+    u32 size_b = ((const build_task*)b)->end - ((const build_task*)b)->begin;
+    return size_a < size_b ? 1 : (size_a > size_b ? -1 : 0);
+}
+
+typedef struct root_job {
+    const build_context* ctx;
+    const bounds3* prim_bounds;
+    u32 count;
+    build_bin* partial;
+} root_job;
+
+// fills a chunk of refs and returns its bounds in partial[index]
+static void root_task(void* params, u64 index, u32 thread_index) {
+    root_job* job = (root_job*)params;
+    u32 begin = (u32)index * BVH_BIN_CHUNK;
+    u32 end = begin + BVH_BIN_CHUNK < job->count ? begin + BVH_BIN_CHUNK : job->count;
+    for (u32 i = begin; i < end; ++i) {
+        build_ref* ref = &job->ctx->refs[i];
+        for (u32 k = 0; k < 3; ++k) {
+            ref->min[k] = job->prim_bounds[i].min.e[k];
+            ref->max[k] = job->prim_bounds[i].max.e[k];
+        }
+        ref->prim = i;
+        ref->pad = 0;
+    }
+    bounds_of_range(job->ctx, begin, end, &job->partial[index].bounds, &job->partial[index].centroid_bounds);
+}
+
+static void write_indices_task(void* params, u64 index, u32 thread_index) {
+    build_context* ctx = (build_context*)params;
+    ctx->prim_indices[index] = ctx->refs[index].prim;
+}
+
+// ============================================================================
+// PUBLIC
+// ============================================================================
+
+void bvh_build_options_default(bvh_build_options* options) {
+    options->max_leaf_size = 4;
+    options->bin_count = 16;
+    options->traversal_cost = 0.5f;
+    options->intersect_cost = 1.0f;
+}
+
+void bvh_build(bvh* out, const bounds3* prim_bounds, u32 prim_count, const bvh_build_options* options, zpool* pool) {
+    clock clk;
+    clock_set(&clk);
+    bvh_build_options defaults;
+    if (!options) {
+        bvh_build_options_default(&defaults);
+        options = &defaults;
+    }
+    ASSERT(options->bin_count >= 2 && options->bin_count <= BVH_MAX_BINS);
+    ASSERT(options->max_leaf_size >= 1 && options->max_leaf_size <= 0xffff);
+
+    out->prim_count = prim_count;
+    out->node_count = 0;
+    out->nodes = 0;
+    out->prim_indices = 0;
+    out->stats = (bvh_build_stats){0};
+    if (prim_count == 0) {
+        return;
+    }
+
+    out->nodes = (bvh_node*)memory_allocate_aligned(sizeof(bvh_node) * (2 * prim_count - 1), 64);
+    out->prim_indices = (u32*)memory_allocate(sizeof(u32) * prim_count);
+
+    arena scratch;
+    arena_create(&scratch, 64 * 1024);
+    u32 chunks = (prim_count + BVH_BIN_CHUNK - 1) / BVH_BIN_CHUNK;
+    u32 thread_count = pool ? zpool_thread_count(pool) : 1;
+
+    build_context ctx;
+    ctx.refs = ARENA_ALLOCATE_ARRAY(&scratch, build_ref, prim_count);
+    ctx.prim_indices = out->prim_indices;
+    ctx.nodes = out->nodes;
+    ctx.node_count = 1;
+    ctx.options = *options;
+    ctx.pool = pool;
+    ctx.chunk_bins = ARENA_ALLOCATE_ARRAY(&scratch, build_bin, (u64)chunks * options->bin_count);
+    ctx.subtree_threshold = prim_count;
+    if (thread_count > 1) {
+        u32 per_thread = prim_count / (thread_count * 8);
+        ctx.subtree_threshold = per_thread > BVH_MIN_SUBTREE ? per_thread : BVH_MIN_SUBTREE;
+    }
+    // balanced splits defer about two ranges per threshold worth of primitives, build_top
+    // grows the array past that
+    ctx.subtree_capacity = 2 * (prim_count / ctx.subtree_threshold) + 2;
+    ctx.subtrees = (build_task*)memory_allocate(sizeof(build_task) * ctx.subtree_capacity);
+    ctx.subtree_count = 0;
+
+    build_task root;
+    root.node = 0;
+    root.begin = 0;
+    root.end = prim_count;
+    root.depth = 0;
+    build_bin* partial = ARENA_ALLOCATE_ARRAY(&scratch, build_bin, chunks);
+    root_job job = {&ctx, prim_bounds, prim_count, partial};
+    zpool_parallel_for(pool, chunks, 1, root_task, &job);
+    root.bounds = bounds3_empty();
+    root.centroid_bounds = bounds3_empty();
+    for (u32 c = 0; c < chunks; ++c) {
+        root.bounds = bounds3_union(root.bounds, partial[c].bounds);
+        root.centroid_bounds = bounds3_union(root.centroid_bounds, partial[c].centroid_bounds);
+    }
+
+    build_top(&ctx, &root);
+    qsort(ctx.subtrees, ctx.subtree_count, sizeof(build_task), compare_task_size);
+    zpool_parallel_for(pool, ctx.subtree_count, 1, subtree_task, &ctx);
+    zpool_parallel_for(pool, prim_count, 0, write_indices_task, &ctx);
+    memory_free(ctx.subtrees);
+
+    out->node_count = ctx.node_count;
+    clock_update(&clk);
+    out->stats.build_seconds = clk.elapsed;
+    arena_destroy(&scratch);
+    bvh_compute_stats(out, options->traversal_cost, options->intersect_cost);
+}
+
+typedef struct triangle_bounds_job {
+    const point3* positions;
+    const u32* indices;
+    bounds3* bounds;
+} triangle_bounds_job;
+
+static void triangle_bounds_task(void* params, u64 index, u32 thread_index) {
+    triangle_bounds_job* job = (triangle_bounds_job*)params;
+    const u32* tri = job->indices + index * 3;
+    bounds3 b = bounds3_make(job->positions[tri[0]], job->positions[tri[1]]);
+    job->bounds[index] = bounds3_union_point(b, job->positions[tri[2]]);
+}
+
+void bvh_build_triangles(bvh* out,
+                         const point3* positions,
+                         const u32* indices,
+                         u32 triangle_count,
+                         const bvh_build_options* options,
+                         zpool* pool) {
+    clock clk;
+    clock_set(&clk);
+    arena scratch;
+    arena_create(&scratch, sizeof(bounds3) * (triangle_count ? triangle_count : 1));
+    bounds3* bounds = ARENA_ALLOCATE_ARRAY(&scratch, bounds3, triangle_count ? triangle_count : 1);
+    triangle_bounds_job job = {positions, indices, bounds};
+    zpool_parallel_for(pool, triangle_count, 4096, triangle_bounds_task, &job);
+    clock_update(&clk);
+
+    bvh_build(out, bounds, triangle_count, options, pool);
+    out->stats.build_seconds += clk.elapsed;
+    arena_destroy(&scratch);
+}
+
+typedef struct mesh_bounds_job {
+    const mesh* m;
+    bounds3* bounds;
+} mesh_bounds_job;
+
+static void mesh_bounds_task(void* params, u64 index, u32 thread_index) {
+    mesh_bounds_job* job = (mesh_bounds_job*)params;
+    point3 p0, p1, p2;
+    mesh_triangle(job->m, (u32)index, &p0, &p1, &p2);
+    job->bounds[index] = bounds3_union_point(bounds3_make(p0, p1), p2);
+}
+
+void bvh_build_mesh(bvh* out, const mesh* m, const bvh_build_options* options, zpool* pool) {
+    clock clk;
+    clock_set(&clk);
+    u32 count = m->triangle_count;
+    bounds3* bounds = (bounds3*)memory_allocate(sizeof(bounds3) * (count ? count : 1));
+    mesh_bounds_job job = {m, bounds};
+    zpool_parallel_for(pool, count, 4096, mesh_bounds_task, &job);
+    clock_update(&clk);
+
+    bvh_build(out, bounds, count, options, pool);
+    out->stats.build_seconds += clk.elapsed;
+    memory_free(bounds);
+}
+
+void bvh_destroy(bvh* b) {
+    if (b->nodes) {
+        memory_free_aligned(b->nodes);
+        memory_free(b->prim_indices);
+    }
+    b->nodes = 0;
+    b->prim_indices = 0;
+    b->node_count = 0;
+}
+
+// children first, returns the new bounds of node index
+static bounds3 refit_node(bvh* b, u32 index, const bounds3* prim_bounds) {
+    bvh_node* node = &b->nodes[index];
+    bounds3 nb = bounds3_empty();
+    if (node->prim_count) {
+        for (u32 i = 0; i < node->prim_count; ++i) {
+            nb = bounds3_union(nb, prim_bounds[b->prim_indices[node->offset + i]]);
+        }
+    } else {
+        nb = bounds3_union(refit_node(b, node->offset, prim_bounds), refit_node(b, node->offset + 1, prim_bounds));
+    }
+    set_node_bounds(node, &nb);
+    return nb;
+}
+
+void bvh_refit(bvh* b, const bounds3* prim_bounds) {
+    if (b->node_count) {
+        refit_node(b, 0, prim_bounds);
+    }
+}
+
+f32 bvh_compute_sah_cost(const bvh* b, f32 traversal_cost, f32 intersect_cost) {
+    if (b->node_count == 0) {
+        return 0;
+    }
+    bounds3 root = bvh_node_bounds(&b->nodes[0]);
+    f32 root_area = bounds3_surface_area(&root);
+    if (root_area <= 0) {
+        return intersect_cost * (f32)b->prim_count;
+    }
+    f64 cost = 0;
+    for (u32 i = 0; i < b->node_count; ++i) {
+        bounds3 nb = bvh_node_bounds(&b->nodes[i]);
+        f64 area = bounds3_surface_area(&nb);
+        cost += b->nodes[i].prim_count ? area * intersect_cost * b->nodes[i].prim_count : area * traversal_cost;
+    }
+    return (f32)(cost / root_area);
+}
+
+void bvh_compute_stats(bvh* b, f32 traversal_cost, f32 intersect_cost) {
+    bvh_build_stats* stats = &b->stats;
+    f64 build_seconds = stats->build_seconds;
+    *stats = (bvh_build_stats){0};
+    stats->build_seconds = build_seconds;
+    if (b->node_count == 0) {
+        return;
+    }
+    stats->node_count = b->node_count;
+    stats->sah_cost = bvh_compute_sah_cost(b, traversal_cost, intersect_cost);
+    // depth first walk, the stack never holds more than one entry per level
+    u32* stack = (u32*)memory_allocate(sizeof(u32) * 2 * (u64)b->node_count);
+    u32 top = 0;
+    stack[top++] = 0;
+    stack[top++] = 1;
+    while (top) {
+        u32 depth = stack[--top];
+        const bvh_node* node = &b->nodes[stack[--top]];
+        if (depth > stats->max_depth) {
+            stats->max_depth = depth;
+        }
+        if (node->prim_count) {
+            stats->leaf_count += 1;
+            if (node->prim_count > stats->max_leaf_prims) {
+                stats->max_leaf_prims = node->prim_count;
+            }
+        } else {
+            stack[top++] = node->offset;
+            stack[top++] = depth + 1;
+            stack[top++] = node->offset + 1;
+            stack[top++] = depth + 1;
+        }
+    }
+    memory_free(stack);
+}
+
+// ============================================================================
+// TRAVERSAL
+// ============================================================================
+
+// closest hit of one primitive, updates hit and returns TRUE when it is closer than t_max
+typedef bool (*bvh_prim_test)(const void* geometry, u32 prim, const ray* r, f32 t_max, triangle_hit* hit);
+
+// always inlined into its callers with a constant prim_test, which the compiler inlines in turn
+FORCE_INLINE bool traverse(const bvh* b, const void* geometry, bvh_prim_test prim_test, const ray* r, f32 t_max, bvh_hit* hit) {
+    if (b->node_count == 0) {
+        return FALSE;
+    }
+    vec3 inv_dir = vec3_div(vec3_splat(1), r->d);
+    bool dir_negative[3] = {r->d.x < 0, r->d.y < 0, r->d.z < 0};
+    u32 stack[BVH_STACK_SIZE];
+    u32 top = 0;
+    u32 node_index = 0;
+    bool found = FALSE;
+    while (TRUE) {
+        const bvh_node* node = &b->nodes[node_index];
+        bounds3 nb = bvh_node_bounds(node);
+        if (bounds3_intersect(&nb, r, inv_dir, t_max, 0, 0)) {
+            if (node->prim_count == 0) {
+                ASSERT(top < BVH_STACK_SIZE);
+                // the left child holds the smaller centroids along axis
+                u32 near = dir_negative[node->axis] ? node->offset + 1 : node->offset;
+                stack[top++] = near == node->offset ? node->offset + 1 : node->offset;
+                node_index = near;
+                continue;
+            }
+            for (u32 i = 0; i < node->prim_count; ++i) {
+                u32 prim = b->prim_indices[node->offset + i];
+                if (prim_test(geometry, prim, r, t_max, &hit->triangle)) {
+                    t_max = hit->triangle.t;
+                    hit->prim_id = prim;
+                    found = TRUE;
+                }
+            }
+        }
+        if (top == 0) {
+            break;
+        }
+        node_index = stack[--top];
+    }
+    return found;
+}
+
+typedef struct indexed_triangles {
+    const point3* positions;
+    const u32* indices;
+} indexed_triangles;
+
+FORCE_INLINE bool indexed_triangle_test(const void* geometry, u32 prim, const ray* r, f32 t_max, triangle_hit* hit) {
+    const indexed_triangles* triangles = (const indexed_triangles*)geometry;
+    const u32* tri = triangles->indices + prim * 3;
+    const point3* p = triangles->positions;
+    return triangle_intersect(r, t_max, p[tri[0]], p[tri[1]], p[tri[2]], hit);
+}
+
+FORCE_INLINE bool mesh_triangle_test(const void* geometry, u32 prim, const ray* r, f32 t_max, triangle_hit* hit) {
+    point3 p0, p1, p2;
+    mesh_triangle((const mesh*)geometry, prim, &p0, &p1, &p2);
+    return triangle_intersect(r, t_max, p0, p1, p2, hit);
+}
+
+bool bvh_intersect_triangles(const bvh* b,
+                             const point3* positions,
+                             const u32* indices,
+                             const ray* r,
+                             f32 t_max,
+                             bvh_hit* hit) {
+    indexed_triangles triangles = {positions, indices};
+    return traverse(b, &triangles, indexed_triangle_test, r, t_max, hit);
+}
+
+bool bvh_intersect_mesh(const bvh* b, const mesh* m, const ray* r, f32 t_max, bvh_hit* hit) {
+    return traverse(b, m, mesh_triangle_test, r, t_max, hit);
+}
+
+// ============================================================================
+// OCCLUSION
+// ============================================================================
+
+// TRUE when the primitive blocks r in (0, t_max)
+typedef bool (*bvh_prim_occluded)(const void* geometry, u32 prim, const ray* r, f32 t_max);
+
+// any hit traversal: nothing is recorded, t_max never shrinks, so the order children are
+// visited in does not matter and the stack only ever holds the right child
+FORCE_INLINE bool traverse_occluded(const bvh* b, const void* geometry, bvh_prim_occluded prim_test, const ray* r, f32 t_max) {
+    if (b->node_count == 0) {
+        return FALSE;
+    }
+    vec3 inv_dir = vec3_div(vec3_splat(1), r->d);
+    u32 stack[BVH_STACK_SIZE];
+    u32 top = 0;
+    u32 node_index = 0;
+    while (TRUE) {
+        const bvh_node* node = &b->nodes[node_index];
+        bounds3 nb = bvh_node_bounds(node);
+        if (bounds3_intersect(&nb, r, inv_dir, t_max, 0, 0)) {
+            if (node->prim_count == 0) {
+                ASSERT(top < BVH_STACK_SIZE);
+                stack[top++] = node->offset + 1;
+                node_index = node->offset;
+                continue;
+            }
+            for (u32 i = 0; i < node->prim_count; ++i) {
+                if (prim_test(geometry, b->prim_indices[node->offset + i], r, t_max)) {
+                    return TRUE;
+                }
+            }
+        }
+        if (top == 0) {
+            return FALSE;
+        }
+        node_index = stack[--top];
+    }
+}
+
+FORCE_INLINE bool indexed_triangle_occluded(const void* geometry, u32 prim, const ray* r, f32 t_max) {
+    const indexed_triangles* triangles = (const indexed_triangles*)geometry;
+    const u32* tri = triangles->indices + prim * 3;
+    const point3* p = triangles->positions;
+    return triangle_occluded(r, t_max, p[tri[0]], p[tri[1]], p[tri[2]]);
+}
+
+FORCE_INLINE bool mesh_triangle_occluded(const void* geometry, u32 prim, const ray* r, f32 t_max) {
+    point3 p0, p1, p2;
+    mesh_triangle((const mesh*)geometry, prim, &p0, &p1, &p2);
+    return triangle_occluded(r, t_max, p0, p1, p2);
+}
+
+bool bvh_occluded_triangles(const bvh* b, const point3* positions, const u32* indices, const ray* r, f32 t_max) {
+    indexed_triangles triangles = {positions, indices};
+    return traverse_occluded(b, &triangles, indexed_triangle_occluded, r, t_max);
+}
+
+bool bvh_occluded_mesh(const bvh* b, const mesh* m, const ray* r, f32 t_max) {
+    return traverse_occluded(b, m, mesh_triangle_occluded, r, t_max);
+}
+
+// one packet walks the tree together: a node is entered by the lanes still unoccluded whose
+// slabs it crosses, tested SIMD_LANES at a time, and leaves run the watertight test per lane,
+// so every lane gets exactly the answer of bvh_occluded_triangles
+static u32 packet_occluded(const bvh* b, const indexed_triangles* triangles, const ray* rays, const f32* t_max, ray_packet* packet, u32 lanes) {
+    u32 all = (1u << lanes) - 1;
+    u32 blocked = 0;
+    u32 stack[BVH_STACK_SIZE];
+    u32 top = 0;
+    u32 node_index = 0;
+    while (TRUE) {
+        const bvh_node* node = &b->nodes[node_index];
+        bounds3 nb = bvh_node_bounds(node);
+        u32 active = ray_packet_intersect_bounds(packet, &nb, all & ~blocked);
+        if (active) {
+            if (node->prim_count == 0) {
+                ASSERT(top < BVH_STACK_SIZE);
+                stack[top++] = node->offset + 1;
+                node_index = node->offset;
+                continue;
+            }
+            for (u32 i = 0; i < node->prim_count && active; ++i) {
+                u32 prim = b->prim_indices[node->offset + i];
+                for (u32 lanes_left = active; lanes_left; lanes_left &= lanes_left - 1) {
+                    u32 lane = (u32)__builtin_ctz(lanes_left);
+                    if (indexed_triangle_occluded(triangles, prim, &rays[lane], t_max[lane])) {
+                        active &= ~(1u << lane);
+                        blocked |= 1u << lane;
+                    }
+                }
+            }
+            if (blocked == all) {
+                return blocked;
+            }
+        }
+        if (top == 0) {
+            return blocked;
+        }
+        node_index = stack[--top];
+    }
+}
+
+void bvh_occluded_triangles_batch(const bvh* b,
+                                  const point3* positions,
+                                  const u32* indices,
+                                  const ray* rays,
+                                  const f32* t_max,
+                                  u32 count,
+                                  bool* occluded) {
+    if (b->node_count == 0 || count == 0) {
+        for (u32 i = 0; i < count; ++i) {
+            occluded[i] = FALSE;
+        }
+        return;
+    }
+    indexed_triangles triangles = {positions, indices};
+    ray_packet packet;
+    ray_packet_create(&packet, BVH_OCCLUSION_PACKET);
+    for (u32 first = 0; first < count; first += BVH_OCCLUSION_PACKET) {
+        u32 lanes = count - first < BVH_OCCLUSION_PACKET ? count - first : BVH_OCCLUSION_PACKET;
+        for (u32 lane = 0; lane < lanes; ++lane) {
+            ray_packet_set(&packet, lane, &rays[first + lane], t_max[first + lane]);
+        }
+        u32 blocked = packet_occluded(b, &triangles, rays + first, t_max + first, &packet, lanes);
+        for (u32 lane = 0; lane < lanes; ++lane) {
+            occluded[first + lane] = (blocked >> lane) & 1;
+        }
+    }
+    ray_packet_destroy(&packet);
+}
@@ -0,0 +1,142 @@
+#ifndef BVH__H
+#define BVH__H
+
+#include "defines.h"
+#include "vec3.h"
+#include "bounds3.h"
+#include "ray.h"
+#include "triangle.h"
+#include "mesh.h"
+#include "zpool.h"
+
+/***
+ *    ██████  ██    ██ ██   ██
+ *    ██   ██ ██    ██ ██   ██
+ *    ██████  ██    ██ ███████
+ *    ██   ██  ██  ██  ██   ██
+ *    ██████    ████   ██   ██
+ *
+ *
+ */
+
+// 32 byte node, two per cache line. the root is node 0 and the two children of an interior
+// node are always stored next to each other, at offset and offset + 1
+typedef struct bvh_node {
+    f32 min[3];
+    // interior: index of the first child. leaf: index of the first entry in prim_indices
+    u32 offset;
+    f32 max[3];
+    // 0 for interior nodes
+    u16 prim_count;
+    // split axis of interior nodes, traversal visits the child on the near side first
+    u16 axis;
+} bvh_node;
+
+typedef struct bvh_build_options {
+    // ranges at or below this size may become leaves when the sah says so
+    u32 max_leaf_size;
+    // centroid bins per split, at most BVH_MAX_BINS
+    u32 bin_count;
+    // sah cost of visiting an interior node relative to intersecting one primitive
+    f32 traversal_cost;
+    f32 intersect_cost;
+} bvh_build_options;
+
+#define BVH_MAX_BINS 32
+// traversal stack depth. morton builds split on code bits and can go deeper than the sah
+// builder, trees deeper than this cannot be traversed
+#define BVH_STACK_SIZE 128
+
+typedef struct bvh_build_stats {
+    f64 build_seconds;
+    // expected cost of a random ray against the tree (sah with the build costs)
+    f32 sah_cost;
+    u32 node_count;
+    u32 leaf_count;
+    u32 max_depth;
+    u32 max_leaf_prims;
+} bvh_build_stats;
+
+typedef struct bvh {
+    bvh_node* nodes;
+    u32 node_count;
+    // leaves reference ranges of this array, which maps back to the input primitives
+    u32* prim_indices;
+    u32 prim_count;
+    bvh_build_stats stats;
+} bvh;
+
+typedef struct bvh_hit {
+    triangle_hit triangle;
+    u32 prim_id;
+} bvh_hit;
+
+// max_leaf_size 4, 16 bins, traversal cost 0.5 and intersect cost 1 (as in pbrt-v4)
+void bvh_build_options_default(bvh_build_options* options);
+
+// binned sah build over arbitrary primitive bounds. options may be null for the defaults and
+// pool may be null to build on the calling thread. large ranges are binned in parallel and
+// once there are enough independent subtrees they are built concurrently
+void bvh_build(bvh* out, const bounds3* prim_bounds, u32 prim_count, const bvh_build_options* options, zpool* pool);
+
+// builds over indexed triangles, primitive i is the triangle indices[3i], [3i+1], [3i+2]
+void bvh_build_triangles(bvh* out,
+                         const point3* positions,
+                         const u32* indices,
+                         u32 triangle_count,
+                         const bvh_build_options* options,
+                         zpool* pool);
+
+// builds over the triangles of m, primitive i is triangle i
+void bvh_build_mesh(bvh* out, const mesh* m, const bvh_build_options* options, zpool* pool);
+
+void bvh_destroy(bvh* b);
+
+f32 bvh_compute_sah_cost(const bvh* b, f32 traversal_cost, f32 intersect_cost);
+
+// updates every node bound in place from new primitive bounds, the topology is kept
+void bvh_refit(bvh* b, const bounds3* prim_bounds);
+
+// recomputes everything in b->stats except build_seconds, for builders and passes that
+// produce or reshape trees outside bvh_build
+void bvh_compute_stats(bvh* b, f32 traversal_cost, f32 intersect_cost);
+
+FORCE_INLINE bounds3 bvh_node_bounds(const bvh_node* node) {
+    bounds3 b;
+    b.min = vec3_make(node->min[0], node->min[1], node->min[2]);
+    b.max = vec3_make(node->max[0], node->max[1], node->max[2]);
+    return b;
+}
+
+// closest hit of r in (0, t_max) against a tree built by bvh_build_triangles
+bool bvh_intersect_triangles(const bvh* b,
+                             const point3* positions,
+                             const u32* indices,
+                             const ray* r,
+                             f32 t_max,
+                             bvh_hit* hit);
+
+// closest hit of r in (0, t_max) against a tree built by bvh_build_mesh
+bool bvh_intersect_mesh(const bvh* b, const mesh* m, const ray* r, f32 t_max, bvh_hit* hit);
+
+// rays bvh_occluded_triangles_batch traces together
+#define BVH_OCCLUSION_PACKET 8
+
+// whether anything lies along r in (0, t_max), for shadow rays. stops at the first
+// primitive found instead of searching for the closest, and keeps no hit record
+bool bvh_occluded_triangles(const bvh* b, const point3* positions, const u32* indices, const ray* r, f32 t_max);
+
+bool bvh_occluded_mesh(const bvh* b, const mesh* m, const ray* r, f32 t_max);
+
+// occluded[i] = bvh_occluded_triangles(b, positions, indices, &rays[i], t_max[i]), with
+// BVH_OCCLUSION_PACKET consecutive rays traversing the tree as one packet. pays off when
+// neighboring rays are coherent, like shadow rays towards one light sorted by origin
+void bvh_occluded_triangles_batch(const bvh* b,
+                                  const point3* positions,
+                                  const u32* indices,
+                                  const ray* rays,
+                                  const f32* t_max,
+                                  u32 count,
+                                  bool* occluded);
+
+#endif
@@ -0,0 +1,274 @@
+#include "bvh8.h"
+#include "logger.h"
+#include "memory.h"
+
+// the quantized range of a child is widened by one cell on each side, so the node grid
+// spans at most 253 cells and 0..255 always fit
+#define BVH8_GRID_CELLS 253
+// every pop pushes at most 8 entries, which bounds the stack by 7 entries per level
+#define BVH8_STACK_SIZE 512
+
+// 2^e built from the exponent bits, e in [-126, 127]
+FORCE_INLINE f32 power_of_two(i32 e) {
+    u32 bits = (u32)(e + 127) << 23;
+    f32 result;
+    __builtin_memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// ============================================================================
+// COLLAPSE
+// ============================================================================
+
+typedef struct collapse_context {
+    const bvh* binary;
+    bvh8* out;
+    u64 child_total;
+} collapse_context;
+
+static void quantize_node(bvh8_node* node, const bounds3* node_bounds, const bounds3* child_bounds, u32 count) {
+    for (u32 k = 0; k < 3; ++k) {
+        f32 origin = node_bounds->min.e[k];
+        f32 extent = node_bounds->max.e[k] - origin;
+        i32 e = -126;
+        if (extent > 0) {
+            e = (i32)ceilf(log2f(extent / BVH8_GRID_CELLS));
+            e = e < -126 ? -126 : e;
+            while (power_of_two(e) * BVH8_GRID_CELLS < extent) {
+                ++e;
+            }
+        }
+        ASSERT(e <= 127);
+        f64 scale = power_of_two(e);
+        node->origin[k] = origin;
+        node->exponent[k] = (i8)e;
+        for (u32 c = 0; c < BVH8_WIDTH; ++c) {
+            if (c >= count) {
+                node->qmin[k][c] = 255;
+                node->qmax[k][c] = 0;
+                continue;
+            }
+            i64 lo = (i64)floor(((f64)child_bounds[c].min.e[k] - origin) / scale) - 1;
+            i64 hi = (i64)ceil(((f64)child_bounds[c].max.e[k] - origin) / scale) + 1;
+            node->qmin[k][c] = (u8)(lo < 0 ? 0 : (lo > 255 ? 255 : lo));
+            node->qmax[k][c] = (u8)(hi < 0 ? 0 : (hi > 255 ? 255 : hi));
+        }
+    }
+}
+
+// returns the index of the wide node built for the binary subtree at binary_index
+static u32 collapse(collapse_context* ctx, u32 binary_index) {
+    const bvh_node* nodes = ctx->binary->nodes;
+    u32 node_index = ctx->out->node_count++;
+
+    // start from the two children and keep opening the interior child with the largest area
+    u32 children[BVH8_WIDTH];
+    u32 count = 0;
+    if (nodes[binary_index].prim_count) {
+        children[count++] = binary_index;
+    } else {
+        children[count++] = nodes[binary_index].offset;
+        children[count++] = nodes[binary_index].offset + 1;
+    }
+    while (count < BVH8_WIDTH) {
+        i32 best = -1;
+        f32 best_area = -1;
+        for (u32 c = 0; c < count; ++c) {
+            const bvh_node* child = &nodes[children[c]];
+            if (child->prim_count) {
+                continue;
+            }
+            bounds3 b = bvh_node_bounds(child);
+            f32 area = bounds3_surface_area(&b);
+            if (area > best_area) {
+                best_area = area;
+                best = (i32)c;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        u32 opened = children[best];
+        children[best] = nodes[opened].offset;
+        children[count++] = nodes[opened].offset + 1;
+    }
+
+    bounds3 child_bounds[BVH8_WIDTH];
+    for (u32 c = 0; c < count; ++c) {
+        child_bounds[c] = bvh_node_bounds(&nodes[children[c]]);
+    }
+    bounds3 node_bounds = bvh_node_bounds(&nodes[binary_index]);
+    quantize_node(&ctx->out->nodes[node_index], &node_bounds, child_bounds, count);
+    ctx->child_total += count;
+
+    for (u32 c = 0; c < BVH8_WIDTH; ++c) {
+        u32 child_node = 0;
+        u8 prim_count = 0;
+        if (c < count) {
+            const bvh_node* child = &nodes[children[c]];
+            if (child->prim_count) {
+                ASSERT(child->prim_count <= 255);
+                child_node = child->offset;
+                prim_count = (u8)child->prim_count;
+            } else {
+                child_node = collapse(ctx, children[c]);
+            }
+        }
+        // looked up after the recursion, which only appends nodes
+        bvh8_node* node = &ctx->out->nodes[node_index];
+        node->child[c] = child_node;
+        node->prim_count[c] = prim_count;
+    }
+    ctx->out->nodes[node_index].child_count = (u8)count;
+    return node_index;
+}
+
+void bvh8_build(bvh8* out, const bvh* binary) {
+    STATIC_ASSERT(sizeof(bvh8_node) == 128);
+    out->nodes = 0;
+    out->node_count = 0;
+    out->prim_indices = 0;
+    out->prim_count = binary->prim_count;
+    out->average_fill = 0;
+    if (binary->node_count == 0) {
+        return;
+    }
+    // every wide node absorbs at least one binary interior node, a lone leaf root needs one
+    u32 interior = (binary->node_count - 1) / 2;
+    u32 capacity = interior ? interior : 1;
+    out->nodes = (bvh8_node*)memory_allocate_aligned(sizeof(bvh8_node) * capacity, 64);
+    out->prim_indices = (u32*)memory_allocate(sizeof(u32) * binary->prim_count);
+    for (u32 i = 0; i < binary->prim_count; ++i) {
+        out->prim_indices[i] = binary->prim_indices[i];
+    }
+    collapse_context ctx = {binary, out, 0};
+    collapse(&ctx, 0);
+    ASSERT(out->node_count <= capacity);
+    out->average_fill = (f32)ctx.child_total / (f32)out->node_count;
+}
+
+void bvh8_destroy(bvh8* b) {
+    if (b->nodes) {
+        memory_free_aligned(b->nodes);
+        memory_free(b->prim_indices);
+    }
+    b->nodes = 0;
+    b->prim_indices = 0;
+    b->node_count = 0;
+}
+
+bounds3 bvh8_child_bounds(const bvh8_node* node, u32 k) {
+    bounds3 b;
+    for (u32 axis = 0; axis < 3; ++axis) {
+        f32 scale = power_of_two(node->exponent[axis]);
+        b.min.e[axis] = node->origin[axis] + (f32)node->qmin[axis][k] * scale;
+        b.max.e[axis] = node->origin[axis] + (f32)node->qmax[axis][k] * scale;
+    }
+    b.min.w = 0;
+    b.max.w = 0;
+    return b;
+}
+
+// ============================================================================
+// TRAVERSAL
+// ============================================================================
+
+typedef struct bvh8_stack_entry {
+    u32 index;
+    // 0 for nodes, the primitive count for leaves
+    u32 prim_count;
+    // entry distance, entries behind the closest hit found since the push are skipped
+    f32 t;
+} bvh8_stack_entry;
+
+bool bvh8_intersect_triangles(const bvh8* b,
+                              const point3* positions,
+                              const u32* indices,
+                              const ray* r,
+                              f32 t_max,
+                              bvh_hit* hit) {
+    if (b->node_count == 0) {
+        return FALSE;
+    }
+    // the grid test computes q * (scale / d) + (origin - o) / d, an infinite reciprocal would
+    // turn that into inf - inf for axis parallel rays, so tiny components are clamped
+    f32 inv_dir[3];
+    bool negative[3];
+    for (u32 k = 0; k < 3; ++k) {
+        f32 d = r->d.e[k];
+        f32 magnitude = absf(d) > 1e-20f ? absf(d) : 1e-20f;
+        negative[k] = d < 0;
+        inv_dir[k] = (negative[k] ? -1.0f : 1.0f) / magnitude;
+    }
+    simdf zero = simdf_set1(0);
+    simdf widen = simdf_set1(1 + 2 * gamma_bound(3));
+
+    bvh8_stack_entry stack[BVH8_STACK_SIZE];
+    u32 top = 0;
+    stack[top++] = (bvh8_stack_entry){0, 0, 0};
+    bool found = FALSE;
+    while (top) {
+        bvh8_stack_entry entry = stack[--top];
+        if (entry.t > t_max) {
+            continue;
+        }
+        if (entry.prim_count) {
+            for (u32 i = 0; i < entry.prim_count; ++i) {
+                u32 prim = b->prim_indices[entry.index + i];
+                const u32* tri = indices + prim * 3;
+                if (triangle_intersect(r, t_max, positions[tri[0]], positions[tri[1]], positions[tri[2]], &hit->triangle)) {
+                    t_max = hit->triangle.t;
+                    hit->prim_id = prim;
+                    found = TRUE;
+                }
+            }
+            continue;
+        }
+
+        const bvh8_node* node = &b->nodes[entry.index];
+        simdf a[3], c[3];
+        const u8* q_near[3];
+        const u8* q_far[3];
+        for (u32 k = 0; k < 3; ++k) {
+            a[k] = simdf_set1(power_of_two(node->exponent[k]) * inv_dir[k]);
+            c[k] = simdf_set1((node->origin[k] - r->o.e[k]) * inv_dir[k]);
+            // for a negative direction the max plane is entered first
+            q_near[k] = negative[k] ? node->qmax[k] : node->qmin[k];
+            q_far[k] = negative[k] ? node->qmin[k] : node->qmax[k];
+        }
+        simdf limit = simdf_set1(t_max);
+        f32 t_enter[BVH8_WIDTH] ALIGN(SIMD_ALIGNMENT);
+        u32 hits = 0;
+        for (u32 base = 0; base < BVH8_WIDTH; base += SIMD_LANES) {
+            simdf enter = zero;
+            simdf exit = limit;
+            for (u32 k = 0; k < 3; ++k) {
+                enter = simdf_max(enter, simdf_madd(simdf_from_u8(q_near[k] + base), a[k], c[k]));
+                exit = simdf_min(exit, simdf_mul(simdf_madd(simdf_from_u8(q_far[k] + base), a[k], c[k]), widen));
+            }
+            simdf_store(t_enter + base, enter);
+            hits |= simdb_bits(simdf_le(enter, exit)) << base;
+        }
+        hits &= (1u << node->child_count) - 1;
+
+        // push far to near so the nearest child is popped first
+        u32 order[BVH8_WIDTH];
+        u32 hit_count = 0;
+        while (hits) {
+            u32 k = (u32)__builtin_ctz(hits);
+            hits &= hits - 1;
+            u32 slot = hit_count++;
+            while (slot > 0 && t_enter[order[slot - 1]] < t_enter[k]) {
+                order[slot] = order[slot - 1];
+                --slot;
+            }
+            order[slot] = k;
+        }
+        ASSERT(top + hit_count <= BVH8_STACK_SIZE);
+        for (u32 i = 0; i < hit_count; ++i) {
+            u32 k = order[i];
+            stack[top++] = (bvh8_stack_entry){node->child[k], node->prim_count[k], t_enter[k]};
+        }
+    }
+    return found;
+}
@@ -0,0 +1,64 @@
+#ifndef BVH8__H
+#define BVH8__H
+
+#include "defines.h"
+#include "simd.h"
+#include "bvh.h"
+
+/***
+ *    ██████  ██    ██ ██   ██  █████
+ *    ██   ██ ██    ██ ██   ██ ██   ██
+ *    ██████  ██    ██ ███████  █████
+ *    ██   ██  ██  ██  ██   ██ ██   ██
+ *    ██████    ████   ██   ██  █████
+ *
+ *
+ */
+
+#define BVH8_WIDTH 8
+
+// two cache lines. the first holds everything the box test reads: a per node grid
+// (origin and power of two cell size per axis) and the child bounds quantized to 8 bits on
+// that grid as structure of arrays. the second is only read for children that were hit
+typedef struct bvh8_node {
+    f32 origin[3];
+    // cell size on axis k is 2^exponent[k]
+    i8 exponent[3];
+    u8 child_count;
+    u8 qmin[3][BVH8_WIDTH];
+    u8 qmax[3][BVH8_WIDTH];
+
+    // interior children: index of the child node. leaf children: first entry in prim_indices
+    u32 child[BVH8_WIDTH];
+    // 0 for interior children
+    u8 prim_count[BVH8_WIDTH];
+    u8 pad[24];
+} ALIGN(64) bvh8_node;
+
+typedef struct bvh8 {
+    bvh8_node* nodes;
+    u32 node_count;
+    u32* prim_indices;
+    u32 prim_count;
+    // average number of children per node, 8 is a perfect collapse
+    f32 average_fill;
+} bvh8;
+
+// collapses a binary bvh built with max_leaf_size <= 255, the binary tree can be destroyed
+// afterwards. every node adopts the children of its largest interior children until it has 8
+void bvh8_build(bvh8* out, const bvh* binary);
+
+void bvh8_destroy(bvh8* b);
+
+// dequantized bounds of child k of node, conservative with respect to the source bounds
+bounds3 bvh8_child_bounds(const bvh8_node* node, u32 k);
+
+// closest hit of r in (0, t_max) against the triangles the binary tree was built from
+bool bvh8_intersect_triangles(const bvh8* b,
+                              const point3* positions,
+                              const u32* indices,
+                              const ray* r,
+                              f32 t_max,
+                              bvh_hit* hit);
+
+#endif
@@ -0,0 +1,240 @@
+#include "bvh_refit.h"
+#include "clock.h"
+#include "logger.h"
+#include "zatomic.h"
+#include "memory.h"
+
+#define REFIT_NO_PARENT 0xffffffffu
+// per thread cost sums are a cache line apart
+#define REFIT_PARTIAL_STRIDE 8
+// leaves per task, and how many triangles ahead the vertex reads are prefetched
+#define REFIT_CHUNK 4096
+#define REFIT_PREFETCH_DISTANCE 8
+
+// ============================================================================
+// STATE
+// ============================================================================
+
+typedef struct refit_state {
+    bvh_build_options options;
+    f32 rebuild_threshold;
+    f32 reference_sah;
+    u32 node_count;
+    u32* parents;
+    // leaves in primitive order, so walking them reads vertex_indices front to back
+    u32* leaves;
+    u32 leaf_count;
+    // the three vertex indices of every triangle in prim_indices order, which turns the
+    // scattered prim_indices -> indices -> positions chain into one scattered read
+    u32* vertex_indices;
+    u32 prim_count;
+    // arrivals per interior node, the second child to arrive refits the node and resets it
+    volatile u32* visits;
+    f64* partial_cost;
+    u32 partial_capacity;
+} refit_state;
+
+typedef struct refit_job {
+    refit_state* state;
+    bvh* b;
+    const point3* positions;
+} refit_job;
+
+static void release_topology(refit_state* state) {
+    if (state->node_count) {
+        memory_free(state->parents);
+        memory_free(state->leaves);
+        memory_free((void*)state->visits);
+        memory_free(state->vertex_indices);
+    }
+    state->node_count = 0;
+    state->leaf_count = 0;
+}
+
+// parent links, the leaf list and the vertex indices of b, and the cost everything is
+// compared against
+static void bind_tree(refit_state* state, const bvh* b, const u32* indices) {
+    release_topology(state);
+    state->reference_sah = bvh_compute_sah_cost(b, state->options.traversal_cost, state->options.intersect_cost);
+    if (b->node_count == 0) {
+        return;
+    }
+    state->node_count = b->node_count;
+    state->parents = (u32*)memory_allocate(sizeof(u32) * b->node_count);
+    state->leaves = (u32*)memory_allocate(sizeof(u32) * b->node_count);
+    state->visits = (volatile u32*)memory_allocate(sizeof(u32) * b->node_count);
+    state->vertex_indices = (u32*)memory_allocate(sizeof(u32) * 3 * b->prim_count);
+    state->prim_count = b->prim_count;
+    // leaves cover disjoint ranges of prim_indices, indexing them by their first entry sorts them
+    u32* leaf_at = (u32*)memory_allocate(sizeof(u32) * b->prim_count);
+    for (u32 k = 0; k < b->prim_count; ++k) {
+        leaf_at[k] = REFIT_NO_PARENT;
+        const u32* tri = indices + b->prim_indices[k] * 3;
+        state->vertex_indices[k * 3 + 0] = tri[0];
+        state->vertex_indices[k * 3 + 1] = tri[1];
+        state->vertex_indices[k * 3 + 2] = tri[2];
+    }
+    state->parents[0] = REFIT_NO_PARENT;
+    for (u32 n = 0; n < b->node_count; ++n) {
+        const bvh_node* node = &b->nodes[n];
+        state->visits[n] = 0;
+        if (node->prim_count) {
+            leaf_at[node->offset] = n;
+        } else {
+            state->parents[node->offset] = n;
+            state->parents[node->offset + 1] = n;
+        }
+    }
+    for (u32 k = 0; k < b->prim_count; ++k) {
+        if (leaf_at[k] != REFIT_NO_PARENT) {
+            state->leaves[state->leaf_count++] = leaf_at[k];
+        }
+    }
+    memory_free(leaf_at);
+}
+
+// ============================================================================
+// REFIT
+// ============================================================================
+
+FORCE_INLINE void set_node_bounds(bvh_node* node, const bounds3* b) {
+    for (u32 k = 0; k < 3; ++k) {
+        node->min[k] = b->min.e[k];
+        node->max[k] = b->max.e[k];
+    }
+}
+
+// refits one leaf from its triangles and walks up while it is the second child to arrive,
+// returning the unnormalized sah cost of every node it touched
+FORCE_INLINE f64 refit_leaf(refit_state* state, bvh_node* nodes, const point3* positions, u32 node_index) {
+    bvh_node* leaf = &nodes[node_index];
+    const u32* vertices = state->vertex_indices + leaf->offset * 3;
+    // the leaves after this one cover the next triangles
+    u32 ahead = (leaf->offset + REFIT_PREFETCH_DISTANCE) * 3;
+    if (ahead + 2 < state->prim_count * 3) {
+        __builtin_prefetch(&positions[state->vertex_indices[ahead]]);
+        __builtin_prefetch(&positions[state->vertex_indices[ahead + 1]]);
+        __builtin_prefetch(&positions[state->vertex_indices[ahead + 2]]);
+    }
+    bounds3 lb = bounds3_empty();
+    for (u32 v = 0; v < leaf->prim_count * 3u; ++v) {
+        lb = bounds3_union_point(lb, positions[vertices[v]]);
+    }
+    set_node_bounds(leaf, &lb);
+    f64 cost = (f64)bounds3_surface_area(&lb) * state->options.intersect_cost * leaf->prim_count;
+
+    u32 parent = state->parents[node_index];
+    // the atomic orders the sibling's bounds before the reads below
+    while (parent != REFIT_NO_PARENT && zatomic_add_u32(&state->visits[parent], 1) == 1) {
+        state->visits[parent] = 0;
+        bvh_node* node = &nodes[parent];
+        bounds3 left = bvh_node_bounds(&nodes[node->offset]);
+        bounds3 right = bvh_node_bounds(&nodes[node->offset + 1]);
+        bounds3 nb = bounds3_union(left, right);
+        set_node_bounds(node, &nb);
+        cost += (f64)bounds3_surface_area(&nb) * state->options.traversal_cost;
+        parent = state->parents[parent];
+    }
+    return cost;
+}
+
+static void refit_chunk_task(void* params, u64 index, u32 thread_index) {
+    refit_job* job = (refit_job*)params;
+    refit_state* state = job->state;
+    u32 begin = (u32)index * REFIT_CHUNK;
+    u32 end = begin + REFIT_CHUNK < state->leaf_count ? begin + REFIT_CHUNK : state->leaf_count;
+    f64 cost = 0;
+    for (u32 i = begin; i < end; ++i) {
+        cost += refit_leaf(state, job->b->nodes, job->positions, state->leaves[i]);
+    }
+    state->partial_cost[thread_index * REFIT_PARTIAL_STRIDE] += cost;
+}
+
+// ============================================================================
+// PUBLIC
+// ============================================================================
+
+void bvh_refitter_create(bvh_refitter* refitter,
+                         const bvh* b,
+                         const u32* indices,
+                         const bvh_build_options* options,
+                         f32 rebuild_threshold) {
+    refit_state* state = (refit_state*)memory_allocate(sizeof(refit_state));
+    if (options) {
+        state->options = *options;
+    } else {
+        bvh_build_options_default(&state->options);
+    }
+    state->rebuild_threshold = rebuild_threshold;
+    state->node_count = 0;
+    state->leaf_count = 0;
+    state->prim_count = 0;
+    state->partial_cost = 0;
+    state->partial_capacity = 0;
+    bind_tree(state, b, indices);
+    refitter->internal_data = state;
+}
+
+void bvh_refitter_destroy(bvh_refitter* refitter) {
+    refit_state* state = (refit_state*)refitter->internal_data;
+    release_topology(state);
+    if (state->partial_capacity) {
+        memory_free(state->partial_cost);
+    }
+    memory_free(state);
+    refitter->internal_data = 0;
+}
+
+void bvh_refitter_update_triangles(bvh_refitter* refitter,
+                                   bvh* b,
+                                   const point3* positions,
+                                   const u32* indices,
+                                   zpool* pool,
+                                   bvh_refit_result* result) {
+    clock clk;
+    clock_set(&clk);
+    refit_state* state = (refit_state*)refitter->internal_data;
+    ASSERT(state->node_count == b->node_count);
+    *result = (bvh_refit_result){0};
+    if (b->node_count == 0) {
+        return;
+    }
+    u32 thread_count = pool ? zpool_thread_count(pool) : 1;
+    if (thread_count > state->partial_capacity) {
+        if (state->partial_capacity) {
+            memory_free(state->partial_cost);
+        }
+        state->partial_capacity = thread_count;
+        state->partial_cost = (f64*)memory_allocate(sizeof(f64) * REFIT_PARTIAL_STRIDE * thread_count);
+    }
+    for (u32 t = 0; t < thread_count; ++t) {
+        state->partial_cost[t * REFIT_PARTIAL_STRIDE] = 0;
+    }
+
+    refit_job job = {state, b, positions};
+    zpool_parallel_for(pool, (state->leaf_count + REFIT_CHUNK - 1) / REFIT_CHUNK, 1, refit_chunk_task, &job);
+
+    f64 cost = 0;
+    for (u32 t = 0; t < thread_count; ++t) {
+        cost += state->partial_cost[t * REFIT_PARTIAL_STRIDE];
+    }
+    bounds3 root = bvh_node_bounds(&b->nodes[0]);
+    f32 root_area = bounds3_surface_area(&root);
+    f32 sah = root_area > 0 ? (f32)(cost / root_area) : state->options.intersect_cost * b->prim_count;
+    f32 ratio = state->reference_sah > 0 ? sah / state->reference_sah : 1;
+
+    if (state->rebuild_threshold > 0 && ratio > state->rebuild_threshold) {
+        u32 triangle_count = b->prim_count;
+        bvh_destroy(b);
+        bvh_build_triangles(b, positions, indices, triangle_count, &state->options, pool);
+        bind_tree(state, b, indices);
+        sah = state->reference_sah;
+        ratio = 1;
+        result->rebuilt = TRUE;
+    }
+    b->stats.sah_cost = sah;
+    clock_update(&clk);
+    result->seconds = clk.elapsed;
+    result->sah_cost = sah;
+    result->sah_ratio = ratio;
+}
@@ -0,0 +1,58 @@
+#ifndef BVH_REFIT__H
+#define BVH_REFIT__H
+
+#include "defines.h"
+#include "bvh.h"
+
+/***
+ *    ██████  ███████ ███████ ██ ████████
+ *    ██   ██ ██      ██      ██    ██
+ *    ██████  █████   █████   ██    ██
+ *    ██   ██ ██      ██      ██    ██
+ *    ██   ██ ███████ ██      ██    ██
+ *
+ *
+ */
+
+// keeps a bvh over a deforming triangle mesh up to date. the topology of the tree is kept
+// and only the bounds move, walking up from the leaves in parallel, so an update costs time
+// proportional to the vertex count. refitted trees slowly lose quality as the triangles
+// drift away from the neighbors they were grouped with, so every update also measures the
+// sah cost and rebuilds once it degrades past a threshold relative to the last build
+
+typedef struct bvh_refitter {
+    void* internal_data;
+} bvh_refitter;
+
+typedef struct bvh_refit_result {
+    // time spent in the update, including a rebuild when one happened
+    f64 seconds;
+    f32 sah_cost;
+    // sah_cost relative to the cost right after the last build
+    f32 sah_ratio;
+    bool rebuilt;
+} bvh_refit_result;
+
+// prepares refits of b, a tree built by bvh_build_triangles or lbvh_build_triangles over
+// indices. options are used for rebuilds and the sah costs (null for the defaults). a
+// rebuild_threshold of 0 never rebuilds, 1.5 rebuilds once a random ray is expected to cost
+// 50% more than right after the build
+void bvh_refitter_create(bvh_refitter* refitter,
+                         const bvh* b,
+                         const u32* indices,
+                         const bvh_build_options* options,
+                         f32 rebuild_threshold);
+
+void bvh_refitter_destroy(bvh_refitter* refitter);
+
+// refits b in place from the current positions, then rebuilds it with bvh_build_triangles
+// when the sah ratio passed the threshold. indices and the triangle count must be the ones
+// b was built with. pool may be null
+void bvh_refitter_update_triangles(bvh_refitter* refitter,
+                                   bvh* b,
+                                   const point3* positions,
+                                   const u32* indices,
+                                   zpool* pool,
+                                   bvh_refit_result* result);
+
+#endif
@@ -0,0 +1,324 @@
+#include "geometry_cache.h"
+#include "platform.h"
+#include "logger.h"
+#include "memory.h"
+
+// "PBGC" read as a little endian u32, a big endian reader sees it reversed and rejects the file
+#define CACHE_MAGIC 0x43474250u
+#define CACHE_ARRAY_ALIGNMENT 64
+
+// ============================================================================
+// FORMAT
+// ============================================================================
+
+typedef struct cache_header {
+    u32 magic;
+    u32 version;
+    // sizes of the structs stored verbatim, catching readers built with another layout
+    u32 entry_size;
+    u32 node_size;
+    u64 source_key;
+    u64 file_size;
+    u32 entry_count;
+    u32 reserved;
+} cache_header;
+
+// byte offsets are from the start of the file, 0 for arrays the mesh does not have
+typedef struct cache_entry {
+    u32 vertex_count;
+    u32 triangle_count;
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+    f32 uv_min[2];
+    f32 uv_extent[2];
+    u64 x;
+    u64 y;
+    u64 z;
+    u64 normals;
+    u64 uvs;
+    u64 indices;
+    u64 nodes;
+    u64 prim_indices;
+    u32 node_count;
+    u32 prim_count;
+    bvh_build_stats stats;
+} cache_entry;
+
+STATIC_ASSERT(sizeof(cache_header) == 40);
+STATIC_ASSERT(sizeof(cache_entry) == 152);
+
+FORCE_INLINE u64 align_up(u64 offset, u64 alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+FORCE_INLINE u64 take(u64* cursor, u64 bytes) {
+    u64 at = align_up(*cursor, CACHE_ARRAY_ALIGNMENT);
+    *cursor = at + bytes;
+    return at;
+}
+
+// ============================================================================
+// WRITE
+// ============================================================================
+
+typedef struct cache_writer {
+    platform_file file;
+    u64 written;
+    bool ok;
+} cache_writer;
+
+// zero pads up to offset, then writes the array there
+static void write_at(cache_writer* w, u64 offset, const void* data, u64 size) {
+    static const u8 zeros[GEOMETRY_CACHE_PAGE];
+    ASSERT(offset >= w->written);
+    while (w->ok && w->written < offset) {
+        u64 pad = offset - w->written < sizeof(zeros) ? offset - w->written : sizeof(zeros);
+        w->ok = platform_file_write(&w->file, zeros, pad) == pad;
+        w->written += pad;
+    }
+    if (w->ok && size) {
+        w->ok = platform_file_write(&w->file, data, size) == size;
+        w->written += size;
+    }
+}
+
+bool geometry_cache_write(const char* path, u64 source_key, const mesh* meshes, const bvh* trees, u32 count) {
+    ASSERT(path && (meshes || count == 0));
+    cache_entry* entries = (cache_entry*)memory_allocate(sizeof(cache_entry) * (count ? count : 1));
+
+    // lay the file out first, every mesh starts on its own page
+    u64 cursor = sizeof(cache_header) + sizeof(cache_entry) * (u64)count;
+    for (u32 i = 0; i < count; ++i) {
+        const mesh* m = &meshes[i];
+        const bvh* tree = trees && trees[i].node_count ? &trees[i] : 0;
+        ASSERT(!tree || tree->prim_count == m->triangle_count);
+        cache_entry* e = &entries[i];
+        e->vertex_count = m->vertex_count;
+        e->triangle_count = m->triangle_count;
+        e->bounds_min[0] = m->bounds.min.x;
+        e->bounds_min[1] = m->bounds.min.y;
+        e->bounds_min[2] = m->bounds.min.z;
+        e->bounds_max[0] = m->bounds.max.x;
+        e->bounds_max[1] = m->bounds.max.y;
+        e->bounds_max[2] = m->bounds.max.z;
+        e->uv_min[0] = m->uv_min[0];
+        e->uv_min[1] = m->uv_min[1];
+        e->uv_extent[0] = m->uv_extent[0];
+        e->uv_extent[1] = m->uv_extent[1];
+
+        cursor = align_up(cursor, GEOMETRY_CACHE_PAGE);
+        u64 position_bytes = sizeof(f32) * (u64)m->vertex_count;
+        e->x = take(&cursor, position_bytes);
+        e->y = take(&cursor, position_bytes);
+        e->z = take(&cursor, position_bytes);
+        e->normals = m->normals ? take(&cursor, sizeof(u32) * (u64)m->vertex_count) : 0;
+        e->uvs = m->uvs ? take(&cursor, 2 * sizeof(u16) * (u64)m->vertex_count) : 0;
+        // shared index buffers are written per mesh, the file does not reference anything outside
+        e->indices = take(&cursor, 3 * sizeof(u32) * (u64)m->triangle_count);
+        e->node_count = tree ? tree->node_count : 0;
+        e->prim_count = tree ? tree->prim_count : 0;
+        e->nodes = tree ? take(&cursor, sizeof(bvh_node) * (u64)tree->node_count) : 0;
+        e->prim_indices = tree ? take(&cursor, sizeof(u32) * (u64)tree->prim_count) : 0;
+        bvh_build_stats no_stats = {0};
+        e->stats = tree ? tree->stats : no_stats;
+    }
+
+    cache_header header;
+    header.magic = CACHE_MAGIC;
+    header.version = GEOMETRY_CACHE_VERSION;
+    header.entry_size = sizeof(cache_entry);
+    header.node_size = sizeof(bvh_node);
+    header.source_key = source_key;
+    header.file_size = cursor;
+    header.entry_count = count;
+    header.reserved = 0;
+
+    cache_writer w;
+    w.written = 0;
+    w.ok = platform_file_open(path, PLATFORM_FILE_WRITE, &w.file);
+    if (!w.ok) {
+        memory_free(entries);
+        return FALSE;
+    }
+    write_at(&w, 0, &header, sizeof(header));
+    write_at(&w, sizeof(header), entries, sizeof(cache_entry) * (u64)count);
+    for (u32 i = 0; i < count; ++i) {
+        const mesh* m = &meshes[i];
+        const cache_entry* e = &entries[i];
+        u64 position_bytes = sizeof(f32) * (u64)m->vertex_count;
+        write_at(&w, e->x, m->x, position_bytes);
+        write_at(&w, e->y, m->y, position_bytes);
+        write_at(&w, e->z, m->z, position_bytes);
+        if (e->normals) {
+            write_at(&w, e->normals, m->normals, sizeof(u32) * (u64)m->vertex_count);
+        }
+        if (e->uvs) {
+            write_at(&w, e->uvs, m->uvs, 2 * sizeof(u16) * (u64)m->vertex_count);
+        }
+        write_at(&w, e->indices, m->indices, 3 * sizeof(u32) * (u64)m->triangle_count);
+        if (e->node_count) {
+            write_at(&w, e->nodes, trees[i].nodes, sizeof(bvh_node) * (u64)e->node_count);
+            write_at(&w, e->prim_indices, trees[i].prim_indices, sizeof(u32) * (u64)e->prim_count);
+        }
+    }
+    // a mesh without vertices or triangles ends the file on an unwritten offset
+    write_at(&w, header.file_size, 0, 0);
+    platform_file_close(&w.file);
+    memory_free(entries);
+    return w.ok;
+}
+
+// ============================================================================
+// OPEN
+// ============================================================================
+
+// the array fits in the file and starts where the writer puts arrays
+static bool array_valid(u64 offset, u64 bytes, u64 file_size) {
+    return offset && offset % CACHE_ARRAY_ALIGNMENT == 0 && offset <= file_size && bytes <= file_size - offset;
+}
+
+static bool entry_valid(const cache_entry* e, u64 file_size) {
+    u64 position_bytes = sizeof(f32) * (u64)e->vertex_count;
+    bool valid = array_valid(e->x, position_bytes, file_size) && array_valid(e->y, position_bytes, file_size) &&
+                 array_valid(e->z, position_bytes, file_size) &&
+                 array_valid(e->indices, 3 * sizeof(u32) * (u64)e->triangle_count, file_size);
+    valid = valid && (!e->normals || array_valid(e->normals, sizeof(u32) * (u64)e->vertex_count, file_size));
+    valid = valid && (!e->uvs || array_valid(e->uvs, 2 * sizeof(u16) * (u64)e->vertex_count, file_size));
+    if (valid && e->node_count) {
+        valid = e->prim_count == e->triangle_count && array_valid(e->nodes, sizeof(bvh_node) * (u64)e->node_count, file_size) &&
+                array_valid(e->prim_indices, sizeof(u32) * (u64)e->prim_count, file_size);
+    }
+    return valid;
+}
+
+// the offsets only say the arrays are inside the file, traversal and shading also trust what
+// they hold. every index has to name a vertex, children come after their parent (the builder
+// reserves them later) and within the node array, leaves stay inside prim_indices, which
+// names triangles, and no path is deeper than the traversal stack
+static bool contents_valid(const cache_entry* e, const u8* base) {
+    const u32* indices = (const u32*)(base + e->indices);
+    for (u64 i = 0; i < 3 * (u64)e->triangle_count; ++i) {
+        if (indices[i] >= e->vertex_count) {
+            return FALSE;
+        }
+    }
+    if (e->node_count == 0) {
+        return TRUE;
+    }
+    const u32* prim_indices = (const u32*)(base + e->prim_indices);
+    for (u32 i = 0; i < e->prim_count; ++i) {
+        if (prim_indices[i] >= e->triangle_count) {
+            return FALSE;
+        }
+    }
+    const bvh_node* nodes = (const bvh_node*)(base + e->nodes);
+    u8* depths = (u8*)memory_allocate(e->node_count);
+    depths[0] = 0;
+    bool valid = TRUE;
+    for (u32 i = 0; valid && i < e->node_count; ++i) {
+        const bvh_node* node = &nodes[i];
+        if (node->prim_count) {
+            valid = (u64)node->offset + node->prim_count <= e->prim_count;
+            continue;
+        }
+        valid = node->axis < 3 && node->offset > i && node->offset < e->node_count - 1 && depths[i] < BVH_STACK_SIZE;
+        if (valid) {
+            depths[node->offset] = depths[node->offset + 1] = (u8)(depths[i] + 1);
+        }
+    }
+    memory_free(depths);
+    return valid;
+}
+
+bool geometry_cache_open(geometry_cache* cache, const char* path, u64 source_key) {
+    ASSERT(cache && path);
+    cache->meshes = 0;
+    cache->trees = 0;
+    cache->count = 0;
+    cache->internal_data = 0;
+
+    platform_file_mapping mapping;
+    if (!platform_file_map(path, &mapping)) {
+        return FALSE;
+    }
+    const u8* base = (const u8*)mapping.data;
+    const cache_header* header = (const cache_header*)base;
+    bool valid = mapping.size >= sizeof(cache_header) && header->magic == CACHE_MAGIC &&
+                 header->version == GEOMETRY_CACHE_VERSION && header->entry_size == sizeof(cache_entry) &&
+                 header->node_size == sizeof(bvh_node) && header->source_key == source_key &&
+                 header->file_size == mapping.size &&
+                 header->entry_count <= (mapping.size - sizeof(cache_header)) / sizeof(cache_entry);
+    const cache_entry* entries = (const cache_entry*)(base + sizeof(cache_header));
+    for (u32 i = 0; valid && i < header->entry_count; ++i) {
+        valid = entry_valid(&entries[i], mapping.size) && contents_valid(&entries[i], base);
+    }
+    if (!valid) {
+        LOGW("geometry cache %s is stale or damaged", path);
+        platform_file_unmap(&mapping);
+        return FALSE;
+    }
+
+    u32 count = header->entry_count;
+    u32 slots = count ? count : 1;
+    cache->meshes = (mesh*)memory_allocate(sizeof(mesh) * slots);
+    cache->trees = (bvh*)memory_allocate(sizeof(bvh) * slots);
+    cache->count = count;
+    cache->source_key = source_key;
+    platform_file_mapping* owned = (platform_file_mapping*)memory_allocate(sizeof(platform_file_mapping));
+    *owned = mapping;
+    cache->internal_data = owned;
+
+    // the mapping is read only, the casts only satisfy the mutable fields of mesh and bvh
+    for (u32 i = 0; i < count; ++i) {
+        const cache_entry* e = &entries[i];
+        mesh* m = &cache->meshes[i];
+        m->vertex_count = e->vertex_count;
+        m->triangle_count = e->triangle_count;
+        m->x = (f32*)(base + e->x);
+        m->y = (f32*)(base + e->y);
+        m->z = (f32*)(base + e->z);
+        m->normals = e->normals ? (u32*)(base + e->normals) : 0;
+        m->uvs = e->uvs ? (u16*)(base + e->uvs) : 0;
+        m->uv_min[0] = e->uv_min[0];
+        m->uv_min[1] = e->uv_min[1];
+        m->uv_extent[0] = e->uv_extent[0];
+        m->uv_extent[1] = e->uv_extent[1];
+        m->indices = (const u32*)(base + e->indices);
+        m->owns_indices = FALSE;
+        m->bounds.min = vec3_make(e->bounds_min[0], e->bounds_min[1], e->bounds_min[2]);
+        m->bounds.max = vec3_make(e->bounds_max[0], e->bounds_max[1], e->bounds_max[2]);
+        m->internal_data = 0;
+
+        bvh* tree = &cache->trees[i];
+        tree->node_count = e->node_count;
+        tree->prim_count = e->prim_count;
+        tree->nodes = e->node_count ? (bvh_node*)(base + e->nodes) : 0;
+        tree->prim_indices = e->node_count ? (u32*)(base + e->prim_indices) : 0;
+        tree->stats = e->stats;
+    }
+    return TRUE;
+}
+
+void geometry_cache_close(geometry_cache* cache) {
+    ASSERT(cache);
+    if (cache->internal_data) {
+        platform_file_mapping* mapping = (platform_file_mapping*)cache->internal_data;
+        platform_file_unmap(mapping);
+        memory_free(mapping);
+        memory_free(cache->meshes);
+        memory_free(cache->trees);
+    }
+    cache->internal_data = 0;
+    cache->meshes = 0;
+    cache->trees = 0;
+    cache->count = 0;
+}
+
+u64 geometry_cache_hash(const void* data, u64 size, u64 seed) {
+    const u8* bytes = (const u8*)data;
+    u64 hash = 0xcbf29ce484222325ULL ^ seed;
+    for (u64 i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
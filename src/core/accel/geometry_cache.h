@@ -0,0 +1,58 @@
+#ifndef GEOMETRY_CACHE__H
+#define GEOMETRY_CACHE__H
+
+#include "defines.h"
+#include "mesh.h"
+#include "bvh.h"
+
+/***
+ *     ██████  █████   ██████ ██   ██ ███████
+ *    ██      ██   ██ ██      ██   ██ ██
+ *    ██      ███████ ██      ███████ █████
+ *    ██      ██   ██ ██      ██   ██ ██
+ *     ██████ ██   ██  ██████ ██   ██ ███████
+ *
+ *
+ */
+
+// binary file holding compact meshes and the bvhs built over them, laid out so it can be
+// mapped and used in place. a header and an entry table come first, then the arrays of every
+// mesh starting on a page boundary, each array on a cache line. opening a cache maps the
+// file and points the meshes and trees at it, nothing is copied or rebuilt. opening reads the
+// index and tree arrays once to check they stay in bounds, the positions, normals and uvs are
+// read from disk (or the page cache) as traversal and shading first touch them.
+// the file stores the build machine's byte order and struct layout, a reader with another
+// layout, an older format version or a different source key rejects it
+
+#define GEOMETRY_CACHE_VERSION 1
+// array sections start at multiples of this in the file, independent of the host page size
+#define GEOMETRY_CACHE_PAGE 4096
+
+typedef struct geometry_cache {
+    // views into the mapping: read only, owning nothing. mesh_destroy on them is harmless,
+    // bvh_destroy must not be called, close the cache instead
+    mesh* meshes;
+    // node_count is 0 for meshes written without a tree
+    bvh* trees;
+    u32 count;
+    u64 source_key;
+    void* internal_data;
+} geometry_cache;
+
+// writes count meshes to path. trees may be null, or hold trees with node_count 0, for meshes
+// without a prebuilt bvh. source_key identifies what the geometry was made from (typically
+// geometry_cache_hash of the scene file) and must match when opening. returns FALSE when the
+// file cannot be written
+bool geometry_cache_write(const char* path, u64 source_key, const mesh* meshes, const bvh* trees, u32 count);
+
+// maps path and validates it against source_key. FALSE when the file is missing, truncated,
+// from another format version or layout, was written for another source, or holds indices or
+// tree nodes pointing outside their arrays
+bool geometry_cache_open(geometry_cache* cache, const char* path, u64 source_key);
+
+void geometry_cache_close(geometry_cache* cache);
+
+// 64 bit fnv-1a, for deriving source keys
+u64 geometry_cache_hash(const void* data, u64 size, u64 seed);
+
+#endif
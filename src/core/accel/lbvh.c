@@ -0,0 +1,628 @@
+#include "lbvh.h"
+#include "clock.h"
+#include "logger.h"
+#include "zatomic.h"
+#include "memory.h"
+
+// primitives per task for the bounds, code and sort passes
+#define LBVH_CHUNK (64 * 1024)
+#define LBVH_RADIX_BITS 8
+#define LBVH_RADIX_SIZE (1u << LBVH_RADIX_BITS)
+#define LBVH_PREFETCH_DISTANCE 16
+// rotations run on one task per subtree at this depth, the levels above run afterwards
+#define LBVH_ROTATION_SPLIT_DEPTH 6
+
+// ============================================================================
+// BUILD STATE
+// ============================================================================
+
+typedef struct lbvh_context {
+    const bounds3* prim_bounds;
+    u32 prim_count;
+    u32 chunk_count;
+    u32 morton_bits;
+    // per chunk centroid bounds, reduced on the calling thread
+    bounds3* chunk_bounds;
+    // centroids map to grid cells as (c - grid_min) * grid_scale
+    f32 grid_min[3];
+    f32 grid_scale[3];
+
+    // radix sort, keys are the morton codes and values the primitive indices. 30 bit codes
+    // are packed above the primitive index instead, which makes every key unique and halves
+    // the memory the scatter passes stream through. the values arrays are unused then
+    bool packed;
+    u32 key_shift;
+    u64* keys;
+    u32* values;
+    u64* keys_swap;
+    u32* values_swap;
+    // LBVH_RADIX_SIZE counters per chunk, turned into scatter offsets in place
+    u32* histograms;
+    u32 shift;
+
+    // internal node i has its children in the pair at 1 + 2i, internal node 0 is the root
+    bvh_node* nodes;
+    u32* prim_indices;
+    u32* internal_slot;
+    u32* internal_parent;
+    u8* internal_axis;
+    u32* leaf_slot;
+    u32* leaf_parent;
+    // the second child to finish computes the bounds of their parent
+    volatile u32* visits;
+    u32* rotation_roots;
+} lbvh_context;
+
+FORCE_INLINE void chunk_range(const lbvh_context* ctx, u64 chunk, u32* begin, u32* end) {
+    *begin = (u32)chunk * LBVH_CHUNK;
+    *end = *begin + LBVH_CHUNK < ctx->prim_count ? *begin + LBVH_CHUNK : ctx->prim_count;
+}
+
+FORCE_INLINE f32 prim_centroid(const lbvh_context* ctx, u32 prim, u32 axis) {
+    return (ctx->prim_bounds[prim].min.e[axis] + ctx->prim_bounds[prim].max.e[axis]) * 0.5f;
+}
+
+FORCE_INLINE u32 sorted_prim(const lbvh_context* ctx, u32 k) {
+    return ctx->packed ? (u32)ctx->keys[k] : ctx->values[k];
+}
+
+// ============================================================================
+// MORTON CODES
+// ============================================================================
+
+// moves bit k of the low 10 bits of v to bit 3k
+FORCE_INLINE u64 expand_bits_10(u32 v) {
+    v = (v * 0x00010001u) & 0xff0000ffu;
+    v = (v * 0x00000101u) & 0x0f00f00fu;
+    v = (v * 0x00000011u) & 0xc30c30c3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// moves bit k of the low 21 bits of v to bit 3k
+FORCE_INLINE u64 expand_bits_21(u64 v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+static void centroid_bounds_task(void* params, u64 index, u32 thread_index) {
+    lbvh_context* ctx = (lbvh_context*)params;
+    u32 begin, end;
+    chunk_range(ctx, index, &begin, &end);
+    bounds3 b = bounds3_empty();
+    for (u32 i = begin; i < end; ++i) {
+        b = bounds3_union_point(b, bounds3_centroid(&ctx->prim_bounds[i]));
+    }
+    ctx->chunk_bounds[index] = b;
+}
+
+// x takes the highest bit of every triple, so the top differing bit of two codes names the
+// axis that separates them
+static void morton_task(void* params, u64 index, u32 thread_index) {
+    lbvh_context* ctx = (lbvh_context*)params;
+    u32 begin, end;
+    chunk_range(ctx, index, &begin, &end);
+    f32 cells = ctx->morton_bits == 30 ? 1023.0f : 2097151.0f;
+    for (u32 i = begin; i < end; ++i) {
+        u32 q[3];
+        for (u32 k = 0; k < 3; ++k) {
+            f32 cell = (prim_centroid(ctx, i, k) - ctx->grid_min[k]) * ctx->grid_scale[k];
+            q[k] = (u32)clampf(cell, 0, cells);
+        }
+        if (ctx->packed) {
+            u64 code = expand_bits_10(q[0]) << 2 | expand_bits_10(q[1]) << 1 | expand_bits_10(q[2]);
+            ctx->keys[i] = code << 32 | i;
+        } else {
+            ctx->keys[i] = expand_bits_21(q[0]) << 2 | expand_bits_21(q[1]) << 1 | expand_bits_21(q[2]);
+            ctx->values[i] = i;
+        }
+    }
+}
+
+// ============================================================================
+// RADIX SORT
+// ============================================================================
+
+static void histogram_task(void* params, u64 index, u32 thread_index) {
+    lbvh_context* ctx = (lbvh_context*)params;
+    u32 begin, end;
+    chunk_range(ctx, index, &begin, &end);
+    u32* histogram = ctx->histograms + index * LBVH_RADIX_SIZE;
+    for (u32 d = 0; d < LBVH_RADIX_SIZE; ++d) {
+        histogram[d] = 0;
+    }
+    for (u32 i = begin; i < end; ++i) {
+        histogram[(ctx->keys[i] >> ctx->shift) & (LBVH_RADIX_SIZE - 1)] += 1;
+    }
+}
+
+// every chunk scatters in order into its own slice of each bucket, which keeps the sort stable
+static void scatter_task(void* params, u64 index, u32 thread_index) {
+    lbvh_context* ctx = (lbvh_context*)params;
+    u32 begin, end;
+    chunk_range(ctx, index, &begin, &end);
+    u32* offsets = ctx->histograms + index * LBVH_RADIX_SIZE;
+    for (u32 i = begin; i < end; ++i) {
+        u64 key = ctx->keys[i];
+        u32 slot = offsets[(key >> ctx->shift) & (LBVH_RADIX_SIZE - 1)]++;
+        ctx->keys_swap[slot] = key;
+        if (!ctx->packed) {
+            ctx->values_swap[slot] = ctx->values[i];
+        }
+    }
+}
+
+// least significant digit first, passes where every key has the same digit are skipped
+static void radix_sort(lbvh_context* ctx, zpool* pool) {
+    for (u32 shift = ctx->key_shift; shift < ctx->key_shift + ctx->morton_bits; shift += LBVH_RADIX_BITS) {
+        ctx->shift = shift;
+        zpool_parallel_for(pool, ctx->chunk_count, 1, histogram_task, ctx);
+        u32 running = 0;
+        bool single_bucket = FALSE;
+        for (u32 d = 0; d < LBVH_RADIX_SIZE; ++d) {
+            u32 bucket_begin = running;
+            for (u32 c = 0; c < ctx->chunk_count; ++c) {
+                u32 count = ctx->histograms[c * LBVH_RADIX_SIZE + d];
+                ctx->histograms[c * LBVH_RADIX_SIZE + d] = running;
+                running += count;
+            }
+            single_bucket = single_bucket || running - bucket_begin == ctx->prim_count;
+        }
+        if (single_bucket) {
+            continue;
+        }
+        zpool_parallel_for(pool, ctx->chunk_count, 1, scatter_task, ctx);
+        u64* keys = ctx->keys;
+        u32* values = ctx->values;
+        ctx->keys = ctx->keys_swap;
+        ctx->values = ctx->values_swap;
+        ctx->keys_swap = keys;
+        ctx->values_swap = values;
+    }
+}
+
+// ============================================================================
+// HIERARCHY
+// ============================================================================
+
+// length of the common prefix of the keys at i and j, -1 outside the array. duplicate keys
+// are told apart by their indices, which keeps every split well defined
+FORCE_INLINE i32 key_delta(const lbvh_context* ctx, u32 i, i64 j) {
+    if (j < 0 || j >= ctx->prim_count) {
+        return -1;
+    }
+    u64 x = ctx->keys[i] ^ ctx->keys[j];
+    if (x) {
+        return __builtin_clzll(x);
+    }
+    return 64 + __builtin_clz(i ^ (u32)j);
+}
+
+// karras 2012: internal node i covers a range of sorted keys with i at one end and splits it
+// where the common prefix grows. each internal node is found independently
+static void emit_task(void* params, u64 index, u32 thread_index) {
+    lbvh_context* ctx = (lbvh_context*)params;
+    u32 i = (u32)index;
+    i64 d = key_delta(ctx, i, (i64)i + 1) > key_delta(ctx, i, (i64)i - 1) ? 1 : -1;
+
+    i32 delta_min = key_delta(ctx, i, i - d);
+    i64 length_max = 2;
+    while (key_delta(ctx, i, i + length_max * d) > delta_min) {
+        length_max <<= 1;
+    }
+    i64 length = 0;
+    for (i64 t = length_max >> 1; t > 0; t >>= 1) {
+        if (key_delta(ctx, i, i + (length + t) * d) > delta_min) {
+            length += t;
+        }
+    }
+    i64 j = i + length * d;
+
+    i32 delta_node = key_delta(ctx, i, j);
+    i64 split = 0;
+    i64 t = length;
+    do {
+        t = (t + 1) >> 1;
+        if (key_delta(ctx, i, i + (split + t) * d) > delta_node) {
+            split += t;
+        }
+    } while (t > 1);
+    u32 gamma = (u32)(i + split * d + (d < 0 ? -1 : 0));
+
+    u32 first = (u32)(d > 0 ? i : j);
+    u32 last = (u32)(d > 0 ? j : i);
+    u32 children[2] = {gamma, gamma + 1};
+    bool is_leaf[2] = {first == gamma, last == gamma + 1};
+    for (u32 side = 0; side < 2; ++side) {
+        u32 slot = 1 + 2 * i + side;
+        if (is_leaf[side]) {
+            ctx->leaf_slot[children[side]] = slot;
+            ctx->leaf_parent[children[side]] = i;
+        } else {
+            ctx->internal_slot[children[side]] = slot;
+            ctx->internal_parent[children[side]] = i;
+        }
+    }
+
+    u64 differing = (ctx->keys[first] ^ ctx->keys[last]) >> ctx->key_shift;
+    u32 bit = differing ? 63 - (u32)__builtin_clzll(differing) : 2;
+    ctx->internal_axis[i] = (u8)(2 - bit % 3);
+    ctx->visits[i] = 0;
+}
+
+static void set_node_bounds(bvh_node* node, const bvh_node* a, const bvh_node* b) {
+    for (u32 k = 0; k < 3; ++k) {
+        node->min[k] = minf(a->min[k], b->min[k]);
+        node->max[k] = maxf(a->max[k], b->max[k]);
+    }
+}
+
+// writes leaf k and walks up while it is the second child to arrive at a parent
+FORCE_INLINE void emit_leaf(lbvh_context* ctx, u32 k) {
+    u32 prim = sorted_prim(ctx, k);
+    bvh_node* leaf = &ctx->nodes[ctx->leaf_slot[k]];
+    for (u32 a = 0; a < 3; ++a) {
+        leaf->min[a] = ctx->prim_bounds[prim].min.e[a];
+        leaf->max[a] = ctx->prim_bounds[prim].max.e[a];
+    }
+    leaf->offset = k;
+    leaf->prim_count = 1;
+    leaf->axis = 0;
+    ctx->prim_indices[k] = prim;
+    if (ctx->prim_count == 1) {
+        return;
+    }
+    u32 parent = ctx->leaf_parent[k];
+    // the atomic orders the sibling's writes before the reads below
+    while (zatomic_add_u32(&ctx->visits[parent], 1) == 1) {
+        bvh_node* node = &ctx->nodes[ctx->internal_slot[parent]];
+        set_node_bounds(node, &ctx->nodes[1 + 2 * parent], &ctx->nodes[2 + 2 * parent]);
+        node->offset = 1 + 2 * parent;
+        node->prim_count = 0;
+        node->axis = ctx->internal_axis[parent];
+        if (parent == 0) {
+            return;
+        }
+        parent = ctx->internal_parent[parent];
+    }
+}
+
+// the sorted order scatters the reads of prim_bounds, prefetching a few leaves ahead hides
+// most of the misses
+static void bounds_task(void* params, u64 index, u32 thread_index) {
+    lbvh_context* ctx = (lbvh_context*)params;
+    u32 begin, end;
+    chunk_range(ctx, index, &begin, &end);
+    for (u32 k = begin; k < end; ++k) {
+        if (k + LBVH_PREFETCH_DISTANCE < end) {
+            __builtin_prefetch(&ctx->prim_bounds[sorted_prim(ctx, k + LBVH_PREFETCH_DISTANCE)]);
+        }
+        emit_leaf(ctx, k);
+    }
+}
+
+// ============================================================================
+// ROTATIONS
+// ============================================================================
+
+FORCE_INLINE f32 union_area(const bvh_node* a, const bvh_node* b) {
+    bvh_node u;
+    set_node_bounds(&u, a, b);
+    bounds3 ub = bvh_node_bounds(&u);
+    return bounds3_surface_area(&ub);
+}
+
+FORCE_INLINE void swap_nodes(bvh_node* nodes, u32 a, u32 b) {
+    bvh_node temp = nodes[a];
+    nodes[a] = nodes[b];
+    nodes[b] = temp;
+}
+
+// recomputes the bounds of an interior node and restores the traversal order of its
+// children along the axis that separates their centroids the most
+static void refit_node(bvh_node* nodes, u32 index) {
+    bvh_node* node = &nodes[index];
+    const bvh_node* left = &nodes[node->offset];
+    const bvh_node* right = &nodes[node->offset + 1];
+    set_node_bounds(node, left, right);
+    u32 axis = 0;
+    f32 best = -1;
+    for (u32 k = 0; k < 3; ++k) {
+        f32 separation = absf((right->min[k] + right->max[k]) - (left->min[k] + left->max[k]));
+        if (separation > best) {
+            best = separation;
+            axis = k;
+        }
+    }
+    if (left->min[axis] + left->max[axis] > right->min[axis] + right->max[axis]) {
+        swap_nodes(nodes, node->offset, node->offset + 1);
+    }
+    node->axis = (u16)axis;
+}
+
+// swaps one child with a grandchild under the other child when that shrinks the other
+// child, the only node whose area changes. ancestors keep their bounds
+static void try_rotation(bvh_node* nodes, u32 index) {
+    const bvh_node* node = &nodes[index];
+    if (node->prim_count) {
+        return;
+    }
+    f32 best_gain = 0;
+    u32 best_child = 0, best_sibling = 0, best_grandchild = 0;
+    for (u32 side = 0; side < 2; ++side) {
+        u32 child = node->offset + side;
+        u32 sibling = node->offset + 1 - side;
+        const bvh_node* c = &nodes[child];
+        if (c->prim_count) {
+            continue;
+        }
+        bounds3 cb = bvh_node_bounds(c);
+        f32 area = bounds3_surface_area(&cb);
+        for (u32 g = 0; g < 2; ++g) {
+            u32 kept = c->offset + 1 - g;
+            f32 gain = area - union_area(&nodes[sibling], &nodes[kept]);
+            if (gain > best_gain) {
+                best_gain = gain;
+                best_child = child;
+                best_sibling = sibling;
+                best_grandchild = c->offset + g;
+            }
+        }
+    }
+    if (best_gain <= 0) {
+        return;
+    }
+    swap_nodes(nodes, best_sibling, best_grandchild);
+    refit_node(nodes, best_child);
+    refit_node(nodes, index);
+}
+
+static void rotate_subtree(bvh_node* nodes, u32 index) {
+    if (nodes[index].prim_count) {
+        return;
+    }
+    rotate_subtree(nodes, nodes[index].offset);
+    rotate_subtree(nodes, nodes[index].offset + 1);
+    try_rotation(nodes, index);
+}
+
+static void collect_rotation_roots(lbvh_context* ctx, u32 index, u32 depth, u32* count) {
+    if (depth == LBVH_ROTATION_SPLIT_DEPTH) {
+        ctx->rotation_roots[(*count)++] = index;
+    } else if (ctx->nodes[index].prim_count == 0) {
+        collect_rotation_roots(ctx, ctx->nodes[index].offset, depth + 1, count);
+        collect_rotation_roots(ctx, ctx->nodes[index].offset + 1, depth + 1, count);
+    }
+}
+
+// the nodes above the split depth, children first
+static void rotate_top(bvh_node* nodes, u32 index, u32 depth) {
+    if (depth == LBVH_ROTATION_SPLIT_DEPTH || nodes[index].prim_count) {
+        return;
+    }
+    rotate_top(nodes, nodes[index].offset, depth + 1);
+    rotate_top(nodes, nodes[index].offset + 1, depth + 1);
+    try_rotation(nodes, index);
+}
+
+static void rotation_task(void* params, u64 index, u32 thread_index) {
+    lbvh_context* ctx = (lbvh_context*)params;
+    rotate_subtree(ctx->nodes, ctx->rotation_roots[index]);
+}
+
+// ============================================================================
+// PUBLIC
+// ============================================================================
+
+void lbvh_build_options_default(lbvh_build_options* options) {
+    bvh_build_options sah;
+    bvh_build_options_default(&sah);
+    options->morton_bits = 30;
+    options->rotation_passes = 0;
+    options->traversal_cost = sah.traversal_cost;
+    options->intersect_cost = sah.intersect_cost;
+}
+
+typedef struct lbvh_builder_state {
+    bvh tree;
+    // primitives the tree arrays and the scratch block are sized for
+    u32 capacity;
+    u8* scratch;
+} lbvh_builder_state;
+
+FORCE_INLINE u64 scratch_take(u64* cursor, u64 bytes) {
+    u64 at = *cursor;
+    *cursor = (at + bytes + 63) & ~63ULL;
+    return at;
+}
+
+// carves every scratch array out of one block, with base null it only measures the block
+static u64 scratch_layout(lbvh_context* ctx, u8* base, u32 prim_count) {
+    u32 chunk_count = (prim_count + LBVH_CHUNK - 1) / LBVH_CHUNK;
+    u64 cursor = 0;
+    u64 chunk_bounds = scratch_take(&cursor, sizeof(bounds3) * chunk_count);
+    u64 keys = scratch_take(&cursor, sizeof(u64) * prim_count);
+    u64 keys_swap = scratch_take(&cursor, sizeof(u64) * prim_count);
+    u64 values = scratch_take(&cursor, sizeof(u32) * prim_count);
+    u64 values_swap = scratch_take(&cursor, sizeof(u32) * prim_count);
+    u64 histograms = scratch_take(&cursor, sizeof(u32) * LBVH_RADIX_SIZE * chunk_count);
+    // internal arrays get one spare entry so a single primitive needs no special case
+    u64 internal_slot = scratch_take(&cursor, sizeof(u32) * prim_count);
+    u64 internal_parent = scratch_take(&cursor, sizeof(u32) * prim_count);
+    u64 internal_axis = scratch_take(&cursor, sizeof(u8) * prim_count);
+    u64 visits = scratch_take(&cursor, sizeof(u32) * prim_count);
+    u64 leaf_slot = scratch_take(&cursor, sizeof(u32) * prim_count);
+    u64 leaf_parent = scratch_take(&cursor, sizeof(u32) * prim_count);
+    u64 rotation_roots = scratch_take(&cursor, sizeof(u32) << LBVH_ROTATION_SPLIT_DEPTH);
+    if (base) {
+        ctx->chunk_count = chunk_count;
+        ctx->chunk_bounds = (bounds3*)(base + chunk_bounds);
+        ctx->keys = (u64*)(base + keys);
+        ctx->keys_swap = (u64*)(base + keys_swap);
+        ctx->values = (u32*)(base + values);
+        ctx->values_swap = (u32*)(base + values_swap);
+        ctx->histograms = (u32*)(base + histograms);
+        ctx->internal_slot = (u32*)(base + internal_slot);
+        ctx->internal_parent = (u32*)(base + internal_parent);
+        ctx->internal_axis = base + internal_axis;
+        ctx->visits = (volatile u32*)(base + visits);
+        ctx->leaf_slot = (u32*)(base + leaf_slot);
+        ctx->leaf_parent = (u32*)(base + leaf_parent);
+        ctx->rotation_roots = (u32*)(base + rotation_roots);
+    }
+    return cursor;
+}
+
+// grows the tree arrays and the scratch block, contents are not preserved
+static void builder_reserve(lbvh_builder_state* state, u32 prim_count) {
+    if (prim_count <= state->capacity) {
+        return;
+    }
+    if (state->capacity) {
+        memory_free_aligned(state->tree.nodes);
+        memory_free(state->tree.prim_indices);
+        memory_free_aligned(state->scratch);
+    }
+    state->capacity = prim_count;
+    state->tree.nodes = (bvh_node*)memory_allocate_aligned(sizeof(bvh_node) * (2 * (u64)prim_count - 1), 64);
+    state->tree.prim_indices = (u32*)memory_allocate(sizeof(u32) * prim_count);
+    state->scratch = (u8*)memory_allocate_aligned(scratch_layout(0, 0, prim_count), 64);
+}
+
+void lbvh_builder_create(lbvh_builder* builder) {
+    lbvh_builder_state* state = (lbvh_builder_state*)memory_allocate(sizeof(lbvh_builder_state));
+    state->tree = (bvh){0};
+    state->capacity = 0;
+    state->scratch = 0;
+    builder->internal_data = state;
+}
+
+void lbvh_builder_destroy(lbvh_builder* builder) {
+    lbvh_builder_state* state = (lbvh_builder_state*)builder->internal_data;
+    if (state->capacity) {
+        memory_free_aligned(state->tree.nodes);
+        memory_free(state->tree.prim_indices);
+        memory_free_aligned(state->scratch);
+    }
+    memory_free(state);
+    builder->internal_data = 0;
+}
+
+const bvh* lbvh_builder_build(lbvh_builder* builder,
+                              const bounds3* prim_bounds,
+                              u32 prim_count,
+                              const lbvh_build_options* options,
+                              zpool* pool) {
+    clock clk;
+    clock_set(&clk);
+    lbvh_builder_state* state = (lbvh_builder_state*)builder->internal_data;
+    lbvh_build_options defaults;
+    if (!options) {
+        lbvh_build_options_default(&defaults);
+        options = &defaults;
+    }
+    ASSERT(options->morton_bits == 30 || options->morton_bits == 63);
+
+    bvh* out = &state->tree;
+    out->prim_count = prim_count;
+    out->node_count = 0;
+    out->stats = (bvh_build_stats){0};
+    if (prim_count == 0) {
+        return out;
+    }
+    builder_reserve(state, prim_count);
+    out->node_count = 2 * prim_count - 1;
+
+    lbvh_context ctx;
+    scratch_layout(&ctx, state->scratch, prim_count);
+    ctx.prim_bounds = prim_bounds;
+    ctx.prim_count = prim_count;
+    ctx.morton_bits = options->morton_bits;
+    ctx.packed = options->morton_bits == 30;
+    ctx.key_shift = ctx.packed ? 32 : 0;
+    ctx.nodes = out->nodes;
+    ctx.prim_indices = out->prim_indices;
+    ctx.internal_slot[0] = 0;
+    ctx.leaf_slot[0] = 0;
+
+    zpool_parallel_for(pool, ctx.chunk_count, 1, centroid_bounds_task, &ctx);
+    bounds3 grid = bounds3_empty();
+    for (u32 c = 0; c < ctx.chunk_count; ++c) {
+        grid = bounds3_union(grid, ctx.chunk_bounds[c]);
+    }
+    f32 cells = options->morton_bits == 30 ? 1024.0f : 2097152.0f;
+    for (u32 k = 0; k < 3; ++k) {
+        f32 extent = grid.max.e[k] - grid.min.e[k];
+        ctx.grid_min[k] = grid.min.e[k];
+        ctx.grid_scale[k] = extent > 0 ? cells / extent : 0;
+    }
+    zpool_parallel_for(pool, ctx.chunk_count, 1, morton_task, &ctx);
+    radix_sort(&ctx, pool);
+
+    zpool_parallel_for(pool, prim_count - 1, 0, emit_task, &ctx);
+    zpool_parallel_for(pool, ctx.chunk_count, 1, bounds_task, &ctx);
+
+    for (u32 pass = 0; pass < options->rotation_passes; ++pass) {
+        u32 root_count = 0;
+        collect_rotation_roots(&ctx, 0, 0, &root_count);
+        zpool_parallel_for(pool, root_count, 1, rotation_task, &ctx);
+        rotate_top(ctx.nodes, 0, 0);
+    }
+
+    clock_update(&clk);
+    out->stats.build_seconds = clk.elapsed;
+    bvh_compute_stats(out, options->traversal_cost, options->intersect_cost);
+    return out;
+}
+
+void lbvh_build(bvh* out, const bounds3* prim_bounds, u32 prim_count, const lbvh_build_options* options, zpool* pool) {
+    lbvh_builder builder;
+    lbvh_builder_create(&builder);
+    *out = *lbvh_builder_build(&builder, prim_bounds, prim_count, options, pool);
+    // the tree arrays move to out, bvh_destroy releases them
+    lbvh_builder_state* state = (lbvh_builder_state*)builder.internal_data;
+    if (state->capacity) {
+        memory_free_aligned(state->scratch);
+        state->capacity = 0;
+    } else {
+        out->nodes = 0;
+        out->prim_indices = 0;
+    }
+    lbvh_builder_destroy(&builder);
+}
+
+typedef struct triangle_bounds_job {
+    const point3* positions;
+    const u32* indices;
+    bounds3* bounds;
+} triangle_bounds_job;
+
+static void triangle_bounds_task(void* params, u64 index, u32 thread_index) {
+    triangle_bounds_job* job = (triangle_bounds_job*)params;
+    const u32* tri = job->indices + index * 3;
+    bounds3 b = bounds3_make(job->positions[tri[0]], job->positions[tri[1]]);
+    job->bounds[index] = bounds3_union_point(b, job->positions[tri[2]]);
+}
+
+void lbvh_build_triangles(bvh* out,
+                          const point3* positions,
+                          const u32* indices,
+                          u32 triangle_count,
+                          const lbvh_build_options* options,
+                          zpool* pool) {
+    clock clk;
+    clock_set(&clk);
+    bounds3* bounds = (bounds3*)memory_allocate(sizeof(bounds3) * (triangle_count ? triangle_count : 1));
+    triangle_bounds_job job = {positions, indices, bounds};
+    zpool_parallel_for(pool, triangle_count, 4096, triangle_bounds_task, &job);
+    clock_update(&clk);
+
+    lbvh_build(out, bounds, triangle_count, options, pool);
+    out->stats.build_seconds += clk.elapsed;
+    memory_free(bounds);
+}
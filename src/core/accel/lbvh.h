@@ -0,0 +1,65 @@
+#ifndef LBVH__H
+#define LBVH__H
+
+#include "defines.h"
+#include "bvh.h"
+
+/***
+ *    ██      ██████  ██    ██ ██   ██
+ *    ██      ██   ██ ██    ██ ██   ██
+ *    ██      ██████  ██    ██ ███████
+ *    ██      ██   ██  ██  ██  ██   ██
+ *    ███████ ██████    ████   ██   ██
+ *
+ *
+ */
+
+// linear bvh for per frame rebuilds: primitives are sorted along a morton curve over their
+// centroids and the hierarchy is read off the sorted codes (karras 2012), every step runs
+// on the pool. the result is a regular bvh with one primitive per leaf, so it works with
+// bvh_intersect_triangles and bvh8_build unchanged
+
+typedef struct lbvh_build_options {
+    // 30 (10 bits per axis, 4 sort passes) or 63 (21 bits per axis, 8 sort passes)
+    u32 morton_bits;
+    // passes of sah driven tree rotations after the build (kensler 2008), 0 disables them.
+    // each pass is linear in the node count and usually buys most of its gain in the first
+    u32 rotation_passes;
+    // only used to report the sah cost in the stats
+    f32 traversal_cost;
+    f32 intersect_cost;
+} lbvh_build_options;
+
+// 30 bit codes, no rotations, the bvh_build costs
+void lbvh_build_options_default(lbvh_build_options* options);
+
+// keeps the tree and the scratch memory between builds, so rebuilding every frame neither
+// allocates nor faults in fresh pages once the primitive count stops growing
+typedef struct lbvh_builder {
+    void* internal_data;
+} lbvh_builder;
+
+void lbvh_builder_create(lbvh_builder* builder);
+
+void lbvh_builder_destroy(lbvh_builder* builder);
+
+// the returned tree belongs to the builder and is valid until the next build or destroy.
+// options may be null for the defaults and pool may be null to build on the calling thread
+const bvh* lbvh_builder_build(lbvh_builder* builder,
+                              const bounds3* prim_bounds,
+                              u32 prim_count,
+                              const lbvh_build_options* options,
+                              zpool* pool);
+
+// one shot build into out, release it with bvh_destroy
+void lbvh_build(bvh* out, const bounds3* prim_bounds, u32 prim_count, const lbvh_build_options* options, zpool* pool);
+
+// builds over indexed triangles, primitive i is the triangle indices[3i], [3i+1], [3i+2]
+void lbvh_build_triangles(bvh* out,
+                          const point3* positions,
+                          const u32* indices,
+                          u32 triangle_count,
+                          const lbvh_build_options* options,
+                          zpool* pool);
+
+#endif
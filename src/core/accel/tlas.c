@@ -0,0 +1,133 @@
+#include "tlas.h"
+#include "logger.h"
+#include "memory.h"
+
+// ============================================================================
+// INSTANCES
+// ============================================================================
+
+static void instance_bounds_task(void* params, u64 index, u32 thread_index) {
+    tlas* t = (tlas*)params;
+    const tlas_instance* instance = &t->instances[index];
+    const bvh* tree = t->geometries[instance->geometry].tree;
+    if (tree->node_count == 0) {
+        // never hit, a degenerate box at the instance origin keeps the top level valid
+        point3 origin = transform_point(&instance->object_to_world, vec3_zero());
+        t->instance_bounds[index] = bounds3_make(origin, origin);
+        return;
+    }
+    bounds3 object_bounds = bvh_node_bounds(&tree->nodes[0]);
+    t->instance_bounds[index] = bounds3_transform(&instance->object_to_world, &object_bounds);
+}
+
+FORCE_INLINE ray object_ray(const tlas_instance* instance, const ray* r) {
+    const mat4* world_to_object = &instance->object_to_world.m_inv;
+    f32 w;
+    point3 o = mat4_apply(world_to_object, r->o, 1.0f, &w);
+    ray result = ray_make(w == 1.0f ? o : vec3_scale(o, 1.0f / w), mat4_apply(world_to_object, r->d, 0.0f, NULL));
+    result.time = r->time;
+    return result;
+}
+
+// ============================================================================
+// PUBLIC
+// ============================================================================
+
+void tlas_build(tlas* out,
+                const tlas_geometry* geometries,
+                u32 geometry_count,
+                const tlas_instance* instances,
+                u32 instance_count,
+                zpool* pool) {
+    out->geometries = geometries;
+    out->geometry_count = geometry_count;
+    out->instance_count = instance_count;
+    out->instances = 0;
+    out->instance_bounds = 0;
+    if (instance_count) {
+        out->instances = (tlas_instance*)memory_allocate(sizeof(tlas_instance) * instance_count);
+        out->instance_bounds = (bounds3*)memory_allocate(sizeof(bounds3) * instance_count);
+    }
+    for (u32 i = 0; i < instance_count; ++i) {
+        ASSERT(instances[i].geometry < geometry_count);
+        out->instances[i] = instances[i];
+    }
+    zpool_parallel_for(pool, instance_count, 0, instance_bounds_task, out);
+    // instances are expensive to test, so every one gets its own leaf
+    bvh_build_options options;
+    bvh_build_options_default(&options);
+    options.max_leaf_size = 1;
+    bvh_build(&out->tree, out->instance_bounds, instance_count, &options, pool);
+}
+
+void tlas_destroy(tlas* t) {
+    bvh_destroy(&t->tree);
+    if (t->instances) {
+        memory_free(t->instances);
+        memory_free(t->instance_bounds);
+    }
+    t->instances = 0;
+    t->instance_bounds = 0;
+    t->instance_count = 0;
+}
+
+void tlas_set_transform(tlas* t, u32 instance, const transform* object_to_world) {
+    ASSERT(instance < t->instance_count);
+    t->instances[instance].object_to_world = *object_to_world;
+}
+
+void tlas_refit(tlas* t, zpool* pool) {
+    zpool_parallel_for(pool, t->instance_count, 0, instance_bounds_task, t);
+    bvh_refit(&t->tree, t->instance_bounds);
+}
+
+// ============================================================================
+// TRAVERSAL
+// ============================================================================
+
+#define TLAS_STACK_SIZE 128
+
+bool tlas_intersect(const tlas* t, const ray* r, f32 t_max, tlas_hit* hit) {
+    const bvh* top = &t->tree;
+    if (top->node_count == 0) {
+        return FALSE;
+    }
+    vec3 inv_dir = vec3_div(vec3_splat(1), r->d);
+    bool dir_negative[3] = {r->d.x < 0, r->d.y < 0, r->d.z < 0};
+    u32 stack[TLAS_STACK_SIZE];
+    u32 top_index = 0;
+    u32 node_index = 0;
+    bool found = FALSE;
+    while (TRUE) {
+        const bvh_node* node = &top->nodes[node_index];
+        bounds3 nb = bvh_node_bounds(node);
+        if (bounds3_intersect(&nb, r, inv_dir, t_max, 0, 0)) {
+            if (node->prim_count == 0) {
+                ASSERT(top_index < TLAS_STACK_SIZE);
+                u32 near = dir_negative[node->axis] ? node->offset + 1 : node->offset;
+                stack[top_index++] = near == node->offset ? node->offset + 1 : node->offset;
+                node_index = near;
+                continue;
+            }
+            for (u32 i = 0; i < node->prim_count; ++i) {
+                u32 instance_index = top->prim_indices[node->offset + i];
+                const tlas_instance* instance = &t->instances[instance_index];
+                const tlas_geometry* geometry = &t->geometries[instance->geometry];
+                ray local = object_ray(instance, r);
+                bvh_hit bottom_hit;
+                if (bvh_intersect_triangles(geometry->tree, geometry->positions, geometry->indices, &local, t_max, &bottom_hit)) {
+                    t_max = bottom_hit.triangle.t;
+                    hit->triangle = bottom_hit.triangle;
+                    hit->instance = instance_index;
+                    hit->prim_id = bottom_hit.prim_id;
+                    found = TRUE;
+                }
+            }
+        }
+        if (top_index == 0) {
+            break;
+        }
+        node_index = stack[--top_index];
+    }
+    return found;
+}
@@ -0,0 +1,72 @@
+#ifndef TLAS__H
+#define TLAS__H
+
+#include "defines.h"
+#include "transform.h"
+#include "bvh.h"
+
+/***
+ *    ████████ ██       █████  ███████
+ *       ██    ██      ██   ██ ██
+ *       ██    ██      ███████ ███████
+ *       ██    ██      ██   ██      ██
+ *       ██    ███████ ██   ██ ███████
+ *
+ *
+ */
+
+// two level acceleration structure: a bvh over instances, each pointing at a shared bottom
+// level mesh through its own transform. memory grows with the unique geometry, and moving
+// instances only needs tlas_refit instead of touching any mesh
+
+// a mesh and a bvh over it in object space, owned by the caller and shared by any number
+// of instances. it has to outlive every tlas that references it
+typedef struct tlas_geometry {
+    const bvh* tree;
+    const point3* positions;
+    const u32* indices;
+} tlas_geometry;
+
+typedef struct tlas_instance {
+    transform object_to_world;
+    u32 geometry;
+} tlas_instance;
+
+typedef struct tlas {
+    // built over instance_bounds, primitive i is instance i
+    bvh tree;
+    const tlas_geometry* geometries;
+    u32 geometry_count;
+    tlas_instance* instances;
+    // world space bounds of every instance
+    bounds3* instance_bounds;
+    u32 instance_count;
+} tlas;
+
+typedef struct tlas_hit {
+    triangle_hit triangle;
+    u32 instance;
+    u32 prim_id;
+} tlas_hit;
+
+// copies the instances, geometries are referenced. pool may be null
+void tlas_build(tlas* out,
+                const tlas_geometry* geometries,
+                u32 geometry_count,
+                const tlas_instance* instances,
+                u32 instance_count,
+                zpool* pool);
+
+void tlas_destroy(tlas* t);
+
+// replaces the transform of one instance, the top level is stale until tlas_refit
+void tlas_set_transform(tlas* t, u32 instance, const transform* object_to_world);
+
+// recomputes the instance bounds and refits the top level bvh, linear in the instance count
+void tlas_refit(tlas* t, zpool* pool);
+
+// closest hit of r in (0, t_max). the ray is taken into object space per instance without
+// renormalizing its direction, so hit distances are world space distances along r
+bool tlas_intersect(const tlas* t, const ray* r, f32 t_max, tlas_hit* hit);
+
+#endif
@@ -0,0 +1,237 @@
+#include "flight_recorder.h"
+#include <stdio.h>
+#include "logger.h"
+#include "memory.h"
+#include "platform.h"
+#include "zatomic.h"
+#include "zthread.h"
+
+typedef struct flight_event {
+    f64 time;
+    const char* zone;
+    flight_event_type type;
+    char message[FLIGHT_RECORDER_MESSAGE_SIZE];
+} flight_event;
+
+typedef struct flight_ring {
+    u64 thread_id;
+    // TRUE while a live thread records into the ring, the events stay for the dump once it exits
+    volatile u32 owned;
+    // total events written, the slot of the next event is head % FLIGHT_RECORDER_EVENTS
+    volatile u64 head;
+    flight_event events[FLIGHT_RECORDER_EVENTS];
+} flight_ring;
+
+// static storage so recording never allocates and the rings survive any heap corruption
+static flight_ring rings[FLIGHT_RECORDER_MAX_THREADS];
+// rings ever claimed, the lowest free ring is claimed first so they stay at the front
+static volatile u32 ring_count;
+static __thread flight_ring* current_ring;
+// set when every ring was owned as the thread started recording
+static __thread bool recording_dropped;
+static bool active;
+static f64 start_time;
+static char dump_prefix[200];
+
+// the ring of the calling thread, 0 when all of them belong to live threads. sharing a ring
+// would interleave two threads' events in one history, so such threads are not recorded
+static flight_ring* get_ring() {
+    if (current_ring == 0 && !recording_dropped) {
+        for (u32 i = 0; i < FLIGHT_RECORDER_MAX_THREADS; ++i) {
+            if (!zatomic_cas_u32(&rings[i].owned, FALSE, TRUE)) {
+                continue;
+            }
+            rings[i].thread_id = platform_thread_id();
+            zatomic_store_u64(&rings[i].head, 0);
+            u32 count = zatomic_load_u32(&ring_count);
+            while (count < i + 1 && !zatomic_cas_u32(&ring_count, count, i + 1)) {
+                count = zatomic_load_u32(&ring_count);
+            }
+            current_ring = &rings[i];
+            return current_ring;
+        }
+        recording_dropped = TRUE;
+    }
+    return current_ring;
+}
+
+// hands the ring of an exiting zthread back for the next thread
+static void release_ring() {
+    if (current_ring) {
+        zatomic_store_u32(&current_ring->owned, FALSE);
+        current_ring = 0;
+    }
+}
+
+// 0 when the thread is not recorded
+static flight_event* next_event(flight_event_type type) {
+    flight_ring* ring = get_ring();
+    if (!ring) {
+        return 0;
+    }
+    u64 slot = zatomic_add_u64(&ring->head, 1) & (FLIGHT_RECORDER_EVENTS - 1);
+    flight_event* event = &ring->events[slot];
+    event->time = platform_time();
+    event->type = type;
+    event->zone = 0;
+    event->message[0] = 0;
+    return event;
+}
+
+// runs inside the signal handler: the logger would record into the rings being dumped and
+// take the stdio lock, which the crashing thread may hold
+static void on_crash(const char* reason) {
+    char path[256];
+    log_buffer(path, sizeof(path), "%s_%u.txt", dump_prefix, platform_process_id());
+    if (flight_recorder_dump(path, reason)) {
+        char message[512];
+        u32 length = log_buffer(message, sizeof(message), "\033[31mcrash: %s, report written to %s\033[0m\n", reason, path);
+        platform_file stderr_file;
+        platform_file_stderr(&stderr_file);
+        platform_file_write(&stderr_file, message, length < sizeof(message) ? length : sizeof(message) - 1);
+    }
+}
+
+void flight_recorder_init(const char* prefix) {
+    ASSERT(prefix);
+    log_buffer(dump_prefix, sizeof(dump_prefix), "%s", prefix);
+    start_time = platform_time();
+    active = TRUE;
+    zthread_exit_callback_set(release_ring);
+    platform_crash_handler_install(on_crash);
+    LOGT("flight_recorder_init");
+}
+
+void flight_recorder_shutdown() {
+    platform_crash_handler_uninstall();
+    active = FALSE;
+    LOGT("flight_recorder_shutdown");
+}
+
+void flight_recorder_log(const char* msg_fmt, va_list args) {
+    if (!active) {
+        return;
+    }
+    flight_event* event = next_event(FLIGHT_EVENT_LOG);
+    if (!event) {
+        return;
+    }
+    char buffer[FLIGHT_RECORDER_MESSAGE_SIZE * 2];
+    vsnprintf(buffer, sizeof(buffer), msg_fmt, args);
+    // drop the color escape sequences and the trailing newline
+    u32 length = 0;
+    for (const char* c = buffer; *c && length < FLIGHT_RECORDER_MESSAGE_SIZE - 1; ++c) {
+        if (*c == '\033') {
+            while (*c && *c != 'm') {
+                c++;
+            }
+            if (!*c) {
+                break;
+            }
+        } else if (*c != '\n') {
+            event->message[length++] = *c;
+        }
+    }
+    event->message[length] = 0;
+}
+
+void flight_recorder_zone_begin(const char* name) {
+    flight_event* event = active ? next_event(FLIGHT_EVENT_ZONE_BEGIN) : 0;
+    if (event) {
+        event->zone = name;
+    }
+}
+
+void flight_recorder_zone_end(const char* name) {
+    flight_event* event = active ? next_event(FLIGHT_EVENT_ZONE_END) : 0;
+    if (event) {
+        event->zone = name;
+    }
+}
+
+//    ██████  ██    ██ ███    ███ ██████
+//    ██   ██ ██    ██ ████  ████ ██   ██
+//    ██   ██ ██    ██ ██ ████ ██ ██████
+//    ██   ██ ██    ██ ██  ██  ██ ██
+//    ██████   ██████  ██      ██ ██
+//
+//
+
+// the dump runs inside a signal handler, so it formats into stack buffers and writes
+// straight to the file without stdio or the heap
+
+static void dump_line(platform_file* file, const char* msg_fmt, ...) {
+    char line[FLIGHT_RECORDER_MESSAGE_SIZE + 128];
+    va_list args;
+    va_start(args, msg_fmt);
+    i32 length = vsnprintf(line, sizeof(line), msg_fmt, args);
+    va_end(args);
+    if (length > 0) {
+        platform_file_write(file, line, (u64)length < sizeof(line) ? (u64)length : sizeof(line) - 1);
+    }
+}
+
+static void dump_ring(platform_file* file, u32 index, flight_ring* ring) {
+    u64 head = ring->head;
+    u64 count = head < FLIGHT_RECORDER_EVENTS ? head : FLIGHT_RECORDER_EVENTS;
+    dump_line(file, "\n-- thread %u (tid %llu%s), last %llu of %llu events --\n", index, ring->thread_id,
+              ring->owned ? "" : ", exited", count, head);
+    // zones begun but not ended within the recorded window are what the thread was doing
+    const char* open_zone = 0;
+    for (u64 i = head - count; i < head; ++i) {
+        flight_event* event = &ring->events[i & (FLIGHT_RECORDER_EVENTS - 1)];
+        f64 time = event->time - start_time;
+        switch (event->type) {
+        case FLIGHT_EVENT_LOG:
+            dump_line(file, "%12.6f  log    %s\n", time, event->message);
+            break;
+        case FLIGHT_EVENT_ZONE_BEGIN:
+            dump_line(file, "%12.6f  begin  %s\n", time, event->zone);
+            open_zone = event->zone;
+            break;
+        case FLIGHT_EVENT_ZONE_END:
+            dump_line(file, "%12.6f  end    %s\n", time, event->zone);
+            open_zone = 0;
+            break;
+        }
+    }
+    if (open_zone) {
+        dump_line(file, "inside zone: %s\n", open_zone);
+    }
+}
+
+bool flight_recorder_dump(const char* path, const char* reason) {
+    platform_file file;
+    if (!platform_file_open(path, PLATFORM_FILE_WRITE, &file)) {
+        return FALSE;
+    }
+    u64 self = platform_thread_id();
+    dump_line(&file, "pbrt flight recorder\nreason: %s\npid: %u\nthread: %llu\nuptime: %.6f secs\n", reason,
+              platform_process_id(), self, platform_time() - start_time);
+
+    memory_stats stats;
+    memory_peek_stats(&stats);
+    dump_line(&file, "\n-- memory --\nallocated: %llu bytes\npeak: %llu bytes\ntotal allocated: %llu bytes\n",
+              stats.allocated_memory, stats.peak_memory, stats.total_allocated);
+    dump_line(&file, "allocations: %llu\nreallocations: %llu\nfrees: %llu\npeak rss: %llu bytes\n", stats.allocation_count,
+              stats.reallocation_count, stats.free_count, platform_peak_memory_usage());
+
+    u32 count = ring_count;
+    for (u32 i = 0; i < count; ++i) {
+        dump_ring(&file, i, &rings[i]);
+    }
+
+    dump_line(&file, "\n-- backtrace of thread %llu --\n", self);
+    platform_backtrace_write(&file);
+    for (u32 i = 0; i < count; ++i) {
+        if (rings[i].thread_id == self || !rings[i].owned) {
+            continue;
+        }
+        dump_line(&file, "\n-- backtrace of thread %u (tid %llu) --\n", i, rings[i].thread_id);
+        if (!platform_thread_backtrace_write(rings[i].thread_id, &file, 0.1)) {
+            dump_line(&file, "unavailable (thread exited or did not respond)\n");
+        }
+    }
+    platform_file_close(&file);
+    return TRUE;
+}
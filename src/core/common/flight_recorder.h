@@ -0,0 +1,50 @@
+#ifndef FLIGHT_RECORDER__H
+#define FLIGHT_RECORDER__H
+
+#include "defines.h"
+#include <stdarg.h>
+
+//    ███████ ██      ██  ██████  ██   ██ ████████     ██████  ███████  ██████  ██████  ██████  ██████  ███████ ██████
+//    ██      ██      ██ ██       ██   ██    ██        ██   ██ ██      ██      ██    ██ ██   ██ ██   ██ ██      ██   ██
+//    █████   ██      ██ ██   ███ ███████    ██        ██████  █████   ██      ██    ██ ██████  ██   ██ █████   ██████
+//    ██      ██      ██ ██    ██ ██   ██    ██        ██   ██ ██      ██      ██    ██ ██   ██ ██   ██ ██      ██   ██
+//    ██      ███████ ██  ██████  ██   ██    ██        ██   ██ ███████  ██████  ██████  ██   ██ ██████  ███████ ██   ██
+//
+//
+
+/**
+ * every thread records its recent log lines and zone begin/end events into its own ring.
+ * when the process crashes the rings, the memory tracker counters and the backtraces of
+ * all recorded threads are written to <dump_prefix>_<pid>.txt
+ */
+
+// rings of zthreads are reused once the thread exits. a thread that starts while all of them
+// belong to live threads is not recorded
+#define FLIGHT_RECORDER_MAX_THREADS 128
+// events kept per thread, must be a power of two
+#define FLIGHT_RECORDER_EVENTS 256
+#define FLIGHT_RECORDER_MESSAGE_SIZE 104
+
+typedef enum flight_event_type {
+    FLIGHT_EVENT_LOG,
+    FLIGHT_EVENT_ZONE_BEGIN,
+    FLIGHT_EVENT_ZONE_END,
+} flight_event_type;
+
+// starts recording and installs the crash handler
+void flight_recorder_init(const char* dump_prefix);
+
+void flight_recorder_shutdown();
+
+// records a formatted log line, called by the logger for every message
+void flight_recorder_log(const char* msg_fmt, va_list args);
+
+// zone names are stored by pointer and must outlive the recorder (string literals)
+void flight_recorder_zone_begin(const char* name);
+
+void flight_recorder_zone_end(const char* name);
+
+// writes everything recorded so far to path, returns FALSE when the file cannot be created
+bool flight_recorder_dump(const char* path, const char* reason);
+
+#endif
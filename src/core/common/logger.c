@@ -1,6 +1,7 @@
 #include "logger.h"
 #include <stdio.h>
 #include <stdarg.h>
+#include "flight_recorder.h"
 
 STATIC_ASSERT(sizeof(i8) == 1);
 STATIC_ASSERT(sizeof(i16) == 2);
@@ -18,6 +19,10 @@ STATIC_ASSERT(sizeof(f64) == 8);
 void log_stdout(const char* msg_fmt, ...) {
     va_list args;
     va_start(args, msg_fmt);
+    va_list record_args;
+    va_copy(record_args, args);
+    flight_recorder_log(msg_fmt, record_args);
+    va_end(record_args);
     vfprintf(stdout, msg_fmt, args);
     va_end(args);
 }
@@ -25,6 +30,10 @@ void log_stdout(const char* msg_fmt, ...) {
 void log_stderr(const char* msg_fmt, ...) {
     va_list args;
     va_start(args, msg_fmt);
+    va_list record_args;
+    va_copy(record_args, args);
+    flight_recorder_log(msg_fmt, record_args);
+    va_end(record_args);
     vfprintf(stderr, msg_fmt, args);
     va_end(args);
 }
@@ -0,0 +1,112 @@
+#include "arena.h"
+#include "logger.h"
+#include "memory.h"
+
+#define ARENA_BLOCK_ALIGNMENT 64
+
+typedef struct arena_block {
+    struct arena_block* next;
+    u64 size;
+    u64 used;
+    u8* data;
+} arena_block;
+
+typedef struct arena_state {
+    arena_block* first;
+    // the block allocations are served from, blocks before it are full
+    arena_block* current;
+    u64 block_size;
+    u64 bytes_used;
+    u64 bytes_reserved;
+} arena_state;
+
+static arena_block* arena_block_create(u64 size) {
+    // header and data share one allocation, the data starts on the next 64 byte boundary
+    u64 header = (sizeof(arena_block) + ARENA_BLOCK_ALIGNMENT - 1) & ~(u64)(ARENA_BLOCK_ALIGNMENT - 1);
+    if (size > ~0ull - header) {
+        LOGE("arena: a block of %llu bytes overflows", size);
+        DEBUG_BREAK;
+    }
+    u8* memory = (u8*)memory_allocate_aligned(header + size, ARENA_BLOCK_ALIGNMENT);
+    arena_block* block = (arena_block*)memory;
+    block->next = 0;
+    block->size = size;
+    block->used = 0;
+    block->data = memory + header;
+    return block;
+}
+
+void arena_create(arena* a, u64 block_size) {
+    ASSERT(block_size != 0);
+    arena_state* state = (arena_state*)memory_allocate(sizeof(arena_state));
+    state->first = 0;
+    state->current = 0;
+    state->block_size = block_size;
+    state->bytes_used = 0;
+    state->bytes_reserved = 0;
+    a->internal_data = state;
+}
+
+void arena_destroy(arena* a) {
+    ASSERT(a->internal_data != 0);
+    arena_state* state = (arena_state*)a->internal_data;
+    arena_block* block = state->first;
+    while (block) {
+        arena_block* next = block->next;
+        memory_free_aligned(block);
+        block = next;
+    }
+    memory_free(state);
+    a->internal_data = 0;
+}
+
+void* arena_allocate(arena* a, u64 size, u32 alignment) {
+    ASSERT(a->internal_data != 0);
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= ARENA_BLOCK_ALIGNMENT);
+    arena_state* state = (arena_state*)a->internal_data;
+    arena_block* block = state->current;
+    while (block) {
+        u64 offset = (block->used + alignment - 1) & ~(u64)(alignment - 1);
+        if (offset + size <= block->size) {
+            block->used = offset + size;
+            state->current = block;
+            state->bytes_used += size;
+            return block->data + offset;
+        }
+        // stop on the last block so the new one can be linked after it
+        if (!block->next) {
+            break;
+        }
+        block = block->next;
+    }
+
+    arena_block* fresh = arena_block_create(size > state->block_size ? size : state->block_size);
+    state->bytes_reserved += fresh->size;
+    if (block) {
+        block->next = fresh;
+    } else {
+        state->first = fresh;
+    }
+    state->current = fresh;
+    fresh->used = size;
+    state->bytes_used += size;
+    return fresh->data;
+}
+
+void arena_reset(arena* a) {
+    ASSERT(a->internal_data != 0);
+    arena_state* state = (arena_state*)a->internal_data;
+    for (arena_block* block = state->first; block; block = block->next) {
+        block->used = 0;
+    }
+    state->current = state->first;
+    state->bytes_used = 0;
+}
+
+u64 arena_bytes_used(const arena* a) {
+    return ((const arena_state*)a->internal_data)->bytes_used;
+}
+
+u64 arena_bytes_reserved(const arena* a) {
+    return ((const arena_state*)a->internal_data)->bytes_reserved;
+}
@@ -0,0 +1,41 @@
+#ifndef ARENA__H
+#define ARENA__H
+
+#include "defines.h"
+
+//     █████  ██████  ███████ ███    ██  █████
+//    ██   ██ ██   ██ ██      ████   ██ ██   ██
+//    ███████ ██████  █████   ██ ██  ██ ███████
+//    ██   ██ ██   ██ ██      ██  ██ ██ ██   ██
+//    ██   ██ ██   ██ ███████ ██   ████ ██   ██
+//
+//
+
+// bump allocator for short lived temporaries. blocks come from the tracked allocator
+// and are only released by arena_destroy, individual allocations are never freed.
+// an arena is not thread safe, give each thread its own
+typedef struct arena {
+    void* internal_data;
+} arena;
+
+// block_size is the size of each block requested from memory.h, larger allocations get a
+// dedicated block
+void arena_create(arena* a, u64 block_size);
+
+void arena_destroy(arena* a);
+
+// alignment must be a power of two no larger than 64, the memory is not cleared
+void* arena_allocate(arena* a, u64 size, u32 alignment);
+
+#define ARENA_ALLOCATE_ARRAY(a, type, count) ((type*)arena_allocate(a, sizeof(type) * (count), _Alignof(type)))
+
+// makes every block available again without returning them to memory.h
+void arena_reset(arena* a);
+
+// bytes handed out since creation or the last reset
+u64 arena_bytes_used(const arena* a);
+
+// bytes held in blocks
+u64 arena_bytes_reserved(const arena* a);
+
+#endif
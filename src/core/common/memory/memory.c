@@ -40,6 +40,11 @@ typedef struct memory_node {
 typedef struct memory_state {
     memory_node* root;
     u64 allocated_memory;
+    u64 total_allocated;
+    u64 peak_memory;
+    u64 allocation_count;
+    u64 reallocation_count;
+    u64 free_count;
     zmutex mutex;
 } memory_state;
 
@@ -59,6 +64,11 @@ void memory_init(bool auto_free_memory) {
     ptr_state = malloc(sizeof(memory_state));
     ptr_state->root = 0;
     ptr_state->allocated_memory = 0;
+    ptr_state->total_allocated = 0;
+    ptr_state->peak_memory = 0;
+    ptr_state->allocation_count = 0;
+    ptr_state->reallocation_count = 0;
+    ptr_state->free_count = 0;
     zmutex_create(&ptr_state->mutex);
     auto_free = auto_free_memory;
     LOGT("memory_init");
@@ -98,7 +108,7 @@ void memory_shutdown() {
     LOGT("memory_shutdown");
 }
 
-void* _memory_allocate(u32 size, const char* file, i32 line) {
+void* _memory_allocate(u64 size, const char* file, i32 line) {
     ASSERT(ptr_state != 0 && size != 0);
     zmutex_lock(&ptr_state->mutex);
     memory_node* node = memory_node_create(size, file, line);
@@ -126,8 +136,10 @@ void* _memory_allocate(u32 size, const char* file, i32 line) {
         }
         memory_node_insert_fixup(node);
     }
+    // read before unlocking, a concurrent free may swap the address into another node
+    void* addr = node->addr;
     zmutex_unlock(&ptr_state->mutex);
-    return node->addr;
+    return addr;
 }
 
 void memory_free(const void* addr) {
@@ -151,6 +163,7 @@ void memory_free(const void* addr) {
                     }
                 }
                 memory_node_destroy(root);
+                ptr_state->free_count += 1;
                 found = TRUE;
                 break;
             }
@@ -185,9 +198,31 @@ void memory_free(const void* addr) {
         }
     }
     ASSERT(found != FALSE);
+    (void)found;
     zmutex_unlock(&ptr_state->mutex);
 }
 
+// the tracked block is over allocated by alignment - 1 plus a pointer, the pointer right
+// before the aligned address remembers where the tracked block starts
+void* _memory_allocate_aligned(u64 size, u32 alignment, const char* file, i32 line) {
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    u64 padding = alignment - 1 + sizeof(void*);
+    // a wrapped sum would hand out a tiny block for a huge request, trap in release builds too
+    if (size > ~0ull - padding) {
+        LOGE("memory: %llu bytes aligned to %u overflow at %s:%i", size, alignment, file, line);
+        DEBUG_BREAK;
+    }
+    u8* base = (u8*)_memory_allocate(size + padding, file, line);
+    u64 aligned = ((u64)(base + sizeof(void*)) + alignment - 1) & ~((u64)alignment - 1);
+    ((void**)aligned)[-1] = base;
+    return (void*)aligned;
+}
+
+void memory_free_aligned(const void* addr) {
+    ASSERT(addr != 0);
+    memory_free(((void* const*)addr)[-1]);
+}
+
 void* memory_reallocate(const void* addr, u64 size) {
     ASSERT(ptr_state != 0 && size != 0);
     zmutex_lock(&ptr_state->mutex);
@@ -202,10 +237,16 @@ void* memory_reallocate(const void* addr, u64 size) {
         }
     }
     ASSERT(found != FALSE);
+    (void)found;
 
     void* realloc_addr = realloc(node->addr, size);
     ptr_state->allocated_memory -= node->size;
     ptr_state->allocated_memory += size;
+    ptr_state->total_allocated += size;
+    ptr_state->reallocation_count += 1;
+    if (ptr_state->allocated_memory > ptr_state->peak_memory) {
+        ptr_state->peak_memory = ptr_state->allocated_memory;
+    }
 
     if ((u64)node->addr != (u64)realloc_addr) {
         memory_node* realloc_node = malloc(sizeof(memory_node));
@@ -298,6 +339,43 @@ void* memory_reallocate(const void* addr, u64 size) {
     return realloc_addr;
 }
 
+void memory_get_stats(memory_stats* stats) {
+    ASSERT(ptr_state != 0 && stats != 0);
+    zmutex_lock(&ptr_state->mutex);
+    stats->allocated_memory = ptr_state->allocated_memory;
+    stats->total_allocated = ptr_state->total_allocated;
+    stats->peak_memory = ptr_state->peak_memory;
+    stats->allocation_count = ptr_state->allocation_count;
+    stats->reallocation_count = ptr_state->reallocation_count;
+    stats->free_count = ptr_state->free_count;
+    zmutex_unlock(&ptr_state->mutex);
+}
+
+void memory_peek_stats(memory_stats* stats) {
+    if (ptr_state == 0) {
+        stats->allocated_memory = 0;
+        stats->total_allocated = 0;
+        stats->peak_memory = 0;
+        stats->allocation_count = 0;
+        stats->reallocation_count = 0;
+        stats->free_count = 0;
+        return;
+    }
+    stats->allocated_memory = ptr_state->allocated_memory;
+    stats->total_allocated = ptr_state->total_allocated;
+    stats->peak_memory = ptr_state->peak_memory;
+    stats->allocation_count = ptr_state->allocation_count;
+    stats->reallocation_count = ptr_state->reallocation_count;
+    stats->free_count = ptr_state->free_count;
+}
+
+void memory_reset_peak() {
+    ASSERT(ptr_state != 0);
+    zmutex_lock(&ptr_state->mutex);
+    ptr_state->peak_memory = ptr_state->allocated_memory;
+    zmutex_unlock(&ptr_state->mutex);
+}
+
 //    ██   ██ ███████ ██      ██████  ███████ ██████  ███████
 //    ██   ██ ██      ██      ██   ██ ██      ██   ██ ██
 //    ███████ █████   ██      ██████  █████   ██████  ███████
@@ -317,6 +395,11 @@ memory_node* memory_node_create(u64 size, const char* file, i32 line) {
     node->left = 0;
     node->right = 0;
     ptr_state->allocated_memory += size;
+    ptr_state->total_allocated += size;
+    ptr_state->allocation_count += 1;
+    if (ptr_state->allocated_memory > ptr_state->peak_memory) {
+        ptr_state->peak_memory = ptr_state->allocated_memory;
+    }
     return node;
 }
 
@@ -4,18 +4,47 @@
 #include "defines.h"
 
 #define memory_allocate(size) _memory_allocate(size, __FILE__, __LINE__)
+#define memory_allocate_aligned(size, alignment) _memory_allocate_aligned(size, alignment, __FILE__, __LINE__)
 #define malloc(size) _memory_allocate(size, __FILE__, __LINE__)
 #define free(block) memory_free(block)
 #define realloc(block, size) memory_reallocate(block, size)
 
+typedef struct memory_stats {
+    // bytes currently owned by live allocations
+    u64 allocated_memory;
+    // bytes handed out by every allocation and reallocation since memory_init
+    u64 total_allocated;
+    // highest allocated_memory since memory_init or the last memory_reset_peak
+    u64 peak_memory;
+    u64 allocation_count;
+    u64 reallocation_count;
+    u64 free_count;
+} memory_stats;
+
 void memory_init(bool auto_free_memory);
 
 void memory_shutdown();
 
-void* _memory_allocate(u32 size, const char* file, i32 line);
+void* _memory_allocate(u64 size, const char* file, i32 line);
 
 void memory_free(const void* addr);
 
+// alignment must be a power of two, the block is tracked like any other allocation and
+// must be released with memory_free_aligned. traps when size plus the alignment padding
+// overflows
+void* _memory_allocate_aligned(u64 size, u32 alignment, const char* file, i32 line);
+
+void memory_free_aligned(const void* addr);
+
 void* memory_reallocate(const void* addr, u64 size);
 
+void memory_get_stats(memory_stats* stats);
+
+// reads the counters without taking the tracker lock, for crash handlers where the
+// crashing thread may already hold it. the values can be slightly inconsistent
+void memory_peek_stats(memory_stats* stats);
+
+// restarts peak tracking from the memory allocated right now
+void memory_reset_peak();
+
 #endif
\ No newline at end of file
@@ -7,4 +7,90 @@ f64 platform_time();
 
 u32 platform_processor_count();
 
+// resident set size of the process in bytes
+u64 platform_memory_usage();
+
+// highest resident set size the process reached in bytes
+u64 platform_peak_memory_usage();
+
+u32 platform_process_id();
+
+// operating system id of the calling thread
+u64 platform_thread_id();
+
+//    ███████ ██ ██      ███████
+//    ██      ██ ██      ██
+//    █████   ██ ██      █████
+//    ██      ██ ██      ██
+//    ██      ██ ███████ ███████
+//
+//
+
+typedef struct platform_file {
+    void* internal_data;
+} platform_file;
+
+typedef enum platform_file_mode {
+    PLATFORM_FILE_READ,
+    // creates the file or truncates an existing one
+    PLATFORM_FILE_WRITE,
+} platform_file_mode;
+
+bool platform_file_open(const char* path, platform_file_mode mode, platform_file* file);
+
+// the standard error stream, written without going through stdio so crash handlers can
+// report while another thread holds the stdio lock. must not be closed
+void platform_file_stderr(platform_file* file);
+
+void platform_file_close(platform_file* file);
+
+// returns the number of bytes written
+u64 platform_file_write(platform_file* file, const void* data, u64 size);
+
+// waits until everything written so far reached the disk
+bool platform_file_flush(platform_file* file);
+
+// renames from to to, replacing to when it exists. readers of to see the old or the new
+// file, never a mix of both
+bool platform_file_replace(const char* from, const char* to);
+
+// read only view of a whole file. data is page aligned, pages are faulted in on first touch
+// and shared with the page cache, so mapping the same file again costs no copy
+typedef struct platform_file_mapping {
+    const void* data;
+    u64 size;
+    void* internal_data;
+} platform_file_mapping;
+
+// FALSE when the file is missing, empty or cannot be mapped
+bool platform_file_map(const char* path, platform_file_mapping* mapping);
+
+void platform_file_unmap(platform_file_mapping* mapping);
+
+//     ██████ ██████   █████  ███████ ██   ██
+//    ██      ██   ██ ██   ██ ██      ██   ██
+//    ██      ██████  ███████ ███████ ███████
+//    ██      ██   ██ ██   ██      ██ ██   ██
+//     ██████ ██   ██ ██   ██ ███████ ██   ██
+//
+//
+
+// called on the crashing thread from inside the signal handler (exception filter on windows),
+// after it returns the default action runs and the process terminates. on linux the handler
+// runs on an alternate signal stack, so stack overflows are reported too, on the thread that
+// installed it and on every thread started with zthread_create
+typedef void (*platform_crash_callback)(const char* reason);
+
+void platform_crash_handler_install(platform_crash_callback callback);
+
+void platform_crash_handler_uninstall();
+
+// writes a backtrace of the calling thread to file
+void platform_backtrace_write(platform_file* file);
+
+// makes the thread with the given platform_thread_id write its backtrace to file, waiting at
+// most timeout seconds. returns FALSE when the thread is gone, did not answer or the platform
+// cannot sample other threads
+bool platform_thread_backtrace_write(u64 thread_id, platform_file* file, f64 timeout);
+
 #endif
\ No newline at end of file
@@ -4,11 +4,24 @@
 
 #    include "zmutex.h"
 #    include "zthread.h"
+#    include "zsemaphore.h"
 #    include <stdlib.h>
+#    include <semaphore.h>
+#    include <sched.h>
 #    include <sys/sysinfo.h> // For get_nprocs_conf
 #    include <pthread.h>
 #    include <time.h>
+#    include <unistd.h>
+#    include <stdio.h>
+#    include <sys/resource.h>
+#    include <sys/syscall.h>
+#    include <sys/stat.h>
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <signal.h>
+#    include <execinfo.h>
 #    include "logger.h"
+#    include "zatomic.h"
 
 // Make sure to link against the (-lrt) (real-time) library when compiling your program,
 // as the clock_gettime function is part of this library:
@@ -23,9 +36,246 @@ u32 platform_processor_count() {
     i32 processor_count = get_nprocs_conf();
     i32 processors_available = get_nprocs();
     LOGI("%i processor cores detected, %i cores available.", processor_count, processors_available);
+    (void)processor_count;
     return processors_available;
 }
 
+u64 platform_memory_usage() {
+    // second field of statm is the resident page count
+    u64 pages = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file) {
+        if (fscanf(file, "%*u %llu", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(file);
+    }
+    return pages * (u64)sysconf(_SC_PAGESIZE);
+}
+
+u64 platform_peak_memory_usage() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is reported in kilobytes on linux
+    return (u64)usage.ru_maxrss * 1024;
+}
+
+u32 platform_process_id() {
+    return (u32)getpid();
+}
+
+u64 platform_thread_id() {
+    return (u64)syscall(SYS_gettid);
+}
+
+//    ███████ ██ ██      ███████
+//    ██      ██ ██      ██
+//    █████   ██ ██      █████
+//    ██      ██ ██      ██
+//    ██      ██ ███████ ███████
+//
+//
+
+// the file descriptor is stored directly in internal_data
+
+bool platform_file_open(const char* path, platform_file_mode mode, platform_file* file) {
+    ASSERT(path && file);
+    i32 fd = mode == PLATFORM_FILE_WRITE ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (fd < 0) {
+        return FALSE;
+    }
+    file->internal_data = (void*)(i64)fd;
+    return TRUE;
+}
+
+void platform_file_stderr(platform_file* file) {
+    file->internal_data = (void*)(i64)STDERR_FILENO;
+}
+
+void platform_file_close(platform_file* file) {
+    ASSERT(file);
+    close((i32)(i64)file->internal_data);
+}
+
+u64 platform_file_write(platform_file* file, const void* data, u64 size) {
+    ASSERT(file && (data || size == 0));
+    u64 written = 0;
+    while (written < size) {
+        ssize_t result = write((i32)(i64)file->internal_data, (const u8*)data + written, size - written);
+        if (result <= 0) {
+            break;
+        }
+        written += (u64)result;
+    }
+    return written;
+}
+
+bool platform_file_flush(platform_file* file) {
+    ASSERT(file);
+    return fsync((i32)(i64)file->internal_data) == 0;
+}
+
+bool platform_file_replace(const char* from, const char* to) {
+    ASSERT(from && to);
+    return rename(from, to) == 0;
+}
+
+bool platform_file_map(const char* path, platform_file_mapping* mapping) {
+    ASSERT(path && mapping);
+    i32 fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return FALSE;
+    }
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        data = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (data == MAP_FAILED) {
+        return FALSE;
+    }
+    mapping->data = data;
+    mapping->size = (u64)info.st_size;
+    mapping->internal_data = 0;
+    return TRUE;
+}
+
+void platform_file_unmap(platform_file_mapping* mapping) {
+    ASSERT(mapping);
+    if (mapping->data) {
+        munmap((void*)mapping->data, (size_t)mapping->size);
+    }
+    mapping->data = 0;
+    mapping->size = 0;
+}
+
+//     ██████ ██████   █████  ███████ ██   ██
+//    ██      ██   ██ ██   ██ ██      ██   ██
+//    ██      ██████  ███████ ███████ ███████
+//    ██      ██   ██ ██   ██      ██ ██   ██
+//     ██████ ██   ██ ██   ██ ███████ ██   ██
+//
+//
+
+#    define CRASH_STACK_SIZE (64 * 1024)
+#    define MAX_BACKTRACE_FRAMES 64
+// other threads are asked for their backtrace with this signal
+#    define BACKTRACE_SIGNAL SIGUSR2
+
+static const i32 crash_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTRAP};
+static platform_crash_callback crash_callback;
+static u8 crash_stack[CRASH_STACK_SIZE];
+static volatile u32 crashing;
+// target of the backtrace requested from another thread
+static platform_file* volatile backtrace_file;
+static volatile u32 backtrace_done;
+
+static const char* signal_name(i32 signal) {
+    switch (signal) {
+    case SIGSEGV:
+        return "SIGSEGV (segmentation fault)";
+    case SIGBUS:
+        return "SIGBUS (bus error)";
+    case SIGILL:
+        return "SIGILL (illegal instruction, ASSERT traps land here)";
+    case SIGFPE:
+        return "SIGFPE (arithmetic exception)";
+    case SIGABRT:
+        return "SIGABRT (abort)";
+    case SIGTRAP:
+        return "SIGTRAP (trap)";
+    }
+    return "unknown signal";
+}
+
+static void crash_signal_handler(i32 signal) {
+    // only the first crashing thread reports, others wait for the process to die
+    if (zatomic_cas_u32(&crashing, FALSE, TRUE)) {
+        if (crash_callback) {
+            crash_callback(signal_name(signal));
+        }
+        platform_crash_handler_uninstall();
+        raise(signal);
+        return;
+    }
+    while (TRUE) {
+        pause();
+    }
+}
+
+static void backtrace_signal_handler(i32 signal) {
+    platform_file* file = backtrace_file;
+    if (file) {
+        platform_backtrace_write(file);
+    }
+    zatomic_store_u32(&backtrace_done, TRUE);
+}
+
+void platform_crash_handler_install(platform_crash_callback callback) {
+    crash_callback = callback;
+
+    // run on a separate stack so stack overflows can still be reported, zthreads set up
+    // their own in zthread_main
+    stack_t stack;
+    stack.ss_sp = crash_stack;
+    stack.ss_size = CRASH_STACK_SIZE;
+    stack.ss_flags = 0;
+    sigaltstack(&stack, 0);
+
+    struct sigaction action;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_ONSTACK;
+    action.sa_handler = crash_signal_handler;
+    for (u32 i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); ++i) {
+        sigaction(crash_signals[i], &action, 0);
+    }
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = backtrace_signal_handler;
+    sigaction(BACKTRACE_SIGNAL, &action, 0);
+    // backtrace() loads libgcc lazily, do it now instead of inside a signal handler
+    void* frames[1];
+    backtrace(frames, 1);
+}
+
+void platform_crash_handler_uninstall() {
+    struct sigaction action;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;
+    action.sa_handler = SIG_DFL;
+    for (u32 i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); ++i) {
+        sigaction(crash_signals[i], &action, 0);
+    }
+    crash_callback = 0;
+}
+
+void platform_backtrace_write(platform_file* file) {
+    void* frames[MAX_BACKTRACE_FRAMES];
+    i32 count = backtrace(frames, MAX_BACKTRACE_FRAMES);
+    backtrace_symbols_fd(frames, count, (i32)(i64)file->internal_data);
+}
+
+bool platform_thread_backtrace_write(u64 thread_id, platform_file* file, f64 timeout) {
+    if (thread_id == platform_thread_id()) {
+        platform_backtrace_write(file);
+        return TRUE;
+    }
+    backtrace_file = file;
+    zatomic_store_u32(&backtrace_done, FALSE);
+    // tgkill fails cleanly with ESRCH when the thread already exited
+    if (syscall(SYS_tgkill, getpid(), (pid_t)thread_id, BACKTRACE_SIGNAL) != 0) {
+        backtrace_file = 0;
+        return FALSE;
+    }
+    f64 end = platform_time() + timeout;
+    while (!zatomic_load_u32(&backtrace_done) && platform_time() < end) {
+        sched_yield();
+    }
+    backtrace_file = 0;
+    return zatomic_load_u32(&backtrace_done);
+}
+
 /***
  *    ███████ ████████ ██   ██ ██████  ███████  █████  ██████
  *       ███     ██    ██   ██ ██   ██ ██      ██   ██ ██   ██
@@ -36,8 +286,50 @@ u32 platform_processor_count() {
  *
  */
 
+static void (*volatile zthread_exit_callback)();
+
+typedef struct zthread_start {
+    zthread_func_return_type (*start_func)(void*);
+    void* params;
+} zthread_start;
+
+// signal alternate stacks are per thread, every zthread gets its own so a stack overflow on
+// a worker still reaches the crash handler
+static zthread_func_return_type zthread_main(void* params) {
+    zthread_start start = *(zthread_start*)params;
+    free(params);
+    stack_t stack;
+    stack.ss_sp = mmap(0, CRASH_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    stack.ss_size = CRASH_STACK_SIZE;
+    stack.ss_flags = 0;
+    bool has_stack = stack.ss_sp != MAP_FAILED && sigaltstack(&stack, 0) == 0;
+    zthread_func_return_type result = start.start_func(start.params);
+    void (*exit_callback)() = zthread_exit_callback;
+    if (exit_callback) {
+        exit_callback();
+    }
+    if (has_stack) {
+        stack.ss_flags = SS_DISABLE;
+        sigaltstack(&stack, 0);
+    }
+    if (stack.ss_sp != MAP_FAILED) {
+        munmap(stack.ss_sp, CRASH_STACK_SIZE);
+    }
+    return result;
+}
+
 void zthread_create(zthread_func_return_type (*start_func)(void*), void* params, zthread* thread) {
-    ASSERT(thread && start_func && pthread_create((pthread_t*)thread, 0, start_func, params) == 0);
+    ASSERT(thread && start_func);
+    zthread_start* start = (zthread_start*)malloc(sizeof(zthread_start));
+    start->start_func = start_func;
+    start->params = params;
+    i32 result = pthread_create((pthread_t*)thread, 0, zthread_main, start);
+    ASSERT(result == 0);
+    (void)result;
+}
+
+void zthread_exit_callback_set(void (*callback)()) {
+    zthread_exit_callback = callback;
 }
 
 void zthread_destroy(zthread* thread) {
@@ -45,16 +337,25 @@ void zthread_destroy(zthread* thread) {
 }
 
 void zthread_wait(zthread* thread) {
-    ASSERT(thread && pthread_join((pthread_t)thread->internal_data, 0) == 0);
+    ASSERT(thread);
+    i32 result = pthread_join((pthread_t)thread->internal_data, 0);
+    ASSERT(result == 0);
+    (void)result;
 }
 
 void zthread_wait_on_all(zthread* threads, u32 count) {
     ASSERT(threads && count);
     for (u32 i = 0; i < count; ++i) {
-        ASSERT(pthread_join((pthread_t)threads[i].internal_data, 0) == 0);
+        i32 result = pthread_join((pthread_t)threads[i].internal_data, 0);
+        ASSERT(result == 0);
+        (void)result;
     }
 }
 
+void zthread_yield() {
+    sched_yield();
+}
+
 /***
  *    ███████ ███    ███ ██    ██ ████████ ███████ ██   ██
  *       ███  ████  ████ ██    ██    ██    ██       ██ ██
@@ -68,23 +369,72 @@ void zthread_wait_on_all(zthread* threads, u32 count) {
 void zmutex_create(zmutex* mutex) {
     ASSERT(mutex);
     mutex->internal_data = malloc(sizeof(pthread_mutex_t));
-    ASSERT(pthread_mutex_init((pthread_mutex_t*)mutex->internal_data, 0) == 0);
+    i32 result = pthread_mutex_init((pthread_mutex_t*)mutex->internal_data, 0);
+    ASSERT(result == 0);
+    (void)result;
 }
 
 void zmutex_destroy(zmutex* mutex) {
-    ASSERT(mutex && pthread_mutex_destroy((pthread_mutex_t*)mutex->internal_data) == 0);
+    ASSERT(mutex);
+    i32 result = pthread_mutex_destroy((pthread_mutex_t*)mutex->internal_data);
+    ASSERT(result == 0);
+    (void)result;
     free(mutex->internal_data);
 }
 
 void zmutex_lock(zmutex* mutex) {
     // if mutex is signaled then the mutex is unsignaled and the thread will enter
     // else thread will wait until the mutex is signaled
-    ASSERT(mutex && pthread_mutex_lock((pthread_mutex_t*)mutex->internal_data) == 0);
+    ASSERT(mutex);
+    i32 result = pthread_mutex_lock((pthread_mutex_t*)mutex->internal_data);
+    ASSERT(result == 0);
+    (void)result;
 }
 
 void zmutex_unlock(zmutex* mutex) {
     // mutex is signaled;
-    ASSERT(mutex && pthread_mutex_unlock((pthread_mutex_t*)mutex->internal_data) == 0);
+    ASSERT(mutex);
+    i32 result = pthread_mutex_unlock((pthread_mutex_t*)mutex->internal_data);
+    ASSERT(result == 0);
+    (void)result;
+}
+
+/***
+ *    ███████ ███████ ███████ ███    ███  █████  ██████  ██   ██  ██████  ██████  ███████
+ *       ███  ██      ██      ████  ████ ██   ██ ██   ██ ██   ██ ██    ██ ██   ██ ██
+ *      ███   ███████ █████   ██ ████ ██ ███████ ██████  ███████ ██    ██ ██████  █████
+ *     ███         ██ ██      ██  ██  ██ ██   ██ ██      ██   ██ ██    ██ ██   ██ ██
+ *    ███████ ███████ ███████ ██      ██ ██   ██ ██      ██   ██  ██████  ██   ██ ███████
+ *
+ *
+ */
+
+void zsemaphore_create(zsemaphore* semaphore, u32 initial_count) {
+    ASSERT(semaphore);
+    semaphore->internal_data = malloc(sizeof(sem_t));
+    i32 result = sem_init((sem_t*)semaphore->internal_data, 0, initial_count);
+    ASSERT(result == 0);
+    (void)result;
+}
+
+void zsemaphore_destroy(zsemaphore* semaphore) {
+    ASSERT(semaphore);
+    sem_destroy((sem_t*)semaphore->internal_data);
+    free(semaphore->internal_data);
+}
+
+void zsemaphore_signal(zsemaphore* semaphore) {
+    ASSERT(semaphore);
+    i32 result = sem_post((sem_t*)semaphore->internal_data);
+    ASSERT(result == 0);
+    (void)result;
+}
+
+void zsemaphore_wait(zsemaphore* semaphore) {
+    ASSERT(semaphore);
+    // retry when a signal handler interrupts the wait
+    while (sem_wait((sem_t*)semaphore->internal_data) != 0) {
+    }
 }
 
 #endif
\ No newline at end of file
@@ -2,9 +2,11 @@
 
 #ifdef PLATFORM_WINDOWS
 #    include <windows.h>
+#    include <psapi.h>
 #    include "logger.h"
 #    include "zthread.h"
 #    include "zmutex.h"
+#    include "zsemaphore.h"
 
 //    ██████  ██       █████  ████████ ███████  ██████  ██████  ███    ███
 //    ██   ██ ██      ██   ██    ██    ██      ██    ██ ██   ██ ████  ████
@@ -29,6 +31,188 @@ u32 platform_processor_count() {
     GetSystemInfo(&sys);
     return sys.dwNumberOfProcessors;
 }
+
+u64 platform_memory_usage() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+}
+
+u64 platform_peak_memory_usage() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+u32 platform_process_id() {
+    return GetCurrentProcessId();
+}
+
+u64 platform_thread_id() {
+    return GetCurrentThreadId();
+}
+
+//    ███████ ██ ██      ███████
+//    ██      ██ ██      ██
+//    █████   ██ ██      █████
+//    ██      ██ ██      ██
+//    ██      ██ ███████ ███████
+//
+//
+
+bool platform_file_open(const char* path, platform_file_mode mode, platform_file* file) {
+    ASSERT(path && file);
+    HANDLE handle;
+    if (mode == PLATFORM_FILE_WRITE) {
+        handle = CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    } else {
+        handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    }
+    if (handle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+    file->internal_data = handle;
+    return TRUE;
+}
+
+void platform_file_stderr(platform_file* file) {
+    file->internal_data = GetStdHandle(STD_ERROR_HANDLE);
+}
+
+void platform_file_close(platform_file* file) {
+    ASSERT(file);
+    CloseHandle(file->internal_data);
+}
+
+u64 platform_file_write(platform_file* file, const void* data, u64 size) {
+    ASSERT(file && (data || size == 0));
+    u64 written = 0;
+    while (written < size) {
+        DWORD chunk = size - written > 0x40000000 ? 0x40000000 : (DWORD)(size - written);
+        DWORD result = 0;
+        if (!WriteFile(file->internal_data, (const u8*)data + written, chunk, &result, 0) || result == 0) {
+            break;
+        }
+        written += result;
+    }
+    return written;
+}
+
+bool platform_file_flush(platform_file* file) {
+    ASSERT(file);
+    return FlushFileBuffers(file->internal_data) != 0;
+}
+
+bool platform_file_replace(const char* from, const char* to) {
+    ASSERT(from && to);
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+bool platform_file_map(const char* path, platform_file_mapping* mapping) {
+    ASSERT(path && mapping);
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+    LARGE_INTEGER size;
+    HANDLE section = 0;
+    if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+        section = CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+    }
+    void* data = section ? MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0) : 0;
+    // the view keeps the section and the file alive
+    if (section) {
+        CloseHandle(section);
+    }
+    CloseHandle(handle);
+    if (!data) {
+        return FALSE;
+    }
+    mapping->data = data;
+    mapping->size = (u64)size.QuadPart;
+    mapping->internal_data = 0;
+    return TRUE;
+}
+
+void platform_file_unmap(platform_file_mapping* mapping) {
+    ASSERT(mapping);
+    if (mapping->data) {
+        UnmapViewOfFile(mapping->data);
+    }
+    mapping->data = 0;
+    mapping->size = 0;
+}
+
+//     ██████ ██████   █████  ███████ ██   ██
+//    ██      ██   ██ ██   ██ ██      ██   ██
+//    ██      ██████  ███████ ███████ ███████
+//    ██      ██   ██ ██   ██      ██ ██   ██
+//     ██████ ██   ██ ██   ██ ███████ ██   ██
+//
+//
+
+#    define MAX_BACKTRACE_FRAMES 62
+
+static platform_crash_callback crash_callback;
+static LPTOP_LEVEL_EXCEPTION_FILTER previous_filter;
+
+static LONG WINAPI crash_exception_filter(EXCEPTION_POINTERS* info) {
+    const char* reason = "unhandled exception";
+    switch (info->ExceptionRecord->ExceptionCode) {
+    case EXCEPTION_ACCESS_VIOLATION:
+        reason = "EXCEPTION_ACCESS_VIOLATION (segmentation fault)";
+        break;
+    case EXCEPTION_ILLEGAL_INSTRUCTION:
+        reason = "EXCEPTION_ILLEGAL_INSTRUCTION (ASSERT traps land here)";
+        break;
+    case EXCEPTION_INT_DIVIDE_BY_ZERO:
+        reason = "EXCEPTION_INT_DIVIDE_BY_ZERO";
+        break;
+    case EXCEPTION_STACK_OVERFLOW:
+        reason = "EXCEPTION_STACK_OVERFLOW";
+        break;
+    case EXCEPTION_BREAKPOINT:
+        reason = "EXCEPTION_BREAKPOINT";
+        break;
+    }
+    if (crash_callback) {
+        crash_callback(reason);
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void platform_crash_handler_install(platform_crash_callback callback) {
+    crash_callback = callback;
+    previous_filter = SetUnhandledExceptionFilter(crash_exception_filter);
+}
+
+void platform_crash_handler_uninstall() {
+    SetUnhandledExceptionFilter(previous_filter);
+    crash_callback = 0;
+}
+
+void platform_backtrace_write(platform_file* file) {
+    // raw return addresses, symbolize them offline against the pdb
+    void* frames[MAX_BACKTRACE_FRAMES];
+    u16 count = CaptureStackBackTrace(0, MAX_BACKTRACE_FRAMES, frames, 0);
+    char line[32];
+    for (u16 i = 0; i < count; ++i) {
+        i32 length = wsprintfA(line, "  0x%p\n", frames[i]);
+        platform_file_write(file, line, (u64)length);
+    }
+}
+
+bool platform_thread_backtrace_write(u64 thread_id, platform_file* file, f64 timeout) {
+    if (thread_id == platform_thread_id()) {
+        platform_backtrace_write(file);
+        return TRUE;
+    }
+    return FALSE;
+}
 /***
  *    ███████ ████████ ██   ██ ██████  ███████  █████  ██████
  *       ███     ██    ██   ██ ██   ██ ██      ██   ██ ██   ██
@@ -39,26 +223,60 @@ u32 platform_processor_count() {
  *
  */
 
+static void (*volatile zthread_exit_callback)();
+
+typedef struct zthread_start {
+    zthread_func_return_type (*start_func)(void*);
+    void* params;
+} zthread_start;
+
+static zthread_func_return_type zthread_main(void* params) {
+    zthread_start start = *(zthread_start*)params;
+    HeapFree(GetProcessHeap(), 0, params);
+    zthread_func_return_type result = start.start_func(start.params);
+    void (*exit_callback)() = zthread_exit_callback;
+    if (exit_callback) {
+        exit_callback();
+    }
+    return result;
+}
+
 void zthread_create(zthread_func_return_type (*start_func)(void*), void* params, zthread* thread) {
     ASSERT(start_func && thread);
-    thread->internal_data = CreateThread(0, 0, start_func, params, 0, 0);
+    zthread_start* start = (zthread_start*)HeapAlloc(GetProcessHeap(), 0, sizeof(zthread_start));
+    start->start_func = start_func;
+    start->params = params;
+    thread->internal_data = CreateThread(0, 0, zthread_main, start, 0, 0);
     ASSERT(thread->internal_data);
 }
 
+void zthread_exit_callback_set(void (*callback)()) {
+    zthread_exit_callback = callback;
+}
+
 void zthread_destroy(zthread* thread) {
-    ASSERT(thread && CloseHandle(thread->internal_data));
+    ASSERT(thread);
+    BOOL result = CloseHandle(thread->internal_data);
+    ASSERT(result);
+    (void)result;
 }
 
 void zthread_wait(zthread* thread) {
     ASSERT(thread);
     u32 result = WaitForSingleObject(thread->internal_data, INFINITE);
     ASSERT(WAIT_ABANDONED != result && WAIT_TIMEOUT != result && WAIT_FAILED != result);
+    (void)result;
 }
 
 void zthread_wait_on_all(zthread* threads, u32 count) {
     ASSERT(threads && count);
     u32 result = WaitForMultipleObjects(count, (HANDLE*)threads, TRUE, INFINITE);
     ASSERT(WAIT_TIMEOUT != result && WAIT_FAILED != result);
+    (void)result;
+}
+
+void zthread_yield() {
+    SwitchToThread();
 }
 
 /***
@@ -78,17 +296,61 @@ void zmutex_create(zmutex* mutex) {
 }
 
 void zmutex_destroy(zmutex* mutex) {
-    ASSERT(mutex && CloseHandle(mutex->internal_data));
+    ASSERT(mutex);
+    BOOL result = CloseHandle(mutex->internal_data);
+    ASSERT(result);
+    (void)result;
 }
 
 void zmutex_lock(zmutex* mutex) {
     ASSERT(mutex);
     u32 result = WaitForSingleObject(mutex->internal_data, INFINITE);
     ASSERT(WAIT_ABANDONED != result && WAIT_TIMEOUT != result && WAIT_FAILED != result);
+    (void)result;
 }
 
 void zmutex_unlock(zmutex* mutex) {
-    ASSERT(mutex && ReleaseMutex(mutex->internal_data));
+    ASSERT(mutex);
+    BOOL result = ReleaseMutex(mutex->internal_data);
+    ASSERT(result);
+    (void)result;
+}
+
+/***
+ *    ███████ ███████ ███████ ███    ███  █████  ██████  ██   ██  ██████  ██████  ███████
+ *       ███  ██      ██      ████  ████ ██   ██ ██   ██ ██   ██ ██    ██ ██   ██ ██
+ *      ███   ███████ █████   ██ ████ ██ ███████ ██████  ███████ ██    ██ ██████  █████
+ *     ███         ██ ██      ██  ██  ██ ██   ██ ██      ██   ██ ██    ██ ██   ██ ██
+ *    ███████ ███████ ███████ ██      ██ ██   ██ ██      ██   ██  ██████  ██   ██ ███████
+ *
+ *
+ */
+
+void zsemaphore_create(zsemaphore* semaphore, u32 initial_count) {
+    ASSERT(semaphore);
+    semaphore->internal_data = CreateSemaphore(0, initial_count, 0x7fffffff, 0);
+    ASSERT(semaphore->internal_data);
+}
+
+void zsemaphore_destroy(zsemaphore* semaphore) {
+    ASSERT(semaphore);
+    BOOL result = CloseHandle(semaphore->internal_data);
+    ASSERT(result);
+    (void)result;
+}
+
+void zsemaphore_signal(zsemaphore* semaphore) {
+    ASSERT(semaphore);
+    BOOL result = ReleaseSemaphore(semaphore->internal_data, 1, 0);
+    ASSERT(result);
+    (void)result;
+}
+
+void zsemaphore_wait(zsemaphore* semaphore) {
+    ASSERT(semaphore);
+    u32 result = WaitForSingleObject(semaphore->internal_data, INFINITE);
+    ASSERT(WAIT_FAILED != result);
+    (void)result;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef ZATOMIC__H
+#define ZATOMIC__H
+
+#include "defines.h"
+
+// thin wrappers over the gnu __atomic builtins, all sequentially consistent
+
+static inline u32 zatomic_load_u32(volatile u32* value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static inline void zatomic_store_u32(volatile u32* value, u32 x) {
+    __atomic_store_n(value, x, __ATOMIC_SEQ_CST);
+}
+
+// returns the value before the addition
+static inline u32 zatomic_add_u32(volatile u32* value, u32 x) {
+    return __atomic_fetch_add(value, x, __ATOMIC_SEQ_CST);
+}
+
+static inline bool zatomic_cas_u32(volatile u32* value, u32 expected, u32 desired) {
+    return __atomic_compare_exchange_n(value, &expected, desired, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline u64 zatomic_load_u64(volatile u64* value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static inline void zatomic_store_u64(volatile u64* value, u64 x) {
+    __atomic_store_n(value, x, __ATOMIC_SEQ_CST);
+}
+
+// returns the value before the addition
+static inline u64 zatomic_add_u64(volatile u64* value, u64 x) {
+    return __atomic_fetch_add(value, x, __ATOMIC_SEQ_CST);
+}
+
+static inline bool zatomic_cas_u64(volatile u64* value, u64 expected, u64 desired) {
+    return __atomic_compare_exchange_n(value, &expected, desired, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+// returns the value before the addition. there is no float fetch_add, the bits are swapped
+// in with a compare exchange until no other thread got in between
+static inline f32 zatomic_add_f32(volatile f32* value, f32 x) {
+    volatile u32* bits = (volatile u32*)value;
+    union {
+        u32 u;
+        f32 f;
+    } before, after;
+    before.u = __atomic_load_n(bits, __ATOMIC_RELAXED);
+    do {
+        after.f = before.f + x;
+    } while (!__atomic_compare_exchange_n(bits, &before.u, after.u, TRUE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+    return before.f;
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include "zpool.h"
+#include "zatomic.h"
+#include "memory.h"
+#include "logger.h"
+#include "platform.h"
+
+// pool whose task is running on this thread and the thread index it was given,
+// nested zpool_parallel_for calls on the same pool run inline with that index
+static __thread zpool* current_pool;
+static __thread u32 current_thread_index;
+
+typedef struct zpool_worker {
+    zpool* pool;
+    u32 thread_index;
+} zpool_worker;
+
+static void zpool_run_chunks(zpool* pool, u32 thread_index) {
+    while (TRUE) {
+        u64 begin = zatomic_add_u64(&pool->next, pool->chunk);
+        if (begin >= pool->count) {
+            break;
+        }
+        u64 end = begin + pool->chunk < pool->count ? begin + pool->chunk : pool->count;
+        for (u64 i = begin; i < end; ++i) {
+            pool->task(pool->params, i, thread_index);
+        }
+    }
+}
+
+static zthread_func_return_type zpool_worker_main(void* params) {
+    zpool_worker worker = *(zpool_worker*)params;
+    free(params);
+    current_pool = worker.pool;
+    current_thread_index = worker.thread_index;
+    while (TRUE) {
+        zsemaphore_wait(&worker.pool->start);
+        if (worker.pool->quit) {
+            break;
+        }
+        zpool_run_chunks(worker.pool, worker.thread_index);
+        zsemaphore_signal(&worker.pool->done);
+    }
+    return 0;
+}
+
+void zpool_create(zpool* pool, u32 worker_count) {
+    ASSERT(pool);
+    if (worker_count == 0) {
+        u32 processors = platform_processor_count();
+        worker_count = processors > 1 ? processors - 1 : 1;
+    }
+    pool->worker_count = worker_count;
+    zmutex_create(&pool->mutex);
+    pool->quit = FALSE;
+    pool->task = 0;
+    pool->params = 0;
+    pool->count = 0;
+    pool->chunk = 1;
+    pool->next = 0;
+    zsemaphore_create(&pool->start, 0);
+    zsemaphore_create(&pool->done, 0);
+    pool->threads = (zthread*)memory_allocate(sizeof(zthread) * worker_count);
+    for (u32 i = 0; i < worker_count; ++i) {
+        zpool_worker* worker = (zpool_worker*)memory_allocate(sizeof(zpool_worker));
+        worker->pool = pool;
+        worker->thread_index = i + 1;
+        zthread_create(zpool_worker_main, worker, &pool->threads[i]);
+    }
+    LOGD("zpool_create %u workers", worker_count);
+}
+
+void zpool_destroy(zpool* pool) {
+    ASSERT(pool);
+    pool->quit = TRUE;
+    for (u32 i = 0; i < pool->worker_count; ++i) {
+        zsemaphore_signal(&pool->start);
+    }
+    for (u32 i = 0; i < pool->worker_count; ++i) {
+        // waited one by one, WaitForMultipleObjects is limited to 64 handles
+        zthread_wait(&pool->threads[i]);
+        zthread_destroy(&pool->threads[i]);
+    }
+    memory_free(pool->threads);
+    zsemaphore_destroy(&pool->start);
+    zsemaphore_destroy(&pool->done);
+    zmutex_destroy(&pool->mutex);
+}
+
+u32 zpool_thread_count(zpool* pool) {
+    return pool ? pool->worker_count + 1 : 1;
+}
+
+void zpool_parallel_for(zpool* pool, u64 count, u64 chunk, zpool_task task, void* params) {
+    ASSERT(task);
+    if (count == 0) {
+        return;
+    }
+    if (pool == 0 || count == 1 || current_pool == pool) {
+        u32 thread_index = current_pool == pool ? current_thread_index : 0;
+        for (u64 i = 0; i < count; ++i) {
+            task(params, i, thread_index);
+        }
+        return;
+    }
+    // callers outside the pool take turns
+    zmutex_lock(&pool->mutex);
+    if (chunk == 0) {
+        // a few chunks per thread keeps the load balanced without hammering the counter
+        chunk = count / (zpool_thread_count(pool) * 8);
+        chunk = chunk ? chunk : 1;
+    }
+    pool->task = task;
+    pool->params = params;
+    pool->count = count;
+    pool->chunk = chunk;
+    zatomic_store_u64(&pool->next, 0);
+
+    zpool* previous_pool = current_pool;
+    u32 previous_thread_index = current_thread_index;
+    current_pool = pool;
+    current_thread_index = 0;
+    for (u32 i = 0; i < pool->worker_count; ++i) {
+        zsemaphore_signal(&pool->start);
+    }
+    zpool_run_chunks(pool, 0);
+    for (u32 i = 0; i < pool->worker_count; ++i) {
+        zsemaphore_wait(&pool->done);
+    }
+    current_pool = previous_pool;
+    current_thread_index = previous_thread_index;
+    zmutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,53 @@
+#ifndef ZPOOL__H
+#define ZPOOL__H
+
+#include "defines.h"
+#include "zthread.h"
+#include "zmutex.h"
+#include "zsemaphore.h"
+
+/***
+ *    ███████ ██████   ██████   ██████  ██
+ *       ███  ██   ██ ██    ██ ██    ██ ██
+ *      ███   ██████  ██    ██ ██    ██ ██
+ *     ███    ██      ██    ██ ██    ██ ██
+ *    ███████ ██       ██████   ██████  ███████
+ *
+ *
+ */
+
+// index is the item being processed, thread_index identifies the executing thread
+// (0 is the thread that called zpool_parallel_for, workers are 1..zpool_thread_count-1)
+typedef void (*zpool_task)(void* params, u64 index, u32 thread_index);
+
+typedef struct zpool {
+    zthread* threads;
+    u32 worker_count;
+    zsemaphore start;
+    zsemaphore done;
+    zmutex mutex;
+    bool quit;
+    // current job
+    zpool_task task;
+    void* params;
+    u64 count;
+    u64 chunk;
+    volatile u64 next;
+} zpool;
+
+// worker_count of 0 creates one worker per available processor minus the calling thread
+void zpool_create(zpool* pool, u32 worker_count);
+
+void zpool_destroy(zpool* pool);
+
+// number of threads that can execute tasks (workers plus the calling thread),
+// use it to size per thread scratch data indexed by thread_index
+u32 zpool_thread_count(zpool* pool);
+
+// runs task for every index in [0, count) and returns when all of them finished,
+// indices are handed out in chunks of chunk (0 picks a chunk size automatically).
+// a null pool runs the loop on the calling thread, as does a nested call made from
+// inside a task of the same pool; calls from other threads wait their turn
+void zpool_parallel_for(zpool* pool, u64 count, u64 chunk, zpool_task task, void* params);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef ZSEMAPHORE__H
+#define ZSEMAPHORE__H
+
+#include "defines.h"
+
+typedef struct zsemaphore {
+    void* internal_data;
+} zsemaphore;
+
+void zsemaphore_create(zsemaphore* semaphore, u32 initial_count);
+
+void zsemaphore_destroy(zsemaphore* semaphore);
+
+// increments the count, waking one waiting thread
+void zsemaphore_signal(zsemaphore* semaphore);
+
+// waits until the count is non zero and decrements it
+void zsemaphore_wait(zsemaphore* semaphore);
+
+#endif
@@ -16,10 +16,17 @@ typedef void* zthread_func_return_type;
 
 void zthread_create(zthread_func_return_type (*start_func)(void*), void* params, zthread* thread);
 
+// called on every zthread after its start function returned, right before the thread exits.
+// one callback per process, set it before creating the threads that should run it
+void zthread_exit_callback_set(void (*callback)());
+
 void zthread_destroy(zthread* thread);
 
 void zthread_wait(zthread* thread);
 
 void zthread_wait_on_all(zthread* threads, u32 count);
 
+// gives up the rest of the calling thread's time slice
+void zthread_yield();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,134 @@
+#ifndef BOUNDS3__H
+#define BOUNDS3__H
+
+#include "defines.h"
+#include "vec3.h"
+#include "ray.h"
+#include "transform.h"
+
+/***
+ *    ██████   ██████  ██    ██ ███    ██ ██████  ███████ ██████
+ *    ██   ██ ██    ██ ██    ██ ████   ██ ██   ██ ██           ██
+ *    ██████  ██    ██ ██    ██ ██ ██  ██ ██   ██ ███████  █████
+ *    ██   ██ ██    ██ ██    ██ ██  ██ ██ ██   ██      ██      ██
+ *    ██████   ██████   ██████  ██   ████ ██████  ███████ ██████
+ *
+ *
+ */
+
+typedef struct bounds3 {
+    point3 min;
+    point3 max;
+} bounds3;
+
+// min > max so the first union replaces it
+FORCE_INLINE bounds3 bounds3_empty() {
+    bounds3 b;
+    b.min = vec3_splat(MAX_F32);
+    b.max = vec3_splat(-MAX_F32);
+    return b;
+}
+
+FORCE_INLINE bounds3 bounds3_make(point3 a, point3 b) {
+    bounds3 r;
+    r.min = vec3_min(a, b);
+    r.max = vec3_max(a, b);
+    return r;
+}
+
+FORCE_INLINE bool bounds3_is_empty(const bounds3* b) {
+    return b->min.x > b->max.x || b->min.y > b->max.y || b->min.z > b->max.z;
+}
+
+FORCE_INLINE bounds3 bounds3_union(bounds3 a, bounds3 b) {
+    bounds3 r;
+    r.min = vec3_min(a.min, b.min);
+    r.max = vec3_max(a.max, b.max);
+    return r;
+}
+
+FORCE_INLINE bounds3 bounds3_union_point(bounds3 a, point3 p) {
+    bounds3 r;
+    r.min = vec3_min(a.min, p);
+    r.max = vec3_max(a.max, p);
+    return r;
+}
+
+FORCE_INLINE vec3 bounds3_diagonal(const bounds3* b) {
+    return vec3_sub(b->max, b->min);
+}
+
+FORCE_INLINE point3 bounds3_centroid(const bounds3* b) {
+    return vec3_scale(vec3_add(b->min, b->max), 0.5f);
+}
+
+FORCE_INLINE f32 bounds3_surface_area(const bounds3* b) {
+    vec3 d = bounds3_diagonal(b);
+    return 2 * (d.x * d.y + d.x * d.z + d.y * d.z);
+}
+
+// axis with the largest extent
+FORCE_INLINE u32 bounds3_maximum_extent(const bounds3* b) {
+    return vec3_max_dimension(bounds3_diagonal(b));
+}
+
+// position of p relative to the corners, 0 at min and 1 at max on every axis
+FORCE_INLINE vec3 bounds3_offset(const bounds3* b, point3 p) {
+    vec3 o = vec3_sub(p, b->min);
+    vec3 d = bounds3_diagonal(b);
+    for (u32 i = 0; i < 3; ++i) {
+        if (d.e[i] > 0) {
+            o.e[i] /= d.e[i];
+        }
+    }
+    return o;
+}
+
+FORCE_INLINE bool bounds3_inside(const bounds3* b, point3 p) {
+    return p.x >= b->min.x && p.x <= b->max.x && p.y >= b->min.y && p.y <= b->max.y && p.z >= b->min.z &&
+           p.z <= b->max.z;
+}
+
+// bounds of an affine transform of b (arvo 1990): the center goes through the matrix and the
+// half extent through its absolute value, both widened by the rounding error of the products
+FORCE_INLINE bounds3 bounds3_transform(const transform* t, const bounds3* b) {
+    point3 center = bounds3_centroid(b);
+    vec3 half = vec3_scale(bounds3_diagonal(b), 0.5f);
+    const f32(*m)[4] = t->m.m;
+    bounds3 r;
+    for (u32 i = 0; i < 3; ++i) {
+        f32 c = m[i][0] * center.x + m[i][1] * center.y + m[i][2] * center.z + m[i][3];
+        f32 e = absf(m[i][0]) * half.x + absf(m[i][1]) * half.y + absf(m[i][2]) * half.z;
+        f32 error = gamma_bound(3) * (absf(m[i][0] * center.x) + absf(m[i][1] * center.y) +
+                                      absf(m[i][2] * center.z) + absf(m[i][3]) + e);
+        r.min.e[i] = c - e - error;
+        r.max.e[i] = c + e + error;
+    }
+    r.min.w = 0;
+    r.max.w = 0;
+    return r;
+}
+
+// slab test of a single ray, inv_dir is 1 / r->d. on a hit the parametric range
+// inside the box is clipped to [0, t_max] and written to t0 and t1 when they are not null
+FORCE_INLINE bool bounds3_intersect(const bounds3* b, const ray* r, vec3 inv_dir, f32 t_max, f32* t0, f32* t1) {
+    vec3 t_lo = vec3_mul(vec3_sub(b->min, r->o), inv_dir);
+    vec3 t_hi = vec3_mul(vec3_sub(b->max, r->o), inv_dir);
+    vec3 t_near = vec3_min(t_lo, t_hi);
+    // widened by the rounding error of the subtraction and product (pbrt 6.8.2)
+    vec3 t_far = vec3_scale(vec3_max(t_lo, t_hi), 1 + 2 * gamma_bound(3));
+    f32 enter = maxf(vec3_max_component(t_near), 0.0f);
+    f32 exit = minf(vec3_min_component(t_far), t_max);
+    if (enter > exit) {
+        return FALSE;
+    }
+    if (t0) {
+        *t0 = enter;
+    }
+    if (t1) {
+        *t1 = exit;
+    }
+    return TRUE;
+}
+
+#endif
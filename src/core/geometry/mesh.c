@@ -0,0 +1,95 @@
+#include "mesh.h"
+#include "logger.h"
+#include "memory.h"
+
+FORCE_INLINE u64 block_take(u64* cursor, u64 bytes) {
+    u64 at = *cursor;
+    *cursor = (at + bytes + 63) & ~63ULL;
+    return at;
+}
+
+void mesh_create(mesh* m, const mesh_desc* desc) {
+    ASSERT(desc->positions && desc->indices);
+    u32 vc = desc->vertex_count;
+    m->vertex_count = vc;
+    m->triangle_count = desc->triangle_count;
+    m->owns_indices = !desc->share_indices;
+
+    // every array starts on its own cache line
+    u64 cursor = 0;
+    u64 x = block_take(&cursor, sizeof(f32) * vc);
+    u64 y = block_take(&cursor, sizeof(f32) * vc);
+    u64 z = block_take(&cursor, sizeof(f32) * vc);
+    u64 normals = desc->normals ? block_take(&cursor, sizeof(u32) * vc) : 0;
+    u64 uvs = desc->uvs ? block_take(&cursor, sizeof(u16) * 2 * vc) : 0;
+    u64 indices = m->owns_indices ? block_take(&cursor, sizeof(u32) * 3 * (u64)desc->triangle_count) : 0;
+    u8* block = (u8*)memory_allocate_aligned(cursor ? cursor : 64, 64);
+    m->internal_data = block;
+
+    m->x = (f32*)(block + x);
+    m->y = (f32*)(block + y);
+    m->z = (f32*)(block + z);
+    m->bounds = bounds3_empty();
+    for (u32 v = 0; v < vc; ++v) {
+        m->x[v] = desc->positions[v].x;
+        m->y[v] = desc->positions[v].y;
+        m->z[v] = desc->positions[v].z;
+        m->bounds = bounds3_union_point(m->bounds, desc->positions[v]);
+    }
+
+    m->normals = 0;
+    if (desc->normals) {
+        m->normals = (u32*)(block + normals);
+        for (u32 v = 0; v < vc; ++v) {
+            m->normals[v] = octahedral_encode(desc->normals[v]);
+        }
+    }
+
+    m->uvs = 0;
+    m->uv_min[0] = m->uv_min[1] = 0;
+    m->uv_extent[0] = m->uv_extent[1] = 0;
+    if (desc->uvs) {
+        m->uvs = (u16*)(block + uvs);
+        for (u32 k = 0; k < 2; ++k) {
+            f32 lo = MAX_F32, hi = -MAX_F32;
+            for (u32 v = 0; v < vc; ++v) {
+                lo = minf(lo, desc->uvs[v * 2 + k]);
+                hi = maxf(hi, desc->uvs[v * 2 + k]);
+            }
+            m->uv_min[k] = vc ? lo : 0;
+            m->uv_extent[k] = vc ? hi - lo : 0;
+            f32 scale = m->uv_extent[k] > 0 ? 65535 / m->uv_extent[k] : 0;
+            for (u32 v = 0; v < vc; ++v) {
+                m->uvs[v * 2 + k] = (u16)clampf(roundf((desc->uvs[v * 2 + k] - lo) * scale), 0, 65535);
+            }
+        }
+    }
+
+    if (m->owns_indices) {
+        u32* copy = (u32*)(block + indices);
+        for (u64 i = 0; i < 3 * (u64)desc->triangle_count; ++i) {
+            ASSERT(desc->indices[i] < vc);
+            copy[i] = desc->indices[i];
+        }
+        m->indices = copy;
+    } else {
+        m->indices = desc->indices;
+    }
+}
+
+void mesh_destroy(mesh* m) {
+    if (m->internal_data) {
+        memory_free_aligned(m->internal_data);
+    }
+    m->internal_data = 0;
+    m->x = m->y = m->z = 0;
+    m->normals = 0;
+    m->uvs = 0;
+    m->indices = 0;
+}
+
+u64 mesh_bytes(const mesh* m) {
+    u64 per_vertex = 3 * sizeof(f32) + (m->normals ? sizeof(u32) : 0) + (m->uvs ? 2 * sizeof(u16) : 0);
+    u64 bytes = per_vertex * m->vertex_count;
+    return bytes + (m->owns_indices ? 3 * sizeof(u32) * (u64)m->triangle_count : 0);
+}
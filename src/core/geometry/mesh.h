@@ -0,0 +1,145 @@
+#ifndef MESH__H
+#define MESH__H
+
+#include "defines.h"
+#include "vec3.h"
+#include "bounds3.h"
+
+/***
+ *    ███    ███ ███████ ███████ ██   ██
+ *    ████  ████ ██      ██      ██   ██
+ *    ██ ████ ██ █████   ███████ ███████
+ *    ██  ██  ██ ██           ██ ██   ██
+ *    ██      ██ ███████ ███████ ██   ██
+ *
+ *
+ */
+
+// indexed triangle mesh in compact form. positions are three float arrays, normals are
+// octahedral encoded into 2 x 16 bits and uvs are 16 bit fixed point over the uv range of
+// the mesh, which is 20 bytes per vertex against 40 for point3 + normal3 + 2 floats.
+// every array lives in one 64 byte aligned block from memory_allocate_aligned
+
+typedef struct mesh_desc {
+    u32 vertex_count;
+    u32 triangle_count;
+    const point3* positions;
+    // optional, 0 when the mesh has no shading normals
+    const normal3* normals;
+    // optional, 2 per vertex, 0 when the mesh has no uvs
+    const f32* uvs;
+    // 3 per triangle, one index for every vertex attribute
+    const u32* indices;
+    // reference indices instead of copying them, for meshes that share their topology with
+    // others. the buffer then has to outlive the mesh
+    bool share_indices;
+} mesh_desc;
+
+typedef struct mesh {
+    u32 vertex_count;
+    u32 triangle_count;
+    f32* x;
+    f32* y;
+    f32* z;
+    // octahedral normals, 0 when absent
+    u32* normals;
+    // u and v interleaved, 0 when absent. u = uv_min[0] + q * uv_extent[0] / 65535
+    u16* uvs;
+    f32 uv_min[2];
+    f32 uv_extent[2];
+    const u32* indices;
+    bool owns_indices;
+    bounds3 bounds;
+    void* internal_data;
+} mesh;
+
+void mesh_create(mesh* m, const mesh_desc* desc);
+
+void mesh_destroy(mesh* m);
+
+// bytes held by the mesh, shared indices excluded
+u64 mesh_bytes(const mesh* m);
+
+// ============================================================================
+// ENCODING
+// ============================================================================
+
+FORCE_INLINE f32 sign_not_zero(f32 v) {
+    return v < 0 ? -1.0f : 1.0f;
+}
+
+// unit vector to a point of the octahedron unfolded onto [-1, 1]^2 (cigolle et al. 2014),
+// stored as two 16 bit snorms
+FORCE_INLINE u32 octahedral_encode(normal3 n) {
+    f32 l1 = absf(n.x) + absf(n.y) + absf(n.z);
+    f32 u = n.x / l1;
+    f32 v = n.y / l1;
+    if (n.z < 0) {
+        f32 fold_u = (1 - absf(v)) * sign_not_zero(u);
+        f32 fold_v = (1 - absf(u)) * sign_not_zero(v);
+        u = fold_u;
+        v = fold_v;
+    }
+    i32 qu = (i32)roundf(clampf(u, -1, 1) * 32767);
+    i32 qv = (i32)roundf(clampf(v, -1, 1) * 32767);
+    return (u32)(u16)(i16)qu | (u32)(u16)(i16)qv << 16;
+}
+
+FORCE_INLINE normal3 octahedral_decode(u32 encoded) {
+    f32 u = (f32)(i16)(u16)(encoded & 0xffff) / 32767;
+    f32 v = (f32)(i16)(u16)(encoded >> 16) / 32767;
+    f32 z = 1 - absf(u) - absf(v);
+    if (z < 0) {
+        f32 unfold_u = (1 - absf(v)) * sign_not_zero(u);
+        f32 unfold_v = (1 - absf(u)) * sign_not_zero(v);
+        u = unfold_u;
+        v = unfold_v;
+    }
+    return vec3_normalize(vec3_make(u, v, z));
+}
+
+// ============================================================================
+// ACCESS
+// ============================================================================
+
+FORCE_INLINE point3 mesh_position(const mesh* m, u32 vertex) {
+    return vec3_make(m->x[vertex], m->y[vertex], m->z[vertex]);
+}
+
+FORCE_INLINE void mesh_triangle(const mesh* m, u32 triangle, point3* p0, point3* p1, point3* p2) {
+    const u32* tri = m->indices + triangle * 3;
+    *p0 = mesh_position(m, tri[0]);
+    *p1 = mesh_position(m, tri[1]);
+    *p2 = mesh_position(m, tri[2]);
+}
+
+FORCE_INLINE normal3 mesh_normal(const mesh* m, u32 vertex) {
+    return octahedral_decode(m->normals[vertex]);
+}
+
+FORCE_INLINE void mesh_uv(const mesh* m, u32 vertex, f32 uv[2]) {
+    uv[0] = m->uv_min[0] + (f32)m->uvs[vertex * 2] * (m->uv_extent[0] / 65535);
+    uv[1] = m->uv_min[1] + (f32)m->uvs[vertex * 2 + 1] * (m->uv_extent[1] / 65535);
+}
+
+// shading normal at barycentrics (b0, b1, b2) of triangle, the mesh must have normals
+FORCE_INLINE normal3 mesh_interpolate_normal(const mesh* m, u32 triangle, f32 b0, f32 b1, f32 b2) {
+    const u32* tri = m->indices + triangle * 3;
+    vec3 n = vec3_scale(mesh_normal(m, tri[0]), b0);
+    n = vec3_madd(n, mesh_normal(m, tri[1]), b1);
+    n = vec3_madd(n, mesh_normal(m, tri[2]), b2);
+    return vec3_normalize(n);
+}
+
+// uv at barycentrics (b0, b1, b2) of triangle, the mesh must have uvs
+FORCE_INLINE void mesh_interpolate_uv(const mesh* m, u32 triangle, f32 b0, f32 b1, f32 b2, f32 uv[2]) {
+    const u32* tri = m->indices + triangle * 3;
+    f32 a[2], b[2], c[2];
+    mesh_uv(m, tri[0], a);
+    mesh_uv(m, tri[1], b);
+    mesh_uv(m, tri[2], c);
+    uv[0] = a[0] * b0 + b[0] * b1 + c[0] * b2;
+    uv[1] = a[1] * b0 + b[1] * b1 + c[1] * b2;
+}
+
+#endif
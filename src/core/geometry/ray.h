@@ -0,0 +1,34 @@
+#ifndef RAY__H
+#define RAY__H
+
+#include "defines.h"
+#include "vec3.h"
+
+//    ██████   █████  ██    ██
+//    ██   ██ ██   ██  ██  ██
+//    ██████  ███████   ████
+//    ██   ██ ██   ██    ██
+//    ██   ██ ██   ██    ██
+//
+//
+
+// the direction is not required to be normalized, hit distances are in units of |d|
+typedef struct ray {
+    point3 o;
+    vec3 d;
+    f32 time;
+} ray;
+
+FORCE_INLINE ray ray_make(point3 o, vec3 d) {
+    ray r;
+    r.o = o;
+    r.d = d;
+    r.time = 0;
+    return r;
+}
+
+FORCE_INLINE point3 ray_at(const ray* r, f32 t) {
+    return vec3_madd(r->o, r->d, t);
+}
+
+#endif
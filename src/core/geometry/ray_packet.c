@@ -0,0 +1,157 @@
+#include "ray_packet.h"
+#include "logger.h"
+#include "memory.h"
+
+#define RAY_PACKET_ARRAYS 13
+#define RAY_PACKET_ALIGNMENT 64
+
+void ray_packet_create(ray_packet* packet, u32 lanes) {
+    ASSERT(lanes == 4 || lanes == 8 || lanes == 16);
+    u32 width = lanes < SIMD_LANES ? SIMD_LANES : lanes;
+    f32* block = (f32*)memory_allocate_aligned(sizeof(f32) * width * RAY_PACKET_ARRAYS, RAY_PACKET_ALIGNMENT);
+    packet->lanes = lanes;
+    packet->width = width;
+    for (u32 i = 0; i < 3; ++i) {
+        packet->org[i] = block + width * i;
+        packet->dir[i] = block + width * (3 + i);
+        packet->inv_dir[i] = block + width * (6 + i);
+    }
+    packet->t_max = block + width * 9;
+    packet->u = block + width * 10;
+    packet->v = block + width * 11;
+    packet->prim_id = (u32*)(block + width * 12);
+    packet->internal_data = block;
+    for (u32 i = 0; i < width * RAY_PACKET_ARRAYS; ++i) {
+        block[i] = 0;
+    }
+    for (u32 i = 0; i < width; ++i) {
+        packet->t_max[i] = -1;
+        packet->prim_id[i] = RAY_PACKET_NO_HIT;
+    }
+}
+
+void ray_packet_destroy(ray_packet* packet) {
+    ASSERT(packet->internal_data != 0);
+    memory_free_aligned(packet->internal_data);
+    packet->internal_data = 0;
+}
+
+void ray_packet_set(ray_packet* packet, u32 lane, const ray* r, f32 t_max) {
+    ASSERT(lane < packet->lanes);
+    for (u32 i = 0; i < 3; ++i) {
+        packet->org[i][lane] = r->o.e[i];
+        packet->dir[i][lane] = r->d.e[i];
+        packet->inv_dir[i][lane] = 1 / r->d.e[i];
+    }
+    packet->t_max[lane] = t_max;
+    packet->u[lane] = 0;
+    packet->v[lane] = 0;
+    packet->prim_id[lane] = RAY_PACKET_NO_HIT;
+}
+
+u32 ray_packet_active_mask(const ray_packet* packet) {
+    u32 mask = 0;
+    for (u32 i = 0; i < packet->width; ++i) {
+        mask |= (packet->t_max[i] >= 0 ? 1u : 0u) << i;
+    }
+    return mask;
+}
+
+// ============================================================================
+// KERNELS
+// ============================================================================
+
+// both kernels walk the packet SIMD_LANES rays at a time, skipping groups with no
+// active lane, and splat the per primitive values once up front
+
+u32 ray_packet_intersect_bounds(const ray_packet* packet, const bounds3* b, u32 active) {
+    simdf box_min[3], box_max[3];
+    for (u32 i = 0; i < 3; ++i) {
+        box_min[i] = simdf_set1(b->min.e[i]);
+        box_max[i] = simdf_set1(b->max.e[i]);
+    }
+    simdf zero = simdf_set1(0);
+    simdf widen = simdf_set1(1 + 2 * gamma_bound(3));
+
+    u32 result = 0;
+    for (u32 base = 0; base < packet->width; base += SIMD_LANES) {
+        u32 group = (active >> base) & ((1u << SIMD_LANES) - 1);
+        if (group == 0) {
+            continue;
+        }
+        simdf enter = zero;
+        simdf exit = simdf_load(packet->t_max + base);
+        for (u32 i = 0; i < 3; ++i) {
+            simdf o = simdf_load(packet->org[i] + base);
+            simdf inv = simdf_load(packet->inv_dir[i] + base);
+            simdf t_lo = simdf_mul(simdf_sub(box_min[i], o), inv);
+            simdf t_hi = simdf_mul(simdf_sub(box_max[i], o), inv);
+            enter = simdf_max(enter, simdf_min(t_lo, t_hi));
+            exit = simdf_min(exit, simdf_mul(simdf_max(t_lo, t_hi), widen));
+        }
+        result |= (simdb_bits(simdf_le(enter, exit)) & group) << base;
+    }
+    return result;
+}
+
+u32 ray_packet_intersect_triangle(ray_packet* packet, point3 p0, point3 p1, point3 p2, u32 prim_id, u32 active) {
+    simdf v0[3], e1[3], e2[3];
+    for (u32 i = 0; i < 3; ++i) {
+        v0[i] = simdf_set1(p0.e[i]);
+        e1[i] = simdf_set1(p1.e[i] - p0.e[i]);
+        e2[i] = simdf_set1(p2.e[i] - p0.e[i]);
+    }
+    simdf zero = simdf_set1(0);
+    simdf one = simdf_set1(1);
+
+    u32 result = 0;
+    for (u32 base = 0; base < packet->width; base += SIMD_LANES) {
+        u32 group = (active >> base) & ((1u << SIMD_LANES) - 1);
+        if (group == 0) {
+            continue;
+        }
+        simdf d[3], o[3];
+        for (u32 i = 0; i < 3; ++i) {
+            d[i] = simdf_load(packet->dir[i] + base);
+            o[i] = simdf_sub(simdf_load(packet->org[i] + base), v0[i]);
+        }
+
+        // p = d x e2, det = e1 . p
+        simdf p[3] = {simdf_msub2(d[1], e2[2], d[2], e2[1]),
+                      simdf_msub2(d[2], e2[0], d[0], e2[2]),
+                      simdf_msub2(d[0], e2[1], d[1], e2[0])};
+        simdf det = simdf_madd(e1[0], p[0], simdf_madd(e1[1], p[1], simdf_mul(e1[2], p[2])));
+        simdf inv_det = simdf_div(one, det);
+
+        simdf u = simdf_mul(simdf_madd(o[0], p[0], simdf_madd(o[1], p[1], simdf_mul(o[2], p[2]))), inv_det);
+
+        // q = o x e1
+        simdf q[3] = {simdf_msub2(o[1], e1[2], o[2], e1[1]),
+                      simdf_msub2(o[2], e1[0], o[0], e1[2]),
+                      simdf_msub2(o[0], e1[1], o[1], e1[0])};
+        simdf v = simdf_mul(simdf_madd(d[0], q[0], simdf_madd(d[1], q[1], simdf_mul(d[2], q[2]))), inv_det);
+        simdf t = simdf_mul(simdf_madd(e2[0], q[0], simdf_madd(e2[1], q[1], simdf_mul(e2[2], q[2]))), inv_det);
+
+        // a zero det gives an infinite or nan inv_det which fails the t range test
+        simdf t_max = simdf_load(packet->t_max + base);
+        simdb hit = simdb_and(simdf_ge(u, zero), simdf_ge(v, zero));
+        hit = simdb_and(hit, simdf_le(simdf_add(u, v), one));
+        hit = simdb_and(hit, simdb_and(simdf_gt(t, zero), simdf_lt(t, t_max)));
+        hit = simdb_and(hit, simdb_from_bits(group));
+
+        u32 bits = simdb_bits(hit);
+        if (bits == 0) {
+            continue;
+        }
+        simdf_store(packet->t_max + base, simdf_select(hit, t, t_max));
+        simdf_store(packet->u + base, simdf_select(hit, u, simdf_load(packet->u + base)));
+        simdf_store(packet->v + base, simdf_select(hit, v, simdf_load(packet->v + base)));
+        for (u32 lane = 0; lane < SIMD_LANES; ++lane) {
+            if (bits & (1u << lane)) {
+                packet->prim_id[base + lane] = prim_id;
+            }
+        }
+        result |= bits << base;
+    }
+    return result;
+}
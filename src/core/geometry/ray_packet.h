@@ -0,0 +1,59 @@
+#ifndef RAY_PACKET__H
+#define RAY_PACKET__H
+
+#include "defines.h"
+#include "simd.h"
+#include "vec3.h"
+#include "ray.h"
+#include "bounds3.h"
+
+/***
+ *    ██████   █████  ██    ██     ██████   █████   ██████ ██   ██ ███████ ████████
+ *    ██   ██ ██   ██  ██  ██      ██   ██ ██   ██ ██      ██  ██  ██         ██
+ *    ██████  ███████   ████       ██████  ███████ ██      █████   █████      ██
+ *    ██   ██ ██   ██    ██        ██      ██   ██ ██      ██  ██  ██         ██
+ *    ██   ██ ██   ██    ██        ██      ██   ██  ██████ ██   ██ ███████    ██
+ *
+ *
+ */
+
+// structure of arrays packet of 4, 8 or 16 rays. every array holds width floats, where
+// width is lanes rounded up to SIMD_LANES, so a 4 ray packet on an avx2 build runs 8 wide
+// with the padding lanes parked at t_max = -1 where nothing can hit them.
+// the arrays live in one 64 byte aligned block from memory_allocate_aligned
+typedef struct ray_packet {
+    u32 lanes;
+    u32 width;
+    f32* org[3];
+    f32* dir[3];
+    f32* inv_dir[3];
+    // closest hit so far, t_max shrinks as hits are found
+    f32* t_max;
+    f32* u;
+    f32* v;
+    u32* prim_id;
+    void* internal_data;
+} ray_packet;
+
+#define RAY_PACKET_NO_HIT 0xffffffffu
+
+// lanes must be 4, 8 or 16, every lane starts inactive
+void ray_packet_create(ray_packet* packet, u32 lanes);
+
+void ray_packet_destroy(ray_packet* packet);
+
+// activates lane with the ray r limited to (0, t_max) and clears its hit
+void ray_packet_set(ray_packet* packet, u32 lane, const ray* r, f32 t_max);
+
+// bit i is set for every active lane i
+u32 ray_packet_active_mask(const ray_packet* packet);
+
+// slab test of every lane in active against b, returns the mask of lanes that enter b
+// before their current t_max
+u32 ray_packet_intersect_bounds(const ray_packet* packet, const bounds3* b, u32 active);
+
+// moller trumbore test of every lane in active, lanes that hit closer than their t_max
+// record t, the barycentrics of p1 and p2 in u and v, and prim_id. returns the mask of hits
+u32 ray_packet_intersect_triangle(ray_packet* packet, point3 p0, point3 p1, point3 p2, u32 prim_id, u32 active);
+
+#endif
@@ -0,0 +1,94 @@
+#include "triangle.h"
+
+// the watertight test, inlined into both entry points. hit is null for occlusion, the
+// compiler then drops the barycentrics
+FORCE_INLINE bool watertight_test(const ray* r, f32 t_max, point3 p0, point3 p1, point3 p2, triangle_hit* hit) {
+    // degenerate triangles have no area to hit
+    if (vec3_length_squared(vec3_cross(vec3_sub(p2, p0), vec3_sub(p1, p0))) == 0) {
+        return FALSE;
+    }
+
+    // move the ray origin to (0,0,0) and make the largest direction component z
+    vec3 p0t = vec3_sub(p0, r->o);
+    vec3 p1t = vec3_sub(p1, r->o);
+    vec3 p2t = vec3_sub(p2, r->o);
+    u32 kz = vec3_max_dimension(vec3_abs(r->d));
+    u32 kx = kz + 1 == 3 ? 0 : kz + 1;
+    u32 ky = kx + 1 == 3 ? 0 : kx + 1;
+    vec3 d = vec3_permute(r->d, kx, ky, kz);
+    p0t = vec3_permute(p0t, kx, ky, kz);
+    p1t = vec3_permute(p1t, kx, ky, kz);
+    p2t = vec3_permute(p2t, kx, ky, kz);
+
+    // shear the ray direction onto +z, the z shear is deferred until a hit is certain
+    f32 sx = -d.x / d.z;
+    f32 sy = -d.y / d.z;
+    f32 sz = 1 / d.z;
+    p0t.x += sx * p0t.z;
+    p0t.y += sy * p0t.z;
+    p1t.x += sx * p1t.z;
+    p1t.y += sy * p1t.z;
+    p2t.x += sx * p2t.z;
+    p2t.y += sy * p2t.z;
+
+    // edge functions. the products of two f32 are exact in f64, so each difference is
+    // rounded once however the compiler contracts or reorders it (release builds use
+    // -ffast-math). a ray through a shared edge then gets exactly opposite edge values
+    // from the two triangles sharing it and cannot slip between them
+    f32 e0 = (f32)((f64)p1t.x * p2t.y - (f64)p1t.y * p2t.x);
+    f32 e1 = (f32)((f64)p2t.x * p0t.y - (f64)p2t.y * p0t.x);
+    f32 e2 = (f32)((f64)p0t.x * p1t.y - (f64)p0t.y * p1t.x);
+    if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0)) {
+        return FALSE;
+    }
+    f32 det = e0 + e1 + e2;
+    if (det == 0) {
+        return FALSE;
+    }
+
+    // scaled distance, compared against t_max before dividing by det
+    p0t.z *= sz;
+    p1t.z *= sz;
+    p2t.z *= sz;
+    f32 t_scaled = e0 * p0t.z + e1 * p1t.z + e2 * p2t.z;
+    if (det < 0 && (t_scaled >= 0 || t_scaled < t_max * det)) {
+        return FALSE;
+    }
+    if (det > 0 && (t_scaled <= 0 || t_scaled > t_max * det)) {
+        return FALSE;
+    }
+
+    f32 inv_det = 1 / det;
+    f32 t = t_scaled * inv_det;
+
+    // reject hits too close to the origin to be distinguished from rounding error (pbrt 6.8.7)
+    f32 max_zt = vec3_max_component(vec3_abs(vec3_make(p0t.z, p1t.z, p2t.z)));
+    f32 delta_z = gamma_bound(3) * max_zt;
+    f32 max_xt = vec3_max_component(vec3_abs(vec3_make(p0t.x, p1t.x, p2t.x)));
+    f32 max_yt = vec3_max_component(vec3_abs(vec3_make(p0t.y, p1t.y, p2t.y)));
+    f32 delta_x = gamma_bound(5) * (max_xt + max_zt);
+    f32 delta_y = gamma_bound(5) * (max_yt + max_zt);
+    f32 delta_e = 2 * (gamma_bound(2) * max_xt * max_yt + delta_y * max_xt + delta_x * max_yt);
+    f32 max_e = vec3_max_component(vec3_abs(vec3_make(e0, e1, e2)));
+    f32 delta_t =
+        3 * (gamma_bound(3) * max_e * max_zt + delta_e * max_zt + delta_z * max_e) * absf(inv_det);
+    if (t <= delta_t) {
+        return FALSE;
+    }
+
+    if (hit) {
+        hit->t = t;
+        hit->b0 = e0 * inv_det;
+        hit->b1 = e1 * inv_det;
+        hit->b2 = e2 * inv_det;
+    }
+    return TRUE;
+}
+
+bool triangle_intersect(const ray* r, f32 t_max, point3 p0, point3 p1, point3 p2, triangle_hit* hit) {
+    return watertight_test(r, t_max, p0, p1, p2, hit);
+}
+
+bool triangle_occluded(const ray* r, f32 t_max, point3 p0, point3 p1, point3 p2) {
+    return watertight_test(r, t_max, p0, p1, p2, 0);
+}
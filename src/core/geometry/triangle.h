@@ -0,0 +1,32 @@
+#ifndef TRIANGLE__H
+#define TRIANGLE__H
+
+#include "defines.h"
+#include "vec3.h"
+#include "ray.h"
+
+//    ████████ ██████  ██  █████  ███    ██  ██████  ██      ███████
+//       ██    ██   ██ ██ ██   ██ ████   ██ ██       ██      ██
+//       ██    ██████  ██ ███████ ██ ██  ██ ██   ███ ██      █████
+//       ██    ██   ██ ██ ██   ██ ██  ██ ██ ██    ██ ██      ██
+//       ██    ██   ██ ██ ██   ██ ██   ████  ██████  ███████ ███████
+//
+//
+
+// b0, b1, b2 are the barycentric weights of p0, p1, p2 at the hit point
+typedef struct triangle_hit {
+    f32 t;
+    f32 b0;
+    f32 b1;
+    f32 b2;
+} triangle_hit;
+
+// watertight single ray test (Woop et al. 2013, as in pbrt-v4). rays that pass through a
+// shared edge or vertex hit at least one of the triangles sharing it, which the
+// moller trumbore packet kernel does not guarantee
+bool triangle_intersect(const ray* r, f32 t_max, point3 p0, point3 p1, point3 p2, triangle_hit* hit);
+
+// whether triangle_intersect would report a hit, without computing it
+bool triangle_occluded(const ray* r, f32 t_max, point3 p0, point3 p1, point3 p2);
+
+#endif
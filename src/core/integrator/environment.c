@@ -0,0 +1,105 @@
+#include "environment.h"
+#include <math.h>
+#include <string.h>
+#include "math_utils.h"
+#include "clock.h"
+#include "logger.h"
+#include "memory.h"
+
+// ============================================================================
+// MAPPING
+// ============================================================================
+
+// d to image coordinates in [0, 1]^2
+FORCE_INLINE void direction_to_image(vec3 d, f32* u, f32* v) {
+    f32 phi = atan2f(d.z, d.x);
+    phi = phi < 0 ? phi + 2.0f * PI : phi;
+    *u = phi * INV_2PI;
+    *v = acosf(clampf(d.y, -1.0f, 1.0f)) * INV_PI;
+}
+
+FORCE_INLINE const f32* texel(const environment_map* e, f32 u, f32 v) {
+    u32 x = (u32)(u * (f32)e->width);
+    u32 y = (u32)(v * (f32)e->height);
+    x = x < e->width ? x : e->width - 1;
+    y = y < e->height ? y : e->height - 1;
+    return e->rgb + 3 * ((u64)y * e->width + x);
+}
+
+typedef struct weights_job {
+    const environment_map* e;
+    f32* weights;
+} weights_job;
+
+// brightness times sin theta at the middle of the row
+static void weights_task(void* params, u64 index, u32 thread_index) {
+    weights_job* job = (weights_job*)params;
+    const environment_map* e = job->e;
+    f32 sin_theta = sinf(PI * ((f32)index + 0.5f) / (f32)e->height);
+    const f32* rgb = e->rgb + 3 * index * e->width;
+    f32* weights = job->weights + index * e->width;
+    for (u32 x = 0; x < e->width; ++x) {
+        weights[x] = (rgb[3 * x] + rgb[3 * x + 1] + rgb[3 * x + 2]) * (1.0f / 3.0f) * sin_theta;
+    }
+}
+
+// ============================================================================
+// PUBLIC
+// ============================================================================
+
+void environment_create(environment_map* e, const f32* rgb, u32 width, u32 height, zpool* pool) {
+    ASSERT(width && height);
+    clock clk;
+    clock_set(&clk);
+    e->width = width;
+    e->height = height;
+    u64 texels = (u64)width * height;
+    e->rgb = (f32*)memory_allocate(sizeof(f32) * 3 * texels);
+    memcpy(e->rgb, rgb, sizeof(f32) * 3 * texels);
+    f32* weights = (f32*)memory_allocate(sizeof(f32) * texels);
+    weights_job job = {e, weights};
+    zpool_parallel_for(pool, height, 0, weights_task, &job);
+    distribution2d_create(&e->distribution, weights, width, height, pool);
+    memory_free(weights);
+    clock_update(&clk);
+    e->build_seconds = clk.elapsed;
+}
+
+void environment_destroy(environment_map* e) {
+    distribution2d_destroy(&e->distribution);
+    memory_free(e->rgb);
+    memset(e, 0, sizeof(environment_map));
+}
+
+vec3 environment_lookup(const environment_map* e, vec3 d) {
+    f32 u, v;
+    direction_to_image(d, &u, &v);
+    const f32* rgb = texel(e, u, v);
+    return vec3_make(rgb[0], rgb[1], rgb[2]);
+}
+
+bool environment_sample(const environment_map* e, f32 u0, f32 u1, vec3* wi, vec3* radiance, f32* pdf) {
+    f32 u, v, image_pdf;
+    distribution2d_sample_alias(&e->distribution, u0, u1, &u, &v, &image_pdf);
+    f32 theta = v * PI, phi = u * 2.0f * PI;
+    f32 sin_theta = sinf(theta);
+    if (image_pdf <= 0 || sin_theta <= 0) {
+        return FALSE;
+    }
+    *wi = vec3_make(sin_theta * cosf(phi), cosf(theta), sin_theta * sinf(phi));
+    const f32* rgb = texel(e, u, v);
+    *radiance = vec3_make(rgb[0], rgb[1], rgb[2]);
+    // the image maps onto the sphere with a jacobian of 2 pi^2 sin theta
+    *pdf = image_pdf / (2.0f * PI * PI * sin_theta);
+    return TRUE;
+}
+
+f32 environment_pdf(const environment_map* e, vec3 d) {
+    f32 u, v;
+    direction_to_image(d, &u, &v);
+    f32 sin_theta = sinf(v * PI);
+    if (sin_theta <= 0) {
+        return 0.0f;
+    }
+    return distribution2d_pdf(&e->distribution, u, v) / (2.0f * PI * PI * sin_theta);
+}
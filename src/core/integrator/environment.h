@@ -0,0 +1,49 @@
+#ifndef ENVIRONMENT__H
+#define ENVIRONMENT__H
+
+#include "defines.h"
+#include "vec3.h"
+#include "distribution.h"
+#include "zpool.h"
+
+/***
+ *    ███████ ███    ██ ██    ██ ██ ██████   ██████  ███    ██ ███    ███ ███████ ███    ██ ████████
+ *    ██      ████   ██ ██    ██ ██ ██   ██ ██    ██ ████   ██ ████  ████ ██      ████   ██    ██
+ *    █████   ██ ██  ██ ██    ██ ██ ██████  ██    ██ ██ ██  ██ ██ ████ ██ █████   ██ ██  ██    ██
+ *    ██      ██  ██ ██  ██  ██  ██ ██   ██ ██    ██ ██  ██ ██ ██  ██  ██ ██      ██  ██ ██    ██
+ *    ███████ ██   ████   ████   ██ ██   ██  ██████  ██   ████ ██      ██ ███████ ██   ████    ██
+ *
+ *
+ */
+
+// light arriving from infinitely far away, an hdr image in latitude longitude layout: row 0
+// looks along +y, the last row along -y, and columns go around y starting at +x towards +z.
+// texels are constant over their patch of the sphere, and directions are importance
+// sampled in proportion to texel brightness times the solid angle the texel covers
+// (sin theta), from a distribution2d built on the pool, with its alias tables
+
+typedef struct environment_map {
+    // width x height rgb texels, row after row
+    f32* rgb;
+    u32 width;
+    u32 height;
+    distribution2d distribution;
+    f64 build_seconds;
+} environment_map;
+
+// copies the width x height rgb texels. pool may be null
+void environment_create(environment_map* e, const f32* rgb, u32 width, u32 height, zpool* pool);
+
+void environment_destroy(environment_map* e);
+
+// the radiance arriving along -d, from direction d
+vec3 environment_lookup(const environment_map* e, vec3 d);
+
+// a direction wi towards the environment, the radiance arriving from it and the solid angle
+// pdf it was picked with. FALSE for the poles, where the pdf is undefined
+bool environment_sample(const environment_map* e, f32 u0, f32 u1, vec3* wi, vec3* radiance, f32* pdf);
+
+// the solid angle pdf of environment_sample picking d
+f32 environment_pdf(const environment_map* e, vec3 d);
+
+#endif
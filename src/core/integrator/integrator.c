@@ -0,0 +1,293 @@
+#include "integrator.h"
+#include <math.h>
+#include <string.h>
+#include "math_utils.h"
+#include "logger.h"
+#include "memory.h"
+
+// ============================================================================
+// CAMERA
+// ============================================================================
+
+void camera_look_at(camera* c, point3 eye, point3 target, vec3 up, f32 fov, u32 width, u32 height) {
+    ASSERT(width && height && fov > 0 && fov < 180);
+    vec3 forward = vec3_normalize(vec3_sub(target, eye));
+    vec3 right = vec3_normalize(vec3_cross(forward, up));
+    vec3 down = vec3_cross(forward, right);
+    // the image plane at distance 1, half_height tall above and below the axis
+    f32 half_height = tanf(fov * (PI / 360.0f));
+    f32 pixel = 2.0f * half_height / (f32)height;
+    c->position = eye;
+    c->step_x = vec3_scale(right, pixel);
+    c->step_y = vec3_scale(down, pixel);
+    c->corner = vec3_sub(forward, vec3_add(vec3_scale(c->step_x, 0.5f * (f32)width), vec3_scale(c->step_y, 0.5f * (f32)height)));
+    c->width = width;
+    c->height = height;
+}
+
+ray camera_generate_ray(const camera* c, f32 x, f32 y) {
+    vec3 d = vec3_madd(vec3_madd(c->corner, c->step_x, x), c->step_y, y);
+    return ray_make(c->position, vec3_normalize(d));
+}
+
+// ============================================================================
+// WORLD
+// ============================================================================
+
+static bool is_emissive(const material* m) {
+    return m->emission.x > 0 || m->emission.y > 0 || m->emission.z > 0;
+}
+
+void world_create(world* w, const world_desc* desc, zpool* pool) {
+    ASSERT(desc->triangle_count && desc->material_count);
+    w->vertex_count = desc->vertex_count;
+    w->triangle_count = desc->triangle_count;
+    w->material_count = desc->material_count;
+    w->background = desc->background;
+    w->environment = desc->environment;
+    w->positions = (point3*)memory_allocate(sizeof(point3) * desc->vertex_count);
+    w->indices = (u32*)memory_allocate(sizeof(u32) * 3 * desc->triangle_count);
+    w->triangle_materials = (u32*)memory_allocate(sizeof(u32) * desc->triangle_count);
+    w->materials = (material*)memory_allocate(sizeof(material) * desc->material_count);
+    memcpy(w->positions, desc->positions, sizeof(point3) * desc->vertex_count);
+    memcpy(w->indices, desc->indices, sizeof(u32) * 3 * desc->triangle_count);
+    memcpy(w->triangle_materials, desc->triangle_materials, sizeof(u32) * desc->triangle_count);
+    memcpy(w->materials, desc->materials, sizeof(material) * desc->material_count);
+
+    w->bounds = bounds3_empty();
+    for (u32 i = 0; i < w->vertex_count; ++i) {
+        w->bounds = bounds3_union_point(w->bounds, w->positions[i]);
+    }
+    w->light_count = 0;
+    for (u32 i = 0; i < w->triangle_count; ++i) {
+        ASSERT(w->triangle_materials[i] < w->material_count);
+        w->light_count += is_emissive(&w->materials[w->triangle_materials[i]]);
+    }
+    w->lights = (u32*)memory_allocate(sizeof(u32) * (w->light_count ? w->light_count : 1));
+    for (u32 i = 0, light = 0; i < w->triangle_count; ++i) {
+        if (is_emissive(&w->materials[w->triangle_materials[i]])) {
+            w->lights[light++] = i;
+        }
+    }
+    bvh_build_triangles(&w->tree, w->positions, w->indices, w->triangle_count, 0, pool);
+
+    w->light_sampling = desc->light_sampling;
+    memset(&w->light_tree, 0, sizeof(light_bvh));
+    if (w->light_sampling == LIGHT_SAMPLING_BVH && w->light_count) {
+        light_bounds* bounds = (light_bounds*)memory_allocate(sizeof(light_bounds) * w->light_count);
+        for (u32 i = 0; i < w->light_count; ++i) {
+            const u32* v = w->indices + 3 * (u64)w->lights[i];
+            vec3 emission = w->materials[w->triangle_materials[w->lights[i]]].emission;
+            f32 radiance = (emission.x + emission.y + emission.z) * (1.0f / 3.0f);
+            bounds[i] = light_bounds_triangle(w->positions[v[0]], w->positions[v[1]], w->positions[v[2]], radiance);
+        }
+        light_bvh_build(&w->light_tree, bounds, w->light_count, pool);
+        memory_free(bounds);
+    }
+}
+
+void world_destroy(world* w) {
+    bvh_destroy(&w->tree);
+    light_bvh_destroy(&w->light_tree);
+    memory_free(w->positions);
+    memory_free(w->indices);
+    memory_free(w->triangle_materials);
+    memory_free(w->materials);
+    memory_free(w->lights);
+    memset(w, 0, sizeof(world));
+}
+
+bool world_intersect(const world* w, const ray* r, f32 t_max, bvh_hit* hit) {
+    return bvh_intersect_triangles(&w->tree, w->positions, w->indices, r, t_max, hit);
+}
+
+bool world_occluded(const world* w, const ray* r, f32 t_max) {
+    return bvh_occluded_triangles(&w->tree, w->positions, w->indices, r, t_max);
+}
+
+void world_occluded_batch(const world* w, const ray* rays, const f32* t_max, u32 count, bool* occluded) {
+    bvh_occluded_triangles_batch(&w->tree, w->positions, w->indices, rays, t_max, count, occluded);
+}
+
+// ============================================================================
+// PATHS
+// ============================================================================
+
+// the unnormalized geometric normal, facing the side the triangle winds counter clockwise
+// from. its length is twice the area
+FORCE_INLINE vec3 triangle_normal(const world* w, u32 triangle, point3* p0, point3* p1, point3* p2) {
+    const u32* v = w->indices + 3 * (u64)triangle;
+    *p0 = w->positions[v[0]];
+    *p1 = w->positions[v[1]];
+    *p2 = w->positions[v[2]];
+    return vec3_cross(vec3_sub(*p1, *p0), vec3_sub(*p2, *p0));
+}
+
+// moves p off the surface along n far enough that the next ray does not hit it again
+FORCE_INLINE point3 offset_origin(point3 p, vec3 n) {
+    f32 epsilon = 1e-4f * (1.0f + vec3_max_component(vec3_abs(p)));
+    return vec3_madd(p, n, epsilon);
+}
+
+// next event estimation: a light chosen for p on a surface facing n, a point on it and the
+// solid angle pdf of the direction towards it. with an environment map it takes half of the
+// choices, or all of them without area lights. FALSE when no light was chosen or the point
+// faces away from p
+static bool sample_light(const world* w, point3 p, vec3 n, const f32* u, vec3* wi, f32* distance, vec3* radiance, f32* pdf) {
+    f32 u_light = u[0];
+    f32 area_pmf = 1.0f;
+    if (w->environment) {
+        f32 environment_pmf = w->light_count ? 0.5f : 1.0f;
+        if (u_light < environment_pmf) {
+            if (!environment_sample(w->environment, u[1], u[2], wi, radiance, pdf)) {
+                return FALSE;
+            }
+            *pdf *= environment_pmf;
+            *distance = MAX_F32;
+            return TRUE;
+        }
+        u_light = (u_light - environment_pmf) / (1.0f - environment_pmf);
+        area_pmf = 1.0f - environment_pmf;
+    }
+    u32 light;
+    f32 pmf;
+    if (w->light_sampling == LIGHT_SAMPLING_BVH) {
+        if (!light_bvh_sample(&w->light_tree, p, n, u_light, &light, &pmf)) {
+            return FALSE;
+        }
+    } else {
+        light = (u32)(u_light * (f32)w->light_count);
+        light = light < w->light_count ? light : w->light_count - 1;
+        pmf = 1.0f / (f32)w->light_count;
+    }
+    pmf *= area_pmf;
+    u32 triangle = w->lights[light];
+    point3 p0, p1, p2;
+    vec3 light_n = triangle_normal(w, triangle, &p0, &p1, &p2);
+    f32 root = sqrtf(u[1]);
+    f32 b0 = 1.0f - root;
+    f32 b1 = u[2] * root;
+    point3 q = vec3_add(vec3_add(vec3_scale(p0, b0), vec3_scale(p1, b1)), vec3_scale(p2, 1.0f - b0 - b1));
+
+    vec3 to_light = vec3_sub(q, p);
+    f32 distance_squared = vec3_length_squared(to_light);
+    f32 double_area = vec3_length(light_n);
+    if (distance_squared == 0 || double_area == 0) {
+        return FALSE;
+    }
+    *distance = sqrtf(distance_squared);
+    *wi = vec3_scale(to_light, 1.0f / *distance);
+    f32 cos_light = -vec3_dot(light_n, *wi) / double_area;
+    if (cos_light <= 0) {
+        return FALSE;
+    }
+    *radiance = w->materials[w->triangle_materials[triangle]].emission;
+    *pdf = distance_squared * pmf / (cos_light * 0.5f * double_area);
+    return TRUE;
+}
+
+bool integrator_shade(const world* w,
+                      path_state* path,
+                      const bvh_hit* hit,
+                      const f32* u,
+                      u32 max_depth,
+                      shadow_ray* shadow,
+                      bool* has_shadow) {
+    *has_shadow = FALSE;
+    point3 p0, p1, p2;
+    vec3 ng = vec3_normalize(triangle_normal(w, hit->prim_id, &p0, &p1, &p2));
+    const material* m = &w->materials[w->triangle_materials[hit->prim_id]];
+    vec3 wo = vec3_neg(path->r.d);
+    bool front = vec3_dot(ng, wo) > 0;
+    // lights hit after a diffuse bounce were already counted by next event estimation
+    if (front && (path->depth == 0 || path->specular) && is_emissive(m)) {
+        path->radiance = vec3_add(path->radiance, vec3_mul(path->throughput, m->emission));
+    }
+    if (path->depth >= max_depth) {
+        return FALSE;
+    }
+
+    const triangle_hit* h = &hit->triangle;
+    point3 p = vec3_add(vec3_add(vec3_scale(p0, h->b0), vec3_scale(p1, h->b1)), vec3_scale(p2, h->b2));
+    vec3 n = front ? ng : vec3_neg(ng);
+    point3 origin = offset_origin(p, n);
+    vec3 wi;
+    if (m->type == MATERIAL_MIRROR) {
+        wi = vec3_madd(path->r.d, n, -2.0f * vec3_dot(path->r.d, n));
+        path->specular = TRUE;
+    } else {
+        vec3 light_wi, radiance;
+        f32 distance, pdf;
+        if ((w->light_count || w->environment) && sample_light(w, origin, n, u, &light_wi, &distance, &radiance, &pdf)) {
+            f32 cos_surface = vec3_dot(n, light_wi);
+            if (cos_surface > 0) {
+                f32 scale = cos_surface * INV_PI / pdf;
+                shadow->r = ray_make(origin, light_wi);
+                shadow->t_max = distance * (1.0f - 1e-3f);
+                shadow->contribution = vec3_scale(vec3_mul(vec3_mul(path->throughput, m->albedo), radiance), scale);
+                *has_shadow = TRUE;
+            }
+        }
+        // cosine weighted, the cosine and 1 / pi of the bsdf cancel against the pdf
+        f32 r = sqrtf(u[3]);
+        f32 phi = 2.0f * PI * u[4];
+        vec3 s, t;
+        vec3_coordinate_system(n, &s, &t);
+        f32 z = sqrtf(maxf(0.0f, 1.0f - u[3]));
+        wi = vec3_add(vec3_add(vec3_scale(s, r * cosf(phi)), vec3_scale(t, r * sinf(phi))), vec3_scale(n, z));
+        path->specular = FALSE;
+    }
+    path->throughput = vec3_mul(path->throughput, m->albedo);
+    path->depth++;
+
+    if (path->depth >= INTEGRATOR_ROULETTE_DEPTH) {
+        f32 q = maxf(0.05f, 1.0f - vec3_max_component(path->throughput));
+        if (u[5] < q) {
+            return FALSE;
+        }
+        path->throughput = vec3_scale(path->throughput, 1.0f / (1.0f - q));
+    }
+    if (vec3_max_component(path->throughput) <= 0) {
+        return FALSE;
+    }
+    path->r = ray_make(origin, vec3_normalize(wi));
+    return TRUE;
+}
+
+void integrator_miss(const world* w, path_state* path) {
+    if (!w->environment) {
+        path->radiance = vec3_add(path->radiance, vec3_mul(path->throughput, w->background));
+    } else if (path->depth == 0 || path->specular) {
+        // like lights, after a diffuse bounce the environment was counted by next event estimation
+        vec3 radiance = environment_lookup(w->environment, path->r.d);
+        path->radiance = vec3_add(path->radiance, vec3_mul(path->throughput, radiance));
+    }
+}
+
+// ============================================================================
+// STATS
+// ============================================================================
+
+f64 integrator_rays_per_second(const integrator_stats* stats) {
+    u64 rays = stats->camera_rays + stats->bounce_rays + stats->shadow_rays;
+    return stats->seconds > 0 ? (f64)rays / stats->seconds : 0;
+}
+
+const char* integrator_stage_name(integrator_stage stage) {
+    switch (stage) {
+        case INTEGRATOR_STAGE_GENERATE:
+            return "generate";
+        case INTEGRATOR_STAGE_INTERSECT:
+            return "intersect";
+        case INTEGRATOR_STAGE_SORT:
+            return "sort";
+        case INTEGRATOR_STAGE_SHADE:
+            return "shade";
+        case INTEGRATOR_STAGE_SHADOW:
+            return "shadow";
+        case INTEGRATOR_STAGE_ACCUMULATE:
+            return "accumulate";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,197 @@
+#ifndef INTEGRATOR__H
+#define INTEGRATOR__H
+
+#include "defines.h"
+#include "vec3.h"
+#include "ray.h"
+#include "bounds3.h"
+#include "bvh.h"
+#include "light_bvh.h"
+#include "environment.h"
+#include "zpool.h"
+
+/***
+ *    ██ ███    ██ ████████ ███████  ██████  ██████   █████  ████████  ██████  ██████
+ *    ██ ████   ██    ██    ██      ██       ██   ██ ██   ██    ██    ██    ██ ██   ██
+ *    ██ ██ ██  ██    ██    █████   ██   ███ ██████  ███████    ██    ██    ██ ██████
+ *    ██ ██  ██ ██    ██    ██      ██    ██ ██   ██ ██   ██    ██    ██    ██ ██   ██
+ *    ██ ██   ████    ██    ███████  ██████  ██   ██ ██   ██    ██     ██████  ██   ██
+ *
+ *
+ */
+
+// what the path tracers share: a pinhole camera, a world of triangles with one material
+// each, the emissive triangles as area lights, an optional environment map around it all
+// and the work a path does at every bounce.
+// integrator_shade is the whole light transport of one bounce (emission, next event
+// estimation towards a light, russian roulette and the next direction), the integrators
+// only differ in how they schedule it, so they converge to the same image and with the
+// same sampler produce the same radiance for every sample.
+// every random decision of a bounce takes its value from the sampler, dimension
+// INTEGRATOR_FIRST_DIMENSION + depth * INTEGRATOR_BOUNCE_DIMENSIONS onwards
+
+typedef enum material_type {
+    // lambertian reflection of albedo
+    MATERIAL_DIFFUSE,
+    // perfect specular reflection tinted by albedo
+    MATERIAL_MIRROR,
+} material_type;
+
+typedef struct material {
+    vec3 albedo;
+    // radiance leaving the front face, the side the winding p0, p1, p2 is counter clockwise
+    // from. triangles with emission are area lights
+    vec3 emission;
+    material_type type;
+} material;
+
+typedef struct camera {
+    point3 position;
+    // the ray direction through the top left corner of the image and the steps to the
+    // next pixel along x and y
+    vec3 corner;
+    vec3 step_x;
+    vec3 step_y;
+    u32 width;
+    u32 height;
+} camera;
+
+// how next event estimation picks the light it connects to
+typedef enum light_sampling {
+    // walking a light_bvh, in proportion to what each light may contribute at the point
+    LIGHT_SAMPLING_BVH,
+    // every light equally likely
+    LIGHT_SAMPLING_UNIFORM,
+} light_sampling;
+
+// what a world is made from, world_create copies all of it
+typedef struct world_desc {
+    const point3* positions;
+    u32 vertex_count;
+    // three per triangle
+    const u32* indices;
+    u32 triangle_count;
+    // material index of every triangle
+    const u32* triangle_materials;
+    const material* materials;
+    u32 material_count;
+    // radiance of rays leaving the world
+    vec3 background;
+    light_sampling light_sampling;
+    // replaces background when not null. not copied, it must outlive the world
+    const environment_map* environment;
+} world_desc;
+
+typedef struct world {
+    point3* positions;
+    u32 vertex_count;
+    u32* indices;
+    u32 triangle_count;
+    u32* triangle_materials;
+    material* materials;
+    u32 material_count;
+    vec3 background;
+    bvh tree;
+    bounds3 bounds;
+    // the emissive triangles, light i of light_tree is lights[i]
+    u32* lights;
+    u32 light_count;
+    light_sampling light_sampling;
+    // built by world_create for LIGHT_SAMPLING_BVH
+    light_bvh light_tree;
+    const environment_map* environment;
+} world;
+
+// a path between bounces: the ray it continues along and what it carried so far
+typedef struct path_state {
+    ray r;
+    vec3 throughput;
+    vec3 radiance;
+    // bounces taken so far, 0 for camera rays
+    u32 depth;
+    // the last bounce was a mirror, so hitting a light counts (nee could not reach it)
+    bool specular;
+} path_state;
+
+// the connection next event estimation wants to a light, contribution is added to the
+// path's radiance when nothing lies in (0, t_max) along r
+typedef struct shadow_ray {
+    ray r;
+    vec3 contribution;
+    f32 t_max;
+} shadow_ray;
+
+typedef enum integrator_stage {
+    INTEGRATOR_STAGE_GENERATE,
+    INTEGRATOR_STAGE_INTERSECT,
+    INTEGRATOR_STAGE_SORT,
+    INTEGRATOR_STAGE_SHADE,
+    INTEGRATOR_STAGE_SHADOW,
+    INTEGRATOR_STAGE_ACCUMULATE,
+    INTEGRATOR_STAGE_COUNT,
+} integrator_stage;
+
+typedef struct integrator_stats {
+    u64 camera_rays;
+    // rays continuing paths after a bounce
+    u64 bounce_rays;
+    u64 shadow_rays;
+    // seconds spent in every stage. the wavefront integrator times each stage on the wall
+    // clock, the megakernel sums the time every thread spent in it, which can add up to
+    // more than seconds
+    f64 stage_seconds[INTEGRATOR_STAGE_COUNT];
+    // wall clock seconds of the whole render
+    f64 seconds;
+} integrator_stats;
+
+// camera rays take dimensions 0 and 1 for the position inside the pixel, bounces take the
+// following ones: light choice, point on the light (2), bsdf direction (2), russian roulette
+#define INTEGRATOR_FIRST_DIMENSION 2
+#define INTEGRATOR_BOUNCE_DIMENSIONS 6
+
+// paths survive russian roulette from this depth on
+#define INTEGRATOR_ROULETTE_DEPTH 3
+
+// a camera at eye looking at target with a vertical field of view of fov degrees, for an
+// image of width x height pixels
+void camera_look_at(camera* c, point3 eye, point3 target, vec3 up, f32 fov, u32 width, u32 height);
+
+// the normalized ray through raster position (x, y), pixels are one unit wide
+ray camera_generate_ray(const camera* c, f32 x, f32 y);
+
+// builds the bvh of the world on pool, which may be null
+void world_create(world* w, const world_desc* desc, zpool* pool);
+
+void world_destroy(world* w);
+
+// closest hit of r in (0, t_max)
+bool world_intersect(const world* w, const ray* r, f32 t_max, bvh_hit* hit);
+
+// whether anything lies along r in (0, t_max), stopping at the first thing found
+bool world_occluded(const world* w, const ray* r, f32 t_max);
+
+// occluded[i] = world_occluded(w, &rays[i], t_max[i]), neighboring rays traced as packets
+void world_occluded_batch(const world* w, const ray* rays, const f32* t_max, u32 count, bool* occluded);
+
+// the bounce of path at hit. adds the emission the path sees, prepares a shadow ray when
+// the surface samples a light (returning whether it did through has_shadow) and moves the
+// path on to its next ray. u holds the INTEGRATOR_BOUNCE_DIMENSIONS sample values of the
+// bounce. returns FALSE when the path ends
+bool integrator_shade(const world* w,
+                      path_state* path,
+                      const bvh_hit* hit,
+                      const f32* u,
+                      u32 max_depth,
+                      shadow_ray* shadow,
+                      bool* has_shadow);
+
+// a path leaving the world picks up the background, which no light sampling covers, or the
+// environment map where next event estimation did not already count it
+void integrator_miss(const world* w, path_state* path);
+
+// primary plus bounce plus shadow rays per second of render time
+f64 integrator_rays_per_second(const integrator_stats* stats);
+
+const char* integrator_stage_name(integrator_stage stage);
+
+#endif
@@ -0,0 +1,296 @@
+#include "light_bvh.h"
+#include <math.h>
+#include <string.h>
+#include "math_utils.h"
+#include "clock.h"
+#include "logger.h"
+#include "zatomic.h"
+#include "memory.h"
+
+// the largest f32 below 1, sample values are rescaled after every choice and must stay in [0, 1)
+#define ONE_MINUS_EPSILON 0x1.fffffep-1f
+
+// ============================================================================
+// BOUNDS
+// ============================================================================
+
+FORCE_INLINE vec3 bounds_axis(const light_bounds* b) {
+    return vec3_make(b->axis[0], b->axis[1], b->axis[2]);
+}
+
+FORCE_INLINE void set_axis(light_bounds* b, vec3 axis) {
+    b->axis[0] = axis.x;
+    b->axis[1] = axis.y;
+    b->axis[2] = axis.z;
+}
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of two angles in [0, pi]
+FORCE_INLINE f32 cos_sub_clamped(f32 sin_a, f32 cos_a, f32 sin_b, f32 cos_b) {
+    return cos_a > cos_b ? 1.0f : cos_a * cos_b + sin_a * sin_b;
+}
+
+FORCE_INLINE f32 sin_sub_clamped(f32 sin_a, f32 cos_a, f32 sin_b, f32 cos_b) {
+    return cos_a > cos_b ? 0.0f : sin_a * cos_b - cos_a * sin_b;
+}
+
+FORCE_INLINE f32 sin_of_cos(f32 cos_theta) {
+    return sqrtf(maxf(0.0f, 1.0f - cos_theta * cos_theta));
+}
+
+light_bounds light_bounds_triangle(point3 p0, point3 p1, point3 p2, f32 radiance) {
+    light_bounds b;
+    bounds3 box = bounds3_union_point(bounds3_make(p0, p1), p2);
+    for (u32 k = 0; k < 3; ++k) {
+        b.min[k] = box.min.e[k];
+        b.max[k] = box.max.e[k];
+    }
+    vec3 n = vec3_cross(vec3_sub(p1, p0), vec3_sub(p2, p0));
+    f32 double_area = vec3_length(n);
+    // a lambertian emitter sends out pi * radiance * area
+    b.phi = double_area > 0 ? PI * radiance * 0.5f * double_area : 0.0f;
+    set_axis(&b, double_area > 0 ? vec3_scale(n, 1.0f / double_area) : vec3_make(0, 0, 1));
+    // a flat light, every emitted direction within 90 degrees of its normal
+    b.cos_theta_o = 1.0f;
+    b.cos_theta_e = 0.0f;
+    return b;
+}
+
+// the smallest cone holding the cones around a and b (pbrt v4, DirectionCone Union)
+static void cone_union(vec3 a, f32 cos_a, vec3 b, f32 cos_b, vec3* axis, f32* cos_theta) {
+    f32 theta_a = acosf(clampf(cos_a, -1.0f, 1.0f));
+    f32 theta_b = acosf(clampf(cos_b, -1.0f, 1.0f));
+    f32 theta_d = acosf(clampf(vec3_dot(a, b), -1.0f, 1.0f));
+    if (minf(theta_d + theta_b, PI) <= theta_a) {
+        *axis = a;
+        *cos_theta = cos_a;
+        return;
+    }
+    if (minf(theta_d + theta_a, PI) <= theta_b) {
+        *axis = b;
+        *cos_theta = cos_b;
+        return;
+    }
+    f32 theta_o = 0.5f * (theta_a + theta_d + theta_b);
+    vec3 k = vec3_cross(a, b);
+    if (theta_o >= PI || vec3_length_squared(k) == 0) {
+        *axis = a;
+        *cos_theta = -1.0f;
+        return;
+    }
+    // rotate a towards b until the cone of half angle theta_o touches both
+    f32 theta_r = theta_o - theta_a;
+    k = vec3_normalize(k);
+    *axis = vec3_normalize(vec3_add(vec3_scale(a, cosf(theta_r)), vec3_scale(vec3_cross(k, a), sinf(theta_r))));
+    *cos_theta = cosf(theta_o);
+}
+
+light_bounds light_bounds_union(const light_bounds* a, const light_bounds* b) {
+    if (a->phi <= 0) {
+        return *b;
+    }
+    if (b->phi <= 0) {
+        return *a;
+    }
+    light_bounds u;
+    for (u32 k = 0; k < 3; ++k) {
+        u.min[k] = minf(a->min[k], b->min[k]);
+        u.max[k] = maxf(a->max[k], b->max[k]);
+    }
+    u.phi = a->phi + b->phi;
+    vec3 axis;
+    cone_union(bounds_axis(a), a->cos_theta_o, bounds_axis(b), b->cos_theta_o, &axis, &u.cos_theta_o);
+    set_axis(&u, axis);
+    u.cos_theta_e = minf(a->cos_theta_e, b->cos_theta_e);
+    return u;
+}
+
+f32 light_bounds_importance(const light_bounds* b, point3 p, vec3 n) {
+    if (b->phi <= 0) {
+        return 0.0f;
+    }
+    point3 lo = vec3_make(b->min[0], b->min[1], b->min[2]);
+    point3 hi = vec3_make(b->max[0], b->max[1], b->max[2]);
+    vec3 to_center = vec3_sub(vec3_scale(vec3_add(lo, hi), 0.5f), p);
+    f32 d2 = vec3_length_squared(to_center);
+    f32 radius2 = 0.25f * vec3_length_squared(vec3_sub(hi, lo));
+    // inside the bounding sphere the lights may lie in any direction
+    if (d2 <= radius2) {
+        return b->phi / radius2;
+    }
+    vec3 wi = vec3_scale(to_center, 1.0f / sqrtf(d2));
+    // every light is within theta_b of wi as seen from p
+    f32 sin2_b = radius2 / d2;
+    f32 sin_b = sqrtf(sin2_b);
+    f32 cos_b = sqrtf(1.0f - sin2_b);
+
+    // the smallest angle between an emitted direction and the way to p, theta_w - theta_o
+    // - theta_b clamped at 0. past theta_e no light leaves towards p
+    f32 cos_w = -vec3_dot(bounds_axis(b), wi);
+    f32 sin_w = sin_of_cos(cos_w);
+    f32 cos_o = b->cos_theta_o;
+    f32 sin_o = sin_of_cos(cos_o);
+    f32 cos_x = cos_sub_clamped(sin_w, cos_w, sin_o, cos_o);
+    f32 sin_x = sin_sub_clamped(sin_w, cos_w, sin_o, cos_o);
+    f32 cos_p = cos_sub_clamped(sin_x, cos_x, sin_b, cos_b);
+    if (cos_p <= b->cos_theta_e) {
+        return 0.0f;
+    }
+    // the smallest angle between n and a direction to the lights, theta_i - theta_b
+    f32 cos_i = vec3_dot(n, wi);
+    f32 cos_ip = cos_sub_clamped(sin_of_cos(cos_i), cos_i, sin_b, cos_b);
+    if (cos_ip <= 0) {
+        return 0.0f;
+    }
+    return b->phi * cos_p * cos_ip / d2;
+}
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+typedef struct light_build_job {
+    light_bvh* l;
+    const light_bounds* lights;
+    // the second child to finish computes the bounds of their parent
+    volatile u32* visits;
+} light_build_job;
+
+static void parents_task(void* params, u64 index, u32 thread_index) {
+    light_build_job* job = (light_build_job*)params;
+    const bvh_node* node = &job->l->tree.nodes[index];
+    job->visits[index] = 0;
+    if (!node->prim_count) {
+        job->l->parents[node->offset] = (u32)index;
+        job->l->parents[node->offset + 1] = (u32)index;
+    }
+}
+
+// writes a leaf and walks up while it is the second child to arrive at a parent
+static void bounds_task(void* params, u64 index, u32 thread_index) {
+    light_build_job* job = (light_build_job*)params;
+    light_bvh* l = job->l;
+    const bvh_node* node = &l->tree.nodes[index];
+    if (!node->prim_count) {
+        return;
+    }
+    ASSERT(node->prim_count == 1);
+    u32 light = l->tree.prim_indices[node->offset];
+    l->leaves[light] = (u32)index;
+    l->bounds[index] = job->lights[light];
+    u32 current = (u32)index;
+    while (current) {
+        u32 parent = l->parents[current];
+        // the atomic orders the sibling's writes before the reads below
+        if (zatomic_add_u32(&job->visits[parent], 1) != 1) {
+            return;
+        }
+        u32 first = l->tree.nodes[parent].offset;
+        l->bounds[parent] = light_bounds_union(&l->bounds[first], &l->bounds[first + 1]);
+        current = parent;
+    }
+}
+
+void light_bvh_build(light_bvh* out, const light_bounds* lights, u32 light_count, zpool* pool) {
+    clock clk;
+    clock_set(&clk);
+    memset(out, 0, sizeof(light_bvh));
+    out->light_count = light_count;
+    if (!light_count) {
+        return;
+    }
+    bounds3* boxes = (bounds3*)memory_allocate(sizeof(bounds3) * light_count);
+    for (u32 i = 0; i < light_count; ++i) {
+        boxes[i].min = vec3_make(lights[i].min[0], lights[i].min[1], lights[i].min[2]);
+        boxes[i].max = vec3_make(lights[i].max[0], lights[i].max[1], lights[i].max[2]);
+    }
+    bvh_build_options options;
+    bvh_build_options_default(&options);
+    options.max_leaf_size = 1;
+    bvh_build(&out->tree, boxes, light_count, &options, pool);
+    memory_free(boxes);
+
+    u32 node_count = out->tree.node_count;
+    out->bounds = (light_bounds*)memory_allocate_aligned(sizeof(light_bounds) * node_count, 64);
+    out->parents = (u32*)memory_allocate(sizeof(u32) * node_count);
+    out->leaves = (u32*)memory_allocate(sizeof(u32) * light_count);
+    out->parents[0] = 0;
+    light_build_job job;
+    job.l = out;
+    job.lights = lights;
+    job.visits = (volatile u32*)memory_allocate(sizeof(u32) * node_count);
+    zpool_parallel_for(pool, node_count, 0, parents_task, &job);
+    zpool_parallel_for(pool, node_count, 0, bounds_task, &job);
+    memory_free((void*)job.visits);
+    clock_update(&clk);
+    out->build_seconds = clk.elapsed;
+}
+
+void light_bvh_destroy(light_bvh* l) {
+    if (l->light_count) {
+        bvh_destroy(&l->tree);
+        memory_free_aligned(l->bounds);
+        memory_free(l->parents);
+        memory_free(l->leaves);
+    }
+    memset(l, 0, sizeof(light_bvh));
+}
+
+// ============================================================================
+// SAMPLING
+// ============================================================================
+
+bool light_bvh_sample(const light_bvh* l, point3 p, vec3 n, f32 u, u32* light, f32* pmf) {
+    if (!l->light_count) {
+        return FALSE;
+    }
+    const bvh_node* nodes = l->tree.nodes;
+    // below the root a node is only reached when its importance is positive
+    if (light_bounds_importance(&l->bounds[0], p, n) <= 0) {
+        return FALSE;
+    }
+    u32 index = 0;
+    f32 probability = 1.0f;
+    while (!nodes[index].prim_count) {
+        u32 first = nodes[index].offset;
+        f32 left = light_bounds_importance(&l->bounds[first], p, n);
+        f32 right = light_bounds_importance(&l->bounds[first + 1], p, n);
+        if (left <= 0 && right <= 0) {
+            return FALSE;
+        }
+        f32 p_left = left / (left + right);
+        if (u < p_left) {
+            u = minf(u / p_left, ONE_MINUS_EPSILON);
+            probability *= p_left;
+            index = first;
+        } else {
+            u = minf((u - p_left) / (1.0f - p_left), ONE_MINUS_EPSILON);
+            probability *= 1.0f - p_left;
+            index = first + 1;
+        }
+    }
+    *light = l->tree.prim_indices[nodes[index].offset];
+    *pmf = probability;
+    return TRUE;
+}
+
+f32 light_bvh_pmf(const light_bvh* l, point3 p, vec3 n, u32 light) {
+    ASSERT(light < l->light_count);
+    u32 index = l->leaves[light];
+    if (light_bounds_importance(&l->bounds[index], p, n) <= 0) {
+        return 0.0f;
+    }
+    f32 pmf = 1.0f;
+    while (index) {
+        u32 parent = l->parents[index];
+        u32 first = l->tree.nodes[parent].offset;
+        f32 left = light_bounds_importance(&l->bounds[first], p, n);
+        f32 right = light_bounds_importance(&l->bounds[first + 1], p, n);
+        f32 mine = index == first ? left : right;
+        if (mine <= 0) {
+            return 0.0f;
+        }
+        pmf *= mine / (left + right);
+        index = parent;
+    }
+    return pmf;
+}
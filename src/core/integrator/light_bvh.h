@@ -0,0 +1,81 @@
+#ifndef LIGHT_BVH__H
+#define LIGHT_BVH__H
+
+#include "defines.h"
+#include "vec3.h"
+#include "bounds3.h"
+#include "bvh.h"
+#include "zpool.h"
+
+/***
+ *    ██      ██  ██████  ██   ██ ████████     ██████  ██    ██ ██   ██
+ *    ██      ██ ██       ██   ██    ██        ██   ██ ██    ██ ██   ██
+ *    ██      ██ ██   ███ ███████    ██        ██████  ██    ██ ███████
+ *    ██      ██ ██    ██ ██   ██    ██        ██   ██  ██  ██  ██   ██
+ *    ███████ ██  ██████  ██   ██    ██        ██████    ████   ██   ██
+ *
+ *
+ */
+
+// many light sampling (conty estevez and kulla 2018, as in pbrt v4): a hierarchy over the
+// lights where every node bounds the position, power and emitted directions of the lights
+// below it. sampling walks down from the root, picking each child with probability
+// proportional to an estimate of how much its lights can contribute at the shading point:
+// power over squared distance, scaled by how far the point lies outside the cone of
+// emitted directions and how far the lights lie below the surface. the estimate is
+// conservative, a light that can reach the point never gets probability 0, so sampling
+// with it is unbiased.
+// the topology is a sah bvh over the light bounds with one light per leaf (bvh_build),
+// the node bounds are filled in bottom up by the leaves, both on the pool
+
+// where a light or a group of lights sits, how much power it emits and in which
+// directions: every emitted direction makes at most theta_o + theta_e with axis, and
+// theta_o alone bounds the normals. 48 bytes
+typedef struct light_bounds {
+    f32 min[3];
+    // 0 for nodes without lights
+    f32 phi;
+    f32 max[3];
+    f32 cos_theta_o;
+    f32 axis[3];
+    f32 cos_theta_e;
+} light_bounds;
+
+typedef struct light_bvh {
+    // leaves hold one light each, prim_indices maps them back to the input order
+    bvh tree;
+    // per node of tree
+    light_bounds* bounds;
+    // per node of tree, the root is its own parent
+    u32* parents;
+    // per light, the leaf holding it
+    u32* leaves;
+    u32 light_count;
+    f64 build_seconds;
+} light_bvh;
+
+// a one sided area light emitting radiance from the side the winding p0, p1, p2 is counter
+// clockwise from (the integrator's emissive triangles). radiance is its average over the
+// color channels
+light_bounds light_bounds_triangle(point3 p0, point3 p1, point3 p2, f32 radiance);
+
+// the smallest bounds holding both, lights with phi 0 are left out
+light_bounds light_bounds_union(const light_bounds* a, const light_bounds* b);
+
+// the estimate the tree samples with, of what the lights in b contribute at p on a surface
+// with normal n, counting only light arriving from the side n points to
+f32 light_bounds_importance(const light_bounds* b, point3 p, vec3 n);
+
+// builds over light_count lights, light i bounded by lights[i]. pool may be null
+void light_bvh_build(light_bvh* out, const light_bounds* lights, u32 light_count, zpool* pool);
+
+void light_bvh_destroy(light_bvh* l);
+
+// picks a light for the point p with normal n using u in [0, 1), returning its index and
+// the probability it was picked with. FALSE when no light can reach p
+bool light_bvh_sample(const light_bvh* l, point3 p, vec3 n, f32 u, u32* light, f32* pmf);
+
+// the probability light_bvh_sample picks light at p with normal n
+f32 light_bvh_pmf(const light_bvh* l, point3 p, vec3 n, u32 light);
+
+#endif
@@ -0,0 +1,135 @@
+#include "megakernel.h"
+#include <string.h>
+#include "clock.h"
+#include "simd.h"
+#include "logger.h"
+#include "memory.h"
+
+void megakernel_options_default(megakernel_options* options) {
+    options->samples_per_pixel = 16;
+    options->max_depth = 8;
+    options->order = RENDER_ORDER_CENTER_OUT;
+    options->seed = 0;
+    options->sampler = 0;
+    options->time_stages = FALSE;
+}
+
+// what one thread counted, a cache line of its own
+typedef struct megakernel_counters {
+    u64 bounce_rays;
+    u64 shadow_rays;
+    f64 stage_seconds[INTEGRATOR_STAGE_COUNT];
+} ALIGN(64) megakernel_counters;
+
+typedef struct megakernel_job {
+    const world* w;
+    const camera* c;
+    const megakernel_options* options;
+    megakernel_counters* counters;
+} megakernel_job;
+
+FORCE_INLINE void stage_end(clock* clk, megakernel_counters* counters, integrator_stage stage, bool timed) {
+    if (timed) {
+        clock_update(clk);
+        counters->stage_seconds[stage] += clk->elapsed;
+        clock_set(clk);
+    }
+}
+
+static void megakernel_sample(void* params, const render_sample* sample, f32* rgb) {
+    megakernel_job* job = (megakernel_job*)params;
+    megakernel_counters* counters = &job->counters[sample->thread_index];
+    bool timed = job->options->time_stages;
+    clock clk = {0, 0};
+    if (timed) {
+        clock_set(&clk);
+    }
+    path_state path;
+    path.r = camera_generate_ray(job->c, sample->film_x, sample->film_y);
+    path.throughput = vec3_splat(1.0f);
+    path.radiance = vec3_zero();
+    path.depth = 0;
+    path.specular = FALSE;
+    stage_end(&clk, counters, INTEGRATOR_STAGE_GENERATE, timed);
+
+    for (;;) {
+        bvh_hit hit;
+        bool found = world_intersect(job->w, &path.r, MAX_F32, &hit);
+        stage_end(&clk, counters, INTEGRATOR_STAGE_INTERSECT, timed);
+        if (!found) {
+            integrator_miss(job->w, &path);
+            break;
+        }
+        u32 dimension = INTEGRATOR_FIRST_DIMENSION + path.depth * INTEGRATOR_BOUNCE_DIMENSIONS;
+        f32 u[INTEGRATOR_BOUNCE_DIMENSIONS];
+        for (u32 d = 0; d < INTEGRATOR_BOUNCE_DIMENSIONS; ++d) {
+            u[d] = sampler_get(sample->sampler, sample->x, sample->y, sample->index, dimension + d);
+        }
+        shadow_ray shadow;
+        bool has_shadow;
+        bool alive = integrator_shade(job->w, &path, &hit, u, job->options->max_depth, &shadow, &has_shadow);
+        stage_end(&clk, counters, INTEGRATOR_STAGE_SHADE, timed);
+        if (has_shadow) {
+            counters->shadow_rays++;
+            if (!world_occluded(job->w, &shadow.r, shadow.t_max)) {
+                path.radiance = vec3_add(path.radiance, shadow.contribution);
+            }
+            stage_end(&clk, counters, INTEGRATOR_STAGE_SHADOW, timed);
+        }
+        if (!alive) {
+            break;
+        }
+        counters->bounce_rays++;
+    }
+    rgb[0] = path.radiance.x;
+    rgb[1] = path.radiance.y;
+    rgb[2] = path.radiance.z;
+}
+
+void megakernel_render(film* f,
+                       const world* w,
+                       const camera* c,
+                       const megakernel_options* options,
+                       zpool* pool,
+                       integrator_stats* stats) {
+    clock total;
+    clock_set(&total);
+    megakernel_options defaults;
+    if (!options) {
+        megakernel_options_default(&defaults);
+        options = &defaults;
+    }
+    integrator_stats local_stats;
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(integrator_stats));
+    ASSERT(options->samples_per_pixel);
+    ASSERT(c->width == f->width && c->height == f->height);
+
+    u32 thread_count = pool ? zpool_thread_count(pool) : 1;
+    megakernel_counters* counters =
+        (megakernel_counters*)memory_allocate_aligned(sizeof(megakernel_counters) * thread_count, 64);
+    memset(counters, 0, sizeof(megakernel_counters) * thread_count);
+    megakernel_job job = {w, c, options, counters};
+
+    render_options render;
+    render_options_default(&render);
+    render.samples_per_pixel = options->samples_per_pixel;
+    render.order = options->order;
+    render.seed = options->seed;
+    render.sampler = options->sampler;
+    render_film(f, &render, megakernel_sample, &job, pool);
+
+    stats->camera_rays = (u64)f->width * f->height * options->samples_per_pixel;
+    for (u32 i = 0; i < thread_count; ++i) {
+        stats->bounce_rays += counters[i].bounce_rays;
+        stats->shadow_rays += counters[i].shadow_rays;
+        for (u32 stage = 0; stage < INTEGRATOR_STAGE_COUNT; ++stage) {
+            stats->stage_seconds[stage] += counters[i].stage_seconds[stage];
+        }
+    }
+    memory_free_aligned(counters);
+    clock_update(&total);
+    stats->seconds = total.elapsed;
+}
@@ -0,0 +1,55 @@
+#ifndef MEGAKERNEL__H
+#define MEGAKERNEL__H
+
+#include "defines.h"
+#include "integrator.h"
+#include "film.h"
+#include "render.h"
+#include "sampler.h"
+#include "zpool.h"
+
+/***
+ *    ███    ███ ███████  ██████   █████  ██   ██ ███████ ██████  ███    ██ ███████ ██
+ *    ████  ████ ██      ██       ██   ██ ██  ██  ██      ██   ██ ████   ██ ██      ██
+ *    ██ ████ ██ █████   ██   ███ ███████ █████   █████   ██████  ██ ██  ██ █████   ██
+ *    ██  ██  ██ ██      ██    ██ ██   ██ ██  ██  ██      ██   ██ ██  ██ ██ ██      ██
+ *    ██      ██ ███████  ██████  ██   ██ ██   ██ ███████ ██   ██ ██   ████ ███████ ███████
+ *
+ *
+ */
+
+// the reference path tracer: every sample follows its path to the end in one loop,
+// intersecting, shading and tracing the shadow ray of each bounce before the next, with
+// tiles handed to the pool by the render driver. it does exactly the work of the wavefront
+// integrator (the same integrator_shade on the same sample values), so the two produce the
+// same image and their stats compare architectures, not algorithms.
+// per stage times cost two clock reads per stage and bounce, so they are only taken when
+// asked for, rays per second are measured either way
+
+typedef struct megakernel_options {
+    u32 samples_per_pixel;
+    // bounces a path may take, 0 renders what the camera sees directly
+    u32 max_depth;
+    render_tile_order order;
+    u64 seed;
+    // sampler of the image, null samples independently with seed
+    const sampler* sampler;
+    // fill integrator_stats.stage_seconds with per thread seconds summed over the threads,
+    // which slows rendering down a little
+    bool time_stages;
+} megakernel_options;
+
+// 16 samples per pixel, 8 bounces, center out, no stage times
+void megakernel_options_default(megakernel_options* options);
+
+// renders w through c into f, accumulating on top of what the film holds. options, pool and
+// stats may be null, stats is overwritten with the counts and times of this render. stage
+// times are summed over threads
+void megakernel_render(film* f,
+                       const world* w,
+                       const camera* c,
+                       const megakernel_options* options,
+                       zpool* pool,
+                       integrator_stats* stats);
+
+#endif
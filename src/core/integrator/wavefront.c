@@ -0,0 +1,523 @@
+#include "wavefront.h"
+#include <string.h>
+#include "arena.h"
+#include "clock.h"
+#include "math_utils.h"
+#include "logger.h"
+#include "memory.h"
+
+// material keys wrap at this many materials, the sort only needs equal materials adjacent
+#define SHADE_MATERIAL_KEYS 512
+// the shade queue: material * 8 + octant of the incoming direction, misses last
+#define SHADE_BUCKETS (SHADE_MATERIAL_KEYS * 8 + 1)
+// rays: direction bin (octant * 3 + dominant axis) * RAY_CELLS + origin cell
+#define RAY_CELLS_PER_AXIS 4
+#define RAY_CELLS (RAY_CELLS_PER_AXIS * RAY_CELLS_PER_AXIS * RAY_CELLS_PER_AXIS)
+#define RAY_BUCKETS (24 * RAY_CELLS)
+#define MAX_SORT_BLOCKS 64
+// queue entries a sort block and a shading batch cover
+#define SORT_BLOCK_SIZE 8192
+#define SHADE_BATCH 64
+#define SHADOW_BATCH 64
+
+void wavefront_options_default(wavefront_options* options) {
+    options->samples_per_pixel = 16;
+    options->max_depth = 8;
+    options->wave_size = 1u << 16;
+    options->sort = FALSE;
+    options->order = RENDER_ORDER_CENTER_OUT;
+    options->seed = 0;
+    options->sampler = 0;
+}
+
+// what a path carries between bounces, its ray lives in the queues
+typedef struct wavefront_path {
+    path_state state;
+    f32 film_x;
+    f32 film_y;
+    u32 x;
+    u32 y;
+    u32 index;
+} wavefront_path;
+
+// rays in flight and the path each belongs to. queues are sorted by moving the entries
+// themselves, so every stage reads its queue front to back
+typedef struct ray_queue {
+    u32* paths;
+    ray* rays;
+    bvh_hit* hits;
+    u32 count;
+} ray_queue;
+
+// bvh_hit.prim_id of rays that left the world
+#define WAVEFRONT_MISS 0xffffffffu
+
+typedef struct wavefront_job {
+    film* f;
+    const world* w;
+    const camera* c;
+    const wavefront_options* options;
+    const sampler* sampler;
+    arena* arenas;
+    // the tiles of the current wave and the first path of each, plus the end
+    const u32* tiles;
+    u32* tile_offsets;
+    wavefront_path* paths;
+    // the rays being traced and the queue sorts gather into
+    ray_queue queue;
+    ray_queue scratch;
+    // what shading produced for every entry of queue, in its order
+    ray* next_rays;
+    shadow_ray* shadows;
+    // the shadow rays to trace and their paths
+    u32* shadow_paths;
+    shadow_ray* shadow_queue;
+    u32 shadow_count;
+    // sort keys in queue order, keys >= the bucket count drop the entry
+    u32* keys;
+    u32* next_keys;
+    u32* shadow_keys;
+    // queue position of every sorted entry
+    u32* order;
+    // dimension the current bounce starts at
+    u32 dimension;
+    // origin cell of a point is (p - bounds.min) * cell_scale per axis
+    point3 cell_origin;
+    vec3 cell_scale;
+} wavefront_job;
+
+// ============================================================================
+// SORT
+// ============================================================================
+
+typedef struct sort_job {
+    const u32* keys;
+    u32* order;
+    u32 count;
+    u32 bucket_count;
+    u32 block_count;
+    // bucket counts of every block, then where every block's entries of a bucket go
+    u32* offsets;
+} sort_job;
+
+static void sort_count_task(void* params, u64 index, u32 thread_index) {
+    sort_job* job = (sort_job*)params;
+    u32 begin = (u32)((u64)job->count * index / job->block_count);
+    u32 end = (u32)((u64)job->count * (index + 1) / job->block_count);
+    u32* counts = job->offsets + index * job->bucket_count;
+    memset(counts, 0, sizeof(u32) * job->bucket_count);
+    for (u32 i = begin; i < end; ++i) {
+        u32 key = job->keys[i];
+        if (key < job->bucket_count) {
+            counts[key]++;
+        }
+    }
+}
+
+static void sort_scatter_task(void* params, u64 index, u32 thread_index) {
+    sort_job* job = (sort_job*)params;
+    u32 begin = (u32)((u64)job->count * index / job->block_count);
+    u32 end = (u32)((u64)job->count * (index + 1) / job->block_count);
+    u32* offsets = job->offsets + index * job->bucket_count;
+    for (u32 i = begin; i < end; ++i) {
+        u32 key = job->keys[i];
+        if (key < job->bucket_count) {
+            job->order[offsets[key]++] = i;
+        }
+    }
+}
+
+// stable counting sort of the count positions by keys, dropping positions keyed past
+// bucket_count: order receives the kept positions in sorted order. blocks are counted and
+// scattered in parallel, and since entries keep their order inside a bucket the result does
+// not depend on how many blocks there were. returns the positions kept
+static u32 queue_sort(const u32* keys, u32 count, u32 bucket_count, u32* offsets, u32* order, zpool* pool) {
+    if (!count) {
+        return 0;
+    }
+    u32 block_count = (count + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE;
+    block_count = block_count < MAX_SORT_BLOCKS ? block_count : MAX_SORT_BLOCKS;
+    sort_job job = {keys, order, count, bucket_count, block_count, offsets};
+    zpool_parallel_for(pool, block_count, 1, sort_count_task, &job);
+    // bucket major, so a bucket's entries from earlier blocks go first
+    u32 total = 0;
+    for (u32 bucket = 0; bucket < bucket_count; ++bucket) {
+        for (u32 block = 0; block < block_count; ++block) {
+            u32* slot = &offsets[block * bucket_count + bucket];
+            u32 n = *slot;
+            *slot = total;
+            total += n;
+        }
+    }
+    zpool_parallel_for(pool, block_count, 1, sort_scatter_task, &job);
+    return total;
+}
+
+// the gathers moving queue entries into sorted order
+static void gather_hits_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    u32 from = job->order[index];
+    job->scratch.paths[index] = job->queue.paths[from];
+    job->scratch.rays[index] = job->queue.rays[from];
+    job->scratch.hits[index] = job->queue.hits[from];
+}
+
+static void gather_next_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    u32 from = job->order[index];
+    job->scratch.paths[index] = job->queue.paths[from];
+    job->scratch.rays[index] = job->next_rays[from];
+}
+
+static void gather_shadows_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    u32 from = job->order[index];
+    job->shadow_paths[index] = job->queue.paths[from];
+    job->shadow_queue[index] = job->shadows[from];
+}
+
+FORCE_INLINE void queue_swap(wavefront_job* job, u32 count) {
+    ray_queue sorted = job->scratch;
+    job->scratch = job->queue;
+    job->queue = sorted;
+    job->queue.count = count;
+}
+
+FORCE_INLINE u32 direction_octant(vec3 d) {
+    return (u32)(d.x < 0) | ((u32)(d.y < 0) << 1) | ((u32)(d.z < 0) << 2);
+}
+
+FORCE_INLINE u32 cell_coordinate(f32 v) {
+    return v <= 0 ? 0 : (v >= RAY_CELLS_PER_AXIS - 1 ? RAY_CELLS_PER_AXIS - 1 : (u32)v);
+}
+
+// rays in one bucket leave about the same region in about the same direction
+static u32 ray_key(const wavefront_job* job, const ray* r) {
+    u32 bin = direction_octant(r->d) * 3 + vec3_max_dimension(vec3_abs(r->d));
+    vec3 cell = vec3_mul(vec3_sub(r->o, job->cell_origin), job->cell_scale);
+    u32 x = cell_coordinate(cell.x), y = cell_coordinate(cell.y), z = cell_coordinate(cell.z);
+    return bin * RAY_CELLS + x + RAY_CELLS_PER_AXIS * (y + RAY_CELLS_PER_AXIS * z);
+}
+
+// ============================================================================
+// STAGES
+// ============================================================================
+
+static void generate_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    arena* a = &job->arenas[thread_index];
+    u32 spp = job->options->samples_per_pixel;
+    f32* offsets_x = ARENA_ALLOCATE_ARRAY(a, f32, spp);
+    f32* offsets_y = ARENA_ALLOCATE_ARRAY(a, f32, spp);
+    const film* f = job->f;
+    u32 tile = job->tiles[index];
+    u32 x0 = (tile % f->tiles_x) * f->tile_size, y0 = (tile / f->tiles_x) * f->tile_size;
+    u32 x1 = x0 + f->tile_size < f->width ? x0 + f->tile_size : f->width;
+    u32 y1 = y0 + f->tile_size < f->height ? y0 + f->tile_size : f->height;
+    u32 p = job->tile_offsets[index];
+    for (u32 y = y0; y < y1; ++y) {
+        for (u32 x = x0; x < x1; ++x) {
+            sampler_generate(job->sampler, x, y, 0, spp, 0, offsets_x);
+            sampler_generate(job->sampler, x, y, 0, spp, 1, offsets_y);
+            for (u32 i = 0; i < spp; ++i, ++p) {
+                wavefront_path* path = &job->paths[p];
+                path->x = x;
+                path->y = y;
+                path->index = i;
+                path->film_x = (f32)x + offsets_x[i];
+                path->film_y = (f32)y + offsets_y[i];
+                path->state.throughput = vec3_splat(1.0f);
+                path->state.radiance = vec3_zero();
+                path->state.depth = 0;
+                path->state.specular = FALSE;
+                job->queue.paths[p] = p;
+                job->queue.rays[p] = camera_generate_ray(job->c, path->film_x, path->film_y);
+            }
+        }
+    }
+    arena_reset(a);
+}
+
+static void intersect_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    const ray* r = &job->queue.rays[index];
+    bvh_hit* hit = &job->queue.hits[index];
+    if (!world_intersect(job->w, r, MAX_F32, hit)) {
+        hit->prim_id = WAVEFRONT_MISS;
+    }
+    if (!job->options->sort) {
+        return;
+    }
+    if (hit->prim_id != WAVEFRONT_MISS) {
+        u32 material = job->w->triangle_materials[hit->prim_id] % SHADE_MATERIAL_KEYS;
+        job->keys[index] = material * 8 + direction_octant(r->d);
+    } else {
+        job->keys[index] = SHADE_BUCKETS - 1;
+    }
+}
+
+static void shade_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    const ray_queue* queue = &job->queue;
+    u32 begin = (u32)index * SHADE_BATCH;
+    u32 count = queue->count - begin < SHADE_BATCH ? queue->count - begin : SHADE_BATCH;
+    // the sample values of the whole batch, one dimension at a time
+    u32 xs[SHADE_BATCH], ys[SHADE_BATCH], indices[SHADE_BATCH];
+    f32 u[INTEGRATOR_BOUNCE_DIMENSIONS][SHADE_BATCH];
+    for (u32 i = 0; i < count; ++i) {
+        const wavefront_path* path = &job->paths[queue->paths[begin + i]];
+        xs[i] = path->x;
+        ys[i] = path->y;
+        indices[i] = path->index;
+    }
+    for (u32 d = 0; d < INTEGRATOR_BOUNCE_DIMENSIONS; ++d) {
+        sampler_generate_batch(job->sampler, xs, ys, indices, count, job->dimension + d, u[d]);
+    }
+
+    bool sort = job->options->sort;
+    for (u32 i = 0; i < count; ++i) {
+        u32 position = begin + i;
+        path_state* state = &job->paths[queue->paths[position]].state;
+        state->r = queue->rays[position];
+        job->next_keys[position] = RAY_BUCKETS;
+        job->shadow_keys[position] = RAY_BUCKETS;
+        const bvh_hit* hit = &queue->hits[position];
+        if (hit->prim_id == WAVEFRONT_MISS) {
+            integrator_miss(job->w, state);
+            continue;
+        }
+        f32 values[INTEGRATOR_BOUNCE_DIMENSIONS];
+        for (u32 d = 0; d < INTEGRATOR_BOUNCE_DIMENSIONS; ++d) {
+            values[d] = u[d][i];
+        }
+        shadow_ray* shadow = &job->shadows[position];
+        bool has_shadow;
+        bool alive = integrator_shade(job->w, state, hit, values, job->options->max_depth, shadow, &has_shadow);
+        if (has_shadow) {
+            job->shadow_keys[position] = sort ? ray_key(job, &shadow->r) : 0;
+        }
+        if (alive) {
+            job->next_rays[position] = state->r;
+            job->next_keys[position] = sort ? ray_key(job, &state->r) : 0;
+        }
+    }
+}
+
+static void shadow_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    u32 begin = (u32)index * SHADOW_BATCH;
+    u32 count = job->shadow_count - begin < SHADOW_BATCH ? job->shadow_count - begin : SHADOW_BATCH;
+    ray rays[SHADOW_BATCH];
+    f32 t_max[SHADOW_BATCH];
+    bool occluded[SHADOW_BATCH];
+    // every task has at least one shadow ray
+    u32 i = 0;
+    do {
+        rays[i] = job->shadow_queue[begin + i].r;
+        t_max[i] = job->shadow_queue[begin + i].t_max;
+    } while (++i < count);
+    world_occluded_batch(job->w, rays, t_max, count, occluded);
+    for (i = 0; i < count; ++i) {
+        if (!occluded[i]) {
+            path_state* state = &job->paths[job->shadow_paths[begin + i]].state;
+            state->radiance = vec3_add(state->radiance, job->shadow_queue[begin + i].contribution);
+        }
+    }
+}
+
+static void accumulate_task(void* params, u64 index, u32 thread_index) {
+    wavefront_job* job = (wavefront_job*)params;
+    film* f = job->f;
+    arena* a = &job->arenas[thread_index];
+    film_tile tile;
+    film_tile_begin(f, job->tiles[index], a, &tile);
+    for (u32 i = job->tile_offsets[index]; i < job->tile_offsets[index + 1]; ++i) {
+        const wavefront_path* path = &job->paths[i];
+        f32 rgb[3] = {path->state.radiance.x, path->state.radiance.y, path->state.radiance.z};
+        film_tile_add_sample(f, &tile, path->film_x, path->film_y, rgb);
+        if (f->stats) {
+            film_record_sample(f, path->x, path->y, rgb);
+        }
+    }
+    film_tile_merge(f, &tile);
+    arena_reset(a);
+}
+
+// ============================================================================
+// DRIVER
+// ============================================================================
+
+FORCE_INLINE void stage_end(clock* clk, integrator_stats* stats, integrator_stage stage) {
+    clock_update(clk);
+    stats->stage_seconds[stage] += clk->elapsed;
+    clock_set(clk);
+}
+
+// traces the paths of the tiles set up in job until every one of them ended
+static void render_wave(wavefront_job* job, u32 tile_count, u32* offsets, zpool* pool, integrator_stats* stats) {
+    clock clk;
+    clock_set(&clk);
+    zpool_parallel_for(pool, tile_count, 1, generate_task, job);
+    job->queue.count = job->tile_offsets[tile_count];
+    stats->camera_rays += job->queue.count;
+    stage_end(&clk, stats, INTEGRATOR_STAGE_GENERATE);
+
+    bool sort = job->options->sort;
+    for (u32 depth = 0; job->queue.count; ++depth) {
+        job->dimension = INTEGRATOR_FIRST_DIMENSION + depth * INTEGRATOR_BOUNCE_DIMENSIONS;
+        if (depth) {
+            stats->bounce_rays += job->queue.count;
+        }
+        zpool_parallel_for(pool, job->queue.count, 256, intersect_task, job);
+        stage_end(&clk, stats, INTEGRATOR_STAGE_INTERSECT);
+
+        if (sort) {
+            u32 count = queue_sort(job->keys, job->queue.count, SHADE_BUCKETS, offsets, job->order, pool);
+            zpool_parallel_for(pool, count, 1024, gather_hits_task, job);
+            queue_swap(job, count);
+            stage_end(&clk, stats, INTEGRATOR_STAGE_SORT);
+        }
+
+        u32 batches = (job->queue.count + SHADE_BATCH - 1) / SHADE_BATCH;
+        zpool_parallel_for(pool, batches, 4, shade_task, job);
+        stage_end(&clk, stats, INTEGRATOR_STAGE_SHADE);
+
+        u32 ray_buckets = sort ? RAY_BUCKETS : 1;
+        job->shadow_count = queue_sort(job->shadow_keys, job->queue.count, ray_buckets, offsets, job->order, pool);
+        zpool_parallel_for(pool, job->shadow_count, 1024, gather_shadows_task, job);
+        stage_end(&clk, stats, INTEGRATOR_STAGE_SORT);
+
+        zpool_parallel_for(pool, (job->shadow_count + SHADOW_BATCH - 1) / SHADOW_BATCH, 4, shadow_task, job);
+        stats->shadow_rays += job->shadow_count;
+        stage_end(&clk, stats, INTEGRATOR_STAGE_SHADOW);
+
+        u32 count = queue_sort(job->next_keys, job->queue.count, ray_buckets, offsets, job->order, pool);
+        zpool_parallel_for(pool, count, 1024, gather_next_task, job);
+        queue_swap(job, count);
+        stage_end(&clk, stats, INTEGRATOR_STAGE_SORT);
+    }
+
+    zpool_parallel_for(pool, tile_count, 1, accumulate_task, job);
+    stage_end(&clk, stats, INTEGRATOR_STAGE_ACCUMULATE);
+}
+
+void wavefront_render(film* f,
+                      const world* w,
+                      const camera* c,
+                      const wavefront_options* options,
+                      zpool* pool,
+                      integrator_stats* stats) {
+    clock total;
+    clock_set(&total);
+    wavefront_options defaults;
+    if (!options) {
+        wavefront_options_default(&defaults);
+        options = &defaults;
+    }
+    integrator_stats local_stats;
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(integrator_stats));
+    ASSERT(options->samples_per_pixel);
+    ASSERT(c->width == f->width && c->height == f->height);
+
+    sampler independent;
+    const sampler* samples = options->sampler;
+    if (!samples) {
+        sampler_options sampler_defaults;
+        sampler_options_default(&sampler_defaults, f->width, f->height);
+        sampler_defaults.type = SAMPLER_INDEPENDENT;
+        sampler_defaults.samples_per_pixel = options->samples_per_pixel;
+        sampler_defaults.seed = options->seed;
+        sampler_create(&independent, &sampler_defaults);
+        samples = &independent;
+    }
+    ASSERT(samples->width == f->width && samples->height == f->height);
+
+    u32* tiles = (u32*)memory_allocate(sizeof(u32) * f->tile_count);
+    render_schedule_tiles(f, options->order, tiles);
+    u32 tile_paths = f->tile_size * f->tile_size * options->samples_per_pixel;
+    u32 tiles_per_wave = options->wave_size / tile_paths;
+    tiles_per_wave = tiles_per_wave ? tiles_per_wave : 1;
+    tiles_per_wave = tiles_per_wave < f->tile_count ? tiles_per_wave : f->tile_count;
+    u32 capacity = tiles_per_wave * tile_paths;
+
+    wavefront_job job;
+    memset(&job, 0, sizeof(job));
+    job.f = f;
+    job.w = w;
+    job.c = c;
+    job.options = options;
+    job.sampler = samples;
+    job.tile_offsets = (u32*)memory_allocate(sizeof(u32) * (tiles_per_wave + 1));
+    job.paths = (wavefront_path*)memory_allocate_aligned(sizeof(wavefront_path) * capacity, 64);
+    ray_queue* queues[2] = {&job.queue, &job.scratch};
+    for (u32 i = 0; i < 2; ++i) {
+        queues[i]->paths = (u32*)memory_allocate(sizeof(u32) * capacity);
+        queues[i]->rays = (ray*)memory_allocate_aligned(sizeof(ray) * capacity, 64);
+        queues[i]->hits = (bvh_hit*)memory_allocate(sizeof(bvh_hit) * capacity);
+    }
+    job.next_rays = (ray*)memory_allocate_aligned(sizeof(ray) * capacity, 64);
+    job.shadows = (shadow_ray*)memory_allocate_aligned(sizeof(shadow_ray) * capacity, 64);
+    job.shadow_paths = (u32*)memory_allocate(sizeof(u32) * capacity);
+    job.shadow_queue = (shadow_ray*)memory_allocate_aligned(sizeof(shadow_ray) * capacity, 64);
+    job.keys = (u32*)memory_allocate(sizeof(u32) * capacity);
+    job.next_keys = (u32*)memory_allocate(sizeof(u32) * capacity);
+    job.shadow_keys = (u32*)memory_allocate(sizeof(u32) * capacity);
+    job.order = (u32*)memory_allocate(sizeof(u32) * capacity);
+    u32* offsets = (u32*)memory_allocate(sizeof(u32) * MAX_SORT_BLOCKS * SHADE_BUCKETS);
+    vec3 extent = bounds3_diagonal(&w->bounds);
+    job.cell_origin = w->bounds.min;
+    job.cell_scale = vec3_make(extent.x > 0 ? RAY_CELLS_PER_AXIS / extent.x : 0,
+                               extent.y > 0 ? RAY_CELLS_PER_AXIS / extent.y : 0,
+                               extent.z > 0 ? RAY_CELLS_PER_AXIS / extent.z : 0);
+
+    u64 side = f->tile_size + 2 * f->apron;
+    u32 arena_count = pool ? zpool_thread_count(pool) : 1;
+    job.arenas = (arena*)memory_allocate(sizeof(arena) * arena_count);
+    for (u32 i = 0; i < arena_count; ++i) {
+        arena_create(&job.arenas[i], side * side * sizeof(film_pixel) + 2 * sizeof(f32) * options->samples_per_pixel + 192);
+    }
+
+    for (u32 first = 0; first < f->tile_count; first += tiles_per_wave) {
+        u32 tile_count = f->tile_count - first < tiles_per_wave ? f->tile_count - first : tiles_per_wave;
+        job.tiles = tiles + first;
+        job.tile_offsets[0] = 0;
+        for (u32 i = 0; i < tile_count; ++i) {
+            u32 tile = job.tiles[i];
+            u32 x0 = (tile % f->tiles_x) * f->tile_size, y0 = (tile / f->tiles_x) * f->tile_size;
+            u32 width = f->width - x0 < f->tile_size ? f->width - x0 : f->tile_size;
+            u32 height = f->height - y0 < f->tile_size ? f->height - y0 : f->tile_size;
+            job.tile_offsets[i + 1] = job.tile_offsets[i] + width * height * options->samples_per_pixel;
+        }
+        render_wave(&job, tile_count, offsets, pool, stats);
+    }
+
+    for (u32 i = 0; i < arena_count; ++i) {
+        arena_destroy(&job.arenas[i]);
+    }
+    memory_free(job.arenas);
+    memory_free(offsets);
+    memory_free(job.order);
+    memory_free(job.shadow_keys);
+    memory_free(job.next_keys);
+    memory_free(job.keys);
+    memory_free_aligned(job.shadow_queue);
+    memory_free(job.shadow_paths);
+    memory_free_aligned(job.shadows);
+    memory_free_aligned(job.next_rays);
+    for (u32 i = 0; i < 2; ++i) {
+        memory_free(queues[i]->paths);
+        memory_free_aligned(queues[i]->rays);
+        memory_free(queues[i]->hits);
+    }
+    memory_free_aligned(job.paths);
+    memory_free(job.tile_offsets);
+    memory_free(tiles);
+    if (!options->sampler) {
+        sampler_destroy(&independent);
+    }
+    clock_update(&total);
+    stats->seconds = total.elapsed;
+}
@@ -0,0 +1,66 @@
+#ifndef WAVEFRONT__H
+#define WAVEFRONT__H
+
+#include "defines.h"
+#include "integrator.h"
+#include "film.h"
+#include "render.h"
+#include "sampler.h"
+#include "zpool.h"
+
+/***
+ *    ██     ██  █████  ██    ██ ███████ ███████ ██████   ██████  ███    ██ ████████
+ *    ██     ██ ██   ██ ██    ██ ██      ██      ██   ██ ██    ██ ████   ██    ██
+ *    ██  █  ██ ███████ ██    ██ █████   █████   ██████  ██    ██ ██ ██  ██    ██
+ *    ██ ███ ██ ██   ██  ██  ██  ██      ██      ██   ██ ██    ██ ██  ██ ██    ██
+ *     ███ ███  ██   ██   ████   ███████ ██      ██   ██  ██████  ██   ████    ██
+ *
+ *
+ */
+
+// path tracing in stages over large batches of paths instead of one path at a time (laine
+// et al. 2013, "megakernels considered harmful"). a wave is a run of whole tiles with every
+// sample of every pixel in it, all of its paths are generated first and then advanced one
+// bounce at a time: every live path is intersected, shaded, its shadow ray traced, and the
+// survivors queued for the next bounce. each stage is one parallel loop doing one kind of
+// work over a queue of rays, so the code and data a stage touches stay hot and the
+// sample values of a whole queue come from one sampler_generate_batch call per dimension.
+// shadow rays are traced as packets of neighbors in the queue (bvh_occluded_triangles_batch).
+// with sorting on, queues are reordered between stages by stable counting sorts: hits by
+// material and incoming octant before shading, bounce and shadow rays by direction bin and
+// origin cell before tracing, so neighboring rays in a queue walk the same bvh nodes.
+// unsorted queues keep generation order, every sample of a pixel next to each other, which
+// single ray traversal already finds coherent enough that sorting does not pay for itself
+// (integrator_bench_integrators), so it is off by default.
+// the paths of a tile are splatted in a fixed order once the wave is done, and sorting
+// only changes the order paths are processed in, never what they compute, so images do
+// not depend on the thread count or on whether queues were sorted
+
+typedef struct wavefront_options {
+    u32 samples_per_pixel;
+    // bounces a path may take, 0 renders what the camera sees directly
+    u32 max_depth;
+    // paths in flight at once, waves take whole tiles until one more would exceed it (and
+    // always at least one)
+    u32 wave_size;
+    // sort the queues between stages, compaction keeps them in generation order otherwise
+    bool sort;
+    render_tile_order order;
+    u64 seed;
+    // sampler of the image, null samples independently with seed
+    const sampler* sampler;
+} wavefront_options;
+
+// 16 samples per pixel, 8 bounces, 2^16 paths per wave, unsorted, center out
+void wavefront_options_default(wavefront_options* options);
+
+// renders w through c into f, accumulating on top of what the film holds. options, pool and
+// stats may be null, stats is overwritten with the counts and stage times of this render
+void wavefront_render(film* f,
+                      const world* w,
+                      const camera* c,
+                      const wavefront_options* options,
+                      zpool* pool,
+                      integrator_stats* stats);
+
+#endif
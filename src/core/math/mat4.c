@@ -0,0 +1,133 @@
+#include "mat4.h"
+
+void mat4_identity(mat4* out) {
+    mat4_make(out, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+}
+
+void mat4_make(mat4* out,
+               f32 m00, f32 m01, f32 m02, f32 m03,
+               f32 m10, f32 m11, f32 m12, f32 m13,
+               f32 m20, f32 m21, f32 m22, f32 m23,
+               f32 m30, f32 m31, f32 m32, f32 m33) {
+    out->m[0][0] = m00, out->m[0][1] = m01, out->m[0][2] = m02, out->m[0][3] = m03;
+    out->m[1][0] = m10, out->m[1][1] = m11, out->m[1][2] = m12, out->m[1][3] = m13;
+    out->m[2][0] = m20, out->m[2][1] = m21, out->m[2][2] = m22, out->m[2][3] = m23;
+    out->m[3][0] = m30, out->m[3][1] = m31, out->m[3][2] = m32, out->m[3][3] = m33;
+}
+
+bool mat4_is_identity(const mat4* m) {
+    for (u32 i = 0; i < 4; ++i) {
+        for (u32 j = 0; j < 4; ++j) {
+            if (m->m[i][j] != (i == j ? 1.0f : 0.0f)) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+bool mat4_equal(const mat4* a, const mat4* b, f32 epsilon) {
+    for (u32 i = 0; i < 4; ++i) {
+        for (u32 j = 0; j < 4; ++j) {
+            if (absf(a->m[i][j] - b->m[i][j]) > epsilon) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+void mat4_transpose(const mat4* m, mat4* out) {
+#ifdef SIMD_SSE
+    __m128 r0 = m->row[0], r1 = m->row[1], r2 = m->row[2], r3 = m->row[3];
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    out->row[0] = r0;
+    out->row[1] = r1;
+    out->row[2] = r2;
+    out->row[3] = r3;
+#else
+    mat4 r;
+    for (u32 i = 0; i < 4; ++i) {
+        for (u32 j = 0; j < 4; ++j) {
+            r.m[i][j] = m->m[j][i];
+        }
+    }
+    *out = r;
+#endif
+}
+
+// ============================================================================
+// INVERSE
+// ============================================================================
+
+// 2x2 sub determinants of the top (s) and bottom (c) row pairs, shared by the
+// determinant and the adjugate (Laplace expansion by complementary minors)
+typedef struct minors {
+    f64 s[6];
+    f64 c[6];
+} minors;
+
+static void compute_minors(const mat4* m, minors* out) {
+    const f32(*a)[4] = m->m;
+    out->s[0] = (f64)a[0][0] * a[1][1] - (f64)a[1][0] * a[0][1];
+    out->s[1] = (f64)a[0][0] * a[1][2] - (f64)a[1][0] * a[0][2];
+    out->s[2] = (f64)a[0][0] * a[1][3] - (f64)a[1][0] * a[0][3];
+    out->s[3] = (f64)a[0][1] * a[1][2] - (f64)a[1][1] * a[0][2];
+    out->s[4] = (f64)a[0][1] * a[1][3] - (f64)a[1][1] * a[0][3];
+    out->s[5] = (f64)a[0][2] * a[1][3] - (f64)a[1][2] * a[0][3];
+
+    out->c[5] = (f64)a[2][2] * a[3][3] - (f64)a[3][2] * a[2][3];
+    out->c[4] = (f64)a[2][1] * a[3][3] - (f64)a[3][1] * a[2][3];
+    out->c[3] = (f64)a[2][1] * a[3][2] - (f64)a[3][1] * a[2][2];
+    out->c[2] = (f64)a[2][0] * a[3][3] - (f64)a[3][0] * a[2][3];
+    out->c[1] = (f64)a[2][0] * a[3][2] - (f64)a[3][0] * a[2][2];
+    out->c[0] = (f64)a[2][0] * a[3][1] - (f64)a[3][0] * a[2][1];
+}
+
+static f64 minors_determinant(const minors* k) {
+    return k->s[0] * k->c[5] - k->s[1] * k->c[4] + k->s[2] * k->c[3] + k->s[3] * k->c[2] - k->s[4] * k->c[1] +
+           k->s[5] * k->c[0];
+}
+
+f32 mat4_determinant(const mat4* m) {
+    minors k;
+    compute_minors(m, &k);
+    return (f32)minors_determinant(&k);
+}
+
+bool mat4_inverse(const mat4* m, mat4* out) {
+    minors k;
+    compute_minors(m, &k);
+    f64 det = minors_determinant(&k);
+    if (det == 0.0) {
+        return FALSE;
+    }
+    f64 inv = 1.0 / det;
+    const f32(*a)[4] = m->m;
+    const f64* s = k.s;
+    const f64* c = k.c;
+
+    mat4 r;
+    r.m[0][0] = (f32)(inv * (a[1][1] * c[5] - a[1][2] * c[4] + a[1][3] * c[3]));
+    r.m[0][1] = (f32)(inv * (-a[0][1] * c[5] + a[0][2] * c[4] - a[0][3] * c[3]));
+    r.m[0][2] = (f32)(inv * (a[3][1] * s[5] - a[3][2] * s[4] + a[3][3] * s[3]));
+    r.m[0][3] = (f32)(inv * (-a[2][1] * s[5] + a[2][2] * s[4] - a[2][3] * s[3]));
+
+    r.m[1][0] = (f32)(inv * (-a[1][0] * c[5] + a[1][2] * c[2] - a[1][3] * c[1]));
+    r.m[1][1] = (f32)(inv * (a[0][0] * c[5] - a[0][2] * c[2] + a[0][3] * c[1]));
+    r.m[1][2] = (f32)(inv * (-a[3][0] * s[5] + a[3][2] * s[2] - a[3][3] * s[1]));
+    r.m[1][3] = (f32)(inv * (a[2][0] * s[5] - a[2][2] * s[2] + a[2][3] * s[1]));
+
+    r.m[2][0] = (f32)(inv * (a[1][0] * c[4] - a[1][1] * c[2] + a[1][3] * c[0]));
+    r.m[2][1] = (f32)(inv * (-a[0][0] * c[4] + a[0][1] * c[2] - a[0][3] * c[0]));
+    r.m[2][2] = (f32)(inv * (a[3][0] * s[4] - a[3][1] * s[2] + a[3][3] * s[0]));
+    r.m[2][3] = (f32)(inv * (-a[2][0] * s[4] + a[2][1] * s[2] - a[2][3] * s[0]));
+
+    r.m[3][0] = (f32)(inv * (-a[1][0] * c[3] + a[1][1] * c[1] - a[1][2] * c[0]));
+    r.m[3][1] = (f32)(inv * (a[0][0] * c[3] - a[0][1] * c[1] + a[0][2] * c[0]));
+    r.m[3][2] = (f32)(inv * (-a[3][0] * s[3] + a[3][1] * s[1] - a[3][2] * s[0]));
+    r.m[3][3] = (f32)(inv * (a[2][0] * s[3] - a[2][1] * s[1] + a[2][2] * s[0]));
+
+    *out = r;
+    return TRUE;
+}
@@ -0,0 +1,97 @@
+#ifndef MAT4__H
+#define MAT4__H
+
+#include "defines.h"
+#include "simd.h"
+#include "vec3.h"
+
+/***
+ *    ███    ███  █████  ████████ ██   ██
+ *    ████  ████ ██   ██    ██    ██   ██
+ *    ██ ████ ██ ███████    ██    ███████
+ *    ██  ██  ██ ██   ██    ██         ██
+ *    ██      ██ ██   ██    ██         ██
+ *
+ *
+ */
+
+// row major, m[row][column], vectors are columns so a transform applies as M * v.
+// only 16 byte aligned so tracked allocations (malloc alignment) can hold arrays of them,
+// the avx2 paths use unaligned 256 bit loads which cost nothing extra on aligned data
+typedef union mat4 {
+    f32 m[4][4];
+#ifdef SIMD_SSE
+    __m128 row[4];
+#endif
+} ALIGN(16) mat4;
+
+void mat4_identity(mat4* out);
+
+void mat4_make(mat4* out,
+               f32 m00, f32 m01, f32 m02, f32 m03,
+               f32 m10, f32 m11, f32 m12, f32 m13,
+               f32 m20, f32 m21, f32 m22, f32 m23,
+               f32 m30, f32 m31, f32 m32, f32 m33);
+
+bool mat4_is_identity(const mat4* m);
+
+bool mat4_equal(const mat4* a, const mat4* b, f32 epsilon);
+
+void mat4_transpose(const mat4* m, mat4* out);
+
+f32 mat4_determinant(const mat4* m);
+
+// returns FALSE and leaves out untouched when m is singular
+bool mat4_inverse(const mat4* m, mat4* out);
+
+// out = a * b, out may alias a or b
+FORCE_INLINE void mat4_mul(const mat4* a, const mat4* b, mat4* out) {
+#if defined(SIMD_AVX2)
+    // two result rows per register, each 128 bit half broadcasts its own row of a
+    __m256 b0 = _mm256_broadcast_ps(&b->row[0]);
+    __m256 b1 = _mm256_broadcast_ps(&b->row[1]);
+    __m256 b2 = _mm256_broadcast_ps(&b->row[2]);
+    __m256 b3 = _mm256_broadcast_ps(&b->row[3]);
+    __m256 r[2];
+    for (u32 i = 0; i < 2; ++i) {
+        __m256 a_rows = _mm256_loadu_ps(&a->m[i * 2][0]);
+        __m256 t = _mm256_mul_ps(_mm256_shuffle_ps(a_rows, a_rows, 0x00), b0);
+#    ifdef SIMD_FMA
+        t = _mm256_fmadd_ps(_mm256_shuffle_ps(a_rows, a_rows, 0x55), b1, t);
+        t = _mm256_fmadd_ps(_mm256_shuffle_ps(a_rows, a_rows, 0xaa), b2, t);
+        t = _mm256_fmadd_ps(_mm256_shuffle_ps(a_rows, a_rows, 0xff), b3, t);
+#    else
+        t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_shuffle_ps(a_rows, a_rows, 0x55), b1));
+        t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_shuffle_ps(a_rows, a_rows, 0xaa), b2));
+        t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_shuffle_ps(a_rows, a_rows, 0xff), b3));
+#    endif
+        r[i] = t;
+    }
+    _mm256_storeu_ps(&out->m[0][0], r[0]);
+    _mm256_storeu_ps(&out->m[2][0], r[1]);
+#elif defined(SIMD_SSE)
+    __m128 r[4];
+    for (u32 i = 0; i < 4; ++i) {
+        __m128 a_row = a->row[i];
+        __m128 t = _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0x00), b->row[0]);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0x55), b->row[1]));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0xaa), b->row[2]));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0xff), b->row[3]));
+        r[i] = t;
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        out->row[i] = r[i];
+    }
+#else
+    mat4 r;
+    for (u32 i = 0; i < 4; ++i) {
+        for (u32 j = 0; j < 4; ++j) {
+            r.m[i][j] = a->m[i][0] * b->m[0][j] + a->m[i][1] * b->m[1][j] + a->m[i][2] * b->m[2][j] +
+                        a->m[i][3] * b->m[3][j];
+        }
+    }
+    *out = r;
+#endif
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef MATH_UTILS__H
+#define MATH_UTILS__H
+
+#include "defines.h"
+#include "simd.h"
+#include <math.h>
+
+//    ███    ███  █████  ████████ ██   ██
+//    ████  ████ ██   ██    ██    ██   ██
+//    ██ ████ ██ ███████    ██    ███████
+//    ██  ██  ██ ██   ██    ██    ██   ██
+//    ██      ██ ██   ██    ██    ██   ██
+//
+//
+
+#define PI 3.14159265358979323846f
+#define INV_PI 0.31830988618379067154f
+#define INV_2PI 0.15915494309189533577f
+// largest finite f32, used where pbrt uses infinity. release builds compile with
+// -ffast-math which lets the compiler assume no value is ever inf
+#define MAX_F32 3.402823466e+38f
+#define MACHINE_EPSILON_F32 (1.19209290e-07f * 0.5f)
+
+FORCE_INLINE f32 absf(f32 x) {
+    return x < 0 ? -x : x;
+}
+
+FORCE_INLINE f32 minf(f32 a, f32 b) {
+    return a < b ? a : b;
+}
+
+FORCE_INLINE f32 maxf(f32 a, f32 b) {
+    return a > b ? a : b;
+}
+
+FORCE_INLINE f32 clampf(f32 x, f32 low, f32 high) {
+    return x < low ? low : (x > high ? high : x);
+}
+
+FORCE_INLINE f32 lerpf(f32 t, f32 a, f32 b) {
+    return (1 - t) * a + t * b;
+}
+
+// bound on the relative error of n floating point operations (pbrt 6.8.1)
+FORCE_INLINE f32 gamma_bound(u32 n) {
+    return ((f32)n * MACHINE_EPSILON_F32) / (1 - (f32)n * MACHINE_EPSILON_F32);
+}
+
+FORCE_INLINE f32 radians(f32 degrees) {
+    return degrees * (PI / 180.0f);
+}
+
+FORCE_INLINE f32 degrees(f32 radians) {
+    return radians * (180.0f / PI);
+}
+
+#endif
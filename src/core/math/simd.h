@@ -0,0 +1,482 @@
+#ifndef SIMD__H
+#define SIMD__H
+
+#include "defines.h"
+
+/***
+ *    ███████ ██ ███    ███ ██████
+ *    ██      ██ ████  ████ ██   ██
+ *    ███████ ██ ██ ████ ██ ██   ██
+ *         ██ ██ ██  ██  ██ ██   ██
+ *    ███████ ██ ██      ██ ██████
+ *
+ *
+ */
+
+// instruction set is picked at compile time from the target flags, the release config
+// builds with -march=native. define SIMD_FORCE_SCALAR to test the scalar fallback
+
+#if !defined(SIMD_FORCE_SCALAR) && defined(__AVX2__)
+#    define SIMD_AVX2 1
+#    define SIMD_SSE 1
+#elif !defined(SIMD_FORCE_SCALAR) && defined(__SSE4_1__)
+#    define SIMD_SSE 1
+#else
+#    define SIMD_SCALAR 1
+#endif
+
+#if defined(SIMD_AVX2) && defined(__FMA__)
+#    define SIMD_FMA 1
+#endif
+
+#ifdef SIMD_SSE
+#    include <immintrin.h>
+#endif
+
+#define ALIGN(bytes) __attribute__((aligned(bytes)))
+
+#define FORCE_INLINE static inline __attribute__((always_inline))
+
+// ============================================================================
+// SIMDF
+// ============================================================================
+
+// simdf is the widest float register of the target, SIMD_LANES floats wide. simdb is a lane
+// mask produced by comparisons, consumed by simdf_select and simdb_bits.
+// loads and stores expect SIMD_ALIGNMENT aligned addresses
+
+#if defined(SIMD_AVX2)
+#    define SIMD_LANES 8
+#    define SIMD_ALIGNMENT 32
+typedef __m256 simdf;
+typedef __m256 simdb;
+#elif defined(SIMD_SSE)
+#    define SIMD_LANES 4
+#    define SIMD_ALIGNMENT 16
+typedef __m128 simdf;
+typedef __m128 simdb;
+#else
+#    define SIMD_LANES 1
+#    define SIMD_ALIGNMENT 4
+typedef f32 simdf;
+typedef bool simdb;
+#endif
+
+FORCE_INLINE simdf simdf_set1(f32 s) {
+#if defined(SIMD_AVX2)
+    return _mm256_set1_ps(s);
+#elif defined(SIMD_SSE)
+    return _mm_set1_ps(s);
+#else
+    return s;
+#endif
+}
+
+FORCE_INLINE simdf simdf_load(const f32* p) {
+#if defined(SIMD_AVX2)
+    return _mm256_load_ps(p);
+#elif defined(SIMD_SSE)
+    return _mm_load_ps(p);
+#else
+    return *p;
+#endif
+}
+
+// widens SIMD_LANES bytes to floats
+FORCE_INLINE simdf simdf_from_u8(const u8* p) {
+#if defined(SIMD_AVX2)
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+#elif defined(SIMD_SSE)
+    i32 bytes;
+    __builtin_memcpy(&bytes, p, sizeof(bytes));
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+#else
+    return (f32)*p;
+#endif
+}
+
+FORCE_INLINE void simdf_store(f32* p, simdf a) {
+#if defined(SIMD_AVX2)
+    _mm256_store_ps(p, a);
+#elif defined(SIMD_SSE)
+    _mm_store_ps(p, a);
+#else
+    *p = a;
+#endif
+}
+
+FORCE_INLINE void simdf_store_unaligned(f32* p, simdf a) {
+#if defined(SIMD_AVX2)
+    _mm256_storeu_ps(p, a);
+#elif defined(SIMD_SSE)
+    _mm_storeu_ps(p, a);
+#else
+    *p = a;
+#endif
+}
+
+FORCE_INLINE simdf simdf_add(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_add_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_add_ps(a, b);
+#else
+    return a + b;
+#endif
+}
+
+FORCE_INLINE simdf simdf_sub(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_sub_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_sub_ps(a, b);
+#else
+    return a - b;
+#endif
+}
+
+FORCE_INLINE simdf simdf_mul(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_mul_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_mul_ps(a, b);
+#else
+    return a * b;
+#endif
+}
+
+FORCE_INLINE simdf simdf_div(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_div_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_div_ps(a, b);
+#else
+    return a / b;
+#endif
+}
+
+// a * b + c
+FORCE_INLINE simdf simdf_madd(simdf a, simdf b, simdf c) {
+#if defined(SIMD_FMA)
+    return _mm256_fmadd_ps(a, b, c);
+#elif defined(SIMD_AVX2)
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#elif defined(SIMD_SSE)
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#else
+    return a * b + c;
+#endif
+}
+
+// a * b - c * d, the difference of products used by cross products and determinants
+FORCE_INLINE simdf simdf_msub2(simdf a, simdf b, simdf c, simdf d) {
+    return simdf_sub(simdf_mul(a, b), simdf_mul(c, d));
+}
+
+FORCE_INLINE simdf simdf_min(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_min_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_min_ps(a, b);
+#else
+    return a < b ? a : b;
+#endif
+}
+
+FORCE_INLINE simdf simdf_max(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_max_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_max_ps(a, b);
+#else
+    return a > b ? a : b;
+#endif
+}
+
+FORCE_INLINE simdf simdf_abs(simdf a) {
+#if defined(SIMD_AVX2)
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+#elif defined(SIMD_SSE)
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+#else
+    return a < 0 ? -a : a;
+#endif
+}
+
+FORCE_INLINE simdb simdf_lt(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+#elif defined(SIMD_SSE)
+    return _mm_cmplt_ps(a, b);
+#else
+    return a < b;
+#endif
+}
+
+FORCE_INLINE simdb simdf_le(simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+#elif defined(SIMD_SSE)
+    return _mm_cmple_ps(a, b);
+#else
+    return a <= b;
+#endif
+}
+
+FORCE_INLINE simdb simdf_gt(simdf a, simdf b) {
+    return simdf_lt(b, a);
+}
+
+FORCE_INLINE simdb simdf_ge(simdf a, simdf b) {
+    return simdf_le(b, a);
+}
+
+FORCE_INLINE simdb simdb_and(simdb a, simdb b) {
+#if defined(SIMD_AVX2)
+    return _mm256_and_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_and_ps(a, b);
+#else
+    return a && b;
+#endif
+}
+
+FORCE_INLINE simdb simdb_or(simdb a, simdb b) {
+#if defined(SIMD_AVX2)
+    return _mm256_or_ps(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_or_ps(a, b);
+#else
+    return a || b;
+#endif
+}
+
+// lane i of the mask is set when bit i of bits is set
+FORCE_INLINE simdb simdb_from_bits(u32 bits) {
+#if defined(SIMD_AVX2)
+    __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i set = _mm256_and_si256(_mm256_set1_epi32((i32)bits), lane_bits);
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, lane_bits));
+#elif defined(SIMD_SSE)
+    __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+    __m128i set = _mm_and_si128(_mm_set1_epi32((i32)bits), lane_bits);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(set, lane_bits));
+#else
+    return (bits & 1) != 0;
+#endif
+}
+
+// bit i of the result is lane i of the mask
+FORCE_INLINE u32 simdb_bits(simdb mask) {
+#if defined(SIMD_AVX2)
+    return (u32)_mm256_movemask_ps(mask);
+#elif defined(SIMD_SSE)
+    return (u32)_mm_movemask_ps(mask);
+#else
+    return mask ? 1 : 0;
+#endif
+}
+
+// mask ? a : b per lane
+FORCE_INLINE simdf simdf_select(simdb mask, simdf a, simdf b) {
+#if defined(SIMD_AVX2)
+    return _mm256_blendv_ps(b, a, mask);
+#elif defined(SIMD_SSE)
+    return _mm_blendv_ps(b, a, mask);
+#else
+    return mask ? a : b;
+#endif
+}
+
+// ============================================================================
+// SIMDI
+// ============================================================================
+
+// simdi holds SIMD_LANES unsigned 32 bit integers, for the bit twiddling of hashes and
+// sample generators. arithmetic wraps like u32, shifts are logical
+
+#if defined(SIMD_AVX2)
+typedef __m256i simdi;
+#elif defined(SIMD_SSE)
+typedef __m128i simdi;
+#else
+typedef u32 simdi;
+#endif
+
+FORCE_INLINE simdi simdi_set1(u32 s) {
+#if defined(SIMD_AVX2)
+    return _mm256_set1_epi32((i32)s);
+#elif defined(SIMD_SSE)
+    return _mm_set1_epi32((i32)s);
+#else
+    return s;
+#endif
+}
+
+// base, base + 1, ... base + SIMD_LANES - 1
+FORCE_INLINE simdi simdi_ramp(u32 base) {
+#if defined(SIMD_AVX2)
+    return _mm256_add_epi32(_mm256_set1_epi32((i32)base), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+#elif defined(SIMD_SSE)
+    return _mm_add_epi32(_mm_set1_epi32((i32)base), _mm_setr_epi32(0, 1, 2, 3));
+#else
+    return base;
+#endif
+}
+
+FORCE_INLINE simdi simdi_load(const u32* p) {
+#if defined(SIMD_AVX2)
+    return _mm256_load_si256((const __m256i*)p);
+#elif defined(SIMD_SSE)
+    return _mm_load_si128((const __m128i*)p);
+#else
+    return *p;
+#endif
+}
+
+FORCE_INLINE simdi simdi_load_unaligned(const u32* p) {
+#if defined(SIMD_AVX2)
+    return _mm256_loadu_si256((const __m256i*)p);
+#elif defined(SIMD_SSE)
+    return _mm_loadu_si128((const __m128i*)p);
+#else
+    return *p;
+#endif
+}
+
+FORCE_INLINE void simdi_store(u32* p, simdi a) {
+#if defined(SIMD_AVX2)
+    _mm256_store_si256((__m256i*)p, a);
+#elif defined(SIMD_SSE)
+    _mm_store_si128((__m128i*)p, a);
+#else
+    *p = a;
+#endif
+}
+
+FORCE_INLINE simdi simdi_add(simdi a, simdi b) {
+#if defined(SIMD_AVX2)
+    return _mm256_add_epi32(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_add_epi32(a, b);
+#else
+    return a + b;
+#endif
+}
+
+FORCE_INLINE simdi simdi_sub(simdi a, simdi b) {
+#if defined(SIMD_AVX2)
+    return _mm256_sub_epi32(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_sub_epi32(a, b);
+#else
+    return a - b;
+#endif
+}
+
+// low 32 bits of the product
+FORCE_INLINE simdi simdi_mul(simdi a, simdi b) {
+#if defined(SIMD_AVX2)
+    return _mm256_mullo_epi32(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_mullo_epi32(a, b);
+#else
+    return a * b;
+#endif
+}
+
+// high 32 bits of the 64 bit product
+FORCE_INLINE simdi simdi_mul_high(simdi a, simdi b) {
+#if defined(SIMD_AVX2)
+    __m256i even = _mm256_mul_epu32(a, b);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+#elif defined(SIMD_SSE)
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xcc);
+#else
+    return (u32)(((u64)a * b) >> 32);
+#endif
+}
+
+FORCE_INLINE simdi simdi_and(simdi a, simdi b) {
+#if defined(SIMD_AVX2)
+    return _mm256_and_si256(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_and_si128(a, b);
+#else
+    return a & b;
+#endif
+}
+
+FORCE_INLINE simdi simdi_or(simdi a, simdi b) {
+#if defined(SIMD_AVX2)
+    return _mm256_or_si256(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_or_si128(a, b);
+#else
+    return a | b;
+#endif
+}
+
+FORCE_INLINE simdi simdi_xor(simdi a, simdi b) {
+#if defined(SIMD_AVX2)
+    return _mm256_xor_si256(a, b);
+#elif defined(SIMD_SSE)
+    return _mm_xor_si128(a, b);
+#else
+    return a ^ b;
+#endif
+}
+
+FORCE_INLINE simdi simdi_shift_left(simdi a, u32 bits) {
+#if defined(SIMD_AVX2)
+    return _mm256_slli_epi32(a, (i32)bits);
+#elif defined(SIMD_SSE)
+    return _mm_slli_epi32(a, (i32)bits);
+#else
+    return a << bits;
+#endif
+}
+
+FORCE_INLINE simdi simdi_shift_right(simdi a, u32 bits) {
+#if defined(SIMD_AVX2)
+    return _mm256_srli_epi32(a, (i32)bits);
+#elif defined(SIMD_SSE)
+    return _mm_srli_epi32(a, (i32)bits);
+#else
+    return a >> bits;
+#endif
+}
+
+// all ones in the lanes where bit of a is set, zero elsewhere
+FORCE_INLINE simdi simdi_bit_mask(simdi a, u32 bit) {
+    return simdi_sub(simdi_set1(0), simdi_and(simdi_shift_right(a, bit), simdi_set1(1)));
+}
+
+// the 32 bits of every lane in reverse order
+FORCE_INLINE simdi simdi_reverse_bits(simdi a) {
+    a = simdi_or(simdi_shift_right(a, 16), simdi_shift_left(a, 16));
+    a = simdi_or(simdi_and(simdi_shift_right(a, 8), simdi_set1(0x00ff00ffu)),
+                 simdi_shift_left(simdi_and(a, simdi_set1(0x00ff00ffu)), 8));
+    a = simdi_or(simdi_and(simdi_shift_right(a, 4), simdi_set1(0x0f0f0f0fu)),
+                 simdi_shift_left(simdi_and(a, simdi_set1(0x0f0f0f0fu)), 4));
+    a = simdi_or(simdi_and(simdi_shift_right(a, 2), simdi_set1(0x33333333u)),
+                 simdi_shift_left(simdi_and(a, simdi_set1(0x33333333u)), 2));
+    return simdi_or(simdi_and(simdi_shift_right(a, 1), simdi_set1(0x55555555u)),
+                    simdi_shift_left(simdi_and(a, simdi_set1(0x55555555u)), 1));
+}
+
+// the top 24 bits of every lane as a float in [0, 1)
+FORCE_INLINE simdf simdi_to_unit(simdi a) {
+#if defined(SIMD_AVX2)
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(a, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+#elif defined(SIMD_SSE)
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+#else
+    return (f32)(a >> 8) * (1.0f / 16777216.0f);
+#endif
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include "transform.h"
+#include "logger.h"
+
+void transform_identity(transform* out) {
+    mat4_identity(&out->m);
+    mat4_identity(&out->m_inv);
+}
+
+bool transform_from_mat4(const mat4* m, transform* out) {
+    mat4 inv;
+    if (!mat4_inverse(m, &inv)) {
+        return FALSE;
+    }
+    out->m = *m;
+    out->m_inv = inv;
+    return TRUE;
+}
+
+void transform_inverse(const transform* t, transform* out) {
+    mat4 m = t->m;
+    out->m = t->m_inv;
+    out->m_inv = m;
+}
+
+void transform_transpose(const transform* t, transform* out) {
+    mat4_transpose(&t->m, &out->m);
+    mat4_transpose(&t->m_inv, &out->m_inv);
+}
+
+void transform_compose(const transform* a, const transform* b, transform* out) {
+    // (a * b)^-1 = b^-1 * a^-1, computed before out is written in case it aliases a or b
+    mat4 m, m_inv;
+    mat4_mul(&a->m, &b->m, &m);
+    mat4_mul(&b->m_inv, &a->m_inv, &m_inv);
+    out->m = m;
+    out->m_inv = m_inv;
+}
+
+void transform_translate(vec3 delta, transform* out) {
+    mat4_make(&out->m, 1, 0, 0, delta.x, 0, 1, 0, delta.y, 0, 0, 1, delta.z, 0, 0, 0, 1);
+    mat4_make(&out->m_inv, 1, 0, 0, -delta.x, 0, 1, 0, -delta.y, 0, 0, 1, -delta.z, 0, 0, 0, 1);
+}
+
+void transform_scale(f32 x, f32 y, f32 z, transform* out) {
+    mat4_make(&out->m, x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1);
+    mat4_make(&out->m_inv, 1 / x, 0, 0, 0, 0, 1 / y, 0, 0, 0, 0, 1 / z, 0, 0, 0, 0, 1);
+}
+
+// rotations are orthonormal so the inverse is the transpose
+static void set_rotation(const mat4* m, transform* out) {
+    out->m = *m;
+    mat4_transpose(m, &out->m_inv);
+}
+
+void transform_rotate_x(f32 theta, transform* out) {
+    f32 s = sinf(radians(theta));
+    f32 c = cosf(radians(theta));
+    mat4 m;
+    mat4_make(&m, 1, 0, 0, 0, 0, c, -s, 0, 0, s, c, 0, 0, 0, 0, 1);
+    set_rotation(&m, out);
+}
+
+void transform_rotate_y(f32 theta, transform* out) {
+    f32 s = sinf(radians(theta));
+    f32 c = cosf(radians(theta));
+    mat4 m;
+    mat4_make(&m, c, 0, s, 0, 0, 1, 0, 0, -s, 0, c, 0, 0, 0, 0, 1);
+    set_rotation(&m, out);
+}
+
+void transform_rotate_z(f32 theta, transform* out) {
+    f32 s = sinf(radians(theta));
+    f32 c = cosf(radians(theta));
+    mat4 m;
+    mat4_make(&m, c, -s, 0, 0, s, c, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+    set_rotation(&m, out);
+}
+
+void transform_rotate(f32 theta, vec3 axis, transform* out) {
+    vec3 a = vec3_normalize(axis);
+    f32 s = sinf(radians(theta));
+    f32 c = cosf(radians(theta));
+    mat4 m;
+    mat4_make(&m,
+              a.x * a.x + (1 - a.x * a.x) * c, a.x * a.y * (1 - c) - a.z * s, a.x * a.z * (1 - c) + a.y * s, 0,
+              a.x * a.y * (1 - c) + a.z * s, a.y * a.y + (1 - a.y * a.y) * c, a.y * a.z * (1 - c) - a.x * s, 0,
+              a.x * a.z * (1 - c) - a.y * s, a.y * a.z * (1 - c) + a.x * s, a.z * a.z + (1 - a.z * a.z) * c, 0,
+              0, 0, 0, 1);
+    set_rotation(&m, out);
+}
+
+bool transform_look_at(point3 pos, point3 look, vec3 up, transform* out) {
+    vec3 forward = vec3_sub(look, pos);
+    if (vec3_length_squared(forward) == 0.0f) {
+        LOGE("transform_look_at : pos and look are the same point");
+        return FALSE;
+    }
+    vec3 dir = vec3_normalize(forward);
+    vec3 side = vec3_cross(vec3_normalize(up), dir);
+    if (vec3_length_squared(side) == 0.0f) {
+        LOGE("transform_look_at : up vector and viewing direction are parallel");
+        return FALSE;
+    }
+    vec3 right = vec3_normalize(side);
+    vec3 new_up = vec3_cross(dir, right);
+
+    // columns are the camera basis in world space, this is camera to world
+    mat4 camera_to_world;
+    mat4_make(&camera_to_world,
+              right.x, new_up.x, dir.x, pos.x,
+              right.y, new_up.y, dir.y, pos.y,
+              right.z, new_up.z, dir.z, pos.z,
+              0, 0, 0, 1);
+    mat4 world_to_camera;
+    if (!mat4_inverse(&camera_to_world, &world_to_camera)) {
+        return FALSE;
+    }
+    out->m = world_to_camera;
+    out->m_inv = camera_to_world;
+    return TRUE;
+}
+
+bool transform_perspective(f32 fov, f32 near, f32 far, transform* out) {
+    mat4 persp;
+    mat4_make(&persp, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, far / (far - near), -far * near / (far - near), 0, 0, 1, 0);
+    transform p;
+    if (!transform_from_mat4(&persp, &p)) {
+        return FALSE;
+    }
+    f32 inv_tan = 1.0f / tanf(radians(fov) / 2);
+    transform s;
+    transform_scale(inv_tan, inv_tan, 1, &s);
+    transform_compose(&s, &p, out);
+    return TRUE;
+}
+
+bool transform_is_identity(const transform* t) {
+    return mat4_is_identity(&t->m);
+}
+
+bool transform_has_scale(const transform* t, f32 epsilon) {
+    f32 la2 = vec3_length_squared(transform_vector(t, vec3_make(1, 0, 0)));
+    f32 lb2 = vec3_length_squared(transform_vector(t, vec3_make(0, 1, 0)));
+    f32 lc2 = vec3_length_squared(transform_vector(t, vec3_make(0, 0, 1)));
+    return absf(la2 - 1) > epsilon || absf(lb2 - 1) > epsilon || absf(lc2 - 1) > epsilon;
+}
+
+bool transform_swaps_handedness(const transform* t) {
+    const f32(*a)[4] = t->m.m;
+    f32 det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+              a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    return det < 0;
+}
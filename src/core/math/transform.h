@@ -0,0 +1,117 @@
+#ifndef TRANSFORM__H
+#define TRANSFORM__H
+
+#include "defines.h"
+#include "simd.h"
+#include "vec3.h"
+#include "mat4.h"
+#include <stddef.h>
+
+/***
+ *    ████████ ██████   █████  ███    ██ ███████ ███████  ██████  ██████  ███    ███
+ *       ██    ██   ██ ██   ██ ████   ██ ██      ██      ██    ██ ██   ██ ████  ████
+ *       ██    ██████  ███████ ██ ██  ██ ███████ █████   ██    ██ ██████  ██ ████ ██
+ *       ██    ██   ██ ██   ██ ██  ██ ██      ██ ██      ██    ██ ██   ██ ██  ██  ██
+ *       ██    ██   ██ ██   ██ ██   ████ ███████ ██       ██████  ██   ██ ██      ██
+ *
+ *
+ */
+
+// the inverse is kept next to the matrix so normals and inverse transforms never invert
+typedef struct transform {
+    mat4 m;
+    mat4 m_inv;
+} transform;
+
+void transform_identity(transform* out);
+
+// returns FALSE when m is singular
+bool transform_from_mat4(const mat4* m, transform* out);
+
+void transform_inverse(const transform* t, transform* out);
+
+void transform_transpose(const transform* t, transform* out);
+
+// out = a * b, b is applied first. out may alias a or b
+void transform_compose(const transform* a, const transform* b, transform* out);
+
+void transform_translate(vec3 delta, transform* out);
+
+void transform_scale(f32 x, f32 y, f32 z, transform* out);
+
+// angles are in degrees like the pbrt scene format
+void transform_rotate_x(f32 theta, transform* out);
+void transform_rotate_y(f32 theta, transform* out);
+void transform_rotate_z(f32 theta, transform* out);
+void transform_rotate(f32 theta, vec3 axis, transform* out);
+
+// world to camera, returns FALSE when up is parallel to the view direction or pos == look
+bool transform_look_at(point3 pos, point3 look, vec3 up, transform* out);
+
+// fov in degrees, maps camera space to [-1,1]^2 x [0,1] before the divide
+bool transform_perspective(f32 fov, f32 near, f32 far, transform* out);
+
+bool transform_is_identity(const transform* t);
+
+bool transform_has_scale(const transform* t, f32 epsilon);
+
+bool transform_swaps_handedness(const transform* t);
+
+// ============================================================================
+// APPLY
+// ============================================================================
+
+// (r0.p, r1.p, r2.p, r3.p) with p.w forced to w. the sse path transposes the rows into
+// columns and sums broadcast products, inside a loop over points the transpose is loop
+// invariant and gets hoisted, which leaves 3 multiply adds per point instead of 4 dpps
+FORCE_INLINE vec3 mat4_apply(const mat4* m, vec3 p, f32 w, f32* out_w) {
+    vec3 r;
+#ifdef SIMD_SSE
+    __m128 c0 = m->row[0], c1 = m->row[1], c2 = m->row[2], c3 = m->row[3];
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    __m128 t = _mm_mul_ps(c3, _mm_set1_ps(w));
+#    ifdef SIMD_FMA
+    t = _mm_fmadd_ps(c0, _mm_shuffle_ps(p.m, p.m, 0x00), t);
+    t = _mm_fmadd_ps(c1, _mm_shuffle_ps(p.m, p.m, 0x55), t);
+    t = _mm_fmadd_ps(c2, _mm_shuffle_ps(p.m, p.m, 0xaa), t);
+#    else
+    t = _mm_add_ps(t, _mm_mul_ps(c0, _mm_shuffle_ps(p.m, p.m, 0x00)));
+    t = _mm_add_ps(t, _mm_mul_ps(c1, _mm_shuffle_ps(p.m, p.m, 0x55)));
+    t = _mm_add_ps(t, _mm_mul_ps(c2, _mm_shuffle_ps(p.m, p.m, 0xaa)));
+#    endif
+    if (out_w) {
+        *out_w = _mm_cvtss_f32(_mm_shuffle_ps(t, t, 0xff));
+    }
+    r.m = _mm_blend_ps(t, _mm_setzero_ps(), 0x8);
+#else
+    const f32(*a)[4] = m->m;
+    r.x = a[0][0] * p.x + a[0][1] * p.y + a[0][2] * p.z + a[0][3] * w;
+    r.y = a[1][0] * p.x + a[1][1] * p.y + a[1][2] * p.z + a[1][3] * w;
+    r.z = a[2][0] * p.x + a[2][1] * p.y + a[2][2] * p.z + a[2][3] * w;
+    r.w = 0;
+    if (out_w) {
+        *out_w = a[3][0] * p.x + a[3][1] * p.y + a[3][2] * p.z + a[3][3] * w;
+    }
+#endif
+    return r;
+}
+
+FORCE_INLINE point3 transform_point(const transform* t, point3 p) {
+    f32 w;
+    point3 r = mat4_apply(&t->m, p, 1.0f, &w);
+    return w == 1.0f ? r : vec3_scale(r, 1.0f / w);
+}
+
+FORCE_INLINE vec3 transform_vector(const transform* t, vec3 v) {
+    return mat4_apply(&t->m, v, 0.0f, NULL);
+}
+
+// normals go through the inverse transpose so they stay perpendicular to transformed surfaces
+FORCE_INLINE normal3 transform_normal(const transform* t, normal3 n) {
+    const f32(*a)[4] = t->m_inv.m;
+    return vec3_make(a[0][0] * n.x + a[1][0] * n.y + a[2][0] * n.z,
+                     a[0][1] * n.x + a[1][1] * n.y + a[2][1] * n.z,
+                     a[0][2] * n.x + a[1][2] * n.y + a[2][2] * n.z);
+}
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef VEC3__H
+#define VEC3__H
+
+#include "defines.h"
+#include "simd.h"
+#include "math_utils.h"
+
+/***
+ *    ██    ██ ███████  ██████ ██████
+ *    ██    ██ ██      ██           ██
+ *    ██    ██ █████   ██       █████
+ *     ██  ██  ██      ██           ██
+ *      ████   ███████  ██████ ██████
+ *
+ *
+ */
+
+// padded to 16 bytes so a vec3 is one sse register, w is kept at 0 by every operation.
+// points and normals share the representation, the transform functions tell them apart
+typedef union vec3 {
+    struct {
+        f32 x, y, z, w;
+    };
+    f32 e[4];
+#ifdef SIMD_SSE
+    __m128 m;
+#endif
+} ALIGN(16) vec3;
+
+typedef vec3 point3;
+typedef vec3 normal3;
+
+FORCE_INLINE vec3 vec3_make(f32 x, f32 y, f32 z) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_set_ps(0, z, y, x);
+#else
+    r.x = x;
+    r.y = y;
+    r.z = z;
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_splat(f32 s) {
+    return vec3_make(s, s, s);
+}
+
+FORCE_INLINE vec3 vec3_zero() {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_setzero_ps();
+#else
+    r.x = r.y = r.z = r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_add(vec3 a, vec3 b) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_add_ps(a.m, b.m);
+#else
+    r.x = a.x + b.x;
+    r.y = a.y + b.y;
+    r.z = a.z + b.z;
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_sub(vec3 a, vec3 b) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_sub_ps(a.m, b.m);
+#else
+    r.x = a.x - b.x;
+    r.y = a.y - b.y;
+    r.z = a.z - b.z;
+    r.w = 0;
+#endif
+    return r;
+}
+
+// component wise product
+FORCE_INLINE vec3 vec3_mul(vec3 a, vec3 b) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_mul_ps(a.m, b.m);
+#else
+    r.x = a.x * b.x;
+    r.y = a.y * b.y;
+    r.z = a.z * b.z;
+    r.w = 0;
+#endif
+    return r;
+}
+
+// component wise quotient, b.w is 0 so the sse path masks the resulting nan out of w
+FORCE_INLINE vec3 vec3_div(vec3 a, vec3 b) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_blend_ps(_mm_div_ps(a.m, b.m), _mm_setzero_ps(), 0x8);
+#else
+    r.x = a.x / b.x;
+    r.y = a.y / b.y;
+    r.z = a.z / b.z;
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_scale(vec3 a, f32 s) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_mul_ps(a.m, _mm_set1_ps(s));
+#else
+    r.x = a.x * s;
+    r.y = a.y * s;
+    r.z = a.z * s;
+    r.w = 0;
+#endif
+    return r;
+}
+
+// a + b * s
+FORCE_INLINE vec3 vec3_madd(vec3 a, vec3 b, f32 s) {
+    vec3 r;
+#if defined(SIMD_FMA)
+    r.m = _mm_fmadd_ps(b.m, _mm_set1_ps(s), a.m);
+#elif defined(SIMD_SSE)
+    r.m = _mm_add_ps(a.m, _mm_mul_ps(b.m, _mm_set1_ps(s)));
+#else
+    r.x = a.x + b.x * s;
+    r.y = a.y + b.y * s;
+    r.z = a.z + b.z * s;
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_neg(vec3 a) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_sub_ps(_mm_setzero_ps(), a.m);
+#else
+    r.x = -a.x;
+    r.y = -a.y;
+    r.z = -a.z;
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_abs(vec3 a) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_andnot_ps(_mm_set1_ps(-0.0f), a.m);
+#else
+    r.x = absf(a.x);
+    r.y = absf(a.y);
+    r.z = absf(a.z);
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_min(vec3 a, vec3 b) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_min_ps(a.m, b.m);
+#else
+    r.x = minf(a.x, b.x);
+    r.y = minf(a.y, b.y);
+    r.z = minf(a.z, b.z);
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE vec3 vec3_max(vec3 a, vec3 b) {
+    vec3 r;
+#ifdef SIMD_SSE
+    r.m = _mm_max_ps(a.m, b.m);
+#else
+    r.x = maxf(a.x, b.x);
+    r.y = maxf(a.y, b.y);
+    r.z = maxf(a.z, b.z);
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE f32 vec3_dot(vec3 a, vec3 b) {
+#ifdef SIMD_SSE
+    return _mm_cvtss_f32(_mm_dp_ps(a.m, b.m, 0x71));
+#else
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+#endif
+}
+
+FORCE_INLINE f32 vec3_abs_dot(vec3 a, vec3 b) {
+    return absf(vec3_dot(a, b));
+}
+
+FORCE_INLINE vec3 vec3_cross(vec3 a, vec3 b) {
+    vec3 r;
+#ifdef SIMD_SSE
+    // (a.yzx * b.zxy) - (a.zxy * b.yzx), w stays 0 because both products have a.w*b.w
+    __m128 a_yzx = _mm_shuffle_ps(a.m, a.m, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b.m, b.m, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a.m, b_yzx), _mm_mul_ps(a_yzx, b.m));
+    r.m = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+#else
+    // promoted to f64 to avoid catastrophic cancellation
+    r.x = (f32)((f64)a.y * b.z - (f64)a.z * b.y);
+    r.y = (f32)((f64)a.z * b.x - (f64)a.x * b.z);
+    r.z = (f32)((f64)a.x * b.y - (f64)a.y * b.x);
+    r.w = 0;
+#endif
+    return r;
+}
+
+FORCE_INLINE f32 vec3_length_squared(vec3 a) {
+    return vec3_dot(a, a);
+}
+
+FORCE_INLINE f32 vec3_length(vec3 a) {
+#ifdef SIMD_SSE
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_dp_ps(a.m, a.m, 0x71)));
+#else
+    return sqrtf(vec3_dot(a, a));
+#endif
+}
+
+FORCE_INLINE vec3 vec3_normalize(vec3 a) {
+    vec3 r;
+#ifdef SIMD_SSE
+    // 0x7f broadcasts the dot product to every lane, w of a is 0 so w stays 0
+    r.m = _mm_div_ps(a.m, _mm_sqrt_ps(_mm_dp_ps(a.m, a.m, 0x7f)));
+#else
+    r = vec3_scale(a, 1.0f / vec3_length(a));
+#endif
+    return r;
+}
+
+FORCE_INLINE f32 vec3_distance(point3 a, point3 b) {
+    return vec3_length(vec3_sub(a, b));
+}
+
+FORCE_INLINE vec3 vec3_lerp(f32 t, vec3 a, vec3 b) {
+    return vec3_add(vec3_scale(a, 1 - t), vec3_scale(b, t));
+}
+
+FORCE_INLINE f32 vec3_min_component(vec3 a) {
+    return minf(a.x, minf(a.y, a.z));
+}
+
+FORCE_INLINE f32 vec3_max_component(vec3 a) {
+    return maxf(a.x, maxf(a.y, a.z));
+}
+
+// index of the largest component
+FORCE_INLINE u32 vec3_max_dimension(vec3 a) {
+    return (a.x > a.y) ? ((a.x > a.z) ? 0 : 2) : ((a.y > a.z) ? 1 : 2);
+}
+
+FORCE_INLINE vec3 vec3_permute(vec3 a, u32 x, u32 y, u32 z) {
+    return vec3_make(a.e[x], a.e[y], a.e[z]);
+}
+
+// flips n so it lies in the same hemisphere as v
+FORCE_INLINE normal3 vec3_face_forward(normal3 n, vec3 v) {
+    return vec3_dot(n, v) < 0.0f ? vec3_neg(n) : n;
+}
+
+// builds an orthonormal basis around the normalized v1 (Duff et al. 2017)
+FORCE_INLINE void vec3_coordinate_system(vec3 v1, vec3* v2, vec3* v3) {
+    f32 sign = copysignf(1.0f, v1.z);
+    f32 a = -1.0f / (sign + v1.z);
+    f32 b = v1.x * v1.y * a;
+    *v2 = vec3_make(1 + sign * v1.x * v1.x * a, sign * b, -sign * v1.x);
+    *v3 = vec3_make(b, sign + v1.y * v1.y * a, -v1.y);
+}
+
+FORCE_INLINE bool vec3_equal(vec3 a, vec3 b, f32 epsilon) {
+    return absf(a.x - b.x) <= epsilon && absf(a.y - b.y) <= epsilon && absf(a.z - b.z) <= epsilon;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include "checkpoint.h"
+#include <stdio.h>
+#include <string.h>
+#include "platform.h"
+#include "logger.h"
+#include "memory.h"
+
+#define CHECKPOINT_MAGIC "PBCK"
+
+typedef struct checkpoint_header {
+    char magic[4];
+    u32 version;
+    // sizeof of the header and of a pixel, a writer with another layout is rejected
+    u32 header_size;
+    u32 pixel_size;
+    u32 width;
+    u32 height;
+    u32 filter_type;
+    f32 filter_radius;
+    f32 filter_sigma;
+    f32 filter_b;
+    f32 filter_c;
+    u32 samples_done;
+    u32 passes;
+    // the film_pixel_stats array follows the pixels when set
+    u32 has_stats;
+    u32 sampler_type;
+    u32 samples_per_pixel;
+    u64 seed;
+    u64 samples_taken;
+    u64 pixel_bytes;
+    u64 stats_bytes;
+} checkpoint_header;
+
+static void fill_header(checkpoint_header* h, const film* f) {
+    memset(h, 0, sizeof(checkpoint_header));
+    memcpy(h->magic, CHECKPOINT_MAGIC, 4);
+    h->version = RENDER_CHECKPOINT_VERSION;
+    h->header_size = sizeof(checkpoint_header);
+    h->pixel_size = sizeof(film_pixel);
+    h->width = f->width;
+    h->height = f->height;
+    h->filter_type = (u32)f->filter.type;
+    h->filter_radius = f->filter.radius;
+    h->filter_sigma = f->filter.sigma;
+    h->filter_b = f->filter.b;
+    h->filter_c = f->filter.c;
+    h->has_stats = f->stats != 0;
+    h->pixel_bytes = sizeof(film_pixel) * (u64)f->width * f->height;
+    h->stats_bytes = f->stats ? sizeof(film_pixel_stats) * (u64)f->width * f->height : 0;
+}
+
+bool render_checkpoint_write(const char* path, const film* f, const render_checkpoint* state) {
+    char temporary[1024];
+    if (log_buffer(temporary, sizeof(temporary), "%s.tmp", path) >= sizeof(temporary)) {
+        return FALSE;
+    }
+    checkpoint_header h;
+    fill_header(&h, f);
+    h.samples_done = state->samples_done;
+    h.passes = state->passes;
+    h.seed = state->seed;
+    h.sampler_type = state->sampler_type;
+    h.samples_per_pixel = state->samples_per_pixel;
+    h.samples_taken = state->samples_taken;
+
+    platform_file file;
+    if (!platform_file_open(temporary, PLATFORM_FILE_WRITE, &file)) {
+        LOGE("render_checkpoint_write: cannot create %s", temporary);
+        return FALSE;
+    }
+    bool written = platform_file_write(&file, &h, sizeof(h)) == sizeof(h) &&
+                   platform_file_write(&file, f->pixels, h.pixel_bytes) == h.pixel_bytes &&
+                   (!f->stats || platform_file_write(&file, f->stats, h.stats_bytes) == h.stats_bytes) &&
+                   platform_file_flush(&file);
+    platform_file_close(&file);
+    if (!written || !platform_file_replace(temporary, path)) {
+        LOGE("render_checkpoint_write: cannot write %s", path);
+        remove(temporary);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+bool render_checkpoint_read(const char* path, film* f, render_checkpoint* state) {
+    platform_file_mapping mapping;
+    if (!platform_file_map(path, &mapping)) {
+        return FALSE;
+    }
+    checkpoint_header expected;
+    fill_header(&expected, f);
+    const checkpoint_header* h = (const checkpoint_header*)mapping.data;
+    bool valid = mapping.size >= sizeof(checkpoint_header) && memcmp(h->magic, CHECKPOINT_MAGIC, 4) == 0 &&
+                 h->version == RENDER_CHECKPOINT_VERSION && h->header_size == expected.header_size &&
+                 h->pixel_size == expected.pixel_size;
+    if (!valid) {
+        LOGW("render_checkpoint_read: %s is not a version %u checkpoint", path, RENDER_CHECKPOINT_VERSION);
+    } else if (h->width != expected.width || h->height != expected.height || h->filter_type != expected.filter_type ||
+               h->filter_radius != expected.filter_radius || h->filter_sigma != expected.filter_sigma ||
+               h->filter_b != expected.filter_b || h->filter_c != expected.filter_c ||
+               h->has_stats != expected.has_stats) {
+        LOGW("render_checkpoint_read: %s was written for another film", path);
+        valid = FALSE;
+    } else if (h->pixel_bytes != expected.pixel_bytes || h->stats_bytes != expected.stats_bytes ||
+               mapping.size != sizeof(checkpoint_header) + h->pixel_bytes + h->stats_bytes) {
+        LOGW("render_checkpoint_read: %s is truncated", path);
+        valid = FALSE;
+    }
+    if (valid) {
+        const u8* data = (const u8*)mapping.data + sizeof(checkpoint_header);
+        memcpy(f->pixels, data, h->pixel_bytes);
+        if (f->stats) {
+            memcpy(f->stats, data + h->pixel_bytes, h->stats_bytes);
+        }
+        state->seed = h->seed;
+        state->sampler_type = h->sampler_type;
+        state->samples_per_pixel = h->samples_per_pixel;
+        state->samples_taken = h->samples_taken;
+        state->samples_done = h->samples_done;
+        state->passes = h->passes;
+    }
+    platform_file_unmap(&mapping);
+    return valid;
+}
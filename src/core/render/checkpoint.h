@@ -0,0 +1,51 @@
+#ifndef CHECKPOINT__H
+#define CHECKPOINT__H
+
+#include "defines.h"
+#include "film.h"
+
+/***
+ *     ██████ ██   ██ ███████  ██████ ██   ██ ██████   ██████  ██ ███    ██ ████████
+ *    ██      ██   ██ ██      ██      ██  ██  ██   ██ ██    ██ ██ ████   ██    ██
+ *    ██      ███████ █████   ██      █████   ██████  ██    ██ ██ ██ ██  ██    ██
+ *    ██      ██   ██ ██      ██      ██  ██  ██      ██    ██ ██ ██  ██ ██    ██
+ *     ██████ ██   ██ ███████  ██████ ██   ██ ██       ██████  ██ ██   ████    ██
+ *
+ *
+ */
+
+// snapshot of a progressive render: the accumulated pixels of the film and where sampling
+// stands. sample positions are a pure function of the sampler's type, seed and sample count,
+// the pixel and the sample index, so those and the number of samples already taken are the
+// whole sampler state and a resumed render continues with exactly the samples the
+// interrupted one would have taken.
+// films tracking variance also store their pixel statistics, which hold the sample count of
+// every pixel of an adaptive render.
+// files are written next to the destination and renamed over it once flushed, a process
+// killed mid write leaves the previous checkpoint intact.
+// like the geometry cache, the file stores the writer's byte order and struct layout
+
+#define RENDER_CHECKPOINT_VERSION 3
+
+typedef struct render_checkpoint {
+    u64 seed;
+    // every pixel holds the samples [0, samples_done), or fewer in adaptive renders
+    u32 samples_done;
+    // passes rendered so far
+    u32 passes;
+    // samples taken over the whole film
+    u64 samples_taken;
+    // the sampler_type and samples_per_pixel of the sampler the samples came from
+    u32 sampler_type;
+    u32 samples_per_pixel;
+} render_checkpoint;
+
+// FALSE when the file cannot be written, an existing checkpoint is then left as it was
+bool render_checkpoint_write(const char* path, const film* f, const render_checkpoint* state);
+
+// loads the pixels of the checkpoint at path into f. FALSE, leaving f untouched, when the
+// file is missing, truncated, from another format version or layout, or was written for a
+// film of another size or filter or with variance tracking set differently
+bool render_checkpoint_read(const char* path, film* f, render_checkpoint* state);
+
+#endif
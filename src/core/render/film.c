@@ -0,0 +1,291 @@
+#include "film.h"
+#include <math.h>
+#include <string.h>
+#include "math_utils.h"
+#include "zatomic.h"
+#include "logger.h"
+#include "memory.h"
+
+// filter values over one quadrant of the support, the filters are all symmetric
+#define FILTER_TABLE_WIDTH 16
+// splats reach at most this many pixels along an axis
+#define FILTER_MAX_FOOTPRINT 64
+#define ERROR_MEAN_FLOOR 0.01f
+
+typedef struct film_state {
+    f32 table[FILTER_TABLE_WIDTH * FILTER_TABLE_WIDTH];
+    f32 inv_radius;
+} film_state;
+
+// ============================================================================
+// FILTERS
+// ============================================================================
+
+void film_filter_default(film_filter* filter, film_filter_type type) {
+    filter->type = type;
+    filter->sigma = 0.5f;
+    filter->b = 1.0f / 3.0f;
+    filter->c = 1.0f / 3.0f;
+    switch (type) {
+        case FILM_FILTER_BOX:
+            filter->radius = 0.5f;
+            break;
+        case FILM_FILTER_GAUSSIAN:
+            filter->radius = 1.5f;
+            break;
+        default:
+            filter->radius = 2.0f;
+            break;
+    }
+}
+
+static f32 gaussian(f32 x, f32 sigma) {
+    return expf(-(x * x) / (2 * sigma * sigma));
+}
+
+// x in [-2, 2]
+static f32 mitchell(f32 x, f32 b, f32 c) {
+    x = absf(x);
+    if (x <= 1) {
+        return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x + (6 - 2 * b)) * (1.0f / 6.0f);
+    }
+    if (x <= 2) {
+        return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x + (-12 * b - 48 * c) * x + (8 * b + 24 * c)) *
+               (1.0f / 6.0f);
+    }
+    return 0;
+}
+
+f32 film_filter_evaluate(const film_filter* filter, f32 x, f32 y) {
+    f32 r = filter->radius;
+    if (absf(x) > r || absf(y) > r) {
+        return 0;
+    }
+    switch (filter->type) {
+        case FILM_FILTER_BOX:
+            return 1;
+        case FILM_FILTER_TRIANGLE:
+            return (r - absf(x)) * (r - absf(y));
+        case FILM_FILTER_GAUSSIAN: {
+            f32 edge = gaussian(r, filter->sigma);
+            return maxf(0, gaussian(x, filter->sigma) - edge) * maxf(0, gaussian(y, filter->sigma) - edge);
+        }
+        case FILM_FILTER_MITCHELL:
+            return mitchell(2 * x / r, filter->b, filter->c) * mitchell(2 * y / r, filter->b, filter->c);
+    }
+    return 0;
+}
+
+// ============================================================================
+// FILM
+// ============================================================================
+
+void film_options_default(film_options* options, u32 width, u32 height) {
+    options->width = width;
+    options->height = height;
+    options->tile_size = 32;
+    film_filter_default(&options->filter, FILM_FILTER_GAUSSIAN);
+    options->track_variance = FALSE;
+}
+
+void film_create(film* f, const film_options* options) {
+    film_options defaults;
+    if (!options) {
+        film_options_default(&defaults, 1, 1);
+        options = &defaults;
+    }
+    ASSERT(options->width && options->height && options->tile_size);
+    ASSERT(options->filter.radius >= 0.5f && options->filter.radius * 2 < FILTER_MAX_FOOTPRINT);
+    f->width = options->width;
+    f->height = options->height;
+    f->tile_size = options->tile_size;
+    f->tiles_x = (f->width + f->tile_size - 1) / f->tile_size;
+    f->tiles_y = (f->height + f->tile_size - 1) / f->tile_size;
+    f->tile_count = f->tiles_x * f->tiles_y;
+    f->filter = options->filter;
+    // a sample anywhere in pixel i reaches pixels i - apron .. i + apron
+    f->apron = (u32)floorf(f->filter.radius + 0.5f);
+    f->pixels = (film_pixel*)memory_allocate_aligned(sizeof(film_pixel) * (u64)f->width * f->height, 64);
+    f->stats = 0;
+    if (options->track_variance) {
+        f->stats = (film_pixel_stats*)memory_allocate_aligned(sizeof(film_pixel_stats) * (u64)f->width * f->height, 64);
+    }
+
+    film_state* state = (film_state*)memory_allocate(sizeof(film_state));
+    state->inv_radius = 1.0f / f->filter.radius;
+    for (u32 j = 0; j < FILTER_TABLE_WIDTH; ++j) {
+        for (u32 i = 0; i < FILTER_TABLE_WIDTH; ++i) {
+            f32 x = (i + 0.5f) * f->filter.radius / FILTER_TABLE_WIDTH;
+            f32 y = (j + 0.5f) * f->filter.radius / FILTER_TABLE_WIDTH;
+            state->table[j * FILTER_TABLE_WIDTH + i] = film_filter_evaluate(&f->filter, x, y);
+        }
+    }
+    f->internal_data = state;
+    film_clear(f);
+}
+
+void film_destroy(film* f) {
+    if (f->pixels) {
+        memory_free_aligned(f->pixels);
+    }
+    if (f->stats) {
+        memory_free_aligned(f->stats);
+    }
+    if (f->internal_data) {
+        memory_free(f->internal_data);
+    }
+    f->pixels = 0;
+    f->stats = 0;
+    f->internal_data = 0;
+}
+
+void film_clear(film* f) {
+    memset(f->pixels, 0, sizeof(film_pixel) * (u64)f->width * f->height);
+    if (f->stats) {
+        memset(f->stats, 0, sizeof(film_pixel_stats) * (u64)f->width * f->height);
+    }
+}
+
+void film_resolve(const film* f, f32* rgb) {
+    u64 count = (u64)f->width * f->height;
+    for (u64 i = 0; i < count; ++i) {
+        const film_pixel* p = &f->pixels[i];
+        f32 inv = p->weight != 0 ? 1.0f / p->weight : 0;
+        rgb[i * 3 + 0] = p->r * inv;
+        rgb[i * 3 + 1] = p->g * inv;
+        rgb[i * 3 + 2] = p->b * inv;
+    }
+}
+
+// ============================================================================
+// VARIANCE
+// ============================================================================
+
+void film_record_sample(film* f, u32 x, u32 y, const f32* rgb) {
+    film_pixel_stats* s = &f->stats[(u64)y * f->width + x];
+    f32 luminance = 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+    ++s->count;
+    f32 delta = luminance - s->mean;
+    s->mean += delta / (f32)s->count;
+    s->m2 += delta * (luminance - s->mean);
+}
+
+f32 film_pixel_error(const film* f, u32 x, u32 y) {
+    const film_pixel_stats* s = &f->stats[(u64)y * f->width + x];
+    if (s->count < 2) {
+        return MAX_F32;
+    }
+    f32 n = (f32)s->count;
+    // variance of the mean is the sample variance over n
+    f32 variance_of_mean = s->m2 / ((n - 1) * n);
+    return sqrtf(maxf(variance_of_mean, 0)) / maxf(absf(s->mean), ERROR_MEAN_FLOOR);
+}
+
+f32 film_tile_error(const film* f, u32 index) {
+    u32 x0 = (index % f->tiles_x) * f->tile_size;
+    u32 y0 = (index / f->tiles_x) * f->tile_size;
+    u32 x1 = x0 + f->tile_size < f->width ? x0 + f->tile_size : f->width;
+    u32 y1 = y0 + f->tile_size < f->height ? y0 + f->tile_size : f->height;
+    f32 error = 0;
+    for (u32 y = y0; y < y1; ++y) {
+        for (u32 x = x0; x < x1; ++x) {
+            error = maxf(error, film_pixel_error(f, x, y));
+        }
+    }
+    return error;
+}
+
+// ============================================================================
+// TILES
+// ============================================================================
+
+void film_tile_begin(const film* f, u32 index, arena* a, film_tile* tile) {
+    ASSERT(index < f->tile_count);
+    tile->index = index;
+    tile->x0 = (index % f->tiles_x) * f->tile_size;
+    tile->y0 = (index / f->tiles_x) * f->tile_size;
+    tile->x1 = tile->x0 + f->tile_size < f->width ? tile->x0 + f->tile_size : f->width;
+    tile->y1 = tile->y0 + f->tile_size < f->height ? tile->y0 + f->tile_size : f->height;
+    tile->buffer_x = tile->x0 > f->apron ? tile->x0 - f->apron : 0;
+    tile->buffer_y = tile->y0 > f->apron ? tile->y0 - f->apron : 0;
+    u32 buffer_x1 = tile->x1 + f->apron < f->width ? tile->x1 + f->apron : f->width;
+    u32 buffer_y1 = tile->y1 + f->apron < f->height ? tile->y1 + f->apron : f->height;
+    tile->buffer_width = buffer_x1 - tile->buffer_x;
+    tile->buffer_height = buffer_y1 - tile->buffer_y;
+    u64 bytes = sizeof(film_pixel) * (u64)tile->buffer_width * tile->buffer_height;
+    tile->pixels = (film_pixel*)arena_allocate(a, bytes, 64);
+    memset(tile->pixels, 0, bytes);
+}
+
+void film_tile_add_sample(const film* f, film_tile* tile, f32 x, f32 y, const f32* rgb) {
+    const film_state* state = (const film_state*)f->internal_data;
+    f32 r = f->filter.radius;
+    // discrete coordinates of the sample, pixel i has its center at i + 0.5
+    f32 dx = x - 0.5f;
+    f32 dy = y - 0.5f;
+    i32 px0 = (i32)ceilf(dx - r);
+    i32 py0 = (i32)ceilf(dy - r);
+    i32 px1 = (i32)floorf(dx + r);
+    i32 py1 = (i32)floorf(dy + r);
+    i32 bx0 = (i32)tile->buffer_x;
+    i32 by0 = (i32)tile->buffer_y;
+    px0 = px0 > bx0 ? px0 : bx0;
+    py0 = py0 > by0 ? py0 : by0;
+    px1 = px1 < bx0 + (i32)tile->buffer_width - 1 ? px1 : bx0 + (i32)tile->buffer_width - 1;
+    py1 = py1 < by0 + (i32)tile->buffer_height - 1 ? py1 : by0 + (i32)tile->buffer_height - 1;
+    if (px0 > px1 || py0 > py1) {
+        return;
+    }
+
+    // the table column of every pixel in the footprint, shared by all its rows
+    u32 column[FILTER_MAX_FOOTPRINT];
+    f32 scale = state->inv_radius * FILTER_TABLE_WIDTH;
+    for (i32 px = px0; px <= px1; ++px) {
+        u32 i = (u32)(absf((f32)px - dx) * scale);
+        column[px - px0] = i < FILTER_TABLE_WIDTH ? i : FILTER_TABLE_WIDTH - 1;
+    }
+    for (i32 py = py0; py <= py1; ++py) {
+        u32 j = (u32)(absf((f32)py - dy) * scale);
+        const f32* row = &state->table[(j < FILTER_TABLE_WIDTH ? j : FILTER_TABLE_WIDTH - 1) * FILTER_TABLE_WIDTH];
+        film_pixel* p = &tile->pixels[(u64)(py - by0) * tile->buffer_width + (u32)(px0 - bx0)];
+        for (i32 px = px0; px <= px1; ++px, ++p) {
+            f32 w = row[column[px - px0]];
+            p->r += w * rgb[0];
+            p->g += w * rgb[1];
+            p->b += w * rgb[2];
+            p->weight += w;
+        }
+    }
+}
+
+void film_tile_merge(film* f, const film_tile* tile) {
+    // the pixels no neighboring apron reaches. at the image edges there is no neighbor
+    // whose apron could, so the band only exists toward other tiles
+    i64 core_x0 = tile->x0 == 0 ? 0 : (i64)tile->x0 + f->apron;
+    i64 core_y0 = tile->y0 == 0 ? 0 : (i64)tile->y0 + f->apron;
+    i64 core_x1 = tile->x1 == f->width ? f->width : (i64)tile->x1 - f->apron;
+    i64 core_y1 = tile->y1 == f->height ? f->height : (i64)tile->y1 - f->apron;
+    for (u32 j = 0; j < tile->buffer_height; ++j) {
+        i64 y = (i64)tile->buffer_y + j;
+        const film_pixel* src = &tile->pixels[(u64)j * tile->buffer_width];
+        film_pixel* dst = &f->pixels[(u64)y * f->width + tile->buffer_x];
+        bool core_row = y >= core_y0 && y < core_y1;
+        for (u32 i = 0; i < tile->buffer_width; ++i) {
+            i64 x = (i64)tile->buffer_x + i;
+            if (src[i].weight == 0 && src[i].r == 0 && src[i].g == 0 && src[i].b == 0) {
+                continue;
+            }
+            if (core_row && x >= core_x0 && x < core_x1) {
+                dst[i].r += src[i].r;
+                dst[i].g += src[i].g;
+                dst[i].b += src[i].b;
+                dst[i].weight += src[i].weight;
+            } else {
+                zatomic_add_f32(&dst[i].r, src[i].r);
+                zatomic_add_f32(&dst[i].g, src[i].g);
+                zatomic_add_f32(&dst[i].b, src[i].b);
+                zatomic_add_f32(&dst[i].weight, src[i].weight);
+            }
+        }
+    }
+}
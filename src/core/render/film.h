@@ -0,0 +1,145 @@
+#ifndef FILM__H
+#define FILM__H
+
+#include "defines.h"
+#include "arena.h"
+
+/***
+ *    ███████ ██ ██      ███    ███
+ *    ██      ██ ██      ████  ████
+ *    █████   ██ ██      ██ ████ ██
+ *    ██      ██ ██      ██  ██  ██
+ *    ██      ██ ███████ ██      ██
+ *
+ *
+ */
+
+// image the renderer accumulates into, cut into square tiles. a worker rendering a tile
+// splats its samples into a private tile buffer from its own arena, covering the tile plus
+// an apron as wide as the filter reaches, and merges it into the image once the tile is
+// done. pixels further than the apron from the tile edge belong to no other tile and are
+// added with plain stores, only the bands that neighboring aprons overlap take an atomic
+// float add, so no splat ever touches shared memory and no merge takes a lock.
+// pixels hold filter weighted sums (pbrt-v3 style), film_resolve divides them out.
+// a film can also keep running statistics of the unfiltered sample luminance of every pixel,
+// which adaptive sampling uses to tell converged pixels from noisy ones. a pixel's samples
+// are all taken by the thread rendering the tile that owns it, so these need no atomics
+
+typedef enum film_filter_type {
+    FILM_FILTER_BOX,
+    FILM_FILTER_TRIANGLE,
+    FILM_FILTER_GAUSSIAN,
+    FILM_FILTER_MITCHELL,
+} film_filter_type;
+
+typedef struct film_filter {
+    film_filter_type type;
+    // the filter is zero outside [-radius, radius] on both axes
+    f32 radius;
+    // standard deviation of the gaussian
+    f32 sigma;
+    // the b and c of mitchell-netravali
+    f32 b;
+    f32 c;
+} film_filter;
+
+typedef struct film_options {
+    u32 width;
+    u32 height;
+    u32 tile_size;
+    film_filter filter;
+    // keep film_pixel_stats for every pixel
+    bool track_variance;
+} film_options;
+
+typedef struct film_pixel {
+    f32 r;
+    f32 g;
+    f32 b;
+    f32 weight;
+} film_pixel;
+
+// welford's online mean and sum of squared deviations of the sample luminance
+typedef struct film_pixel_stats {
+    u32 count;
+    f32 mean;
+    f32 m2;
+} film_pixel_stats;
+
+typedef struct film {
+    u32 width;
+    u32 height;
+    u32 tile_size;
+    u32 tiles_x;
+    u32 tiles_y;
+    u32 tile_count;
+    // pixels a splat reaches past the pixel it lands in, the apron of every tile buffer
+    u32 apron;
+    film_filter filter;
+    // width * height, row major
+    film_pixel* pixels;
+    // width * height when the film tracks variance, 0 otherwise
+    film_pixel_stats* stats;
+    void* internal_data;
+} film;
+
+// a tile being rendered: the pixels [x0, x1) x [y0, y1) it owns and the buffer covering
+// them plus the apron, clipped to the image. buffer_x/buffer_y is the image pixel the
+// buffer starts at
+typedef struct film_tile {
+    u32 index;
+    u32 x0;
+    u32 y0;
+    u32 x1;
+    u32 y1;
+    u32 buffer_x;
+    u32 buffer_y;
+    u32 buffer_width;
+    u32 buffer_height;
+    film_pixel* pixels;
+} film_tile;
+
+// the pbrt-v4 defaults: box radius 0.5, triangle 2, gaussian 1.5 with sigma 0.5 and
+// mitchell 2 with b = c = 1/3
+void film_filter_default(film_filter* filter, film_filter_type type);
+
+// value at offset (x, y) from the filter center
+f32 film_filter_evaluate(const film_filter* filter, f32 x, f32 y);
+
+// 32 pixel tiles, a gaussian filter, no variance tracking
+void film_options_default(film_options* options, u32 width, u32 height);
+
+// a cleared film. options may be null for the defaults of a 1x1 image
+void film_create(film* f, const film_options* options);
+
+void film_destroy(film* f);
+
+void film_clear(film* f);
+
+// allocates the buffer of tile index from a (the arena of the calling thread) and clears it
+void film_tile_begin(const film* f, u32 index, arena* a, film_tile* tile);
+
+// splats rgb at raster position (x, y) to every pixel of the tile buffer the filter
+// reaches. the position should lie inside the pixels the tile owns
+void film_tile_add_sample(const film* f, film_tile* tile, f32 x, f32 y, const f32* rgb);
+
+// adds the tile buffer to the image. safe to call concurrently for different tiles, the
+// same tile must not be merged twice at once
+void film_tile_merge(film* f, const film_tile* tile);
+
+// adds rgb, a sample taken in pixel (x, y), to the statistics of that pixel. only the thread
+// rendering the tile owning the pixel may call it
+void film_record_sample(film* f, u32 x, u32 y, const f32* rgb);
+
+// standard error of the mean luminance of a pixel relative to the mean, means below 1/100
+// count as 1/100 so dark pixels do not chase noise nobody sees. pixels with fewer than two
+// samples have no estimate and report MAX_F32
+f32 film_pixel_error(const film* f, u32 x, u32 y);
+
+// the largest pixel error of the pixels tile index owns
+f32 film_tile_error(const film* f, u32 index);
+
+// rgb triplets of width * height pixels, black where no sample landed
+void film_resolve(const film* f, f32* rgb);
+
+#endif
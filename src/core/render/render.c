@@ -0,0 +1,325 @@
+#include "render.h"
+#include <stdlib.h>
+#include "arena.h"
+#include "clock.h"
+#include "logger.h"
+#include "memory.h"
+
+// ============================================================================
+// SCHEDULER
+// ============================================================================
+
+void render_options_default(render_options* options) {
+    options->samples_per_pixel = 16;
+    options->first_sample = 0;
+    options->error_threshold = 0;
+    options->order = RENDER_ORDER_CENTER_OUT;
+    options->seed = 0;
+    options->sampler = 0;
+}
+
+// tiles are scheduled in ascending key order
+typedef struct tile_key {
+    u64 key;
+    u32 tile;
+} tile_key;
+
+static int compare_tile_key(const void* a, const void* b) {
+    const tile_key* x = (const tile_key*)a;
+    const tile_key* y = (const tile_key*)b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->tile < y->tile ? -1 : (x->tile > y->tile);
+}
+
+void render_schedule_tiles(const film* f, render_tile_order order, u32* tiles) {
+    if (order == RENDER_ORDER_SCANLINE) {
+        for (u32 i = 0; i < f->tile_count; ++i) {
+            tiles[i] = i;
+        }
+        return;
+    }
+    // squared distance of the tile center to the image center, in doubled pixel units
+    tile_key* sorted = (tile_key*)memory_allocate(sizeof(tile_key) * f->tile_count);
+    for (u32 i = 0; i < f->tile_count; ++i) {
+        i64 cx = (i64)((i % f->tiles_x) * 2 + 1) * f->tile_size - f->width;
+        i64 cy = (i64)((i / f->tiles_x) * 2 + 1) * f->tile_size - f->height;
+        sorted[i].key = (u64)(cx * cx + cy * cy);
+        sorted[i].tile = i;
+    }
+    qsort(sorted, f->tile_count, sizeof(tile_key), compare_tile_key);
+    for (u32 i = 0; i < f->tile_count; ++i) {
+        tiles[i] = sorted[i].tile;
+    }
+    memory_free(sorted);
+}
+
+// ============================================================================
+// DRIVER
+// ============================================================================
+
+typedef struct render_job {
+    film* f;
+    const render_options* options;
+    const u32* tiles;
+    const sampler* sampler;
+    render_sample_fn sample;
+    void* params;
+    arena* arenas;
+} render_job;
+
+static void render_tile_task(void* params, u64 index, u32 thread_index) {
+    render_job* job = (render_job*)params;
+    film* f = job->f;
+    arena* a = &job->arenas[thread_index];
+    film_tile tile;
+    film_tile_begin(f, job->tiles[index], a, &tile);
+
+    const render_options* options = job->options;
+    u32 count = options->samples_per_pixel;
+    f32* offsets_x = ARENA_ALLOCATE_ARRAY(a, f32, count);
+    f32* offsets_y = ARENA_ALLOCATE_ARRAY(a, f32, count);
+    render_sample s;
+    s.thread_index = thread_index;
+    s.sampler = job->sampler;
+    f32 rgb[3];
+    for (s.y = tile.y0; s.y < tile.y1; ++s.y) {
+        for (s.x = tile.x0; s.x < tile.x1; ++s.x) {
+            u32 first = options->first_sample;
+            if (f->stats) {
+                if (options->error_threshold > 0 && film_pixel_error(f, s.x, s.y) < options->error_threshold) {
+                    continue;
+                }
+                first = f->stats[(u64)s.y * f->width + s.x].count;
+            }
+            sampler_generate(job->sampler, s.x, s.y, first, count, 0, offsets_x);
+            sampler_generate(job->sampler, s.x, s.y, first, count, 1, offsets_y);
+            for (u32 i = 0; i < count; ++i) {
+                s.index = first + i;
+                s.film_x = (f32)s.x + offsets_x[i];
+                s.film_y = (f32)s.y + offsets_y[i];
+                job->sample(job->params, &s, rgb);
+                film_tile_add_sample(f, &tile, s.film_x, s.film_y, rgb);
+                if (f->stats) {
+                    film_record_sample(f, s.x, s.y, rgb);
+                }
+            }
+        }
+    }
+    film_tile_merge(f, &tile);
+    arena_reset(a);
+}
+
+void render_film(film* f, const render_options* options, render_sample_fn sample, void* params, zpool* pool) {
+    render_options defaults;
+    if (!options) {
+        render_options_default(&defaults);
+        options = &defaults;
+    }
+    u32* tiles = (u32*)memory_allocate(sizeof(u32) * f->tile_count);
+    render_schedule_tiles(f, options->order, tiles);
+    render_film_tiles(f, options, tiles, f->tile_count, sample, params, pool);
+    memory_free(tiles);
+}
+
+void render_film_tiles(film* f,
+                       const render_options* options,
+                       const u32* tiles,
+                       u32 tile_count,
+                       render_sample_fn sample,
+                       void* params,
+                       zpool* pool) {
+    render_options defaults;
+    if (!options) {
+        render_options_default(&defaults);
+        options = &defaults;
+    }
+    ASSERT(options->error_threshold == 0 || f->stats);
+    sampler independent;
+    const sampler* samples = options->sampler;
+    if (!samples) {
+        sampler_options sampler_defaults;
+        sampler_options_default(&sampler_defaults, f->width, f->height);
+        sampler_defaults.type = SAMPLER_INDEPENDENT;
+        sampler_defaults.samples_per_pixel = options->samples_per_pixel ? options->samples_per_pixel : 1;
+        sampler_defaults.seed = options->seed;
+        sampler_create(&independent, &sampler_defaults);
+        samples = &independent;
+    }
+    ASSERT(samples->width == f->width && samples->height == f->height);
+    // one tile buffer and the sample offsets of a pixel fit a block, so steady state
+    // rendering allocates nothing
+    u64 side = f->tile_size + 2 * f->apron;
+    u32 arena_count = pool ? zpool_thread_count(pool) : 1;
+    arena* arenas = (arena*)memory_allocate(sizeof(arena) * arena_count);
+    for (u32 i = 0; i < arena_count; ++i) {
+        arena_create(&arenas[i], side * side * sizeof(film_pixel) + 2 * sizeof(f32) * options->samples_per_pixel + 192);
+    }
+
+    render_job job = {f, options, tiles, samples, sample, params, arenas};
+    zpool_parallel_for(pool, tile_count, 1, render_tile_task, &job);
+
+    for (u32 i = 0; i < arena_count; ++i) {
+        arena_destroy(&arenas[i]);
+    }
+    memory_free(arenas);
+    if (!options->sampler) {
+        sampler_destroy(&independent);
+    }
+}
+
+// ============================================================================
+// PROGRESSIVE
+// ============================================================================
+
+void render_progressive_options_default(render_progressive_options* options) {
+    render_options_default(&options->render);
+    options->samples_per_pass = 4;
+    options->min_samples = 16;
+    options->checkpoint_path = 0;
+    options->checkpoint_interval = 300;
+    options->resume = FALSE;
+    options->stop = 0;
+}
+
+typedef struct tile_error_job {
+    const film* f;
+    tile_key* errors;
+} tile_error_job;
+
+static void tile_error_task(void* params, u64 index, u32 thread_index) {
+    tile_error_job* job = (tile_error_job*)params;
+    f32 error = film_tile_error(job->f, (u32)index);
+    job->errors[index].tile = (u32)index;
+    // sorting ascending by the negated bits puts the noisiest tile first, errors are never
+    // negative so their bit patterns order like the values
+    union {
+        f32 f;
+        u32 u;
+    } bits = {error};
+    job->errors[index].key = ~(u64)bits.u;
+}
+
+// the tiles still above threshold, noisiest first, so the tiles that need the most work are
+// started early and the cheap ones fill the gaps at the end of the pass
+static u32 schedule_noisy_tiles(const film* f, f32 threshold, tile_key* errors, u32* tiles, zpool* pool) {
+    tile_error_job job = {f, errors};
+    zpool_parallel_for(pool, f->tile_count, 0, tile_error_task, &job);
+    qsort(errors, f->tile_count, sizeof(tile_key), compare_tile_key);
+    union {
+        f32 f;
+        u32 u;
+    } bits = {threshold};
+    u32 count = 0;
+    while (count < f->tile_count && errors[count].key <= ~(u64)bits.u) {
+        tiles[count] = errors[count].tile;
+        ++count;
+    }
+    return count;
+}
+
+static u64 count_samples(const film* f, const render_checkpoint* state) {
+    if (!f->stats) {
+        return (u64)state->samples_done * f->width * f->height;
+    }
+    u64 total = 0;
+    for (u64 i = 0; i < (u64)f->width * f->height; ++i) {
+        total += f->stats[i].count;
+    }
+    return total;
+}
+
+bool render_progressive(film* f,
+                        const render_progressive_options* options,
+                        render_sample_fn sample,
+                        void* params,
+                        zpool* pool,
+                        render_checkpoint* progress) {
+    render_progressive_options defaults;
+    if (!options) {
+        render_progressive_options_default(&defaults);
+        options = &defaults;
+    }
+    ASSERT(options->samples_per_pass);
+    const char* path = options->checkpoint_path;
+    // the sampler the samples come from, render_film's own when none is given
+    const sampler* samples = options->render.sampler;
+    render_checkpoint state = {options->render.seed, 0, 0, 0, SAMPLER_INDEPENDENT, options->render.samples_per_pixel};
+    if (samples) {
+        state.seed = samples->seed;
+        state.sampler_type = (u32)samples->type;
+        state.samples_per_pixel = samples->samples_per_pixel;
+    }
+    bool resumed = FALSE;
+    if (options->resume && path) {
+        render_checkpoint loaded;
+        resumed = render_checkpoint_read(path, f, &loaded);
+        if (resumed && (loaded.sampler_type != state.sampler_type || loaded.seed != state.seed ||
+                        loaded.samples_per_pixel != state.samples_per_pixel)) {
+            LOGW("render_progressive: %s was rendered with another sampler, seed or sample count, starting over", path);
+            resumed = FALSE;
+        } else if (resumed && loaded.samples_done > options->render.samples_per_pixel) {
+            LOGW("render_progressive: %s was rendered with more samples, starting over", path);
+            resumed = FALSE;
+        }
+        if (resumed) {
+            state = loaded;
+            LOGI("render_progressive: resuming %s at %u samples per pixel", path, state.samples_done);
+        }
+    }
+    if (!resumed) {
+        film_clear(f);
+    }
+
+    f32 threshold = options->render.error_threshold;
+    u32* tiles = (u32*)memory_allocate(sizeof(u32) * f->tile_count);
+    tile_key* errors = threshold > 0 ? (tile_key*)memory_allocate(sizeof(tile_key) * f->tile_count) : 0;
+    render_schedule_tiles(f, options->render.order, tiles);
+    u32 tile_count = f->tile_count;
+
+    bool saved = TRUE;
+    bool dirty = FALSE;
+    clock clk;
+    clock_set(&clk);
+    f64 last_checkpoint = 0;
+    u32 target = options->render.samples_per_pixel;
+    while (state.samples_done < target && !(options->stop && *options->stop)) {
+        render_options pass = options->render;
+        pass.first_sample = state.samples_done;
+        pass.samples_per_pixel = target - state.samples_done < options->samples_per_pass ? target - state.samples_done
+                                                                                         : options->samples_per_pass;
+        bool adapting = threshold > 0 && state.samples_done >= options->min_samples;
+        pass.error_threshold = adapting ? threshold : 0;
+        if (adapting) {
+            tile_count = schedule_noisy_tiles(f, threshold, errors, tiles, pool);
+            if (tile_count == 0) {
+                break;
+            }
+        }
+        render_film_tiles(f, &pass, tiles, tile_count, sample, params, pool);
+        state.samples_done += pass.samples_per_pixel;
+        ++state.passes;
+        dirty = TRUE;
+        clock_update(&clk);
+        if (path && clk.elapsed - last_checkpoint >= options->checkpoint_interval) {
+            state.samples_taken = count_samples(f, &state);
+            saved = render_checkpoint_write(path, f, &state) && saved;
+            last_checkpoint = clk.elapsed;
+            dirty = FALSE;
+        }
+    }
+    // finished, converged or stopped, whatever was rendered since the last checkpoint is kept
+    state.samples_taken = count_samples(f, &state);
+    if (path && dirty) {
+        saved = render_checkpoint_write(path, f, &state) && saved;
+    }
+    if (progress) {
+        *progress = state;
+    }
+    if (errors) {
+        memory_free(errors);
+    }
+    memory_free(tiles);
+    return saved;
+}
@@ -0,0 +1,129 @@
+#ifndef RENDER__H
+#define RENDER__H
+
+#include "defines.h"
+#include "film.h"
+#include "checkpoint.h"
+#include "sampler.h"
+#include "zpool.h"
+
+/***
+ *    ██████  ███████ ███    ██ ██████  ███████ ██████
+ *    ██   ██ ██      ████   ██ ██   ██ ██      ██   ██
+ *    ██████  █████   ██ ██  ██ ██   ██ █████   ██████
+ *    ██   ██ ██      ██  ██ ██ ██   ██ ██      ██   ██
+ *    ██   ██ ███████ ██   ████ ██████  ███████ ██   ██
+ *
+ *
+ */
+
+// drives a film tile by tile across the pool. the scheduler decides the order tiles are
+// handed out in, each thread renders the tiles it picks up into a buffer from its own arena
+// and merges it into the film when the tile is finished. what a sample sees is up to the
+// caller: the driver places every sample and asks a callback for its radiance. sample
+// positions come from dimensions 0 and 1 of a sampler, generated for all the samples of a
+// pixel at once, the callback takes whatever else it needs from dimension 2 on.
+// on films that track variance rendering can be adaptive: pixels whose estimated error fell
+// below a threshold take no more samples, and progressive renders only schedule the tiles
+// still above it, noisiest first
+
+typedef enum render_tile_order {
+    // row by row from the top left
+    RENDER_ORDER_SCANLINE,
+    // nearest to the image center first, the part of the image that usually matters
+    RENDER_ORDER_CENTER_OUT,
+} render_tile_order;
+
+typedef struct render_sample {
+    // the pixel and which of its samples this is
+    u32 x;
+    u32 y;
+    u32 index;
+    // raster position inside the pixel
+    f32 film_x;
+    f32 film_y;
+    // the pool thread rendering it, for per thread scratch data
+    u32 thread_index;
+    // where the sample's other dimensions come from, starting at dimension 2
+    const sampler* sampler;
+} render_sample;
+
+// writes the rgb radiance arriving through sample
+typedef void (*render_sample_fn)(void* params, const render_sample* sample, f32* rgb);
+
+typedef struct render_options {
+    u32 samples_per_pixel;
+    // index of the first sample taken in every pixel, a pass continuing earlier ones starts
+    // where they stopped. on films tracking variance every pixel continues at its own
+    // sample count instead
+    u32 first_sample;
+    // relative error (film_pixel_error) below which a pixel takes no more samples, 0 samples
+    // every pixel. needs a film tracking variance
+    f32 error_threshold;
+    render_tile_order order;
+    // sample positions depend on the pixel, the sample index and the seed only, so the
+    // image does not depend on the thread count or the order tiles finish in
+    u64 seed;
+    // sampler of the image, null samples independently with seed. its seed replaces the
+    // one above. a resumed render must use the sampler of the interrupted one
+    const sampler* sampler;
+} render_options;
+
+typedef struct render_progressive_options {
+    // samples_per_pixel is the total every pixel ends up with
+    render_options render;
+    // samples added to every pixel between checkpoints and stop checks
+    u32 samples_per_pass;
+    // where checkpoints go, 0 for none
+    const char* checkpoint_path;
+    // samples every pixel takes before its error estimate is trusted, adaptive renders
+    // (render.error_threshold above 0) sample uniformly until then
+    u32 min_samples;
+    // seconds between checkpoints, 0 writes one after every pass. the finished image is
+    // always checkpointed
+    f64 checkpoint_interval;
+    // continue from the checkpoint at checkpoint_path when there is a usable one
+    bool resume;
+    // polled between passes, once nonzero the render checkpoints and returns. may be null
+    volatile u32* stop;
+} render_progressive_options;
+
+// 16 samples per pixel starting at sample 0, center out, not adaptive, independent samples
+void render_options_default(render_options* options);
+
+// 4 samples per pass, 16 before adapting, checkpoints every 5 minutes when a path is set,
+// no resume
+void render_progressive_options_default(render_progressive_options* options);
+
+// the tile indices of f in the order they are scheduled, tile_count of them
+void render_schedule_tiles(const film* f, render_tile_order order, u32* tiles);
+
+// renders every pixel of f, accumulating on top of what the film already holds. options
+// and pool may be null
+void render_film(film* f, const render_options* options, render_sample_fn sample, void* params, zpool* pool);
+
+// renders the tile_count tiles listed in tiles, handed out in list order. options.order is
+// not used
+void render_film_tiles(film* f,
+                       const render_options* options,
+                       const u32* tiles,
+                       u32 tile_count,
+                       render_sample_fn sample,
+                       void* params,
+                       zpool* pool);
+
+// renders f in passes until every pixel has render.samples_per_pixel samples or stop is
+// raised, checkpointing along the way. adaptive renders also finish once every tile is
+// below the error threshold. when resuming, a checkpoint written for another film or for
+// another sampler type, seed or sample count is ignored and the render starts over. the
+// film is cleared first unless a checkpoint was loaded. progress receives where the render
+// stopped and may be null. returns FALSE when a checkpoint could not be written, the film
+// is complete or stopped regardless
+bool render_progressive(film* f,
+                        const render_progressive_options* options,
+                        render_sample_fn sample,
+                        void* params,
+                        zpool* pool,
+                        render_checkpoint* progress);
+
+#endif
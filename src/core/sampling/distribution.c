@@ -0,0 +1,237 @@
+#include "distribution.h"
+#include <string.h>
+#include "math_utils.h"
+#include "logger.h"
+#include "memory.h"
+
+// the largest float below one
+#define ONE_MINUS_EPSILON 0x1.fffffep-1f
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+// vose's worklists and the scaled probabilities while they are paired up, count of each
+typedef struct alias_scratch {
+    u32* work;
+    f64* p;
+} alias_scratch;
+
+// fills the arrays d already points to from func
+static void build(distribution1d* d, const f32* func, alias_scratch* scratch) {
+    u32 n = d->count;
+    f64 sum = 0;
+    for (u32 i = 0; i < n; ++i) {
+        d->func[i] = absf(func[i]);
+        sum += d->func[i];
+    }
+    d->integral = (f32)(sum / n);
+
+    f64 running = 0;
+    d->cdf[0] = 0;
+    for (u32 i = 0; i < n; ++i) {
+        running += d->func[i];
+        d->cdf[i + 1] = sum > 0 ? (f32)(running / sum) : (f32)(i + 1) / (f32)n;
+    }
+    d->cdf[n] = 1;
+
+    // bins below the average go on the small list growing up from 0, the others on the
+    // large list growing down from n. every small bin is topped up by a large one, which
+    // moves to the small list once it has given away enough
+    u32* work = scratch->work;
+    f64* p = scratch->p;
+    u32 small = 0, large = n;
+    for (u32 i = 0; i < n; ++i) {
+        p[i] = sum > 0 ? d->func[i] * n / sum : 1.0;
+        d->alias[i].alias = i;
+        if (p[i] < 1) {
+            work[small++] = i;
+        } else {
+            work[--large] = i;
+        }
+    }
+    while (small && large < n) {
+        u32 s = work[--small];
+        u32 l = work[large++];
+        d->alias[s].q = (f32)p[s];
+        d->alias[s].alias = l;
+        p[l] = (p[l] + p[s]) - 1.0;
+        if (p[l] < 1) {
+            work[small++] = l;
+        } else {
+            work[--large] = l;
+        }
+    }
+    // what is left is 1 up to rounding
+    while (small) {
+        d->alias[work[--small]].q = 1;
+    }
+    while (large < n) {
+        d->alias[work[large++]].q = 1;
+    }
+}
+
+// ============================================================================
+// 1D
+// ============================================================================
+
+void distribution1d_create(distribution1d* d, const f32* func, u32 count) {
+    ASSERT(count);
+    d->count = count;
+    d->func = (f32*)memory_allocate(sizeof(f32) * count);
+    d->cdf = (f32*)memory_allocate(sizeof(f32) * (count + 1));
+    d->alias = (distribution_alias*)memory_allocate(sizeof(distribution_alias) * count);
+    alias_scratch scratch;
+    scratch.work = (u32*)memory_allocate(sizeof(u32) * count);
+    scratch.p = (f64*)memory_allocate(sizeof(f64) * count);
+    build(d, func, &scratch);
+    memory_free(scratch.work);
+    memory_free(scratch.p);
+}
+
+void distribution1d_destroy(distribution1d* d) {
+    memory_free(d->func);
+    memory_free(d->cdf);
+    memory_free(d->alias);
+    memset(d, 0, sizeof(distribution1d));
+}
+
+FORCE_INLINE f32 bin_pdf(const distribution1d* d, u32 offset) {
+    return d->integral > 0 ? d->func[offset] / d->integral : 1.0f;
+}
+
+f32 distribution1d_sample_alias(const distribution1d* d, f32 u, f32* pdf, u32* offset) {
+    f32 scaled = u * (f32)d->count;
+    u32 i = (u32)scaled < d->count ? (u32)scaled : d->count - 1;
+    f32 up = scaled - (f32)i;
+    const distribution_alias* entry = &d->alias[i];
+    u32 bin;
+    f32 remapped;
+    if (up < entry->q) {
+        bin = i;
+        remapped = up / entry->q;
+    } else {
+        bin = entry->alias;
+        remapped = (up - entry->q) / (1.0f - entry->q);
+    }
+    *pdf = bin_pdf(d, bin);
+    *offset = bin;
+    return minf(((f32)bin + minf(remapped, ONE_MINUS_EPSILON)) / (f32)d->count, ONE_MINUS_EPSILON);
+}
+
+f32 distribution1d_sample_cdf(const distribution1d* d, f32 u, f32* pdf, u32* offset) {
+    // the last bin whose cdf is at most u, skipping empty bins
+    u32 first = 0, size = d->count;
+    while (size > 1) {
+        u32 half = size >> 1;
+        u32 middle = first + half;
+        if (d->cdf[middle] <= u) {
+            first = middle;
+            size -= half;
+        } else {
+            size = half;
+        }
+    }
+    f32 width = d->cdf[first + 1] - d->cdf[first];
+    f32 du = width > 0 ? (u - d->cdf[first]) / width : 0.0f;
+    *pdf = bin_pdf(d, first);
+    *offset = first;
+    return minf(((f32)first + minf(du, ONE_MINUS_EPSILON)) / (f32)d->count, ONE_MINUS_EPSILON);
+}
+
+f32 distribution1d_pdf(const distribution1d* d, f32 x) {
+    u32 i = (u32)(x * (f32)d->count);
+    return bin_pdf(d, i < d->count ? i : d->count - 1);
+}
+
+// ============================================================================
+// 2D
+// ============================================================================
+
+typedef struct rows_job {
+    distribution2d* d;
+    const f32* func;
+    // one per thread
+    alias_scratch* scratch;
+} rows_job;
+
+static void row_task(void* params, u64 index, u32 thread_index) {
+    rows_job* job = (rows_job*)params;
+    build(&job->d->conditional[index], job->func + index * job->d->width, &job->scratch[thread_index]);
+}
+
+void distribution2d_create(distribution2d* d, const f32* func, u32 width, u32 height, zpool* pool) {
+    ASSERT(width && height);
+    d->width = width;
+    d->height = height;
+    d->conditional = (distribution1d*)memory_allocate(sizeof(distribution1d) * height);
+    u64 cells = (u64)width * height;
+    f32* funcs = (f32*)memory_allocate(sizeof(f32) * cells);
+    f32* cdfs = (f32*)memory_allocate(sizeof(f32) * (width + 1) * height);
+    distribution_alias* aliases = (distribution_alias*)memory_allocate(sizeof(distribution_alias) * cells);
+    for (u32 y = 0; y < height; ++y) {
+        distribution1d* row = &d->conditional[y];
+        row->func = funcs + (u64)y * width;
+        row->cdf = cdfs + (u64)y * (width + 1);
+        row->alias = aliases + (u64)y * width;
+        row->count = width;
+    }
+
+    u32 thread_count = pool ? zpool_thread_count(pool) : 1;
+    alias_scratch* scratch = (alias_scratch*)memory_allocate(sizeof(alias_scratch) * thread_count);
+    for (u32 t = 0; t < thread_count; ++t) {
+        scratch[t].work = (u32*)memory_allocate(sizeof(u32) * width);
+        scratch[t].p = (f64*)memory_allocate(sizeof(f64) * width);
+    }
+    rows_job job = {d, func, scratch};
+    zpool_parallel_for(pool, height, 0, row_task, &job);
+    for (u32 t = 0; t < thread_count; ++t) {
+        memory_free(scratch[t].work);
+        memory_free(scratch[t].p);
+    }
+    memory_free(scratch);
+
+    f32* marginal = (f32*)memory_allocate(sizeof(f32) * height);
+    for (u32 y = 0; y < height; ++y) {
+        marginal[y] = d->conditional[y].integral;
+    }
+    distribution1d_create(&d->marginal, marginal, height);
+    memory_free(marginal);
+}
+
+void distribution2d_destroy(distribution2d* d) {
+    // the rows share the arrays of the first one
+    memory_free(d->conditional[0].func);
+    memory_free(d->conditional[0].cdf);
+    memory_free(d->conditional[0].alias);
+    memory_free(d->conditional);
+    distribution1d_destroy(&d->marginal);
+    memset(d, 0, sizeof(distribution2d));
+}
+
+void distribution2d_sample_alias(const distribution2d* d, f32 u0, f32 u1, f32* x, f32* y, f32* pdf) {
+    f32 pdf_y, pdf_x;
+    u32 row;
+    *y = distribution1d_sample_alias(&d->marginal, u0, &pdf_y, &row);
+    *x = distribution1d_sample_alias(&d->conditional[row], u1, &pdf_x, &row);
+    *pdf = pdf_x * pdf_y;
+}
+
+void distribution2d_sample_cdf(const distribution2d* d, f32 u0, f32 u1, f32* x, f32* y, f32* pdf) {
+    f32 pdf_y, pdf_x;
+    u32 row;
+    *y = distribution1d_sample_cdf(&d->marginal, u0, &pdf_y, &row);
+    *x = distribution1d_sample_cdf(&d->conditional[row], u1, &pdf_x, &row);
+    *pdf = pdf_x * pdf_y;
+}
+
+f32 distribution2d_pdf(const distribution2d* d, f32 x, f32 y) {
+    u32 ix = (u32)(x * (f32)d->width);
+    u32 iy = (u32)(y * (f32)d->height);
+    ix = ix < d->width ? ix : d->width - 1;
+    iy = iy < d->height ? iy : d->height - 1;
+    if (d->marginal.integral <= 0) {
+        return 1.0f;
+    }
+    return d->conditional[iy].func[ix] / d->marginal.integral;
+}
@@ -0,0 +1,78 @@
+#ifndef DISTRIBUTION__H
+#define DISTRIBUTION__H
+
+#include "defines.h"
+#include "zpool.h"
+
+/***
+ *    ██████  ██ ███████ ████████ ██████  ██ ██████  ██    ██ ████████ ██  ██████  ███    ██
+ *    ██   ██ ██ ██         ██    ██   ██ ██ ██   ██ ██    ██    ██    ██ ██    ██ ████   ██
+ *    ██   ██ ██ ███████    ██    ██████  ██ ██████  ██    ██    ██    ██ ██    ██ ██ ██  ██
+ *    ██   ██ ██      ██    ██    ██   ██ ██ ██   ██ ██    ██    ██    ██ ██    ██ ██  ██ ██
+ *    ██████  ██ ███████    ██    ██   ██ ██ ██████   ██████     ██    ██  ██████  ██   ████
+ *
+ *
+ */
+
+// piecewise constant distributions over [0, 1) and [0, 1)^2, for sampling in proportion to
+// a tabulated function such as the brightness of an environment map.
+// every distribution keeps two ways to sample it with the same density: inverting the cdf,
+// a binary search per sample, and walker's alias method (vose's O(n) construction), which
+// picks a bin with one table lookup and a comparison. both take one value per dimension
+// and keep the position inside the chosen bin stratified, the alias method with fewer
+// bits of it (24 minus log2 of the bin count)
+
+typedef struct distribution_alias {
+    // the bin keeps the value when the fraction left after choosing it is below q
+    f32 q;
+    u32 alias;
+} distribution_alias;
+
+typedef struct distribution1d {
+    // |f| per bin
+    f32* func;
+    // count + 1 entries from 0 to 1
+    f32* cdf;
+    distribution_alias* alias;
+    // the average of func, 0 when func is 0 everywhere and the bins are sampled uniformly
+    f32 integral;
+    u32 count;
+} distribution1d;
+
+// rows are conditional distributions in x and the marginal picks the row, y
+typedef struct distribution2d {
+    distribution1d* conditional;
+    distribution1d marginal;
+    u32 width;
+    u32 height;
+} distribution2d;
+
+// a copy of the count values of func
+void distribution1d_create(distribution1d* d, const f32* func, u32 count);
+
+void distribution1d_destroy(distribution1d* d);
+
+// a point in [0, 1) with density pdf, from bin offset. alias table
+f32 distribution1d_sample_alias(const distribution1d* d, f32 u, f32* pdf, u32* offset);
+
+// the same through the cdf
+f32 distribution1d_sample_cdf(const distribution1d* d, f32 u, f32* pdf, u32* offset);
+
+// the density at x in [0, 1)
+f32 distribution1d_pdf(const distribution1d* d, f32 x);
+
+// over width x height values of func, row after row. the rows are built on the pool, which
+// may be null
+void distribution2d_create(distribution2d* d, const f32* func, u32 width, u32 height, zpool* pool);
+
+void distribution2d_destroy(distribution2d* d);
+
+// a point (x, y) in [0, 1)^2 with density pdf, u0 picks the row and u1 the column
+void distribution2d_sample_alias(const distribution2d* d, f32 u0, f32 u1, f32* x, f32* y, f32* pdf);
+
+void distribution2d_sample_cdf(const distribution2d* d, f32 u0, f32 u1, f32* x, f32* y, f32* pdf);
+
+// the density at (x, y) in [0, 1)^2
+f32 distribution2d_pdf(const distribution2d* d, f32 x, f32 y);
+
+#endif
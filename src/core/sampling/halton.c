@@ -0,0 +1,104 @@
+#include "halton.h"
+#include "sobol.h"
+#include "logger.h"
+#include "memory.h"
+
+static const u16 primes[HALTON_MAX_DIMENSIONS] = {
+    2,   3,   5,   7,   11,  13,  17,  19,  23,  29,  31,  37,  41,  43,  47,  53,  59,  61,  67,  71,  73,  79,
+    83,  89,  97,  101, 103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193,
+    197, 199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311,
+};
+
+// the largest float below one
+#define ONE_MINUS_EPSILON 0x1.fffffep-1f
+
+static inline f32 clamp_unit(f64 value) {
+    return value < ONE_MINUS_EPSILON ? (f32)value : ONE_MINUS_EPSILON;
+}
+
+u32 halton_prime(u32 dimension) {
+    ASSERT(dimension < HALTON_MAX_DIMENSIONS);
+    return primes[dimension];
+}
+
+f32 halton_radical_inverse(u32 dimension, u64 index) {
+    ASSERT(dimension < HALTON_MAX_DIMENSIONS);
+    if (dimension == 0) {
+        u64 bits = index;
+        bits = (bits << 32) | (bits >> 32);
+        bits = ((bits & 0x0000ffff0000ffffull) << 16) | ((bits >> 16) & 0x0000ffff0000ffffull);
+        bits = ((bits & 0x00ff00ff00ff00ffull) << 8) | ((bits >> 8) & 0x00ff00ff00ff00ffull);
+        bits = ((bits & 0x0f0f0f0f0f0f0f0full) << 4) | ((bits >> 4) & 0x0f0f0f0f0f0f0f0full);
+        bits = ((bits & 0x3333333333333333ull) << 2) | ((bits >> 2) & 0x3333333333333333ull);
+        bits = ((bits & 0x5555555555555555ull) << 1) | ((bits >> 1) & 0x5555555555555555ull);
+        return clamp_unit((f64)bits * 0x1p-64);
+    }
+    u64 base = primes[dimension];
+    f64 inv_base = 1.0 / (f64)base;
+    f64 inv_base_n = 1;
+    u64 reversed = 0;
+    while (index) {
+        u64 next = index / base;
+        reversed = reversed * base + (index - next * base);
+        inv_base_n *= inv_base;
+        index = next;
+    }
+    return clamp_unit((f64)reversed * inv_base_n);
+}
+
+u64 halton_inverse_radical_inverse(u64 inverse, u32 base, u32 n_digits) {
+    u64 index = 0;
+    for (u32 i = 0; i < n_digits; ++i) {
+        u64 digit = inverse % base;
+        inverse /= base;
+        index = index * base + digit;
+    }
+    return index;
+}
+
+void halton_permutations_create(halton_permutations* p, u32 seed) {
+    u32 total = 0;
+    for (u32 d = 0; d < HALTON_MAX_DIMENSIONS; ++d) {
+        p->offsets[d] = total;
+        total += primes[d];
+    }
+    p->digits = (u16*)memory_allocate(sizeof(u16) * total);
+    // fisher-yates per dimension, drawing from a counter hashed with the seed
+    u32 counter = 0;
+    for (u32 d = 0; d < HALTON_MAX_DIMENSIONS; ++d) {
+        u16* perm = p->digits + p->offsets[d];
+        for (u32 i = 0; i < primes[d]; ++i) {
+            perm[i] = (u16)i;
+        }
+        for (u32 i = primes[d] - 1; i > 0; --i) {
+            u32 r = sobol_hash(sobol_hash_combine(seed, counter++));
+            u32 j = (u32)(((u64)r * (i + 1)) >> 32);
+            u16 t = perm[i];
+            perm[i] = perm[j];
+            perm[j] = t;
+        }
+    }
+}
+
+void halton_permutations_destroy(halton_permutations* p) {
+    memory_free(p->digits);
+    p->digits = 0;
+}
+
+f32 halton_scrambled_radical_inverse(const halton_permutations* p, u32 dimension, u64 index) {
+    ASSERT(dimension < HALTON_MAX_DIMENSIONS);
+    const u16* perm = p->digits + p->offsets[dimension];
+    u64 base = primes[dimension];
+    f64 inv_base = 1.0 / (f64)base;
+    f64 inv_base_n = 1;
+    u64 reversed = 0;
+    while (index) {
+        u64 next = index / base;
+        reversed = reversed * base + perm[index - next * base];
+        inv_base_n *= inv_base;
+        index = next;
+    }
+    // the digits past the last one are zeros, permuted to perm[0] each: a geometric series
+    // perm[0] / base + perm[0] / base^2 + ... below the last digit
+    return clamp_unit(inv_base_n * ((f64)reversed + inv_base * perm[0] / (1 - inv_base)));
+}
@@ -0,0 +1,51 @@
+#ifndef HALTON__H
+#define HALTON__H
+
+#include "defines.h"
+
+/***
+ *    ██   ██  █████  ██      ████████  ██████  ███    ██
+ *    ██   ██ ██   ██ ██         ██    ██    ██ ████   ██
+ *    ███████ ███████ ██         ██    ██    ██ ██ ██  ██
+ *    ██   ██ ██   ██ ██         ██    ██    ██ ██  ██ ██
+ *    ██   ██ ██   ██ ███████    ██     ██████  ██   ████
+ *
+ *
+ */
+
+// the halton sequence: dimension d is the radical inverse of the index in the d-th prime.
+// higher bases correlate badly between neighboring dimensions, so scrambled dimensions
+// permute the digits with a random permutation of their base (pbrt-v3). the permutations of
+// every dimension live in one table of u16 digits built once from a seed.
+// base 2 is a bit reversal, the other bases divide by a constant the compiler cannot see,
+// which is fine at a few dozen digits per sample
+
+#define HALTON_MAX_DIMENSIONS 64
+
+typedef struct halton_permutations {
+    // the permutation of dimension d starts at digits + offsets[d] and has halton_prime(d)
+    // entries
+    u16* digits;
+    u32 offsets[HALTON_MAX_DIMENSIONS];
+} halton_permutations;
+
+// the base of dimension, 2, 3, 5, ...
+u32 halton_prime(u32 dimension);
+
+// radical inverse of index in the base of dimension, in [0, 1)
+f32 halton_radical_inverse(u32 dimension, u64 index);
+
+// the n_digits lowest digits of inverse in base, mirrored: the index whose radical inverse
+// starts with them
+u64 halton_inverse_radical_inverse(u64 inverse, u32 base, u32 n_digits);
+
+// random digit permutations for every dimension, derived from seed
+void halton_permutations_create(halton_permutations* p, u32 seed);
+
+void halton_permutations_destroy(halton_permutations* p);
+
+// radical inverse of index with the digits of dimension permuted by p, including the
+// infinite tail of permuted zero digits, in [0, 1)
+f32 halton_scrambled_radical_inverse(const halton_permutations* p, u32 dimension, u64 index);
+
+#endif
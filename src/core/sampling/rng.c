@@ -0,0 +1,173 @@
+#include "rng.h"
+#include "simd.h"
+#include "logger.h"
+
+#define PCG_MULTIPLIER 6364136223846793005ull
+
+#define PHILOX_M0 0xd2511f53u
+#define PHILOX_M1 0xcd9e8d57u
+#define PHILOX_W0 0x9e3779b9u
+#define PHILOX_W1 0xbb67ae85u
+#define PHILOX_ROUNDS 10
+
+// ============================================================================
+// PCG
+// ============================================================================
+
+void rng_seed(rng* r, u64 seed, u64 stream) {
+    r->state = 0;
+    r->inc = (stream << 1) | 1;
+    rng_u32(r);
+    r->state += seed;
+    rng_u32(r);
+}
+
+void rng_seed_stream(rng* r, u64 seed, u64 index) {
+    rng_seed(r, seed, rng_mix64(index));
+}
+
+u32 rng_u32(rng* r) {
+    u64 old = r->state;
+    r->state = old * PCG_MULTIPLIER + r->inc;
+    u32 xorshifted = (u32)(((old >> 18) ^ old) >> 27);
+    u32 rot = (u32)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+}
+
+f32 rng_f32(rng* r) {
+    return (f32)(rng_u32(r) >> 8) * (1.0f / 16777216.0f);
+}
+
+f32 rng_range(rng* r, f32 low, f32 high) {
+    return low + (high - low) * rng_f32(r);
+}
+
+u32 rng_bounded(rng* r, u32 bound) {
+    ASSERT(bound);
+    u64 m = (u64)rng_u32(r) * bound;
+    u32 low = (u32)m;
+    if (low < bound) {
+        // the products landing in the first 2^32 % bound of a bucket are rejected
+        u32 threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            m = (u64)rng_u32(r) * bound;
+            low = (u32)m;
+        }
+    }
+    return (u32)(m >> 32);
+}
+
+void rng_advance(rng* r, u64 delta) {
+    // brown's lcg jump: square the step, accumulating the steps delta's bits ask for
+    u64 multiplier = PCG_MULTIPLIER, increment = r->inc;
+    u64 acc_multiplier = 1, acc_increment = 0;
+    while (delta) {
+        if (delta & 1) {
+            acc_multiplier *= multiplier;
+            acc_increment = acc_increment * multiplier + increment;
+        }
+        increment = (multiplier + 1) * increment;
+        multiplier *= multiplier;
+        delta >>= 1;
+    }
+    r->state = acc_multiplier * r->state + acc_increment;
+}
+
+// ============================================================================
+// PHILOX
+// ============================================================================
+
+void rng_philox(u64 seed, u64 stream, u64 block, u32* out) {
+    u32 c0 = (u32)block, c1 = (u32)(block >> 32), c2 = (u32)stream, c3 = (u32)(stream >> 32);
+    u32 k0 = (u32)seed, k1 = (u32)(seed >> 32);
+    for (u32 round = 0; round < PHILOX_ROUNDS; ++round) {
+        u64 p0 = (u64)PHILOX_M0 * c0;
+        u64 p1 = (u64)PHILOX_M1 * c2;
+        u32 n0 = (u32)(p1 >> 32) ^ c1 ^ k0;
+        u32 n2 = (u32)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (u32)p1;
+        c3 = (u32)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// SIMD_LANES consecutive blocks, words[w] holding word w of every block
+FORCE_INLINE void philox_lanes(u64 seed, u64 stream, u64 block, simdi* words) {
+    simdi c0 = simdi_ramp((u32)block);
+    simdi c1 = simdi_set1((u32)(block >> 32));
+    simdi c2 = simdi_set1((u32)stream);
+    simdi c3 = simdi_set1((u32)(stream >> 32));
+    u32 k0 = (u32)seed, k1 = (u32)(seed >> 32);
+    simdi m0 = simdi_set1(PHILOX_M0);
+    simdi m1 = simdi_set1(PHILOX_M1);
+    for (u32 round = 0; round < PHILOX_ROUNDS; ++round) {
+        simdi n0 = simdi_xor(simdi_xor(simdi_mul_high(m1, c2), c1), simdi_set1(k0));
+        simdi n2 = simdi_xor(simdi_xor(simdi_mul_high(m0, c0), c3), simdi_set1(k1));
+        c1 = simdi_mul(m1, c2);
+        c3 = simdi_mul(m0, c0);
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    words[0] = c0;
+    words[1] = c1;
+    words[2] = c2;
+    words[3] = c3;
+}
+
+void rng_philox_batch(u64 seed, u64 stream, u64 first, u32 count, u32* out) {
+    u32 block_values[4];
+    u32 i = 0;
+    // the partial block in front
+    for (; i < count && (first + i) % 4; ++i) {
+        if (i == 0) {
+            rng_philox(seed, stream, (first + i) / 4, block_values);
+        }
+        out[i] = block_values[(first + i) % 4];
+    }
+    // whole blocks, SIMD_LANES of them at once, transposed from words into value order.
+    // lanes take consecutive low counter words, so groups wrapping the low word go scalar
+    ALIGN(SIMD_ALIGNMENT) u32 words[4][SIMD_LANES];
+    while (count - i >= 4 * SIMD_LANES && (u32)((first + i) / 4) <= 0xffffffffu - SIMD_LANES) {
+        simdi lanes[4];
+        philox_lanes(seed, stream, (first + i) / 4, lanes);
+        for (u32 w = 0; w < 4; ++w) {
+            simdi_store(words[w], lanes[w]);
+        }
+        for (u32 lane = 0; lane < SIMD_LANES; ++lane) {
+            for (u32 w = 0; w < 4; ++w) {
+                out[i + lane * 4 + w] = words[w][lane];
+            }
+        }
+        i += 4 * SIMD_LANES;
+    }
+    for (; i < count; ++i) {
+        if ((first + i) % 4 == 0) {
+            rng_philox(seed, stream, (first + i) / 4, block_values);
+        }
+        out[i] = block_values[(first + i) % 4];
+    }
+}
+
+void rng_philox_unit_batch(u64 seed, u64 stream, u64 first, u32 count, f32* out) {
+    u32 bits[64];
+    for (u32 done = 0; done < count; done += 64) {
+        u32 n = count - done < 64 ? count - done : 64;
+        rng_philox_batch(seed, stream, first + done, n, bits);
+        u32 i = 0;
+        for (; i + SIMD_LANES <= n; i += SIMD_LANES) {
+            simdf_store_unaligned(out + done + i, simdi_to_unit(simdi_load_unaligned(bits + i)));
+        }
+        for (; i < n; ++i) {
+            out[done + i] = (f32)(bits[i] >> 8) * (1.0f / 16777216.0f);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef RNG__H
+#define RNG__H
+
+#include "defines.h"
+
+/***
+ *    ██████  ███    ██  ██████
+ *    ██   ██ ████   ██ ██
+ *    ██████  ██ ██  ██ ██   ███
+ *    ██   ██ ██  ██ ██ ██    ██
+ *    ██   ██ ██   ████  ██████
+ *
+ *
+ */
+
+// random numbers that are reproducible however work is split between threads.
+// rng is o'neill's pcg32: 64 bits of lcg state with a stream selecting the increment, so
+// every (seed, stream) pair is its own sequence of 2^64 values. give each pixel, path or
+// worker its own stream instead of sharing a generator, and use rng_advance to jump to any
+// point of a stream in log time, e.g. to the sample a resumed render continues at.
+// philox4x32-10 (salmon et al. 2011, random123) is counter based instead: the value at a
+// position of a stream is a pure function of (seed, stream, position) with no state at all,
+// which makes it the batch generator. rng_philox_batch fills arrays SIMD_LANES blocks of
+// four values at a time
+
+typedef struct rng {
+    u64 state;
+    // odd, selects the stream
+    u64 inc;
+} rng;
+
+// pcg32_srandom: any two different streams are different sequences
+void rng_seed(rng* r, u64 seed, u64 stream);
+
+// rng_seed with the index mixed first, for streams keyed by pixel, path or thread index
+// where neighboring indices should not give related increments
+void rng_seed_stream(rng* r, u64 seed, u64 index);
+
+u32 rng_u32(rng* r);
+
+// uniform in [0, 1), 24 bits
+f32 rng_f32(rng* r);
+
+// uniform in [low, high)
+f32 rng_range(rng* r, f32 low, f32 high);
+
+// uniform in [0, bound) without modulo bias (lemire), bound must not be 0
+u32 rng_bounded(rng* r, u32 bound);
+
+// moves delta values ahead, as if rng_u32 was called delta times. deltas wrap, 2^64 - n
+// steps back n values
+void rng_advance(rng* r, u64 delta);
+
+// the four values of block of stream, philox4x32-10 keyed by seed with the counter
+// (block, stream)
+void rng_philox(u64 seed, u64 stream, u64 block, u32* out);
+
+// out[i] = value first + i of stream, where value n is word n % 4 of block n / 4
+void rng_philox_batch(u64 seed, u64 stream, u64 first, u32 count, u32* out);
+
+// rng_philox_batch as floats uniform in [0, 1)
+void rng_philox_unit_batch(u64 seed, u64 stream, u64 first, u32 count, f32* out);
+
+// splitmix64's finalizer, a full avalanche 64 bit mix
+static inline u64 rng_mix64(u64 x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+#endif
@@ -0,0 +1,335 @@
+#include "sampler.h"
+#include <string.h>
+#include "sobol.h"
+#include "halton.h"
+#include "logger.h"
+#include "memory.h"
+
+// halton pixel offsets repeat every this many pixels (pbrt-v3's kMaxResolution)
+#define HALTON_MAX_RESOLUTION 128
+
+// values are generated this many at a time into stack buffers
+#define SAMPLER_CHUNK 64
+
+typedef struct sampler_data {
+    // the seed folded to 32 bits
+    u32 seed;
+    // halton
+    halton_permutations permutations;
+    u32 base_scales[2];
+    u32 base_exponents[2];
+    u64 sample_stride;
+    u64 mult_inverse[2];
+    // blue noise, the morton index has 2 * log2_resolution + log2_samples bits
+    u32 log2_samples;
+    u32 base4_digits;
+} sampler_data;
+
+static inline f32 to_unit(u32 bits) {
+    return (f32)(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline u32 log2_ceil(u32 v) {
+    u32 bits = 0;
+    while ((1ull << bits) < v) {
+        ++bits;
+    }
+    return bits;
+}
+
+// ============================================================================
+// INDEPENDENT
+// ============================================================================
+
+// stateless 32 bit mix (a pcg output permutation)
+static inline u32 independent_hash(u32 x) {
+    x = x * 747796405u + 2891336453u;
+    x = ((x >> ((x >> 28u) + 4u)) ^ x) * 277803737u;
+    return (x >> 22u) ^ x;
+}
+
+static inline f32 independent_get(const sampler* s, const sampler_data* data, u32 x, u32 y, u32 index, u32 dimension) {
+    u32 pixel = independent_hash(data->seed + independent_hash(y * s->width + x));
+    u32 h = independent_hash(pixel + index);
+    return to_unit(independent_hash(h ^ (dimension * 0x9e3779b9u)));
+}
+
+// ============================================================================
+// SOBOL
+// ============================================================================
+
+static inline u32 sobol_pixel_seed(const sampler* s, const sampler_data* data, u32 x, u32 y) {
+    return sobol_hash(sobol_hash_combine(data->seed, y * s->width + x));
+}
+
+// ============================================================================
+// HALTON
+// ============================================================================
+
+static void extended_gcd(i64 a, i64 b, i64* x, i64* y) {
+    if (b == 0) {
+        *x = 1;
+        *y = 0;
+        return;
+    }
+    i64 xp, yp;
+    extended_gcd(b, a % b, &xp, &yp);
+    *x = yp;
+    *y = xp - (a / b) * yp;
+}
+
+static u64 multiplicative_inverse(i64 a, i64 n) {
+    i64 x, y;
+    extended_gcd(a, n, &x, &y);
+    return (u64)(((x % n) + n) % n);
+}
+
+static void halton_setup(const sampler* s, sampler_data* data) {
+    halton_permutations_create(&data->permutations, data->seed);
+    // the first two dimensions scale to cover a block of up to 128 x 128 pixels, every
+    // pixel of the block gets every sample_stride-th point of the sequence
+    u32 resolution[2] = {s->width, s->height};
+    for (u32 i = 0; i < 2; ++i) {
+        u32 base = halton_prime(i);
+        u32 limit = resolution[i] < HALTON_MAX_RESOLUTION ? resolution[i] : HALTON_MAX_RESOLUTION;
+        u32 scale = 1, exponent = 0;
+        while (scale < limit) {
+            scale *= base;
+            ++exponent;
+        }
+        data->base_scales[i] = scale;
+        data->base_exponents[i] = exponent;
+    }
+    data->sample_stride = (u64)data->base_scales[0] * data->base_scales[1];
+    data->mult_inverse[0] = multiplicative_inverse(data->base_scales[1], data->base_scales[0]);
+    data->mult_inverse[1] = multiplicative_inverse(data->base_scales[0], data->base_scales[1]);
+}
+
+// the index into the halton sequence of sample index of pixel (x, y): the first index whose
+// first two dimensions land in the pixel, found with the chinese remainder theorem, plus
+// index strides
+static u64 halton_index(const sampler_data* data, u32 x, u32 y, u32 index) {
+    u64 offset = 0;
+    if (data->sample_stride > 1) {
+        u32 pixel[2] = {x % HALTON_MAX_RESOLUTION, y % HALTON_MAX_RESOLUTION};
+        for (u32 i = 0; i < 2; ++i) {
+            u64 dimension_offset = halton_inverse_radical_inverse(pixel[i], halton_prime(i), data->base_exponents[i]);
+            offset += dimension_offset * (data->sample_stride / data->base_scales[i]) * data->mult_inverse[i];
+        }
+        offset %= data->sample_stride;
+    }
+    return offset + (u64)index * data->sample_stride;
+}
+
+static f32 halton_get(const sampler_data* data, u32 x, u32 y, u32 index, u32 dimension) {
+    u64 i = halton_index(data, x, y, index);
+    if (dimension == 0) {
+        // the digits that pick the pixel are dropped, what is left is the position inside it
+        return halton_radical_inverse(0, i >> data->base_exponents[0]);
+    }
+    if (dimension == 1) {
+        return halton_radical_inverse(1, i / data->base_scales[1]);
+    }
+    if (dimension < HALTON_MAX_DIMENSIONS) {
+        return halton_scrambled_radical_inverse(&data->permutations, dimension, i);
+    }
+    // past the prime table dimensions fall back to hashed random numbers
+    u32 h = sobol_hash_combine(sobol_hash_combine(data->seed, (u32)i ^ (u32)(i >> 32)), dimension);
+    return to_unit(sobol_hash(h));
+}
+
+// ============================================================================
+// BLUE NOISE
+// ============================================================================
+
+// the 24 permutations of the 4 base 4 digits
+static const u8 digit_permutations[24][4] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 2, 1}, {0, 3, 1, 2},
+    {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 2, 0}, {1, 3, 0, 2},
+    {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 3, 0, 1}, {2, 3, 1, 0},
+    {3, 1, 2, 0}, {3, 1, 0, 2}, {3, 2, 1, 0}, {3, 2, 0, 1}, {3, 0, 2, 1}, {3, 0, 1, 2},
+};
+
+static inline u32 part_1_by_1(u32 v) {
+    v &= 0x0000ffffu;
+    v = (v | (v << 8)) & 0x00ff00ffu;
+    v = (v | (v << 4)) & 0x0f0f0f0fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    return (v | (v << 1)) & 0x55555555u;
+}
+
+static void blue_noise_setup(const sampler* s, sampler_data* data) {
+    u32 log2_resolution = log2_ceil(s->width > s->height ? s->width : s->height);
+    u32 log2_samples = log2_ceil(s->samples_per_pixel);
+    // the sobol index is 32 bits, on huge images samples move to later rounds earlier
+    if (2 * log2_resolution + log2_samples > 32) {
+        log2_samples = 32 - 2 * log2_resolution;
+    }
+    data->log2_samples = log2_samples;
+    data->base4_digits = log2_resolution + (log2_samples + 1) / 2;
+}
+
+// the key of dimension pair of round, every round of 2^log2_samples samples is a fresh set
+static inline u32 blue_noise_key(const sampler_data* data, u32 round, u32 pair) {
+    return sobol_hash(sobol_hash_combine(data->seed + round, pair));
+}
+
+static inline u32 blue_noise_value_seed(u32 key, u32 component) {
+    return sobol_hash(sobol_hash_combine(key, component + 1));
+}
+
+// the sobol index of sample index of pixel (x, y): its morton index with every base 4
+// digit permuted by a permutation chosen from the digits above it. pixels sharing the
+// higher digits share the permutation, so every aligned block of pixels still gets a
+// whole, stratified block of sobol points
+static u32 blue_noise_index(const sampler_data* data, u32 x, u32 y, u32 index, u32 key) {
+    u64 morton = ((u64)(part_1_by_1(x) | (part_1_by_1(y) << 1)) << data->log2_samples) |
+                 (index & ((1u << data->log2_samples) - 1));
+    // an odd number of sample bits leaves a single base 2 digit at the bottom
+    u32 odd = data->log2_samples & 1;
+    u64 sample_index = 0;
+    for (i32 i = (i32)data->base4_digits - 1; i >= (i32)odd; --i) {
+        u32 shift = 2 * (u32)i - odd;
+        u32 digit = (u32)(morton >> shift) & 3;
+        u64 higher = morton >> (shift + 2);
+        u32 p = (sobol_hash((u32)higher ^ (u32)(higher >> 32) ^ key) >> 24) % 24;
+        sample_index |= (u64)digit_permutations[p][digit] << shift;
+    }
+    if (odd) {
+        u64 higher = morton >> 1;
+        u32 flip = sobol_hash((u32)higher ^ (u32)(higher >> 32) ^ key) & 1;
+        sample_index |= ((u32)morton & 1) ^ flip;
+    }
+    return (u32)sample_index;
+}
+
+// ============================================================================
+// SAMPLER
+// ============================================================================
+
+void sampler_options_default(sampler_options* options, u32 width, u32 height) {
+    options->type = SAMPLER_SOBOL;
+    options->width = width;
+    options->height = height;
+    options->samples_per_pixel = 16;
+    options->seed = 0;
+}
+
+void sampler_create(sampler* s, const sampler_options* options) {
+    sampler_options defaults;
+    if (!options) {
+        sampler_options_default(&defaults, 1, 1);
+        options = &defaults;
+    }
+    ASSERT(options->width && options->height && options->samples_per_pixel);
+    s->type = options->type;
+    s->width = options->width;
+    s->height = options->height;
+    s->samples_per_pixel = options->samples_per_pixel;
+    s->seed = options->seed;
+
+    sampler_data* data = (sampler_data*)memory_allocate(sizeof(sampler_data));
+    memset(data, 0, sizeof(sampler_data));
+    data->seed = (u32)s->seed ^ (u32)(s->seed >> 32);
+    if (s->type == SAMPLER_HALTON) {
+        halton_setup(s, data);
+    } else if (s->type == SAMPLER_BLUE_NOISE) {
+        blue_noise_setup(s, data);
+    }
+    s->internal_data = data;
+}
+
+void sampler_destroy(sampler* s) {
+    sampler_data* data = (sampler_data*)s->internal_data;
+    if (s->type == SAMPLER_HALTON) {
+        halton_permutations_destroy(&data->permutations);
+    }
+    memory_free(data);
+    s->internal_data = 0;
+}
+
+f32 sampler_get(const sampler* s, u32 x, u32 y, u32 index, u32 dimension) {
+    const sampler_data* data = (const sampler_data*)s->internal_data;
+    switch (s->type) {
+        case SAMPLER_INDEPENDENT:
+            return independent_get(s, data, x, y, index, dimension);
+        case SAMPLER_SOBOL:
+            return sobol_padded(index, dimension, sobol_pixel_seed(s, data, x, y));
+        case SAMPLER_HALTON:
+            return halton_get(data, x, y, index, dimension);
+        case SAMPLER_BLUE_NOISE: {
+            u32 key = blue_noise_key(data, index >> data->log2_samples, dimension / 2);
+            u32 i = blue_noise_index(data, x, y, index, key);
+            return sobol_owen(i, dimension & 1, blue_noise_value_seed(key, dimension & 1));
+        }
+    }
+    return 0;
+}
+
+void sampler_generate(const sampler* s, u32 x, u32 y, u32 first, u32 count, u32 dimension, f32* out) {
+    const sampler_data* data = (const sampler_data*)s->internal_data;
+    if (s->type != SAMPLER_SOBOL && s->type != SAMPLER_BLUE_NOISE) {
+        for (u32 i = 0; i < count; ++i) {
+            out[i] = sampler_get(s, x, y, first + i, dimension);
+        }
+        return;
+    }
+    u32 indices[SAMPLER_CHUNK];
+    u32 seeds[SAMPLER_CHUNK];
+    u32 pixel_seed = sobol_pixel_seed(s, data, x, y);
+    for (u32 done = 0; done < count; done += SAMPLER_CHUNK) {
+        u32 n = count - done < SAMPLER_CHUNK ? count - done : SAMPLER_CHUNK;
+        if (s->type == SAMPLER_SOBOL) {
+            for (u32 i = 0; i < n; ++i) {
+                indices[i] = first + done + i;
+                seeds[i] = pixel_seed;
+            }
+            sobol_padded_batch(indices, seeds, n, dimension, out + done);
+        } else {
+            for (u32 i = 0; i < n; ++i) {
+                u32 index = first + done + i;
+                u32 key = blue_noise_key(data, index >> data->log2_samples, dimension / 2);
+                indices[i] = blue_noise_index(data, x, y, index, key);
+                seeds[i] = blue_noise_value_seed(key, dimension & 1);
+            }
+            sobol_owen_batch(indices, seeds, n, dimension & 1, out + done);
+        }
+    }
+}
+
+void sampler_generate_batch(const sampler* s,
+                            const u32* xs,
+                            const u32* ys,
+                            const u32* indices,
+                            u32 count,
+                            u32 dimension,
+                            f32* out) {
+    const sampler_data* data = (const sampler_data*)s->internal_data;
+    if (s->type != SAMPLER_SOBOL && s->type != SAMPLER_BLUE_NOISE) {
+        for (u32 i = 0; i < count; ++i) {
+            out[i] = sampler_get(s, xs[i], ys[i], indices[i], dimension);
+        }
+        return;
+    }
+    u32 chunk_indices[SAMPLER_CHUNK];
+    u32 seeds[SAMPLER_CHUNK];
+    for (u32 done = 0; done < count; done += SAMPLER_CHUNK) {
+        u32 n = count - done < SAMPLER_CHUNK ? count - done : SAMPLER_CHUNK;
+        for (u32 i = 0; i < n; ++i) {
+            u32 x = xs[done + i], y = ys[done + i], index = indices[done + i];
+            if (s->type == SAMPLER_SOBOL) {
+                chunk_indices[i] = index;
+                seeds[i] = sobol_pixel_seed(s, data, x, y);
+            } else {
+                u32 key = blue_noise_key(data, index >> data->log2_samples, dimension / 2);
+                chunk_indices[i] = blue_noise_index(data, x, y, index, key);
+                seeds[i] = blue_noise_value_seed(key, dimension & 1);
+            }
+        }
+        if (s->type == SAMPLER_SOBOL) {
+            sobol_padded_batch(chunk_indices, seeds, n, dimension, out + done);
+        } else {
+            sobol_owen_batch(chunk_indices, seeds, n, dimension & 1, out + done);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef SAMPLER__H
+#define SAMPLER__H
+
+#include "defines.h"
+
+/***
+ *    ███████  █████  ███    ███ ██████  ██      ███████ ██████
+ *    ██      ██   ██ ████  ████ ██   ██ ██      ██      ██   ██
+ *    ███████ ███████ ██ ████ ██ ██████  ██      █████   ██████
+ *         ██ ██   ██ ██  ██  ██ ██      ██      ██      ██   ██
+ *    ███████ ██   ██ ██      ██ ██      ███████ ███████ ██   ██
+ *
+ *
+ */
+
+// sample values for the renderer: every value is a pure function of the pixel, the sample
+// index, the dimension and the seed, so any sample can be generated by any thread in any
+// order and a resumed render picks up exactly where it stopped. dimensions 0 and 1 place
+// the sample inside its pixel, integrators take theirs from dimension 2 on.
+// the low discrepancy samplers cover every pixel's samples far more evenly than
+// independent random numbers, which converges faster for the same sample count.
+// sampler_generate produces the values of consecutive samples of a pixel at once, the
+// sobol and blue noise samplers run it SIMD_LANES samples at a time
+
+typedef enum sampler_type {
+    // hashed uniform random numbers, the jitter the renderer always used
+    SAMPLER_INDEPENDENT,
+    // padded owen scrambled sobol, seeded per pixel
+    SAMPLER_SOBOL,
+    // one halton sequence over the whole image, with pbrt-v3's pixel mapping
+    SAMPLER_HALTON,
+    // owen scrambled sobol indexed along a morton curve through the image with randomly
+    // permuted base 4 digits (ahmed and wonka 2020, pbrt-v4's zsobol), so the errors of
+    // neighboring pixels are decorrelated like blue noise
+    SAMPLER_BLUE_NOISE,
+} sampler_type;
+
+typedef struct sampler_options {
+    sampler_type type;
+    // image resolution
+    u32 width;
+    u32 height;
+    // samples each pixel will take, the blue noise sampler rounds it up to a power of two.
+    // samples past it are still valid, just not as well distributed
+    u32 samples_per_pixel;
+    u64 seed;
+} sampler_options;
+
+typedef struct sampler {
+    sampler_type type;
+    u32 width;
+    u32 height;
+    u32 samples_per_pixel;
+    u64 seed;
+    void* internal_data;
+} sampler;
+
+// a sobol sampler of 16 samples per pixel with seed 0
+void sampler_options_default(sampler_options* options, u32 width, u32 height);
+
+// options may be null for the defaults of a 1x1 image
+void sampler_create(sampler* s, const sampler_options* options);
+
+void sampler_destroy(sampler* s);
+
+// the value of dimension of sample index of pixel (x, y), in [0, 1)
+f32 sampler_get(const sampler* s, u32 x, u32 y, u32 index, u32 dimension);
+
+// out[i] = sampler_get(s, x, y, first + i, dimension) for i < count
+void sampler_generate(const sampler* s, u32 x, u32 y, u32 first, u32 count, u32 dimension, f32* out);
+
+// out[i] = sampler_get(s, xs[i], ys[i], indices[i], dimension) for i < count, the samples of
+// a ray packet
+void sampler_generate_batch(const sampler* s,
+                            const u32* xs,
+                            const u32* ys,
+                            const u32* indices,
+                            u32 count,
+                            u32 dimension,
+                            f32* out);
+
+#endif
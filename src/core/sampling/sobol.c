@@ -0,0 +1,147 @@
+#include "sobol.h"
+#include "simd.h"
+#include "logger.h"
+
+// column i is the contribution of index bit i, the first column the most significant bit of
+// the fraction. dimension 0 is van der corput, 1 to 3 come from the joe-kuo primitive
+// polynomials x + 1, x^2 + x + 1 and x^3 + x + 1 with direction numbers 1; 1 3; 1 3 1
+static const u32 sobol_matrices[SOBOL_COMPONENTS][32] = {
+    {0x80000000, 0x40000000, 0x20000000, 0x10000000, 0x08000000, 0x04000000, 0x02000000, 0x01000000,
+     0x00800000, 0x00400000, 0x00200000, 0x00100000, 0x00080000, 0x00040000, 0x00020000, 0x00010000,
+     0x00008000, 0x00004000, 0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100,
+     0x00000080, 0x00000040, 0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001},
+    {0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+     0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+     0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+     0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff},
+    {0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000,
+     0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+     0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500,
+     0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555},
+    {0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000,
+     0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+     0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00,
+     0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093},
+};
+
+static inline u32 reverse_bits(u32 x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x >> 8) & 0x00ff00ffu);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x >> 4) & 0x0f0f0f0fu);
+    x = ((x & 0x33333333u) << 2) | ((x >> 2) & 0x33333333u);
+    return ((x & 0x55555555u) << 1) | ((x >> 1) & 0x55555555u);
+}
+
+static inline f32 to_unit(u32 bits) {
+    return (f32)(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+// the seeds of a padded dimension: the index shuffle of its group and its value scramble
+static inline u32 group_seed(u32 seed, u32 dimension) {
+    return sobol_hash(sobol_hash_combine(seed, dimension / SOBOL_COMPONENTS));
+}
+
+static inline u32 value_seed(u32 group, u32 dimension) {
+    return sobol_hash(sobol_hash_combine(group, dimension % SOBOL_COMPONENTS + 1));
+}
+
+// ============================================================================
+// SCALAR
+// ============================================================================
+
+u32 sobol_bits(u32 index, u32 component) {
+    ASSERT(component < SOBOL_COMPONENTS);
+    const u32* matrix = sobol_matrices[component];
+    u32 bits = 0;
+    for (u32 i = 0; index; index >>= 1, ++i) {
+        if (index & 1) {
+            bits ^= matrix[i];
+        }
+    }
+    return bits;
+}
+
+u32 sobol_owen_scramble(u32 bits, u32 seed) {
+    // laine-karras with burley's constants, every output bit only depends on the input bits
+    // below it. on reversed bits that is every bit depending on the ones above it
+    u32 x = reverse_bits(bits);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits(x);
+}
+
+f32 sobol_owen(u32 index, u32 component, u32 seed) {
+    return to_unit(sobol_owen_scramble(sobol_bits(index, component), seed));
+}
+
+f32 sobol_padded(u32 index, u32 dimension, u32 seed) {
+    u32 group = group_seed(seed, dimension);
+    u32 shuffled = sobol_owen_scramble(index, group);
+    return sobol_owen(shuffled, dimension % SOBOL_COMPONENTS, value_seed(group, dimension));
+}
+
+// ============================================================================
+// BATCH
+// ============================================================================
+
+FORCE_INLINE simdi simd_bits(simdi index, u32 component) {
+    const u32* matrix = sobol_matrices[component];
+    simdi bits = simdi_set1(0);
+    for (u32 i = 0; i < 32; ++i) {
+        bits = simdi_xor(bits, simdi_and(simdi_bit_mask(index, i), simdi_set1(matrix[i])));
+    }
+    return bits;
+}
+
+FORCE_INLINE simdi simd_owen_scramble(simdi bits, simdi seed) {
+    simdi x = simdi_add(simdi_reverse_bits(bits), seed);
+    x = simdi_xor(x, simdi_mul(x, simdi_set1(0x6c50b47cu)));
+    x = simdi_xor(x, simdi_mul(x, simdi_set1(0xb82f1e52u)));
+    x = simdi_xor(x, simdi_mul(x, simdi_set1(0xc7afe638u)));
+    x = simdi_xor(x, simdi_mul(x, simdi_set1(0x8d22f6e6u)));
+    return simdi_reverse_bits(x);
+}
+
+FORCE_INLINE simdi simd_hash(simdi x) {
+    x = simdi_xor(x, simdi_shift_right(x, 16));
+    x = simdi_mul(x, simdi_set1(0x7feb352du));
+    x = simdi_xor(x, simdi_shift_right(x, 15));
+    x = simdi_mul(x, simdi_set1(0x846ca68bu));
+    return simdi_xor(x, simdi_shift_right(x, 16));
+}
+
+FORCE_INLINE simdi simd_hash_combine(simdi seed, u32 v) {
+    simdi mixed = simdi_add(simdi_add(simdi_set1(v), simdi_shift_left(seed, 6)), simdi_shift_right(seed, 2));
+    return simdi_xor(seed, mixed);
+}
+
+void sobol_owen_batch(const u32* indices, const u32* seeds, u32 count, u32 component, f32* out) {
+    ASSERT(component < SOBOL_COMPONENTS);
+    u32 i = 0;
+    for (; i + SIMD_LANES <= count; i += SIMD_LANES) {
+        simdi bits = simd_bits(simdi_load_unaligned(indices + i), component);
+        bits = simd_owen_scramble(bits, simdi_load_unaligned(seeds + i));
+        simdf_store_unaligned(out + i, simdi_to_unit(bits));
+    }
+    for (; i < count; ++i) {
+        out[i] = sobol_owen(indices[i], component, seeds[i]);
+    }
+}
+
+void sobol_padded_batch(const u32* indices, const u32* seeds, u32 count, u32 dimension, f32* out) {
+    u32 component = dimension % SOBOL_COMPONENTS;
+    u32 i = 0;
+    for (; i + SIMD_LANES <= count; i += SIMD_LANES) {
+        simdi group = simd_hash(simd_hash_combine(simdi_load_unaligned(seeds + i), dimension / SOBOL_COMPONENTS));
+        simdi shuffled = simd_owen_scramble(simdi_load_unaligned(indices + i), group);
+        simdi bits = simd_bits(shuffled, component);
+        bits = simd_owen_scramble(bits, simd_hash(simd_hash_combine(group, component + 1)));
+        simdf_store_unaligned(out + i, simdi_to_unit(bits));
+    }
+    for (; i < count; ++i) {
+        out[i] = sobol_padded(indices[i], dimension, seeds[i]);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef SOBOL__H
+#define SOBOL__H
+
+#include "defines.h"
+
+/***
+ *    ███████  ██████  ██████   ██████  ██
+ *    ██      ██    ██ ██   ██ ██    ██ ██
+ *    ███████ ██    ██ ██████  ██    ██ ██
+ *         ██ ██    ██ ██   ██ ██    ██ ██
+ *    ███████  ██████  ██████   ██████  ███████
+ *
+ *
+ */
+
+// owen scrambled sobol points after burley, "practical hash-based owen scrambling" (jcgt
+// 2020). the first four sobol dimensions come from precomputed 32x32 bit generator matrices
+// (joe-kuo direction numbers), higher dimensions are padded: every group of four takes the
+// same four dimensions with its index shuffled by an owen scramble of its own, which keeps
+// every 4d group a scrambled (0,m,4) net without tables for hundreds of dimensions.
+// the scramble is the laine-karras hash on reversed bits, a nested uniform permutation that
+// keeps the stratification of every power of two block of points.
+// the batch versions do the matrix products and hashes SIMD_LANES points at a time
+
+#define SOBOL_COMPONENTS 4
+
+// the index-th point of sobol dimension component, unscrambled, as a 32 bit fraction
+u32 sobol_bits(u32 index, u32 component);
+
+// nested uniform scramble of the 32 bit fraction bits under seed
+u32 sobol_owen_scramble(u32 bits, u32 seed);
+
+// sobol_bits scrambled with seed, as a float in [0, 1)
+f32 sobol_owen(u32 index, u32 component, u32 seed);
+
+// any dimension of the padded sequence: dimension / 4 picks the group, whose index shuffle
+// and value scrambles are all derived from seed
+f32 sobol_padded(u32 index, u32 dimension, u32 seed);
+
+// out[i] = sobol_owen(indices[i], component, seeds[i])
+void sobol_owen_batch(const u32* indices, const u32* seeds, u32 count, u32 component, f32* out);
+
+// out[i] = sobol_padded(indices[i], dimension, seeds[i])
+void sobol_padded_batch(const u32* indices, const u32* seeds, u32 count, u32 dimension, f32* out);
+
+// lowbias32 (wellons), a cheap full avalanche 32 bit mix for deriving seeds
+static inline u32 sobol_hash(u32 x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// burley's boost style combine, seeds of dependent streams
+static inline u32 sobol_hash_combine(u32 seed, u32 v) {
+    return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+#endif
@@ -0,0 +1,972 @@
+#include "scene.h"
+#include <string.h>
+#include "scene_tokenizer.h"
+#include "platform.h"
+#include "logger.h"
+#include "arena.h"
+#include "memory.h"
+
+#define SCENE_ARENA_BLOCK (1u << 20)
+// lists up to this long convert while the structure is parsed, longer ones are split into
+// runs and converted afterwards across the pool
+#define INLINE_NUMBERS 256
+// how much of an offending token error messages quote
+#define ERROR_QUOTE 40
+
+// ============================================================================
+// DIRECTIVES
+// ============================================================================
+
+enum {
+    // the argument is a bare word rather than a string (ActiveTransform All)
+    DIRECTIVE_WORD = 1,
+    // a second string may follow the first (MediumInterface "inside" "outside")
+    DIRECTIVE_OPTIONAL_STRING = 2,
+    DIRECTIVE_INCLUDE = 4,
+};
+
+typedef struct directive_info {
+    const char* name;
+    u32 type;
+    u8 strings;
+    u8 numbers;
+    u8 params;
+    u8 flags;
+} directive_info;
+
+// sorted by name for the binary search
+static const directive_info directive_table[] = {
+    {"Accelerator", SCENE_ACCELERATOR, 1, 0, 1, 0},
+    {"ActiveTransform", SCENE_ACTIVE_TRANSFORM, 1, 0, 0, DIRECTIVE_WORD},
+    {"AreaLightSource", SCENE_AREA_LIGHT_SOURCE, 1, 0, 1, 0},
+    {"Attribute", SCENE_ATTRIBUTE, 1, 0, 1, 0},
+    {"AttributeBegin", SCENE_ATTRIBUTE_BEGIN, 0, 0, 0, 0},
+    {"AttributeEnd", SCENE_ATTRIBUTE_END, 0, 0, 0, 0},
+    {"Camera", SCENE_CAMERA, 1, 0, 1, 0},
+    {"ColorSpace", SCENE_COLOR_SPACE, 1, 0, 0, 0},
+    {"ConcatTransform", SCENE_CONCAT_TRANSFORM, 0, 16, 0, 0},
+    {"CoordSysTransform", SCENE_COORD_SYS_TRANSFORM, 1, 0, 0, 0},
+    {"CoordinateSystem", SCENE_COORDINATE_SYSTEM, 1, 0, 0, 0},
+    {"Film", SCENE_FILM, 1, 0, 1, 0},
+    {"Identity", SCENE_IDENTITY, 0, 0, 0, 0},
+    {"Import", SCENE_DIRECTIVE_COUNT, 1, 0, 0, DIRECTIVE_INCLUDE},
+    {"Include", SCENE_DIRECTIVE_COUNT, 1, 0, 0, DIRECTIVE_INCLUDE},
+    {"Integrator", SCENE_INTEGRATOR, 1, 0, 1, 0},
+    {"LightSource", SCENE_LIGHT_SOURCE, 1, 0, 1, 0},
+    {"LookAt", SCENE_LOOK_AT, 0, 9, 0, 0},
+    {"MakeNamedMaterial", SCENE_MAKE_NAMED_MATERIAL, 1, 0, 1, 0},
+    {"MakeNamedMedium", SCENE_MAKE_NAMED_MEDIUM, 1, 0, 1, 0},
+    {"Material", SCENE_MATERIAL, 1, 0, 1, 0},
+    {"MediumInterface", SCENE_MEDIUM_INTERFACE, 1, 0, 0, DIRECTIVE_OPTIONAL_STRING},
+    {"NamedMaterial", SCENE_NAMED_MATERIAL, 1, 0, 0, 0},
+    {"ObjectBegin", SCENE_OBJECT_BEGIN, 1, 0, 0, 0},
+    {"ObjectEnd", SCENE_OBJECT_END, 0, 0, 0, 0},
+    {"ObjectInstance", SCENE_OBJECT_INSTANCE, 1, 0, 0, 0},
+    {"Option", SCENE_OPTION, 0, 0, 1, 0},
+    {"PixelFilter", SCENE_PIXEL_FILTER, 1, 0, 1, 0},
+    {"ReverseOrientation", SCENE_REVERSE_ORIENTATION, 0, 0, 0, 0},
+    {"Rotate", SCENE_ROTATE, 0, 4, 0, 0},
+    {"Sampler", SCENE_SAMPLER, 1, 0, 1, 0},
+    {"Scale", SCENE_SCALE, 0, 3, 0, 0},
+    {"Shape", SCENE_SHAPE, 1, 0, 1, 0},
+    {"Texture", SCENE_TEXTURE, 3, 0, 1, 0},
+    {"Transform", SCENE_TRANSFORM, 0, 16, 0, 0},
+    {"TransformBegin", SCENE_TRANSFORM_BEGIN, 0, 0, 0, 0},
+    {"TransformEnd", SCENE_TRANSFORM_END, 0, 0, 0, 0},
+    {"TransformTimes", SCENE_TRANSFORM_TIMES, 0, 2, 0, 0},
+    {"Translate", SCENE_TRANSLATE, 0, 3, 0, 0},
+    {"WorldBegin", SCENE_WORLD_BEGIN, 0, 0, 0, 0},
+};
+
+#define DIRECTIVE_TABLE_SIZE (sizeof(directive_table) / sizeof(directive_table[0]))
+
+typedef struct param_type_info {
+    const char* name;
+    scene_param_type type;
+    // values per element, lists must be a multiple of it
+    u32 components;
+} param_type_info;
+
+static const param_type_info param_type_table[] = {
+    {"integer", SCENE_PARAM_INTEGER, 1},  {"float", SCENE_PARAM_FLOAT, 1},       {"point2", SCENE_PARAM_POINT2, 2},
+    {"vector2", SCENE_PARAM_VECTOR2, 2},  {"point3", SCENE_PARAM_POINT3, 3},     {"point", SCENE_PARAM_POINT3, 3},
+    {"vector3", SCENE_PARAM_VECTOR3, 3},  {"vector", SCENE_PARAM_VECTOR3, 3},    {"normal3", SCENE_PARAM_NORMAL3, 3},
+    {"normal", SCENE_PARAM_NORMAL3, 3},   {"rgb", SCENE_PARAM_RGB, 3},           {"color", SCENE_PARAM_RGB, 3},
+    {"spectrum", SCENE_PARAM_SPECTRUM, 2}, {"blackbody", SCENE_PARAM_BLACKBODY, 1}, {"bool", SCENE_PARAM_BOOL, 1},
+    {"string", SCENE_PARAM_STRING, 1},    {"texture", SCENE_PARAM_TEXTURE, 1},
+};
+
+#define PARAM_TYPE_TABLE_SIZE (sizeof(param_type_table) / sizeof(param_type_table[0]))
+
+// strcmp between a nul terminated name and a token
+static i32 compare_word(const char* name, const char* text, u32 length) {
+    i32 order = strncmp(name, text, length);
+    return order ? order : (name[length] != 0);
+}
+
+static const directive_info* find_directive(const char* text, u32 length) {
+    u32 lo = 0, hi = DIRECTIVE_TABLE_SIZE;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        i32 order = compare_word(directive_table[mid].name, text, length);
+        if (order == 0) {
+            return &directive_table[mid];
+        }
+        if (order < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0;
+}
+
+static const param_type_info* find_param_type(const char* text, u32 length) {
+    for (u32 i = 0; i < PARAM_TYPE_TABLE_SIZE; ++i) {
+        if (compare_word(param_type_table[i].name, text, length) == 0) {
+            return &param_type_table[i];
+        }
+    }
+    return 0;
+}
+
+const char* scene_directive_name(scene_directive_type type) {
+    for (u32 i = 0; i < DIRECTIVE_TABLE_SIZE; ++i) {
+        if (directive_table[i].type == (u32)type) {
+            return directive_table[i].name;
+        }
+    }
+    return "unknown";
+}
+
+const scene_param* scene_directive_param(const scene_directive* d, const char* name) {
+    for (u32 i = 0; i < d->param_count; ++i) {
+        if (strcmp(d->params[i].name, name) == 0) {
+            return &d->params[i];
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// STATE
+// ============================================================================
+
+typedef struct pending_include {
+    // resolved against the main file directory
+    const char* path;
+    // index of the directive the file's contents go in front of
+    u32 position;
+    u32 line;
+    // index of the file record, assigned once the batch is done
+    u32 file;
+} pending_include;
+
+// a run of numbers converted after parsing, straight into its slice of the parameter array
+typedef struct number_job {
+    const char* text;
+    u64 length;
+    void* out;
+    u32 count;
+    u32 integer;
+    u32 file;
+    u32 line;
+    const char* error_at;
+} number_job;
+
+typedef struct parse_file {
+    const char* path;
+    const char* text;
+    u64 size;
+    platform_file_mapping mapping;
+    u32 depth;
+    // index of the including file, the main file is its own parent
+    u32 parent;
+    u32 first_chunk;
+    u32 chunk_count;
+    scene_directive* directives;
+    u32 directive_count;
+    u32 directive_capacity;
+    pending_include* includes;
+    u32 include_count;
+    u32 include_capacity;
+    number_job* jobs;
+    u32 job_count;
+    u32 job_capacity;
+    // parameters of the directive being parsed, copied to the arena once it is complete
+    scene_param* params;
+    u32 param_capacity;
+    bool failed;
+    u32 error_line;
+    char error[192];
+} parse_file;
+
+typedef struct parse_chunk {
+    u32 file;
+    u64 begin;
+    u64 end;
+    // 0 based line the chunk starts on
+    u32 first_line;
+    scene_token_list tokens;
+} parse_chunk;
+
+typedef struct scene_state {
+    // one per pool thread, tasks allocate from the arena of their thread_index
+    arena* arenas;
+    u32 arena_count;
+} scene_state;
+
+typedef struct parse_context {
+    scene_parse_options options;
+    zpool* pool;
+    scene_state* state;
+    // include paths are relative to this directory
+    const char* base_dir;
+    u32 base_length;
+    parse_file* files;
+    u32 file_count;
+    u32 file_capacity;
+    parse_chunk* chunks;
+    u32 chunk_count;
+    u32 chunk_capacity;
+    // the files and chunks of the include level being processed
+    u32 batch_begin;
+    u32 chunk_begin;
+    number_job* jobs;
+} parse_context;
+
+// doubles the capacity of a growable array once count reaches it
+static void* grow(void* array, u32* capacity, u32 count, u64 element_size) {
+    if (count < *capacity) {
+        return array;
+    }
+    u32 next = *capacity ? *capacity * 2 : 16;
+    *capacity = next;
+    return array ? memory_reallocate(array, element_size * next) : memory_allocate(element_size * next);
+}
+
+static u32 count_newlines(const char* from, const char* to) {
+    u32 lines = 0;
+    for (; from < to; ++from) {
+        lines += *from == '\n';
+    }
+    return lines;
+}
+
+// records the first error of the file, always returns FALSE
+static bool fail(parse_file* f, u32 line, const char* message, const char* quote, u32 quote_length) {
+    if (!f->failed) {
+        f->failed = TRUE;
+        f->error_line = line;
+        quote_length = quote_length < ERROR_QUOTE ? quote_length : ERROR_QUOTE;
+        if (quote) {
+            log_buffer(f->error, sizeof(f->error), "%s '%.*s'", message, (i32)quote_length, quote);
+        } else {
+            log_buffer(f->error, sizeof(f->error), "%s", message);
+        }
+    }
+    return FALSE;
+}
+
+// copies a string token into the arena, resolving escapes
+static const char* copy_string(arena* a, const scene_token* t) {
+    char* out = (char*)arena_allocate(a, t->length + 1, 1);
+    u32 n = 0;
+    for (u32 i = 0; i < t->length; ++i) {
+        char c = t->text[i];
+        if (c == '\\' && i + 1 < t->length) {
+            c = t->text[++i];
+            switch (c) {
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            }
+        }
+        out[n++] = c;
+    }
+    out[n] = 0;
+    return out;
+}
+
+static const char* copy_text(arena* a, const char* text, u64 length) {
+    char* out = (char*)arena_allocate(a, length + 1, 1);
+    memcpy(out, text, length);
+    out[length] = 0;
+    return out;
+}
+
+static bool is_absolute_path(const char* path) {
+    return path[0] == '/' || path[0] == '\\' || (path[0] && path[1] == ':');
+}
+
+// ============================================================================
+// TOKEN CURSOR
+// ============================================================================
+
+// walks the tokens of a file across its chunks
+typedef struct token_cursor {
+    parse_context* ctx;
+    parse_file* file;
+    u32 chunk;
+    u32 index;
+} token_cursor;
+
+static const scene_token* cursor_peek(token_cursor* c) {
+    u32 last = c->file->first_chunk + c->file->chunk_count;
+    while (c->chunk < last) {
+        const scene_token_list* list = &c->ctx->chunks[c->chunk].tokens;
+        if (c->index < list->count) {
+            return &list->tokens[c->index];
+        }
+        ++c->chunk;
+        c->index = 0;
+    }
+    return 0;
+}
+
+static const scene_token* cursor_next(token_cursor* c) {
+    const scene_token* t = cursor_peek(c);
+    c->index += t != 0;
+    return t;
+}
+
+// 1 based line of a token the cursor just returned
+static inline u32 cursor_line(const token_cursor* c, const scene_token* t) {
+    return c->ctx->chunks[c->chunk].first_line + t->line + 1;
+}
+
+static inline bool peek_is(token_cursor* c, scene_token_kind kind) {
+    const scene_token* t = cursor_peek(c);
+    return t && t->kind == (u32)kind;
+}
+
+// ============================================================================
+// STRUCTURE
+// ============================================================================
+
+static bool bad_number(parse_file* f, const token_cursor* c, const scene_token* t, const char* at) {
+    u32 length = 0;
+    while (at + length < t->text + t->length && at[length] != ' ' && at[length] != '\n' && at[length] != '\t') {
+        ++length;
+    }
+    return fail(f, cursor_line(c, t) + count_newlines(t->text, at), "malformed number", at, length);
+}
+
+static bool parse_directive_numbers(token_cursor* c, parse_file* f, scene_directive* d, const directive_info* info, u32 line) {
+    bool bracket = peek_is(c, SCENE_TOKEN_OPEN);
+    if (bracket) {
+        cursor_next(c);
+    }
+    while (d->number_count < info->numbers) {
+        const scene_token* t = cursor_next(c);
+        if (!t || t->kind != SCENE_TOKEN_NUMBERS || t->count > info->numbers - d->number_count) {
+            return fail(f, line, "wrong number of arguments for", info->name, (u32)strlen(info->name));
+        }
+        const char* bad = scene_parse_floats(t->text, t->length, t->count, d->numbers + d->number_count);
+        if (bad) {
+            return bad_number(f, c, t, bad);
+        }
+        d->number_count += t->count;
+    }
+    if (bracket) {
+        const scene_token* t = cursor_next(c);
+        if (!t || t->kind != SCENE_TOKEN_CLOSE) {
+            return fail(f, line, "expected ] after the arguments of", info->name, (u32)strlen(info->name));
+        }
+    }
+    return TRUE;
+}
+
+static bool parse_bool(const scene_token* t, bool* out) {
+    if (compare_word("true", t->text, t->length) == 0) {
+        *out = TRUE;
+        return TRUE;
+    }
+    if (compare_word("false", t->text, t->length) == 0) {
+        *out = FALSE;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// the value of a parameter: one token, or a [ ] list of numbers, strings or bools
+static bool parse_values(parse_context* ctx, token_cursor* c, parse_file* f, arena* a, scene_param* p, u32 components, u32 line) {
+    bool bracket = peek_is(c, SCENE_TOKEN_OPEN);
+    if (bracket) {
+        cursor_next(c);
+    }
+    // count first so the arrays are allocated at their final size
+    token_cursor start = *c;
+    u32 token_count = 0;
+    u32 numbers = 0, strings = 0, words = 0;
+    for (;;) {
+        const scene_token* t = cursor_next(c);
+        if (!t) {
+            return fail(f, line, bracket ? "unterminated [ in parameter" : "missing value of parameter", p->name, (u32)strlen(p->name));
+        }
+        if (t->kind == SCENE_TOKEN_CLOSE && bracket) {
+            break;
+        }
+        if (t->kind == SCENE_TOKEN_OPEN || t->kind == SCENE_TOKEN_CLOSE) {
+            return fail(f, cursor_line(c, t), "unexpected bracket in parameter", p->name, (u32)strlen(p->name));
+        }
+        ++token_count;
+        numbers += t->kind == SCENE_TOKEN_NUMBERS ? t->count : 0;
+        strings += t->kind == SCENE_TOKEN_STRING;
+        words += t->kind == SCENE_TOKEN_WORD;
+        if (!bracket) {
+            if (numbers > 1) {
+                return fail(f, line, "a list of values needs [ ] in parameter", p->name, (u32)strlen(p->name));
+            }
+            break;
+        }
+    }
+
+    bool string_values = p->type == SCENE_PARAM_STRING || p->type == SCENE_PARAM_TEXTURE ||
+                         (p->type == SCENE_PARAM_SPECTRUM && strings);
+    bool valid;
+    if (p->type == SCENE_PARAM_BOOL) {
+        p->kind = SCENE_VALUES_BOOL;
+        valid = numbers == 0;
+    } else if (string_values) {
+        p->kind = SCENE_VALUES_STRING;
+        valid = numbers == 0 && words == 0;
+    } else {
+        p->kind = p->type == SCENE_PARAM_INTEGER ? SCENE_VALUES_INT : SCENE_VALUES_FLOAT;
+        valid = strings == 0 && words == 0;
+    }
+    if (!valid) {
+        return fail(f, line, "wrong kind of value for parameter", p->name, (u32)strlen(p->name));
+    }
+    p->count = numbers + strings + words;
+    if (p->kind == SCENE_VALUES_FLOAT || p->kind == SCENE_VALUES_INT) {
+        if (p->count % components) {
+            return fail(f, line, "value count is not a multiple of the type size in parameter", p->name, (u32)strlen(p->name));
+        }
+    }
+    p->floats = 0;
+    if (p->count == 0) {
+        return TRUE;
+    }
+
+    // second pass over the same tokens fills the values
+    *c = start;
+    if (p->kind == SCENE_VALUES_STRING) {
+        const char** values = ARENA_ALLOCATE_ARRAY(a, const char*, p->count);
+        for (u32 i = 0; i < token_count; ++i) {
+            values[i] = copy_string(a, cursor_next(c));
+        }
+        p->strings = values;
+    } else if (p->kind == SCENE_VALUES_BOOL) {
+        bool* values = ARENA_ALLOCATE_ARRAY(a, bool, p->count);
+        for (u32 i = 0; i < token_count; ++i) {
+            const scene_token* t = cursor_next(c);
+            if (!parse_bool(t, &values[i])) {
+                return fail(f, cursor_line(c, t), "expected true or false, found", t->text, t->length);
+            }
+        }
+        p->bools = values;
+    } else {
+        bool integer = p->kind == SCENE_VALUES_INT;
+        u8* values = (u8*)arena_allocate(a, 4 * (u64)p->count, 4);
+        u64 offset = 0;
+        for (u32 i = 0; i < token_count; ++i) {
+            const scene_token* t = cursor_next(c);
+            void* out = values + offset;
+            offset += 4 * (u64)t->count;
+            if (p->count > INLINE_NUMBERS) {
+                f->jobs = (number_job*)grow(f->jobs, &f->job_capacity, f->job_count, sizeof(number_job));
+                number_job* job = &f->jobs[f->job_count++];
+                job->text = t->text;
+                job->length = t->length;
+                job->out = out;
+                job->count = t->count;
+                job->integer = integer;
+                job->file = (u32)(f - ctx->files);
+                job->line = cursor_line(c, t);
+                job->error_at = 0;
+                continue;
+            }
+            const char* bad = integer ? scene_parse_integers(t->text, t->length, t->count, (i32*)out)
+                                      : scene_parse_floats(t->text, t->length, t->count, (f32*)out);
+            if (bad) {
+                return bad_number(f, c, t, bad);
+            }
+        }
+        p->floats = (const f32*)values;
+    }
+    if (bracket) {
+        cursor_next(c);
+    }
+    return TRUE;
+}
+
+static bool parse_params(parse_context* ctx, token_cursor* c, parse_file* f, arena* a, scene_directive* d) {
+    u32 count = 0;
+    while (peek_is(c, SCENE_TOKEN_STRING)) {
+        const scene_token* t = cursor_next(c);
+        u32 line = cursor_line(c, t);
+        // "type name", exactly two words
+        u32 i = 0;
+        while (i < t->length && t->text[i] == ' ') {
+            ++i;
+        }
+        u32 type_begin = i;
+        while (i < t->length && t->text[i] != ' ') {
+            ++i;
+        }
+        u32 type_end = i;
+        while (i < t->length && t->text[i] == ' ') {
+            ++i;
+        }
+        u32 name_begin = i;
+        while (i < t->length && t->text[i] != ' ') {
+            ++i;
+        }
+        u32 name_end = i;
+        while (i < t->length && t->text[i] == ' ') {
+            ++i;
+        }
+        if (name_begin == name_end || i != t->length) {
+            return fail(f, line, "expected \"type name\", found", t->text, t->length);
+        }
+        const param_type_info* type = find_param_type(t->text + type_begin, type_end - type_begin);
+        if (!type) {
+            return fail(f, line, "unknown parameter type", t->text + type_begin, type_end - type_begin);
+        }
+        f->params = (scene_param*)grow(f->params, &f->param_capacity, count, sizeof(scene_param));
+        scene_param* p = &f->params[count++];
+        p->type = type->type;
+        p->name = copy_text(a, t->text + name_begin, name_end - name_begin);
+        if (!parse_values(ctx, c, f, a, p, type->components, line)) {
+            return FALSE;
+        }
+    }
+    d->param_count = count;
+    if (count) {
+        scene_param* params = ARENA_ALLOCATE_ARRAY(a, scene_param, count);
+        memcpy(params, f->params, sizeof(scene_param) * count);
+        d->params = params;
+    }
+    return TRUE;
+}
+
+static const char* resolve_include(parse_context* ctx, arena* a, const scene_token* t) {
+    const char* path = copy_string(a, t);
+    if (is_absolute_path(path) || ctx->base_length == 0) {
+        return path;
+    }
+    u64 length = strlen(path);
+    char* joined = (char*)arena_allocate(a, ctx->base_length + length + 1, 1);
+    memcpy(joined, ctx->base_dir, ctx->base_length);
+    memcpy(joined + ctx->base_length, path, length + 1);
+    return joined;
+}
+
+static bool parse_structure(parse_context* ctx, parse_file* f, arena* a) {
+    token_cursor c = {ctx, f, f->first_chunk, 0};
+    const scene_token* t;
+    while ((t = cursor_next(&c))) {
+        u32 line = cursor_line(&c, t);
+        if (t->kind != SCENE_TOKEN_WORD) {
+            return fail(f, line, "expected a directive, found", t->text, t->length);
+        }
+        const directive_info* info = find_directive(t->text, t->length);
+        if (!info) {
+            return fail(f, line, "unknown directive", t->text, t->length);
+        }
+        if (info->flags & DIRECTIVE_INCLUDE) {
+            const scene_token* name = cursor_next(&c);
+            if (!name || name->kind != SCENE_TOKEN_STRING) {
+                return fail(f, line, "expected a file name after", info->name, (u32)strlen(info->name));
+            }
+            f->includes = (pending_include*)grow(f->includes, &f->include_capacity, f->include_count, sizeof(pending_include));
+            pending_include* include = &f->includes[f->include_count++];
+            include->path = resolve_include(ctx, a, name);
+            include->position = f->directive_count;
+            include->line = line;
+            include->file = 0;
+            continue;
+        }
+
+        f->directives = (scene_directive*)grow(f->directives, &f->directive_capacity, f->directive_count, sizeof(scene_directive));
+        scene_directive* d = &f->directives[f->directive_count++];
+        d->type = (scene_directive_type)info->type;
+        d->file = (u32)(f - ctx->files);
+        d->line = line;
+        d->string_count = 0;
+        d->number_count = 0;
+        d->param_count = 0;
+        d->params = 0;
+        u32 kind = info->flags & DIRECTIVE_WORD ? SCENE_TOKEN_WORD : SCENE_TOKEN_STRING;
+        for (u32 i = 0; i < info->strings; ++i) {
+            const scene_token* s = cursor_next(&c);
+            if (!s || s->kind != kind) {
+                return fail(f, line, "missing argument of", info->name, (u32)strlen(info->name));
+            }
+            d->strings[d->string_count++] = copy_string(a, s);
+        }
+        if ((info->flags & DIRECTIVE_OPTIONAL_STRING) && peek_is(&c, SCENE_TOKEN_STRING)) {
+            d->strings[d->string_count++] = copy_string(a, cursor_next(&c));
+        }
+        if (info->numbers && !parse_directive_numbers(&c, f, d, info, line)) {
+            return FALSE;
+        }
+        if (info->params && !parse_params(ctx, &c, f, a, d)) {
+            return FALSE;
+        }
+        if (d->type == SCENE_OPTION && d->param_count != 1) {
+            return fail(f, line, "Option takes exactly one parameter", 0, 0);
+        }
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// TASKS
+// ============================================================================
+
+static void tokenize_task(void* params, u64 index, u32 thread_index) {
+    parse_context* ctx = (parse_context*)params;
+    parse_chunk* chunk = &ctx->chunks[ctx->chunk_begin + index];
+    const parse_file* f = &ctx->files[chunk->file];
+    scene_tokenize(f->text + chunk->begin, chunk->end - chunk->begin, &chunk->tokens);
+}
+
+static void structure_task(void* params, u64 index, u32 thread_index) {
+    parse_context* ctx = (parse_context*)params;
+    parse_structure(ctx, &ctx->files[ctx->batch_begin + index], &ctx->state->arenas[thread_index]);
+}
+
+static void number_task(void* params, u64 index, u32 thread_index) {
+    number_job* job = &((parse_context*)params)->jobs[index];
+    job->error_at = job->integer ? scene_parse_integers(job->text, job->length, job->count, (i32*)job->out)
+                                 : scene_parse_floats(job->text, job->length, job->count, (f32*)job->out);
+}
+
+// ============================================================================
+// DRIVER
+// ============================================================================
+
+static u32 add_file(parse_context* ctx, const char* path, u32 depth, u32 parent) {
+    ctx->files = (parse_file*)grow(ctx->files, &ctx->file_capacity, ctx->file_count, sizeof(parse_file));
+    parse_file* f = &ctx->files[ctx->file_count];
+    memset(f, 0, sizeof(*f));
+    f->path = path;
+    f->depth = depth;
+    f->parent = parent;
+    return ctx->file_count++;
+}
+
+// whether path is the file at file_index or one of the files including it. the depth
+// limit alone does not stop a file including itself twice, which doubles the files to
+// read at every level
+static bool in_include_chain(const parse_context* ctx, u32 file_index, const char* path) {
+    while (TRUE) {
+        const parse_file* f = &ctx->files[file_index];
+        if (strcmp(f->path, path) == 0) {
+            return TRUE;
+        }
+        if (f->parent == file_index) {
+            return FALSE;
+        }
+        file_index = f->parent;
+    }
+}
+
+// maps the file, empty files cannot be mapped and are read as empty text
+static bool load_file(parse_file* f) {
+    if (platform_file_map(f->path, &f->mapping)) {
+        f->text = (const char*)f->mapping.data;
+        f->size = f->mapping.size;
+        return TRUE;
+    }
+    platform_file file;
+    if (!platform_file_open(f->path, PLATFORM_FILE_READ, &file)) {
+        return FALSE;
+    }
+    platform_file_close(&file);
+    f->text = "";
+    f->size = 0;
+    return TRUE;
+}
+
+static void add_chunks(parse_context* ctx, u32 file_index) {
+    parse_file* f = &ctx->files[file_index];
+    f->first_chunk = ctx->chunk_count;
+    for (u64 begin = 0; begin < f->size;) {
+        u64 end = scene_chunk_end(f->text, f->size, begin, ctx->options.chunk_bytes);
+        ctx->chunks = (parse_chunk*)grow(ctx->chunks, &ctx->chunk_capacity, ctx->chunk_count, sizeof(parse_chunk));
+        parse_chunk* chunk = &ctx->chunks[ctx->chunk_count++];
+        memset(chunk, 0, sizeof(*chunk));
+        chunk->file = file_index;
+        chunk->begin = begin;
+        chunk->end = end;
+        ++f->chunk_count;
+        begin = end;
+    }
+}
+
+// the first failed file in file order, 0 when every file is fine
+static const parse_file* first_failure(const parse_context* ctx, u32 begin, u32 end) {
+    for (u32 i = begin; i < end; ++i) {
+        if (ctx->files[i].failed) {
+            return &ctx->files[i];
+        }
+    }
+    return 0;
+}
+
+static void report(scene* s, const parse_file* f) {
+    log_buffer(s->error, sizeof(s->error), "%s:%u: %s", f->path, f->error_line, f->error);
+}
+
+static void flatten(const parse_context* ctx, u32 file_index, scene_directive* out, u32* count) {
+    const parse_file* f = &ctx->files[file_index];
+    u32 include = 0;
+    for (u32 i = 0; i <= f->directive_count; ++i) {
+        while (include < f->include_count && f->includes[include].position == i) {
+            flatten(ctx, f->includes[include++].file, out, count);
+        }
+        if (i < f->directive_count) {
+            out[(*count)++] = f->directives[i];
+        }
+    }
+}
+
+// parses the batches of files one include level at a time, then converts the numbers
+static bool parse_all(parse_context* ctx, scene* s) {
+    u32 batch_end = ctx->file_count;
+    while (ctx->batch_begin < batch_end) {
+        ctx->chunk_begin = ctx->chunk_count;
+        for (u32 i = ctx->batch_begin; i < batch_end; ++i) {
+            s->bytes_parsed += ctx->files[i].size;
+            add_chunks(ctx, i);
+        }
+        zpool_parallel_for(ctx->pool, ctx->chunk_count - ctx->chunk_begin, 1, tokenize_task, ctx);
+
+        for (u32 i = ctx->chunk_begin; i < ctx->chunk_count; ++i) {
+            parse_chunk* chunk = &ctx->chunks[i];
+            parse_file* f = &ctx->files[chunk->file];
+            bool first = i == f->first_chunk;
+            chunk->first_line = first ? 0 : ctx->chunks[i - 1].first_line + ctx->chunks[i - 1].tokens.line_count;
+            const scene_token_list* tokens = &chunk->tokens;
+            if (tokens->error && !f->failed) {
+                const char* chunk_text = f->text + chunk->begin;
+                u32 line = chunk->first_line + count_newlines(chunk_text, tokens->error_at) + 1;
+                fail(f, line, tokens->error, 0, 0);
+            }
+        }
+        const parse_file* failed = first_failure(ctx, ctx->batch_begin, batch_end);
+        if (failed) {
+            report(s, failed);
+            return FALSE;
+        }
+
+        zpool_parallel_for(ctx->pool, batch_end - ctx->batch_begin, 1, structure_task, ctx);
+        failed = first_failure(ctx, ctx->batch_begin, batch_end);
+        if (failed) {
+            report(s, failed);
+            return FALSE;
+        }
+
+        // the includes of this level become the next batch
+        u32 next_end = batch_end;
+        for (u32 i = ctx->batch_begin; i < batch_end; ++i) {
+            for (u32 k = 0; k < ctx->files[i].include_count; ++k) {
+                pending_include* include = &ctx->files[i].includes[k];
+                u32 depth = ctx->files[i].depth + 1;
+                bool cycle = in_include_chain(ctx, i, include->path);
+                u32 child = add_file(ctx, include->path, depth, i);
+                include->file = child;
+                parse_file* parent = &ctx->files[i];
+                if (cycle) {
+                    fail(parent, include->line, "include cycle at", include->path, (u32)strlen(include->path));
+                } else if (depth > ctx->options.max_include_depth) {
+                    fail(parent, include->line, "includes nested too deep at", include->path, (u32)strlen(include->path));
+                } else if (!load_file(&ctx->files[child])) {
+                    fail(parent, include->line, "cannot open", include->path, (u32)strlen(include->path));
+                }
+                if (parent->failed) {
+                    report(s, parent);
+                    return FALSE;
+                }
+                ++next_end;
+            }
+        }
+        ctx->batch_begin = batch_end;
+        batch_end = next_end;
+    }
+
+    u32 job_count = 0;
+    for (u32 i = 0; i < ctx->file_count; ++i) {
+        job_count += ctx->files[i].job_count;
+    }
+    if (job_count) {
+        ctx->jobs = (number_job*)memory_allocate(sizeof(number_job) * job_count);
+        u32 n = 0;
+        for (u32 i = 0; i < ctx->file_count; ++i) {
+            memcpy(ctx->jobs + n, ctx->files[i].jobs, sizeof(number_job) * ctx->files[i].job_count);
+            n += ctx->files[i].job_count;
+        }
+        zpool_parallel_for(ctx->pool, job_count, 1, number_task, ctx);
+        for (u32 i = 0; i < job_count; ++i) {
+            const number_job* job = &ctx->jobs[i];
+            if (job->error_at) {
+                parse_file* f = &ctx->files[job->file];
+                u32 length = 0;
+                while (job->error_at + length < job->text + job->length && job->error_at[length] != ' ' &&
+                       job->error_at[length] != '\n' && job->error_at[length] != '\t') {
+                    ++length;
+                }
+                fail(f, job->line + count_newlines(job->text, job->error_at), "malformed number", job->error_at, length);
+                report(s, f);
+                return FALSE;
+            }
+        }
+    }
+
+    u32 directive_count = 0;
+    for (u32 i = 0; i < ctx->file_count; ++i) {
+        directive_count += ctx->files[i].directive_count;
+    }
+    arena* a = &ctx->state->arenas[0];
+    s->directives = ARENA_ALLOCATE_ARRAY(a, scene_directive, directive_count ? directive_count : 1);
+    s->directive_count = 0;
+    flatten(ctx, 0, s->directives, &s->directive_count);
+    const char** files = ARENA_ALLOCATE_ARRAY(a, const char*, ctx->file_count);
+    for (u32 i = 0; i < ctx->file_count; ++i) {
+        files[i] = ctx->files[i].path;
+    }
+    s->files = files;
+    s->file_count = ctx->file_count;
+    return TRUE;
+}
+
+static void context_release(parse_context* ctx) {
+    for (u32 i = 0; i < ctx->chunk_count; ++i) {
+        scene_token_list_destroy(&ctx->chunks[i].tokens);
+    }
+    for (u32 i = 0; i < ctx->file_count; ++i) {
+        parse_file* f = &ctx->files[i];
+        if (f->mapping.data) {
+            platform_file_unmap(&f->mapping);
+        }
+        if (f->directives) {
+            memory_free(f->directives);
+        }
+        if (f->includes) {
+            memory_free(f->includes);
+        }
+        if (f->jobs) {
+            memory_free(f->jobs);
+        }
+        if (f->params) {
+            memory_free(f->params);
+        }
+    }
+    if (ctx->chunks) {
+        memory_free(ctx->chunks);
+    }
+    if (ctx->files) {
+        memory_free(ctx->files);
+    }
+    if (ctx->jobs) {
+        memory_free(ctx->jobs);
+    }
+}
+
+static void scene_begin(scene* s, parse_context* ctx, const scene_parse_options* options, zpool* pool) {
+    memset(s, 0, sizeof(*s));
+    memset(ctx, 0, sizeof(*ctx));
+    if (options) {
+        ctx->options = *options;
+    } else {
+        scene_parse_options_default(&ctx->options);
+    }
+    ASSERT(ctx->options.chunk_bytes > 0);
+    ctx->pool = pool;
+    scene_state* state = (scene_state*)memory_allocate(sizeof(scene_state));
+    state->arena_count = pool ? zpool_thread_count(pool) : 1;
+    state->arenas = (arena*)memory_allocate(sizeof(arena) * state->arena_count);
+    for (u32 i = 0; i < state->arena_count; ++i) {
+        arena_create(&state->arenas[i], SCENE_ARENA_BLOCK);
+    }
+    ctx->state = state;
+    s->internal_data = state;
+}
+
+static bool scene_end(scene* s, parse_context* ctx, bool ok) {
+    context_release(ctx);
+    if (!ok) {
+        // keep the message, drop everything else
+        char error[sizeof(s->error)];
+        memcpy(error, s->error, sizeof(error));
+        scene_destroy(s);
+        memcpy(s->error, error, sizeof(error));
+    }
+    return ok;
+}
+
+void scene_parse_options_default(scene_parse_options* options) {
+    options->chunk_bytes = 4u << 20;
+    options->max_include_depth = 32;
+}
+
+bool scene_parse_file(scene* s, const char* path, const scene_parse_options* options, zpool* pool) {
+    ASSERT(s && path);
+    parse_context ctx;
+    scene_begin(s, &ctx, options, pool);
+    arena* a = &ctx.state->arenas[0];
+    const char* slash = 0;
+    for (const char* p = path; *p; ++p) {
+        slash = *p == '/' || *p == '\\' ? p : slash;
+    }
+    ctx.base_dir = path;
+    ctx.base_length = slash ? (u32)(slash - path + 1) : 0;
+    u32 main_file = add_file(&ctx, copy_text(a, path, strlen(path)), 0, 0);
+    if (!load_file(&ctx.files[main_file])) {
+        log_buffer(s->error, sizeof(s->error), "%s: cannot open", path);
+        return scene_end(s, &ctx, FALSE);
+    }
+    return scene_end(s, &ctx, parse_all(&ctx, s));
+}
+
+bool scene_parse_text(scene* s,
+                      const char* text,
+                      u64 size,
+                      const char* name,
+                      const scene_parse_options* options,
+                      zpool* pool) {
+    ASSERT(s && (text || size == 0) && name);
+    parse_context ctx;
+    scene_begin(s, &ctx, options, pool);
+    u32 main_file = add_file(&ctx, copy_text(&ctx.state->arenas[0], name, strlen(name)), 0, 0);
+    ctx.files[main_file].text = text ? text : "";
+    ctx.files[main_file].size = size;
+    return scene_end(s, &ctx, parse_all(&ctx, s));
+}
+
+void scene_destroy(scene* s) {
+    scene_state* state = (scene_state*)s->internal_data;
+    if (state) {
+        for (u32 i = 0; i < state->arena_count; ++i) {
+            arena_destroy(&state->arenas[i]);
+        }
+        memory_free(state->arenas);
+        memory_free(state);
+    }
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,170 @@
+#ifndef SCENE__H
+#define SCENE__H
+
+#include "defines.h"
+#include "zpool.h"
+
+/***
+ *    ███████  ██████ ███████ ███    ██ ███████
+ *    ██      ██      ██      ████   ██ ██
+ *    ███████ ██      █████   ██ ██  ██ █████
+ *         ██ ██      ██      ██  ██ ██ ██
+ *    ███████  ██████ ███████ ██   ████ ███████
+ *
+ *
+ */
+
+// parser for pbrt-v4 scene files. the result is the flat list of directives in the order a
+// serial parser would see them, with Include and Import files spliced in where they appear.
+// files are mapped, cut into chunks at line starts and tokenized in parallel, then every
+// file's directive structure is parsed by its own task, so independent Include/Import files
+// proceed concurrently. numeric lists are converted last, split across the pool. every
+// parsed array and string comes from per thread arenas released by scene_destroy, the input
+// files are unmapped before scene_parse_file returns.
+// this is syntax only: transforms are not applied, names are not resolved and Import files
+// are spliced like Include files without checking what they may contain
+
+typedef enum scene_directive_type {
+    SCENE_ACCELERATOR,
+    SCENE_ACTIVE_TRANSFORM,
+    SCENE_AREA_LIGHT_SOURCE,
+    SCENE_ATTRIBUTE,
+    SCENE_ATTRIBUTE_BEGIN,
+    SCENE_ATTRIBUTE_END,
+    SCENE_CAMERA,
+    SCENE_COLOR_SPACE,
+    SCENE_CONCAT_TRANSFORM,
+    SCENE_COORDINATE_SYSTEM,
+    SCENE_COORD_SYS_TRANSFORM,
+    SCENE_FILM,
+    SCENE_IDENTITY,
+    SCENE_INTEGRATOR,
+    SCENE_LIGHT_SOURCE,
+    SCENE_LOOK_AT,
+    SCENE_MAKE_NAMED_MATERIAL,
+    SCENE_MAKE_NAMED_MEDIUM,
+    SCENE_MATERIAL,
+    SCENE_MEDIUM_INTERFACE,
+    SCENE_NAMED_MATERIAL,
+    SCENE_OBJECT_BEGIN,
+    SCENE_OBJECT_END,
+    SCENE_OBJECT_INSTANCE,
+    SCENE_OPTION,
+    SCENE_PIXEL_FILTER,
+    SCENE_REVERSE_ORIENTATION,
+    SCENE_ROTATE,
+    SCENE_SAMPLER,
+    SCENE_SCALE,
+    SCENE_SHAPE,
+    SCENE_TEXTURE,
+    SCENE_TRANSFORM,
+    SCENE_TRANSFORM_BEGIN,
+    SCENE_TRANSFORM_END,
+    SCENE_TRANSFORM_TIMES,
+    SCENE_TRANSLATE,
+    SCENE_WORLD_BEGIN,
+    SCENE_DIRECTIVE_COUNT,
+} scene_directive_type;
+
+// the aliases point, vector, normal and color parse as point3, vector3, normal3 and rgb
+typedef enum scene_param_type {
+    SCENE_PARAM_INTEGER,
+    SCENE_PARAM_FLOAT,
+    SCENE_PARAM_POINT2,
+    SCENE_PARAM_VECTOR2,
+    SCENE_PARAM_POINT3,
+    SCENE_PARAM_VECTOR3,
+    SCENE_PARAM_NORMAL3,
+    SCENE_PARAM_RGB,
+    SCENE_PARAM_SPECTRUM,
+    SCENE_PARAM_BLACKBODY,
+    SCENE_PARAM_BOOL,
+    SCENE_PARAM_STRING,
+    SCENE_PARAM_TEXTURE,
+} scene_param_type;
+
+// which member of the value union is set. integer params hold ints, bools hold bools,
+// strings and textures hold strings, spectrum holds floats or a string and the rest floats
+typedef enum scene_value_kind {
+    SCENE_VALUES_FLOAT,
+    SCENE_VALUES_INT,
+    SCENE_VALUES_BOOL,
+    SCENE_VALUES_STRING,
+} scene_value_kind;
+
+typedef struct scene_param {
+    scene_param_type type;
+    scene_value_kind kind;
+    const char* name;
+    // values, not components: a point3 list of n points has count 3n
+    u32 count;
+    union {
+        const f32* floats;
+        const i32* ints;
+        const bool* bools;
+        const char* const* strings;
+    };
+} scene_param;
+
+typedef struct scene_directive {
+    scene_directive_type type;
+    // index into scene.files and the 1 based line the directive starts on
+    u32 file;
+    u32 line;
+    // the quoted arguments before the parameter list: the shape or light type, the three
+    // names of a Texture, the word of ActiveTransform...
+    u32 string_count;
+    const char* strings[3];
+    // arguments of the transform directives, in file order
+    u32 number_count;
+    f32 numbers[16];
+    u32 param_count;
+    const scene_param* params;
+} scene_directive;
+
+typedef struct scene_parse_options {
+    // target size of the pieces files are tokenized in, they end at the next line start
+    u64 chunk_bytes;
+    // deeper Include/Import nesting is an error. a file including itself, directly or
+    // through others, is an error at any depth
+    u32 max_include_depth;
+} scene_parse_options;
+
+typedef struct scene {
+    scene_directive* directives;
+    u32 directive_count;
+    // paths of every file read, the main file first. Include/Import paths are relative to
+    // the directory of the main file, as in pbrt-v4
+    const char** files;
+    u32 file_count;
+    u64 bytes_parsed;
+    // "file:line: message" when parsing failed
+    char error[256];
+    void* internal_data;
+} scene;
+
+// 4 MB chunks, include depth 32
+void scene_parse_options_default(scene_parse_options* options);
+
+// parses path and every file it includes. options and pool may be null. on failure error
+// describes the first problem in file order, the scene holds no directives and
+// scene_destroy is still safe to call
+bool scene_parse_file(scene* s, const char* path, const scene_parse_options* options, zpool* pool);
+
+// parses text as if it were a file named name, includes resolve relative to the working
+// directory
+bool scene_parse_text(scene* s,
+                      const char* text,
+                      u64 size,
+                      const char* name,
+                      const scene_parse_options* options,
+                      zpool* pool);
+
+void scene_destroy(scene* s);
+
+const char* scene_directive_name(scene_directive_type type);
+
+// the parameter called name, 0 when the directive has none
+const scene_param* scene_directive_param(const scene_directive* d, const char* name);
+
+#endif
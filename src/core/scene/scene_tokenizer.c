@@ -0,0 +1,265 @@
+#include "scene_tokenizer.h"
+#include <math.h>
+#include "math_utils.h"
+#include "logger.h"
+#include "memory.h"
+
+#define TOKEN_LIST_INITIAL 1024
+
+// powers that are exact in a double, mantissas below 2^53 scaled by them round once
+static const f64 powers_of_ten[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+enum {
+    CHAR_BLANK = 1,
+    CHAR_NEWLINE = 2,
+    // quote, brackets and comment start, which end a word like blanks do
+    CHAR_SPECIAL = 4,
+    CHAR_NUMBER = 8,
+    CHAR_DELIMITER = CHAR_BLANK | CHAR_NEWLINE | CHAR_SPECIAL,
+};
+
+static const u8 char_class[256] = {
+    [' '] = CHAR_BLANK,    ['\t'] = CHAR_BLANK,     ['\r'] = CHAR_BLANK,     ['\n'] = CHAR_NEWLINE,
+    ['"'] = CHAR_SPECIAL,  ['['] = CHAR_SPECIAL,    [']'] = CHAR_SPECIAL,    ['#'] = CHAR_SPECIAL,
+    ['0' ... '9'] = CHAR_NUMBER, ['-'] = CHAR_NUMBER, ['+'] = CHAR_NUMBER,   ['.'] = CHAR_NUMBER,
+};
+
+static inline bool is_delimiter(char c) {
+    return char_class[(u8)c] & CHAR_DELIMITER;
+}
+
+static inline bool is_digit(char c) {
+    return (u32)(c - '0') < 10;
+}
+
+// past blanks, newlines and comments, counting the newlines
+static inline const char* skip_blanks(const char* p, const char* end, u32* line) {
+    while (p < end) {
+        u8 c = char_class[(u8)*p];
+        if (c & CHAR_BLANK) {
+            ++p;
+        } else if (c & CHAR_NEWLINE) {
+            ++*line;
+            ++p;
+        } else if (*p == '#') {
+            while (p < end && *p != '\n') {
+                ++p;
+            }
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+// ============================================================================
+// TOKENIZER
+// ============================================================================
+
+static scene_token* push_token(scene_token_list* list, scene_token_kind kind, const char* text, u64 length, u32 line) {
+    if (list->count == list->capacity) {
+        list->capacity *= 2;
+        list->tokens = (scene_token*)memory_reallocate(list->tokens, sizeof(scene_token) * list->capacity);
+    }
+    scene_token* token = &list->tokens[list->count++];
+    token->text = text;
+    token->length = (u32)length;
+    token->line = line;
+    token->count = 1;
+    token->kind = kind;
+    return token;
+}
+
+void scene_tokenize(const char* text, u64 size, scene_token_list* list) {
+    list->capacity = TOKEN_LIST_INITIAL;
+    list->tokens = (scene_token*)memory_allocate(sizeof(scene_token) * list->capacity);
+    list->count = 0;
+    list->error = 0;
+    list->error_at = 0;
+
+    const char* p = text;
+    const char* end = text + size;
+    u32 line = 0;
+    while (p < end) {
+        p = skip_blanks(p, end, &line);
+        if (p == end) {
+            break;
+        }
+        char c = *p;
+        if (c == '"') {
+            const char* start = ++p;
+            while (p < end && *p != '"' && *p != '\n') {
+                // an escaped character never ends the string
+                p += *p == '\\' && p + 1 < end && p[1] != '\n' ? 2 : 1;
+            }
+            if (p >= end || *p != '"') {
+                list->error = "unterminated string";
+                list->error_at = start - 1;
+                break;
+            }
+            push_token(list, SCENE_TOKEN_STRING, start, (u64)(p - start), line);
+            ++p;
+        } else if (c == '[' || c == ']') {
+            push_token(list, c == '[' ? SCENE_TOKEN_OPEN : SCENE_TOKEN_CLOSE, p, 1, line);
+            ++p;
+        } else if (char_class[(u8)c] & CHAR_NUMBER) {
+            // consume the whole run here, blanks and comments between its numbers included
+            scene_token* run = push_token(list, SCENE_TOKEN_NUMBERS, p, 0, line);
+            const char* run_end;
+            u32 count = 0;
+            for (;;) {
+                while (p < end && !is_delimiter(*p)) {
+                    ++p;
+                }
+                run_end = p;
+                if (++count == SCENE_TOKEN_RUN_MAX) {
+                    break;
+                }
+                p = skip_blanks(p, end, &line);
+                if (p == end || !(char_class[(u8)*p] & CHAR_NUMBER)) {
+                    break;
+                }
+            }
+            run->length = (u32)(run_end - run->text);
+            run->count = count;
+        } else {
+            const char* start = p;
+            while (p < end && !is_delimiter(*p)) {
+                ++p;
+            }
+            push_token(list, SCENE_TOKEN_WORD, start, (u64)(p - start), line);
+        }
+    }
+    list->line_count = line;
+}
+
+void scene_token_list_destroy(scene_token_list* list) {
+    if (list->tokens) {
+        memory_free(list->tokens);
+    }
+    list->tokens = 0;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+u64 scene_chunk_end(const char* text, u64 size, u64 from, u64 chunk_bytes) {
+    u64 at = from + chunk_bytes;
+    if (at >= size) {
+        return size;
+    }
+    while (at < size && text[at - 1] != '\n') {
+        ++at;
+    }
+    return at;
+}
+
+// ============================================================================
+// NUMBERS
+// ============================================================================
+
+// decimal mantissa of at most 19 significant digits and a power of ten. the word has to end
+// right after the number, so 1.2.3 or 4x are malformed rather than two tokens
+static bool parse_number(const char** cursor, const char* end, f64* value, bool* integral) {
+    const char* p = *cursor;
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        ++p;
+    }
+    u64 mantissa = 0;
+    u32 digits = 0;
+    i32 exponent = 0;
+    bool any = FALSE;
+    for (; p < end && is_digit(*p); ++p) {
+        any = TRUE;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (u64)(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+        }
+    }
+    *integral = TRUE;
+    if (p < end && *p == '.') {
+        *integral = FALSE;
+        for (++p; p < end && is_digit(*p); ++p) {
+            any = TRUE;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (u64)(*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (!any) {
+        return FALSE;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        *integral = FALSE;
+        ++p;
+        bool negative_exponent = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) {
+            ++p;
+        }
+        if (p >= end || !is_digit(*p)) {
+            return FALSE;
+        }
+        i32 e = 0;
+        for (; p < end && is_digit(*p); ++p) {
+            e = e < 100000 ? e * 10 + (*p - '0') : e;
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+    if (p < end && !is_delimiter(*p)) {
+        return FALSE;
+    }
+    f64 v = (f64)mantissa;
+    if (exponent >= 0) {
+        v = exponent <= 22 ? v * powers_of_ten[exponent] : v * pow(10.0, exponent);
+    } else {
+        v = exponent >= -22 ? v / powers_of_ten[-exponent] : v * pow(10.0, exponent);
+    }
+    *value = negative ? -v : v;
+    *cursor = p;
+    return TRUE;
+}
+
+const char* scene_parse_floats(const char* text, u64 length, u32 count, f32* out) {
+    const char* p = text;
+    const char* end = text + length;
+    for (u32 i = 0; i < count; ++i) {
+        u32 lines = 0;
+        p = skip_blanks(p, end, &lines);
+        const char* start = p;
+        f64 value;
+        bool integral;
+        if (p >= end || !parse_number(&p, end, &value, &integral)) {
+            return start;
+        }
+        // past the f32 range the value would silently turn into an infinity. compared as a
+        // double since release builds assume no infinities (-ffast-math) and drop isfinite
+        if (value > MAX_F32 || value < -MAX_F32) {
+            return start;
+        }
+        out[i] = (f32)value;
+    }
+    return 0;
+}
+
+const char* scene_parse_integers(const char* text, u64 length, u32 count, i32* out) {
+    const char* p = text;
+    const char* end = text + length;
+    for (u32 i = 0; i < count; ++i) {
+        u32 lines = 0;
+        p = skip_blanks(p, end, &lines);
+        const char* start = p;
+        f64 value;
+        bool integral;
+        if (p >= end || !parse_number(&p, end, &value, &integral) || !integral || value > 2147483647.0 ||
+            value < -2147483648.0) {
+            return start;
+        }
+        out[i] = (i32)value;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef SCENE_TOKENIZER__H
+#define SCENE_TOKENIZER__H
+
+#include "defines.h"
+
+/***
+ *    ████████  ██████  ██   ██ ███████ ███    ██ ███████
+ *       ██    ██    ██ ██  ██  ██      ████   ██ ██
+ *       ██    ██    ██ █████   █████   ██ ██  ██ ███████
+ *       ██    ██    ██ ██  ██  ██      ██  ██ ██      ██
+ *       ██     ██████  ██   ██ ███████ ██   ████ ███████
+ *
+ *
+ */
+
+// lexer for the pbrt-v4 scene format. strings cannot span lines and comments end at the
+// newline, so no state crosses a line break and any range starting at a line start can be
+// tokenized on its own. that is what lets a file be cut into chunks tokenized in parallel.
+// numbers are not converted here: consecutive numbers become a single run token that the
+// parser converts later, also in parallel, so a million vertex list costs a few dozen tokens
+
+typedef enum scene_token_kind {
+    // text is the contents without the quotes, escapes still in place
+    SCENE_TOKEN_STRING,
+    // directive names, true/false and anything else unquoted that does not look like a number
+    SCENE_TOKEN_WORD,
+    // count numbers, text spans from the first to the end of the last. comments inside the
+    // run are part of the text
+    SCENE_TOKEN_NUMBERS,
+    SCENE_TOKEN_OPEN,
+    SCENE_TOKEN_CLOSE,
+} scene_token_kind;
+
+// runs are cut at this many numbers so a long list converts in balanced pieces
+#define SCENE_TOKEN_RUN_MAX (1u << 14)
+
+typedef struct scene_token {
+    const char* text;
+    u32 length;
+    // 0 based, relative to the start of the tokenized range
+    u32 line;
+    // numbers in a SCENE_TOKEN_NUMBERS run, 1 for other tokens
+    u32 count;
+    u32 kind;
+} scene_token;
+
+typedef struct scene_token_list {
+    scene_token* tokens;
+    u32 count;
+    u32 capacity;
+    // newlines in the range
+    u32 line_count;
+    // first lexical error and where it is, error is 0 when there was none
+    const char* error;
+    const char* error_at;
+} scene_token_list;
+
+// tokenizes [text, text + size), which must start at the beginning of a line. stops at the
+// first error
+void scene_tokenize(const char* text, u64 size, scene_token_list* list);
+
+void scene_token_list_destroy(scene_token_list* list);
+
+// the first line start at or after from + chunk_bytes, or size. cutting a file at these
+// offsets gives ranges scene_tokenize accepts
+u64 scene_chunk_end(const char* text, u64 size, u64 from, u64 chunk_bytes);
+
+// convert the count numbers of a run. return 0 on success or where the malformed number
+// starts. floats must be finite as f32, integers must be whole and fit in 32 bits
+const char* scene_parse_floats(const char* text, u64 length, u32 count, f32* out);
+const char* scene_parse_integers(const char* text, u64 length, u32 count, i32* out);
+
+#endif
@@ -1,10 +1,92 @@
-#include"logger.h"
-
-int main(){
-	LOGE("pbrt");
-	LOGW("pbrt");
-	LOGI("pbrt");
-	LOGD("pbrt");
-	LOGT("pbrt");
-	return 0;
-}
\ No newline at end of file
+#include <stdlib.h>
+#include <string.h>
+#include "scene.h"
+#include "clock.h"
+#include "logger.h"
+#include "memory.h"
+#include "zpool.h"
+#include "flight_recorder.h"
+
+static bool match_option(const char* arg, const char* option, const char** value) {
+    u64 length = strlen(option);
+    if (strncmp(arg, option, length) != 0 || arg[length] != '=') {
+        return FALSE;
+    }
+    *value = arg + length + 1;
+    return TRUE;
+}
+
+static void print_usage() {
+    log_stdout("usage: pbrt [--threads=N] scene.pbrt\n");
+}
+
+static bool load_scene(const char* path, u32 threads) {
+    // a worker count of 0 means one per processor, a single thread parses without a pool
+    zpool pool;
+    zpool* workers = 0;
+    if (threads != 1) {
+        zpool_create(&pool, threads ? threads - 1 : 0);
+        workers = &pool;
+    }
+    clock clk;
+    clock_set(&clk);
+    scene s;
+    bool parsed = scene_parse_file(&s, path, 0, workers);
+    clock_update(&clk);
+    if (!parsed) {
+        LOGE("%s", s.error);
+    } else {
+        u32 counts[SCENE_DIRECTIVE_COUNT] = {0};
+        for (u32 i = 0; i < s.directive_count; ++i) {
+            ++counts[s.directives[i].type];
+        }
+        f64 megabytes = s.bytes_parsed / (1024.0 * 1024.0);
+        log_stdout("%s: %u files, %.1f MB in %.3fs (%.0f MB/s, %u threads)\n",
+                   path,
+                   s.file_count,
+                   megabytes,
+                   clk.elapsed,
+                   megabytes / clk.elapsed,
+                   workers ? zpool_thread_count(workers) : 1);
+        log_stdout("%u directives, %u shapes, %u lights, %u materials, %u object instances\n",
+                   s.directive_count,
+                   counts[SCENE_SHAPE],
+                   counts[SCENE_LIGHT_SOURCE] + counts[SCENE_AREA_LIGHT_SOURCE],
+                   counts[SCENE_MATERIAL] + counts[SCENE_MAKE_NAMED_MATERIAL],
+                   counts[SCENE_OBJECT_INSTANCE]);
+    }
+    scene_destroy(&s);
+    if (workers) {
+        zpool_destroy(workers);
+    }
+    return parsed;
+}
+
+// --threads=N     threads parsing the scene, default one per processor
+int main(int argc, char** argv) {
+    const char* path = 0;
+    u32 threads = 0;
+    for (i32 i = 1; i < argc; ++i) {
+        const char* value;
+        if (match_option(argv[i], "--threads", &value)) {
+            threads = (u32)strtoul(value, 0, 10);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            LOGE("unknown argument %s", argv[i]);
+            print_usage();
+            return 1;
+        }
+    }
+    if (!path) {
+        print_usage();
+        return 1;
+    }
+
+    memory_init(TRUE);
+    flight_recorder_init("pbrt_crash");
+    bool loaded = load_scene(path, threads);
+    flight_recorder_shutdown();
+    memory_shutdown();
+    return loaded ? 0 : 1;
+}
@@ -4,15 +4,37 @@
 
 #include "test_manager.h"
 #include "memory.h"
+#include "flight_recorder.h"
 
 void register_memory_testcases();
+void register_threads_testcases();
+void register_flight_recorder_testcases();
+void register_math_testcases();
+void register_geometry_testcases();
+void register_accel_testcases();
+void register_scene_testcases();
+void register_render_testcases();
+void register_sampling_testcases();
+void register_integrator_testcases();
 
-int main() {
+int main(int argc, char** argv) {
     memory_init(TRUE);
-    test_manager_init(100); // Initialize with max 100 tests
+    flight_recorder_init("pbrt_testing_crash");
+    test_manager_init(256); // initial capacity, registration grows past it
+    test_manager_parse_args(argc, argv);
     register_memory_testcases();
-    test_manager_run();
+    register_threads_testcases();
+    register_flight_recorder_testcases();
+    register_math_testcases();
+    register_geometry_testcases();
+    register_accel_testcases();
+    register_scene_testcases();
+    register_render_testcases();
+    register_sampling_testcases();
+    register_integrator_testcases();
+    u32 result = test_manager_run();
     test_manager_shutdown();
+    flight_recorder_shutdown();
     memory_shutdown();
-    return 0;
+    return result == TRUE ? 0 : 1;
 }
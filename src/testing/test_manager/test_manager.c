@@ -1,17 +1,91 @@
 #include "test_manager.h"
+#include "memory.h"
+#undef malloc
+#undef free
+#undef realloc
+
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include "clock.h"
 #include "logger.h"
+#include "platform.h"
+#include "zpool.h"
+#include "flight_recorder.h"
+
+#ifdef PLATFORM_LINUX
+#    include <unistd.h>
+#    include <signal.h>
+#    include <sys/wait.h>
+#endif
 
 typedef struct test {
     u32 (*function)();
     char* name;
+    // allocation budget per iteration, 0 means unlimited
+    u64 max_bytes;
+    u64 max_allocations;
 } test;
 
+typedef struct test_result {
+    // FALSE when the test was filtered out of this run
+    bool selected;
+    bool passed;
+    bool timed_out;
+    u32 iterations;
+    f64 mean;
+    f64 stddev;
+    f64 min;
+    f64 max;
+    bool over_budget;
+    // FALSE when other tests ran concurrently and the tracker counters below overlap
+    bool exact_accounting;
+    // average bytes handed out by the tracker per iteration
+    u64 bytes_allocated;
+    // process peak resident memory after the test finished
+    u64 peak_memory;
+    // average allocations (including reallocations) per iteration
+    u64 allocations;
+    // highest tracked memory above what was allocated when the test started
+    u64 tracked_peak;
+    // memory still allocated when the test returned, summed over iterations
+    u64 leaked_bytes;
+    u64 leaked_allocations;
+} test_result;
+
+typedef struct baseline_entry {
+    char name[128];
+    test_result result;
+} baseline_entry;
+
 static test* tests;
+static test_result* results;
 static u64 tests_size;
 static u64 idx;
 
+// command line configuration
+static u32 iterations = 1;
+static const char* json_path;
+static const char* csv_path;
+static const char* baseline_path;
+// relative slowdown (or allocation growth) tolerated before a test counts as regressed
+static f64 regression_threshold = 0.10;
+// welch t statistic above which a slowdown is considered significant
+#define REGRESSION_T_SCORE 2.0
+// number of tests run at the same time
+static u32 jobs = 1;
+// run every test in its own child process (linux only)
+static bool use_fork;
+// seconds a test may take before it is failed (0 disables the limit)
+static f64 timeout;
+// cleared while tests run concurrently on threads and share the tracker counters
+static bool exact_accounting = TRUE;
+// comma separated glob patterns, a test runs when it matches an include
+// (or no include was given) and matches no exclude
+static char* include_patterns;
+static char* exclude_patterns;
+
 #define PRINT_TIME(msg, seconds)                  \
     do {                                          \
         if (seconds < 60) {                       \
@@ -25,46 +99,565 @@ static u64 idx;
 
 void test_manager_init(u64 max_tests) {
     ASSERT(tests == 0);
-    tests = (test*)malloc(sizeof(test) * max_tests);
-    tests_size = max_tests;
+    tests_size = max_tests ? max_tests : 16;
+    tests = (test*)malloc(sizeof(test) * tests_size);
+    results = (test_result*)malloc(sizeof(test_result) * tests_size);
     LOGD("test_manager_init");
 }
 
 void test_manager_shutdown() {
     ASSERT(tests);
     free(tests);
+    free(results);
+    free(include_patterns);
+    free(exclude_patterns);
     LOGD("test_manager_shutdown");
 }
 
+static char* copy_string(const char* str) {
+    u64 length = strlen(str);
+    char* copy = (char*)malloc(length + 1);
+    memcpy(copy, str, length + 1);
+    return copy;
+}
+
+static bool match_option(const char* arg, const char* option, const char** value) {
+    u64 length = strlen(option);
+    if (strncmp(arg, option, length) != 0 || arg[length] != '=') {
+        return FALSE;
+    }
+    *value = arg + length + 1;
+    return TRUE;
+}
+
+void test_manager_parse_args(i32 argc, char** argv) {
+    for (i32 i = 1; i < argc; ++i) {
+        const char* value;
+        if (match_option(argv[i], "--iterations", &value)) {
+            iterations = (u32)strtoul(value, 0, 10);
+            if (iterations == 0) {
+                iterations = 1;
+            }
+        } else if (match_option(argv[i], "--json", &value)) {
+            json_path = value;
+        } else if (match_option(argv[i], "--csv", &value)) {
+            csv_path = value;
+        } else if (match_option(argv[i], "--baseline", &value)) {
+            baseline_path = value;
+        } else if (match_option(argv[i], "--threshold", &value)) {
+            regression_threshold = strtod(value, 0);
+        } else if (match_option(argv[i], "--filter", &value)) {
+            free(include_patterns);
+            include_patterns = copy_string(value);
+        } else if (match_option(argv[i], "--exclude", &value)) {
+            free(exclude_patterns);
+            exclude_patterns = copy_string(value);
+        } else if (match_option(argv[i], "--jobs", &value)) {
+            jobs = (u32)strtoul(value, 0, 10);
+            if (jobs == 0) {
+                jobs = platform_processor_count();
+            }
+        } else if (match_option(argv[i], "--timeout", &value)) {
+            timeout = strtod(value, 0);
+        } else if (strcmp(argv[i], "--fork") == 0) {
+            use_fork = TRUE;
+        } else {
+            LOGW("test_manager: unknown argument %s", argv[i]);
+        }
+    }
+}
+
 void test_manager_add(u32 (*function)(), char* name) {
-    ASSERT(tests_size > idx);
+    ASSERT(tests);
+    if (idx == tests_size) {
+        tests_size *= 2;
+        tests = (test*)realloc(tests, sizeof(test) * tests_size);
+        results = (test_result*)realloc(results, sizeof(test_result) * tests_size);
+    }
     tests[idx].function = function;
     tests[idx].name = name;
+    tests[idx].max_bytes = 0;
+    tests[idx].max_allocations = 0;
     idx += 1;
 }
 
-void test_manager_run() {
+void test_manager_add_budget(u32 (*function)(), char* name, u64 max_bytes, u64 max_allocations) {
+    test_manager_add(function, name);
+    tests[idx - 1].max_bytes = max_bytes;
+    tests[idx - 1].max_allocations = max_allocations;
+}
+
+// glob match supporting '*' (any run of characters) and '?' (any single character),
+// the pattern ends at a ',' so the comma separated lists can be matched in place
+static bool glob_match(const char* pattern, const char* str) {
+    const char* star = 0;
+    const char* resume = 0;
+    while (*str) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = str;
+        } else if (*pattern && *pattern != ',' && (*pattern == '?' || *pattern == *str)) {
+            pattern++;
+            str++;
+        } else if (star) {
+            pattern = star + 1;
+            str = ++resume;
+        } else {
+            return FALSE;
+        }
+    }
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == 0 || *pattern == ',';
+}
+
+static bool match_any(const char* patterns, const char* name) {
+    while (patterns) {
+        if (glob_match(patterns, name)) {
+            return TRUE;
+        }
+        patterns = strchr(patterns, ',');
+        patterns = patterns ? patterns + 1 : 0;
+    }
+    return FALSE;
+}
+
+static bool is_selected(const char* name) {
+    if (include_patterns && !match_any(include_patterns, name)) {
+        return FALSE;
+    }
+    return exclude_patterns == 0 || !match_any(exclude_patterns, name);
+}
+
+static void run_test(test* t, test_result* result) {
+    memory_stats before;
+    memory_stats after;
+    clock clk;
+    f64 sum = 0;
+    f64 sum_squared = 0;
+
+    result->selected = TRUE;
+    result->passed = TRUE;
+    result->timed_out = FALSE;
+    result->over_budget = FALSE;
+    result->exact_accounting = exact_accounting;
+    result->iterations = 0;
+    result->min = 0;
+    result->max = 0;
+
+    if (exact_accounting) {
+        memory_reset_peak();
+    }
+    memory_get_stats(&before);
+    flight_recorder_zone_begin(t->name);
+    for (u32 i = 0; i < iterations; ++i) {
+        clock_set(&clk);
+        u32 passed = t->function();
+        clock_update(&clk);
+
+        result->iterations += 1;
+        sum += clk.elapsed;
+        sum_squared += clk.elapsed * clk.elapsed;
+        if (i == 0 || clk.elapsed < result->min) {
+            result->min = clk.elapsed;
+        }
+        if (i == 0 || clk.elapsed > result->max) {
+            result->max = clk.elapsed;
+        }
+        if (passed != TRUE) {
+            result->passed = FALSE;
+            break;
+        }
+    }
+    flight_recorder_zone_end(t->name);
+    memory_get_stats(&after);
+
+    u32 n = result->iterations;
+    result->mean = sum / n;
+    f64 variance = n > 1 ? (sum_squared - sum * sum / n) / (n - 1) : 0;
+    result->stddev = variance > 0 ? sqrt(variance) : 0;
+    result->bytes_allocated = (after.total_allocated - before.total_allocated) / n;
+    result->allocations = (after.allocation_count + after.reallocation_count - before.allocation_count - before.reallocation_count) / n;
+    result->tracked_peak = after.peak_memory > before.allocated_memory ? after.peak_memory - before.allocated_memory : 0;
+    result->leaked_bytes = after.allocated_memory > before.allocated_memory ? after.allocated_memory - before.allocated_memory : 0;
+    u64 frees = after.free_count - before.free_count;
+    u64 allocations = after.allocation_count - before.allocation_count;
+    result->leaked_allocations = allocations > frees ? allocations - frees : 0;
+    result->peak_memory = platform_peak_memory_usage();
+    if (exact_accounting && ((t->max_bytes && result->bytes_allocated > t->max_bytes) ||
+                             (t->max_allocations && result->allocations > t->max_allocations))) {
+        result->passed = FALSE;
+        result->over_budget = TRUE;
+    }
+    if (timeout > 0 && sum > timeout) {
+        result->passed = FALSE;
+        result->timed_out = TRUE;
+    }
+}
+
+static void report_result(u64 i) {
+    test_result* r = &results[i];
+    if (r->passed) {
+        LOGT("passed : name = %s ,time_taken: %lf ,allocations: %llu ,bytes: %llu ,peak: %llu", tests[i].name, r->mean,
+             r->allocations, r->bytes_allocated, r->tracked_peak);
+    } else if (r->over_budget) {
+        LOGE("failed : name = %s ,over allocation budget: %llu bytes in %llu allocations (budget %llu bytes, %llu allocations)",
+             tests[i].name, r->bytes_allocated, r->allocations, tests[i].max_bytes, tests[i].max_allocations);
+    } else if (r->timed_out) {
+        LOGE("failed : name = %s ,timed out after %lf secs", tests[i].name, timeout);
+    } else {
+        LOGE("failed : name = %s", tests[i].name);
+    }
+    if (r->exact_accounting && r->leaked_bytes) {
+        LOGW("leaked : name = %s ,%llu bytes in %llu allocations", tests[i].name, r->leaked_bytes, r->leaked_allocations);
+    }
+}
+
+//    ███████ ██   ██ ███████  ██████ ██    ██ ████████ ██  ██████  ███    ██
+//    ██       ██ ██  ██      ██      ██    ██    ██    ██ ██    ██ ████   ██
+//    █████     ███   █████   ██      ██    ██    ██    ██ ██    ██ ██ ██  ██
+//    ██       ██ ██  ██      ██      ██    ██    ██    ██ ██    ██ ██  ██ ██
+//    ███████ ██   ██ ███████  ██████  ██████     ██    ██  ██████  ██   ████
+//
+//
+
+static void run_test_task(void* params, u64 index, u32 thread_index) {
+    u64 i = ((u64*)params)[index];
+    run_test(&tests[i], &results[i]);
+    report_result(i);
+}
+
+static void run_threaded(u64* selected, u64 count) {
+    // tests share the process, so the tracker counters of concurrently running tests
+    // overlap. tests with an allocation budget are held back and run one at a time
+    // afterwards so their accounting stays exact
+    u64* parallel = (u64*)malloc(sizeof(u64) * count);
+    u64 parallel_count = 0;
+    for (u64 i = 0; i < count; ++i) {
+        if (tests[selected[i]].max_bytes == 0 && tests[selected[i]].max_allocations == 0) {
+            parallel[parallel_count++] = selected[i];
+        }
+    }
+    zpool pool;
+    zpool_create(&pool, jobs - 1);
+    exact_accounting = FALSE;
+    zpool_parallel_for(&pool, parallel_count, 1, run_test_task, parallel);
+    exact_accounting = TRUE;
+    zpool_destroy(&pool);
+    free(parallel);
+
+    for (u64 i = 0; i < count; ++i) {
+        if (tests[selected[i]].max_bytes || tests[selected[i]].max_allocations) {
+            run_test(&tests[selected[i]], &results[selected[i]]);
+            report_result(selected[i]);
+        }
+    }
+}
+
+#ifdef PLATFORM_LINUX
+typedef struct test_child {
+    pid_t pid;
+    i32 fd;
+    u64 test;
+    f64 start;
+} test_child;
+
+// status is the wait status of the already reaped child
+static void finish_child(test_child* child, bool killed, i32 status) {
+    test_result* result = &results[child->test];
+    if (killed) {
+        result->passed = FALSE;
+        result->timed_out = TRUE;
+    } else if (read(child->fd, result, sizeof(test_result)) != sizeof(test_result)) {
+        // the child died before reporting (crash, assert or abort)
+        result->passed = FALSE;
+        LOGE("test process for %s terminated abnormally (status %i)", tests[child->test].name, status);
+    }
+    close(child->fd);
+    report_result(child->test);
+}
+
+// every test runs in a forked child that writes its result back through a pipe,
+// children past the timeout are killed and a crash only fails the test that caused it
+static void run_forked(u64* selected, u64 count) {
+    test_child* children = (test_child*)malloc(sizeof(test_child) * jobs);
+    u32 running = 0;
+    u64 next = 0;
+    while (next < count || running) {
+        while (running < jobs && next < count) {
+            u64 i = selected[next++];
+            i32 fds[2];
+            if (pipe(fds) != 0) {
+                LOGE("test_manager: pipe failed, running %s in process", tests[i].name);
+                run_test(&tests[i], &results[i]);
+                report_result(i);
+                continue;
+            }
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(fds[0]);
+                run_test(&tests[i], &results[i]);
+                ssize_t written = write(fds[1], &results[i], sizeof(test_result));
+                _exit(written == sizeof(test_result) ? 0 : 1);
+            }
+            close(fds[1]);
+            children[running].pid = pid;
+            children[running].fd = fds[0];
+            children[running].test = i;
+            children[running].start = platform_time();
+            running += 1;
+        }
+        for (u32 c = 0; c < running;) {
+            i32 status;
+            if (waitpid(children[c].pid, &status, WNOHANG) == children[c].pid) {
+                finish_child(&children[c], FALSE, status);
+            } else if (timeout > 0 && platform_time() - children[c].start > timeout) {
+                kill(children[c].pid, SIGKILL);
+                waitpid(children[c].pid, &status, 0);
+                finish_child(&children[c], TRUE, status);
+            } else {
+                c += 1;
+                continue;
+            }
+            children[c] = children[--running];
+        }
+        usleep(1000);
+    }
+    free(children);
+}
+#endif
+
+//    ██████  ███████ ██████   ██████  ██████  ████████
+//    ██   ██ ██      ██   ██ ██    ██ ██   ██    ██
+//    ██████  █████   ██████  ██    ██ ██████     ██
+//    ██   ██ ██      ██      ██    ██ ██   ██    ██
+//    ██   ██ ███████ ██       ██████  ██   ██    ██
+//
+//
+
+static void write_json_string(FILE* file, const char* str) {
+    fputc('"', file);
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+static void write_json(const char* path, f64 total_time) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOGE("test_manager: unable to open %s", path);
+        return;
+    }
+    fprintf(file, "{\n  \"total_time\": %.9f,\n  \"tests\": [\n", total_time);
+    bool first = TRUE;
+    for (u64 i = 0; i < idx; ++i) {
+        test_result* r = &results[i];
+        if (!r->selected) {
+            continue;
+        }
+        fprintf(file, "%s    {\"name\": ", first ? "" : ",\n");
+        first = FALSE;
+        write_json_string(file, tests[i].name);
+        fprintf(file, ", \"passed\": %s, \"iterations\": %u, ", r->passed ? "true" : "false", r->iterations);
+        fprintf(file, "\"time\": {\"mean\": %.9f, \"stddev\": %.9f, \"min\": %.9f, \"max\": %.9f}, ", r->mean, r->stddev, r->min, r->max);
+        fprintf(file, "\"bytes_allocated\": %llu, \"allocations\": %llu, \"peak_memory\": %llu, \"tracked_peak\": %llu, ",
+                r->bytes_allocated, r->allocations, r->peak_memory, r->tracked_peak);
+        fprintf(file, "\"leaked_bytes\": %llu, \"leaked_allocations\": %llu, \"over_budget\": %s, \"exact_accounting\": %s}",
+                r->leaked_bytes, r->leaked_allocations, r->over_budget ? "true" : "false", r->exact_accounting ? "true" : "false");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+}
+
+#define CSV_HEADER "name,passed,iterations,mean,stddev,min,max,bytes_allocated,peak_memory,allocations,tracked_peak,leaked_bytes,leaked_allocations"
+
+static void write_csv(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOGE("test_manager: unable to open %s", path);
+        return;
+    }
+    fprintf(file, CSV_HEADER "\n");
+    for (u64 i = 0; i < idx; ++i) {
+        test_result* r = &results[i];
+        if (!r->selected) {
+            continue;
+        }
+        fprintf(file, "%s,%u,%u,%.9f,%.9f,%.9f,%.9f,%llu,%llu,%llu,%llu,%llu,%llu\n", tests[i].name, r->passed ? 1 : 0, r->iterations,
+                r->mean, r->stddev, r->min, r->max, r->bytes_allocated, r->peak_memory, r->allocations, r->tracked_peak,
+                r->leaked_bytes, r->leaked_allocations);
+    }
+    fclose(file);
+}
+
+//    ██████   █████  ███████ ███████ ██      ██ ███    ██ ███████
+//    ██   ██ ██   ██ ██      ██      ██      ██ ████   ██ ██
+//    ██████  ███████ ███████ █████   ██      ██ ██ ██  ██ █████
+//    ██   ██ ██   ██      ██ ██      ██      ██ ██  ██ ██ ██
+//    ██████  ██   ██ ███████ ███████ ███████ ██ ██   ████ ███████
+//
+//
+
+// loads a csv written by --csv, FALSE when the file cannot be read or holds no entries
+static bool load_baseline(const char* path, baseline_entry** entries, u64* entry_count) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        LOGE("test_manager: unable to open baseline %s", path);
+        return FALSE;
+    }
+    u64 capacity = 64;
+    u64 count = 0;
+    baseline_entry* list = (baseline_entry*)malloc(sizeof(baseline_entry) * capacity);
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        baseline_entry entry;
+        u32 passed;
+        entry.result.allocations = 0;
+        // files from before allocation counting stop after peak_memory
+        if (sscanf(line, "%127[^,],%u,%u,%lf,%lf,%lf,%lf,%llu,%llu,%llu", entry.name, &passed, &entry.result.iterations,
+                   &entry.result.mean, &entry.result.stddev, &entry.result.min, &entry.result.max,
+                   &entry.result.bytes_allocated, &entry.result.peak_memory, &entry.result.allocations) < 9) {
+            // header or malformed line
+            continue;
+        }
+        entry.result.passed = passed != 0;
+        if (count == capacity) {
+            capacity *= 2;
+            list = (baseline_entry*)realloc(list, sizeof(baseline_entry) * capacity);
+        }
+        list[count++] = entry;
+    }
+    bool read_failed = ferror(file) != 0;
+    fclose(file);
+    if (read_failed || !count) {
+        LOGE("test_manager: unable to read baseline %s", path);
+        free(list);
+        return FALSE;
+    }
+    *entries = list;
+    *entry_count = count;
+    return TRUE;
+}
+
+static bool is_time_regression(test_result* base, test_result* current) {
+    if (current->mean <= base->mean * (1.0 + regression_threshold)) {
+        return FALSE;
+    }
+    // with a single sample on either side there is no variance estimate, fall back to the threshold alone
+    if (base->iterations < 2 || current->iterations < 2) {
+        return TRUE;
+    }
+    f64 error = base->stddev * base->stddev / base->iterations + current->stddev * current->stddev / current->iterations;
+    if (error <= 0) {
+        return TRUE;
+    }
+    // welch's t statistic
+    return (current->mean - base->mean) / sqrt(error) > REGRESSION_T_SCORE;
+}
+
+// counts the regressions against the baseline at path, FALSE when it cannot be loaded
+static bool compare_baseline(const char* path, u32* regression_count) {
+    baseline_entry* entries = 0;
+    u64 count = 0;
+    if (!load_baseline(path, &entries, &count)) {
+        return FALSE;
+    }
+    u32 regressions = 0;
+    for (u64 i = 0; i < idx; ++i) {
+        test_result* current = &results[i];
+        baseline_entry* base = 0;
+        for (u64 j = 0; j < count; ++j) {
+            if (strcmp(entries[j].name, tests[i].name) == 0) {
+                base = &entries[j];
+                break;
+            }
+        }
+        if (!base || !base->result.passed || !current->selected || !current->passed) {
+            continue;
+        }
+        if (is_time_regression(&base->result, current)) {
+            regressions += 1;
+            LOGE("regression : name = %s ,time %lf -> %lf", tests[i].name, base->result.mean, current->mean);
+        }
+        if (current->bytes_allocated > base->result.bytes_allocated * (1.0 + regression_threshold)) {
+            regressions += 1;
+            LOGE("regression : name = %s ,bytes_allocated %llu -> %llu", tests[i].name, base->result.bytes_allocated, current->bytes_allocated);
+        }
+        if (base->result.allocations && current->allocations > base->result.allocations * (1.0 + regression_threshold)) {
+            regressions += 1;
+            LOGE("regression : name = %s ,allocations %llu -> %llu", tests[i].name, base->result.allocations, current->allocations);
+        }
+    }
+    free(entries);
+    *regression_count = regressions;
+    return TRUE;
+}
+
+u32 test_manager_run() {
     u32 passed = 0;
     u32 failed = 0;
+    u32 regressions = 0;
+    bool baseline_loaded = TRUE;
     clock total;
-    clock clk;
 
-    clock_set(&total);
+    u64* selected = (u64*)malloc(sizeof(u64) * (idx ? idx : 1));
+    u64 selected_count = 0;
     for (u64 i = 0; i < idx; ++i) {
-        clock_set(&clk);
-        u32 result = tests[i].function();
-        clock_update(&clk);
-        if (result == TRUE) {
+        results[i].selected = is_selected(tests[i].name);
+        if (results[i].selected) {
+            selected[selected_count++] = i;
+        }
+    }
+
+    clock_set(&total);
+    if (use_fork) {
+#ifdef PLATFORM_LINUX
+        run_forked(selected, selected_count);
+#else
+        LOGW("test_manager: --fork is not supported on this platform, using threads");
+        run_threaded(selected, selected_count);
+#endif
+    } else if (jobs > 1) {
+        run_threaded(selected, selected_count);
+    } else {
+        for (u64 i = 0; i < selected_count; ++i) {
+            run_test(&tests[selected[i]], &results[selected[i]]);
+            report_result(selected[i]);
+        }
+    }
+    clock_update(&total);
+
+    for (u64 i = 0; i < selected_count; ++i) {
+        if (results[selected[i]].passed) {
             passed += 1;
-            LOGT("passed : name = %s ,time_taken: %lf", tests[i].name, clk.elapsed);
         } else {
             failed += 1;
-            LOGE("failed : name = %s", tests[i].name);
         }
     }
-    clock_update(&total);
+    free(selected);
+
+    if (json_path) {
+        write_json(json_path, total.elapsed);
+    }
+    if (csv_path) {
+        write_csv(csv_path);
+    }
+    if (baseline_path) {
+        baseline_loaded = compare_baseline(baseline_path, &regressions);
+    }
+
     PRINT_TIME("test_manager_run_time_taken ", total.elapsed);
-    LOGD("total_tests = %u", idx);
+    LOGD("total_tests = %u", selected_count);
     LOGD("passed = %u", passed);
     LOGD("failed = %u", failed);
+    if (baseline_path) {
+        LOGD("regressions = %u", regressions);
+    }
+    return failed == 0 && regressions == 0 && baseline_loaded;
 }
@@ -21,12 +21,32 @@
         return FALSE;                                                                    \
     }
 
+// no_of_tests is the initial capacity, registration grows past it as needed
 void test_manager_init(u64 no_of_tests);
 
+// --iterations=N     run every test N times and report timing statistics
+// --json=path        write results as json
+// --csv=path         write results as csv (the format --baseline reads back)
+// --baseline=path    compare against a csv from an earlier run and fail on regressions
+// --threshold=x      relative slowdown tolerated before a regression is reported (default 0.10)
+// --filter=a*,b?     only run tests whose name matches one of the comma separated globs
+// --exclude=a*,b?    skip tests whose name matches one of the comma separated globs
+// --jobs=N           run N tests concurrently on a thread pool (0 uses every processor)
+// --fork             run each test in its own child process, up to --jobs at a time (linux only)
+// --timeout=secs     fail tests that run longer than secs, forked tests are killed
+void test_manager_parse_args(i32 argc, char** argv);
+
 void test_manager_add(u32 (*function)(), char* name);
 
+// registers a test that fails when an iteration allocates more than max_bytes or makes more
+// than max_allocations allocations through the tracker (0 leaves that limit off).
+// budgeted tests never overlap with other tests so their counters stay exact under --jobs
+void test_manager_add_budget(u32 (*function)(), char* name, u64 max_bytes, u64 max_allocations);
+
 void test_manager_shutdown();
 
-void test_manager_run();
+// returns TRUE when every test passed and no regression against the baseline was found.
+// a --baseline that cannot be loaded fails the run
+u32 test_manager_run();
 
 #endif
\ No newline at end of file
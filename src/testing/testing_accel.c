@@ -0,0 +1,1389 @@
+// the accel headers pull in immintrin.h, which declares malloc and free, so they go before memory.h
+#include "bvh.h"
+#include "bvh8.h"
+#include "lbvh.h"
+#include "tlas.h"
+#include "bvh_refit.h"
+#include "geometry_cache.h"
+#include "rng.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "clock.h"
+#include "test_manager.h"
+#include "memory.h"
+#include "zpool.h"
+#include "platform.h"
+#include "logger.h"
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+typedef struct test_mesh {
+    point3* positions;
+    u32* indices;
+    u32 triangle_count;
+} test_mesh;
+
+// small random triangles scattered through a cube, size controls their extent
+static void soup_create(test_mesh* mesh, u32 triangle_count, f32 size, u64 seed) {
+    rng r;
+    rng_seed(&r, seed, 0);
+    mesh->triangle_count = triangle_count;
+    mesh->positions = (point3*)memory_allocate(sizeof(point3) * triangle_count * 3);
+    mesh->indices = (u32*)memory_allocate(sizeof(u32) * triangle_count * 3);
+    for (u32 t = 0; t < triangle_count; ++t) {
+        f32 cx = rng_f32(&r) * 100 - 50;
+        f32 cy = rng_f32(&r) * 100 - 50;
+        f32 cz = rng_f32(&r) * 100 - 50;
+        for (u32 v = 0; v < 3; ++v) {
+            f32 x = cx + (rng_f32(&r) - 0.5f) * size;
+            f32 y = cy + (rng_f32(&r) - 0.5f) * size;
+            f32 z = cz + (rng_f32(&r) - 0.5f) * size;
+            mesh->positions[t * 3 + v] = vec3_make(x, y, z);
+            mesh->indices[t * 3 + v] = t * 3 + v;
+        }
+    }
+}
+
+static void soup_destroy(test_mesh* mesh) {
+    memory_free(mesh->positions);
+    memory_free(mesh->indices);
+}
+
+static bool bounds_contains(const bounds3* outer, const bounds3* inner) {
+    return bounds3_inside(outer, inner->min) && bounds3_inside(outer, inner->max);
+}
+
+// every primitive referenced exactly once, children inside their parents, leaves cover their triangles
+static bool bvh_validate(const bvh* b, const test_mesh* mesh) {
+    u32* seen = (u32*)memory_allocate(sizeof(u32) * mesh->triangle_count);
+    for (u32 i = 0; i < mesh->triangle_count; ++i) {
+        seen[i] = 0;
+    }
+    bool valid = b->node_count == 2 * b->stats.leaf_count - 1;
+    u32 leaf_prims = 0;
+    for (u32 n = 0; n < b->node_count && valid; ++n) {
+        const bvh_node* node = &b->nodes[n];
+        bounds3 nb = bvh_node_bounds(node);
+        if (node->prim_count) {
+            leaf_prims += node->prim_count;
+            for (u32 i = 0; i < node->prim_count; ++i) {
+                u32 prim = b->prim_indices[node->offset + i];
+                seen[prim] += 1;
+                for (u32 v = 0; v < 3; ++v) {
+                    valid = valid && bounds3_inside(&nb, mesh->positions[mesh->indices[prim * 3 + v]]);
+                }
+            }
+        } else {
+            valid = valid && node->offset < b->node_count && (node->offset & 1) == 1;
+            bounds3 left = bvh_node_bounds(&b->nodes[node->offset]);
+            bounds3 right = bvh_node_bounds(&b->nodes[node->offset + 1]);
+            valid = valid && bounds_contains(&nb, &left) && bounds_contains(&nb, &right);
+        }
+    }
+    for (u32 i = 0; i < mesh->triangle_count; ++i) {
+        valid = valid && seen[i] == 1;
+    }
+    memory_free(seen);
+    return valid && leaf_prims == mesh->triangle_count;
+}
+
+// ============================================================================
+// BVH TESTS
+// ============================================================================
+
+u32 test_bvh_build_structure() {
+    test_mesh mesh;
+    soup_create(&mesh, 5000, 2, 1);
+    bvh b;
+    bvh_build_triangles(&b, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    EXPECTED_TO_BE(TRUE, bvh_validate(&b, &mesh));
+    EXPECTED_TO_BE(TRUE, (b.stats.max_depth < 64));
+    EXPECTED_TO_BE(TRUE, (b.stats.max_leaf_prims <= 4));
+    EXPECTED_TO_BE(TRUE, (b.stats.sah_cost > 1.0f));
+    // a sah tree over a uniform soup is far cheaper than testing everything
+    EXPECTED_TO_BE(TRUE, (b.stats.sah_cost < 0.01f * mesh.triangle_count));
+    bvh_destroy(&b);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_bvh_parallel_build_matches_serial() {
+    test_mesh mesh;
+    // large enough for parallel binning at the root and many concurrent subtrees
+    soup_create(&mesh, 150000, 1, 2);
+    zpool pool;
+    zpool_create(&pool, 3);
+    bvh serial, parallel;
+    bvh_build_triangles(&serial, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh_build_triangles(&parallel, mesh.positions, mesh.indices, mesh.triangle_count, 0, &pool);
+    zpool_destroy(&pool);
+
+    EXPECTED_TO_BE(TRUE, bvh_validate(&parallel, &mesh));
+    // same splits, only the node order differs
+    EXPECTED_TO_BE(serial.node_count, parallel.node_count);
+    EXPECTED_TO_BE(serial.stats.leaf_count, parallel.stats.leaf_count);
+    EXPECTED_TO_BE(serial.stats.max_depth, parallel.stats.max_depth);
+    EXPECTED_FLOAT_TO_BE(serial.stats.sah_cost, parallel.stats.sah_cost, 1e-3f * serial.stats.sah_cost);
+    bvh_destroy(&serial);
+    bvh_destroy(&parallel);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_bvh_intersect_matches_brute_force() {
+    test_mesh mesh;
+    soup_create(&mesh, 2000, 6, 3);
+    bvh b;
+    bvh_build_triangles(&b, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+
+    rng r;
+
+    rng_seed(&r, 99, 0);
+    u32 hits = 0;
+    for (u32 i = 0; i < 500; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70, -80);
+        point3 target = vec3_make(rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50);
+        ray r = ray_make(o, vec3_sub(target, o));
+
+        f32 t_max = MAX_F32;
+        u32 expected_prim = 0xffffffff;
+        for (u32 t = 0; t < mesh.triangle_count; ++t) {
+            const u32* tri = mesh.indices + t * 3;
+            triangle_hit th;
+            if (triangle_intersect(&r, t_max, mesh.positions[tri[0]], mesh.positions[tri[1]], mesh.positions[tri[2]], &th)) {
+                t_max = th.t;
+                expected_prim = t;
+            }
+        }
+        bvh_hit hit;
+        bool found = bvh_intersect_triangles(&b, mesh.positions, mesh.indices, &r, MAX_F32, &hit);
+        EXPECTED_TO_BE((expected_prim != 0xffffffff), found);
+        if (found) {
+            EXPECTED_TO_BE(expected_prim, hit.prim_id);
+            EXPECTED_FLOAT_TO_BE(t_max, hit.triangle.t, 0.0f);
+            hits += 1;
+        }
+    }
+    EXPECTED_TO_BE(TRUE, (hits > 50));
+    bvh_destroy(&b);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_bvh_degenerate_inputs() {
+    bvh b;
+    bvh_build_triangles(&b, 0, 0, 0, 0, 0);
+    EXPECTED_TO_BE(0, b.node_count);
+    ray r = ray_make(vec3_make(0, 0, -5), vec3_make(0, 0, 1));
+    bvh_hit hit;
+    EXPECTED_TO_BE(FALSE, bvh_intersect_triangles(&b, 0, 0, &r, MAX_F32, &hit));
+    bvh_destroy(&b);
+
+    // many copies of one triangle have coincident centroids, the builder splits them by index
+    test_mesh mesh;
+    mesh.triangle_count = 1000;
+    mesh.positions = (point3*)memory_allocate(sizeof(point3) * 3);
+    mesh.indices = (u32*)memory_allocate(sizeof(u32) * 3 * mesh.triangle_count);
+    mesh.positions[0] = vec3_make(-1, -1, 0);
+    mesh.positions[1] = vec3_make(1, -1, 0);
+    mesh.positions[2] = vec3_make(0, 1, 0);
+    for (u32 i = 0; i < 3 * mesh.triangle_count; ++i) {
+        mesh.indices[i] = i % 3;
+    }
+    bvh_build_triangles(&b, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    EXPECTED_TO_BE(TRUE, (b.stats.max_depth < 64));
+    EXPECTED_TO_BE(TRUE, (b.stats.max_leaf_prims <= 4));
+    EXPECTED_TO_BE(TRUE, bvh_intersect_triangles(&b, mesh.positions, mesh.indices, &r, MAX_F32, &hit));
+    EXPECTED_FLOAT_TO_BE(5.0f, hit.triangle.t, 1e-5f);
+    bvh_destroy(&b);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// a dense cluster with single triangles strung out along the axes at doubling distances:
+// every split near the root peels off one outlier, each deferred as its own subtree, far
+// more of them than a balanced tree defers
+u32 test_bvh_skewed_parallel_build() {
+    test_mesh mesh;
+    soup_create(&mesh, 1u << 18, 0.1f, 6);
+    const u32 outliers = 40;
+    for (u32 axis = 0; axis < 3; ++axis) {
+        for (u32 k = 0; k < outliers; ++k) {
+            u32 t = axis * outliers + k;
+            f32 distance = 100.0f * (f32)(1ull << (k + 1));
+            for (u32 v = 0; v < 3; ++v) {
+                point3 p = mesh.positions[t * 3 + v];
+                p.e[axis] += distance;
+                mesh.positions[t * 3 + v] = p;
+            }
+        }
+    }
+    zpool pool;
+    zpool_create(&pool, 1);
+    bvh serial, parallel;
+    bvh_build_triangles(&serial, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh_build_triangles(&parallel, mesh.positions, mesh.indices, mesh.triangle_count, 0, &pool);
+    zpool_destroy(&pool);
+    EXPECTED_TO_BE(TRUE, bvh_validate(&parallel, &mesh));
+    EXPECTED_TO_BE(serial.node_count, parallel.node_count);
+    EXPECTED_TO_BE(serial.stats.max_depth, parallel.stats.max_depth);
+    bvh_destroy(&serial);
+    bvh_destroy(&parallel);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_bvh_mesh_matches_indexed() {
+    test_mesh soup;
+    soup_create(&soup, 3000, 4, 27);
+    mesh_desc desc = {soup.triangle_count * 3, soup.triangle_count, soup.positions, 0, 0, soup.indices, TRUE};
+    mesh m;
+    mesh_create(&m, &desc);
+    bvh indexed, compact;
+    bvh_build_triangles(&indexed, soup.positions, soup.indices, soup.triangle_count, 0, 0);
+    bvh_build_mesh(&compact, &m, 0, 0);
+    // same bounds in, same tree out
+    EXPECTED_TO_BE(indexed.node_count, compact.node_count);
+    EXPECTED_TO_BE(0, memcmp(indexed.nodes, compact.nodes, sizeof(bvh_node) * indexed.node_count));
+
+    rng r;
+
+    rng_seed(&r, 28, 0);
+    for (u32 i = 0; i < 500; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70, -80);
+        point3 target = vec3_make(rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50);
+        ray r = ray_make(o, vec3_sub(target, o));
+        bvh_hit expected, obtained;
+        bool expected_found = bvh_intersect_triangles(&indexed, soup.positions, soup.indices, &r, MAX_F32, &expected);
+        bool found = bvh_intersect_mesh(&compact, &m, &r, MAX_F32, &obtained);
+        EXPECTED_TO_BE(expected_found, found);
+        if (found) {
+            EXPECTED_TO_BE(expected.prim_id, obtained.prim_id);
+            EXPECTED_FLOAT_TO_BE(expected.triangle.t, obtained.triangle.t, 0.0f);
+        }
+    }
+    bvh_destroy(&indexed);
+    bvh_destroy(&compact);
+    mesh_destroy(&m);
+    soup_destroy(&soup);
+    return TRUE;
+}
+
+// build throughput, run a release build with --filter=accel_bench_* for meaningful numbers
+u32 test_accel_bench_bvh_build() {
+    test_mesh mesh;
+    soup_create(&mesh, 200000, 1, 4);
+    zpool pool;
+    zpool_create(&pool, 0);
+    bvh serial, parallel;
+    bvh_build_triangles(&serial, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh_build_triangles(&parallel, mesh.positions, mesh.indices, mesh.triangle_count, 0, &pool);
+    // printed directly so the numbers survive release builds where LOGI compiles out
+    log_stdout("    bvh_build %u triangles: serial %.3fs (%.2f Mtri/s), %u threads %.3fs (%.2f Mtri/s), "
+               "sah %.2f, %u nodes, depth %u\n",
+               mesh.triangle_count,
+               serial.stats.build_seconds,
+               mesh.triangle_count / serial.stats.build_seconds * 1e-6,
+               zpool_thread_count(&pool),
+               parallel.stats.build_seconds,
+               mesh.triangle_count / parallel.stats.build_seconds * 1e-6,
+               parallel.stats.sah_cost,
+               parallel.stats.node_count,
+               parallel.stats.max_depth);
+    zpool_destroy(&pool);
+    EXPECTED_TO_BE(serial.node_count, parallel.node_count);
+    bvh_destroy(&serial);
+    bvh_destroy(&parallel);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// ============================================================================
+// OCCLUSION TESTS
+// ============================================================================
+
+// shadow ray like segments: from origins spread over the soup, or packed into a small
+// patch, to targets around one point, blocked unless they reach t_max = 1
+static void shadow_rays_create(ray* rays, f32* t_max, u32 count, f32 spread, u64 seed) {
+    rng r;
+    rng_seed(&r, seed, 0);
+    for (u32 i = 0; i < count; ++i) {
+        point3 o = vec3_make(rng_range(&r, -spread, spread), rng_range(&r, -spread, spread), rng_range(&r, -spread, spread));
+        point3 target = vec3_make(rng_range(&r, -2, 2), 70 + rng_range(&r, -2, 2), rng_range(&r, -2, 2));
+        rays[i] = ray_make(o, vec3_sub(target, o));
+        t_max[i] = rng_range(&r, 0.2f, 1.0f);
+    }
+}
+
+u32 test_bvh_occluded_matches_intersect() {
+    const u32 count = 2000;
+    test_mesh soup;
+    soup_create(&soup, 3000, 4, 41);
+    mesh_desc desc = {soup.triangle_count * 3, soup.triangle_count, soup.positions, 0, 0, soup.indices, TRUE};
+    mesh m;
+    mesh_create(&m, &desc);
+    bvh b, compact;
+    bvh_build_triangles(&b, soup.positions, soup.indices, soup.triangle_count, 0, 0);
+    bvh_build_mesh(&compact, &m, 0, 0);
+    ray* rays = (ray*)memory_allocate(sizeof(ray) * count);
+    f32* t_max = (f32*)memory_allocate(sizeof(f32) * count);
+    bool* occluded = (bool*)memory_allocate(sizeof(bool) * count);
+    for (u32 set = 0; set < 2; ++set) {
+        shadow_rays_create(rays, t_max, count, set ? 3 : 60, 42 + set);
+        bvh_occluded_triangles_batch(&b, soup.positions, soup.indices, rays, t_max, count, occluded);
+        u32 blocked = 0;
+        for (u32 i = 0; i < count; ++i) {
+            bvh_hit hit;
+            bool expected = bvh_intersect_triangles(&b, soup.positions, soup.indices, &rays[i], t_max[i], &hit);
+            EXPECTED_TO_BE(expected, bvh_occluded_triangles(&b, soup.positions, soup.indices, &rays[i], t_max[i]));
+            EXPECTED_TO_BE(expected, bvh_occluded_mesh(&compact, &m, &rays[i], t_max[i]));
+            EXPECTED_TO_BE(expected, occluded[i]);
+            blocked += expected;
+        }
+        // both outcomes are well represented
+        EXPECTED_TO_BE(TRUE, (blocked > count / 20 && blocked < count - count / 20));
+    }
+    // batches of any length, down to none
+    bvh_occluded_triangles_batch(&b, soup.positions, soup.indices, rays, t_max, 13, occluded);
+    for (u32 i = 0; i < 13; ++i) {
+        EXPECTED_TO_BE(bvh_occluded_triangles(&b, soup.positions, soup.indices, &rays[i], t_max[i]), occluded[i]);
+    }
+    bvh_occluded_triangles_batch(&b, soup.positions, soup.indices, rays, t_max, 0, occluded);
+    bvh empty;
+    bvh_build_triangles(&empty, 0, 0, 0, 0, 0);
+    EXPECTED_TO_BE(FALSE, bvh_occluded_triangles(&empty, 0, 0, &rays[0], 1));
+    bvh_destroy(&empty);
+
+    memory_free(occluded);
+    memory_free(t_max);
+    memory_free(rays);
+    bvh_destroy(&compact);
+    bvh_destroy(&b);
+    mesh_destroy(&m);
+    soup_destroy(&soup);
+    return TRUE;
+}
+
+// closest hit traversal answering occlusion against the any hit traversal and the packet
+// batch, for shadow rays from all over the soup and from one small patch
+u32 test_accel_bench_occlusion() {
+    const u32 count = 200000;
+    test_mesh soup;
+    soup_create(&soup, 200000, 1, 8);
+    bvh b;
+    bvh_build_triangles(&b, soup.positions, soup.indices, soup.triangle_count, 0, 0);
+    ray* rays = (ray*)memory_allocate(sizeof(ray) * count);
+    f32* t_max = (f32*)memory_allocate(sizeof(f32) * count);
+    bool* occluded = (bool*)memory_allocate(sizeof(bool) * count);
+    for (u32 set = 0; set < 2; ++set) {
+        shadow_rays_create(rays, t_max, count, set ? 3 : 60, 9 + set);
+        clock clk;
+        bvh_hit hit;
+        u32 closest_blocked = 0, any_blocked = 0, batch_blocked = 0;
+        clock_set(&clk);
+        for (u32 i = 0; i < count; ++i) {
+            closest_blocked += bvh_intersect_triangles(&b, soup.positions, soup.indices, &rays[i], t_max[i], &hit);
+        }
+        clock_update(&clk);
+        f64 closest_seconds = clk.elapsed;
+        clock_set(&clk);
+        for (u32 i = 0; i < count; ++i) {
+            any_blocked += bvh_occluded_triangles(&b, soup.positions, soup.indices, &rays[i], t_max[i]);
+        }
+        clock_update(&clk);
+        f64 any_seconds = clk.elapsed;
+        clock_set(&clk);
+        bvh_occluded_triangles_batch(&b, soup.positions, soup.indices, rays, t_max, count, occluded);
+        clock_update(&clk);
+        f64 batch_seconds = clk.elapsed;
+        for (u32 i = 0; i < count; ++i) {
+            batch_blocked += occluded[i];
+        }
+        log_stdout("    occlusion %u %s shadow rays (%.0f%% blocked): closest hit %.2f Mrays/s, any hit %.2f Mrays/s (%.2fx), "
+                   "batch %.2f Mrays/s (%.2fx)\n",
+                   count,
+                   set ? "coherent" : "scattered",
+                   100.0 * any_blocked / count,
+                   count / closest_seconds * 1e-6,
+                   count / any_seconds * 1e-6,
+                   closest_seconds / any_seconds,
+                   count / batch_seconds * 1e-6,
+                   closest_seconds / batch_seconds);
+        EXPECTED_TO_BE(closest_blocked, any_blocked);
+        EXPECTED_TO_BE(closest_blocked, batch_blocked);
+    }
+    memory_free(occluded);
+    memory_free(t_max);
+    memory_free(rays);
+    bvh_destroy(&b);
+    soup_destroy(&soup);
+    return TRUE;
+}
+
+// ============================================================================
+// BVH8 TESTS
+// ============================================================================
+
+// every wide child covers the binary subtree it replaced, checked through the leaves
+static bool bvh8_validate(const bvh8* wide, const bvh* binary, const test_mesh* mesh) {
+    u32 leaf_prims = 0;
+    bool valid = TRUE;
+    for (u32 n = 0; n < wide->node_count && valid; ++n) {
+        const bvh8_node* node = &wide->nodes[n];
+        valid = node->child_count >= 1 && node->child_count <= BVH8_WIDTH;
+        for (u32 k = 0; k < node->child_count && valid; ++k) {
+            bounds3 cb = bvh8_child_bounds(node, k);
+            if (node->prim_count[k]) {
+                leaf_prims += node->prim_count[k];
+                for (u32 i = 0; i < node->prim_count[k]; ++i) {
+                    u32 prim = wide->prim_indices[node->child[k] + i];
+                    for (u32 v = 0; v < 3; ++v) {
+                        valid = valid && bounds3_inside(&cb, mesh->positions[mesh->indices[prim * 3 + v]]);
+                    }
+                }
+            } else {
+                valid = valid && node->child[k] > n && node->child[k] < wide->node_count;
+            }
+        }
+    }
+    return valid && leaf_prims == binary->prim_count;
+}
+
+u32 test_bvh8_collapse_structure() {
+    STATIC_ASSERT(sizeof(bvh8_node) == 128);
+    test_mesh mesh;
+    soup_create(&mesh, 5000, 2, 5);
+    bvh binary;
+    bvh_build_triangles(&binary, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh8 wide;
+    bvh8_build(&wide, &binary);
+    u64 node_address = (u64)wide.nodes;
+    EXPECTED_TO_BE(0, (node_address & 63));
+    EXPECTED_TO_BE(TRUE, bvh8_validate(&wide, &binary, &mesh));
+    // nodes above the leaves run out of interior children to open before reaching 8
+    EXPECTED_TO_BE(TRUE, (wide.average_fill > 3.5f));
+    EXPECTED_TO_BE(TRUE, (wide.node_count < binary.node_count / 4));
+    bvh8_destroy(&wide);
+    bvh_destroy(&binary);
+
+    // a single leaf root becomes a node with one leaf child
+    bvh_build_triangles(&binary, mesh.positions, mesh.indices, 1, 0, 0);
+    bvh8_build(&wide, &binary);
+    EXPECTED_TO_BE(1, wide.node_count);
+    EXPECTED_TO_BE(1, wide.nodes[0].child_count);
+    EXPECTED_TO_BE(1, wide.nodes[0].prim_count[0]);
+    bvh8_destroy(&wide);
+    bvh_destroy(&binary);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_bvh8_intersect_matches_binary() {
+    test_mesh mesh;
+    soup_create(&mesh, 20000, 3, 6);
+    bvh binary;
+    bvh_build_triangles(&binary, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh8 wide;
+    bvh8_build(&wide, &binary);
+
+    rng r;
+
+    rng_seed(&r, 77, 0);
+    u32 hits = 0;
+    for (u32 i = 0; i < 2000; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70);
+        point3 target = vec3_make(rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50);
+        vec3 d = vec3_sub(target, o);
+        // every eighth ray is axis aligned, which exercises the clamped reciprocal
+        if ((i & 7) == 0) {
+            d = vec3_make(0, 0, d.z < 0 ? -1.0f : 1.0f);
+        }
+        ray r = ray_make(o, d);
+        bvh_hit expected, obtained;
+        bool expected_found = bvh_intersect_triangles(&binary, mesh.positions, mesh.indices, &r, MAX_F32, &expected);
+        bool found = bvh8_intersect_triangles(&wide, mesh.positions, mesh.indices, &r, MAX_F32, &obtained);
+        EXPECTED_TO_BE(expected_found, found);
+        if (found) {
+            EXPECTED_TO_BE(expected.prim_id, obtained.prim_id);
+            EXPECTED_FLOAT_TO_BE(expected.triangle.t, obtained.triangle.t, 0.0f);
+            hits += 1;
+        }
+    }
+    EXPECTED_TO_BE(TRUE, (hits > 200));
+    bvh8_destroy(&wide);
+    bvh_destroy(&binary);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// closest hit throughput of the binary and the wide tree on the same rays
+u32 test_accel_bench_bvh8_traversal() {
+    const u32 ray_count = 200000;
+    test_mesh mesh;
+    soup_create(&mesh, 200000, 1, 8);
+    bvh binary;
+    bvh_build_triangles(&binary, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh8 wide;
+    bvh8_build(&wide, &binary);
+
+    ray* rays = (ray*)memory_allocate(sizeof(ray) * ray_count);
+    rng r;
+    rng_seed(&r, 123, 0);
+    for (u32 i = 0; i < ray_count; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70);
+        point3 target = vec3_make(rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50);
+        rays[i] = ray_make(o, vec3_sub(target, o));
+    }
+
+    clock clk;
+    bvh_hit hit;
+    u32 binary_hits = 0, wide_hits = 0;
+    clock_set(&clk);
+    for (u32 i = 0; i < ray_count; ++i) {
+        binary_hits += bvh_intersect_triangles(&binary, mesh.positions, mesh.indices, &rays[i], MAX_F32, &hit);
+    }
+    clock_update(&clk);
+    f64 binary_seconds = clk.elapsed;
+    clock_set(&clk);
+    for (u32 i = 0; i < ray_count; ++i) {
+        wide_hits += bvh8_intersect_triangles(&wide, mesh.positions, mesh.indices, &rays[i], MAX_F32, &hit);
+    }
+    clock_update(&clk);
+    f64 wide_seconds = clk.elapsed;
+
+    log_stdout("    bvh traversal %u rays, %u triangles: binary %.2f Mrays/s (%u nodes), "
+               "bvh8 %.2f Mrays/s (%u nodes, fill %.2f), speedup %.2fx\n",
+               ray_count,
+               mesh.triangle_count,
+               ray_count / binary_seconds * 1e-6,
+               binary.node_count,
+               ray_count / wide_seconds * 1e-6,
+               wide.node_count,
+               wide.average_fill,
+               binary_seconds / wide_seconds);
+    EXPECTED_TO_BE(binary_hits, wide_hits);
+    memory_free(rays);
+    bvh8_destroy(&wide);
+    bvh_destroy(&binary);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// ============================================================================
+// LBVH TESTS
+// ============================================================================
+
+u32 test_lbvh_build_structure() {
+    test_mesh mesh;
+    soup_create(&mesh, 5000, 2, 9);
+    lbvh_build_options options;
+    lbvh_build_options_default(&options);
+    u32 bits[2] = {30, 63};
+    for (u32 i = 0; i < 2; ++i) {
+        options.morton_bits = bits[i];
+        bvh b;
+        lbvh_build_triangles(&b, mesh.positions, mesh.indices, mesh.triangle_count, &options, 0);
+        EXPECTED_TO_BE(2 * mesh.triangle_count - 1, b.node_count);
+        EXPECTED_TO_BE(TRUE, bvh_validate(&b, &mesh));
+        EXPECTED_TO_BE(1, b.stats.max_leaf_prims);
+        EXPECTED_TO_BE(TRUE, (b.stats.max_depth < 64));
+        bvh_destroy(&b);
+    }
+
+    // a single primitive is a leaf root
+    bvh b;
+    lbvh_build_triangles(&b, mesh.positions, mesh.indices, 1, 0, 0);
+    EXPECTED_TO_BE(1, b.node_count);
+    EXPECTED_TO_BE(1, b.nodes[0].prim_count);
+    bvh_destroy(&b);
+    lbvh_build_triangles(&b, 0, 0, 0, 0, 0);
+    EXPECTED_TO_BE(0, b.node_count);
+    bvh_destroy(&b);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_lbvh_parallel_build_matches_serial() {
+    test_mesh mesh;
+    soup_create(&mesh, 150000, 1, 10);
+    lbvh_build_options options;
+    lbvh_build_options_default(&options);
+    options.morton_bits = 63;
+    options.rotation_passes = 2;
+    zpool pool;
+    zpool_create(&pool, 3);
+    bvh serial, parallel;
+    lbvh_build_triangles(&serial, mesh.positions, mesh.indices, mesh.triangle_count, &options, 0);
+    lbvh_build_triangles(&parallel, mesh.positions, mesh.indices, mesh.triangle_count, &options, &pool);
+    zpool_destroy(&pool);
+
+    EXPECTED_TO_BE(TRUE, bvh_validate(&parallel, &mesh));
+    // every step is deterministic, so the trees are identical down to the node order
+    EXPECTED_TO_BE(serial.node_count, parallel.node_count);
+    EXPECTED_TO_BE(0, memcmp(serial.nodes, parallel.nodes, sizeof(bvh_node) * serial.node_count));
+    EXPECTED_TO_BE(0, memcmp(serial.prim_indices, parallel.prim_indices, sizeof(u32) * serial.prim_count));
+    bvh_destroy(&serial);
+    bvh_destroy(&parallel);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_lbvh_rotations_reduce_sah() {
+    test_mesh mesh;
+    soup_create(&mesh, 20000, 2, 11);
+    lbvh_build_options options;
+    lbvh_build_options_default(&options);
+    bvh plain, rotated;
+    lbvh_build_triangles(&plain, mesh.positions, mesh.indices, mesh.triangle_count, &options, 0);
+    options.rotation_passes = 2;
+    lbvh_build_triangles(&rotated, mesh.positions, mesh.indices, mesh.triangle_count, &options, 0);
+    EXPECTED_TO_BE(TRUE, bvh_validate(&rotated, &mesh));
+    EXPECTED_TO_BE(TRUE, (rotated.stats.sah_cost < plain.stats.sah_cost));
+
+    // rotations only move subtrees, closest hits stay the same
+    rng r;
+    rng_seed(&r, 5, 0);
+    for (u32 i = 0; i < 500; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70, -80);
+        point3 target = vec3_make(rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50);
+        ray r = ray_make(o, vec3_sub(target, o));
+        bvh_hit expected, obtained;
+        bool expected_found = bvh_intersect_triangles(&plain, mesh.positions, mesh.indices, &r, MAX_F32, &expected);
+        bool found = bvh_intersect_triangles(&rotated, mesh.positions, mesh.indices, &r, MAX_F32, &obtained);
+        EXPECTED_TO_BE(expected_found, found);
+        if (found) {
+            EXPECTED_TO_BE(expected.prim_id, obtained.prim_id);
+        }
+    }
+    bvh_destroy(&plain);
+    bvh_destroy(&rotated);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_lbvh_duplicate_codes() {
+    // every copy lands in the same morton cell, the splits fall back to the sorted index
+    test_mesh mesh;
+    mesh.triangle_count = 1024;
+    mesh.positions = (point3*)memory_allocate(sizeof(point3) * 3);
+    mesh.indices = (u32*)memory_allocate(sizeof(u32) * 3 * mesh.triangle_count);
+    mesh.positions[0] = vec3_make(-1, -1, 0);
+    mesh.positions[1] = vec3_make(1, -1, 0);
+    mesh.positions[2] = vec3_make(0, 1, 0);
+    for (u32 i = 0; i < 3 * mesh.triangle_count; ++i) {
+        mesh.indices[i] = i % 3;
+    }
+    bvh b;
+    lbvh_build_triangles(&b, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    EXPECTED_TO_BE(TRUE, bvh_validate(&b, &mesh));
+    // a balanced tree over 1024 leaves, the root counts as depth 1
+    EXPECTED_TO_BE(11, b.stats.max_depth);
+    ray r = ray_make(vec3_make(0, 0, -5), vec3_make(0, 0, 1));
+    bvh_hit hit;
+    EXPECTED_TO_BE(TRUE, bvh_intersect_triangles(&b, mesh.positions, mesh.indices, &r, MAX_F32, &hit));
+    EXPECTED_FLOAT_TO_BE(5.0f, hit.triangle.t, 1e-5f);
+    bvh_destroy(&b);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_lbvh_builder_rebuilds_match_one_shot() {
+    test_mesh mesh;
+    soup_create(&mesh, 3000, 2, 13);
+    bounds3* bounds = (bounds3*)memory_allocate(sizeof(bounds3) * mesh.triangle_count);
+    lbvh_builder builder;
+    lbvh_builder_create(&builder);
+    // frames of a drifting mesh, the last one with fewer primitives than the builder holds
+    u32 counts[3] = {1000, 3000, 2000};
+    for (u32 frame = 0; frame < 3; ++frame) {
+        for (u32 i = 0; i < mesh.triangle_count * 3; ++i) {
+            mesh.positions[i] = vec3_add(mesh.positions[i], vec3_make(0.5f, 0, -0.25f));
+        }
+        for (u32 t = 0; t < counts[frame]; ++t) {
+            bounds[t] = bounds3_make(mesh.positions[3 * t], mesh.positions[3 * t + 1]);
+            bounds[t] = bounds3_union_point(bounds[t], mesh.positions[3 * t + 2]);
+        }
+        const bvh* rebuilt = lbvh_builder_build(&builder, bounds, counts[frame], 0, 0);
+        bvh fresh;
+        lbvh_build(&fresh, bounds, counts[frame], 0, 0);
+        EXPECTED_TO_BE(fresh.node_count, rebuilt->node_count);
+        EXPECTED_TO_BE(0, memcmp(fresh.nodes, rebuilt->nodes, sizeof(bvh_node) * fresh.node_count));
+        EXPECTED_TO_BE(0, memcmp(fresh.prim_indices, rebuilt->prim_indices, sizeof(u32) * fresh.prim_count));
+        bvh_destroy(&fresh);
+    }
+    lbvh_builder_destroy(&builder);
+    memory_free(bounds);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// per frame rebuild cost against the sah builder, with the resulting tree quality
+u32 test_accel_bench_lbvh_build() {
+    test_mesh mesh;
+    soup_create(&mesh, 1000000, 0.2f, 12);
+    zpool pool;
+    zpool_create(&pool, 0);
+    lbvh_build_options options;
+    lbvh_build_options_default(&options);
+    bvh sah, linear, linear_wide, rotated;
+    bvh_build_triangles(&sah, mesh.positions, mesh.indices, mesh.triangle_count, 0, &pool);
+    lbvh_build_triangles(&linear, mesh.positions, mesh.indices, mesh.triangle_count, &options, &pool);
+    options.morton_bits = 63;
+    lbvh_build_triangles(&linear_wide, mesh.positions, mesh.indices, mesh.triangle_count, &options, &pool);
+    options.morton_bits = 30;
+    options.rotation_passes = 1;
+    lbvh_build_triangles(&rotated, mesh.positions, mesh.indices, mesh.triangle_count, &options, &pool);
+
+    // steady state of an animation: the builder already holds memory for this many primitives
+    bounds3* bounds = (bounds3*)memory_allocate(sizeof(bounds3) * mesh.triangle_count);
+    for (u32 t = 0; t < mesh.triangle_count; ++t) {
+        bounds[t] = bounds3_make(mesh.positions[3 * t], mesh.positions[3 * t + 1]);
+        bounds[t] = bounds3_union_point(bounds[t], mesh.positions[3 * t + 2]);
+    }
+    options.rotation_passes = 0;
+    lbvh_builder builder;
+    lbvh_builder_create(&builder);
+    const u32 frames = 5;
+    f64 rebuild_seconds = 0;
+    for (u32 frame = 0; frame <= frames; ++frame) {
+        const bvh* rebuilt = lbvh_builder_build(&builder, bounds, mesh.triangle_count, &options, &pool);
+        rebuild_seconds += frame ? rebuilt->stats.build_seconds : 0;
+    }
+    lbvh_builder_destroy(&builder);
+    memory_free(bounds);
+
+    log_stdout("    lbvh_build %u triangles, %u threads: sah %.1fms (cost %.2f), lbvh30 %.1fms (cost %.2f), "
+               "lbvh63 %.1fms (cost %.2f), lbvh30+rotations %.1fms (cost %.2f), lbvh30 rebuild %.1fms\n",
+               mesh.triangle_count,
+               zpool_thread_count(&pool),
+               sah.stats.build_seconds * 1e3,
+               sah.stats.sah_cost,
+               linear.stats.build_seconds * 1e3,
+               linear.stats.sah_cost,
+               linear_wide.stats.build_seconds * 1e3,
+               linear_wide.stats.sah_cost,
+               rotated.stats.build_seconds * 1e3,
+               rotated.stats.sah_cost,
+               rebuild_seconds / frames * 1e3);
+    zpool_destroy(&pool);
+    EXPECTED_TO_BE(linear.node_count, rotated.node_count);
+    bvh_destroy(&sah);
+    bvh_destroy(&linear);
+    bvh_destroy(&linear_wide);
+    bvh_destroy(&rotated);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// ============================================================================
+// TLAS TESTS
+// ============================================================================
+
+// rotation about a random axis, uniform scale in [0.5, 2) and a translation in the scene cube
+static void random_instance_transform(rng* r, transform* out) {
+    transform scale, rotate, translate, partial;
+    f32 s = 0.5f + rng_f32(r) * 1.5f;
+    transform_scale(s, s, s, &scale);
+    vec3 axis = vec3_make(rng_f32(r) - 0.5f, rng_f32(r) - 0.5f, rng_f32(r) - 0.5f);
+    transform_rotate(rng_f32(r) * 360, vec3_normalize(axis), &rotate);
+    transform_translate(vec3_make(rng_f32(r) * 400 - 200, rng_f32(r) * 400 - 200, rng_f32(r) * 400 - 200),
+                        &translate);
+    transform_compose(&rotate, &scale, &partial);
+    transform_compose(&translate, &partial, out);
+}
+
+// reference closest hit: every instance tested with the same object space ray as the tlas
+static bool tlas_brute_force(const tlas* t, const ray* r, tlas_hit* hit) {
+    f32 t_max = MAX_F32;
+    bool found = FALSE;
+    for (u32 i = 0; i < t->instance_count; ++i) {
+        const tlas_instance* instance = &t->instances[i];
+        const tlas_geometry* geometry = &t->geometries[instance->geometry];
+        f32 w;
+        point3 o = mat4_apply(&instance->object_to_world.m_inv, r->o, 1.0f, &w);
+        ray local = ray_make(o, mat4_apply(&instance->object_to_world.m_inv, r->d, 0.0f, 0));
+        bvh_hit bottom_hit;
+        if (bvh_intersect_triangles(geometry->tree, geometry->positions, geometry->indices, &local, t_max, &bottom_hit)) {
+            t_max = bottom_hit.triangle.t;
+            hit->triangle = bottom_hit.triangle;
+            hit->instance = i;
+            hit->prim_id = bottom_hit.prim_id;
+            found = TRUE;
+        }
+    }
+    return found;
+}
+
+static u32 tlas_compare_random_rays(const tlas* t, u32 ray_count, u64 seed) {
+    rng r;
+    rng_seed(&r, seed, 0);
+    u32 hits = 0;
+    for (u32 i = 0; i < ray_count; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 600 - 300, rng_f32(&r) * 600 - 300, -400);
+        point3 target = vec3_make(rng_f32(&r) * 400 - 200, rng_f32(&r) * 400 - 200, rng_f32(&r) * 400 - 200);
+        ray r = ray_make(o, vec3_sub(target, o));
+        tlas_hit expected, obtained;
+        bool expected_found = tlas_brute_force(t, &r, &expected);
+        bool found = tlas_intersect(t, &r, MAX_F32, &obtained);
+        if (expected_found != found) {
+            return 0;
+        }
+        if (found) {
+            if (expected.instance != obtained.instance || expected.prim_id != obtained.prim_id ||
+                expected.triangle.t != obtained.triangle.t) {
+                return 0;
+            }
+            hits += 1;
+        }
+    }
+    return hits;
+}
+
+u32 test_tlas_intersect_matches_brute_force() {
+    test_mesh meshes[2];
+    soup_create(&meshes[0], 500, 6, 14);
+    soup_create(&meshes[1], 300, 10, 15);
+    bvh trees[2];
+    tlas_geometry geometries[2];
+    for (u32 g = 0; g < 2; ++g) {
+        bvh_build_triangles(&trees[g], meshes[g].positions, meshes[g].indices, meshes[g].triangle_count, 0, 0);
+        geometries[g] = (tlas_geometry){&trees[g], meshes[g].positions, meshes[g].indices};
+    }
+    const u32 instance_count = 200;
+    tlas_instance* instances = (tlas_instance*)memory_allocate(sizeof(tlas_instance) * instance_count);
+    rng r;
+    rng_seed(&r, 16, 0);
+    for (u32 i = 0; i < instance_count; ++i) {
+        random_instance_transform(&r, &instances[i].object_to_world);
+        instances[i].geometry = i & 1;
+    }
+    tlas t;
+    tlas_build(&t, geometries, 2, instances, instance_count, 0);
+    EXPECTED_TO_BE(2 * instance_count - 1, t.tree.node_count);
+    for (u32 i = 0; i < instance_count; ++i) {
+        // instance bounds hold every transformed vertex
+        const test_mesh* mesh = &meshes[instances[i].geometry];
+        for (u32 v = 0; v < mesh->triangle_count * 3; ++v) {
+            point3 p = transform_point(&instances[i].object_to_world, mesh->positions[v]);
+            EXPECTED_TO_BE(TRUE, bounds3_inside(&t.instance_bounds[i], p));
+        }
+    }
+    u32 hits = tlas_compare_random_rays(&t, 300, 17);
+    EXPECTED_TO_BE(TRUE, (hits > 30));
+
+    tlas_destroy(&t);
+    memory_free(instances);
+    for (u32 g = 0; g < 2; ++g) {
+        bvh_destroy(&trees[g]);
+        soup_destroy(&meshes[g]);
+    }
+    return TRUE;
+}
+
+u32 test_tlas_refit_after_moving_instances() {
+    test_mesh mesh;
+    soup_create(&mesh, 400, 8, 18);
+    bvh tree;
+    bvh_build_triangles(&tree, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    tlas_geometry geometry = {&tree, mesh.positions, mesh.indices};
+    const u32 instance_count = 150;
+    tlas_instance* instances = (tlas_instance*)memory_allocate(sizeof(tlas_instance) * instance_count);
+    rng r;
+    rng_seed(&r, 19, 0);
+    for (u32 i = 0; i < instance_count; ++i) {
+        random_instance_transform(&r, &instances[i].object_to_world);
+        instances[i].geometry = 0;
+    }
+    zpool pool;
+    zpool_create(&pool, 2);
+    tlas t;
+    tlas_build(&t, &geometry, 1, instances, instance_count, &pool);
+
+    // every other instance moves somewhere else entirely, the topology stays as built
+    for (u32 i = 0; i < instance_count; i += 2) {
+        transform moved;
+        random_instance_transform(&r, &moved);
+        tlas_set_transform(&t, i, &moved);
+    }
+    tlas_refit(&t, &pool);
+    zpool_destroy(&pool);
+    for (u32 n = 0; n < t.tree.node_count; ++n) {
+        const bvh_node* node = &t.tree.nodes[n];
+        bounds3 nb = bvh_node_bounds(node);
+        if (node->prim_count) {
+            EXPECTED_TO_BE(TRUE, bounds_contains(&nb, &t.instance_bounds[t.tree.prim_indices[node->offset]]));
+        } else {
+            bounds3 left = bvh_node_bounds(&t.tree.nodes[node->offset]);
+            bounds3 right = bvh_node_bounds(&t.tree.nodes[node->offset + 1]);
+            EXPECTED_TO_BE(TRUE, (bounds_contains(&nb, &left) && bounds_contains(&nb, &right)));
+        }
+    }
+    u32 hits = tlas_compare_random_rays(&t, 300, 20);
+    EXPECTED_TO_BE(TRUE, (hits > 20));
+
+    tlas_destroy(&t);
+    memory_free(instances);
+    bvh_destroy(&tree);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// memory against flattening every instance, and top level refit against rebuild
+u32 test_accel_bench_tlas() {
+    test_mesh mesh;
+    soup_create(&mesh, 20000, 2, 21);
+    bvh tree;
+    bvh_build_triangles(&tree, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    tlas_geometry geometry = {&tree, mesh.positions, mesh.indices};
+    const u32 instance_count = 100000;
+    tlas_instance* instances = (tlas_instance*)memory_allocate(sizeof(tlas_instance) * instance_count);
+    rng r;
+    rng_seed(&r, 22, 0);
+    for (u32 i = 0; i < instance_count; ++i) {
+        random_instance_transform(&r, &instances[i].object_to_world);
+        instances[i].geometry = 0;
+    }
+    zpool pool;
+    zpool_create(&pool, 0);
+    clock clk;
+    clock_set(&clk);
+    tlas t;
+    tlas_build(&t, &geometry, 1, instances, instance_count, &pool);
+    clock_update(&clk);
+    f64 build_seconds = clk.elapsed;
+    for (u32 i = 0; i < instance_count; ++i) {
+        transform moved;
+        random_instance_transform(&r, &moved);
+        tlas_set_transform(&t, i, &moved);
+    }
+    clock_set(&clk);
+    tlas_refit(&t, &pool);
+    clock_update(&clk);
+    f64 refit_seconds = clk.elapsed;
+    zpool_destroy(&pool);
+
+    u64 mesh_bytes = mesh.triangle_count * 3 * (sizeof(point3) + sizeof(u32));
+    u64 blas_bytes = mesh_bytes + tree.node_count * sizeof(bvh_node) + tree.prim_count * sizeof(u32);
+    u64 tlas_bytes = instance_count * (sizeof(tlas_instance) + sizeof(bounds3) + sizeof(u32)) +
+                     t.tree.node_count * sizeof(bvh_node);
+    log_stdout("    tlas %u instances of %u triangles: %.1f MB shared + %.1f MB top level vs %.1f GB flattened, "
+               "build %.1fms, refit %.1fms\n",
+               instance_count,
+               mesh.triangle_count,
+               blas_bytes / (1024.0 * 1024.0),
+               tlas_bytes / (1024.0 * 1024.0),
+               (f64)blas_bytes * instance_count / (1024.0 * 1024.0 * 1024.0),
+               build_seconds * 1e3,
+               refit_seconds * 1e3);
+    EXPECTED_TO_BE(2 * instance_count - 1, t.tree.node_count);
+    tlas_destroy(&t);
+    memory_free(instances);
+    bvh_destroy(&tree);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// ============================================================================
+// REFIT TESTS
+// ============================================================================
+
+// smooth per vertex displacement, neighboring triangles move together like a skinned mesh
+static void mesh_deform(test_mesh* mesh, const point3* rest, f32 phase, f32 amplitude) {
+    for (u32 v = 0; v < mesh->triangle_count * 3; ++v) {
+        point3 p = rest[v];
+        vec3 offset = vec3_make(sinf(p.y * 0.05f + phase), cosf(p.z * 0.05f + phase), sinf(p.x * 0.05f - phase));
+        mesh->positions[v] = vec3_madd(p, offset, amplitude);
+    }
+}
+
+u32 test_bvh_refit_matches_tight_bounds() {
+    test_mesh mesh;
+    soup_create(&mesh, 20000, 2, 23);
+    point3* rest = (point3*)memory_allocate(sizeof(point3) * mesh.triangle_count * 3);
+    for (u32 v = 0; v < mesh.triangle_count * 3; ++v) {
+        rest[v] = mesh.positions[v];
+    }
+    bvh serial, parallel;
+    bvh_build_triangles(&serial, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh_build_triangles(&parallel, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh_refitter serial_refitter, parallel_refitter;
+    bvh_refitter_create(&serial_refitter, &serial, mesh.indices, 0, 0);
+    bvh_refitter_create(&parallel_refitter, &parallel, mesh.indices, 0, 0);
+    zpool pool;
+    zpool_create(&pool, 3);
+
+    for (u32 frame = 1; frame <= 3; ++frame) {
+        mesh_deform(&mesh, rest, frame * 0.7f, 4);
+        bvh_refit_result serial_result, parallel_result;
+        bvh_refitter_update_triangles(&serial_refitter, &serial, mesh.positions, mesh.indices, 0, &serial_result);
+        bvh_refitter_update_triangles(&parallel_refitter, &parallel, mesh.positions, mesh.indices, &pool, &parallel_result);
+        EXPECTED_TO_BE(FALSE, parallel_result.rebuilt);
+        EXPECTED_TO_BE(TRUE, bvh_validate(&parallel, &mesh));
+        // bounds are unions of the same triangles in any order, so they match exactly
+        EXPECTED_TO_BE(0, memcmp(serial.nodes, parallel.nodes, sizeof(bvh_node) * serial.node_count));
+        f32 expected_sah = bvh_compute_sah_cost(&parallel, 0.5f, 1.0f);
+        EXPECTED_FLOAT_TO_BE(expected_sah, parallel_result.sah_cost, 1e-3f * expected_sah);
+        EXPECTED_FLOAT_TO_BE(expected_sah, serial_result.sah_cost, 1e-3f * expected_sah);
+    }
+    // leaves are tight around their triangles after the refit
+    for (u32 n = 0; n < parallel.node_count; ++n) {
+        const bvh_node* node = &parallel.nodes[n];
+        if (node->prim_count == 0) {
+            continue;
+        }
+        bounds3 tight = bounds3_empty();
+        for (u32 i = 0; i < node->prim_count; ++i) {
+            for (u32 v = 0; v < 3; ++v) {
+                tight = bounds3_union_point(tight, mesh.positions[mesh.indices[parallel.prim_indices[node->offset + i] * 3 + v]]);
+            }
+        }
+        EXPECTED_FLOAT_TO_BE(tight.min.x, node->min[0], 0.0f);
+        EXPECTED_FLOAT_TO_BE(tight.max.z, node->max[2], 0.0f);
+    }
+
+    zpool_destroy(&pool);
+    bvh_refitter_destroy(&serial_refitter);
+    bvh_refitter_destroy(&parallel_refitter);
+    bvh_destroy(&serial);
+    bvh_destroy(&parallel);
+    memory_free(rest);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+u32 test_bvh_refit_rebuilds_past_threshold() {
+    test_mesh mesh;
+    soup_create(&mesh, 5000, 2, 24);
+    point3* rest = (point3*)memory_allocate(sizeof(point3) * mesh.triangle_count * 3);
+    for (u32 v = 0; v < mesh.triangle_count * 3; ++v) {
+        rest[v] = mesh.positions[v];
+    }
+    bvh b;
+    bvh_build_triangles(&b, mesh.positions, mesh.indices, mesh.triangle_count, 0, 0);
+    bvh_refitter refitter;
+    bvh_refitter_create(&refitter, &b, mesh.indices, 0, 1.5f);
+    bvh_refit_result result;
+
+    // a gentle deformation keeps the tree
+    mesh_deform(&mesh, rest, 0.3f, 0.5f);
+    bvh_refitter_update_triangles(&refitter, &b, mesh.positions, mesh.indices, 0, &result);
+    EXPECTED_TO_BE(FALSE, result.rebuilt);
+    EXPECTED_TO_BE(TRUE, (result.sah_ratio < 1.5f));
+
+    // swapping triangles across the cube leaves every leaf spanning half the scene
+    rng r;
+    rng_seed(&r, 25, 0);
+    for (u32 t = 0; t < mesh.triangle_count; ++t) {
+        u32 other = (u32)(rng_f32(&r) * mesh.triangle_count) % mesh.triangle_count;
+        for (u32 v = 0; v < 3; ++v) {
+            point3 temp = mesh.positions[t * 3 + v];
+            mesh.positions[t * 3 + v] = mesh.positions[other * 3 + v];
+            mesh.positions[other * 3 + v] = temp;
+        }
+    }
+    bvh_refitter_update_triangles(&refitter, &b, mesh.positions, mesh.indices, 0, &result);
+    EXPECTED_TO_BE(TRUE, result.rebuilt);
+    EXPECTED_FLOAT_TO_BE(1.0f, result.sah_ratio, 0.0f);
+    EXPECTED_TO_BE(TRUE, bvh_validate(&b, &mesh));
+
+    // the refitter follows the rebuilt topology
+    mesh_deform(&mesh, mesh.positions, 0.1f, 0.1f);
+    bvh_refitter_update_triangles(&refitter, &b, mesh.positions, mesh.indices, 0, &result);
+    EXPECTED_TO_BE(FALSE, result.rebuilt);
+    EXPECTED_TO_BE(TRUE, bvh_validate(&b, &mesh));
+
+    bvh_refitter_destroy(&refitter);
+    bvh_destroy(&b);
+    memory_free(rest);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// per frame update of a deforming mesh against rebuilding it
+u32 test_accel_bench_bvh_refit() {
+    test_mesh mesh;
+    soup_create(&mesh, 1000000, 0.2f, 26);
+    point3* rest = (point3*)memory_allocate(sizeof(point3) * mesh.triangle_count * 3);
+    for (u32 v = 0; v < mesh.triangle_count * 3; ++v) {
+        rest[v] = mesh.positions[v];
+    }
+    zpool pool;
+    zpool_create(&pool, 0);
+    bvh b;
+    bvh_build_triangles(&b, mesh.positions, mesh.indices, mesh.triangle_count, 0, &pool);
+    f64 build_seconds = b.stats.build_seconds;
+    bvh_refitter refitter;
+    bvh_refitter_create(&refitter, &b, mesh.indices, 0, 1.5f);
+    const u32 frames = 5;
+    f64 refit_seconds = 0;
+    bvh_refit_result result;
+    for (u32 frame = 0; frame < frames; ++frame) {
+        mesh_deform(&mesh, rest, frame * 0.2f, 1);
+        bvh_refitter_update_triangles(&refitter, &b, mesh.positions, mesh.indices, &pool, &result);
+        refit_seconds += result.seconds;
+    }
+    log_stdout("    bvh_refit %u triangles, %u threads: build %.1fms, refit %.1fms per frame, "
+               "sah ratio after %u frames %.3f\n",
+               mesh.triangle_count,
+               zpool_thread_count(&pool),
+               build_seconds * 1e3,
+               refit_seconds / frames * 1e3,
+               frames,
+               result.sah_ratio);
+    zpool_destroy(&pool);
+    EXPECTED_TO_BE(FALSE, result.rebuilt);
+    bvh_refitter_destroy(&refitter);
+    bvh_destroy(&b);
+    memory_free(rest);
+    soup_destroy(&mesh);
+    return TRUE;
+}
+
+// ============================================================================
+// GEOMETRY CACHE TESTS
+// ============================================================================
+
+// compact mesh over a soup with made up normals and uvs, so every array is present
+static void soup_to_mesh(const test_mesh* soup, mesh* m) {
+    u32 vertex_count = soup->triangle_count * 3;
+    normal3* normals = (normal3*)memory_allocate(sizeof(normal3) * vertex_count);
+    f32* uvs = (f32*)memory_allocate(sizeof(f32) * 2 * vertex_count);
+    for (u32 v = 0; v < vertex_count; ++v) {
+        normals[v] = vec3_normalize(vec3_add(soup->positions[v], vec3_make(0.5f, 0.25f, 0.125f)));
+        uvs[v * 2] = soup->positions[v].x * 0.01f;
+        uvs[v * 2 + 1] = soup->positions[v].y * 0.01f;
+    }
+    mesh_desc desc = {vertex_count, soup->triangle_count, soup->positions, normals, uvs, soup->indices, FALSE};
+    mesh_create(m, &desc);
+    memory_free(normals);
+    memory_free(uvs);
+}
+
+static bool mesh_arrays_equal(const mesh* a, const mesh* b) {
+    u64 vc = a->vertex_count;
+    return a->vertex_count == b->vertex_count && a->triangle_count == b->triangle_count &&
+           memcmp(a->x, b->x, sizeof(f32) * vc) == 0 && memcmp(a->y, b->y, sizeof(f32) * vc) == 0 &&
+           memcmp(a->z, b->z, sizeof(f32) * vc) == 0 && memcmp(a->normals, b->normals, sizeof(u32) * vc) == 0 &&
+           memcmp(a->uvs, b->uvs, 2 * sizeof(u16) * vc) == 0 &&
+           memcmp(a->indices, b->indices, 3 * sizeof(u32) * (u64)a->triangle_count) == 0 &&
+           memcmp(a->uv_min, b->uv_min, sizeof(a->uv_min)) == 0 &&
+           memcmp(a->uv_extent, b->uv_extent, sizeof(a->uv_extent)) == 0 &&
+           vec3_equal(a->bounds.min, b->bounds.min, 0.0f) && vec3_equal(a->bounds.max, b->bounds.max, 0.0f);
+}
+
+// writes a copy of source with the u32 at offset replaced by value
+static bool write_patched_copy(const char* path, const platform_file_mapping* source, u64 offset, u32 value) {
+    u8* bytes = (u8*)memory_allocate(source->size);
+    memcpy(bytes, source->data, source->size);
+    memcpy(bytes + offset, &value, sizeof(value));
+    platform_file file;
+    bool ok = platform_file_open(path, PLATFORM_FILE_WRITE, &file);
+    if (ok) {
+        ok = platform_file_write(&file, bytes, source->size) == source->size;
+        platform_file_close(&file);
+    }
+    memory_free(bytes);
+    return ok;
+}
+
+u32 test_geometry_cache_roundtrip() {
+    char path[64];
+    log_buffer(path, sizeof(path), "geometry_cache_test_%u.bin", platform_process_id());
+    test_mesh soup[2];
+    soup_create(&soup[0], 3000, 3, 29);
+    soup_create(&soup[1], 700, 1, 30);
+    mesh meshes[2];
+    bvh trees[2];
+    soup_to_mesh(&soup[0], &meshes[0]);
+    soup_to_mesh(&soup[1], &meshes[1]);
+    bvh_build_mesh(&trees[0], &meshes[0], 0, 0);
+    // the second mesh goes in without a tree
+    trees[1].node_count = 0;
+    EXPECTED_TO_BE(TRUE, geometry_cache_write(path, 77, meshes, trees, 2));
+
+    geometry_cache cache;
+    EXPECTED_TO_BE(FALSE, geometry_cache_open(&cache, path, 78));
+    EXPECTED_TO_BE(TRUE, geometry_cache_open(&cache, path, 77));
+    EXPECTED_TO_BE(2, cache.count);
+    EXPECTED_TO_BE(TRUE, mesh_arrays_equal(&meshes[0], &cache.meshes[0]));
+    EXPECTED_TO_BE(TRUE, mesh_arrays_equal(&meshes[1], &cache.meshes[1]));
+    for (u32 i = 0; i < 2; ++i) {
+        u64 address = (u64)cache.meshes[i].x;
+        EXPECTED_TO_BE(0, (address & (GEOMETRY_CACHE_PAGE - 1)));
+    }
+    const bvh* mapped = &cache.trees[0];
+    EXPECTED_TO_BE(trees[0].node_count, mapped->node_count);
+    EXPECTED_TO_BE(0, memcmp(trees[0].nodes, mapped->nodes, sizeof(bvh_node) * trees[0].node_count));
+    EXPECTED_TO_BE(0, memcmp(trees[0].prim_indices, mapped->prim_indices, sizeof(u32) * trees[0].prim_count));
+    EXPECTED_FLOAT_TO_BE(trees[0].stats.sah_cost, mapped->stats.sah_cost, 0.0f);
+    EXPECTED_TO_BE(0, cache.trees[1].node_count);
+
+    // the mapped tree traces straight out of the file
+    rng r;
+    rng_seed(&r, 31, 0);
+    for (u32 i = 0; i < 300; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70, -80);
+        point3 target = vec3_make(rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50);
+        ray r = ray_make(o, vec3_sub(target, o));
+        bvh_hit expected, obtained;
+        bool expected_found = bvh_intersect_mesh(&trees[0], &meshes[0], &r, MAX_F32, &expected);
+        bool found = bvh_intersect_mesh(mapped, &cache.meshes[0], &r, MAX_F32, &obtained);
+        EXPECTED_TO_BE(expected_found, found);
+        if (found) {
+            EXPECTED_TO_BE(expected.prim_id, obtained.prim_id);
+        }
+    }
+
+    // a truncated copy is rejected instead of handing out pointers past the end
+    platform_file_mapping whole;
+    EXPECTED_TO_BE(TRUE, platform_file_map(path, &whole));
+    char truncated_path[64];
+    log_buffer(truncated_path, sizeof(truncated_path), "geometry_cache_test_%u_cut.bin", platform_process_id());
+    platform_file file;
+    EXPECTED_TO_BE(TRUE, platform_file_open(truncated_path, PLATFORM_FILE_WRITE, &file));
+    u64 cut = whole.size - 100;
+    EXPECTED_TO_BE(cut, platform_file_write(&file, whole.data, cut));
+    platform_file_close(&file);
+    geometry_cache truncated;
+    EXPECTED_TO_BE(FALSE, geometry_cache_open(&truncated, truncated_path, 77));
+    remove(truncated_path);
+
+    // so is a full length copy whose indices or tree point outside their arrays. the first
+    // mesh starts on the first page, the other offsets follow from the mapped pointers
+    const u8* first = (const u8*)cache.meshes[0].x;
+    u64 indices_at = GEOMETRY_CACHE_PAGE + (u64)((const u8*)cache.meshes[0].indices - first);
+    u64 nodes_at = GEOMETRY_CACHE_PAGE + (u64)((const u8*)mapped->nodes - first);
+    u64 prim_indices_at = GEOMETRY_CACHE_PAGE + (u64)((const u8*)mapped->prim_indices - first);
+    u32 leaf = 0;
+    while (mapped->nodes[leaf].prim_count == 0) {
+        ++leaf;
+    }
+    struct {
+        u64 offset;
+        u32 value;
+    } corruptions[] = {
+        {indices_at + 5 * sizeof(u32), meshes[0].vertex_count},
+        {nodes_at + offsetof(bvh_node, offset), mapped->node_count - 1},
+        // the root pointing back at itself would loop forever
+        {nodes_at + offsetof(bvh_node, offset), 0},
+        {nodes_at + leaf * sizeof(bvh_node) + offsetof(bvh_node, offset), mapped->prim_count},
+        {prim_indices_at + 7 * sizeof(u32), meshes[0].triangle_count},
+    };
+    char corrupt_path[64];
+    log_buffer(corrupt_path, sizeof(corrupt_path), "geometry_cache_test_%u_bad.bin", platform_process_id());
+    for (u32 i = 0; i < sizeof(corruptions) / sizeof(corruptions[0]); ++i) {
+        EXPECTED_TO_BE(TRUE, write_patched_copy(corrupt_path, &whole, corruptions[i].offset, corruptions[i].value));
+        geometry_cache corrupt;
+        EXPECTED_TO_BE(FALSE, geometry_cache_open(&corrupt, corrupt_path, 77));
+    }
+    // and the unpatched bytes still open, so the rejections above come from the patches
+    EXPECTED_TO_BE(TRUE, write_patched_copy(corrupt_path, &whole, 0, *(const u32*)whole.data));
+    geometry_cache intact;
+    EXPECTED_TO_BE(TRUE, geometry_cache_open(&intact, corrupt_path, 77));
+    geometry_cache_close(&intact);
+    remove(corrupt_path);
+    platform_file_unmap(&whole);
+
+    geometry_cache_close(&cache);
+    remove(path);
+    for (u32 i = 0; i < 2; ++i) {
+        mesh_destroy(&meshes[i]);
+        soup_destroy(&soup[i]);
+    }
+    bvh_destroy(&trees[0]);
+    return TRUE;
+}
+
+// cold start (compact mesh + bvh build) against reopening the cache and tracing the first rays
+u32 test_accel_bench_geometry_cache() {
+    char path[64];
+    log_buffer(path, sizeof(path), "geometry_cache_bench_%u.bin", platform_process_id());
+    test_mesh soup;
+    soup_create(&soup, 1000000, 0.2f, 32);
+    zpool pool;
+    zpool_create(&pool, 0);
+
+    clock clk;
+    clock_set(&clk);
+    mesh m;
+    soup_to_mesh(&soup, &m);
+    bvh tree;
+    bvh_build_mesh(&tree, &m, 0, &pool);
+    clock_update(&clk);
+    f64 build_seconds = clk.elapsed;
+
+    clock_set(&clk);
+    EXPECTED_TO_BE(TRUE, geometry_cache_write(path, 1, &m, &tree, 1));
+    clock_update(&clk);
+    f64 write_seconds = clk.elapsed;
+
+    clock_set(&clk);
+    geometry_cache cache;
+    EXPECTED_TO_BE(TRUE, geometry_cache_open(&cache, path, 1));
+    clock_update(&clk);
+    f64 open_seconds = clk.elapsed;
+
+    const u32 ray_count = 10000;
+    rng r;
+    rng_seed(&r, 33, 0);
+    u32 hits = 0;
+    clock_set(&clk);
+    for (u32 i = 0; i < ray_count; ++i) {
+        point3 o = vec3_make(rng_f32(&r) * 140 - 70, rng_f32(&r) * 140 - 70, -80);
+        point3 target = vec3_make(rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50, rng_f32(&r) * 100 - 50);
+        ray r = ray_make(o, vec3_sub(target, o));
+        bvh_hit hit;
+        hits += bvh_intersect_mesh(&cache.trees[0], &cache.meshes[0], &r, MAX_F32, &hit);
+    }
+    clock_update(&clk);
+    f64 trace_seconds = clk.elapsed;
+    log_stdout("    geometry cache %u triangles: build %.1fms, write %.1fms, open %.3fms, first %u rays %.1fms (%u hits)\n",
+               soup.triangle_count,
+               build_seconds * 1e3,
+               write_seconds * 1e3,
+               open_seconds * 1e3,
+               ray_count,
+               trace_seconds * 1e3,
+               hits);
+    EXPECTED_TO_BE(TRUE, (open_seconds * 10 < build_seconds));
+
+    geometry_cache_close(&cache);
+    remove(path);
+    zpool_destroy(&pool);
+    bvh_destroy(&tree);
+    mesh_destroy(&m);
+    soup_destroy(&soup);
+    return TRUE;
+}
+
+void register_accel_testcases() {
+    test_manager_add(test_bvh_build_structure, "bvh_build_structure");
+    test_manager_add(test_bvh_parallel_build_matches_serial, "bvh_parallel_build_matches_serial");
+    test_manager_add(test_bvh_intersect_matches_brute_force, "bvh_intersect_matches_brute_force");
+    test_manager_add(test_bvh_degenerate_inputs, "bvh_degenerate_inputs");
+    test_manager_add(test_bvh_skewed_parallel_build, "bvh_skewed_parallel_build");
+    test_manager_add(test_accel_bench_bvh_build, "accel_bench_bvh_build");
+    test_manager_add(test_bvh_mesh_matches_indexed, "bvh_mesh_matches_indexed");
+    test_manager_add(test_bvh_occluded_matches_intersect, "bvh_occluded_matches_intersect");
+    test_manager_add(test_accel_bench_occlusion, "accel_bench_occlusion");
+    test_manager_add(test_bvh8_collapse_structure, "bvh8_collapse_structure");
+    test_manager_add(test_bvh8_intersect_matches_binary, "bvh8_intersect_matches_binary");
+    test_manager_add(test_accel_bench_bvh8_traversal, "accel_bench_bvh8_traversal");
+    test_manager_add(test_lbvh_build_structure, "lbvh_build_structure");
+    test_manager_add(test_lbvh_parallel_build_matches_serial, "lbvh_parallel_build_matches_serial");
+    test_manager_add(test_lbvh_rotations_reduce_sah, "lbvh_rotations_reduce_sah");
+    test_manager_add(test_lbvh_duplicate_codes, "lbvh_duplicate_codes");
+    test_manager_add(test_lbvh_builder_rebuilds_match_one_shot, "lbvh_builder_rebuilds_match_one_shot");
+    test_manager_add(test_accel_bench_lbvh_build, "accel_bench_lbvh_build");
+    test_manager_add(test_tlas_intersect_matches_brute_force, "tlas_intersect_matches_brute_force");
+    test_manager_add(test_tlas_refit_after_moving_instances, "tlas_refit_after_moving_instances");
+    test_manager_add(test_accel_bench_tlas, "accel_bench_tlas");
+    test_manager_add(test_bvh_refit_matches_tight_bounds, "bvh_refit_matches_tight_bounds");
+    test_manager_add(test_bvh_refit_rebuilds_past_threshold, "bvh_refit_rebuilds_past_threshold");
+    test_manager_add(test_accel_bench_bvh_refit, "accel_bench_bvh_refit");
+    test_manager_add(test_geometry_cache_roundtrip, "geometry_cache_roundtrip");
+    test_manager_add(test_accel_bench_geometry_cache, "accel_bench_geometry_cache");
+}
@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <string.h>
+#include "test_manager.h"
+#include "memory.h"
+#include "flight_recorder.h"
+#include "platform.h"
+#include "logger.h"
+#include "zthread.h"
+
+#ifdef PLATFORM_LINUX
+#    include <unistd.h>
+#    include <sys/wait.h>
+#    include <signal.h>
+#endif
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// reads the whole file into a tracked buffer, the caller frees it
+static char* read_text_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    u64 size = (u64)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)memory_allocate((u32)size + 1);
+    u64 read = fread(text, 1, size, file);
+    text[read] = 0;
+    fclose(file);
+    return text;
+}
+
+// ============================================================================
+// FLIGHT RECORDER TESTS
+// ============================================================================
+
+u32 test_flight_recorder_dump_contains_events() {
+    char path[64];
+    log_buffer(path, sizeof(path), "flight_recorder_test_%u.txt", platform_process_id());
+
+    flight_recorder_zone_begin("flight_recorder_zone");
+    LOGE("flight recorder marker %i", 42);
+    flight_recorder_zone_end("flight_recorder_zone");
+    flight_recorder_zone_begin("flight_recorder_open_zone");
+    bool written = flight_recorder_dump(path, "manual dump");
+    flight_recorder_zone_end("flight_recorder_open_zone");
+    EXPECTED_TO_BE(TRUE, written);
+
+    char* text = read_text_file(path);
+    remove(path);
+    EXPECTED_NOT_TO_BE(0, (u64)text);
+    bool has_reason = strstr(text, "reason: manual dump") != 0;
+    bool has_log = strstr(text, "log    flight recorder marker 42") != 0;
+    bool has_zone = strstr(text, "begin  flight_recorder_zone") != 0;
+    bool has_open_zone = strstr(text, "inside zone: flight_recorder_open_zone") != 0;
+    bool has_memory = strstr(text, "-- memory --") != 0;
+    bool has_backtrace = strstr(text, "-- backtrace of thread") != 0;
+    memory_free(text);
+
+    EXPECTED_TO_BE(TRUE, has_reason);
+    EXPECTED_TO_BE(TRUE, has_log);
+    EXPECTED_TO_BE(TRUE, has_zone);
+    EXPECTED_TO_BE(TRUE, has_open_zone);
+    EXPECTED_TO_BE(TRUE, has_memory);
+    EXPECTED_TO_BE(TRUE, has_backtrace);
+    return TRUE;
+}
+
+u32 test_flight_recorder_ring_wraps() {
+    char path[64];
+    log_buffer(path, sizeof(path), "flight_recorder_wrap_%u.txt", platform_process_id());
+
+    for (u32 i = 0; i < FLIGHT_RECORDER_EVENTS * 3; ++i) {
+        flight_recorder_zone_begin("flight_recorder_wrap_zone");
+        flight_recorder_zone_end("flight_recorder_wrap_zone");
+    }
+    LOGE("flight recorder newest event");
+    EXPECTED_TO_BE(TRUE, flight_recorder_dump(path, "wrap"));
+
+    char* text = read_text_file(path);
+    remove(path);
+    EXPECTED_NOT_TO_BE(0, (u64)text);
+    bool has_newest = strstr(text, "flight recorder newest event") != 0;
+    memory_free(text);
+    EXPECTED_TO_BE(TRUE, has_newest);
+    return TRUE;
+}
+
+static zthread_func_return_type short_lived_thread(void* params) {
+    flight_recorder_zone_begin("flight_recorder_reuse_worker");
+    flight_recorder_zone_end("flight_recorder_reuse_worker");
+    return 0;
+}
+
+u32 test_flight_recorder_rings_reused() {
+    LOGE("flight recorder reuse owner");
+    // twice as many threads as rings, one after another, every one hands its ring back
+    for (u32 i = 0; i < FLIGHT_RECORDER_MAX_THREADS * 2; ++i) {
+        zthread thread;
+        zthread_create(short_lived_thread, 0, &thread);
+        zthread_wait(&thread);
+        zthread_destroy(&thread);
+    }
+    char path[64];
+    log_buffer(path, sizeof(path), "flight_recorder_reuse_%u.txt", platform_process_id());
+    EXPECTED_TO_BE(TRUE, flight_recorder_dump(path, "reuse"));
+
+    char* text = read_text_file(path);
+    remove(path);
+    EXPECTED_NOT_TO_BE(0, (u64)text);
+    // the ring of this thread holds its own events and none of the workers'
+    char header[64];
+    log_buffer(header, sizeof(header), "(tid %llu)", platform_thread_id());
+    char* section = strstr(text, header);
+    char* end = section ? strstr(section, "\n-- ") : 0;
+    if (end) {
+        *end = 0;
+    }
+    bool has_owner = section && strstr(section, "flight recorder reuse owner") != 0;
+    bool has_worker = section && strstr(section, "flight_recorder_reuse_worker") != 0;
+    memory_free(text);
+    EXPECTED_TO_BE(TRUE, has_owner);
+    EXPECTED_TO_BE(FALSE, has_worker);
+    return TRUE;
+}
+
+#ifdef PLATFORM_LINUX
+u32 test_flight_recorder_crash_writes_report() {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        flight_recorder_zone_begin("flight_recorder_crashing_zone");
+        DEBUG_BREAK;
+        _exit(0);
+    }
+    i32 status = 0;
+    waitpid(pid, &status, 0);
+    EXPECTED_TO_BE(TRUE, WIFSIGNALED(status));
+
+    char path[64];
+    log_buffer(path, sizeof(path), "pbrt_testing_crash_%u.txt", (u32)pid);
+    char* text = read_text_file(path);
+    remove(path);
+    EXPECTED_NOT_TO_BE(0, (u64)text);
+    bool has_zone = strstr(text, "inside zone: flight_recorder_crashing_zone") != 0;
+    bool has_signal = strstr(text, "reason: SIG") != 0;
+    memory_free(text);
+    EXPECTED_TO_BE(TRUE, has_zone);
+    EXPECTED_TO_BE(TRUE, has_signal);
+    return TRUE;
+}
+
+static volatile u32 stderr_locked;
+
+static zthread_func_return_type stderr_holding_thread(void* params) {
+    flockfile(stderr);
+    stderr_locked = TRUE;
+    while (TRUE) {
+        pause();
+    }
+    return 0;
+}
+
+// the report does not go through stdio, a crash while another thread holds the stderr
+// lock still finishes instead of hanging
+u32 test_flight_recorder_crash_with_stderr_locked() {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        zthread thread;
+        zthread_create(stderr_holding_thread, 0, &thread);
+        while (!stderr_locked) {
+            zthread_yield();
+        }
+        DEBUG_BREAK;
+        _exit(0);
+    }
+    i32 status = 0;
+    f64 end = platform_time() + 10.0;
+    while (waitpid(pid, &status, WNOHANG) == 0 && platform_time() < end) {
+        usleep(1000);
+    }
+    bool finished = platform_time() < end;
+    if (!finished) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+    char path[64];
+    log_buffer(path, sizeof(path), "pbrt_testing_crash_%u.txt", (u32)pid);
+    char* text = read_text_file(path);
+    remove(path);
+    EXPECTED_TO_BE(TRUE, finished);
+    EXPECTED_NOT_TO_BE(0, (u64)text);
+    memory_free(text);
+    return TRUE;
+}
+
+// volatile so the compiler cannot see the recursion below is unbounded
+static volatile u64 overflow_depth_limit = ~0ull;
+
+// every frame keeps a page of stack alive until the guard page is hit
+static u32 overflow_stack(volatile u8* previous, u64 depth) {
+    volatile u8 frame[4096];
+    frame[0] = previous ? previous[0] + 1 : 0;
+    if (depth == overflow_depth_limit) {
+        return frame[0];
+    }
+    return overflow_stack(frame, depth + 1) + frame[0];
+}
+
+static zthread_func_return_type overflowing_thread(void* params) {
+    flight_recorder_zone_begin("flight_recorder_overflow_zone");
+    overflow_stack(0, 0);
+    return 0;
+}
+
+u32 test_flight_recorder_worker_stack_overflow() {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        zthread thread;
+        zthread_create(overflowing_thread, 0, &thread);
+        zthread_wait(&thread);
+        _exit(0);
+    }
+    i32 status = 0;
+    waitpid(pid, &status, 0);
+    EXPECTED_TO_BE(TRUE, WIFSIGNALED(status));
+
+    char path[64];
+    log_buffer(path, sizeof(path), "pbrt_testing_crash_%u.txt", (u32)pid);
+    char* text = read_text_file(path);
+    remove(path);
+    EXPECTED_NOT_TO_BE(0, (u64)text);
+    bool has_zone = strstr(text, "inside zone: flight_recorder_overflow_zone") != 0;
+    bool has_signal = strstr(text, "reason: SIGSEGV") != 0;
+    memory_free(text);
+    EXPECTED_TO_BE(TRUE, has_zone);
+    EXPECTED_TO_BE(TRUE, has_signal);
+    return TRUE;
+}
+#endif
+
+// ============================================================================
+// MAIN TEST REGISTRATION
+// ============================================================================
+
+void register_flight_recorder_testcases() {
+    test_manager_add(test_flight_recorder_dump_contains_events, "flight_recorder_dump_contains_events");
+    test_manager_add(test_flight_recorder_ring_wraps, "flight_recorder_ring_wraps");
+    test_manager_add(test_flight_recorder_rings_reused, "flight_recorder_rings_reused");
+#ifdef PLATFORM_LINUX
+    test_manager_add(test_flight_recorder_crash_writes_report, "flight_recorder_crash_writes_report");
+    test_manager_add(test_flight_recorder_worker_stack_overflow, "flight_recorder_worker_stack_overflow");
+    test_manager_add(test_flight_recorder_crash_with_stderr_locked, "flight_recorder_crash_with_stderr_locked");
+#endif
+}
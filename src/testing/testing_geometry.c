@@ -0,0 +1,385 @@
+// the geometry headers pull in immintrin.h, which declares malloc and free, so they go before memory.h
+#include "bounds3.h"
+#include "ray_packet.h"
+#include "triangle.h"
+#include "mesh.h"
+#include "rng.h"
+#include "test_manager.h"
+#include "memory.h"
+#include "clock.h"
+#include "logger.h"
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static vec3 rng_vec3(rng* r, f32 low, f32 high) {
+    f32 x = rng_range(r, low, high);
+    f32 y = rng_range(r, low, high);
+    f32 z = rng_range(r, low, high);
+    return vec3_make(x, y, z);
+}
+
+// ray from a random origin aimed at a random point of the triangle, or well past it for misses
+static ray aimed_ray(rng* r, point3 p0, point3 p1, point3 p2, bool inside) {
+    f32 b1 = rng_range(r, 0.05f, 0.9f);
+    f32 b2 = rng_range(r, 0.05f, 0.9f);
+    if (b1 + b2 > 0.95f) {
+        b1 = 0.95f - b1;
+        b2 = 0.95f - b2;
+        b1 = b1 < 0.02f ? 0.02f : b1;
+        b2 = b2 < 0.02f ? 0.02f : b2;
+    }
+    if (!inside) {
+        b1 += 1.2f;
+    }
+    point3 target = vec3_add(p0, vec3_add(vec3_scale(vec3_sub(p1, p0), b1), vec3_scale(vec3_sub(p2, p0), b2)));
+    point3 o = rng_vec3(r, -10, 10);
+    o.z = -10;
+    return ray_make(o, vec3_sub(target, o));
+}
+
+// ============================================================================
+// BOUNDS TESTS
+// ============================================================================
+
+u32 test_bounds3_basics() {
+    bounds3 b = bounds3_empty();
+    EXPECTED_TO_BE(TRUE, bounds3_is_empty(&b));
+    b = bounds3_union_point(b, vec3_make(1, 2, 3));
+    b = bounds3_union(b, bounds3_make(vec3_make(-1, 0, 0), vec3_make(0, 5, 1)));
+    EXPECTED_TO_BE(FALSE, bounds3_is_empty(&b));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(-1, 0, 0), b.min, 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(1, 5, 3), b.max, 0));
+    EXPECTED_FLOAT_TO_BE(2.0f * (2 * 5 + 2 * 3 + 5 * 3), bounds3_surface_area(&b), 0.0f);
+    EXPECTED_TO_BE(1, bounds3_maximum_extent(&b));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(0.5f, 0.5f, 0.5f), bounds3_offset(&b, bounds3_centroid(&b)), 0));
+
+    ray r = ray_make(vec3_make(-5, 1, 1), vec3_make(1, 0, 0));
+    vec3 inv_dir = vec3_make(1, 1 / r.d.y, 1 / r.d.z);
+    f32 t0, t1;
+    EXPECTED_TO_BE(TRUE, bounds3_intersect(&b, &r, inv_dir, MAX_F32, &t0, &t1));
+    EXPECTED_FLOAT_TO_BE(4.0f, t0, 0.0f);
+    EXPECTED_FLOAT_TO_BE(6.0f, t1, 1e-4f);
+    EXPECTED_TO_BE(FALSE, bounds3_intersect(&b, &r, inv_dir, 3.0f, &t0, &t1));
+
+    // axis parallel ray outside the y slab
+    r.o.y = 6;
+    EXPECTED_TO_BE(FALSE, bounds3_intersect(&b, &r, inv_dir, MAX_F32, 0, 0));
+    return TRUE;
+}
+
+u32 test_ray_packet_bounds_matches_single() {
+    rng r;
+    rng_seed(&r, 0x9e3779b97f4a7c15ULL, 0);
+    bounds3 b = bounds3_make(vec3_make(-1, -2, -1), vec3_make(2, 1, 3));
+    u32 sizes[] = {4, 8, 16};
+    for (u32 s = 0; s < 3; ++s) {
+        ray_packet packet;
+        ray_packet_create(&packet, sizes[s]);
+        for (u32 round = 0; round < 64; ++round) {
+            ray rays[16];
+            for (u32 lane = 0; lane < packet.lanes; ++lane) {
+                rays[lane] = ray_make(rng_vec3(&r, -6, 6), rng_vec3(&r, -1, 1));
+                ray_packet_set(&packet, lane, &rays[lane], 20);
+            }
+            u32 active = ray_packet_active_mask(&packet);
+            EXPECTED_TO_BE((1u << packet.lanes) - 1, active);
+            u32 mask = ray_packet_intersect_bounds(&packet, &b, active);
+            for (u32 lane = 0; lane < packet.lanes; ++lane) {
+                vec3 inv_dir = vec3_div(vec3_splat(1), rays[lane].d);
+                u32 expected = bounds3_intersect(&b, &rays[lane], inv_dir, 20, 0, 0) ? 1 : 0;
+                EXPECTED_TO_BE(expected, ((mask >> lane) & 1));
+            }
+            // masked out lanes never report a hit
+            EXPECTED_TO_BE(0, ray_packet_intersect_bounds(&packet, &b, 0));
+        }
+        ray_packet_destroy(&packet);
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// TRIANGLE TESTS
+// ============================================================================
+
+u32 test_ray_packet_triangle_matches_watertight() {
+    rng r;
+    rng_seed(&r, 0x2545F4914F6CDD1DULL, 0);
+    point3 p0 = vec3_make(-1, -1, 2);
+    point3 p1 = vec3_make(3, -1, 2.5f);
+    point3 p2 = vec3_make(0, 2, 3);
+    u32 sizes[] = {4, 8, 16};
+    for (u32 s = 0; s < 3; ++s) {
+        ray_packet packet;
+        ray_packet_create(&packet, sizes[s]);
+        for (u32 round = 0; round < 64; ++round) {
+            ray rays[16];
+            for (u32 lane = 0; lane < packet.lanes; ++lane) {
+                rays[lane] = aimed_ray(&r, p0, p1, p2, lane % 3 != 0);
+                ray_packet_set(&packet, lane, &rays[lane], MAX_F32);
+            }
+            u32 mask = ray_packet_intersect_triangle(&packet, p0, p1, p2, 7, ray_packet_active_mask(&packet));
+            for (u32 lane = 0; lane < packet.lanes; ++lane) {
+                triangle_hit hit;
+                bool single = triangle_intersect(&rays[lane], MAX_F32, p0, p1, p2, &hit);
+                EXPECTED_TO_BE((lane % 3 != 0), single);
+                EXPECTED_TO_BE((single ? 1 : 0), ((mask >> lane) & 1));
+                if (single) {
+                    EXPECTED_FLOAT_TO_BE(hit.t, packet.t_max[lane], 1e-4f);
+                    EXPECTED_FLOAT_TO_BE(hit.b1, packet.u[lane], 1e-4f);
+                    EXPECTED_FLOAT_TO_BE(hit.b2, packet.v[lane], 1e-4f);
+                    EXPECTED_TO_BE(7, packet.prim_id[lane]);
+                } else {
+                    EXPECTED_TO_BE(RAY_PACKET_NO_HIT, packet.prim_id[lane]);
+                }
+            }
+            // the closest hit wins, a triangle behind the recorded one changes nothing
+            point3 q0 = vec3_add(p0, vec3_make(0, 0, 5));
+            point3 q1 = vec3_add(p1, vec3_make(0, 0, 5));
+            point3 q2 = vec3_add(p2, vec3_make(0, 0, 5));
+            ray_packet_intersect_triangle(&packet, q0, q1, q2, 8, ray_packet_active_mask(&packet));
+            for (u32 lane = 0; lane < packet.lanes; ++lane) {
+                EXPECTED_NOT_TO_BE(8, packet.prim_id[lane]);
+            }
+        }
+        ray_packet_destroy(&packet);
+    }
+    return TRUE;
+}
+
+u32 test_triangle_watertight_shared_edge() {
+    // two triangles sharing the diagonal from (0,0) to (1,1), rays along the diagonal
+    // must hit at least one of them no matter how the rounding falls
+    point3 a = vec3_make(0, 0, 0);
+    point3 b = vec3_make(1, 0, 0);
+    point3 c = vec3_make(1, 1, 0);
+    point3 d = vec3_make(0, 1, 0);
+    u32 misses = 0;
+    for (u32 i = 1; i < 1000; ++i) {
+        f32 s = (f32)i / 1000.0f;
+        ray r = ray_make(vec3_make(s * 0.37f, s * 0.91f, 1), vec3_make(s - s * 0.37f, s - s * 0.91f, -1));
+        triangle_hit hit;
+        bool first = triangle_intersect(&r, MAX_F32, a, b, c, &hit);
+        bool second = triangle_intersect(&r, MAX_F32, a, c, d, &hit);
+        misses += (!first && !second) ? 1 : 0;
+    }
+    EXPECTED_TO_BE(0, misses);
+
+    triangle_hit hit;
+    ray r = ray_make(vec3_make(0.25f, 0.5f, 1), vec3_make(0, 0, -1));
+    EXPECTED_TO_BE(TRUE, triangle_intersect(&r, MAX_F32, a, c, d, &hit));
+    EXPECTED_FLOAT_TO_BE(1.0f, hit.t, 1e-6f);
+    f32 weight_sum = hit.b0 + hit.b1 + hit.b2;
+    EXPECTED_FLOAT_TO_BE(1.0f, weight_sum, 1e-6f);
+    EXPECTED_TO_BE(FALSE, triangle_intersect(&r, 0.5f, a, c, d, &hit));
+    EXPECTED_TO_BE(FALSE, triangle_intersect(&r, MAX_F32, a, b, c, &hit));
+    // degenerate triangle
+    EXPECTED_TO_BE(FALSE, triangle_intersect(&r, MAX_F32, a, a, d, &hit));
+    return TRUE;
+}
+
+// ============================================================================
+// MICRO BENCHMARKS
+// ============================================================================
+
+#define BENCH_TRIANGLES 256
+#define BENCH_PACKETS 64
+
+// 8 ray packets against a triangle soup compared with the same rays traced one at a time,
+// run a release build with --filter=geometry_bench_* for meaningful numbers
+u32 test_geometry_bench_packet_triangles() {
+    rng r;
+    rng_seed(&r, 0x853c49e6748fea9bULL, 0);
+    point3* vertices = (point3*)memory_allocate_aligned(sizeof(point3) * BENCH_TRIANGLES * 3, 64);
+    for (u32 i = 0; i < BENCH_TRIANGLES * 3; ++i) {
+        vertices[i] = rng_vec3(&r, -4, 4);
+    }
+    ray* rays = (ray*)memory_allocate_aligned(sizeof(ray) * BENCH_PACKETS * 8, 64);
+    ray_packet* packets = (ray_packet*)memory_allocate(sizeof(ray_packet) * BENCH_PACKETS);
+    for (u32 p = 0; p < BENCH_PACKETS; ++p) {
+        ray_packet_create(&packets[p], 8);
+        // coherent bundle, like neighboring camera pixels
+        point3 o = vec3_make(rng_range(&r, -1, 1), rng_range(&r, -1, 1), -10);
+        for (u32 lane = 0; lane < 8; ++lane) {
+            vec3 d = vec3_make(rng_range(&r, -0.3f, 0.3f), rng_range(&r, -0.3f, 0.3f), 1);
+            rays[p * 8 + lane] = ray_make(o, d);
+        }
+    }
+
+    u64 packet_hits = 0;
+    clock clk;
+    clock_set(&clk);
+    for (u32 p = 0; p < BENCH_PACKETS; ++p) {
+        for (u32 lane = 0; lane < 8; ++lane) {
+            ray_packet_set(&packets[p], lane, &rays[p * 8 + lane], MAX_F32);
+        }
+        u32 active = ray_packet_active_mask(&packets[p]);
+        for (u32 t = 0; t < BENCH_TRIANGLES; ++t) {
+            const point3* v = vertices + t * 3;
+            ray_packet_intersect_triangle(&packets[p], v[0], v[1], v[2], t, active);
+        }
+        for (u32 lane = 0; lane < 8; ++lane) {
+            packet_hits += packets[p].prim_id[lane] != RAY_PACKET_NO_HIT ? 1 : 0;
+        }
+    }
+    clock_update(&clk);
+    f64 packet_seconds = clk.elapsed;
+
+    u64 single_hits = 0;
+    clock_set(&clk);
+    for (u32 r = 0; r < BENCH_PACKETS * 8; ++r) {
+        f32 t_max = MAX_F32;
+        bool found = FALSE;
+        for (u32 t = 0; t < BENCH_TRIANGLES; ++t) {
+            const point3* v = vertices + t * 3;
+            triangle_hit hit;
+            if (triangle_intersect(&rays[r], t_max, v[0], v[1], v[2], &hit)) {
+                t_max = hit.t;
+                found = TRUE;
+            }
+        }
+        single_hits += found ? 1 : 0;
+    }
+    clock_update(&clk);
+
+    f64 tests = (f64)BENCH_PACKETS * 8 * BENCH_TRIANGLES;
+    (void)tests;
+    // printed directly so the numbers survive release builds where LOGI compiles out
+    log_stdout("    packet_triangles: %.2f ns/test packet, %.2f ns/test single (%.2fx)\n",
+               packet_seconds * 1e9 / tests,
+               clk.elapsed * 1e9 / tests,
+               clk.elapsed / (packet_seconds > 0 ? packet_seconds : 1e-12));
+
+    for (u32 p = 0; p < BENCH_PACKETS; ++p) {
+        ray_packet_destroy(&packets[p]);
+    }
+    memory_free(packets);
+    memory_free_aligned(rays);
+    memory_free_aligned(vertices);
+    EXPECTED_TO_BE(single_hits, packet_hits);
+    return TRUE;
+}
+
+// ============================================================================
+// MESH TESTS
+// ============================================================================
+
+u32 test_mesh_octahedral_roundtrip() {
+    rng r;
+    rng_seed(&r, 41, 0);
+    f32 max_error = 0;
+    for (u32 i = 0; i < 20000; ++i) {
+        normal3 n = vec3_normalize(rng_vec3(&r, -1, 1));
+        // the poles and the fold lines of the lower hemisphere are the hard cases
+        if (i < 6) {
+            n = vec3_zero();
+            n.e[i / 2] = i & 1 ? -1.0f : 1.0f;
+        } else if (i < 10) {
+            n = vec3_normalize(vec3_make(i & 1 ? -1.0f : 1.0f, 0, i & 2 ? -1.0f : -0.01f));
+        }
+        normal3 decoded = octahedral_decode(octahedral_encode(n));
+        f32 error = vec3_length(vec3_sub(decoded, n));
+        max_error = error > max_error ? error : max_error;
+    }
+    // 16 bits per axis puts every normal within about 1e-4 radians
+    EXPECTED_TO_BE(TRUE, (max_error < 1e-4f));
+    return TRUE;
+}
+
+// n x n vertex grid bent into a dome, with normals and uvs spanning [2, 5] x [-1, 1]
+static void grid_arrays(u32 n, point3* positions, normal3* normals, f32* uvs, u32* indices) {
+    for (u32 j = 0; j < n; ++j) {
+        for (u32 i = 0; i < n; ++i) {
+            u32 v = j * n + i;
+            f32 s = (f32)i / (n - 1), t = (f32)j / (n - 1);
+            positions[v] = vec3_make(s * 10 - 5, t * 10 - 5, 3 * sinf(s * PI) * sinf(t * PI));
+            normals[v] = vec3_normalize(vec3_make(cosf(s * PI), cosf(t * PI), 1));
+            uvs[v * 2] = 2 + 3 * s;
+            uvs[v * 2 + 1] = t * 2 - 1;
+        }
+    }
+    u32 k = 0;
+    for (u32 j = 0; j + 1 < n; ++j) {
+        for (u32 i = 0; i + 1 < n; ++i) {
+            u32 v = j * n + i;
+            u32 quad[6] = {v, v + 1, v + n, v + 1, v + n + 1, v + n};
+            for (u32 q = 0; q < 6; ++q) {
+                indices[k++] = quad[q];
+            }
+        }
+    }
+}
+
+u32 test_mesh_compact_storage() {
+    const u32 n = 64;
+    const u32 vertex_count = n * n, triangle_count = 2 * (n - 1) * (n - 1);
+    point3* positions = (point3*)memory_allocate(sizeof(point3) * vertex_count);
+    normal3* normals = (normal3*)memory_allocate(sizeof(normal3) * vertex_count);
+    f32* uvs = (f32*)memory_allocate(sizeof(f32) * 2 * vertex_count);
+    u32* indices = (u32*)memory_allocate(sizeof(u32) * 3 * triangle_count);
+    grid_arrays(n, positions, normals, uvs, indices);
+
+    mesh_desc desc = {vertex_count, triangle_count, positions, normals, uvs, indices, FALSE};
+    mesh m;
+    mesh_create(&m, &desc);
+    u64 x_address = (u64)m.x, y_address = (u64)m.y;
+    EXPECTED_TO_BE(0, (x_address & 63));
+    EXPECTED_TO_BE(0, (y_address & 63));
+    EXPECTED_TO_BE(TRUE, (m.indices != indices));
+    for (u32 v = 0; v < vertex_count; ++v) {
+        point3 p = mesh_position(&m, v);
+        EXPECTED_TO_BE(TRUE, vec3_equal(p, positions[v], 0.0f));
+        EXPECTED_TO_BE(TRUE, bounds3_inside(&m.bounds, p));
+        EXPECTED_TO_BE(TRUE, vec3_equal(mesh_normal(&m, v), normals[v], 1e-4f));
+        f32 uv[2];
+        mesh_uv(&m, v, uv);
+        EXPECTED_FLOAT_TO_BE(uvs[v * 2], uv[0], 3.0f / 65535);
+        EXPECTED_FLOAT_TO_BE(uvs[v * 2 + 1], uv[1], 2.0f / 65535);
+    }
+    // barycentric interpolation at a vertex returns the vertex attributes
+    f32 uv[2];
+    mesh_interpolate_uv(&m, 0, 0, 1, 0, uv);
+    EXPECTED_FLOAT_TO_BE(uvs[2], uv[0], 1e-4f);
+    EXPECTED_TO_BE(TRUE, vec3_equal(mesh_interpolate_normal(&m, 0, 0, 0, 1), normals[n], 1e-4f));
+
+    // against a point3 + normal3 + float uv vertex array, the index buffer being 12 bytes per triangle in both
+    u64 index_bytes = 3 * sizeof(u32) * (u64)triangle_count;
+    u64 naive = (sizeof(point3) + sizeof(normal3) + 2 * sizeof(f32)) * (u64)vertex_count;
+    u64 compact = mesh_bytes(&m) - index_bytes;
+    log_stdout("    mesh %u vertices: %.1f bytes per vertex compact, %.1f naive, %.1f vs %.1f bytes per triangle\n",
+               vertex_count,
+               (f64)compact / vertex_count,
+               (f64)naive / vertex_count,
+               (f64)(compact + index_bytes) / triangle_count,
+               (f64)(naive + index_bytes) / triangle_count);
+    EXPECTED_TO_BE(TRUE, (compact * 10 < naive * 6));
+
+    // a second mesh over the same topology references the index buffer
+    desc.share_indices = TRUE;
+    desc.normals = 0;
+    desc.uvs = 0;
+    mesh shared;
+    mesh_create(&shared, &desc);
+    EXPECTED_TO_BE(TRUE, (shared.indices == indices));
+    EXPECTED_TO_BE(TRUE, (shared.normals == 0 && shared.uvs == 0));
+    EXPECTED_TO_BE(12 * vertex_count, mesh_bytes(&shared));
+
+    mesh_destroy(&shared);
+    mesh_destroy(&m);
+    memory_free(positions);
+    memory_free(normals);
+    memory_free(uvs);
+    memory_free(indices);
+    return TRUE;
+}
+
+void register_geometry_testcases() {
+    test_manager_add(test_bounds3_basics, "bounds3_basics");
+    test_manager_add(test_ray_packet_bounds_matches_single, "ray_packet_bounds_matches_single");
+    test_manager_add(test_ray_packet_triangle_matches_watertight, "ray_packet_triangle_matches_watertight");
+    test_manager_add(test_triangle_watertight_shared_edge, "triangle_watertight_shared_edge");
+    test_manager_add(test_geometry_bench_packet_triangles, "geometry_bench_packet_triangles");
+    test_manager_add(test_mesh_octahedral_roundtrip, "mesh_octahedral_roundtrip");
+    test_manager_add(test_mesh_compact_storage, "mesh_compact_storage");
+}
@@ -0,0 +1,835 @@
+#include <math.h>
+#include <string.h>
+#include "integrator.h"
+#include "wavefront.h"
+#include "megakernel.h"
+#include "light_bvh.h"
+#include "environment.h"
+#include "film.h"
+#include "sampler.h"
+#include "rng.h"
+#include "math_utils.h"
+#include "test_manager.h"
+#include "clock.h"
+#include "memory.h"
+#include "zpool.h"
+#include "logger.h"
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+#define TEST_WORLD_QUADS 16
+
+// worlds made of quads, each split into the triangles (0, 1, 2) and (0, 2, 3). a quad's
+// front face is the one its corners wind counter clockwise around
+typedef struct test_world {
+    point3 positions[TEST_WORLD_QUADS * 4];
+    u32 indices[TEST_WORLD_QUADS * 6];
+    u32 triangle_materials[TEST_WORLD_QUADS * 2];
+    material materials[8];
+    u32 quad_count;
+    u32 material_count;
+} test_world;
+
+static u32 add_material(test_world* t, material_type type, vec3 albedo, vec3 emission) {
+    material* m = &t->materials[t->material_count];
+    m->type = type;
+    m->albedo = albedo;
+    m->emission = emission;
+    return t->material_count++;
+}
+
+static void add_quad(test_world* t, point3 p0, point3 p1, point3 p2, point3 p3, u32 material) {
+    u32 base = t->quad_count * 4;
+    t->positions[base + 0] = p0;
+    t->positions[base + 1] = p1;
+    t->positions[base + 2] = p2;
+    t->positions[base + 3] = p3;
+    const u32 corners[6] = {0, 1, 2, 0, 2, 3};
+    for (u32 i = 0; i < 6; ++i) {
+        t->indices[t->quad_count * 6 + i] = base + corners[i];
+    }
+    t->triangle_materials[t->quad_count * 2 + 0] = material;
+    t->triangle_materials[t->quad_count * 2 + 1] = material;
+    t->quad_count++;
+}
+
+// a horizontal quad at height y over [-half, half]^2, facing up or down
+static void add_plane(test_world* t, f32 y, f32 half, bool up, u32 material) {
+    point3 a = vec3_make(-half, y, -half), b = vec3_make(half, y, -half);
+    point3 c = vec3_make(half, y, half), d = vec3_make(-half, y, half);
+    if (up) {
+        add_quad(t, a, d, c, b, material);
+    } else {
+        add_quad(t, a, b, c, d, material);
+    }
+}
+
+static void test_world_create(world* w, const test_world* t, vec3 background, zpool* pool) {
+    world_desc desc;
+    desc.positions = t->positions;
+    desc.vertex_count = t->quad_count * 4;
+    desc.indices = t->indices;
+    desc.triangle_count = t->quad_count * 2;
+    desc.triangle_materials = t->triangle_materials;
+    desc.materials = t->materials;
+    desc.material_count = t->material_count;
+    desc.background = background;
+    desc.light_sampling = LIGHT_SAMPLING_BVH;
+    desc.environment = 0;
+    world_create(w, &desc, pool);
+}
+
+// the cornell box in [0, 1]^3 open towards -z, with a square light under the ceiling and a
+// mirror standing near the green wall, seen from in front of the opening
+static void cornell_create(world* w, camera* c, u32 width, u32 height, zpool* pool) {
+    test_world t;
+    memset(&t, 0, sizeof(t));
+    u32 white = add_material(&t, MATERIAL_DIFFUSE, vec3_splat(0.75f), vec3_zero());
+    u32 red = add_material(&t, MATERIAL_DIFFUSE, vec3_make(0.65f, 0.05f, 0.05f), vec3_zero());
+    u32 green = add_material(&t, MATERIAL_DIFFUSE, vec3_make(0.12f, 0.45f, 0.15f), vec3_zero());
+    u32 light = add_material(&t, MATERIAL_DIFFUSE, vec3_splat(0.75f), vec3_splat(12.0f));
+    u32 mirror = add_material(&t, MATERIAL_MIRROR, vec3_splat(0.9f), vec3_zero());
+    point3 p[8];
+    for (u32 i = 0; i < 8; ++i) {
+        p[i] = vec3_make((f32)(i & 1), (f32)((i >> 1) & 1), (f32)(i >> 2));
+    }
+    add_quad(&t, p[0], p[4], p[5], p[1], white);
+    add_quad(&t, p[2], p[3], p[7], p[6], white);
+    add_quad(&t, p[4], p[6], p[7], p[5], white);
+    // the camera sees +x on its left
+    add_quad(&t, p[0], p[2], p[6], p[4], green);
+    add_quad(&t, p[1], p[5], p[7], p[3], red);
+    f32 h = 0.999f;
+    add_quad(&t, vec3_make(0.35f, h, 0.35f), vec3_make(0.65f, h, 0.35f), vec3_make(0.65f, h, 0.65f), vec3_make(0.35f, h, 0.65f), light);
+    add_quad(&t, vec3_make(0.15f, 0, 0.55f), vec3_make(0.45f, 0, 0.85f), vec3_make(0.45f, 0.6f, 0.85f), vec3_make(0.15f, 0.6f, 0.55f), mirror);
+    test_world_create(w, &t, vec3_zero(), pool);
+    camera_look_at(c, vec3_make(0.5f, 0.5f, -1.4f), vec3_make(0.5f, 0.5f, 0.5f), vec3_make(0, 1, 0), 40, width, height);
+}
+
+static void film_create_box(film* f, u32 width, u32 height, u32 tile_size) {
+    film_options options;
+    film_options_default(&options, width, height);
+    options.tile_size = tile_size;
+    film_filter_default(&options.filter, FILM_FILTER_BOX);
+    film_create(f, &options);
+}
+
+
+// a floor under grid x grid small lights facing down from varying heights, in four colors
+// of very different power, seen from above. most lights are far from any given point, so
+// uniform light selection wastes most of its shadow rays
+static void many_lights_create(world* w, camera* c, u32 grid, light_sampling sampling, u32 width, u32 height, zpool* pool) {
+    u32 quad_count = 1 + grid * grid;
+    point3* positions = (point3*)memory_allocate(sizeof(point3) * 4 * quad_count);
+    u32* indices = (u32*)memory_allocate(sizeof(u32) * 6 * quad_count);
+    u32* triangle_materials = (u32*)memory_allocate(sizeof(u32) * 2 * quad_count);
+    const f32 half = 8.0f;
+    positions[0] = vec3_make(-half, 0, -half);
+    positions[1] = vec3_make(-half, 0, half);
+    positions[2] = vec3_make(half, 0, half);
+    positions[3] = vec3_make(half, 0, -half);
+    rng r;
+    rng_seed(&r, 7, 0);
+    f32 cell = 2.0f * half / (f32)grid;
+    for (u32 i = 0; i < grid * grid; ++i) {
+        f32 x = -half + ((f32)(i % grid) + rng_range(&r, 0.2f, 0.8f)) * cell;
+        f32 z = -half + ((f32)(i / grid) + rng_range(&r, 0.2f, 0.8f)) * cell;
+        f32 y = rng_range(&r, 0.5f, 1.0f);
+        f32 size = 0.15f * cell;
+        point3* p = positions + 4 * (i + 1);
+        p[0] = vec3_make(x - size, y, z - size);
+        p[1] = vec3_make(x + size, y, z - size);
+        p[2] = vec3_make(x + size, y, z + size);
+        p[3] = vec3_make(x - size, y, z + size);
+        triangle_materials[2 * (i + 1)] = 1 + rng_bounded(&r, 4);
+        triangle_materials[2 * (i + 1) + 1] = triangle_materials[2 * (i + 1)];
+    }
+    for (u32 q = 0; q < quad_count; ++q) {
+        const u32 corners[6] = {0, 1, 2, 0, 2, 3};
+        for (u32 k = 0; k < 6; ++k) {
+            indices[6 * q + k] = 4 * q + corners[k];
+        }
+    }
+    triangle_materials[0] = 0;
+    triangle_materials[1] = 0;
+    material materials[5];
+    const vec3 emission[4] = {vec3_splat(2), vec3_make(12, 8, 4), vec3_make(1, 3, 9), vec3_splat(60)};
+    materials[0].type = MATERIAL_DIFFUSE;
+    materials[0].albedo = vec3_splat(0.5f);
+    materials[0].emission = vec3_zero();
+    for (u32 m = 1; m < 5; ++m) {
+        materials[m].type = MATERIAL_DIFFUSE;
+        materials[m].albedo = vec3_zero();
+        materials[m].emission = emission[m - 1];
+    }
+    world_desc desc = {positions, 4 * quad_count, indices, 2 * quad_count, triangle_materials, materials, 5, vec3_zero(), sampling, 0};
+    world_create(w, &desc, pool);
+    memory_free(positions);
+    memory_free(indices);
+    memory_free(triangle_materials);
+    camera_look_at(c, vec3_make(0, 6, -6), vec3_make(0, 0, 0), vec3_make(0, 1, 0), 60, width, height);
+}
+
+// renders direct light only at spp samples per pixel with the given seed
+static void direct_light_render(const world* w, const camera* c, u32 spp, u64 seed, zpool* pool, f32* rgb, integrator_stats* stats) {
+    film f;
+    film_create_box(&f, c->width, c->height, 16);
+    megakernel_options options;
+    megakernel_options_default(&options);
+    options.samples_per_pixel = spp;
+    options.max_depth = 1;
+    options.seed = seed;
+    megakernel_render(&f, w, c, &options, pool, stats);
+    film_resolve(&f, rgb);
+    film_destroy(&f);
+}
+
+// the mean of two renders and the rms difference between them, sqrt(2) times the noise of one
+static void render_noise(const f32* a, const f32* b, u32 count, f64* mean, f64* rms) {
+    f64 sum = 0, squares = 0;
+    for (u32 i = 0; i < count; ++i) {
+        sum += 0.5 * ((f64)a[i] + b[i]);
+        squares += ((f64)a[i] - b[i]) * ((f64)a[i] - b[i]);
+    }
+    *mean = sum / count;
+    *rms = sqrt(squares / count);
+}
+
+// a dim blue sky over a dark ground with a small bright sun, width x height texels
+static f32* sky_create(u32 width, u32 height) {
+    f32* rgb = (f32*)memory_allocate(sizeof(f32) * 3 * width * height);
+    for (u32 y = 0; y < height; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            f32* texel = rgb + 3 * (y * width + x);
+            bool up = y < height / 2;
+            texel[0] = up ? 0.3f : 0.05f;
+            texel[1] = up ? 0.5f : 0.05f;
+            texel[2] = up ? 0.9f : 0.05f;
+            if (x / (width / 16) == 3 && y / (height / 8) == 1) {
+                texel[0] = texel[1] = texel[2] = 200.0f;
+            }
+        }
+    }
+    return rgb;
+}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+
+u32 test_integrator_camera() {
+    camera c;
+    camera_look_at(&c, vec3_make(1, 2, 3), vec3_make(1, 2, 10), vec3_make(0, 1, 0), 90, 200, 100);
+    ray center = camera_generate_ray(&c, 100, 50);
+    EXPECTED_TO_BE(TRUE, vec3_equal(center.o, vec3_make(1, 2, 3), 1e-6f));
+    EXPECTED_TO_BE(TRUE, vec3_equal(center.d, vec3_make(0, 0, 1), 1e-6f));
+    // 90 degrees vertically: the middle of the top edge is 45 degrees up
+    ray top = camera_generate_ray(&c, 100, 0);
+    EXPECTED_FLOAT_TO_BE(top.d.y, top.d.z, 1e-5f);
+    EXPECTED_TO_BE(TRUE, (top.d.y > 0));
+    // x grows to the right of a camera looking down +z with y up, which is -x
+    ray left = camera_generate_ray(&c, 0, 50);
+    ray right = camera_generate_ray(&c, 200, 50);
+    EXPECTED_TO_BE(TRUE, (left.d.x > 0 && right.d.x < 0));
+    EXPECTED_FLOAT_TO_BE(-left.d.x, right.d.x, 1e-6f);
+    EXPECTED_FLOAT_TO_BE(1, vec3_length(left.d), 1e-5f);
+    return TRUE;
+}
+
+// a floor under a white sky reflects exactly its albedo: every diffuse bounce escapes to
+// the sky and every mirror reflection sees it, so each sample is exact
+u32 test_integrator_furnace() {
+    const u32 size = 32;
+    test_world t;
+    memset(&t, 0, sizeof(t));
+    u32 diffuse = add_material(&t, MATERIAL_DIFFUSE, vec3_make(0.25f, 0.5f, 0.75f), vec3_zero());
+    u32 mirror = add_material(&t, MATERIAL_MIRROR, vec3_splat(0.9f), vec3_zero());
+    // diffuse where x < 0, mirror where x > 0
+    add_quad(&t, vec3_make(-100, 0, -100), vec3_make(-100, 0, 100), vec3_make(0, 0, 100), vec3_make(0, 0, -100), diffuse);
+    add_quad(&t, vec3_make(0, 0, -100), vec3_make(0, 0, 100), vec3_make(100, 0, 100), vec3_make(100, 0, -100), mirror);
+    world w;
+    test_world_create(&w, &t, vec3_splat(1), 0);
+    camera c;
+    camera_look_at(&c, vec3_make(0, 1, 0), vec3_make(0, 0, 0), vec3_make(0, 0, 1), 60, size, size);
+    film f;
+    film_create_box(&f, size, size, 8);
+    wavefront_options options;
+    wavefront_options_default(&options);
+    options.samples_per_pixel = 4;
+    wavefront_render(&f, &w, &c, &options, 0, 0);
+    f32* rgb = (f32*)memory_allocate(sizeof(f32) * 3 * size * size);
+    film_resolve(&f, rgb);
+    // looking down with +z up in the image, +x is on the left
+    for (u32 y = 0; y < size; ++y) {
+        for (u32 x = 0; x < size; ++x) {
+            const f32* pixel = rgb + 3 * (y * size + x);
+            if (x < size / 2 - 1) {
+                EXPECTED_FLOAT_TO_BE(0.9f, pixel[0], 1e-4f);
+                EXPECTED_FLOAT_TO_BE(0.9f, pixel[2], 1e-4f);
+            } else if (x > size / 2) {
+                EXPECTED_FLOAT_TO_BE(0.25f, pixel[0], 1e-4f);
+                EXPECTED_FLOAT_TO_BE(0.5f, pixel[1], 1e-4f);
+                EXPECTED_FLOAT_TO_BE(0.75f, pixel[2], 1e-4f);
+            }
+        }
+    }
+    memory_free(rgb);
+    film_destroy(&f);
+    world_destroy(&w);
+    return TRUE;
+}
+
+// a floor under a large square light and one bounce: all the light arrives through next
+// event estimation, the bounce ray hitting the light must not count it twice. the floor
+// reflects albedo * emission * the form factor of the light
+u32 test_integrator_direct_light() {
+    const u32 size = 64;
+    test_world t;
+    memset(&t, 0, sizeof(t));
+    u32 floor = add_material(&t, MATERIAL_DIFFUSE, vec3_splat(0.5f), vec3_zero());
+    u32 light = add_material(&t, MATERIAL_DIFFUSE, vec3_zero(), vec3_splat(2));
+    add_plane(&t, 0, 100, TRUE, floor);
+    add_plane(&t, 1, 4, FALSE, light);
+    world w;
+    test_world_create(&w, &t, vec3_zero(), 0);
+    EXPECTED_TO_BE(2, w.light_count);
+    camera c;
+    camera_look_at(&c, vec3_make(0, 0.5f, 0), vec3_make(0, 0, 0), vec3_make(0, 0, 1), 30, size, size);
+    sampler_options sampler_opts;
+    sampler_options_default(&sampler_opts, size, size);
+    sampler_opts.samples_per_pixel = 16;
+    sampler s;
+    sampler_create(&s, &sampler_opts);
+    film f;
+    film_create_box(&f, size, size, 16);
+    wavefront_options options;
+    wavefront_options_default(&options);
+    options.samples_per_pixel = 16;
+    options.max_depth = 1;
+    options.sampler = &s;
+    wavefront_render(&f, &w, &c, &options, 0, 0);
+    f32* rgb = (f32*)memory_allocate(sizeof(f32) * 3 * size * size);
+    film_resolve(&f, rgb);
+    f64 sum = 0;
+    for (u32 i = 0; i < size * size; ++i) {
+        sum += rgb[i * 3 + 1];
+    }
+    // parallel square of half side a at height h: 4 / pi * x * atan(x) with x = a / sqrt(a^2 + h^2)
+    f32 x = 4.0f / sqrtf(17.0f);
+    f32 expected = 0.5f * 2.0f * 4.0f / PI * x * atanf(x);
+    EXPECTED_FLOAT_TO_BE(expected, (f32)(sum / (size * size)), 0.03f * expected);
+    memory_free(rgb);
+    film_destroy(&f);
+    sampler_destroy(&s);
+    world_destroy(&w);
+    return TRUE;
+}
+
+// the light is seen directly, the walls take the color of their paint
+u32 test_integrator_cornell() {
+    const u32 width = 48;
+    const u32 height = 48;
+    zpool pool;
+    zpool_create(&pool, 3);
+    world w;
+    camera c;
+    cornell_create(&w, &c, width, height, &pool);
+    film f;
+    film_create_box(&f, width, height, 16);
+    wavefront_options options;
+    wavefront_options_default(&options);
+    options.samples_per_pixel = 16;
+    integrator_stats stats;
+    wavefront_render(&f, &w, &c, &options, &pool, &stats);
+    EXPECTED_TO_BE((u64)width * height * 16, stats.camera_rays);
+    EXPECTED_TO_BE(TRUE, (stats.bounce_rays > stats.camera_rays && stats.shadow_rays > stats.camera_rays / 2));
+
+    f32* rgb = (f32*)memory_allocate(sizeof(f32) * 3 * width * height);
+    film_resolve(&f, rgb);
+    f32 brightest = 0;
+    f64 left[3] = {0}, right[3] = {0};
+    for (u32 y = 0; y < height; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            const f32* pixel = rgb + 3 * (y * width + x);
+            for (u32 k = 0; k < 3; ++k) {
+                EXPECTED_TO_BE(TRUE, (isfinite(pixel[k]) && pixel[k] >= 0));
+            }
+            brightest = maxf(brightest, pixel[1]);
+            // the side walls fill the outer columns
+            if (y > height / 4 && y < height * 3 / 4) {
+                f64* side = x < width / 8 ? left : (x >= width - width / 8 ? right : 0);
+                for (u32 k = 0; side && k < 3; ++k) {
+                    side[k] += pixel[k];
+                }
+            }
+        }
+    }
+    EXPECTED_FLOAT_TO_BE(12.0f, brightest, 0.5f);
+    EXPECTED_TO_BE(TRUE, (left[0] > 3 * left[1] && right[1] > 2 * right[0]));
+    memory_free(rgb);
+    film_destroy(&f);
+    world_destroy(&w);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+// sorting, wave size and thread count only change the order paths are processed in
+u32 test_integrator_wavefront_schedules() {
+    const u32 width = 40;
+    const u32 height = 28;
+    zpool pool;
+    zpool_create(&pool, 3);
+    world w;
+    camera c;
+    cornell_create(&w, &c, width, height, &pool);
+    wavefront_options options;
+    wavefront_options_default(&options);
+    options.samples_per_pixel = 8;
+    options.max_depth = 6;
+    options.seed = 11;
+
+    film reference;
+    film_create_box(&reference, width, height, 8);
+    wavefront_render(&reference, &w, &c, &options, 0, 0);
+    const struct {
+        bool sort;
+        u32 wave_size;
+        bool parallel;
+    } runs[4] = {{TRUE, 1u << 20, TRUE}, {FALSE, 1u << 20, TRUE}, {TRUE, 1000, TRUE}, {FALSE, 1, FALSE}};
+    for (u32 run = 0; run < 4; ++run) {
+        film f;
+        film_create_box(&f, width, height, 8);
+        options.sort = runs[run].sort;
+        options.wave_size = runs[run].wave_size;
+        wavefront_render(&f, &w, &c, &options, runs[run].parallel ? &pool : 0, 0);
+        for (u32 i = 0; i < width * height; ++i) {
+            const film_pixel* a = &reference.pixels[i];
+            const film_pixel* b = &f.pixels[i];
+            EXPECTED_FLOAT_TO_BE(a->weight, b->weight, 1e-4f);
+            EXPECTED_FLOAT_TO_BE(a->r, b->r, 1e-4f * (1 + a->r));
+            EXPECTED_FLOAT_TO_BE(a->g, b->g, 1e-4f * (1 + a->g));
+            EXPECTED_FLOAT_TO_BE(a->b, b->b, 1e-4f * (1 + a->b));
+        }
+        film_destroy(&f);
+    }
+    film_destroy(&reference);
+    world_destroy(&w);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+// both integrators run integrator_shade on the same sample values, only the schedule differs
+u32 test_integrator_megakernel_matches_wavefront() {
+    const u32 width = 36;
+    const u32 height = 30;
+    zpool pool;
+    zpool_create(&pool, 3);
+    world w;
+    camera c;
+    cornell_create(&w, &c, width, height, &pool);
+    film a, b;
+    film_create_box(&a, width, height, 8);
+    film_create_box(&b, width, height, 8);
+    megakernel_options mega;
+    megakernel_options_default(&mega);
+    mega.samples_per_pixel = 8;
+    mega.seed = 5;
+    mega.time_stages = TRUE;
+    integrator_stats mega_stats;
+    megakernel_render(&a, &w, &c, &mega, &pool, &mega_stats);
+    wavefront_options wave;
+    wavefront_options_default(&wave);
+    wave.samples_per_pixel = 8;
+    wave.seed = 5;
+    wave.sort = TRUE;
+    integrator_stats wave_stats;
+    wavefront_render(&b, &w, &c, &wave, &pool, &wave_stats);
+
+    for (u32 i = 0; i < width * height; ++i) {
+        EXPECTED_FLOAT_TO_BE(a.pixels[i].weight, b.pixels[i].weight, 1e-4f);
+        EXPECTED_FLOAT_TO_BE(a.pixels[i].r, b.pixels[i].r, 1e-4f * (1 + a.pixels[i].r));
+        EXPECTED_FLOAT_TO_BE(a.pixels[i].g, b.pixels[i].g, 1e-4f * (1 + a.pixels[i].g));
+        EXPECTED_FLOAT_TO_BE(a.pixels[i].b, b.pixels[i].b, 1e-4f * (1 + a.pixels[i].b));
+    }
+    EXPECTED_TO_BE(wave_stats.camera_rays, mega_stats.camera_rays);
+    EXPECTED_TO_BE(wave_stats.bounce_rays, mega_stats.bounce_rays);
+    EXPECTED_TO_BE(wave_stats.shadow_rays, mega_stats.shadow_rays);
+    EXPECTED_TO_BE(TRUE, (mega_stats.stage_seconds[INTEGRATOR_STAGE_INTERSECT] > 0));
+    EXPECTED_TO_BE(TRUE, (mega_stats.stage_seconds[INTEGRATOR_STAGE_SHADE] > 0));
+    EXPECTED_TO_BE(TRUE, (mega_stats.stage_seconds[INTEGRATOR_STAGE_SHADOW] > 0));
+    EXPECTED_TO_BE(TRUE, (integrator_rays_per_second(&mega_stats) > 0));
+    film_destroy(&a);
+    film_destroy(&b);
+    world_destroy(&w);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+// random lights seen from random surface points: sampling picks lights as often as
+// light_bvh_pmf says and a light that can shine on the point never gets probability 0.
+// the probabilities add up to less than 1 where the walk can end in a node whose bounds
+// reach the point while those of its children do not
+u32 test_integrator_light_bvh() {
+    const u32 light_count = 300;
+    rng r;
+    rng_seed(&r, 3, 0);
+    light_bounds* lights = (light_bounds*)memory_allocate(sizeof(light_bounds) * light_count);
+    point3* corners = (point3*)memory_allocate(sizeof(point3) * 3 * light_count);
+    for (u32 i = 0; i < light_count; ++i) {
+        point3 center = vec3_make(rng_range(&r, -5, 5), rng_range(&r, -5, 5), rng_range(&r, -5, 5));
+        for (u32 k = 0; k < 3; ++k) {
+            vec3 offset = vec3_make(rng_range(&r, -0.5f, 0.5f), rng_range(&r, -0.5f, 0.5f), rng_range(&r, -0.5f, 0.5f));
+            corners[3 * i + k] = vec3_add(center, offset);
+        }
+        lights[i] = light_bounds_triangle(corners[3 * i], corners[3 * i + 1], corners[3 * i + 2], rng_range(&r, 0.1f, 10.0f));
+    }
+    zpool pool;
+    zpool_create(&pool, 3);
+    light_bvh serial, parallel;
+    light_bvh_build(&serial, lights, light_count, 0);
+    light_bvh_build(&parallel, lights, light_count, &pool);
+    EXPECTED_TO_BE(2 * light_count - 1, serial.tree.node_count);
+    EXPECTED_TO_BE(serial.tree.node_count, parallel.tree.node_count);
+    EXPECTED_TO_BE(0, memcmp(serial.bounds, parallel.bounds, sizeof(light_bounds) * serial.tree.node_count));
+    f32 total = 0;
+    for (u32 i = 0; i < light_count; ++i) {
+        total += lights[i].phi;
+    }
+    EXPECTED_FLOAT_TO_BE(total, serial.bounds[0].phi, 1e-4f * total);
+
+    f32* pmf = (f32*)memory_allocate(sizeof(f32) * light_count);
+    u32* picked = (u32*)memory_allocate(sizeof(u32) * light_count);
+    const u32 draws = 100000;
+    for (u32 point = 0; point < 6; ++point) {
+        point3 p = vec3_make(rng_range(&r, -6, 6), rng_range(&r, -6, 6), rng_range(&r, -6, 6));
+        vec3 n = vec3_normalize(vec3_make(rng_range(&r, -1, 1), rng_range(&r, -1, 1), rng_range(&r, -1, 1)));
+        f64 sum = 0;
+        for (u32 i = 0; i < light_count; ++i) {
+            pmf[i] = light_bvh_pmf(&serial, p, n, i);
+            sum += pmf[i];
+            // a point on the light in front of it and above the surface must be reachable
+            point3 q = vec3_scale(vec3_add(vec3_add(corners[3 * i], corners[3 * i + 1]), corners[3 * i + 2]), 1.0f / 3.0f);
+            vec3 normal = vec3_make(lights[i].axis[0], lights[i].axis[1], lights[i].axis[2]);
+            vec3 to_light = vec3_sub(q, p);
+            if (vec3_dot(normal, to_light) < -1e-3f && vec3_dot(n, to_light) > 1e-3f) {
+                EXPECTED_TO_BE(TRUE, (pmf[i] > 0));
+            }
+        }
+        memset(picked, 0, sizeof(u32) * light_count);
+        u32 found = 0;
+        for (u32 d = 0; d < draws; ++d) {
+            u32 light;
+            f32 probability;
+            if (light_bvh_sample(&serial, p, n, ((f32)d + 0.5f) / (f32)draws, &light, &probability)) {
+                EXPECTED_FLOAT_TO_BE(pmf[light], probability, 1e-4f * (1 + pmf[light]));
+                picked[light]++;
+                found++;
+            }
+        }
+        EXPECTED_TO_BE(TRUE, (sum <= 1 + 1e-4));
+        EXPECTED_FLOAT_TO_BE((f32)found / (f32)draws, (f32)sum, 1e-3f);
+        // stratified draws land within a couple of draws of the expected count
+        for (u32 i = 0; i < light_count; ++i) {
+            EXPECTED_FLOAT_TO_BE(pmf[i] * draws, (f32)picked[i], 2.0f + 1e-3f * pmf[i] * draws);
+        }
+    }
+    memory_free(pmf);
+    memory_free(picked);
+    memory_free(lights);
+    memory_free(corners);
+    light_bvh_destroy(&serial);
+    light_bvh_destroy(&parallel);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+// both ways of picking lights converge to the same image, the light bvh with far less noise
+u32 test_integrator_many_lights() {
+    const u32 size = 48;
+    zpool pool;
+    zpool_create(&pool, 3);
+    f32* a = (f32*)memory_allocate(sizeof(f32) * 3 * size * size);
+    f32* b = (f32*)memory_allocate(sizeof(f32) * 3 * size * size);
+    f64 mean[2], rms[2];
+    for (u32 method = 0; method < 2; ++method) {
+        world w;
+        camera c;
+        many_lights_create(&w, &c, 16, method ? LIGHT_SAMPLING_UNIFORM : LIGHT_SAMPLING_BVH, size, size, &pool);
+        EXPECTED_TO_BE(2 * 16 * 16, w.light_count);
+        direct_light_render(&w, &c, 32, 1, &pool, a, 0);
+        direct_light_render(&w, &c, 32, 2, &pool, b, 0);
+        render_noise(a, b, 3 * size * size, &mean[method], &rms[method]);
+        world_destroy(&w);
+    }
+    EXPECTED_FLOAT_TO_BE(mean[1], mean[0], 0.05f * mean[1]);
+    EXPECTED_TO_BE(TRUE, (rms[0] * 2 < rms[1]));
+    memory_free(a);
+    memory_free(b);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+// sampled directions come with the pdf environment_pdf gives them and the radiance of the
+// texel they point at, and importance sampling integrates the map over the sphere: the
+// texel values times the solid angles they cover
+u32 test_integrator_environment() {
+    const u32 width = 64;
+    const u32 height = 32;
+    f32* rgb = sky_create(width, height);
+    environment_map e;
+    environment_create(&e, rgb, width, height, 0);
+    f64 expected = 0;
+    for (u32 y = 0; y < height; ++y) {
+        f64 solid_angle = 2.0 * PI / width * (cos(PI * y / height) - cos(PI * (y + 1) / height));
+        for (u32 x = 0; x < width; ++x) {
+            expected += rgb[3 * (y * width + x) + 1] * solid_angle;
+        }
+    }
+    const u32 side = 256;
+    f64 estimate = 0;
+    for (u32 j = 0; j < side; ++j) {
+        for (u32 i = 0; i < side; ++i) {
+            vec3 wi, radiance;
+            f32 pdf;
+            if (!environment_sample(&e, ((f32)j + 0.5f) / side, ((f32)i + 0.5f) / side, &wi, &radiance, &pdf)) {
+                continue;
+            }
+            EXPECTED_FLOAT_TO_BE(1, vec3_length(wi), 1e-5f);
+            EXPECTED_FLOAT_TO_BE(environment_pdf(&e, wi), pdf, 1e-3f * pdf);
+            vec3 seen = environment_lookup(&e, wi);
+            EXPECTED_FLOAT_TO_BE(seen.y, radiance.y, 0);
+            estimate += radiance.y / pdf;
+        }
+    }
+    EXPECTED_FLOAT_TO_BE((f32)expected, (f32)(estimate / (side * side)), 0.01f * (f32)expected);
+    // +y is row 0, +x column 0 and +z a quarter turn around
+    vec3 up = environment_lookup(&e, vec3_make(0, 1, 0));
+    vec3 down = environment_lookup(&e, vec3_make(0, -1, 0));
+    EXPECTED_TO_BE(TRUE, (up.z > 0.8f && down.z < 0.1f));
+    memory_free(rgb);
+    environment_destroy(&e);
+    return TRUE;
+}
+
+// the furnace under a white environment map instead of a white background: the diffuse
+// half now sees the sky only through next event estimation towards the map
+u32 test_integrator_environment_furnace() {
+    const u32 size = 32;
+    f32* rgb = (f32*)memory_allocate(sizeof(f32) * 3 * 32 * 16);
+    for (u32 i = 0; i < 3 * 32 * 16; ++i) {
+        rgb[i] = 1;
+    }
+    environment_map e;
+    environment_create(&e, rgb, 32, 16, 0);
+    test_world t;
+    memset(&t, 0, sizeof(t));
+    u32 diffuse = add_material(&t, MATERIAL_DIFFUSE, vec3_make(0.25f, 0.5f, 0.75f), vec3_zero());
+    u32 mirror = add_material(&t, MATERIAL_MIRROR, vec3_splat(0.9f), vec3_zero());
+    add_quad(&t, vec3_make(-100, 0, -100), vec3_make(-100, 0, 100), vec3_make(0, 0, 100), vec3_make(0, 0, -100), diffuse);
+    add_quad(&t, vec3_make(0, 0, -100), vec3_make(0, 0, 100), vec3_make(100, 0, 100), vec3_make(100, 0, -100), mirror);
+    world_desc desc;
+    desc.positions = t.positions;
+    desc.vertex_count = t.quad_count * 4;
+    desc.indices = t.indices;
+    desc.triangle_count = t.quad_count * 2;
+    desc.triangle_materials = t.triangle_materials;
+    desc.materials = t.materials;
+    desc.material_count = t.material_count;
+    desc.background = vec3_zero();
+    desc.light_sampling = LIGHT_SAMPLING_BVH;
+    desc.environment = &e;
+    world w;
+    world_create(&w, &desc, 0);
+    camera c;
+    camera_look_at(&c, vec3_make(0, 1, 0), vec3_make(0, 0, 0), vec3_make(0, 0, 1), 60, size, size);
+    film f;
+    film_create_box(&f, size, size, 8);
+    wavefront_options options;
+    wavefront_options_default(&options);
+    options.samples_per_pixel = 16;
+    wavefront_render(&f, &w, &c, &options, 0, 0);
+    f32* image = (f32*)memory_allocate(sizeof(f32) * 3 * size * size);
+    film_resolve(&f, image);
+    f64 diffuse_sum[3] = {0};
+    u32 diffuse_count = 0;
+    for (u32 y = 0; y < size; ++y) {
+        for (u32 x = 0; x < size; ++x) {
+            const f32* pixel = image + 3 * (y * size + x);
+            if (x < size / 2 - 1) {
+                EXPECTED_FLOAT_TO_BE(0.9f, pixel[0], 1e-4f);
+            } else if (x > size / 2) {
+                for (u32 k = 0; k < 3; ++k) {
+                    diffuse_sum[k] += pixel[k];
+                }
+                diffuse_count++;
+            }
+        }
+    }
+    EXPECTED_FLOAT_TO_BE(0.25f, (f32)(diffuse_sum[0] / diffuse_count), 0.01f);
+    EXPECTED_FLOAT_TO_BE(0.5f, (f32)(diffuse_sum[1] / diffuse_count), 0.02f);
+    EXPECTED_FLOAT_TO_BE(0.75f, (f32)(diffuse_sum[2] / diffuse_count), 0.03f);
+    memory_free(image);
+    memory_free(rgb);
+    film_destroy(&f);
+    world_destroy(&w);
+    environment_destroy(&e);
+    return TRUE;
+}
+
+static void log_stats(const char* name, const integrator_stats* stats) {
+    log_stdout("    %-10s %6.1f Mrays/s (%.3fs):", name, integrator_rays_per_second(stats) * 1e-6, stats->seconds);
+    for (u32 stage = 0; stage < INTEGRATOR_STAGE_COUNT; ++stage) {
+        log_stdout(" %s %.3fs", integrator_stage_name((integrator_stage)stage), stats->stage_seconds[stage]);
+    }
+    log_stdout("\n");
+}
+
+// a bumpy height field of 2 * cells^2 triangles under a light and a dim sky, big enough
+// that its bvh does not stay in cache
+static void terrain_create(world* w, camera* c, u32 cells, u32 width, u32 height, zpool* pool) {
+    u32 vertex_count = (cells + 1) * (cells + 1) + 4;
+    u32 triangle_count = 2 * cells * cells + 2;
+    point3* positions = (point3*)memory_allocate(sizeof(point3) * vertex_count);
+    u32* indices = (u32*)memory_allocate(sizeof(u32) * 3 * triangle_count);
+    u32* triangle_materials = (u32*)memory_allocate(sizeof(u32) * triangle_count);
+    for (u32 z = 0; z <= cells; ++z) {
+        for (u32 x = 0; x <= cells; ++x) {
+            f32 u = (f32)x / (f32)cells * 2 - 1, v = (f32)z / (f32)cells * 2 - 1;
+            f32 y = 0.08f * sinf(u * 23.0f) * cosf(v * 17.0f) + 0.03f * sinf((u + v) * 71.0f);
+            positions[z * (cells + 1) + x] = vec3_make(u, y, v);
+        }
+    }
+    u32* index = indices;
+    for (u32 z = 0; z < cells; ++z) {
+        for (u32 x = 0; x < cells; ++x) {
+            u32 v0 = z * (cells + 1) + x, v1 = v0 + 1, v2 = v0 + cells + 1, v3 = v2 + 1;
+            const u32 quad[6] = {v0, v2, v3, v0, v3, v1};
+            memcpy(index, quad, sizeof(quad));
+            index += 6;
+        }
+    }
+    memset(triangle_materials, 0, sizeof(u32) * triangle_count);
+    // a light above the middle, facing down
+    u32 light = vertex_count - 4;
+    positions[light + 0] = vec3_make(-0.3f, 1, -0.3f);
+    positions[light + 1] = vec3_make(0.3f, 1, -0.3f);
+    positions[light + 2] = vec3_make(0.3f, 1, 0.3f);
+    positions[light + 3] = vec3_make(-0.3f, 1, 0.3f);
+    const u32 light_quad[6] = {light, light + 1, light + 2, light, light + 2, light + 3};
+    memcpy(index, light_quad, sizeof(light_quad));
+    triangle_materials[triangle_count - 2] = 1;
+    triangle_materials[triangle_count - 1] = 1;
+    material materials[2];
+    materials[0].type = MATERIAL_DIFFUSE;
+    materials[0].albedo = vec3_make(0.6f, 0.55f, 0.5f);
+    materials[0].emission = vec3_zero();
+    materials[1].type = MATERIAL_DIFFUSE;
+    materials[1].albedo = vec3_zero();
+    materials[1].emission = vec3_splat(8);
+    world_desc desc = {positions, vertex_count, indices, triangle_count, triangle_materials, materials, 2, vec3_make(0.1f, 0.15f, 0.25f), LIGHT_SAMPLING_BVH, 0};
+    world_create(w, &desc, pool);
+    memory_free(positions);
+    memory_free(indices);
+    memory_free(triangle_materials);
+    camera_look_at(c, vec3_make(0, 0.6f, -1.6f), vec3_make(0, 0, 0), vec3_make(0, 1, 0), 50, width, height);
+}
+
+// --filter=integrator_bench_* gives meaningful numbers. the megakernel is the baseline, its
+// stage times are summed over threads and taken in a second, timed run
+u32 test_integrator_bench_integrators() {
+    const u32 width = 160;
+    const u32 height = 160;
+    zpool pool;
+    zpool_create(&pool, 0);
+    for (u32 scene = 0; scene < 2; ++scene) {
+        world w;
+        camera c;
+        if (scene == 0) {
+            cornell_create(&w, &c, width, height, &pool);
+        } else {
+            terrain_create(&w, &c, 512, width, height, &pool);
+        }
+        log_stdout("    %s, %u triangles\n", scene ? "terrain" : "cornell box", w.triangle_count);
+        film f;
+        film_create_box(&f, width, height, 16);
+        megakernel_options mega;
+        megakernel_options_default(&mega);
+        integrator_stats stats, timed;
+        megakernel_render(&f, &w, &c, &mega, &pool, &stats);
+        mega.time_stages = TRUE;
+        megakernel_render(&f, &w, &c, &mega, &pool, &timed);
+        memcpy(stats.stage_seconds, timed.stage_seconds, sizeof(stats.stage_seconds));
+        log_stats("megakernel", &stats);
+        EXPECTED_TO_BE((u64)width * height * 16, stats.camera_rays);
+
+        wavefront_options options;
+        wavefront_options_default(&options);
+        for (u32 sort = 0; sort < 2; ++sort) {
+            options.sort = sort;
+            wavefront_render(&f, &w, &c, &options, &pool, &stats);
+            log_stats(sort ? "sorted" : "wavefront", &stats);
+            EXPECTED_TO_BE((u64)width * height * 16, stats.camera_rays);
+        }
+        film_destroy(&f);
+        world_destroy(&w);
+    }
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+// --filter=integrator_bench_* gives meaningful numbers. noise is the rms difference of two
+// renders with different seeds, variance falls with 1 / spp, so uniform selection needs
+// (noise ratio)^2 times the samples for the noise of the light bvh
+u32 test_integrator_bench_light_sampling() {
+    const u32 size = 128;
+    const u32 spp = 4;
+    zpool pool;
+    zpool_create(&pool, 0);
+    f32* a = (f32*)memory_allocate(sizeof(f32) * 3 * size * size);
+    f32* b = (f32*)memory_allocate(sizeof(f32) * 3 * size * size);
+    const u32 grids[2] = {16, 64};
+    for (u32 g = 0; g < 2; ++g) {
+        f64 rms[2], seconds[2];
+        for (u32 method = 0; method < 2; ++method) {
+            world w;
+            camera c;
+            many_lights_create(&w, &c, grids[g], method ? LIGHT_SAMPLING_UNIFORM : LIGHT_SAMPLING_BVH, size, size, &pool);
+            integrator_stats stats;
+            f64 mean;
+            direct_light_render(&w, &c, spp, 1, &pool, a, &stats);
+            direct_light_render(&w, &c, spp, 2, &pool, b, 0);
+            render_noise(a, b, 3 * size * size, &mean, &rms[method]);
+            rms[method] /= mean;
+            seconds[method] = stats.seconds;
+            if (!method) {
+                log_stdout("    %u lights, light bvh built in %.2fms\n", w.light_count, w.light_tree.build_seconds * 1e3);
+            }
+            log_stdout("    %-8s %u spp: relative noise %.4f in %.3fs\n", method ? "uniform" : "bvh", spp, rms[method], seconds[method]);
+            world_destroy(&w);
+        }
+        f64 ratio = (rms[1] * rms[1]) / (rms[0] * rms[0]);
+        log_stdout("    uniform needs %.1fx the samples for equal noise, %.1fx the time\n", ratio, ratio * seconds[1] / seconds[0]);
+        EXPECTED_TO_BE(TRUE, (ratio > 1));
+    }
+    memory_free(a);
+    memory_free(b);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+void register_integrator_testcases() {
+    test_manager_add(test_integrator_camera, "integrator_camera");
+    test_manager_add(test_integrator_furnace, "integrator_furnace");
+    test_manager_add(test_integrator_direct_light, "integrator_direct_light");
+    test_manager_add(test_integrator_cornell, "integrator_cornell");
+    test_manager_add(test_integrator_wavefront_schedules, "integrator_wavefront_schedules");
+    test_manager_add(test_integrator_megakernel_matches_wavefront, "integrator_megakernel_matches_wavefront");
+    test_manager_add(test_integrator_light_bvh, "integrator_light_bvh");
+    test_manager_add(test_integrator_many_lights, "integrator_many_lights");
+    test_manager_add(test_integrator_environment, "integrator_environment");
+    test_manager_add(test_integrator_environment_furnace, "integrator_environment_furnace");
+    test_manager_add(test_integrator_bench_integrators, "integrator_bench_integrators");
+    test_manager_add(test_integrator_bench_light_sampling, "integrator_bench_light_sampling");
+}
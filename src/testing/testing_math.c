@@ -0,0 +1,342 @@
+// the math headers pull in immintrin.h, which declares malloc and free, so they go before memory.h
+#include "vec3.h"
+#include "mat4.h"
+#include "transform.h"
+#include "test_manager.h"
+#include "memory.h"
+#include "clock.h"
+#include "logger.h"
+
+#define MATH_EPSILON 1e-4f
+
+// ============================================================================
+// VEC3 TESTS
+// ============================================================================
+
+u32 test_vec3_layout() {
+    STATIC_ASSERT(sizeof(vec3) == 16);
+    STATIC_ASSERT(sizeof(mat4) == 64);
+    vec3 v = vec3_make(1, 2, 3);
+    EXPECTED_FLOAT_TO_BE(1.0f, v.e[0], 0.0f);
+    EXPECTED_FLOAT_TO_BE(2.0f, v.e[1], 0.0f);
+    EXPECTED_FLOAT_TO_BE(3.0f, v.e[2], 0.0f);
+    EXPECTED_FLOAT_TO_BE(0.0f, v.w, 0.0f);
+    return TRUE;
+}
+
+u32 test_vec3_arithmetic() {
+    vec3 a = vec3_make(1, 2, 3);
+    vec3 b = vec3_make(4, -5, 6);
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(5, -3, 9), vec3_add(a, b), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(-3, 7, -3), vec3_sub(a, b), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(4, -10, 18), vec3_mul(a, b), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(0.25f, -0.4f, 0.5f), vec3_div(a, b), MATH_EPSILON));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(2, 4, 6), vec3_scale(a, 2), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(9, -8, 15), vec3_madd(a, b, 2), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(1, 2, 3), vec3_abs(vec3_neg(a)), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(1, -5, 3), vec3_min(a, b), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(4, 2, 6), vec3_max(a, b), 0));
+    EXPECTED_FLOAT_TO_BE(0.0f, vec3_div(a, b).w, 0.0f);
+    EXPECTED_FLOAT_TO_BE(12.0f, vec3_dot(a, b), 0.0f);
+    EXPECTED_TO_BE(2, vec3_max_dimension(b));
+    EXPECTED_FLOAT_TO_BE(-5.0f, vec3_min_component(b), 0.0f);
+    return TRUE;
+}
+
+u32 test_vec3_cross_and_normalize() {
+    vec3 x = vec3_make(1, 0, 0);
+    vec3 y = vec3_make(0, 1, 0);
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(0, 0, 1), vec3_cross(x, y), 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(0, 0, -1), vec3_cross(y, x), 0));
+
+    vec3 a = vec3_make(3, -2, 7);
+    vec3 b = vec3_make(-1, 5, 2);
+    vec3 c = vec3_cross(a, b);
+    EXPECTED_FLOAT_TO_BE(0.0f, vec3_dot(c, a), MATH_EPSILON);
+    EXPECTED_FLOAT_TO_BE(0.0f, vec3_dot(c, b), MATH_EPSILON);
+    EXPECTED_FLOAT_TO_BE(0.0f, c.w, 0.0f);
+
+    vec3 n = vec3_normalize(a);
+    EXPECTED_FLOAT_TO_BE(1.0f, vec3_length(n), MATH_EPSILON);
+    EXPECTED_FLOAT_TO_BE(0.0f, n.w, 0.0f);
+
+    vec3 v2, v3;
+    vec3_coordinate_system(n, &v2, &v3);
+    EXPECTED_FLOAT_TO_BE(0.0f, vec3_dot(n, v2), MATH_EPSILON);
+    EXPECTED_FLOAT_TO_BE(0.0f, vec3_dot(n, v3), MATH_EPSILON);
+    EXPECTED_FLOAT_TO_BE(0.0f, vec3_dot(v2, v3), MATH_EPSILON);
+    EXPECTED_FLOAT_TO_BE(1.0f, vec3_length(v2), MATH_EPSILON);
+    return TRUE;
+}
+
+// ============================================================================
+// MAT4 AND TRANSFORM TESTS
+// ============================================================================
+
+u32 test_mat4_mul_and_inverse() {
+    mat4 a;
+    mat4_make(&a, 2, 0, 1, 3, 1, 3, 0, -1, 0, 1, 4, 2, 1, 0, 0, 1);
+    mat4 inv;
+    EXPECTED_TO_BE(TRUE, mat4_inverse(&a, &inv));
+
+    mat4 id, product;
+    mat4_identity(&id);
+    mat4_mul(&a, &inv, &product);
+    EXPECTED_TO_BE(TRUE, mat4_equal(&id, &product, MATH_EPSILON));
+    mat4_mul(&inv, &a, &product);
+    EXPECTED_TO_BE(TRUE, mat4_equal(&id, &product, MATH_EPSILON));
+
+    // aliasing the output with an input must still produce a * a
+    mat4 square, aliased = a;
+    mat4_mul(&a, &a, &square);
+    mat4_mul(&aliased, &aliased, &aliased);
+    EXPECTED_TO_BE(TRUE, mat4_equal(&square, &aliased, 0));
+    f32 expected = 2.0f * 2 + 0 * 1 + 1 * 0 + 3 * 1;
+    EXPECTED_FLOAT_TO_BE(expected, square.m[0][0], 0.0f);
+
+    mat4 singular;
+    mat4_make(&singular, 1, 2, 3, 4, 2, 4, 6, 8, 0, 1, 0, 1, 1, 1, 1, 1);
+    EXPECTED_TO_BE(FALSE, mat4_inverse(&singular, &inv));
+    EXPECTED_FLOAT_TO_BE(0.0f, mat4_determinant(&singular), 0.0f);
+
+    mat4 t;
+    mat4_transpose(&a, &t);
+    EXPECTED_FLOAT_TO_BE(a.m[0][3], t.m[3][0], 0.0f);
+    EXPECTED_FLOAT_TO_BE(a.m[2][1], t.m[1][2], 0.0f);
+    return TRUE;
+}
+
+u32 test_transform_apply() {
+    transform translate, scale, rotate, composed;
+    transform_translate(vec3_make(1, 2, 3), &translate);
+    transform_scale(2, 2, 2, &scale);
+    transform_rotate_z(90, &rotate);
+
+    // rotate first, then scale, then translate
+    transform_compose(&scale, &rotate, &composed);
+    transform_compose(&translate, &composed, &composed);
+
+    point3 p = transform_point(&composed, vec3_make(1, 0, 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(1, 4, 3), p, MATH_EPSILON));
+    vec3 v = transform_vector(&composed, vec3_make(1, 0, 0));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(0, 2, 0), v, MATH_EPSILON));
+
+    transform inverse;
+    transform_inverse(&composed, &inverse);
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(1, 0, 0), transform_point(&inverse, p), MATH_EPSILON));
+
+    // a normal of the plane x = y stays perpendicular to it under non uniform scale
+    transform stretch;
+    transform_scale(4, 1, 1, &stretch);
+    normal3 n = transform_normal(&stretch, vec3_make(1, -1, 0));
+    vec3 tangent = transform_vector(&stretch, vec3_make(1, 1, 0));
+    EXPECTED_FLOAT_TO_BE(0.0f, vec3_dot(n, tangent), MATH_EPSILON);
+
+    transform axis;
+    transform_rotate(90, vec3_make(0, 0, 3), &axis);
+    EXPECTED_TO_BE(TRUE, mat4_equal(&rotate.m, &axis.m, MATH_EPSILON));
+    EXPECTED_TO_BE(FALSE, transform_has_scale(&rotate, MATH_EPSILON));
+    EXPECTED_TO_BE(TRUE, transform_has_scale(&composed, MATH_EPSILON));
+
+    transform mirror;
+    transform_scale(-1, 1, 1, &mirror);
+    EXPECTED_TO_BE(TRUE, transform_swaps_handedness(&mirror));
+    EXPECTED_TO_BE(FALSE, transform_swaps_handedness(&rotate));
+    return TRUE;
+}
+
+u32 test_transform_camera() {
+    transform look_at;
+    EXPECTED_TO_BE(TRUE, transform_look_at(vec3_make(0, 0, -5), vec3_make(0, 0, 0), vec3_make(0, 1, 0), &look_at));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(0, 0, 5), transform_point(&look_at, vec3_make(0, 0, 0)), MATH_EPSILON));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(1, 0, 5), transform_point(&look_at, vec3_make(1, 0, 0)), MATH_EPSILON));
+    EXPECTED_TO_BE(FALSE, transform_look_at(vec3_make(0, 0, 0), vec3_make(0, 1, 0), vec3_make(0, 1, 0), &look_at));
+
+    transform persp;
+    EXPECTED_TO_BE(TRUE, transform_perspective(90, 1, 100, &persp));
+    point3 near = transform_point(&persp, vec3_make(1, 1, 1));
+    point3 far = transform_point(&persp, vec3_make(0, 0, 100));
+    EXPECTED_TO_BE(TRUE, vec3_equal(vec3_make(1, 1, 0), near, MATH_EPSILON));
+    EXPECTED_FLOAT_TO_BE(1.0f, far.z, MATH_EPSILON);
+    return TRUE;
+}
+
+// ============================================================================
+// MICRO BENCHMARKS
+// ============================================================================
+
+// throughput of the simd paths against plain scalar loops over the same arrays, the
+// scalar loops are left for the compiler to auto vectorize so the ratio is honest.
+// run a release build with --filter=math_bench_* --iterations=N for stable numbers
+
+#define BENCH_COUNT 4096
+#define BENCH_ROUNDS 64
+
+static void report(const char* name, f64 simd_seconds, f64 scalar_seconds) {
+    f64 ops = (f64)BENCH_COUNT * BENCH_ROUNDS;
+    // printed directly so the numbers survive release builds where LOGI compiles out
+    log_stdout("    %s: %.2f ns/op simd, %.2f ns/op scalar (%.2fx)\n",
+               name,
+               simd_seconds * 1e9 / ops,
+               scalar_seconds * 1e9 / ops,
+               scalar_seconds / (simd_seconds > 0 ? simd_seconds : 1e-12));
+}
+
+static vec3* bench_points() {
+    vec3* points = (vec3*)memory_allocate(sizeof(vec3) * BENCH_COUNT);
+    for (u32 i = 0; i < BENCH_COUNT; ++i) {
+        points[i] = vec3_make((f32)(i % 17) - 8, (f32)(i % 31) * 0.5f, (f32)(i % 7) + 1);
+    }
+    return points;
+}
+
+u32 test_math_bench_mat4_mul() {
+    mat4* inputs = (mat4*)memory_allocate(sizeof(mat4) * BENCH_COUNT);
+    mat4* simd_out = (mat4*)memory_allocate(sizeof(mat4) * BENCH_COUNT);
+    mat4* scalar_out = (mat4*)memory_allocate(sizeof(mat4) * BENCH_COUNT);
+    for (u32 i = 0; i < BENCH_COUNT; ++i) {
+        for (u32 k = 0; k < 16; ++k) {
+            inputs[i].m[k / 4][k % 4] = (f32)((i + k * 7) % 13) * 0.25f - 1.0f;
+        }
+    }
+    mat4 m;
+    mat4_make(&m, 0.5f, 0.1f, 0, 1, -0.1f, 0.5f, 0.2f, 0, 0, -0.2f, 0.5f, 2, 0, 0, 0, 1);
+
+    clock clk;
+    clock_set(&clk);
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_COUNT; ++i) {
+            mat4_mul(&inputs[i], &m, &simd_out[i]);
+        }
+    }
+    clock_update(&clk);
+    f64 simd_seconds = clk.elapsed;
+
+    clock_set(&clk);
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_COUNT; ++i) {
+            const f32(*a)[4] = inputs[i].m;
+            for (u32 r = 0; r < 4; ++r) {
+                for (u32 c = 0; c < 4; ++c) {
+                    scalar_out[i].m[r][c] =
+                        a[r][0] * m.m[0][c] + a[r][1] * m.m[1][c] + a[r][2] * m.m[2][c] + a[r][3] * m.m[3][c];
+                }
+            }
+        }
+    }
+    clock_update(&clk);
+    report("mat4_mul", simd_seconds, clk.elapsed);
+
+    bool equal = TRUE;
+    for (u32 i = 0; i < BENCH_COUNT; ++i) {
+        equal = equal && mat4_equal(&scalar_out[i], &simd_out[i], MATH_EPSILON);
+    }
+    memory_free(inputs);
+    memory_free(simd_out);
+    memory_free(scalar_out);
+    EXPECTED_TO_BE(TRUE, equal);
+    return TRUE;
+}
+
+u32 test_math_bench_transform_point() {
+    vec3* points = bench_points();
+    vec3* simd_out = (vec3*)memory_allocate(sizeof(vec3) * BENCH_COUNT);
+    vec3* scalar_out = (vec3*)memory_allocate(sizeof(vec3) * BENCH_COUNT);
+    transform t, r;
+    transform_rotate(30, vec3_make(1, 1, 0), &r);
+    transform_translate(vec3_make(1, -2, 3), &t);
+    transform_compose(&t, &r, &t);
+
+    clock clk;
+    clock_set(&clk);
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_COUNT; ++i) {
+            simd_out[i] = transform_point(&t, points[i]);
+        }
+    }
+    clock_update(&clk);
+    f64 simd_seconds = clk.elapsed;
+
+    const f32(*a)[4] = t.m.m;
+    clock_set(&clk);
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_COUNT; ++i) {
+            const f32* p = points[i].e;
+            f32 inv_w = 1.0f / (a[3][0] * p[0] + a[3][1] * p[1] + a[3][2] * p[2] + a[3][3]);
+            for (u32 k = 0; k < 3; ++k) {
+                scalar_out[i].e[k] = (a[k][0] * p[0] + a[k][1] * p[1] + a[k][2] * p[2] + a[k][3]) * inv_w;
+            }
+            scalar_out[i].w = 0;
+        }
+    }
+    clock_update(&clk);
+    report("transform_point", simd_seconds, clk.elapsed);
+
+    bool equal = TRUE;
+    for (u32 i = 0; i < BENCH_COUNT; ++i) {
+        equal = equal && vec3_equal(scalar_out[i], simd_out[i], MATH_EPSILON);
+    }
+    memory_free(points);
+    memory_free(simd_out);
+    memory_free(scalar_out);
+    EXPECTED_TO_BE(TRUE, equal);
+    return TRUE;
+}
+
+u32 test_math_bench_vec3_normalize_cross() {
+    vec3* points = bench_points();
+    vec3* simd_out = (vec3*)memory_allocate(sizeof(vec3) * BENCH_COUNT);
+    vec3* scalar_out = (vec3*)memory_allocate(sizeof(vec3) * BENCH_COUNT);
+
+    // no bench point is parallel to the axis (they all have y >= 0 and z >= 1)
+    vec3 axis = vec3_make(0.3f, -0.7f, 0.2f);
+    clock clk;
+    clock_set(&clk);
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_COUNT; ++i) {
+            simd_out[i] = vec3_normalize(vec3_cross(axis, points[i]));
+        }
+    }
+    clock_update(&clk);
+    f64 simd_seconds = clk.elapsed;
+
+    // a plain copy, taking the address of axis would keep it in memory during the simd loop
+    const f32 axis_scalar[3] = {0.3f, -0.7f, 0.2f};
+    clock_set(&clk);
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_COUNT; ++i) {
+            const f32* a = axis_scalar;
+            const f32* b = points[i].e;
+            f32 c[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+            f32 inv = 1.0f / sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+            for (u32 k = 0; k < 3; ++k) {
+                scalar_out[i].e[k] = c[k] * inv;
+            }
+            scalar_out[i].w = 0;
+        }
+    }
+    clock_update(&clk);
+    report("vec3_normalize_cross", simd_seconds, clk.elapsed);
+
+    bool equal = TRUE;
+    for (u32 i = 0; i < BENCH_COUNT; ++i) {
+        equal = equal && vec3_equal(scalar_out[i], simd_out[i], MATH_EPSILON);
+    }
+    memory_free(points);
+    memory_free(simd_out);
+    memory_free(scalar_out);
+    EXPECTED_TO_BE(TRUE, equal);
+    return TRUE;
+}
+
+void register_math_testcases() {
+    test_manager_add(test_vec3_layout, "vec3_layout");
+    test_manager_add(test_vec3_arithmetic, "vec3_arithmetic");
+    test_manager_add(test_vec3_cross_and_normalize, "vec3_cross_and_normalize");
+    test_manager_add(test_mat4_mul_and_inverse, "mat4_mul_and_inverse");
+    test_manager_add(test_transform_apply, "transform_apply");
+    test_manager_add(test_transform_camera, "transform_camera");
+    test_manager_add(test_math_bench_mat4_mul, "math_bench_mat4_mul");
+    test_manager_add(test_math_bench_transform_point, "math_bench_transform_point");
+    test_manager_add(test_math_bench_vec3_normalize_cross, "math_bench_vec3_normalize_cross");
+}
@@ -1,7 +1,15 @@
+#include "rng.h"
 #include "test_manager.h"
 #include "memory.h"
 #include "zthread.h"
 #include "logger.h"
+#include "arena.h"
+#include <stdio.h>
+
+#ifdef PLATFORM_LINUX
+#    include <unistd.h>
+#    include <sys/wait.h>
+#endif
 
 // ============================================================================
 // BASIC ALLOCATION TESTS
@@ -89,6 +97,51 @@ u32 test_memory_very_large_allocation() {
     return TRUE;
 }
 
+// sizes past 4 GB reach the system allocator whole, only the touched pages become resident
+u32 test_memory_allocation_above_4gb() {
+    u64 size = (4ull << 30) + 4096;
+    u8* aligned = (u8*)memory_allocate_aligned(size, 64);
+    EXPECTED_NOT_TO_BE(0, (u64)aligned);
+    aligned[0] = 1;
+    aligned[size - 1] = 2;
+    EXPECTED_TO_BE(2, aligned[size - 1]);
+    memory_stats stats;
+    memory_get_stats(&stats);
+    EXPECTED_TO_BE(TRUE, (stats.allocated_memory > size));
+    memory_free_aligned(aligned);
+
+    arena a;
+    arena_create(&a, 1 << 20);
+    u8* block = (u8*)arena_allocate(&a, size, 16);
+    block[0] = 1;
+    block[size - 1] = 2;
+    EXPECTED_TO_BE(2, block[size - 1]);
+    EXPECTED_TO_BE(TRUE, (arena_bytes_reserved(&a) >= size));
+    arena_destroy(&a);
+    return TRUE;
+}
+
+#ifdef PLATFORM_LINUX
+// a size that wraps once the alignment padding is added traps instead of returning a tiny block
+u32 test_memory_aligned_size_overflow() {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        u8* block = (u8*)memory_allocate_aligned(~0ull - 8, 64);
+        block[0] = 1;
+        _exit(0);
+    }
+    i32 status = 0;
+    waitpid(pid, &status, 0);
+    EXPECTED_TO_BE(TRUE, WIFSIGNALED(status));
+    // the child's crash report
+    char path[64];
+    log_buffer(path, sizeof(path), "pbrt_testing_crash_%u.txt", (u32)pid);
+    remove(path);
+    return TRUE;
+}
+#endif
+
 // ============================================================================
 // DATA INTEGRITY TESTS
 // ============================================================================
@@ -359,11 +412,19 @@ u32 test_memory_random_order() {
         EXPECTED_NOT_TO_BE(0, (u64)ptrs[i]);
     }
 
-    // Free in pseudo-random order
-    u32 indices[] = {7, 23, 5, 41, 12, 38, 3, 29, 15, 47, 1, 34, 19, 45, 8, 26,
-                     11, 39, 4, 32, 18, 44, 2, 28, 14, 40, 6, 33, 20, 46, 0, 27,
-                     13, 37, 9, 35, 21, 43, 10, 36, 22, 48, 16, 42, 17, 49, 24,
-                     25, 30, 31};
+    // Free in a shuffled order
+    u32 indices[50];
+    rng r;
+    rng_seed(&r, 50, 0);
+    for (u32 i = 0; i < 50; i++) {
+        indices[i] = i;
+    }
+    for (u32 i = 49; i > 0; i--) {
+        u32 j = rng_bounded(&r, i + 1);
+        u32 t = indices[i];
+        indices[i] = indices[j];
+        indices[j] = t;
+    }
 
     for (u32 i = 0; i < 50; i++) {
         memory_free(ptrs[indices[i]]);
@@ -543,9 +604,11 @@ u32 test_memory_stress_many_allocations() {
 
 u32 test_memory_stress_varying_sizes() {
     void* ptrs[500];
+    rng r;
+    rng_seed(&r, 500, 0);
 
     for (u32 i = 0; i < 500; i++) {
-        u32 size = ((i * 97) % 1024) + 1;
+        u32 size = rng_bounded(&r, 1024) + 1;
         ptrs[i] = memory_allocate(size);
         EXPECTED_NOT_TO_BE(0, (u64)ptrs[i]);
     }
@@ -582,8 +645,10 @@ u32 test_memory_stress_with_realloc() {
         EXPECTED_NOT_TO_BE(0, (u64)ptrs[i]);
     }
 
+    rng r;
+    rng_seed(&r, 100, 0);
     for (u32 i = 0; i < 100; i++) {
-        u32 new_size = ((i * 73) % 2048) + 128;
+        u32 new_size = rng_bounded(&r, 2048) + 128;
         ptrs[i] = memory_reallocate(ptrs[i], new_size);
         EXPECTED_NOT_TO_BE(0, (u64)ptrs[i]);
     }
@@ -873,8 +938,11 @@ zthread_func_return_type thread_realloc_stress(void* params) {
         return 0;
     }
 
+    // every thread draws from its own stream
+    rng r;
+    rng_seed_stream(&r, 37, data->thread_id);
     for (u32 i = 0; i < data->num_allocations; i++) {
-        u32 new_size = ((i * 37 + data->thread_id) % 4096) + 64;
+        u32 new_size = rng_bounded(&r, 4096) + 64;
         ptr = memory_reallocate(ptr, new_size);
         if (ptr == 0) {
             data->success = FALSE;
@@ -918,9 +986,11 @@ u32 test_memory_concurrent_realloc_stress() {
 zthread_func_return_type thread_varying_sizes(void* params) {
     thread_alloc_data* data = (thread_alloc_data*)params;
     void** ptrs = malloc(sizeof(void*) * data->num_allocations);
+    rng r;
+    rng_seed_stream(&r, 97, data->thread_id);
 
     for (u32 i = 0; i < data->num_allocations; i++) {
-        u32 size = ((i * 97 + data->thread_id * 13) % 8192) + 1;
+        u32 size = rng_bounded(&r, 8192) + 1;
         ptrs[i] = memory_allocate(size);
         if (ptrs[i] == 0) {
             data->success = FALSE;
@@ -1167,11 +1237,15 @@ u32 test_memory_lifecycle_complete() {
 }
 
 u32 test_memory_torture_test() {
+    rng r;
+    rng_seed(&r, 73, 0);
     for (u32 iteration = 0; iteration < 5; iteration++) {
         void* ptrs[100];
+        u32 sizes[100];
 
         for (u32 i = 0; i < 100; i++) {
-            u32 size = ((i * 73 + iteration * 17) % 2048) + 1;
+            u32 size = rng_bounded(&r, 2048) + 1;
+            sizes[i] = size;
             ptrs[i] = memory_allocate(size);
             EXPECTED_NOT_TO_BE(0, (u64)ptrs[i]);
 
@@ -1182,8 +1256,8 @@ u32 test_memory_torture_test() {
         }
 
         for (u32 i = 0; i < 100; i += 3) {
-            u32 old_size = ((i * 73 + iteration * 17) % 2048) + 1;
-            u32 new_size = ((i * 97 + iteration * 23) % 4096) + 1;
+            u32 old_size = sizes[i];
+            u32 new_size = rng_bounded(&r, 4096) + 1;
             u32 check_size = (new_size < old_size) ? new_size : old_size;
 
             ptrs[i] = memory_reallocate(ptrs[i], new_size);
@@ -1200,7 +1274,7 @@ u32 test_memory_torture_test() {
         }
 
         for (u32 i = 1; i < 100; i += 5) {
-            u32 size = ((i * 53) % 1024) + 1;
+            u32 size = rng_bounded(&r, 1024) + 1;
             ptrs[i] = memory_allocate(size);
             EXPECTED_NOT_TO_BE(0, (u64)ptrs[i]);
         }
@@ -1213,6 +1287,93 @@ u32 test_memory_torture_test() {
     return TRUE;
 }
 
+// ============================================================================
+// TRACKER STATISTICS TESTS
+// ============================================================================
+
+u32 test_memory_stats_counters() {
+    memory_stats before;
+    memory_stats after;
+    memory_reset_peak();
+    memory_get_stats(&before);
+
+    void* ptr1 = memory_allocate(1000);
+    void* ptr2 = memory_allocate(3000);
+    memory_free(ptr1);
+    ptr2 = memory_reallocate(ptr2, 500);
+
+    memory_get_stats(&after);
+    EXPECTED_TO_BE(2, after.allocation_count - before.allocation_count);
+    EXPECTED_TO_BE(1, after.reallocation_count - before.reallocation_count);
+    EXPECTED_TO_BE(1, after.free_count - before.free_count);
+    EXPECTED_TO_BE(4500, after.total_allocated - before.total_allocated);
+    EXPECTED_TO_BE(500, after.allocated_memory - before.allocated_memory);
+    EXPECTED_TO_BE(4000, after.peak_memory - before.allocated_memory);
+
+    memory_reset_peak();
+    memory_get_stats(&after);
+    EXPECTED_TO_BE(after.allocated_memory, after.peak_memory);
+
+    memory_free(ptr2);
+    return TRUE;
+}
+
+u32 test_memory_aligned_allocation() {
+    u32 alignments[] = {1, 16, 32, 64, 4096};
+    void* ptrs[5];
+    for (u32 i = 0; i < 5; ++i) {
+        ptrs[i] = memory_allocate_aligned(100 + i, alignments[i]);
+        EXPECTED_TO_BE(0, ((u64)ptrs[i] & (alignments[i] - 1)));
+        u8* bytes = (u8*)ptrs[i];
+        for (u32 j = 0; j < 100 + i; ++j) {
+            bytes[j] = (u8)j;
+        }
+    }
+    for (u32 i = 0; i < 5; ++i) {
+        EXPECTED_TO_BE(99, ((u8*)ptrs[i])[99]);
+        memory_free_aligned(ptrs[i]);
+    }
+    return TRUE;
+}
+
+u32 test_memory_arena() {
+    memory_stats before, after;
+    memory_get_stats(&before);
+    arena a;
+    arena_create(&a, 1024);
+    u8* first = (u8*)arena_allocate(&a, 10, 1);
+    u64* second = (u64*)arena_allocate(&a, sizeof(u64) * 4, 8);
+    EXPECTED_TO_BE(0, ((u64)second & 7));
+    EXPECTED_TO_BE(TRUE, ((u8*)second >= first + 10));
+    for (u32 i = 0; i < 4; ++i) {
+        second[i] = i;
+    }
+    // spills into a second block, then a dedicated block for the oversized request
+    void* third = arena_allocate(&a, 1000, 64);
+    EXPECTED_TO_BE(0, ((u64)third & 63));
+    void* big = arena_allocate(&a, 5000, 16);
+    EXPECTED_NOT_TO_BE(0, (u64)big);
+    EXPECTED_TO_BE(10 + 32 + 1000 + 5000, arena_bytes_used(&a));
+    EXPECTED_TO_BE(1024 + 1024 + 5000, arena_bytes_reserved(&a));
+    EXPECTED_TO_BE(3, second[3]);
+
+    // a reset reuses the blocks without asking memory.h for more
+    memory_get_stats(&after);
+    u64 allocations = after.allocation_count;
+    arena_reset(&a);
+    EXPECTED_TO_BE(0, arena_bytes_used(&a));
+    EXPECTED_TO_BE((u64)first, (u64)arena_allocate(&a, 10, 1));
+    arena_allocate(&a, 4000, 8);
+    memory_get_stats(&after);
+    EXPECTED_TO_BE(allocations, after.allocation_count);
+    EXPECTED_TO_BE(1024 + 1024 + 5000, arena_bytes_reserved(&a));
+
+    arena_destroy(&a);
+    memory_get_stats(&after);
+    EXPECTED_TO_BE(before.allocated_memory, after.allocated_memory);
+    return TRUE;
+}
+
 // ============================================================================
 // MAIN TEST REGISTRATION
 // ============================================================================
@@ -1220,13 +1381,17 @@ u32 test_memory_torture_test() {
 void register_memory_testcases() {
 
     // Basic allocation tests
-    test_manager_add(test_memory_single_allocation, "single_allocation");
-    test_manager_add(test_memory_multiple_different_sizes, "multiple_different_sizes");
-    test_manager_add(test_memory_allocation_uniqueness, "allocation_uniqueness");
-    test_manager_add(test_memory_power_of_two_sizes, "power_of_two_sizes");
+    test_manager_add_budget(test_memory_single_allocation, "single_allocation", 128, 1);
+    test_manager_add_budget(test_memory_multiple_different_sizes, "multiple_different_sizes", 69905, 5);
+    test_manager_add_budget(test_memory_allocation_uniqueness, "allocation_uniqueness", 6400, 100);
+    test_manager_add_budget(test_memory_power_of_two_sizes, "power_of_two_sizes", (1 << 20) - 1, 20);
     test_manager_add(test_memory_odd_sizes, "odd_sizes");
     test_manager_add(test_memory_large_allocation, "large_allocation");
     test_manager_add(test_memory_very_large_allocation, "very_large_allocation");
+    test_manager_add(test_memory_allocation_above_4gb, "allocation_above_4gb");
+#ifdef PLATFORM_LINUX
+    test_manager_add(test_memory_aligned_size_overflow, "aligned_size_overflow");
+#endif
 
     // Data integrity tests
     test_manager_add(test_memory_write_read_bytes, "write_read_bytes");
@@ -1291,4 +1456,9 @@ void register_memory_testcases() {
     // Comprehensive integration tests
     test_manager_add(test_memory_lifecycle_complete, "lifecycle_complete");
     test_manager_add(test_memory_torture_test, "torture_test");
+
+    // Tracker statistics tests (budgeted so they never overlap other tests)
+    test_manager_add_budget(test_memory_stats_counters, "stats_counters", 4500, 3);
+    test_manager_add(test_memory_aligned_allocation, "aligned_allocation");
+    test_manager_add_budget(test_memory_arena, "arena", 0, 4);
 }
\ No newline at end of file
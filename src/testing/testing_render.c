@@ -0,0 +1,656 @@
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include "film.h"
+#include "render.h"
+#include "checkpoint.h"
+#include "math_utils.h"
+#include "test_manager.h"
+#include "arena.h"
+#include "clock.h"
+#include "zatomic.h"
+#include "memory.h"
+#include "zpool.h"
+#include "logger.h"
+#include "platform.h"
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// smooth colors varying across the image, so misplaced samples change the result
+static void gradient_sample(void* params, const render_sample* sample, f32* rgb) {
+    const film* f = (const film*)params;
+    rgb[0] = sample->film_x / (f32)f->width;
+    rgb[1] = sample->film_y / (f32)f->height;
+    rgb[2] = 0.25f + 0.5f * sinf(sample->film_x * 0.1f) * cosf(sample->film_y * 0.1f);
+}
+
+static void constant_sample(void* params, const render_sample* sample, f32* rgb) {
+    const f32* color = (const f32*)params;
+    rgb[0] = color[0];
+    rgb[1] = color[1];
+    rgb[2] = color[2];
+}
+
+// noise around a mean of 0.5 growing from nothing on the left edge to +-0.5 on the right,
+// so the samples a pixel needs grow with the square of x
+static void noisy_sample(void* params, const render_sample* sample, f32* rgb) {
+    const film* f = (const film*)params;
+    u32 h = (sample->y * f->width + sample->x) * 2654435761u ^ sample->index * 0x85ebca6bu;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    f32 u = (f32)(h >> 8) * (1.0f / (f32)(1u << 24));
+    f32 value = 0.5f + (f32)sample->x / (f32)f->width * (u - 0.5f);
+    rgb[0] = value;
+    rgb[1] = value;
+    rgb[2] = value;
+}
+
+static void film_create_sized(film* f, u32 width, u32 height, u32 tile_size, film_filter_type filter) {
+    film_options options;
+    film_options_default(&options, width, height);
+    options.tile_size = tile_size;
+    film_filter_default(&options.filter, filter);
+    film_create(f, &options);
+}
+
+static void film_create_tracked(film* f, u32 width, u32 height, u32 tile_size) {
+    film_options options;
+    film_options_default(&options, width, height);
+    options.tile_size = tile_size;
+    options.track_variance = TRUE;
+    film_create(f, &options);
+}
+
+// ============================================================================
+// FILM TESTS
+// ============================================================================
+
+u32 test_render_filters() {
+    film_filter box, triangle, gaussian, mitchell;
+    film_filter_default(&box, FILM_FILTER_BOX);
+    film_filter_default(&triangle, FILM_FILTER_TRIANGLE);
+    film_filter_default(&gaussian, FILM_FILTER_GAUSSIAN);
+    film_filter_default(&mitchell, FILM_FILTER_MITCHELL);
+    EXPECTED_FLOAT_TO_BE(0.5f, box.radius, 1e-6f);
+    EXPECTED_FLOAT_TO_BE(1.5f, gaussian.radius, 1e-6f);
+
+    EXPECTED_FLOAT_TO_BE(1, film_filter_evaluate(&box, 0.4f, -0.4f), 1e-6f);
+    EXPECTED_FLOAT_TO_BE(0, film_filter_evaluate(&box, 0.6f, 0), 1e-6f);
+    EXPECTED_FLOAT_TO_BE(4, film_filter_evaluate(&triangle, 0, 0), 1e-6f);
+    EXPECTED_FLOAT_TO_BE(1, film_filter_evaluate(&triangle, 1, -1), 1e-6f);
+    EXPECTED_FLOAT_TO_BE(0, film_filter_evaluate(&triangle, 2, 0), 1e-6f);
+    EXPECTED_FLOAT_TO_BE(0, film_filter_evaluate(&gaussian, 1.5f, 0), 1e-6f);
+    EXPECTED_TO_BE(TRUE, (film_filter_evaluate(&gaussian, 0, 0) > film_filter_evaluate(&gaussian, 0.5f, 0)));
+    // mitchell-netravali peaks at (6 - 2b) / 6 and dips below zero past half its radius
+    f32 peak = (6 - 2 * mitchell.b) / 6;
+    EXPECTED_FLOAT_TO_BE((peak * peak), film_filter_evaluate(&mitchell, 0, 0), 1e-5f);
+    EXPECTED_TO_BE(TRUE, (film_filter_evaluate(&mitchell, 1.5f, 0) < 0));
+    EXPECTED_FLOAT_TO_BE(0, film_filter_evaluate(&mitchell, 2, 0), 1e-6f);
+    return TRUE;
+}
+
+// tile bounds, aprons clipped at the image edges and the partial tiles on the far sides
+u32 test_render_film_tiles() {
+    film f;
+    film_create_sized(&f, 100, 70, 32, FILM_FILTER_GAUSSIAN);
+    EXPECTED_TO_BE(4, f.tiles_x);
+    EXPECTED_TO_BE(3, f.tiles_y);
+    EXPECTED_TO_BE(12, f.tile_count);
+    EXPECTED_TO_BE(2, f.apron);
+
+    arena a;
+    arena_create(&a, 64 * 1024);
+    film_tile tile;
+    film_tile_begin(&f, 0, &a, &tile);
+    EXPECTED_TO_BE(0, tile.buffer_x);
+    EXPECTED_TO_BE(0, tile.buffer_y);
+    EXPECTED_TO_BE(34, tile.buffer_width);
+    EXPECTED_TO_BE(34, tile.buffer_height);
+    film_tile_begin(&f, 5, &a, &tile);
+    EXPECTED_TO_BE(32, tile.x0);
+    EXPECTED_TO_BE(64, tile.x1);
+    EXPECTED_TO_BE(30, tile.buffer_x);
+    EXPECTED_TO_BE(36, tile.buffer_width);
+    film_tile_begin(&f, 11, &a, &tile);
+    EXPECTED_TO_BE(96, tile.x0);
+    EXPECTED_TO_BE(100, tile.x1);
+    EXPECTED_TO_BE(64, tile.y0);
+    EXPECTED_TO_BE(70, tile.y1);
+    EXPECTED_TO_BE(6, tile.buffer_width);
+    EXPECTED_TO_BE(8, tile.buffer_height);
+    for (u32 i = 0; i < tile.buffer_width * tile.buffer_height; ++i) {
+        EXPECTED_TO_BE(TRUE, (tile.pixels[i].weight == 0));
+    }
+    arena_destroy(&a);
+    film_destroy(&f);
+    return TRUE;
+}
+
+// a sample near a tile corner lands partly in the apron, after merging every pixel holds
+// the filter weight at its distance from the sample
+u32 test_render_film_splat() {
+    film f;
+    film_create_sized(&f, 64, 64, 16, FILM_FILTER_TRIANGLE);
+    arena a;
+    arena_create(&a, 64 * 1024);
+    film_tile tile;
+    film_tile_begin(&f, 5, &a, &tile);
+    const f32 rgb[3] = {1, 2, 3};
+    f32 x = 16.3f;
+    f32 y = 17.8f;
+    film_tile_add_sample(&f, &tile, x, y, rgb);
+    film_tile_merge(&f, &tile);
+    f32 total = 0;
+    for (u32 py = 0; py < f.height; ++py) {
+        for (u32 px = 0; px < f.width; ++px) {
+            const film_pixel* p = &f.pixels[py * f.width + px];
+            f32 expected = film_filter_evaluate(&f.filter, px + 0.5f - x, py + 0.5f - y);
+            // the table is piecewise constant over 1/16 of the radius
+            EXPECTED_FLOAT_TO_BE(expected, p->weight, 0.3f);
+            EXPECTED_FLOAT_TO_BE((p->weight * 3), p->b, 1e-5f);
+            total += p->weight;
+        }
+    }
+    // 4x4 pixels reached, left of the tile included
+    EXPECTED_TO_BE(TRUE, (f.pixels[17 * f.width + 15].weight > 0));
+    EXPECTED_TO_BE(TRUE, (total > 0));
+    arena_destroy(&a);
+    film_destroy(&f);
+    return TRUE;
+}
+
+// ============================================================================
+// RENDER TESTS
+// ============================================================================
+
+u32 test_render_schedule() {
+    film f;
+    film_create_sized(&f, 200, 120, 16, FILM_FILTER_BOX);
+    u32* tiles = (u32*)memory_allocate(sizeof(u32) * f.tile_count);
+    u8* seen = (u8*)memory_allocate(f.tile_count);
+    for (u32 order = RENDER_ORDER_SCANLINE; order <= RENDER_ORDER_CENTER_OUT; ++order) {
+        render_schedule_tiles(&f, (render_tile_order)order, tiles);
+        memset(seen, 0, f.tile_count);
+        for (u32 i = 0; i < f.tile_count; ++i) {
+            EXPECTED_TO_BE(TRUE, (tiles[i] < f.tile_count));
+            EXPECTED_TO_BE(0, seen[tiles[i]]);
+            seen[tiles[i]] = 1;
+        }
+    }
+    // the first tile holds the center pixel
+    u32 first = tiles[0];
+    u32 x0 = (first % f.tiles_x) * f.tile_size;
+    u32 y0 = (first / f.tiles_x) * f.tile_size;
+    EXPECTED_TO_BE(TRUE, (x0 <= 100 && x0 + 16 >= 100 && y0 <= 60 && y0 + 16 >= 60));
+    memory_free(seen);
+    memory_free(tiles);
+    film_destroy(&f);
+    return TRUE;
+}
+
+// with filter weights normalized out, a constant radiance resolves to itself everywhere,
+// image borders and tile seams included
+u32 test_render_constant_image() {
+    zpool pool;
+    zpool_create(&pool, 3);
+    f32 color[3] = {0.25f, 0.5f, 2};
+    f32* rgb = (f32*)memory_allocate(sizeof(f32) * 3 * 97 * 61);
+    for (u32 filter = FILM_FILTER_BOX; filter <= FILM_FILTER_MITCHELL; ++filter) {
+        film f;
+        film_create_sized(&f, 97, 61, 16, (film_filter_type)filter);
+        render_options options;
+        render_options_default(&options);
+        options.samples_per_pixel = 4;
+        render_film(&f, &options, constant_sample, color, &pool);
+        film_resolve(&f, rgb);
+        for (u32 i = 0; i < 97 * 61; ++i) {
+            EXPECTED_FLOAT_TO_BE(color[0], rgb[i * 3 + 0], 1e-4f);
+            EXPECTED_FLOAT_TO_BE(color[1], rgb[i * 3 + 1], 1e-4f);
+            EXPECTED_FLOAT_TO_BE(color[2], rgb[i * 3 + 2], 1e-4f);
+        }
+        film_destroy(&f);
+    }
+    memory_free(rgb);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+// the same image on one thread and on several, only the order of the apron additions may
+// differ
+u32 test_render_parallel_matches_serial() {
+    film serial, parallel;
+    film_create_sized(&serial, 150, 90, 16, FILM_FILTER_GAUSSIAN);
+    film_create_sized(&parallel, 150, 90, 16, FILM_FILTER_GAUSSIAN);
+    render_options options;
+    render_options_default(&options);
+    options.samples_per_pixel = 8;
+    options.seed = 7;
+    render_film(&serial, &options, gradient_sample, &serial, 0);
+    zpool pool;
+    zpool_create(&pool, 3);
+    options.order = RENDER_ORDER_SCANLINE;
+    render_film(&parallel, &options, gradient_sample, &parallel, &pool);
+    zpool_destroy(&pool);
+    for (u32 i = 0; i < 150 * 90; ++i) {
+        EXPECTED_FLOAT_TO_BE(serial.pixels[i].weight, parallel.pixels[i].weight, 1e-4f);
+        EXPECTED_FLOAT_TO_BE(serial.pixels[i].r, parallel.pixels[i].r, 1e-4f);
+        EXPECTED_FLOAT_TO_BE(serial.pixels[i].g, parallel.pixels[i].g, 1e-4f);
+        EXPECTED_FLOAT_TO_BE(serial.pixels[i].b, parallel.pixels[i].b, 1e-4f);
+    }
+    film_destroy(&parallel);
+    film_destroy(&serial);
+    return TRUE;
+}
+
+// ============================================================================
+// CHECKPOINT TESTS
+// ============================================================================
+
+static bool films_identical(const film* a, const film* b) {
+    return a->width == b->width && a->height == b->height &&
+           memcmp(a->pixels, b->pixels, sizeof(film_pixel) * a->width * a->height) == 0;
+}
+
+u32 test_render_checkpoint_roundtrip() {
+    char path[64];
+    log_buffer(path, sizeof(path), "render_checkpoint_%u.bin", platform_process_id());
+    film f, loaded, other;
+    film_create_sized(&f, 70, 50, 16, FILM_FILTER_MITCHELL);
+    film_create_sized(&loaded, 70, 50, 16, FILM_FILTER_MITCHELL);
+    film_create_sized(&other, 70, 50, 16, FILM_FILTER_GAUSSIAN);
+    render_options options;
+    render_options_default(&options);
+    options.samples_per_pixel = 2;
+    render_film(&f, &options, gradient_sample, &f, 0);
+
+    render_checkpoint state = {0x1234567890ull, 2, 1, 2 * 70 * 50, SAMPLER_SOBOL, 64};
+    render_checkpoint read = {0};
+    EXPECTED_TO_BE(FALSE, render_checkpoint_read(path, &loaded, &read));
+    EXPECTED_TO_BE(TRUE, render_checkpoint_write(path, &f, &state));
+    EXPECTED_TO_BE(TRUE, render_checkpoint_read(path, &loaded, &read));
+    EXPECTED_TO_BE(TRUE, films_identical(&f, &loaded));
+    EXPECTED_TO_BE(TRUE, (read.seed == state.seed));
+    EXPECTED_TO_BE(2, read.samples_done);
+    EXPECTED_TO_BE(1, read.passes);
+    EXPECTED_TO_BE(TRUE, (read.samples_taken == state.samples_taken));
+    EXPECTED_TO_BE(SAMPLER_SOBOL, read.sampler_type);
+    EXPECTED_TO_BE(64, read.samples_per_pixel);
+    // another filter means other pixel sums, the checkpoint does not apply
+    EXPECTED_TO_BE(FALSE, render_checkpoint_read(path, &other, &read));
+
+    // a file cut short, as a copy interrupted midway would leave it
+    platform_file_mapping mapping;
+    EXPECTED_TO_BE(TRUE, platform_file_map(path, &mapping));
+    u8* copy = (u8*)memory_allocate((u32)mapping.size);
+    memcpy(copy, mapping.data, mapping.size);
+    u64 size = mapping.size;
+    platform_file_unmap(&mapping);
+    platform_file file;
+    EXPECTED_TO_BE(TRUE, platform_file_open(path, PLATFORM_FILE_WRITE, &file));
+    platform_file_write(&file, copy, size - 100);
+    platform_file_close(&file);
+    film_clear(&loaded);
+    EXPECTED_TO_BE(FALSE, render_checkpoint_read(path, &loaded, &read));
+    EXPECTED_TO_BE(TRUE, (loaded.pixels[0].weight == 0));
+
+    memory_free(copy);
+    remove(path);
+    film_destroy(&other);
+    film_destroy(&loaded);
+    film_destroy(&f);
+    return TRUE;
+}
+
+typedef struct stopping_sampler {
+    const film* f;
+    volatile u32 stop;
+    u32 stop_at_sample;
+} stopping_sampler;
+
+// raises the stop flag once a sample with index stop_at_sample is taken, as a preemption
+// signal arriving mid pass would
+static void stopping_sample(void* params, const render_sample* sample, f32* rgb) {
+    stopping_sampler* s = (stopping_sampler*)params;
+    gradient_sample((void*)s->f, sample, rgb);
+    if (sample->index == s->stop_at_sample) {
+        s->stop = 1;
+    }
+}
+
+// a render stopped halfway and resumed from its checkpoint ends with exactly the pixels of
+// one that ran through
+u32 test_render_progressive_resume() {
+    char path[64];
+    log_buffer(path, sizeof(path), "render_progressive_%u.bin", platform_process_id());
+    remove(path);
+    film reference, resumed;
+    film_create_sized(&reference, 90, 70, 16, FILM_FILTER_GAUSSIAN);
+    film_create_sized(&resumed, 90, 70, 16, FILM_FILTER_GAUSSIAN);
+    render_progressive_options options;
+    render_progressive_options_default(&options);
+    options.render.samples_per_pixel = 16;
+    options.render.seed = 99;
+    options.samples_per_pass = 4;
+    render_checkpoint progress;
+    EXPECTED_TO_BE(TRUE, render_progressive(&reference, &options, gradient_sample, &reference, 0, &progress));
+    EXPECTED_TO_BE(16, progress.samples_done);
+    EXPECTED_TO_BE(4, progress.passes);
+
+    stopping_sampler stopping = {&resumed, 0, 5};
+    options.checkpoint_path = path;
+    options.stop = &stopping.stop;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, stopping_sample, &stopping, 0, &progress));
+    EXPECTED_TO_BE(8, progress.samples_done);
+    EXPECTED_TO_BE(FALSE, films_identical(&reference, &resumed));
+
+    // a new process: the film starts out empty and only the checkpoint remembers
+    film_clear(&resumed);
+    stopping.stop = 0;
+    stopping.stop_at_sample = 0xffffffffu;
+    options.resume = TRUE;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, stopping_sample, &stopping, 0, &progress));
+    EXPECTED_TO_BE(16, progress.samples_done);
+    EXPECTED_TO_BE(4, progress.passes);
+    EXPECTED_TO_BE(TRUE, films_identical(&reference, &resumed));
+
+    // another seed would continue a different sequence, the render starts over instead
+    options.render.seed = 100;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, gradient_sample, &resumed, 0, &progress));
+    EXPECTED_TO_BE(4, progress.passes);
+
+    // so would another sample count or sampler type. stopping at sample 0 ends a render
+    // that starts over after its first pass, a wrongly resumed one would run to the end
+    options.render.samples_per_pixel = 32;
+    stopping.stop = 0;
+    stopping.stop_at_sample = 0;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, stopping_sample, &stopping, 0, &progress));
+    EXPECTED_TO_BE(4, progress.samples_done);
+
+    sampler_options sobol_options;
+    sampler_options_default(&sobol_options, 90, 70);
+    sobol_options.samples_per_pixel = 32;
+    sobol_options.seed = 100;
+    sampler sobol;
+    sampler_create(&sobol, &sobol_options);
+    options.render.sampler = &sobol;
+    stopping.stop = 0;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, stopping_sample, &stopping, 0, &progress));
+    EXPECTED_TO_BE(4, progress.samples_done);
+
+    // the same sampler picks up where it stopped
+    stopping.stop = 0;
+    stopping.stop_at_sample = 4;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, stopping_sample, &stopping, 0, &progress));
+    EXPECTED_TO_BE(8, progress.samples_done);
+    EXPECTED_TO_BE(2, progress.passes);
+    sampler_destroy(&sobol);
+
+    remove(path);
+    film_destroy(&resumed);
+    film_destroy(&reference);
+    return TRUE;
+}
+
+// ============================================================================
+// ADAPTIVE TESTS
+// ============================================================================
+
+u32 test_render_pixel_error() {
+    film f;
+    film_create_tracked(&f, 4, 4, 4);
+    EXPECTED_TO_BE(TRUE, (film_pixel_error(&f, 0, 0) == MAX_F32));
+    // samples 1, 3, 1, 3: mean 2, sample variance 4/3, standard error sqrt(1/3) relative to 2
+    for (u32 i = 0; i < 4; ++i) {
+        f32 v = i % 2 ? 3.0f : 1.0f;
+        f32 rgb[3] = {v, v, v};
+        film_record_sample(&f, 1, 2, rgb);
+    }
+    EXPECTED_TO_BE(4, f.stats[2 * 4 + 1].count);
+    EXPECTED_FLOAT_TO_BE(2, f.stats[2 * 4 + 1].mean, 1e-5f);
+    EXPECTED_FLOAT_TO_BE((sqrtf(1.0f / 3.0f) / 2), film_pixel_error(&f, 1, 2), 1e-5f);
+    // constant samples have converged, whatever their value
+    for (u32 i = 0; i < 3; ++i) {
+        f32 rgb[3] = {0, 0, 0};
+        film_record_sample(&f, 3, 3, rgb);
+    }
+    EXPECTED_FLOAT_TO_BE(0, film_pixel_error(&f, 3, 3), 1e-6f);
+    EXPECTED_TO_BE(TRUE, (film_tile_error(&f, 0) == MAX_F32));
+    film_destroy(&f);
+    return TRUE;
+}
+
+// pixels stop once their error is below the threshold, the noiseless left side after the
+// minimum, and the whole film takes a fraction of the samples of a uniform render
+u32 test_render_adaptive() {
+    const u32 width = 128;
+    const u32 height = 64;
+    film f;
+    film_create_tracked(&f, width, height, 16);
+    render_progressive_options options;
+    render_progressive_options_default(&options);
+    options.render.samples_per_pixel = 256;
+    options.render.error_threshold = 0.05f;
+    options.samples_per_pass = 8;
+    options.min_samples = 16;
+    render_checkpoint progress;
+    EXPECTED_TO_BE(TRUE, render_progressive(&f, &options, noisy_sample, &f, 0, &progress));
+    u64 total = 0;
+    for (u32 y = 0; y < height; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            u32 count = f.stats[y * width + x].count;
+            total += count;
+            EXPECTED_TO_BE(TRUE, (count == 256 || film_pixel_error(&f, x, y) < 0.05f * 1.001f));
+            EXPECTED_TO_BE(TRUE, (count >= 16));
+        }
+    }
+    EXPECTED_TO_BE(TRUE, (total == progress.samples_taken));
+    EXPECTED_TO_BE(16, f.stats[5 * width].count);
+    EXPECTED_TO_BE(TRUE, (f.stats[5 * width + width - 1].count > 128));
+    EXPECTED_TO_BE(TRUE, (total * 2 < 256ull * width * height));
+
+    // the decisions depend on the statistics alone, any thread count takes the same samples
+    film parallel;
+    film_create_tracked(&parallel, width, height, 16);
+    zpool pool;
+    zpool_create(&pool, 3);
+    EXPECTED_TO_BE(TRUE, render_progressive(&parallel, &options, noisy_sample, &parallel, &pool, &progress));
+    zpool_destroy(&pool);
+    EXPECTED_TO_BE(0, memcmp(f.stats, parallel.stats, sizeof(film_pixel_stats) * width * height));
+    EXPECTED_TO_BE(TRUE, (total == progress.samples_taken));
+    film_destroy(&parallel);
+    film_destroy(&f);
+    return TRUE;
+}
+
+// an adaptive render stopped midway resumes with the per pixel counts it had
+u32 test_render_adaptive_resume() {
+    char path[64];
+    log_buffer(path, sizeof(path), "render_adaptive_%u.bin", platform_process_id());
+    remove(path);
+    film reference, resumed;
+    film_create_tracked(&reference, 64, 48, 16);
+    film_create_tracked(&resumed, 64, 48, 16);
+    render_progressive_options options;
+    render_progressive_options_default(&options);
+    options.render.samples_per_pixel = 128;
+    options.render.error_threshold = 0.05f;
+    options.samples_per_pass = 8;
+    render_checkpoint full, partial;
+    EXPECTED_TO_BE(TRUE, render_progressive(&reference, &options, noisy_sample, &reference, 0, &full));
+
+    // preempted after 40 samples per pixel
+    options.checkpoint_path = path;
+    options.render.samples_per_pixel = 40;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, noisy_sample, &resumed, 0, &partial));
+    EXPECTED_TO_BE(40, partial.samples_done);
+    film_clear(&resumed);
+    options.render.samples_per_pixel = 128;
+    options.resume = TRUE;
+    EXPECTED_TO_BE(TRUE, render_progressive(&resumed, &options, noisy_sample, &resumed, 0, &partial));
+    EXPECTED_TO_BE(TRUE, (full.samples_taken == partial.samples_taken));
+    EXPECTED_TO_BE(full.passes, partial.passes);
+    EXPECTED_TO_BE(TRUE, films_identical(&reference, &resumed));
+    EXPECTED_TO_BE(0, memcmp(reference.stats, resumed.stats, sizeof(film_pixel_stats) * 64 * 48));
+
+    remove(path);
+    film_destroy(&resumed);
+    film_destroy(&reference);
+    return TRUE;
+}
+
+static f32 film_max_error(const film* f) {
+    f32 error = 0;
+    for (u32 i = 0; i < f->tile_count; ++i) {
+        error = maxf(error, film_tile_error(f, i));
+    }
+    return error;
+}
+
+// samples and time an adaptive render needs to bring every pixel below an error threshold,
+// against uniform passes until the worst pixel gets there
+u32 test_render_bench_adaptive() {
+    const u32 width = 640;
+    const u32 height = 360;
+    const f32 threshold = 0.05f;
+    zpool pool;
+    zpool_create(&pool, 0);
+    film f;
+    film_create_tracked(&f, width, height, 32);
+    render_progressive_options options;
+    render_progressive_options_default(&options);
+    options.render.samples_per_pixel = 1024;
+    options.render.error_threshold = threshold;
+    options.samples_per_pass = 16;
+    render_checkpoint adaptive;
+    clock clk;
+    clock_set(&clk);
+    render_progressive(&f, &options, noisy_sample, &f, &pool, &adaptive);
+    clock_update(&clk);
+    f64 adaptive_seconds = clk.elapsed;
+    // release builds may vectorize the tile error with approximate division, a pixel right at
+    // the threshold can come out a hair above it
+    EXPECTED_TO_BE(TRUE, (film_max_error(&f) < threshold * 1.001f));
+
+    film_clear(&f);
+    render_options pass;
+    render_options_default(&pass);
+    pass.samples_per_pixel = options.samples_per_pass;
+    u32 uniform_spp = 0;
+    clock_set(&clk);
+    while (uniform_spp < options.render.samples_per_pixel && (uniform_spp == 0 || film_max_error(&f) >= threshold)) {
+        render_film(&f, &pass, noisy_sample, &f, &pool);
+        uniform_spp += pass.samples_per_pixel;
+    }
+    clock_update(&clk);
+    f64 adaptive_spp = (f64)adaptive.samples_taken / (width * height);
+    log_stdout("    adaptive %ux%u to error %.2f: %.1f spp average in %.2fs, uniform %u spp in %.2fs (%.1fx the samples)\n",
+               width,
+               height,
+               threshold,
+               adaptive_spp,
+               adaptive_seconds,
+               uniform_spp,
+               clk.elapsed,
+               uniform_spp / adaptive_spp);
+    EXPECTED_TO_BE(TRUE, (adaptive_spp < uniform_spp));
+    film_destroy(&f);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+typedef struct atomic_splat_job {
+    film* f;
+    u32 samples_per_pixel;
+} atomic_splat_job;
+
+// the approach tiles replace: every sample splatted straight into the shared image with
+// atomic adds
+static void atomic_splat_task(void* params, u64 index, u32 thread_index) {
+    atomic_splat_job* job = (atomic_splat_job*)params;
+    film* f = job->f;
+    u32 y = (u32)index;
+    f32 rgb[3];
+    render_sample s = {0};
+    for (u32 x = 0; x < f->width; ++x) {
+        for (u32 k = 0; k < job->samples_per_pixel; ++k) {
+            s.film_x = x + (k + 0.5f) / job->samples_per_pixel;
+            s.film_y = y + 0.5f;
+            gradient_sample(f, &s, rgb);
+            f32 dx = s.film_x - 0.5f;
+            f32 dy = s.film_y - 0.5f;
+            i32 r = (i32)f->apron;
+            for (i32 py = (i32)y - r; py <= (i32)y + r; ++py) {
+                for (i32 px = (i32)x - r; px <= (i32)x + r; ++px) {
+                    if (px < 0 || py < 0 || px >= (i32)f->width || py >= (i32)f->height) {
+                        continue;
+                    }
+                    f32 w = film_filter_evaluate(&f->filter, px - dx, py - dy);
+                    if (w != 0) {
+                        film_pixel* p = &f->pixels[py * f->width + px];
+                        zatomic_add_f32(&p->r, w * rgb[0]);
+                        zatomic_add_f32(&p->g, w * rgb[1]);
+                        zatomic_add_f32(&p->b, w * rgb[2]);
+                        zatomic_add_f32(&p->weight, w);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// splat throughput of tiles against atomics on the shared image, a release build with
+// --filter=render_bench_* gives meaningful numbers
+u32 test_render_bench_film() {
+    const u32 width = 1280;
+    const u32 height = 720;
+    const u32 spp = 8;
+    zpool pool;
+    zpool_create(&pool, 0);
+    film f;
+    film_create_sized(&f, width, height, 32, FILM_FILTER_GAUSSIAN);
+    render_options options;
+    render_options_default(&options);
+    options.samples_per_pixel = spp;
+    clock clk;
+    clock_set(&clk);
+    render_film(&f, &options, gradient_sample, &f, &pool);
+    clock_update(&clk);
+    f64 tile_seconds = clk.elapsed;
+
+    film_clear(&f);
+    atomic_splat_job job = {&f, spp};
+    clock_set(&clk);
+    zpool_parallel_for(&pool, height, 4, atomic_splat_task, &job);
+    clock_update(&clk);
+    f64 atomic_seconds = clk.elapsed;
+    f64 samples = (f64)width * height * spp;
+    log_stdout("    film %ux%u, %u spp, %u threads: tiles %.1f Msamples/s, shared atomics %.1f Msamples/s\n",
+               width,
+               height,
+               spp,
+               zpool_thread_count(&pool),
+               samples / tile_seconds * 1e-6,
+               samples / atomic_seconds * 1e-6);
+    film_destroy(&f);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+void register_render_testcases() {
+    test_manager_add(test_render_filters, "render_filters");
+    test_manager_add(test_render_film_tiles, "render_film_tiles");
+    test_manager_add(test_render_film_splat, "render_film_splat");
+    test_manager_add(test_render_schedule, "render_schedule");
+    test_manager_add(test_render_constant_image, "render_constant_image");
+    test_manager_add(test_render_parallel_matches_serial, "render_parallel_matches_serial");
+    test_manager_add(test_render_checkpoint_roundtrip, "render_checkpoint_roundtrip");
+    test_manager_add(test_render_progressive_resume, "render_progressive_resume");
+    test_manager_add(test_render_pixel_error, "render_pixel_error");
+    test_manager_add(test_render_adaptive, "render_adaptive");
+    test_manager_add(test_render_adaptive_resume, "render_adaptive_resume");
+    test_manager_add(test_render_bench_film, "render_bench_film");
+    test_manager_add(test_render_bench_adaptive, "render_bench_adaptive");
+}
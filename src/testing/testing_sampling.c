@@ -0,0 +1,880 @@
+#include <math.h>
+#include <string.h>
+#include "sobol.h"
+#include "halton.h"
+#include "sampler.h"
+#include "distribution.h"
+#include "rng.h"
+#include "film.h"
+#include "render.h"
+#include "math_utils.h"
+#include "test_manager.h"
+#include "clock.h"
+#include "memory.h"
+#include "zpool.h"
+#include "logger.h"
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// TRUE when the count points (u[i], v[i]) are a (0, m, 2) net: every partition of the unit
+// square into 2^k x 2^(m - k) boxes holds exactly one point per box
+static bool is_net(const f32* u, const f32* v, u32 m) {
+    u32 count = 1u << m;
+    u8* hits = (u8*)memory_allocate(count);
+    bool net = TRUE;
+    for (u32 k = 0; k <= m && net; ++k) {
+        memset(hits, 0, count);
+        for (u32 i = 0; i < count; ++i) {
+            u32 bx = (u32)(u[i] * (f32)(1u << k));
+            u32 by = (u32)(v[i] * (f32)(1u << (m - k)));
+            u32 box = (by << k) | bx;
+            if (u[i] < 0 || u[i] >= 1 || v[i] < 0 || v[i] >= 1 || hits[box]) {
+                net = FALSE;
+                break;
+            }
+            hits[box] = 1;
+        }
+    }
+    memory_free(hits);
+    return net;
+}
+
+// TRUE when the count values fall one into each of count equal intervals
+static bool is_stratified(const f32* values, u32 count) {
+    u8 hits[256] = {0};
+    for (u32 i = 0; i < count; ++i) {
+        u32 bin = (u32)(values[i] * (f32)count);
+        if (values[i] < 0 || values[i] >= 1 || hits[bin]) {
+            return FALSE;
+        }
+        hits[bin] = 1;
+    }
+    return TRUE;
+}
+
+static void sampler_create_typed(sampler* s, sampler_type type, u32 width, u32 height, u32 spp, u64 seed) {
+    sampler_options options;
+    sampler_options_default(&options, width, height);
+    options.type = type;
+    options.samples_per_pixel = spp;
+    options.seed = seed;
+    sampler_create(s, &options);
+}
+
+// ============================================================================
+// SOBOL TESTS
+// ============================================================================
+
+u32 test_sampling_sobol_matrices() {
+    // the first points of the unscrambled sequence in dimensions 0 and 1
+    EXPECTED_TO_BE(0u, sobol_bits(0, 0));
+    EXPECTED_TO_BE(0x80000000u, sobol_bits(1, 0));
+    EXPECTED_TO_BE(0x40000000u, sobol_bits(2, 0));
+    EXPECTED_TO_BE(0xc0000000u, sobol_bits(3, 0));
+    EXPECTED_TO_BE(0x80000000u, sobol_bits(1, 1));
+    EXPECTED_TO_BE(0xc0000000u, sobol_bits(2, 1));
+    EXPECTED_TO_BE(0x40000000u, sobol_bits(3, 1));
+    // every dimension starts at 0 and its first 2^m points are one per interval of 2^-m
+    f32 u[1024], v[1024];
+    for (u32 c = 0; c < SOBOL_COMPONENTS; ++c) {
+        EXPECTED_TO_BE(0u, sobol_bits(0, c));
+        for (u32 i = 0; i < 256; ++i) {
+            u[i] = (f32)(sobol_bits(i, c) >> 8) * (1.0f / 16777216.0f);
+        }
+        EXPECTED_TO_BE(TRUE, is_stratified(u, 256));
+    }
+    // dimensions 0 and 1 are a (0, 2) sequence: every aligned block of 2^m points is a net
+    for (u32 m = 1; m <= 10; ++m) {
+        for (u32 block = 0; block < 3; ++block) {
+            for (u32 i = 0; i < (1u << m); ++i) {
+                u32 index = (block << m) + i;
+                u[i] = (f32)(sobol_bits(index, 0) >> 8) * (1.0f / 16777216.0f);
+                v[i] = (f32)(sobol_bits(index, 1) >> 8) * (1.0f / 16777216.0f);
+            }
+            EXPECTED_TO_BE(TRUE, is_net(u, v, m));
+        }
+    }
+    return TRUE;
+}
+
+u32 test_sampling_owen_scramble() {
+    // the scramble permutes the fractions and keeps every net a net
+    f32 u[1024], v[1024];
+    for (u32 seed = 1; seed < 6; ++seed) {
+        u32 s0 = sobol_hash(seed), s1 = sobol_hash(seed + 100);
+        for (u32 i = 0; i < 1024; ++i) {
+            u[i] = sobol_owen(i, 0, s0);
+            v[i] = sobol_owen(i, 1, s1);
+        }
+        EXPECTED_TO_BE(TRUE, is_net(u, v, 10));
+        EXPECTED_TO_BE(TRUE, (u[0] != 0 || v[0] != 0));
+        // padded dimensions pair up like the first two of their group
+        for (u32 group = 0; group < 3; ++group) {
+            for (u32 i = 0; i < 256; ++i) {
+                u[i] = sobol_padded(i, group * SOBOL_COMPONENTS, seed);
+                v[i] = sobol_padded(i, group * SOBOL_COMPONENTS + 1, seed);
+            }
+            EXPECTED_TO_BE(TRUE, is_net(u, v, 8));
+            for (u32 i = 0; i < 256; ++i) {
+                u[i] = sobol_padded(i, group * SOBOL_COMPONENTS + 3, seed);
+            }
+            EXPECTED_TO_BE(TRUE, is_stratified(u, 256));
+        }
+    }
+    // nested uniform: scrambles agree on the top bits when the inputs do
+    for (u32 i = 0; i < 1000; ++i) {
+        u32 a = sobol_hash(i * 2 + 1);
+        u32 b = (a & 0xfff00000u) | (sobol_hash(i * 2 + 2) & 0x000fffffu);
+        u32 seed = sobol_hash(i);
+        EXPECTED_TO_BE((sobol_owen_scramble(a, seed) & 0xfff00000u), (sobol_owen_scramble(b, seed) & 0xfff00000u));
+    }
+    return TRUE;
+}
+
+u32 test_sampling_batch_matches_scalar() {
+    // lengths that are not lane multiples exercise the scalar tails
+    const u32 count = 37;
+    u32 indices[37], seeds[37], xs[37], ys[37];
+    f32 batch[37];
+    for (u32 i = 0; i < count; ++i) {
+        indices[i] = sobol_hash(i) & 0xffff;
+        seeds[i] = sobol_hash(i + 1000);
+        xs[i] = i % 13;
+        ys[i] = i / 13;
+    }
+    for (u32 c = 0; c < SOBOL_COMPONENTS; ++c) {
+        sobol_owen_batch(indices, seeds, count, c, batch);
+        for (u32 i = 0; i < count; ++i) {
+            EXPECTED_TO_BE(TRUE, (batch[i] == sobol_owen(indices[i], c, seeds[i])));
+        }
+    }
+    for (u32 d = 0; d < 11; ++d) {
+        sobol_padded_batch(indices, seeds, count, d, batch);
+        for (u32 i = 0; i < count; ++i) {
+            EXPECTED_TO_BE(TRUE, (batch[i] == sobol_padded(indices[i], d, seeds[i])));
+        }
+    }
+    sampler_type types[] = {SAMPLER_INDEPENDENT, SAMPLER_SOBOL, SAMPLER_HALTON, SAMPLER_BLUE_NOISE};
+    for (u32 t = 0; t < 4; ++t) {
+        sampler s;
+        sampler_create_typed(&s, types[t], 13, 5, 8, 77);
+        for (u32 d = 0; d < 6; ++d) {
+            // runs crossing the end of the first round of samples
+            sampler_generate(&s, 3, 4, 5, count, d, batch);
+            for (u32 i = 0; i < count; ++i) {
+                EXPECTED_TO_BE(TRUE, (batch[i] == sampler_get(&s, 3, 4, 5 + i, d)));
+                EXPECTED_TO_BE(TRUE, (batch[i] >= 0 && batch[i] < 1));
+            }
+            sampler_generate_batch(&s, xs, ys, indices, count, d, batch);
+            for (u32 i = 0; i < count; ++i) {
+                EXPECTED_TO_BE(TRUE, (batch[i] == sampler_get(&s, xs[i], ys[i], indices[i], d)));
+            }
+        }
+        sampler_destroy(&s);
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// HALTON TESTS
+// ============================================================================
+
+u32 test_sampling_halton() {
+    EXPECTED_TO_BE(2u, halton_prime(0));
+    EXPECTED_TO_BE(311u, halton_prime(HALTON_MAX_DIMENSIONS - 1));
+    EXPECTED_FLOAT_TO_BE(0.5f, halton_radical_inverse(0, 1), 1e-7f);
+    EXPECTED_FLOAT_TO_BE(0.75f, halton_radical_inverse(0, 3), 1e-7f);
+    EXPECTED_FLOAT_TO_BE(0.125f, halton_radical_inverse(0, 4), 1e-7f);
+    EXPECTED_FLOAT_TO_BE((1.0f / 3), halton_radical_inverse(1, 1), 1e-7f);
+    // 5 is 12 in base 3, mirrored 0.21
+    EXPECTED_FLOAT_TO_BE((7.0f / 9), halton_radical_inverse(1, 5), 1e-7f);
+    EXPECTED_FLOAT_TO_BE((3.0f / 25), halton_radical_inverse(2, 15), 1e-7f);
+    // 21 is 210 in base 3, its 3 digits mirrored are 012
+    EXPECTED_TO_BE(5ull, halton_inverse_radical_inverse(21, 3, 3));
+
+    halton_permutations p;
+    halton_permutations_create(&p, 1234);
+    for (u32 d = 0; d < HALTON_MAX_DIMENSIONS; ++d) {
+        u32 base = halton_prime(d);
+        u8 seen[311] = {0};
+        for (u32 i = 0; i < base; ++i) {
+            u16 digit = p.digits[p.offsets[d] + i];
+            EXPECTED_TO_BE(TRUE, (digit < base && !seen[digit]));
+            seen[digit] = 1;
+        }
+    }
+    // permuted digits still put the first base^2 indices one per interval of base^-2
+    f32 values[256];
+    for (u32 d = 1; d < 4; ++d) {
+        u32 n = halton_prime(d) * halton_prime(d);
+        for (u32 i = 0; i < n; ++i) {
+            values[i] = halton_scrambled_radical_inverse(&p, d, i);
+        }
+        EXPECTED_TO_BE(TRUE, is_stratified(values, n));
+    }
+    halton_permutations_destroy(&p);
+
+    // the pixel mapping: the samples of a pixel walk the first two dimensions with strides
+    // coprime to their bases, so they stratify inside the pixel
+    sampler s;
+    sampler_create_typed(&s, SAMPLER_HALTON, 40, 30, 16, 5);
+    for (u32 y = 0; y < 30; y += 7) {
+        for (u32 x = 0; x < 40; x += 3) {
+            sampler_generate(&s, x, y, 0, 16, 0, values);
+            EXPECTED_TO_BE(TRUE, is_stratified(values, 16));
+            sampler_generate(&s, x, y, 0, 9, 1, values);
+            EXPECTED_TO_BE(TRUE, is_stratified(values, 9));
+        }
+    }
+    // every pixel gets its own indices, which scrambled dimensions never map to one value
+    f32* firsts = (f32*)memory_allocate(sizeof(f32) * 40 * 30);
+    for (u32 i = 0; i < 40 * 30; ++i) {
+        firsts[i] = sampler_get(&s, i % 40, i / 40, 0, 2);
+        for (u32 j = 0; j < i; ++j) {
+            EXPECTED_TO_BE(TRUE, (firsts[i] != firsts[j]));
+        }
+    }
+    memory_free(firsts);
+    sampler_destroy(&s);
+    return TRUE;
+}
+
+// ============================================================================
+// SAMPLER TESTS
+// ============================================================================
+
+u32 test_sampling_sobol_pixels() {
+    sampler s;
+    sampler_create_typed(&s, SAMPLER_SOBOL, 16, 16, 64, 9);
+    f32 u[64], v[64];
+    for (u32 p = 0; p < 256; p += 17) {
+        for (u32 d = 0; d < 8; d += 2) {
+            sampler_generate(&s, p % 16, p / 16, 0, 64, d, u);
+            sampler_generate(&s, p % 16, p / 16, 0, 64, d + 1, v);
+            if (d % SOBOL_COMPONENTS == 0) {
+                EXPECTED_TO_BE(TRUE, is_net(u, v, 6));
+            } else {
+                EXPECTED_TO_BE(TRUE, is_stratified(u, 64));
+                EXPECTED_TO_BE(TRUE, is_stratified(v, 64));
+            }
+        }
+    }
+    // neighboring pixels are scrambled differently
+    EXPECTED_TO_BE(TRUE, (sampler_get(&s, 0, 0, 0, 0) != sampler_get(&s, 1, 0, 0, 0)));
+    sampler_destroy(&s);
+    return TRUE;
+}
+
+u32 test_sampling_blue_noise() {
+    f32 u[64], v[64];
+    // every pixel's samples are a whole block of sobol indices, a net in every pair, both
+    // for an even and an odd number of sample bits
+    u32 spps[] = {16, 8, 5};
+    u32 nets[] = {4, 3, 3};
+    for (u32 k = 0; k < 3; ++k) {
+        sampler s;
+        sampler_create_typed(&s, SAMPLER_BLUE_NOISE, 24, 10, spps[k], 3);
+        for (u32 y = 0; y < 10; y += 3) {
+            for (u32 x = 0; x < 24; x += 5) {
+                for (u32 d = 0; d < 6; d += 2) {
+                    sampler_generate(&s, x, y, 0, 1u << nets[k], d, u);
+                    sampler_generate(&s, x, y, 0, 1u << nets[k], d + 1, v);
+                    EXPECTED_TO_BE(TRUE, is_net(u, v, nets[k]));
+                }
+            }
+        }
+        sampler_destroy(&s);
+    }
+    // at one sample per pixel the four pixels of every aligned 2x2 quad and the sixteen of
+    // every 4x4 block split the square between them
+    sampler s;
+    sampler_create_typed(&s, SAMPLER_BLUE_NOISE, 32, 32, 1, 11);
+    for (u32 size = 2; size <= 4; size *= 2) {
+        u32 m = size == 2 ? 2 : 4;
+        for (u32 by = 0; by < 32; by += size) {
+            for (u32 bx = 0; bx < 32; bx += size) {
+                for (u32 d = 0; d < 4; d += 2) {
+                    for (u32 i = 0; i < size * size; ++i) {
+                        u[i] = sampler_get(&s, bx + i % size, by + i / size, 0, d);
+                        v[i] = sampler_get(&s, bx + i % size, by + i / size, 0, d + 1);
+                    }
+                    EXPECTED_TO_BE(TRUE, is_net(u, v, m));
+                }
+            }
+        }
+    }
+    sampler_destroy(&s);
+    return TRUE;
+}
+
+// ============================================================================
+// CONVERGENCE
+// ============================================================================
+
+typedef struct integrand_params {
+    u32 dimension;
+} integrand_params;
+
+// a smooth 2d integrand of known mean taken from two sampler dimensions, the same in every
+// pixel so the error of every pixel is the error of its estimate
+static void integrand_sample(void* params, const render_sample* sample, f32* rgb) {
+    const integrand_params* p = (const integrand_params*)params;
+    f32 u = sampler_get(sample->sampler, sample->x, sample->y, sample->index, p->dimension);
+    f32 v = sampler_get(sample->sampler, sample->x, sample->y, sample->index, p->dimension + 1);
+    f32 value = expf(u) * v * v + (u + v < 1 ? 0.5f : 0);
+    rgb[0] = value;
+    rgb[1] = value;
+    rgb[2] = value;
+}
+
+// root mean square error of the per pixel estimates after rendering with s
+static f64 render_rms_error(const sampler* s, u32 width, u32 height, u32 spp, u32 dimension, zpool* pool) {
+    film_options film_opts;
+    film_options_default(&film_opts, width, height);
+    film_filter_default(&film_opts.filter, FILM_FILTER_BOX);
+    film f;
+    film_create(&f, &film_opts);
+    render_options options;
+    render_options_default(&options);
+    options.samples_per_pixel = spp;
+    options.sampler = s;
+    integrand_params params = {dimension};
+    render_film(&f, &options, integrand_sample, &params, pool);
+    f32* rgb = (f32*)memory_allocate(sizeof(f32) * 3 * width * height);
+    film_resolve(&f, rgb);
+    const f64 expected = (exp(1.0) - 1) / 3 + 0.25;
+    f64 sum = 0;
+    for (u32 i = 0; i < width * height; ++i) {
+        f64 e = rgb[i * 3] - expected;
+        sum += e * e;
+    }
+    memory_free(rgb);
+    film_destroy(&f);
+    return sqrt(sum / (width * height));
+}
+
+u32 test_sampling_convergence() {
+    const u32 width = 48;
+    const u32 height = 32;
+    const u32 spp = 64;
+    zpool pool;
+    zpool_create(&pool, 0);
+    sampler_type types[] = {SAMPLER_INDEPENDENT, SAMPLER_SOBOL, SAMPLER_HALTON, SAMPLER_BLUE_NOISE};
+    // the integrand in the pixel position dimensions and in later ones
+    u32 dimensions[] = {2, 6};
+    for (u32 k = 0; k < 2; ++k) {
+        f64 errors[4];
+        for (u32 t = 0; t < 4; ++t) {
+            sampler s;
+            sampler_create_typed(&s, types[t], width, height, spp, 21);
+            errors[t] = render_rms_error(&s, width, height, spp, dimensions[k], &pool);
+            sampler_destroy(&s);
+        }
+        LOGI("    dimension %u at %u spp, rms error: independent %.5f, sobol %.5f, halton %.5f, blue noise %.5f",
+             dimensions[k],
+             spp,
+             errors[0],
+             errors[1],
+             errors[2],
+             errors[3]);
+        // the discontinuity limits the low discrepancy samplers to about n^-3/4
+        for (u32 t = 1; t < 4; ++t) {
+            EXPECTED_TO_BE(TRUE, (errors[t] < errors[0] * 0.5));
+        }
+    }
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+u32 test_sampling_render_default_sampler() {
+    // a render without a sampler matches one given the independent sampler explicitly
+    const u32 width = 20;
+    const u32 height = 14;
+    film a, b;
+    film_options film_opts;
+    film_options_default(&film_opts, width, height);
+    film_opts.tile_size = 8;
+    film_create(&a, &film_opts);
+    film_create(&b, &film_opts);
+    render_options options;
+    render_options_default(&options);
+    options.samples_per_pixel = 4;
+    options.seed = 0x1234567890ull;
+    integrand_params params = {2};
+    render_film(&a, &options, integrand_sample, &params, 0);
+    sampler s;
+    sampler_create_typed(&s, SAMPLER_INDEPENDENT, width, height, 4, options.seed);
+    options.sampler = &s;
+    render_film(&b, &options, integrand_sample, &params, 0);
+    EXPECTED_TO_BE(0, memcmp(a.pixels, b.pixels, sizeof(film_pixel) * width * height));
+    sampler_destroy(&s);
+    film_destroy(&a);
+    film_destroy(&b);
+    return TRUE;
+}
+
+// ============================================================================
+// RNG TESTS
+// ============================================================================
+
+u32 test_sampling_rng_reference() {
+    // pcg32-demo's first values for seed 42 on stream 54
+    const u32 pcg[6] = {0xa15c02b7u, 0x7b47f409u, 0xba1d3330u, 0x83d2f293u, 0xbfa4784bu, 0xcbed606eu};
+    rng r;
+    rng_seed(&r, 42, 54);
+    for (u32 i = 0; i < 6; ++i) {
+        EXPECTED_TO_BE(pcg[i], rng_u32(&r));
+    }
+    // random123's known answers for philox4x32-10
+    u32 out[4];
+    rng_philox(0, 0, 0, out);
+    EXPECTED_TO_BE(0x6627e8d5u, out[0]);
+    EXPECTED_TO_BE(0xe169c58du, out[1]);
+    EXPECTED_TO_BE(0xbc57ac4cu, out[2]);
+    EXPECTED_TO_BE(0x9b00dbd8u, out[3]);
+    rng_philox(0x299f31d0a4093822ull, 0x0370734413198a2eull, 0x85a308d3243f6a88ull, out);
+    EXPECTED_TO_BE(0xd16cfe09u, out[0]);
+    EXPECTED_TO_BE(0x94fdccebu, out[1]);
+    EXPECTED_TO_BE(0x5001e420u, out[2]);
+    EXPECTED_TO_BE(0x24126ea1u, out[3]);
+    return TRUE;
+}
+
+u32 test_sampling_rng_advance() {
+    rng a, b;
+    rng_seed_stream(&a, 7, 3);
+    b = a;
+    for (u32 i = 0; i < 1000; ++i) {
+        rng_u32(&a);
+    }
+    rng_advance(&b, 1000);
+    EXPECTED_TO_BE(a.state, b.state);
+    EXPECTED_TO_BE(rng_u32(&a), rng_u32(&b));
+    // wrapping deltas step back
+    rng_advance(&b, 0ull - 1001);
+    rng_seed_stream(&a, 7, 3);
+    EXPECTED_TO_BE(a.state, b.state);
+    // a huge jump is just as cheap and lands where small ones add up to
+    rng_advance(&a, 1ull << 40);
+    for (u32 i = 0; i < 16; ++i) {
+        rng_advance(&b, 1ull << 36);
+    }
+    EXPECTED_TO_BE(a.state, b.state);
+    return TRUE;
+}
+
+u32 test_sampling_rng_distribution() {
+    rng r;
+    rng_seed_stream(&r, 1, 0);
+    // bounded values hit every bucket about evenly, floats stay in range
+    u32 buckets[10] = {0};
+    f64 sum = 0;
+    const u32 count = 100000;
+    for (u32 i = 0; i < count; ++i) {
+        u32 v = rng_bounded(&r, 10);
+        EXPECTED_TO_BE(TRUE, (v < 10));
+        ++buckets[v];
+        f32 f = rng_f32(&r);
+        EXPECTED_TO_BE(TRUE, (f >= 0 && f < 1));
+        sum += f;
+        f32 g = rng_range(&r, -3, 5);
+        EXPECTED_TO_BE(TRUE, (g >= -3 && g < 5));
+    }
+    for (u32 i = 0; i < 10; ++i) {
+        EXPECTED_TO_BE(TRUE, (buckets[i] > count / 10 - 600 && buckets[i] < count / 10 + 600));
+    }
+    EXPECTED_FLOAT_TO_BE(0.5, (sum / count), 0.005);
+    EXPECTED_TO_BE(0u, rng_bounded(&r, 1));
+    // neighboring streams are unrelated sequences
+    rng a, b;
+    rng_seed_stream(&a, 1, 100);
+    rng_seed_stream(&b, 1, 101);
+    u32 equal = 0;
+    for (u32 i = 0; i < 1000; ++i) {
+        equal += rng_u32(&a) == rng_u32(&b);
+    }
+    EXPECTED_TO_BE(TRUE, (equal < 3));
+    return TRUE;
+}
+
+u32 test_sampling_rng_philox_batch() {
+    // every start and length, including the partial blocks at both ends, matches the blocks
+    // computed one at a time
+    u32 expected[200], batch[200];
+    f32 unit[200];
+    const u64 seed = 0x1234abcd5678ull, stream = 99;
+    for (u32 block = 0; block < 50; ++block) {
+        rng_philox(seed, stream, block, expected + block * 4);
+    }
+    for (u32 first = 0; first < 9; ++first) {
+        for (u32 count = 0; count + first <= 200; count += 13) {
+            rng_philox_batch(seed, stream, first, count, batch);
+            for (u32 i = 0; i < count; ++i) {
+                EXPECTED_TO_BE(expected[first + i], batch[i]);
+            }
+        }
+    }
+    rng_philox_unit_batch(seed, stream, 3, 150, unit);
+    for (u32 i = 0; i < 150; ++i) {
+        EXPECTED_TO_BE(TRUE, (unit[i] == (f32)(expected[3 + i] >> 8) * (1.0f / 16777216.0f)));
+    }
+    // a run crossing a carry into the high half of the block counter
+    u64 first = (0xffffffffull - 3) * 4;
+    rng_philox_batch(seed, stream, first, 64, batch);
+    for (u32 i = 0; i < 64; i += 4) {
+        rng_philox(seed, stream, (first + i) / 4, expected);
+        EXPECTED_TO_BE(0, memcmp(expected, batch + i, sizeof(u32) * 4));
+    }
+    return TRUE;
+}
+
+typedef struct rng_stream_job {
+    u64 seed;
+    u32* values;
+} rng_stream_job;
+
+static void rng_stream_task(void* params, u64 index, u32 thread_index) {
+    rng_stream_job* job = (rng_stream_job*)params;
+    rng r;
+    rng_seed_stream(&r, job->seed, index);
+    u32 sum = 0;
+    for (u32 i = 0; i < 100; ++i) {
+        sum += rng_u32(&r);
+    }
+    job->values[index] = sum;
+}
+
+u32 test_sampling_rng_streams_parallel() {
+    // a stream per work item gives the same values whatever thread runs it
+    const u32 count = 4096;
+    u32* serial = (u32*)memory_allocate(sizeof(u32) * count);
+    u32* parallel = (u32*)memory_allocate(sizeof(u32) * count);
+    rng_stream_job job = {77, serial};
+    zpool_parallel_for(0, count, 1, rng_stream_task, &job);
+    zpool pool;
+    zpool_create(&pool, 3);
+    job.values = parallel;
+    zpool_parallel_for(&pool, count, 7, rng_stream_task, &job);
+    zpool_destroy(&pool);
+    EXPECTED_TO_BE(0, memcmp(serial, parallel, sizeof(u32) * count));
+    memory_free(serial);
+    memory_free(parallel);
+    return TRUE;
+}
+
+// ============================================================================
+// BENCHMARKS
+// ============================================================================
+
+// sample generation throughput, a release build with --filter=sampling_bench_* gives
+// meaningful numbers
+// stratified values land in every bin as often as its share of the function says, through
+// the alias table and through the cdf, and never in an empty bin
+static bool distribution1d_matches(const distribution1d* d, const f32* func, bool alias) {
+    const u32 draws = 1u << 16;
+    u32* hits = (u32*)memory_allocate(sizeof(u32) * d->count);
+    memset(hits, 0, sizeof(u32) * d->count);
+    f64 sum = 0;
+    for (u32 i = 0; i < d->count; ++i) {
+        sum += func[i];
+    }
+    bool ok = TRUE;
+    for (u32 k = 0; k < draws; ++k) {
+        f32 u = ((f32)k + 0.5f) / (f32)draws;
+        f32 pdf;
+        u32 offset;
+        f32 x = alias ? distribution1d_sample_alias(d, u, &pdf, &offset) : distribution1d_sample_cdf(d, u, &pdf, &offset);
+        ok &= x >= 0 && x < 1 && (u32)(x * (f32)d->count) == offset;
+        ok &= absf(pdf - distribution1d_pdf(d, x)) <= 1e-5f * pdf;
+        ok &= absf(pdf - (f32)(func[offset] * d->count / sum)) <= 1e-4f * pdf;
+        hits[offset]++;
+    }
+    for (u32 i = 0; i < d->count; ++i) {
+        f64 expected = func[i] / sum * draws;
+        ok &= absf((f32)(hits[i] - expected)) <= 2.0f;
+    }
+    memory_free(hits);
+    return ok;
+}
+
+u32 test_sampling_distribution() {
+    f32 func[37];
+    for (u32 i = 0; i < 37; ++i) {
+        func[i] = i % 5 == 0 ? 0.0f : (f32)(i % 7) + 0.25f;
+    }
+    func[11] = 500;
+    distribution1d d;
+    distribution1d_create(&d, func, 37);
+    EXPECTED_TO_BE(TRUE, distribution1d_matches(&d, func, TRUE));
+    EXPECTED_TO_BE(TRUE, distribution1d_matches(&d, func, FALSE));
+    // every column of the table mixes at most two bins, together they hold count times each
+    // bin's probability
+    f64 mass[37] = {0};
+    for (u32 i = 0; i < 37; ++i) {
+        mass[i] += d.alias[i].q;
+        mass[d.alias[i].alias] += 1.0 - d.alias[i].q;
+    }
+    for (u32 i = 0; i < 37; ++i) {
+        f32 expected = func[i] / d.integral;
+        EXPECTED_FLOAT_TO_BE(expected, (f32)mass[i], 1e-4f * (1 + expected));
+    }
+    distribution1d_destroy(&d);
+
+    // nothing to go by, bins are equally likely
+    f32 zeros[8] = {0};
+    distribution1d_create(&d, zeros, 8);
+    for (u32 i = 0; i < 8; ++i) {
+        f32 pdf;
+        u32 offset;
+        f32 x = distribution1d_sample_alias(&d, ((f32)i + 0.5f) / 8.0f, &pdf, &offset);
+        EXPECTED_TO_BE(i, offset);
+        EXPECTED_FLOAT_TO_BE(1.0f, pdf, 0);
+        EXPECTED_FLOAT_TO_BE(((f32)i + 0.5f) / 8.0f, x, 1e-6f);
+    }
+    distribution1d_destroy(&d);
+    return TRUE;
+}
+
+u32 test_sampling_distribution_2d() {
+    const u32 width = 24;
+    const u32 height = 16;
+    f32* func = (f32*)memory_allocate(sizeof(f32) * width * height);
+    rng r;
+    rng_seed(&r, 9, 0);
+    for (u32 i = 0; i < width * height; ++i) {
+        func[i] = rng_f32(&r) < 0.2f ? 0.0f : rng_range(&r, 0.1f, 4.0f);
+    }
+    // an empty row and a bright spot
+    memset(func + 3 * width, 0, sizeof(f32) * width);
+    func[10 * width + 5] = 300;
+    zpool pool;
+    zpool_create(&pool, 3);
+    distribution2d serial, parallel;
+    distribution2d_create(&serial, func, width, height, 0);
+    distribution2d_create(&parallel, func, width, height, &pool);
+    EXPECTED_TO_BE(0, memcmp(serial.conditional[0].alias, parallel.conditional[0].alias, sizeof(distribution_alias) * width * height));
+    EXPECTED_TO_BE(0, memcmp(serial.conditional[0].cdf, parallel.conditional[0].cdf, sizeof(f32) * (width + 1) * height));
+    EXPECTED_TO_BE(0, memcmp(serial.marginal.alias, parallel.marginal.alias, sizeof(distribution_alias) * height));
+
+    f64 sum = 0;
+    for (u32 i = 0; i < width * height; ++i) {
+        sum += func[i];
+    }
+    const u32 draws = 1u << 19;
+    u32* hits = (u32*)memory_allocate(sizeof(u32) * width * height);
+    for (u32 method = 0; method < 2; ++method) {
+        memset(hits, 0, sizeof(u32) * width * height);
+        rng_seed(&r, 4, method);
+        for (u32 k = 0; k < draws; ++k) {
+            f32 u0 = rng_f32(&r), u1 = rng_f32(&r);
+            f32 x, y, pdf;
+            if (method) {
+                distribution2d_sample_cdf(&serial, u0, u1, &x, &y, &pdf);
+            } else {
+                distribution2d_sample_alias(&serial, u0, u1, &x, &y, &pdf);
+            }
+            EXPECTED_FLOAT_TO_BE(distribution2d_pdf(&serial, x, y), pdf, 1e-4f * pdf);
+            u32 cell = (u32)(y * height) * width + (u32)(x * width);
+            EXPECTED_TO_BE(TRUE, (func[cell] > 0));
+            EXPECTED_FLOAT_TO_BE((f32)(func[cell] * width * height / sum), pdf, 1e-3f * pdf);
+            hits[cell]++;
+        }
+        // within 5 standard deviations of the expected count
+        for (u32 i = 0; i < width * height; ++i) {
+            f32 expected = (f32)(func[i] / sum) * draws;
+            EXPECTED_FLOAT_TO_BE(expected, (f32)hits[i], 5.0f * sqrtf(expected) + 1.0f);
+        }
+    }
+    memory_free(hits);
+    memory_free(func);
+    distribution2d_destroy(&serial);
+    distribution2d_destroy(&parallel);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+u32 test_sampling_bench_generate() {
+    const u32 width = 640;
+    const u32 height = 360;
+    const u32 spp = 16;
+    const u32 dimensions = 4;
+    f32 values[16];
+    f64 checksum = 0;
+    clock clk;
+
+    // the padded sobol sequence a point at a time against the batch generator
+    clock_set(&clk);
+    for (u32 p = 0; p < width * height; ++p) {
+        for (u32 d = 0; d < dimensions; ++d) {
+            for (u32 i = 0; i < spp; ++i) {
+                checksum += sobol_padded(i, d, p);
+            }
+        }
+    }
+    clock_update(&clk);
+    f64 scalar_seconds = clk.elapsed;
+    u32 indices[16], seeds[16];
+    for (u32 i = 0; i < spp; ++i) {
+        indices[i] = i;
+    }
+    clock_set(&clk);
+    for (u32 p = 0; p < width * height; ++p) {
+        for (u32 i = 0; i < spp; ++i) {
+            seeds[i] = p;
+        }
+        for (u32 d = 0; d < dimensions; ++d) {
+            sobol_padded_batch(indices, seeds, spp, d, values);
+            checksum += values[spp - 1];
+        }
+    }
+    clock_update(&clk);
+    f64 batch_seconds = clk.elapsed;
+    f64 count = (f64)width * height * spp * dimensions;
+    log_stdout("    sobol %u values: scalar %.1f Mvalues/s, batch %.1f Mvalues/s\n",
+               (u32)count,
+               count / scalar_seconds * 1e-6,
+               count / batch_seconds * 1e-6);
+
+    sampler_type types[] = {SAMPLER_INDEPENDENT, SAMPLER_SOBOL, SAMPLER_HALTON, SAMPLER_BLUE_NOISE};
+    const char* names[] = {"independent", "sobol", "halton", "blue noise"};
+    for (u32 t = 0; t < 4; ++t) {
+        sampler s;
+        sampler_create_typed(&s, types[t], width, height, spp, 1);
+        clock_set(&clk);
+        for (u32 y = 0; y < height; ++y) {
+            for (u32 x = 0; x < width; ++x) {
+                for (u32 d = 0; d < dimensions; ++d) {
+                    sampler_generate(&s, x, y, 0, spp, d, values);
+                    checksum += values[0];
+                }
+            }
+        }
+        clock_update(&clk);
+        log_stdout("    sampler_generate %s: %.1f Mvalues/s\n", names[t], count / clk.elapsed * 1e-6);
+        sampler_destroy(&s);
+    }
+    // keeps the loops from being optimized away
+    EXPECTED_TO_BE(TRUE, (checksum > 0));
+    return TRUE;
+}
+
+// random number throughput, a release build with --filter=sampling_bench_* gives meaningful
+// numbers
+u32 test_sampling_bench_rng() {
+    const u32 count = 1u << 24;
+    u32 block[1024];
+    u64 checksum = 0;
+    clock clk;
+    rng r;
+    rng_seed_stream(&r, 1, 2);
+    clock_set(&clk);
+    for (u32 i = 0; i < count; ++i) {
+        checksum += rng_u32(&r);
+    }
+    clock_update(&clk);
+    f64 pcg_seconds = clk.elapsed;
+    clock_set(&clk);
+    for (u32 i = 0; i < count; i += 4) {
+        rng_philox(1, 2, i / 4, block);
+        checksum += block[0] + block[3];
+    }
+    clock_update(&clk);
+    f64 philox_seconds = clk.elapsed;
+    clock_set(&clk);
+    for (u32 i = 0; i < count; i += 1024) {
+        rng_philox_batch(1, 2, i, 1024, block);
+        checksum += block[0] + block[1023];
+    }
+    clock_update(&clk);
+    f64 batch_seconds = clk.elapsed;
+    log_stdout("    rng %u values: pcg32 %.0f Mvalues/s, philox %.0f Mvalues/s, philox batch %.0f Mvalues/s\n",
+               count,
+               count / pcg_seconds * 1e-6,
+               count / philox_seconds * 1e-6,
+               count / batch_seconds * 1e-6);
+    EXPECTED_TO_BE(TRUE, (checksum > 0));
+    return TRUE;
+}
+
+// an environment map sized distribution with a small bright sun over a smooth sky, built
+// on one thread and on the pool, then sampled through the alias tables and the cdfs.
+// --filter=sampling_bench_* in a release build gives meaningful numbers
+u32 test_sampling_bench_distribution() {
+    const u32 width = 4096;
+    const u32 height = 2048;
+    const u32 count = 1u << 22;
+    f32* func = (f32*)memory_allocate(sizeof(f32) * width * height);
+    for (u32 y = 0; y < height; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            f32 dx = (f32)x - 1200.0f, dy = (f32)y - 600.0f;
+            f32 sky = 0.5f + 0.4f * sinf((f32)x * 0.003f) * cosf((f32)y * 0.005f);
+            func[(u64)y * width + x] = dx * dx + dy * dy < 100.0f ? 5000.0f : sky;
+        }
+    }
+    zpool pool;
+    zpool_create(&pool, 0);
+    clock clk;
+    distribution2d d;
+    clock_set(&clk);
+    distribution2d_create(&d, func, width, height, 0);
+    clock_update(&clk);
+    f64 serial = clk.elapsed;
+    distribution2d_destroy(&d);
+    clock_set(&clk);
+    distribution2d_create(&d, func, width, height, &pool);
+    clock_update(&clk);
+    log_stdout("    %ux%u build: %.1fms on one thread, %.1fms on %u\n", width, height, serial * 1e3, clk.elapsed * 1e3, zpool_thread_count(&pool));
+
+    rng r;
+    f64 checksum = 0;
+    f64 seconds[2];
+    for (u32 method = 0; method < 2; ++method) {
+        rng_seed(&r, 5, 0);
+        clock_set(&clk);
+        for (u32 i = 0; i < count; ++i) {
+            f32 x, y, pdf;
+            f32 u0 = rng_f32(&r), u1 = rng_f32(&r);
+            if (method) {
+                distribution2d_sample_cdf(&d, u0, u1, &x, &y, &pdf);
+            } else {
+                distribution2d_sample_alias(&d, u0, u1, &x, &y, &pdf);
+            }
+            checksum += x + y + pdf;
+        }
+        clock_update(&clk);
+        seconds[method] = clk.elapsed;
+    }
+    log_stdout("    %u samples: alias %.1f Msamples/s, cdf inversion %.1f Msamples/s (%.2fx)\n",
+               count,
+               count / seconds[0] * 1e-6,
+               count / seconds[1] * 1e-6,
+               seconds[1] / seconds[0]);
+    EXPECTED_TO_BE(TRUE, (checksum > 0));
+    distribution2d_destroy(&d);
+    memory_free(func);
+    zpool_destroy(&pool);
+    return TRUE;
+}
+
+void register_sampling_testcases() {
+    test_manager_add(test_sampling_sobol_matrices, "sampling_sobol_matrices");
+    test_manager_add(test_sampling_owen_scramble, "sampling_owen_scramble");
+    test_manager_add(test_sampling_batch_matches_scalar, "sampling_batch_matches_scalar");
+    test_manager_add(test_sampling_halton, "sampling_halton");
+    test_manager_add(test_sampling_sobol_pixels, "sampling_sobol_pixels");
+    test_manager_add(test_sampling_blue_noise, "sampling_blue_noise");
+    test_manager_add(test_sampling_convergence, "sampling_convergence");
+    test_manager_add(test_sampling_render_default_sampler, "sampling_render_default_sampler");
+    test_manager_add(test_sampling_rng_reference, "sampling_rng_reference");
+    test_manager_add(test_sampling_rng_advance, "sampling_rng_advance");
+    test_manager_add(test_sampling_rng_distribution, "sampling_rng_distribution");
+    test_manager_add(test_sampling_rng_philox_batch, "sampling_rng_philox_batch");
+    test_manager_add(test_sampling_rng_streams_parallel, "sampling_rng_streams_parallel");
+    test_manager_add(test_sampling_distribution, "sampling_distribution");
+    test_manager_add(test_sampling_distribution_2d, "sampling_distribution_2d");
+    test_manager_add(test_sampling_bench_generate, "sampling_bench_generate");
+    test_manager_add(test_sampling_bench_rng, "sampling_bench_rng");
+    test_manager_add(test_sampling_bench_distribution, "sampling_bench_distribution");
+}
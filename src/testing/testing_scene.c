@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scene.h"
+#include "scene_tokenizer.h"
+#include "rng.h"
+#include "math_utils.h"
+#include "test_manager.h"
+#include "platform.h"
+#include "clock.h"
+#include "memory.h"
+#include "zpool.h"
+#include "logger.h"
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// growable text the generated scenes are printed into
+typedef struct text_builder {
+    char* text;
+    u64 size;
+    u64 capacity;
+} text_builder;
+
+static void text_create(text_builder* b, u64 capacity) {
+    b->text = (char*)memory_allocate((u32)capacity);
+    b->size = 0;
+    b->capacity = capacity;
+}
+
+static void text_append(text_builder* b, const char* s) {
+    u64 length = strlen(s);
+    if (b->size + length + 1 > b->capacity) {
+        b->capacity = (b->size + length + 1) * 2;
+        b->text = (char*)memory_reallocate(b->text, b->capacity);
+    }
+    memcpy(b->text + b->size, s, length + 1);
+    b->size += length;
+}
+
+static bool write_file(const char* path, const char* text, u64 size) {
+    platform_file file;
+    if (!platform_file_open(path, PLATFORM_FILE_WRITE, &file)) {
+        return FALSE;
+    }
+    bool written = platform_file_write(&file, text, size) == size;
+    platform_file_close(&file);
+    return written;
+}
+
+// a scene of triangle meshes with vertex_count vertices each, spread over the usual
+// directives, numbers printed in several styles and with comments in between
+static void generate_scene(text_builder* b, u32 mesh_count, u32 vertex_count, u64 seed) {
+    rng r;
+    rng_seed(&r, seed, 0);
+    char line[256];
+    text_append(b, "LookAt 0 0 -10  0 0 0  0 1 0\nCamera \"perspective\" \"float fov\" [ 45 ]\n");
+    text_append(b, "Film \"rgb\" \"integer xresolution\" [ 640 ] \"integer yresolution\" 480 \"string filename\" \"out.exr\"\n");
+    text_append(b, "WorldBegin\n");
+    for (u32 m = 0; m < mesh_count; ++m) {
+        text_append(b, "AttributeBegin\n");
+        log_buffer(line, sizeof(line), "  Translate %g %g %g\n", rng_f32(&r) * 10, rng_f32(&r) * 10, -rng_f32(&r));
+        text_append(b, line);
+        text_append(b, "  Material \"diffuse\" \"rgb reflectance\" [ .5 0.25e0 +1 ]\n");
+        text_append(b, "  Shape \"trianglemesh\"\n    \"point3 P\" [\n");
+        for (u32 v = 0; v < vertex_count; ++v) {
+            log_buffer(line, sizeof(line), "      %.7g %.7g %.7g%s\n", rng_f32(&r) * 200 - 100, rng_f32(&r) * 1e-3f,
+                       rng_f32(&r) * 3e5f, v % 97 == 0 ? " # comment in the list" : "");
+            text_append(b, line);
+        }
+        text_append(b, "    ]\n    \"integer indices\" [");
+        for (u32 t = 0; t + 2 < vertex_count; ++t) {
+            log_buffer(line, sizeof(line), " %u %u %u", t, t + 1, t + 2);
+            text_append(b, line);
+            text_append(b, t % 8 == 7 ? "\n" : "");
+        }
+        text_append(b, " ]\n    \"bool flip\" true \"string alpha\" \"mask.png\"\n");
+        text_append(b, "AttributeEnd\n");
+    }
+}
+
+static bool params_equal(const scene_param* a, const scene_param* b) {
+    if (a->type != b->type || a->kind != b->kind || a->count != b->count || strcmp(a->name, b->name) != 0) {
+        return FALSE;
+    }
+    for (u32 i = 0; i < a->count; ++i) {
+        bool same = a->kind == SCENE_VALUES_STRING ? strcmp(a->strings[i], b->strings[i]) == 0
+                    : a->kind == SCENE_VALUES_BOOL ? a->bools[i] == b->bools[i]
+                                                   : a->ints[i] == b->ints[i];
+        if (!same) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static bool scenes_equal(const scene* a, const scene* b) {
+    if (a->directive_count != b->directive_count || a->file_count != b->file_count) {
+        return FALSE;
+    }
+    for (u32 i = 0; i < a->directive_count; ++i) {
+        const scene_directive* x = &a->directives[i];
+        const scene_directive* y = &b->directives[i];
+        bool same = x->type == y->type && x->file == y->file && x->line == y->line && x->string_count == y->string_count &&
+                    x->number_count == y->number_count && x->param_count == y->param_count &&
+                    memcmp(x->numbers, y->numbers, sizeof(f32) * x->number_count) == 0;
+        for (u32 k = 0; same && k < x->string_count; ++k) {
+            same = strcmp(x->strings[k], y->strings[k]) == 0;
+        }
+        for (u32 k = 0; same && k < x->param_count; ++k) {
+            same = params_equal(&x->params[k], &y->params[k]);
+        }
+        if (!same) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// TOKENIZER TESTS
+// ============================================================================
+
+u32 test_scene_tokenizer() {
+    const char* text = "Shape \"tri\\\"angle\" # comment \"not a string\"\n"
+                       "  \"point3 P\" [ 1 -2.5 # inside\n 3e2 ] true\n";
+    scene_token_list list;
+    scene_tokenize(text, strlen(text), &list);
+    EXPECTED_TO_BE(0, (u64)list.error);
+    EXPECTED_TO_BE(7, list.count);
+    EXPECTED_TO_BE(3, list.line_count);
+    const u32 kinds[7] = {SCENE_TOKEN_WORD,    SCENE_TOKEN_STRING, SCENE_TOKEN_STRING, SCENE_TOKEN_OPEN,
+                          SCENE_TOKEN_NUMBERS, SCENE_TOKEN_CLOSE,  SCENE_TOKEN_WORD};
+    for (u32 i = 0; i < 7; ++i) {
+        EXPECTED_TO_BE(kinds[i], list.tokens[i].kind);
+    }
+    // the comment inside the list stays part of the run and the converter skips it
+    EXPECTED_TO_BE(3, list.tokens[4].count);
+    EXPECTED_TO_BE(1, list.tokens[4].line);
+    EXPECTED_TO_BE(2, list.tokens[5].line);
+    f32 values[3];
+    EXPECTED_TO_BE(0, (u64)scene_parse_floats(list.tokens[4].text, list.tokens[4].length, 3, values));
+    EXPECTED_FLOAT_TO_BE(-2.5f, values[1], 0.0f);
+    EXPECTED_FLOAT_TO_BE(300.0f, values[2], 0.0f);
+    EXPECTED_TO_BE(10, list.tokens[1].length);
+    scene_token_list_destroy(&list);
+
+    const char* open = "Shape \"sphere\n\"float radius\" 1\n";
+    scene_tokenize(open, strlen(open), &list);
+    EXPECTED_NOT_TO_BE(0, (u64)list.error);
+    EXPECTED_TO_BE(TRUE, (list.error_at == open + 6));
+    scene_token_list_destroy(&list);
+
+    // chunks end on line starts
+    const char* lines = "ab\ncd\nef";
+    EXPECTED_TO_BE(3, scene_chunk_end(lines, 8, 0, 1));
+    EXPECTED_TO_BE(6, scene_chunk_end(lines, 8, 3, 3));
+    EXPECTED_TO_BE(8, scene_chunk_end(lines, 8, 6, 1));
+    return TRUE;
+}
+
+u32 test_scene_parse_numbers() {
+    rng r;
+    rng_seed(&r, 51, 0);
+    char text[64];
+    for (u32 i = 0; i < 20000; ++i) {
+        f32 scale = powf(10.0f, rng_f32(&r) * 60 - 30);
+        f32 value = (rng_f32(&r) - 0.5f) * scale;
+        const char* formats[3] = {"%.9g", "%.3e", "%f"};
+        log_buffer(text, sizeof(text), formats[i % 3], value);
+        f32 parsed;
+        EXPECTED_TO_BE(0, (u64)scene_parse_floats(text, strlen(text), 1, &parsed));
+        f32 reference = strtof(text, 0);
+        f32 tolerance = absf(reference) * 1.2e-7f;
+        EXPECTED_FLOAT_TO_BE(reference, parsed, tolerance);
+    }
+    const char* good = "-.5 +2. 1E+10 0.000001 12345678901234567890 007";
+    f32 values[6];
+    EXPECTED_TO_BE(0, (u64)scene_parse_floats(good, strlen(good), 6, values));
+    EXPECTED_FLOAT_TO_BE(-0.5f, values[0], 0.0f);
+    EXPECTED_FLOAT_TO_BE(2.0f, values[1], 0.0f);
+    EXPECTED_FLOAT_TO_BE(1e10f, values[2], 0.0f);
+    EXPECTED_FLOAT_TO_BE(1e-6f, values[3], 0.0f);
+    EXPECTED_FLOAT_TO_BE(1.2345679e19f, values[4], 1e13f);
+    EXPECTED_FLOAT_TO_BE(7.0f, values[5], 0.0f);
+
+    const char* bad[5] = {"1.2.3", "4x", "-", "1e", "."};
+    for (u32 i = 0; i < 5; ++i) {
+        f32 v;
+        EXPECTED_TO_BE(TRUE, (scene_parse_floats(bad[i], strlen(bad[i]), 1, &v) == bad[i]));
+    }
+    const char* integers = "0 -2147483648 2147483647";
+    i32 ints[3];
+    EXPECTED_TO_BE(0, (u64)scene_parse_integers(integers, strlen(integers), 3, ints));
+    EXPECTED_TO_BE(-2147483647 - 1, ints[1]);
+    EXPECTED_TO_BE(2147483647, ints[2]);
+    const char* not_integers[3] = {"2147483648", "1.5", "1e3"};
+    for (u32 i = 0; i < 3; ++i) {
+        i32 v;
+        EXPECTED_NOT_TO_BE(0, (u64)scene_parse_integers(not_integers[i], strlen(not_integers[i]), 1, &v));
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// PARSER TESTS
+// ============================================================================
+
+u32 test_scene_parse_directives() {
+    const char* text = "# header comment\n"
+                       "LookAt 0 1 2 3 4 5 6 7 8\n"
+                       "Camera \"perspective\" \"float fov\" 45\n"
+                       "Option \"bool disablepixeljitter\" true\n"
+                       "ConcatTransform [ 1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1 ]\n"
+                       "WorldBegin\n"
+                       "ActiveTransform StartTime\n"
+                       "Texture \"checks\" \"spectrum\" \"checkerboard\" \"float uscale\" [ 8 ] \"rgb tex1\" [ 1 0 0 ]\n"
+                       "MediumInterface \"fog\" \"\"\n"
+                       "Shape \"trianglemesh\" \"point P\" [ 0 0 0 1 0 0 0 1 0 ] \"integer indices\" [ 0 1 2 ]\n"
+                       "  \"normal N\" [ ] \"bool flip\" \"false\" \"string names\" [ \"a\" \"b\\tc\" ]\n"
+                       "LightSource \"infinite\" \"spectrum L\" \"stdillum-D65\" \"blackbody temperature\" 5500\n";
+    scene s;
+    EXPECTED_TO_BE(TRUE, scene_parse_text(&s, text, strlen(text), "inline.pbrt", 0, 0));
+    EXPECTED_TO_BE(10, s.directive_count);
+    EXPECTED_TO_BE(1, s.file_count);
+    EXPECTED_TO_BE(0, strcmp(s.files[0], "inline.pbrt"));
+
+    const scene_directive* look_at = &s.directives[0];
+    EXPECTED_TO_BE(SCENE_LOOK_AT, look_at->type);
+    EXPECTED_TO_BE(2, look_at->line);
+    EXPECTED_TO_BE(9, look_at->number_count);
+    EXPECTED_FLOAT_TO_BE(8.0f, look_at->numbers[8], 0.0f);
+
+    const scene_directive* camera = &s.directives[1];
+    EXPECTED_TO_BE(0, strcmp(camera->strings[0], "perspective"));
+    const scene_param* fov = scene_directive_param(camera, "fov");
+    EXPECTED_NOT_TO_BE(0, (u64)fov);
+    EXPECTED_TO_BE(SCENE_VALUES_FLOAT, fov->kind);
+    EXPECTED_FLOAT_TO_BE(45.0f, fov->floats[0], 0.0f);
+
+    EXPECTED_TO_BE(SCENE_OPTION, s.directives[2].type);
+    EXPECTED_TO_BE(TRUE, s.directives[2].params[0].bools[0]);
+    EXPECTED_TO_BE(16, s.directives[3].number_count);
+    EXPECTED_TO_BE(SCENE_WORLD_BEGIN, s.directives[4].type);
+    EXPECTED_TO_BE(0, strcmp(s.directives[5].strings[0], "StartTime"));
+
+    const scene_directive* texture = &s.directives[6];
+    EXPECTED_TO_BE(3, texture->string_count);
+    EXPECTED_TO_BE(0, strcmp(texture->strings[2], "checkerboard"));
+    EXPECTED_TO_BE(SCENE_PARAM_RGB, scene_directive_param(texture, "tex1")->type);
+    EXPECTED_TO_BE(2, s.directives[7].string_count);
+    EXPECTED_TO_BE(0, strcmp(s.directives[7].strings[1], ""));
+
+    const scene_directive* shape = &s.directives[8];
+    EXPECTED_TO_BE(SCENE_SHAPE, shape->type);
+    EXPECTED_TO_BE(5, shape->param_count);
+    const scene_param* p = scene_directive_param(shape, "P");
+    EXPECTED_TO_BE(SCENE_PARAM_POINT3, p->type);
+    EXPECTED_TO_BE(9, p->count);
+    EXPECTED_FLOAT_TO_BE(1.0f, p->floats[7], 0.0f);
+    const scene_param* indices = scene_directive_param(shape, "indices");
+    EXPECTED_TO_BE(SCENE_VALUES_INT, indices->kind);
+    EXPECTED_TO_BE(2, indices->ints[2]);
+    EXPECTED_TO_BE(0, scene_directive_param(shape, "N")->count);
+    EXPECTED_TO_BE(FALSE, scene_directive_param(shape, "flip")->bools[0]);
+    EXPECTED_TO_BE(0, strcmp(scene_directive_param(shape, "names")->strings[1], "b\tc"));
+    EXPECTED_TO_BE(0, (u64)scene_directive_param(shape, "uv"));
+
+    const scene_directive* light = &s.directives[9];
+    EXPECTED_TO_BE(12, light->line);
+    EXPECTED_TO_BE(SCENE_VALUES_STRING, scene_directive_param(light, "L")->kind);
+    EXPECTED_TO_BE(SCENE_PARAM_BLACKBODY, scene_directive_param(light, "temperature")->type);
+    EXPECTED_TO_BE(0, strcmp(scene_directive_name(light->type), "LightSource"));
+    scene_destroy(&s);
+    return TRUE;
+}
+
+u32 test_scene_parse_errors() {
+    const char* cases[][2] = {
+        {"WorldBegin\nShape \"sphere\" \"float radius\" [ 1\n", "e.pbrt:2: unterminated [ in parameter 'radius'"},
+        {"WorldBegin\n\nSphere\n", "e.pbrt:3: unknown directive 'Sphere'"},
+        {"Translate 1 2\nWorldBegin\n", "e.pbrt:1: wrong number of arguments for 'Translate'"},
+        {"Shape \"sphere\"\n  \"float radius\" [ 1 2.0.1 ]\n", "e.pbrt:2: malformed number '2.0.1'"},
+        {"Shape \"sphere\" \"radius\" 1\n", "e.pbrt:1: expected \"type name\", found 'radius'"},
+        {"Shape \"sphere\" \"real radius\" 1\n", "e.pbrt:1: unknown parameter type 'real'"},
+        {"Shape \"trianglemesh\" \"point3 P\" [ 0 0 0 1 ]\n", "e.pbrt:1: value count is not a multiple of the type size in parameter 'P'"},
+        {"Shape \"sphere\" \"integer n\" [ 1.5 ]\n", "e.pbrt:1: malformed number '1.5'"},
+        {"Shape \"sphere\" \"float radius\" [ 1e400 ]\n", "e.pbrt:1: malformed number '1e400'"},
+        {"Shape \"trianglemesh\"\n  \"point3 P\" [ 0 0 0 1e39 0 0 0 1 0 ]\n", "e.pbrt:2: malformed number '1e39'"},
+        {"Translate 1 -4e38 0\n", "e.pbrt:1: malformed number '-4e38'"},
+        {"Shape \"sphere\" \"float radius\" \"one\"\n", "e.pbrt:1: wrong kind of value for parameter 'radius'"},
+        {"\n\nMaterial \"diffuse\" \"string a\n", "e.pbrt:3: unterminated string"},
+        {"Include \"scene_test_missing_file.pbrt\"\n", "e.pbrt:1: cannot open 'scene_test_missing_file.pbrt'"},
+        {"1 2 3\n", "e.pbrt:1: expected a directive, found '1 2 3'"},
+    };
+    for (u32 i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        scene s;
+        EXPECTED_TO_BE(FALSE, scene_parse_text(&s, cases[i][0], strlen(cases[i][0]), "e.pbrt", 0, 0));
+        if (strcmp(s.error, cases[i][1]) != 0) {
+            LOGE("case %u: expected \"%s\", got \"%s\"", i, cases[i][1], s.error);
+        }
+        EXPECTED_TO_BE(0, strcmp(s.error, cases[i][1]));
+        EXPECTED_TO_BE(0, s.directive_count);
+        scene_destroy(&s);
+    }
+
+    // long lists are converted after parsing, their errors still point at the right line
+    text_builder b;
+    text_create(&b, 1 << 16);
+    text_append(&b, "Shape \"trianglemesh\" \"point3 P\" [\n");
+    for (u32 i = 0; i < 1000; ++i) {
+        text_append(&b, i == 700 ? "1 2 3x\n" : "1 2 3\n");
+    }
+    text_append(&b, "]\n");
+    scene s;
+    EXPECTED_TO_BE(FALSE, scene_parse_text(&s, b.text, b.size, "e.pbrt", 0, 0));
+    EXPECTED_TO_BE(0, strcmp(s.error, "e.pbrt:702: malformed number '3x'"));
+    scene_destroy(&s);
+    memory_free(b.text);
+    return TRUE;
+}
+
+u32 test_scene_parse_includes() {
+    char main_path[64], a_path[64], b_path[64], empty_path[64];
+    u32 pid = platform_process_id();
+    log_buffer(main_path, sizeof(main_path), "scene_test_%u_main.pbrt", pid);
+    log_buffer(a_path, sizeof(a_path), "scene_test_%u_a.pbrt", pid);
+    log_buffer(b_path, sizeof(b_path), "scene_test_%u_b.pbrt", pid);
+    log_buffer(empty_path, sizeof(empty_path), "scene_test_%u_empty.pbrt", pid);
+    char main_text[512], a_text[256];
+    log_buffer(main_text, sizeof(main_text),
+               "WorldBegin\nInclude \"%s\"\nAttributeBegin\nImport \"%s\"\nAttributeEnd\nInclude \"%s\"\n",
+               a_path, b_path, empty_path);
+    log_buffer(a_text, sizeof(a_text), "Material \"diffuse\"\nInclude \"%s\"\nShape \"sphere\"\n", b_path);
+    const char* b_text = "Translate 1 2 3\nShape \"disk\"\n";
+    EXPECTED_TO_BE(TRUE, write_file(main_path, main_text, strlen(main_text)));
+    EXPECTED_TO_BE(TRUE, write_file(a_path, a_text, strlen(a_text)));
+    EXPECTED_TO_BE(TRUE, write_file(b_path, b_text, strlen(b_text)));
+    EXPECTED_TO_BE(TRUE, write_file(empty_path, "", 0));
+
+    zpool pool;
+    zpool_create(&pool, 3);
+    scene s;
+    bool parsed = scene_parse_file(&s, main_path, 0, &pool);
+    if (!parsed) {
+        LOGE("%s", s.error);
+    }
+    EXPECTED_TO_BE(TRUE, parsed);
+    // main, its three includes, then b again from inside a
+    EXPECTED_TO_BE(5, s.file_count);
+    const u32 expected[9] = {SCENE_WORLD_BEGIN, SCENE_MATERIAL,  SCENE_TRANSLATE,     SCENE_SHAPE,      SCENE_SHAPE,
+                             SCENE_ATTRIBUTE_BEGIN, SCENE_TRANSLATE, SCENE_SHAPE, SCENE_ATTRIBUTE_END};
+    EXPECTED_TO_BE(9, s.directive_count);
+    for (u32 i = 0; i < 9; ++i) {
+        EXPECTED_TO_BE(expected[i], s.directives[i].type);
+    }
+    EXPECTED_TO_BE(0, strcmp(s.directives[4].strings[0], "sphere"));
+    EXPECTED_TO_BE(3, s.directives[4].line);
+    EXPECTED_TO_BE(0, strcmp(s.files[s.directives[2].file], b_path));
+    EXPECTED_TO_BE(0, strcmp(s.files[s.directives[1].file], a_path));
+    EXPECTED_TO_BE(strlen(main_text) + strlen(a_text) + 2 * strlen(b_text), s.bytes_parsed);
+    scene_destroy(&s);
+
+    // a chain deeper than the limit, main includes a which includes b
+    scene_parse_options options;
+    scene_parse_options_default(&options);
+    options.max_include_depth = 1;
+    EXPECTED_TO_BE(FALSE, scene_parse_file(&s, main_path, &options, &pool));
+    EXPECTED_NOT_TO_BE(0, (u64)strstr(s.error, "includes nested too deep"));
+    scene_destroy(&s);
+
+    // a file including itself twice would double the files to read at every level
+    char self_text[256];
+    log_buffer(self_text, sizeof(self_text), "Shape \"sphere\"\nInclude \"%s\"\nInclude \"%s\"\n", a_path, a_path);
+    EXPECTED_TO_BE(TRUE, write_file(a_path, self_text, strlen(self_text)));
+    char expected_error[192];
+    log_buffer(expected_error, sizeof(expected_error), "%s:2: include cycle at '%s'", a_path, a_path);
+    EXPECTED_TO_BE(FALSE, scene_parse_file(&s, a_path, 0, &pool));
+    EXPECTED_TO_BE(0, strcmp(s.error, expected_error));
+    scene_destroy(&s);
+
+    // and through another file, b includes a back
+    log_buffer(self_text, sizeof(self_text), "Include \"%s\"\n", b_path);
+    EXPECTED_TO_BE(TRUE, write_file(a_path, self_text, strlen(self_text)));
+    log_buffer(self_text, sizeof(self_text), "Shape \"disk\"\nInclude \"%s\"\n", a_path);
+    EXPECTED_TO_BE(TRUE, write_file(b_path, self_text, strlen(self_text)));
+    log_buffer(expected_error, sizeof(expected_error), "%s:2: include cycle at '%s'", b_path, a_path);
+    EXPECTED_TO_BE(FALSE, scene_parse_file(&s, main_path, 0, &pool));
+    EXPECTED_TO_BE(0, strcmp(s.error, expected_error));
+    scene_destroy(&s);
+
+    zpool_destroy(&pool);
+    remove(main_path);
+    remove(a_path);
+    remove(b_path);
+    remove(empty_path);
+    return TRUE;
+}
+
+u32 test_scene_parallel_matches_serial() {
+    text_builder b;
+    text_create(&b, 1 << 20);
+    generate_scene(&b, 40, 1500, 52);
+    scene serial;
+    EXPECTED_TO_BE(TRUE, scene_parse_text(&serial, b.text, b.size, "generated.pbrt", 0, 0));
+    EXPECTED_TO_BE(3 + 40 * 5 + 1, serial.directive_count);
+    const scene_param* p = scene_directive_param(&serial.directives[7], "P");
+    EXPECTED_TO_BE(4500, p->count);
+
+    // small chunks cut through the number lists, and both conversion paths run on the pool
+    zpool pool;
+    zpool_create(&pool, 3);
+    scene_parse_options options;
+    scene_parse_options_default(&options);
+    options.chunk_bytes = 4096;
+    scene parallel;
+    EXPECTED_TO_BE(TRUE, scene_parse_text(&parallel, b.text, b.size, "generated.pbrt", &options, &pool));
+    EXPECTED_TO_BE(TRUE, scenes_equal(&serial, &parallel));
+    scene_destroy(&parallel);
+    zpool_destroy(&pool);
+    scene_destroy(&serial);
+    memory_free(b.text);
+    return TRUE;
+}
+
+// tokenize, structure and convert a generated scene file, serial against the pool
+u32 test_scene_bench_parse() {
+    char path[64];
+    log_buffer(path, sizeof(path), "scene_bench_%u.pbrt", platform_process_id());
+    text_builder b;
+    text_create(&b, 64 << 20);
+    generate_scene(&b, 100, 20000, 53);
+    EXPECTED_TO_BE(TRUE, write_file(path, b.text, b.size));
+    f64 megabytes = b.size / (1024.0 * 1024.0);
+    memory_free(b.text);
+
+    clock clk;
+    clock_set(&clk);
+    scene serial;
+    EXPECTED_TO_BE(TRUE, scene_parse_file(&serial, path, 0, 0));
+    clock_update(&clk);
+    f64 serial_seconds = clk.elapsed;
+
+    zpool pool;
+    zpool_create(&pool, 0);
+    u32 threads = zpool_thread_count(&pool);
+    clock_set(&clk);
+    scene parallel;
+    EXPECTED_TO_BE(TRUE, scene_parse_file(&parallel, path, 0, &pool));
+    clock_update(&clk);
+    f64 parallel_seconds = clk.elapsed;
+    EXPECTED_TO_BE(TRUE, scenes_equal(&serial, &parallel));
+    log_stdout("    scene parse %.1f MB, %u directives: serial %.0f MB/s, %u threads %.0f MB/s\n",
+               megabytes,
+               serial.directive_count,
+               megabytes / serial_seconds,
+               threads,
+               megabytes / parallel_seconds);
+    scene_destroy(&parallel);
+    scene_destroy(&serial);
+    zpool_destroy(&pool);
+    remove(path);
+    return TRUE;
+}
+
+void register_scene_testcases() {
+    test_manager_add(test_scene_tokenizer, "scene_tokenizer");
+    test_manager_add(test_scene_parse_numbers, "scene_parse_numbers");
+    test_manager_add(test_scene_parse_directives, "scene_parse_directives");
+    test_manager_add(test_scene_parse_errors, "scene_parse_errors");
+    test_manager_add(test_scene_parse_includes, "scene_parse_includes");
+    test_manager_add(test_scene_parallel_matches_serial, "scene_parallel_matches_serial");
+    test_manager_add(test_scene_bench_parse, "scene_bench_parse");
+}
@@ -0,0 +1,125 @@
+#include "test_manager.h"
+#include "memory.h"
+#include "zpool.h"
+#include "zatomic.h"
+#include "logger.h"
+
+// ============================================================================
+// ZPOOL TESTS
+// ============================================================================
+
+typedef struct pool_test_data {
+    zpool* pool;
+    u32* visits;
+    volatile u64 sum;
+    u32 thread_count;
+    volatile u32 bad_thread_index;
+} pool_test_data;
+
+static void count_visit(void* params, u64 index, u32 thread_index) {
+    pool_test_data* data = (pool_test_data*)params;
+    zatomic_add_u32(&data->visits[index], 1);
+    zatomic_add_u64(&data->sum, index);
+    if (thread_index >= data->thread_count) {
+        zatomic_store_u32(&data->bad_thread_index, TRUE);
+    }
+}
+
+u32 test_zpool_parallel_for_visits_once() {
+    zpool pool;
+    zpool_create(&pool, 4);
+    const u64 count = 10000;
+    pool_test_data data = {&pool, (u32*)memory_allocate(sizeof(u32) * count), 0, zpool_thread_count(&pool), FALSE};
+    for (u64 i = 0; i < count; ++i) {
+        data.visits[i] = 0;
+    }
+
+    zpool_parallel_for(&pool, count, 0, count_visit, &data);
+    zpool_destroy(&pool);
+
+    for (u64 i = 0; i < count; ++i) {
+        EXPECTED_TO_BE(1, data.visits[i]);
+    }
+    EXPECTED_TO_BE(count * (count - 1) / 2, data.sum);
+    EXPECTED_TO_BE(FALSE, data.bad_thread_index);
+    memory_free(data.visits);
+    return TRUE;
+}
+
+u32 test_zpool_repeated_jobs() {
+    zpool pool;
+    zpool_create(&pool, 3);
+    const u64 count = 257;
+    pool_test_data data = {&pool, (u32*)memory_allocate(sizeof(u32) * count), 0, zpool_thread_count(&pool), FALSE};
+    for (u64 i = 0; i < count; ++i) {
+        data.visits[i] = 0;
+    }
+
+    for (u32 job = 0; job < 50; ++job) {
+        zpool_parallel_for(&pool, count, 1 + job % 7, count_visit, &data);
+    }
+    zpool_destroy(&pool);
+
+    for (u64 i = 0; i < count; ++i) {
+        EXPECTED_TO_BE(50, data.visits[i]);
+    }
+    memory_free(data.visits);
+    return TRUE;
+}
+
+static void nested_visit(void* params, u64 index, u32 thread_index) {
+    pool_test_data* data = (pool_test_data*)params;
+    // the pool is busy, so the inner loop runs on this thread
+    pool_test_data inner = *data;
+    inner.visits = data->visits + index * 8;
+    zpool_parallel_for(data->pool, 8, 1, count_visit, &inner);
+    zatomic_add_u64(&data->sum, inner.sum);
+}
+
+u32 test_zpool_nested_parallel_for() {
+    zpool pool;
+    zpool_create(&pool, 2);
+    const u64 count = 64;
+    pool_test_data data = {&pool, (u32*)memory_allocate(sizeof(u32) * count * 8), 0, zpool_thread_count(&pool), FALSE};
+    for (u64 i = 0; i < count * 8; ++i) {
+        data.visits[i] = 0;
+    }
+
+    zpool_parallel_for(&pool, count, 1, nested_visit, &data);
+    zpool_destroy(&pool);
+
+    for (u64 i = 0; i < count * 8; ++i) {
+        EXPECTED_TO_BE(1, data.visits[i]);
+    }
+    EXPECTED_TO_BE(FALSE, data.bad_thread_index);
+    memory_free(data.visits);
+    return TRUE;
+}
+
+u32 test_zpool_null_pool_runs_serially() {
+    const u64 count = 100;
+    pool_test_data data = {0, (u32*)memory_allocate(sizeof(u32) * count), 0, 1, FALSE};
+    for (u64 i = 0; i < count; ++i) {
+        data.visits[i] = 0;
+    }
+
+    zpool_parallel_for(0, count, 0, count_visit, &data);
+
+    for (u64 i = 0; i < count; ++i) {
+        EXPECTED_TO_BE(1, data.visits[i]);
+    }
+    EXPECTED_TO_BE(FALSE, data.bad_thread_index);
+    memory_free(data.visits);
+    return TRUE;
+}
+
+// ============================================================================
+// MAIN TEST REGISTRATION
+// ============================================================================
+
+void register_threads_testcases() {
+    test_manager_add(test_zpool_parallel_for_visits_once, "zpool_parallel_for_visits_once");
+    test_manager_add(test_zpool_repeated_jobs, "zpool_repeated_jobs");
+    test_manager_add(test_zpool_nested_parallel_for, "zpool_nested_parallel_for");
+    test_manager_add(test_zpool_null_pool_runs_serially, "zpool_null_pool_runs_serially");
+}